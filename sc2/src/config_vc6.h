@@ -35,6 +35,9 @@
 /* Defined if your system has setenv of its own */
 #undef HAVE_SETENV
 
+/* Defined if your system has mmap */
+#undef HAVE_MMAP
+
 /* Defined if your system has strupr of its own */
 #define HAVE_STRUPR
 
@@ -20,6 +20,7 @@
 
 #include SDL_INCLUDE(SDL.h)
 #include "libs/heap.h"
+#include "libs/memlib.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -30,12 +31,12 @@ Heap *alarmHeap;
 
 static inline Alarm *
 Alarm_alloc(void) {
-	return malloc(sizeof (Alarm));
+	return HMallocObject(sizeof (Alarm));
 }
 
 static inline void
 Alarm_free(Alarm *alarm) {
-	free(alarm);
+	HFreeObject(alarm, sizeof (Alarm));
 }
 
 static inline int
@@ -24,6 +24,7 @@
 #include <sys/types.h>
 
 #include "libs/threadlib.h"
+#include "libs/memlib.h"
 
 typedef struct CallbackLink CallbackLink;
 
@@ -77,7 +78,7 @@ Callback_uninit(void) {
 // Callbacks are guaranteed to be called in the order that they are queued.
 CallbackID
 Callback_add(CallbackFunction callback, CallbackArg arg) {
-	CallbackLink *link = malloc(sizeof (CallbackLink));
+	CallbackLink *link = HMallocObject(sizeof (CallbackLink));
 	link->callback = callback;
 	link->arg = arg;
 	link->next = NULL;
@@ -92,7 +93,7 @@ Callback_add(CallbackFunction callback, CallbackArg arg) {
 
 static void
 CallbackLink_delete(CallbackLink *link) {
-	free(link);
+	HFreeObject(link, sizeof (CallbackLink));
 }
 
 // Pre: CallbackList is locked.
@@ -0,0 +1,178 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "libs/graphics/blend.h"
+
+#if defined(__SSE2__) || defined(_M_X64) \
+		|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define BLEND_SSE2
+#	include <emmintrin.h>
+#endif
+
+// The SSE2 version works on 16 bytes at a time, as two halves of 8
+// channels widened to 16 bits. Whatever is left at the end of a row is
+// done by the plain C version.
+
+static inline BYTE
+blendColorChan (BYTE from, BYTE to, DWORD frac)
+{
+	// The same as from + (to - from) * frac / BLEND_FRAC_ONE, which
+	// rounds towards zero.
+	if (to < from)
+		return from - (BYTE)(((DWORD)(from - to) * frac) >> 16);
+	return from + (BYTE)(((DWORD)(to - from) * frac) >> 16);
+}
+
+static inline BYTE
+blendPixelChan (BYTE src, BYTE dst, BYTE alpha)
+{
+	// (t + (t >> 8)) >> 8 is t / 255 rounded to the nearest, for
+	// t <= 255 * 255, when 128 is added first.
+	DWORD t = src * alpha + dst * (255 - alpha) + 128;
+	return (BYTE)((t + (t >> 8)) >> 8);
+}
+
+#if defined(BLEND_SSE2)
+
+static inline __m128i
+blendColors8 (__m128i from, __m128i to, __m128i frac)
+{
+	__m128i diff = _mm_sub_epi16 (to, from);
+	__m128i sign = _mm_srai_epi16 (diff, 15);
+	__m128i step = _mm_sub_epi16 (_mm_xor_si128 (diff, sign), sign);
+	step = _mm_mulhi_epu16 (step, frac);
+	step = _mm_sub_epi16 (_mm_xor_si128 (step, sign), sign);
+	return _mm_add_epi16 (from, step);
+}
+
+static inline __m128i
+blendPixels8 (__m128i dst, __m128i invAlpha, __m128i srcTerm)
+{
+	__m128i t = _mm_add_epi16 (_mm_mullo_epi16 (dst, invAlpha), srcTerm);
+	return _mm_srli_epi16 (_mm_add_epi16 (t, _mm_srli_epi16 (t, 8)), 8);
+}
+
+#endif
+
+void
+TFB_BlendColors (Color *dst, const Color *from, const Color *to,
+		COUNT count, DWORD frac)
+{
+	BYTE *d = (BYTE *) dst;
+	const BYTE *f = (const BYTE *) from;
+	const BYTE *t = (const BYTE *) to;
+	size_t n = count * sizeof (Color);
+	size_t i = 0;
+
+#if defined(BLEND_SSE2)
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i vfrac = _mm_set1_epi16 ((short) frac);
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i vf = _mm_loadu_si128 ((const __m128i *) (f + i));
+		__m128i vt = _mm_loadu_si128 ((const __m128i *) (t + i));
+		__m128i lo = blendColors8 (_mm_unpacklo_epi8 (vf, zero),
+				_mm_unpacklo_epi8 (vt, zero), vfrac);
+		__m128i hi = blendColors8 (_mm_unpackhi_epi8 (vf, zero),
+				_mm_unpackhi_epi8 (vt, zero), vfrac);
+		_mm_storeu_si128 ((__m128i *) (d + i), _mm_packus_epi16 (lo, hi));
+	}
+#endif
+
+	for (; i < n; ++i)
+		d[i] = blendColorChan (f[i], t[i], frac);
+}
+
+static void
+blendRow (BYTE *dst, const BYTE *src, size_t n, BYTE alpha)
+{
+	size_t i = 0;
+
+#if defined(BLEND_SSE2)
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i valpha = _mm_set1_epi16 (alpha);
+	const __m128i vinv = _mm_set1_epi16 (255 - alpha);
+	const __m128i round = _mm_set1_epi16 (128);
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i vs = _mm_loadu_si128 ((const __m128i *) (src + i));
+		__m128i vd = _mm_loadu_si128 ((const __m128i *) (dst + i));
+		__m128i lo = blendPixels8 (_mm_unpacklo_epi8 (vd, zero), vinv,
+				_mm_add_epi16 (_mm_mullo_epi16 (
+				_mm_unpacklo_epi8 (vs, zero), valpha), round));
+		__m128i hi = blendPixels8 (_mm_unpackhi_epi8 (vd, zero), vinv,
+				_mm_add_epi16 (_mm_mullo_epi16 (
+				_mm_unpackhi_epi8 (vs, zero), valpha), round));
+		_mm_storeu_si128 ((__m128i *) (dst + i), _mm_packus_epi16 (lo, hi));
+	}
+#endif
+
+	for (; i < n; ++i)
+		dst[i] = blendPixelChan (src[i], dst[i], alpha);
+}
+
+static void
+fillRow (BYTE *dst, uint32 pixel, size_t n, BYTE alpha)
+{
+	const BYTE *pixelBytes = (const BYTE *) &pixel;
+	size_t i = 0;
+
+#if defined(BLEND_SSE2)
+	const __m128i vinv = _mm_set1_epi16 (255 - alpha);
+	// Two pixels' worth of src * alpha + 128.
+	const __m128i srcTerm = _mm_add_epi16 (_mm_mullo_epi16 (
+			_mm_unpacklo_epi8 (_mm_set1_epi32 ((int) pixel),
+			_mm_setzero_si128 ()), _mm_set1_epi16 (alpha)),
+			_mm_set1_epi16 (128));
+	const __m128i zero = _mm_setzero_si128 ();
+
+	for (; i + 16 <= n; i += 16)
+	{
+		__m128i vd = _mm_loadu_si128 ((const __m128i *) (dst + i));
+		__m128i lo = blendPixels8 (_mm_unpacklo_epi8 (vd, zero), vinv,
+				srcTerm);
+		__m128i hi = blendPixels8 (_mm_unpackhi_epi8 (vd, zero), vinv,
+				srcTerm);
+		_mm_storeu_si128 ((__m128i *) (dst + i), _mm_packus_epi16 (lo, hi));
+	}
+#endif
+
+	for (; i < n; ++i)
+		dst[i] = blendPixelChan (pixelBytes[i & 3], dst[i], alpha);
+}
+
+void
+TFB_BlendPixels (void *dst, int dstPitch, const void *src, int srcPitch,
+		int w, int h, BYTE alpha)
+{
+	BYTE *d = (BYTE *) dst;
+	const BYTE *s = (const BYTE *) src;
+
+	for (; h > 0; --h, d += dstPitch, s += srcPitch)
+		blendRow (d, s, (size_t) w * 4, alpha);
+}
+
+void
+TFB_BlendFill (void *dst, int dstPitch, int w, int h, uint32 pixel,
+		BYTE alpha)
+{
+	BYTE *d = (BYTE *) dst;
+
+	for (; h > 0; --h, d += dstPitch)
+		fillRow (d, pixel, (size_t) w * 4, alpha);
+}
@@ -0,0 +1,57 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Blending kernels for colormap transformations and screen fades.
+// Where SSE2 is available at compile time it is used; the SSE2 version
+// gives exactly the same results as the plain C one.
+
+#ifndef LIBS_GRAPHICS_BLEND_H_
+#define LIBS_GRAPHICS_BLEND_H_
+
+#include "libs/gfxlib.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Weights for TFB_BlendColors() are fractions of this.
+#define BLEND_FRAC_ONE 0x10000
+
+// Sets each channel of 'dst' to from + (to - from) * frac / BLEND_FRAC_ONE,
+// rounded towards 'from'. 'frac' must be less than BLEND_FRAC_ONE.
+// 'dst' may be the same as 'from' or 'to'.
+extern void TFB_BlendColors (Color *dst, const Color *from, const Color *to,
+		COUNT count, DWORD frac);
+
+// The pixel functions below work on 32 bits per pixel, 8 bits per
+// channel. Every channel is blended the same way, so the order of the
+// channels does not matter, as long as 'dst' and 'src' use the same one.
+// Pitches are in bytes.
+
+// Sets dst to (src * alpha + dst * (255 - alpha)) / 255, rounded to the
+// nearest value, for a 'w' by 'h' rectangle.
+extern void TFB_BlendPixels (void *dst, int dstPitch, const void *src,
+		int srcPitch, int w, int h, BYTE alpha);
+
+// As TFB_BlendPixels(), with every source pixel being 'pixel'.
+extern void TFB_BlendFill (void *dst, int dstPitch, int w, int h,
+		uint32 pixel, BYTE alpha);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_GRAPHICS_BLEND_H_ */
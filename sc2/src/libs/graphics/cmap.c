@@ -17,6 +17,7 @@
  */
 
 #include "libs/graphics/cmap.h"
+#include "libs/graphics/blend.h"
 #include "libs/threadlib.h"
 #include "libs/timelib.h"
 #include "libs/inplib.h"
@@ -35,6 +36,8 @@ typedef struct xform_control
 	DWORD StartTime;
 	DWORD EndTime;
 	Color OldCMap[NUMBER_OF_PLUTVALS];
+	Color NewCMap[NUMBER_OF_PLUTVALS];
+			// CMapPtr unpacked, for blending
 } XFORM_CONTROL;
 
 #define MAX_XFORMS 16
@@ -458,12 +461,6 @@ finish_colormap_xform (int which)
 	}
 }
 
-static inline BYTE
-blendChan (BYTE c1, BYTE c2, int weight, int scale)
-{
-	return c1 + ((int)c2 - c1) * weight / scale;
-}
-
 /* This gives the XFormColorMap task a timeslice to do its thing
  * Only one thread should ever be allowed to be calling this at any time
  */
@@ -499,35 +496,18 @@ XFormColorMap_step (void)
 
 		if (TicksLeft > 0)
 		{
-#define XFORM_SCALE 0x10000
 			TFB_ColorMap *newmap = NULL;
-			UBYTE *newClr;
-			Color *oldClr;
-			int frac;
-			int i;
+			Color colors[NUMBER_OF_PLUTVALS];
+			DWORD frac;
 
 			newmap = clone_colormap (curmap, index);
 
-			oldClr = control->OldCMap;
-			newClr = (UBYTE*)control->CMapPtr + 2;
-
-			frac = (int)(control->Ticks - TicksLeft) * XFORM_SCALE
+			frac = (DWORD)(control->Ticks - TicksLeft) * BLEND_FRAC_ONE
 					/ control->Ticks;
-
-			for (i = 0; i < NUMBER_OF_PLUTVALS; ++i, ++oldClr,
-					newClr += PLUTVAL_BYTE_SIZE)
-			{
-				Color color;
-
-				color.a = 0xff;
-				color.r = blendChan (oldClr->r, newClr[PLUTVAL_RED],
-						frac, XFORM_SCALE);
-				color.g = blendChan (oldClr->g, newClr[PLUTVAL_GREEN],
-						frac, XFORM_SCALE);
-				color.b = blendChan (oldClr->b, newClr[PLUTVAL_BLUE],
-						frac, XFORM_SCALE);
-				SetNativePaletteColor (newmap->palette, i, color);
-			}
+			TFB_BlendColors (colors, control->OldCMap, control->NewCMap,
+					NUMBER_OF_PLUTVALS, frac);
+			SetNativePaletteColors (newmap->palette, 0, NUMBER_OF_PLUTVALS,
+					colors);
 
 			colormaps[index] = newmap;
 			release_colormap (curmap);
@@ -621,6 +601,20 @@ XFormPLUT (COLORMAPPTR ColorMapPtr, SIZE TimeInterval)
 	GetColorMapColors (control->OldCMap, map);
 	UnlockMutex (maplock);
 
+	{
+		const UBYTE *newClr = (const UBYTE *)ColorMapPtr + 2;
+		int i;
+
+		for (i = 0; i < NUMBER_OF_PLUTVALS; ++i,
+				newClr += PLUTVAL_BYTE_SIZE)
+		{
+			control->NewCMap[i].r = newClr[PLUTVAL_RED];
+			control->NewCMap[i].g = newClr[PLUTVAL_GREEN];
+			control->NewCMap[i].b = newClr[PLUTVAL_BLUE];
+			control->NewCMap[i].a = 0xff;
+		}
+	}
+
 	control->CMapIndex = index;
 	control->CMapPtr = ColorMapPtr;
 	control->Ticks = TimeInterval;
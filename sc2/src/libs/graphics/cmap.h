@@ -72,6 +72,8 @@ extern BOOLEAN XFormColorMap_step (void);
 NativePalette* AllocNativePalette (void);
 void FreeNativePalette (NativePalette *);
 void SetNativePaletteColor (NativePalette *, int index, Color);
+void SetNativePaletteColors (NativePalette *, int first, int count,
+		const Color *);
 Color GetNativePaletteColor (NativePalette *, int index);
 
 #endif /* CMAP_H */
@@ -22,7 +22,9 @@
 #include "libs/graphics/dcqueue.h"
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/bbox.h"
+#include "libs/graphics/framesched.h"
 #include "libs/timelib.h"
+#include "libs/perflib.h"
 #include "libs/log.h"
 #include "libs/misc.h"
 		// for TFB_DEBUG_HALT
@@ -39,6 +41,10 @@ TFB_DrawCommandQueue DrawCommandQueue;
 #define FPS_PERIOD  (ONE_SECOND / 100)
 int RenderedFrames = 0;
 
+// When the last unbatched draw commands were made available to the
+// renderer. Protected by DCQ_Mutex.
+static uint64 DCQ_CommitTime = 0;
+
 
 // Wait for the queue to be emptied.
 static void
@@ -96,6 +102,7 @@ Synchronize_DCQ (void)
 			DrawCommandQueue.Size = (back + DCQ_MAX - front);
 		}
 		DrawCommandQueue.FullSize = DrawCommandQueue.Size;
+		DCQ_CommitTime = GetPerfCounter ();
 	}
 }
 
@@ -327,6 +334,14 @@ TFB_FlushGraphics (void)
 
 	// This is technically a locking violation on DrawCommandQueue.Size,
 	// but it is likely to not be very destructive.
+	if (DrawCommandQueue.Size <= DCQ_FORCE_SLOWDOWN_SIZE)
+	{	// Draw at most once per frame, unless the queue is filling up
+		// so fast that the game would have to wait for it.
+		if (!TFB_FrameDue ())
+			return;
+		TFB_AdvanceFrameDeadline ();
+	}
+
 	if (DrawCommandQueue.Size == 0)
 	{
 		static int last_fade = 255;
@@ -343,10 +358,6 @@ TFB_FlushGraphics (void)
 			TFB_SwapBuffers (TFB_REDRAW_FADING);
 					// if fading, redraw every frame
 		}
-		else
-		{
-			TaskSwitch ();
-		}
 		
 		last_fade = current_fade;
 		last_transition = current_transition;
@@ -371,8 +382,15 @@ TFB_FlushGraphics (void)
 		livelock_deterrence = TRUE;
 	}
 
+	perf_inc (PERF_DCQ_FLUSHES);
+	perf_add (PERF_DCQ_DEPTH, DrawCommandQueue.Size);
+
 	TFB_BBox_Reset ();
 
+	LockRecursiveMutex (DCQ_Mutex);
+	TFB_MarkFrameStage (TFB_FRAME_LOGIC, DCQ_CommitTime);
+	UnlockRecursiveMutex (DCQ_Mutex);
+
 	for (;;)
 	{
 		TFB_DrawCommand DC;
@@ -618,6 +636,9 @@ TFB_FlushGraphics (void)
 	if (livelock_deterrence)
 		Unlock_DCQ ();
 
+	perf_add (PERF_DCQ_COMMANDS, commands_handled);
+	TFB_MarkFrameStage (TFB_FRAME_DRAINED, GetPerfCounter ());
+
 	TFB_SwapBuffers (TFB_REDRAW_NO);
 	RenderedFrames++;
 	BroadcastCondVar (RenderingCond);
@@ -0,0 +1,156 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include "libs/graphics/framesched.h"
+#include "libs/timelib.h"
+
+static uint64 framePeriod;
+static uint64 frameDeadline;
+
+static TFB_FrameTimes curFrame;
+static TFB_FrameTimes frameHistory[TFB_FRAME_HISTORY];
+static DWORD framesPresented;
+		// Index into frameHistory[] modulo TFB_FRAME_HISTORY.
+
+void
+TFB_InitFrameSchedule (int rate)
+{
+	if (rate <= 0)
+		rate = TFB_DEFAULT_FRAME_RATE;
+
+	framePeriod = GetPerfFrequency () / rate;
+	if (framePeriod == 0)
+		framePeriod = 1;
+	frameDeadline = GetPerfCounter ();
+}
+
+uint64
+TFB_GetFramePeriod (void)
+{
+	return framePeriod;
+}
+
+uint64
+TFB_GetFrameDeadline (void)
+{
+	return frameDeadline;
+}
+
+BOOLEAN
+TFB_FrameDue (void)
+{
+	return GetPerfCounter () >= frameDeadline;
+}
+
+void
+TFB_AdvanceFrameDeadline (void)
+{
+	uint64 now = GetPerfCounter ();
+
+	curFrame.deadline = frameDeadline;
+
+	frameDeadline += framePeriod;
+	if (frameDeadline <= now)
+	{	// We missed one or more frames; skip them, but keep the
+		// phase, so that the frames after this one are evenly spaced.
+		frameDeadline += ((now - frameDeadline) / framePeriod + 1)
+				* framePeriod;
+	}
+}
+
+void
+TFB_MarkFrameStage (TFB_FrameStage stage, uint64 time)
+{
+	curFrame.stage[stage] = time;
+}
+
+void
+TFB_EndFrame (void)
+{
+	curFrame.stage[TFB_FRAME_PRESENTED] = GetPerfCounter ();
+	frameHistory[framesPresented % TFB_FRAME_HISTORY] = curFrame;
+	framesPresented++;
+	memset (&curFrame, 0, sizeof curFrame);
+}
+
+void
+TFB_DiscardFrame (void)
+{
+	memset (&curFrame, 0, sizeof curFrame);
+}
+
+const TFB_FrameTimes *
+TFB_GetFrameTimes (COUNT age)
+{
+	if (age >= TFB_FRAME_HISTORY || age >= framesPresented)
+		return NULL;
+	return &frameHistory[(framesPresented - 1 - age) % TFB_FRAME_HISTORY];
+}
+
+// Prints the time from 'from' to 'to' in microseconds, or nothing if
+// either is not known.
+static void
+dumpInterval (FILE *out, uint64 from, uint64 to, uint64 freq)
+{
+	fputc (',', out);
+	if (from == 0 || to == 0)
+		return;
+	if (to >= from)
+		fprintf (out, "%lu", (unsigned long) ((to - from) * 1000000 / freq));
+	else
+		fprintf (out, "-%lu", (unsigned long) ((from - to) * 1000000 / freq));
+}
+
+void
+TFB_DumpFrameTimes (FILE *out)
+{
+	uint64 freq = GetPerfFrequency ();
+	COUNT count;
+	COUNT age;
+	const TFB_FrameTimes *first;
+	uint64 prevPresented = 0;
+
+	fprintf (out, "frame,present_us,interval_us,late_us,"
+			"logic_to_drained_us,drained_to_scaled_us,"
+			"scaled_to_presented_us\n");
+
+	count = framesPresented < TFB_FRAME_HISTORY ?
+			(COUNT) framesPresented : TFB_FRAME_HISTORY;
+	if (count == 0)
+		return;
+	first = TFB_GetFrameTimes (count - 1);
+
+	for (age = count; age-- > 0; )
+	{
+		const TFB_FrameTimes *frame = TFB_GetFrameTimes (age);
+		uint64 presented = frame->stage[TFB_FRAME_PRESENTED];
+
+		fprintf (out, "%lu", (unsigned long) (framesPresented - 1 - age));
+		dumpInterval (out, first->stage[TFB_FRAME_PRESENTED], presented,
+				freq);
+		dumpInterval (out, prevPresented, presented, freq);
+		dumpInterval (out, frame->deadline, presented, freq);
+		dumpInterval (out, frame->stage[TFB_FRAME_LOGIC],
+				frame->stage[TFB_FRAME_DRAINED], freq);
+		dumpInterval (out, frame->stage[TFB_FRAME_DRAINED],
+				frame->stage[TFB_FRAME_SCALED], freq);
+		dumpInterval (out, frame->stage[TFB_FRAME_SCALED], presented, freq);
+		fputc ('\n', out);
+
+		prevPresented = presented;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Frame pacing for the main() thread. The draw command queue is drained
+// and the screen presented once per frame period, on a fixed grid of
+// deadlines, instead of whenever the main loop happens to come around.
+// The times at which each presented frame went through the stages of the
+// pipeline are kept for the last TFB_FRAME_HISTORY frames.
+// All functions must be called on the main() thread.
+
+#ifndef LIBS_GRAPHICS_FRAMESCHED_H_
+#define LIBS_GRAPHICS_FRAMESCHED_H_
+
+#include <stdio.h>
+#include "libs/compiler.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Used when the refresh rate of the display cannot be determined.
+#define TFB_DEFAULT_FRAME_RATE 60
+
+#define TFB_FRAME_HISTORY 256
+
+typedef enum
+{
+	TFB_FRAME_LOGIC,
+			// The game thread committed the last draw commands
+			// that went into the frame.
+	TFB_FRAME_DRAINED,
+			// The draw command queue was emptied.
+	TFB_FRAME_SCALED,
+			// The screens were scaled and composed.
+	TFB_FRAME_PRESENTED,
+			// The frame was handed to the display.
+	TFB_FRAME_NUM_STAGES
+} TFB_FrameStage;
+
+// Times are in GetPerfCounter() counts; 0 if not known.
+typedef struct
+{
+	uint64 deadline;
+			// 0 for frames presented outside of the schedule,
+			// such as on window exposure.
+	uint64 stage[TFB_FRAME_NUM_STAGES];
+} TFB_FrameTimes;
+
+// Start presenting 'rate' frames per second, from now on.
+void TFB_InitFrameSchedule (int rate);
+uint64 TFB_GetFramePeriod (void);
+uint64 TFB_GetFrameDeadline (void);
+BOOLEAN TFB_FrameDue (void);
+// Called when the frame that was due is being produced. The next
+// deadline is one period later, or the first one after now that is on
+// the same grid if frames were missed.
+void TFB_AdvanceFrameDeadline (void);
+
+void TFB_MarkFrameStage (TFB_FrameStage stage, uint64 time);
+// Marks the current frame as presented and adds it to the history.
+void TFB_EndFrame (void);
+// Forgets the stages marked for the current frame, when nothing is
+// presented for it, so that they do not end up in the next frame.
+void TFB_DiscardFrame (void);
+
+// Get the times of a presented frame; 0 is the last one. Returns NULL
+// if fewer than 'age + 1' frames have been presented.
+const TFB_FrameTimes *TFB_GetFrameTimes (COUNT age);
+// Write the frame history to 'out' as CSV, oldest frame first.
+// All times are in microseconds.
+void TFB_DumpFrameTimes (FILE *out);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_GRAPHICS_FRAMESCHED_H_ */
@@ -71,9 +71,24 @@ void TFB_ProcessEvents (void);
 bool TFB_SetGamma (float gamma);
 void TFB_UploadTransitionScreen (void);
 int TFB_SupportsHardwareScaling (void);
+// Present at most 'rate' frames per second; 0 for the refresh rate of
+// the display.
+void TFB_SetFrameRate (int rate);
+// Sleep until the next frame is due, or until an event arrives.
+void TFB_WaitForFrame (void);
 // This function should not be called directly
 void TFB_SwapBuffers (int force_full_redraw);
 
+// For the benchmarks: scales a frame of ScreenWidth x ScreenHeight, in
+// the format of the screen, to twice its size, with the scaler selected
+// by 'flags' (one of TFB_GFXFLAGS_SCALE_*, or 0 for nearest neighbour).
+// TFB_ScalerBench_New() returns NULL if the scaler can not be set up.
+typedef struct tfb_scalerbench TFB_ScalerBench;
+TFB_ScalerBench *TFB_ScalerBench_New (int flags);
+void TFB_ScalerBench_Run (TFB_ScalerBench *bench);
+		// Scales the whole frame once.
+void TFB_ScalerBench_Delete (TFB_ScalerBench *bench);
+
 #define GSCALE_IDENTITY 256
 
 typedef enum {
@@ -0,0 +1,98 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "libs/graphics/indexblit.h"
+#include <string.h>
+		// for memcpy()
+
+// Copies one row of palette indices to 32bpp pixels.
+static inline void
+blitIndexedRow (const BYTE *src, uint32 *dst, int width, const uint32 *lut)
+{
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4)
+	{
+		dst[i] = lut[src[i]];
+		dst[i + 1] = lut[src[i + 1]];
+		dst[i + 2] = lut[src[i + 2]];
+		dst[i + 3] = lut[src[i + 3]];
+	}
+	for (; i < width; ++i)
+		dst[i] = lut[src[i]];
+}
+
+// Like blitIndexedRow(), but pixels with index 'key' are skipped.
+// Four indices are tested at once, so that runs of opaque or transparent
+// pixels do not need a test per pixel.
+static inline void
+blitIndexedRowKeyed (const BYTE *src, uint32 *dst, int width,
+		const uint32 *lut, BYTE key)
+{
+	const uint32 keyQuad = key * 0x01010101U;
+	int i;
+
+	for (i = 0; i + 4 <= width; i += 4)
+	{
+		uint32 quad;
+		uint32 diff;
+
+		memcpy (&quad, src + i, sizeof quad);
+		diff = quad ^ keyQuad;
+				// A byte of 'diff' is 0 where the pixel is transparent.
+		if (((diff - 0x01010101U) & ~diff & 0x80808080U) == 0)
+		{	// no transparent pixels
+			dst[i] = lut[src[i]];
+			dst[i + 1] = lut[src[i + 1]];
+			dst[i + 2] = lut[src[i + 2]];
+			dst[i + 3] = lut[src[i + 3]];
+		}
+		else if (diff != 0)
+		{	// some transparent pixels
+			int j;
+			for (j = i; j < i + 4; ++j)
+			{
+				if (src[j] != key)
+					dst[j] = lut[src[j]];
+			}
+		}
+	}
+	for (; i < width; ++i)
+	{
+		if (src[i] != key)
+			dst[i] = lut[src[i]];
+	}
+}
+
+void
+TFB_BlitIndexed (void *dst, int dstPitch, const BYTE *src, int srcPitch,
+		int w, int h, const uint32 *lut)
+{
+	BYTE *d = (BYTE *) dst;
+
+	for (; h > 0; --h, d += dstPitch, src += srcPitch)
+		blitIndexedRow (src, (uint32 *) d, w, lut);
+}
+
+void
+TFB_BlitIndexedKeyed (void *dst, int dstPitch, const BYTE *src,
+		int srcPitch, int w, int h, const uint32 *lut, BYTE key)
+{
+	BYTE *d = (BYTE *) dst;
+
+	for (; h > 0; --h, d += dstPitch, src += srcPitch)
+		blitIndexedRowKeyed (src, (uint32 *) d, w, lut, key);
+}
@@ -0,0 +1,44 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Kernels for drawing paletted images to 32bpp pixels through a lookup
+// table of 256 destination pixels, one for each palette index.
+
+#ifndef LIBS_GRAPHICS_INDEXBLIT_H_
+#define LIBS_GRAPHICS_INDEXBLIT_H_
+
+#include "libs/gfxlib.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Pitches are in bytes. 'src' has one byte per pixel, 'dst' four.
+
+// Sets each pixel of a 'w' by 'h' rectangle of 'dst' to lut[i], where i
+// is the palette index of the same pixel in 'src'.
+extern void TFB_BlitIndexed (void *dst, int dstPitch, const BYTE *src,
+		int srcPitch, int w, int h, const uint32 *lut);
+
+// As TFB_BlitIndexed(), but the pixels with index 'key' are left alone.
+extern void TFB_BlitIndexedKeyed (void *dst, int dstPitch, const BYTE *src,
+		int srcPitch, int w, int h, const uint32 *lut, BYTE key);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_GRAPHICS_INDEXBLIT_H_ */
@@ -23,6 +23,7 @@
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/tfb_draw.h"
 #include "libs/graphics/cmap.h"
+#include "libs/graphics/indexblit.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
 #include "primitives.h"
@@ -193,6 +194,67 @@ TFB_DrawCanvas_Blit (SDL_Surface *src, SDL_Rect *src_r,
 	}
 }
 
+// Blits a paletted image to a 32bpp canvas, taking the colors from
+// 'lut' instead of from the palette of the image. This way, an image
+// drawn with an ever changing colormap does not need its palette
+// updated, which would make SDL rebuild its color mapping for the
+// following blit.
+// Returns FALSE when the surfaces are not suitable; nothing is drawn
+// then.
+static BOOLEAN
+TFB_DrawCanvas_BlitIndexed (SDL_Surface *src, const NativePalette *palette,
+		SDL_Surface *dst, int x, int y)
+{
+	const Uint32 *lut;
+	SDL_Rect clip;
+	int sx = 0, sy = 0;
+	int width = src->w;
+	int height = src->h;
+	Uint32 colorkey;
+	BOOLEAN keyed;
+	const Uint8 *srcRow;
+	Uint8 *dstRow;
+
+	if (dst->format->BytesPerPixel != 4 || SDL_MUSTLOCK (src))
+		return FALSE;  // RLE-encoded pixels cannot be read directly
+
+	SDL_GetClipRect (dst, &clip);
+	if (x < clip.x)
+	{
+		sx = clip.x - x;
+		width -= sx;
+		x = clip.x;
+	}
+	if (y < clip.y)
+	{
+		sy = clip.y - y;
+		height -= sy;
+		y = clip.y;
+	}
+	if (x + width > clip.x + clip.w)
+		width = clip.x + clip.w - x;
+	if (y + height > clip.y + clip.h)
+		height = clip.y + clip.h - y;
+	if (width <= 0 || height <= 0)
+		return TRUE;  // completely clipped
+
+	lut = GetNativePalettePixels ((NativePalette *) palette, dst->format);
+	keyed = TFB_GetColorKey (src, &colorkey) == 0;
+
+	SDL_LockSurface (dst);
+	srcRow = (const Uint8 *) src->pixels + sy * src->pitch + sx;
+	dstRow = (Uint8 *) dst->pixels + y * dst->pitch + x * 4;
+	if (keyed)
+		TFB_BlitIndexedKeyed (dstRow, dst->pitch, srcRow, src->pitch,
+				width, height, lut, (BYTE) colorkey);
+	else
+		TFB_BlitIndexed (dstRow, dst->pitch, srcRow, src->pitch,
+				width, height, lut);
+	SDL_UnlockSurface (dst);
+
+	return TRUE;
+}
+
 // XXX: If a colormap is passed in, it has to have been acquired via
 // TFB_GetColorMap(). We release the colormap at the end.
 void
@@ -213,6 +275,20 @@ TFB_DrawCanvas_Image (TFB_Image *img, int x, int y, int scale,
 	LockMutex (img->mutex);
 
 	NormalPal = ((SDL_Surface *)img->NormalImg)->format->palette;
+
+	if (NormalPal && cmap && mode.kind == DRAW_REPLACE
+			&& (scale == 0 || scale == GSCALE_IDENTITY)
+			&& TFB_DrawCanvas_BlitIndexed (img->NormalImg, cmap->palette,
+				target, x - img->NormalHs.x, y - img->NormalHs.y))
+	{
+		// The palette of the image is left alone, and so is
+		// img->colormap_version; the other paths will still update the
+		// palette when they need it.
+		TFB_ReturnColorMap (cmap);
+		UnlockMutex (img->mutex);
+		return;
+	}
+
 	// only set the new palette if it changed
 	if (NormalPal && cmap && img->colormap_version != cmap->version)
 		TFB_SetColors (img->NormalImg, cmap->palette->colors, 0, 256);
@@ -23,6 +23,7 @@
 #include "scalers.h"
 #include "options.h"
 #include "libs/log.h"
+#include "libs/perflib.h"
 
 #if SDL_MAJOR_VERSION == 1
 
@@ -499,7 +500,9 @@ TFB_GL_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 	if (GL_Screens[screen].dirty)
 	{
 		int PitchWords = GL_Screens[screen].scaled->pitch / 4;
+		uint64 startTime = GetPerfCounter ();
 		scaler (SDL_Screens[screen], GL_Screens[screen].scaled, &GL_Screens[screen].updated);
+		perf_addTimeSince (PERF_SCALER_TIME, startTime);
 		glPixelStorei (GL_UNPACK_ROW_LENGTH, PitchWords);
 
 		 /* Matrox OpenGL drivers do not handle GL_UNPACK_SKIP_*
@@ -37,6 +37,19 @@ SetNativePaletteColor (NativePalette *palette, int index, Color color)
 {
 	assert (index < NUMBER_OF_PLUTVALS);
 	palette->colors[index] = ColorToNative (color);
+	palette->pixelFormat = NULL;
+}
+
+void
+SetNativePaletteColors (NativePalette *palette, int first, int count,
+		const Color *colors)
+{
+	int i;
+
+	assert (first + count <= NUMBER_OF_PLUTVALS);
+	for (i = 0; i < count; ++i)
+		palette->colors[first + i] = ColorToNative (colors[i]);
+	palette->pixelFormat = NULL;
 }
 
 Color
@@ -45,3 +58,24 @@ GetNativePaletteColor (NativePalette *palette, int index)
 	assert (index < NUMBER_OF_PLUTVALS);
 	return NativeToColor (palette->colors[index]);
 }
+
+// Returns the colors of the palette as pixel values of format 'fmt'.
+// The values are kept until the palette or the format changes, so that
+// a colormap only needs to be mapped once per version.
+const Uint32 *
+GetNativePalettePixels (NativePalette *palette, const SDL_PixelFormat *fmt)
+{
+	if (palette->pixelFormat != fmt)
+	{
+		int i;
+
+		for (i = 0; i < NUMBER_OF_PLUTVALS; ++i)
+		{
+			const SDL_Color *c = &palette->colors[i];
+			palette->pixels[i] = SDL_MapRGBA ((SDL_PixelFormat *) fmt,
+					c->r, c->g, c->b, 0xff);
+		}
+		palette->pixelFormat = fmt;
+	}
+	return palette->pixels;
+}
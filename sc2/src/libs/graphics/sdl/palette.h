@@ -26,8 +26,14 @@
 struct NativePalette
 {
 	SDL_Color colors[NUMBER_OF_PLUTVALS];
+	Uint32 pixels[NUMBER_OF_PLUTVALS];
+			// 'colors' mapped to 'pixelFormat', for the indexed blitter
+	const SDL_PixelFormat *pixelFormat;
+			// NULL when 'pixels' needs to be recalculated
 };
 
+const Uint32 *GetNativePalettePixels (NativePalette *, const SDL_PixelFormat *);
+
 static inline Color
 NativeToColor (SDL_Color native)
 {
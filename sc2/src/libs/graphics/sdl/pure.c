@@ -19,6 +19,7 @@
 #include "libs/graphics/bbox.h"
 #include "scalers.h"
 #include "libs/log.h"
+#include "libs/perflib.h"
 
 #if SDL_MAJOR_VERSION == 1
 
@@ -369,7 +370,11 @@ TFB_Pure_Scaled_Postprocess (void)
 	SDL_LockSurface (backbuffer);
 
 	if (scaler)
+	{
+		uint64 startTime = GetPerfCounter ();
 		scaler (backbuffer, scalebuffer, &updated);
+		perf_addTimeSince (PERF_SCALER_TIME, startTime);
+	}
 
 	if (GfxFlags & TFB_GFXFLAGS_SCANLINES)
 		ScanLines (scalebuffer, &updated);
@@ -405,6 +410,9 @@ TFB_Pure_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 {
 	if (SDL_Screens[screen] == backbuffer)
 		return;
+	if (a != 255 && TFB_BlendSurface (SDL_Screens[screen], rect,
+			backbuffer, a))
+		return;
 	SDL_SetAlpha (SDL_Screens[screen], SDL_SRCALPHA, a);
 	SDL_BlitSurface (SDL_Screens[screen], rect, backbuffer, rect);
 }	
@@ -412,7 +420,12 @@ TFB_Pure_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 static void
 TFB_Pure_ColorLayer (Uint8 r, Uint8 g, Uint8 b, Uint8 a, SDL_Rect *rect)
 {
-	Uint32 col = SDL_MapRGB (fade_color_surface->format, r, g, b);
+	Uint32 col;
+
+	if (TFB_BlendSurfaceColor (backbuffer, rect, r, g, b, a))
+		return;
+
+	col = SDL_MapRGB (fade_color_surface->format, r, g, b);
 	if (col != fade_color)
 	{
 		fade_color = col;
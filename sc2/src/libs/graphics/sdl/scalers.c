@@ -18,6 +18,7 @@
 #include "libs/graphics/sdl/sdl_common.h"
 #include "libs/platform.h"
 #include "libs/log.h"
+#include "libs/memlib.h"
 #include "scalers.h"
 #include "scaleint.h"
 #include "2xscalers.h"
@@ -287,3 +288,81 @@ Scale_PrepPlatform (int flags, const SDL_PixelFormat* fmt)
 	return fdef->func;
 }
 
+
+struct tfb_scalerbench
+{
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	TFB_ScaleFunc scale;
+};
+
+TFB_ScalerBench *
+TFB_ScalerBench_New (int flags)
+{
+	const SDL_PixelFormat *fmt;
+	TFB_ScalerBench *bench;
+	int x, y;
+
+	if (format_conv_surf == NULL)
+		return NULL;
+	fmt = format_conv_surf->format;
+	if (fmt->BytesPerPixel != 4)
+		return NULL;
+
+	bench = HCalloc (sizeof *bench);
+	bench->src = SDL_CreateRGBSurface (SDL_SWSURFACE, ScreenWidth,
+			ScreenHeight, 32, fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+	bench->dst = SDL_CreateRGBSurface (SDL_SWSURFACE, ScreenWidth * 2,
+			ScreenHeight * 2, 32, fmt->Rmask, fmt->Gmask, fmt->Bmask, 0);
+	if (bench->src == NULL || bench->dst == NULL)
+	{
+		TFB_ScalerBench_Delete (bench);
+		return NULL;
+	}
+
+	// Blocks of flat colour, and some with a gradient, so that the
+	// adaptive scalers see both flat areas and edges, as in the game.
+	SDL_LockSurface (bench->src);
+	for (y = 0; y < ScreenHeight; y++)
+	{
+		Uint32 *row = (Uint32 *) ((Uint8 *) bench->src->pixels
+				+ y * bench->src->pitch);
+
+		for (x = 0; x < ScreenWidth; x++)
+		{
+			DWORD block = (DWORD) ((y / 8) * ScreenWidth + x / 8)
+					* 2654435761U;
+			Uint8 blue = ((x / 8 + y / 8) % 4 == 0) ?
+					(Uint8) (x + y) : (Uint8) (block >> 8);
+
+			row[x] = SDL_MapRGB (bench->src->format, (Uint8) (block >> 24),
+					(Uint8) (block >> 16), blue);
+		}
+	}
+	SDL_UnlockSurface (bench->src);
+
+	bench->scale = Scale_PrepPlatform (flags, bench->src->format);
+	return bench;
+}
+
+void
+TFB_ScalerBench_Run (TFB_ScalerBench *bench)
+{
+	SDL_Rect r = {0, 0, ScreenWidth, ScreenHeight};
+
+	SDL_LockSurface (bench->src);
+	SDL_LockSurface (bench->dst);
+	bench->scale (bench->src, bench->dst, &r);
+	SDL_UnlockSurface (bench->dst);
+	SDL_UnlockSurface (bench->src);
+}
+
+void
+TFB_ScalerBench_Delete (TFB_ScalerBench *bench)
+{
+	if (bench->src)
+		SDL_FreeSurface (bench->src);
+	if (bench->dst)
+		SDL_FreeSurface (bench->dst);
+	HFree (bench);
+}
@@ -18,14 +18,24 @@
 #include "pure.h"
 #include "libs/graphics/bbox.h"
 #include "libs/log.h"
+#include "sdl_common.h"
 #include "scalers.h"
 #include "uqmversion.h"
+#include "libs/timelib.h"
+#include "libs/perflib.h"
 
 #if SDL_MAJOR_VERSION > 1
 
+#define SDL2_MAX_SCREEN_TEXTURES 2
+
 typedef struct tfb_sdl2_screeninfo_s {
 	SDL_Surface *scaled;
-	SDL_Texture *texture;
+	SDL_Texture *textures[SDL2_MAX_SCREEN_TEXTURES];
+	SDL_Rect pending[SDL2_MAX_SCREEN_TEXTURES];
+			// The part of each texture that is out of date, in screen
+			// coordinates.
+	int current;
+			// The texture that was drawn last.
 	BOOLEAN dirty, active;
 	SDL_Rect updated;
 } TFB_SDL2_SCREENINFO;
@@ -38,6 +48,32 @@ static const char *rendererBackend = NULL;
 
 static int ScreenFilterMode;
 
+// With a software renderer, SDL blends layers with its generic blitter.
+// Fading frames are then put together in 'composite' with the kernels of
+// blend.h instead, and copied to the renderer in one go.
+static BOOLEAN softwareRenderer;
+static SDL_Surface *composite = NULL;
+static SDL_Texture *compositeTexture = NULL;
+static int compositeScale;
+static BOOLEAN compositing;
+		// This frame is being put together in 'composite'.
+static BOOLEAN texturesStale;
+		// The screen textures have not been updated while compositing.
+
+// With streaming textures, changed parts of the screens are copied into
+// locked textures, and each screen alternates between two textures, so
+// that updating one does not have to wait for the renderer to be done
+// with the other. Otherwise, each screen has one texture, which is updated
+// with SDL_UpdateTexture(). See TFB_SDL2_TestStreaming().
+static BOOLEAN streamingTextures;
+static int numScreenTextures = 1;
+
+// For the statistics logged with --fps
+#define SDL2_STATS_FRAMES 256
+static DWORD statsFrames;
+static uint64 statsUploadBytes;
+static uint64 statsPresentTime;
+
 static TFB_ScaleFunc scaler = NULL;
 
 #if SDL_BYTEORDER == SDL_BIG_ENDIAN
@@ -123,6 +159,115 @@ FindBestRenderDriver (void)
 	return -1;
 }
 
+#define STREAMING_TEST_SIZE 8
+
+static Uint32
+StreamingTestPixel (int x, int y)
+{
+	return ((Uint32) (x * 32) << 24) | ((Uint32) (y * 32) << 16)
+			| ((Uint32) ((x + y) * 16) << 8);
+}
+
+/* Checks that streaming textures can be locked and written to, by
+ * drawing a pattern through a locked texture and reading it back.
+ * Must be called before the logical size of the renderer is set. */
+static BOOLEAN
+TFB_SDL2_TestStreaming (void)
+{
+	SDL_RendererInfo info;
+	SDL_Texture *texture;
+	SDL_Rect r = {0, 0, STREAMING_TEST_SIZE, STREAMING_TEST_SIZE};
+	Uint32 readBack[STREAMING_TEST_SIZE * STREAMING_TEST_SIZE];
+	void *pixels;
+	int pitch;
+	int x, y;
+	BOOLEAN result = TRUE;
+
+	/* SDL_LockTexture corrupts driver memory with the 32-bit Direct3D 9
+	 * driver on Intel integrated graphics, and crashes later on; this
+	 * cannot be detected by trying, so do not. */
+	if (SDL_GetRendererInfo (renderer, &info) != 0
+			|| !strcmp (info.name, "direct3d"))
+		return FALSE;
+
+	texture = SDL_CreateTexture (renderer, SDL_PIXELFORMAT_RGBX8888,
+			SDL_TEXTUREACCESS_STREAMING, STREAMING_TEST_SIZE,
+			STREAMING_TEST_SIZE);
+	if (!texture)
+		return FALSE;
+
+	if (SDL_LockTexture (texture, NULL, &pixels, &pitch) != 0
+			|| pitch < STREAMING_TEST_SIZE * 4)
+	{
+		SDL_DestroyTexture (texture);
+		return FALSE;
+	}
+	for (y = 0; y < STREAMING_TEST_SIZE; y++)
+	{
+		Uint32 *row = (Uint32 *) ((Uint8 *) pixels + y * pitch);
+		for (x = 0; x < STREAMING_TEST_SIZE; x++)
+			row[x] = StreamingTestPixel (x, y);
+	}
+	SDL_UnlockTexture (texture);
+
+	SDL_SetTextureBlendMode (texture, SDL_BLENDMODE_NONE);
+	if (SDL_RenderCopy (renderer, texture, NULL, &r) != 0
+			|| SDL_RenderReadPixels (renderer, &r, SDL_PIXELFORMAT_RGBX8888,
+			readBack, STREAMING_TEST_SIZE * 4) != 0)
+	{
+		result = FALSE;
+	}
+	for (y = 0; result && y < STREAMING_TEST_SIZE; y++)
+	{
+		for (x = 0; x < STREAMING_TEST_SIZE; x++)
+		{
+			if ((readBack[y * STREAMING_TEST_SIZE + x] & 0xffffff00)
+					!= StreamingTestPixel (x, y))
+			{
+				result = FALSE;
+				break;
+			}
+		}
+	}
+
+	SDL_DestroyTexture (texture);
+	SDL_SetRenderDrawColor (renderer, 0, 0, 0, 255);
+	SDL_RenderClear (renderer);
+	return result;
+}
+
+static int
+TFB_SDL2_CreateScreenTextures (TFB_SDL2_SCREENINFO *info, int w, int h)
+{
+	int i;
+
+	for (i = 0; i < SDL2_MAX_SCREEN_TEXTURES; i++)
+	{
+		if (info->textures[i])
+		{
+			SDL_DestroyTexture (info->textures[i]);
+			info->textures[i] = NULL;
+		}
+	}
+	for (i = 0; i < numScreenTextures; i++)
+	{
+		info->textures[i] = SDL_CreateTexture (renderer,
+				SDL_PIXELFORMAT_RGBX8888, SDL_TEXTUREACCESS_STREAMING, w, h);
+		if (!info->textures[i])
+		{
+			log_add (log_Error, "Couldn't create screen textures: %s",
+					SDL_GetError ());
+			return -1;
+		}
+		info->pending[i].x = 0;
+		info->pending[i].y = 0;
+		info->pending[i].w = ScreenWidth;
+		info->pending[i].h = ScreenHeight;
+	}
+	info->current = 0;
+	return 0;
+}
+
 int
 TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int togglefullscreen)
 {
@@ -158,16 +303,24 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int toggl
 		if (SDL_GetRendererInfo (renderer, &info) == 0)
 		{
 			log_add (log_Info, "SDL2 renderer '%s' selected.\n", info.name);
+			softwareRenderer = (info.flags & SDL_RENDERER_SOFTWARE) != 0;
 		}
 		else
 		{
 			log_add (log_Info, "SDL2 renderer had no name.");
 		}
+		streamingTextures = TFB_SDL2_TestStreaming ();
+		numScreenTextures = streamingTextures ? 2 : 1;
+		log_add (log_Info, "SDL2 screen textures are updated %s.",
+				streamingTextures ? "by locking them" : "in one call");
 		SDL_RenderSetLogicalSize (renderer, ScreenWidth, ScreenHeight);
 		for (i = 0; i < TFB_GFX_NUMSCREENS; i++)
 		{
+			int j;
+
 			SDL2_Screens[i].scaled = NULL;
-			SDL2_Screens[i].texture = NULL;
+			for (j = 0; j < SDL2_MAX_SCREEN_TEXTURES; j++)
+				SDL2_Screens[i].textures[j] = NULL;
 			SDL2_Screens[i].dirty = TRUE;
 			SDL2_Screens[i].active = TRUE;
 			if (0 != ReInit_Screen (&SDL_Screens[i], ScreenWidth, ScreenHeight))
@@ -222,18 +375,15 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int toggl
 			{
 				return -1;
 			}
-			if (SDL2_Screens[i].texture)
+			if (0 != TFB_SDL2_CreateScreenTextures (&SDL2_Screens[i],
+					ScreenWidth * 2, ScreenHeight * 2))
 			{
-				SDL_DestroyTexture (SDL2_Screens[i].texture);
-				SDL2_Screens[i].texture = NULL;
+				return -1;
 			}
-			SDL2_Screens[i].texture = SDL_CreateTexture (renderer, SDL_PIXELFORMAT_RGBX8888, SDL_TEXTUREACCESS_STREAMING, ScreenWidth * 2, ScreenHeight * 2);
-			SDL_LockSurface (SDL2_Screens[i].scaled);
-			SDL_UpdateTexture (SDL2_Screens[i].texture, NULL, SDL2_Screens[i].scaled->pixels, SDL2_Screens[i].scaled->pitch);
-			SDL_UnlockSurface (SDL2_Screens[i].scaled);
 		}
 		scaler = Scale_PrepPlatform (flags, SDL2_Screens[0].scaled->format);
 		graphics_backend = &sdl2_scaled_backend;
+		compositeScale = 2;
 	}
 	else
 	{
@@ -244,18 +394,32 @@ TFB_Pure_ConfigureVideo (int driver, int flags, int width, int height, int toggl
 				SDL_FreeSurface (SDL2_Screens[i].scaled);
 				SDL2_Screens[i].scaled = NULL;
 			}
-			if (SDL2_Screens[i].texture)
+			if (0 != TFB_SDL2_CreateScreenTextures (&SDL2_Screens[i],
+					ScreenWidth, ScreenHeight))
 			{
-				SDL_DestroyTexture (SDL2_Screens[i].texture);
-				SDL2_Screens[i].texture = NULL;
+				return -1;
 			}
-			SDL2_Screens[i].texture = SDL_CreateTexture (renderer, SDL_PIXELFORMAT_RGBX8888, SDL_TEXTUREACCESS_STREAMING, ScreenWidth, ScreenHeight);
-			SDL_LockSurface (SDL_Screens[i]);
-			SDL_UpdateTexture (SDL2_Screens[i].texture, NULL, SDL_Screens[i]->pixels, SDL_Screens[i]->pitch);
-			SDL_UnlockSurface (SDL_Screens[i]);
 		}
 		scaler = NULL;
 		graphics_backend = &sdl2_unscaled_backend;
+		compositeScale = 1;
+	}
+
+	if (compositeTexture)
+	{
+		SDL_DestroyTexture (compositeTexture);
+		compositeTexture = NULL;
+	}
+	UnInit_Screen (&composite);
+	if (softwareRenderer)
+	{
+		int w = ScreenWidth * compositeScale;
+		int h = ScreenHeight * compositeScale;
+
+		if (0 != ReInit_Screen (&composite, w, h))
+			return -1;
+		compositeTexture = SDL_CreateTexture (renderer,
+				SDL_PIXELFORMAT_RGBX8888, SDL_TEXTUREACCESS_STREAMING, w, h);
 	}
 
 	/* We succeeded, so alter the screen size to our new sizes */
@@ -292,6 +456,11 @@ TFB_Pure_InitGraphics (int driver, int flags, const char *renderer, int width, i
 void
 TFB_Pure_UninitGraphics (void)
 {
+	if (compositeTexture) {
+		SDL_DestroyTexture (compositeTexture);
+		compositeTexture = NULL;
+	}
+	UnInit_Screen (&composite);
 	if (renderer) {
 		SDL_DestroyRenderer (renderer);
 	}
@@ -314,6 +483,11 @@ static void
 TFB_SDL2_UpdateTexture (SDL_Texture *dest, SDL_Surface *src, SDL_Rect *rect)
 {
 	char *srcBytes;
+	int w = rect ? rect->w : src->w;
+	int h = rect ? rect->h : src->h;
+	void *pixels;
+	int pitch;
+
 	SDL_LockSurface (src);
 	srcBytes = src->pixels;
 	if (rect)
@@ -334,11 +508,67 @@ TFB_SDL2_UpdateTexture (SDL_Texture *dest, SDL_Surface *src, SDL_Rect *rect)
 	 * pre-Windows 10 machines appear to fail to initialize D3D11 even
 	 * while claiming to support it.
 	 *
-	 * These bugs may be fixed in the future, but in the meantime we
-	 * rely on this allegedly slower but definitely more reliable
-	 * function. */
-	SDL_UpdateTexture (dest, rect, srcBytes, src->pitch);
+	 * So we only lock textures with other drivers, and only when
+	 * TFB_SDL2_TestStreaming() found that it works; otherwise we rely
+	 * on this allegedly slower but definitely more reliable function. */
+	if (streamingTextures && SDL_LockTexture (dest, rect, &pixels, &pitch) == 0)
+	{
+		int y;
+		for (y = 0; y < h; y++)
+		{
+			memcpy ((Uint8 *) pixels + y * pitch, srcBytes + y * src->pitch,
+					w * 4);
+		}
+		SDL_UnlockTexture (dest);
+	}
+	else
+	{
+		SDL_UpdateTexture (dest, rect, srcBytes, src->pitch);
+	}
 	SDL_UnlockSurface (src);
+
+	statsUploadBytes += (uint64) w * h * 4;
+}
+
+/* Brings a texture of 'info' up to date with 'src', which has 'scale'
+ * times the resolution of the screen, and returns it. If anything
+ * changed and there are two textures, the one that was not drawn last
+ * is updated, as the renderer may still be using the other one. */
+static SDL_Texture *
+TFB_SDL2_SyncScreenTexture (TFB_SDL2_SCREENINFO *info, SDL_Surface *src,
+		int scale)
+{
+	SDL_Rect r;
+
+	if (SDL_RectEmpty (&info->pending[info->current]))
+		return info->textures[info->current];
+
+	info->current = (info->current + 1) % numScreenTextures;
+	r = info->pending[info->current];
+	r.x *= scale;
+	r.y *= scale;
+	r.w *= scale;
+	r.h *= scale;
+	TFB_SDL2_UpdateTexture (info->textures[info->current], src, &r);
+	info->pending[info->current].w = 0;
+	info->pending[info->current].h = 0;
+
+	return info->textures[info->current];
+}
+
+/* Marks the updated part of the screen as out of date in all of its
+ * textures. */
+static void
+TFB_SDL2_MarkScreenUpdated (TFB_SDL2_SCREENINFO *info)
+{
+	int i;
+
+	for (i = 0; i < numScreenTextures; i++)
+	{
+		SDL_UnionRect (&info->pending[i], &info->updated,
+				&info->pending[i]);
+	}
+	info->dirty = FALSE;
 }
 
 static void
@@ -358,8 +588,17 @@ TFB_SDL2_ScanLines (void)
 static void
 TFB_SDL2_Preprocess (int force_full_redraw, int transition_amount, int fade_amount)
 {
-	(void) transition_amount;
-	(void) fade_amount;
+	compositing = compositeTexture != NULL
+			&& (transition_amount != 255 || fade_amount != 255);
+	if (compositing)
+	{
+		texturesStale = TRUE;
+	}
+	else if (texturesStale)
+	{
+		force_full_redraw = TFB_REDRAW_YES;
+		texturesStale = FALSE;
+	}
 
 	if (force_full_redraw == TFB_REDRAW_YES)
 	{
@@ -383,14 +622,45 @@ TFB_SDL2_Preprocess (int force_full_redraw, int transition_amount, int fade_amou
 	SDL_RenderClear (renderer);
 }
 
+/* 'src' has the resolution of 'composite'; 'rect' is in screen
+ * coordinates. */
+static void
+TFB_SDL2_ComposeLayer (SDL_Surface *src, Uint8 a, const SDL_Rect *rect)
+{
+	SDL_Rect r, *pRect = NULL;
+
+	if (rect)
+	{
+		r.x = rect->x * compositeScale;
+		r.y = rect->y * compositeScale;
+		r.w = rect->w * compositeScale;
+		r.h = rect->h * compositeScale;
+		pRect = &r;
+	}
+	if (a == 255 || !TFB_BlendSurface (src, pRect, composite, a))
+	{
+		SDL_Rect dstRect;
+		if (pRect)
+			dstRect = r;
+		SDL_BlitSurface (src, pRect, composite, pRect ? &dstRect : NULL);
+	}
+}
+
 static void
 TFB_SDL2_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 {
-	SDL_Texture *texture = SDL2_Screens[screen].texture;
+	SDL_Texture *texture;
 	if (SDL2_Screens[screen].dirty)
 	{
-		TFB_SDL2_UpdateTexture (texture, SDL_Screens[screen], &SDL2_Screens[screen].updated);
+		TFB_SDL2_MarkScreenUpdated (&SDL2_Screens[screen]);
 	}
+	if (compositing)
+	{
+		TFB_SDL2_ComposeLayer (SDL_Screens[screen], a, rect);
+		return;
+	}
+	texture = TFB_SDL2_SyncScreenTexture (&SDL2_Screens[screen],
+			SDL_Screens[screen], 1);
 	if (a == 255)
 	{
 		SDL_SetTextureBlendMode (texture, SDL_BLENDMODE_NONE);
@@ -406,19 +676,23 @@ TFB_SDL2_Unscaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 static void
 TFB_SDL2_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 {
-	SDL_Texture *texture = SDL2_Screens[screen].texture;
+	SDL_Texture *texture;
 	SDL_Rect srcRect, *pSrcRect = NULL;
 	if (SDL2_Screens[screen].dirty)
 	{
-		SDL_Surface *src = SDL2_Screens[screen].scaled;
-		SDL_Rect scaled_update = SDL2_Screens[screen].updated;
-		scaler (SDL_Screens[screen], src, &SDL2_Screens[screen].updated);
-		scaled_update.x *= 2;
-		scaled_update.y *= 2;
-		scaled_update.w *= 2;
-		scaled_update.h *= 2;
-		TFB_SDL2_UpdateTexture (texture, src, &scaled_update);
+		uint64 startTime = GetPerfCounter ();
+		scaler (SDL_Screens[screen], SDL2_Screens[screen].scaled,
+				&SDL2_Screens[screen].updated);
+		perf_addTimeSince (PERF_SCALER_TIME, startTime);
+		TFB_SDL2_MarkScreenUpdated (&SDL2_Screens[screen]);
 	}
+	if (compositing)
+	{
+		TFB_SDL2_ComposeLayer (SDL2_Screens[screen].scaled, a, rect);
+		return;
+	}
+	texture = TFB_SDL2_SyncScreenTexture (&SDL2_Screens[screen],
+			SDL2_Screens[screen].scaled, 2);
 	if (a == 255)
 	{
 		SDL_SetTextureBlendMode (texture, SDL_BLENDMODE_NONE);
@@ -447,6 +721,22 @@ TFB_SDL2_Scaled_ScreenLayer (SCREEN screen, Uint8 a, SDL_Rect *rect)
 static void
 TFB_SDL2_ColorLayer (Uint8 r, Uint8 g, Uint8 b, Uint8 a, SDL_Rect *rect)
 {
+	if (compositing)
+	{
+		SDL_Rect cr, *pRect = NULL;
+		if (rect)
+		{
+			cr.x = rect->x * compositeScale;
+			cr.y = rect->y * compositeScale;
+			cr.w = rect->w * compositeScale;
+			cr.h = rect->h * compositeScale;
+			pRect = &cr;
+		}
+		if (a == 255 || !TFB_BlendSurfaceColor (composite, pRect, r, g, b, a))
+			SDL_FillRect (composite, pRect,
+					SDL_MapRGB (composite->format, r, g, b));
+		return;
+	}
 	SDL_SetRenderDrawBlendMode (renderer, a == 255 ? SDL_BLENDMODE_NONE 
 			: SDL_BLENDMODE_BLEND);
 	SDL_SetRenderDrawColor (renderer, r, g, b, a);
@@ -456,10 +746,39 @@ TFB_SDL2_ColorLayer (Uint8 r, Uint8 g, Uint8 b, Uint8 a, SDL_Rect *rect)
 static void
 TFB_SDL2_Postprocess (void)
 {
+	if (compositing)
+	{
+		TFB_SDL2_UpdateTexture (compositeTexture, composite, NULL);
+		SDL_SetTextureBlendMode (compositeTexture, SDL_BLENDMODE_NONE);
+		SDL_RenderCopy (renderer, compositeTexture, NULL, NULL);
+	}
+
 	if (GfxFlags & TFB_GFXFLAGS_SCANLINES)
 		TFB_SDL2_ScanLines ();
 
-	SDL_RenderPresent (renderer);
+	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
+	{
+		uint64 start = GetPerfCounter ();
+		SDL_RenderPresent (renderer);
+		statsPresentTime += GetPerfCounter () - start;
+
+		statsFrames++;
+		if (statsFrames == SDL2_STATS_FRAMES)
+		{
+			log_add (log_User, "SDL2: %lu bytes of texture uploads, "
+					"%lu us in SDL_RenderPresent per frame",
+					(unsigned long) (statsUploadBytes / statsFrames),
+					(unsigned long) (statsPresentTime * 1000000
+					/ GetPerfFrequency () / statsFrames));
+			statsFrames = 0;
+			statsUploadBytes = 0;
+			statsPresentTime = 0;
+		}
+	}
+	else
+	{
+		SDL_RenderPresent (renderer);
+	}
 }
 
 #endif
@@ -28,11 +28,18 @@
 #include "libs/input/sdl/input.h"
 		// for ProcessInputEvent()
 #include "libs/graphics/bbox.h"
+#include "libs/graphics/blend.h"
+#include "libs/graphics/framesched.h"
 #include "port.h"
 #include "libs/uio.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
 #include "libs/vidlib.h"
+#include "libs/timelib.h"
+#include "libs/perflib.h"
+#ifdef EMSCRIPTEN
+#	include <emscripten/threading.h>
+#endif
 
 SDL_Surface *SDL_Screen;
 SDL_Surface *TransitionScreen;
@@ -50,6 +57,11 @@ TFB_GRAPHICS_BACKEND *graphics_backend = NULL;
 volatile int QuitPosted = 0;
 volatile int GameActive = 1; // Track the SDL_ACTIVEEVENT state SDL_APPACTIVE
 
+// As requested with TFB_SetFrameRate(); 0 for the display refresh rate.
+static int frameRate = 0;
+
+static void applyFrameRate (void);
+
 int
 TFB_InitGraphics (int driver, int flags, const char *renderer, int width, int height)
 {
@@ -95,6 +107,8 @@ TFB_InitGraphics (int driver, int flags, const char *renderer, int width, int he
 
 	TFB_DrawCanvas_Initialize ();
 
+	applyFrameRate ();
+
 	return 0;
 }
 
@@ -103,6 +117,16 @@ TFB_UninitGraphics (void)
 {
 	int i;
 
+	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
+	{
+		FILE *out = fopen ("./FrameTimes.csv", "w");
+		if (out != NULL)
+		{
+			TFB_DumpFrameTimes (out);
+			fclose (out);
+		}
+	}
+
 	Uninit_DrawCommandQueue ();
 
 	for (i = 0; i < TFB_GFX_NUMSCREENS; i++)
@@ -121,6 +145,13 @@ TFB_ProcessEvents ()
 {
 	SDL_Event Event;
 
+#ifdef EMSCRIPTEN
+	/* main() runs on a worker pthread (PROXY_TO_PTHREAD). The browser
+	 * main thread queues DOM input callbacks to us; run them now so SDL
+	 * sees the events. */
+	emscripten_current_thread_process_queued_calls ();
+#endif
+
 	while (SDL_PollEvent (&Event) > 0)
 	{
 		/* Run through the InputEvent filter. */
@@ -164,6 +195,189 @@ TFB_ProcessEvents ()
 	}
 }
 
+static int
+getDisplayRefreshRate (void)
+{
+#if SDL_MAJOR_VERSION > 1
+	SDL_DisplayMode mode;
+
+	if (SDL_GetDesktopDisplayMode (0, &mode) == 0 && mode.refresh_rate > 0)
+		return mode.refresh_rate;
+#endif
+	// SDL 1.2 cannot tell
+	return TFB_DEFAULT_FRAME_RATE;
+}
+
+static void
+applyFrameRate (void)
+{
+	int rate = frameRate;
+
+	if (rate <= 0)
+		rate = getDisplayRefreshRate ();
+	log_add (log_Info, "Presenting up to %d frames per second.", rate);
+	TFB_InitFrameSchedule (rate);
+}
+
+void
+TFB_SetFrameRate (int rate)
+{
+	frameRate = rate;
+	if (graphics_backend != NULL)
+		applyFrameRate ();
+}
+
+// Only call from main() thread!!
+void
+TFB_WaitForFrame (void)
+{
+	uint64 now = GetPerfCounter ();
+	uint64 deadline = TFB_GetFrameDeadline ();
+	uint64 freq = GetPerfFrequency ();
+	Uint32 ms;
+
+	if (deadline <= now)
+		return;
+
+	// Round up, so that we do not wake up just before the deadline
+	// and spin until it passes.
+	ms = (Uint32) (((deadline - now) * 1000 + freq - 1) / freq);
+#if SDL_MAJOR_VERSION > 1 && !defined(EMSCRIPTEN)
+	// Input events end the wait early, so that they are processed
+	// right away; the event stays in the queue for TFB_ProcessEvents().
+	SDL_WaitEventTimeout (NULL, ms);
+#else
+	// SDL 1.2 cannot wait for an event with a timeout, and on
+	// Emscripten input arrives through queued calls, which we only run
+	// in TFB_ProcessEvents(); keep polling.
+	(void) ms;
+	SDL_Delay (1);
+#endif
+}
+
+#if SDL_MAJOR_VERSION > 1
+// Draws a bar for each of the last FRAME_GRAPH_WIDTH presented frames in
+// the bottom left corner of the screen, newest on the right. The height of
+// a bar is the time since the frame before it; the part of the bar in a
+// different colour is the time from the game committing the frame to it
+// being presented. The line marks one frame period.
+#define FRAME_GRAPH_WIDTH 64
+#define FRAME_GRAPH_SCALE 8
+		// Pixels per frame period
+#define FRAME_GRAPH_HEIGHT (FRAME_GRAPH_SCALE * 4)
+
+static int
+frameGraphBarHeight (uint64 from, uint64 to, uint64 period)
+{
+	uint64 height;
+
+	if (from == 0 || to <= from)
+		return 0;
+	height = (to - from) * FRAME_GRAPH_SCALE / period;
+	return height > FRAME_GRAPH_HEIGHT ? FRAME_GRAPH_HEIGHT : (int) height;
+}
+
+static void
+drawFrameGraph (void)
+{
+	uint64 period = TFB_GetFramePeriod ();
+	SDL_Rect r;
+	COUNT age;
+
+	r.x = 0;
+	r.y = ScreenHeight - FRAME_GRAPH_HEIGHT;
+	r.w = FRAME_GRAPH_WIDTH;
+	r.h = FRAME_GRAPH_HEIGHT;
+	graphics_backend->color (0, 0, 0, 192, &r);
+
+	r.w = 1;
+	for (age = 0; age < FRAME_GRAPH_WIDTH; age++)
+	{
+		const TFB_FrameTimes *frame = TFB_GetFrameTimes (age);
+		const TFB_FrameTimes *prev = TFB_GetFrameTimes (age + 1);
+		uint64 presented;
+		int interval;
+		int latency;
+
+		if (prev == NULL)
+			break;
+
+		presented = frame->stage[TFB_FRAME_PRESENTED];
+		interval = frameGraphBarHeight (prev->stage[TFB_FRAME_PRESENTED],
+				presented, period);
+		latency = frameGraphBarHeight (frame->stage[TFB_FRAME_LOGIC],
+				presented, period);
+		if (latency > interval)
+			latency = interval;
+
+		r.x = FRAME_GRAPH_WIDTH - 1 - age;
+		r.y = ScreenHeight - interval;
+		r.h = interval - latency;
+		if (r.h > 0)
+			graphics_backend->color (0x00, 0xc0, 0x00, 255, &r);
+		r.y = ScreenHeight - latency;
+		r.h = latency;
+		if (r.h > 0)
+			graphics_backend->color (0xe0, 0xe0, 0x00, 255, &r);
+	}
+
+	r.x = 0;
+	r.y = ScreenHeight - FRAME_GRAPH_SCALE;
+	r.w = FRAME_GRAPH_WIDTH;
+	r.h = 1;
+	graphics_backend->color (0x80, 0x80, 0x80, 255, &r);
+}
+
+// Draws a bar for each performance counter, in the order of
+// perf_CounterId from the top, to the right of the frame graph. The length
+// of a bar is the value of the counter over the last interval, relative
+// to the 'full' value in its perf_CounterInfo.
+#define PERF_OVERLAY_WIDTH 64
+#define PERF_OVERLAY_BAR_HEIGHT 2
+#define PERF_OVERLAY_ROW_HEIGHT (PERF_OVERLAY_BAR_HEIGHT + 1)
+
+static void
+drawPerfOverlay (void)
+{
+	static const Uint8 barColors[][3] =
+	{
+		{ 0x00, 0xc0, 0x00 },
+		{ 0xe0, 0xe0, 0x00 },
+		{ 0x00, 0xa0, 0xe0 },
+		{ 0xe0, 0x60, 0x00 },
+		{ 0xc0, 0x00, 0xc0 },
+	};
+	const perf_Snapshot *interval = perf_getLastInterval ();
+	SDL_Rect r;
+	int id;
+
+	if (interval == NULL)
+		return;
+
+	r.x = FRAME_GRAPH_WIDTH + 1;
+	r.y = ScreenHeight - PERF_NUM_COUNTERS * PERF_OVERLAY_ROW_HEIGHT;
+	r.w = PERF_OVERLAY_WIDTH;
+	r.h = PERF_NUM_COUNTERS * PERF_OVERLAY_ROW_HEIGHT;
+	graphics_backend->color (0, 0, 0, 192, &r);
+
+	r.h = PERF_OVERLAY_BAR_HEIGHT;
+	for (id = 0; id < PERF_NUM_COUNTERS; id++)
+	{
+		const Uint8 *c = barColors[id % (sizeof barColors
+				/ sizeof barColors[0])];
+		double fraction = perf_getDisplayValue (interval, id)
+				/ perf_getCounterInfo (id)->full;
+
+		if (fraction > 1.0)
+			fraction = 1.0;
+		r.w = (int) (fraction * PERF_OVERLAY_WIDTH + 0.5);
+		if (r.w > 0)
+			graphics_backend->color (c[0], c[1], c[2], 255, &r);
+		r.y += PERF_OVERLAY_ROW_HEIGHT;
+	}
+}
+#endif
+
 static BOOLEAN system_box_active = 0;
 static SDL_Rect system_box;
 
@@ -195,7 +409,10 @@ TFB_SwapBuffers (int force_full_redraw)
 	if (force_full_redraw == TFB_REDRAW_NO && !TFB_BBox.valid &&
 			fade_amount == 255 && transition_amount == 255 &&
 			last_fade_amount == 255 && last_transition_amount == 255)
+	{
+		TFB_DiscardFrame ();
 		return;
+	}
 
 	if (force_full_redraw == TFB_REDRAW_NO &&
 			(fade_amount != 255 || transition_amount != 255 ||
@@ -238,7 +455,21 @@ TFB_SwapBuffers (int force_full_redraw)
 		graphics_backend->screen (TFB_SCREEN_MAIN, 255, &system_box);
 	}
 
+	TFB_MarkFrameStage (TFB_FRAME_SCALED, GetPerfCounter ());
+
+#if SDL_MAJOR_VERSION > 1
+	// The SDL 1.2 pure backend may compose straight onto the main
+	// screen, where the graph would stay.
+	if (GfxFlags & TFB_GFXFLAGS_SHOWFPS)
+	{
+		drawFrameGraph ();
+		drawPerfOverlay ();
+	}
+#endif
+
 	graphics_backend->postprocess ();
+
+	TFB_EndFrame ();
 }
 
 /* Probably ought to clean this away at some point. */
@@ -306,3 +537,104 @@ UnInit_Screen (SDL_Surface **screen)
 	SDL_FreeSurface (*screen);
 	*screen = NULL;
 }
+
+// Whether the pixels of 'fmt' are 4 bytes of 8-bit channels, which the
+// kernels of blend.h work on.
+static BOOLEAN
+isBlendableFormat (const SDL_PixelFormat *fmt)
+{
+	return fmt->BytesPerPixel == 4
+			&& fmt->Rloss == 0 && fmt->Gloss == 0 && fmt->Bloss == 0
+			&& (fmt->Rshift & 7) == 0 && (fmt->Gshift & 7) == 0
+			&& (fmt->Bshift & 7) == 0;
+}
+
+// Clips 'rect', or the whole surface if NULL, to 'surface'. Returns FALSE
+// if nothing is left.
+static BOOLEAN
+clipToSurface (const SDL_Surface *surface, const SDL_Rect *rect,
+		SDL_Rect *clipped)
+{
+	int x1, y1, x2, y2;
+
+	if (rect == NULL)
+	{
+		clipped->x = 0;
+		clipped->y = 0;
+		clipped->w = surface->w;
+		clipped->h = surface->h;
+		return surface->w > 0 && surface->h > 0;
+	}
+
+	x1 = rect->x < 0 ? 0 : rect->x;
+	y1 = rect->y < 0 ? 0 : rect->y;
+	x2 = rect->x + rect->w;
+	y2 = rect->y + rect->h;
+	if (x2 > surface->w)
+		x2 = surface->w;
+	if (y2 > surface->h)
+		y2 = surface->h;
+	if (x2 <= x1 || y2 <= y1)
+		return FALSE;
+
+	clipped->x = x1;
+	clipped->y = y1;
+	clipped->w = x2 - x1;
+	clipped->h = y2 - y1;
+	return TRUE;
+}
+
+// Blends the area 'rect' (all if NULL) of 'src' onto the same area of
+// 'dst', with 'alpha' the opacity of 'src'. This is what an SDL blit with
+// a surface alpha does, only faster.
+// Returns FALSE, without drawing anything, if the surfaces do not have
+// the same format, or one that blend.h cannot handle.
+BOOLEAN
+TFB_BlendSurface (SDL_Surface *src, const SDL_Rect *rect, SDL_Surface *dst,
+		Uint8 alpha)
+{
+	SDL_Rect r, rd;
+
+	if (!isBlendableFormat (src->format) || !isBlendableFormat (dst->format)
+			|| src->format->Rmask != dst->format->Rmask
+			|| src->format->Gmask != dst->format->Gmask
+			|| src->format->Bmask != dst->format->Bmask)
+		return FALSE;
+
+	if (!clipToSurface (src, rect, &r) || !clipToSurface (dst, &r, &rd))
+		return TRUE;
+
+	SDL_LockSurface (src);
+	SDL_LockSurface (dst);
+	TFB_BlendPixels ((Uint8 *) dst->pixels + rd.y * dst->pitch + rd.x * 4,
+			dst->pitch,
+			(const Uint8 *) src->pixels + rd.y * src->pitch + rd.x * 4,
+			src->pitch, rd.w, rd.h, alpha);
+	SDL_UnlockSurface (dst);
+	SDL_UnlockSurface (src);
+	return TRUE;
+}
+
+// Blends the color 'r', 'g', 'b' onto the area 'rect' (all if NULL) of
+// 'dst', with 'alpha' its opacity.
+// Returns FALSE, without drawing anything, if blend.h cannot handle the
+// format of 'dst'.
+BOOLEAN
+TFB_BlendSurfaceColor (SDL_Surface *dst, const SDL_Rect *rect, Uint8 r,
+		Uint8 g, Uint8 b, Uint8 alpha)
+{
+	SDL_Rect rd;
+
+	if (!isBlendableFormat (dst->format))
+		return FALSE;
+
+	if (!clipToSurface (dst, rect, &rd))
+		return TRUE;
+
+	SDL_LockSurface (dst);
+	TFB_BlendFill ((Uint8 *) dst->pixels + rd.y * dst->pitch + rd.x * 4,
+			dst->pitch, rd.w, rd.h, SDL_MapRGB (dst->format, r, g, b),
+			alpha);
+	SDL_UnlockSurface (dst);
+	return TRUE;
+}
@@ -60,4 +60,9 @@ int SDL1_ReInit_Screen (SDL_Surface **screen, SDL_Surface *templat, int w, int h
 #endif
 void UnInit_Screen (SDL_Surface **screen);
 
+BOOLEAN TFB_BlendSurface (SDL_Surface *src, const SDL_Rect *rect,
+		SDL_Surface *dst, Uint8 alpha);
+BOOLEAN TFB_BlendSurfaceColor (SDL_Surface *dst, const SDL_Rect *rect,
+		Uint8 r, Uint8 g, Uint8 b, Uint8 alpha);
+
 #endif
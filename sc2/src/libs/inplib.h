@@ -21,6 +21,7 @@
 
 #include <stddef.h>
 #include "libs/compiler.h"
+#include "libs/timelib.h"
 #include "libs/uio.h"
 #include "libs/unicode.h"
 
@@ -63,6 +64,56 @@ void SaveKeyConfiguration (uio_DirHandle *path, const char *fname);
 
 void BeginInputFrame (void);
 
+/* The input event queue.  Every change to a control is queued on the
+ * thread that handles the input, and read back in order by the game
+ * thread, so that no press is lost, however short. */
+
+//#define DEBUG_INPUT_LATENCY
+		// Inject a latency probe into the event queue every so often,
+		// and log the time it takes the game to draw after reading it.
+
+typedef enum
+{
+	INPUT_EVENT_MENU,
+			// 'control' is a menu key.
+	INPUT_EVENT_FLIGHT,
+			// 'control' is a flight key of template 'templat'.
+	INPUT_EVENT_RESYNC,
+			// Events have been dropped, because the queue was full or
+			// the controls were reset. The state of all controls must
+			// be read again from the input vectors.
+	INPUT_EVENT_PROBE,
+			// A latency probe; does not change any control.
+} InputEventType;
+
+typedef struct
+{
+	BYTE type;
+			// An InputEventType.
+	BYTE templat;
+	BYTE control;
+	int value;
+			// The number of gestures now holding the control;
+			// non-zero while it is held.
+	TimeCount time;
+	uint64 perfTime;
+			// GetTimeCounter() and GetPerfCounter() when the event
+			// was handled.
+} InputEvent;
+
+// The bits of an input vector element that count the gestures holding
+// the control; the other bits are used by the input driver.
+#define INPUT_COUNT_MASK 0xFFFF
+
+// Takes the next event from the queue. Returns FALSE if there is none.
+// Must only be called from one thread.
+BOOLEAN GetInputEvent (InputEvent *event);
+// Waits until an event is queued, or until wakeTime. Returns TRUE if an
+// event was queued after the last call to this function or to
+// GetInputEvent(), without waiting if there already was one.
+// Must be called from the same thread as GetInputEvent().
+BOOLEAN WaitInputEventUntil (TimeCount wakeTime);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -18,3 +18,165 @@
 
 #include "port.h"
 #include "inpintrn.h"
+#include "libs/threadlib.h"
+#include <string.h>
+
+#if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#	define EVQ_LOAD(ptr) \
+		__atomic_load_n ((ptr), __ATOMIC_ACQUIRE)
+#	define EVQ_STORE(ptr, newVal) \
+		__atomic_store_n ((ptr), (newVal), __ATOMIC_RELEASE)
+#	define EVQ_EXCHANGE(ptr, newVal) \
+		__atomic_exchange_n ((ptr), (newVal), __ATOMIC_ACQ_REL)
+#elif defined(_MSC_VER) && _MSC_VER >= 1400
+#	include <intrin.h>
+#	define EVQ_LOAD(ptr) \
+		(*(volatile DWORD *) (ptr))
+#	define EVQ_STORE(ptr, newVal) \
+		_InterlockedExchange ((long volatile *) (ptr), (long) (newVal))
+#	define EVQ_EXCHANGE(ptr, newVal) \
+		((DWORD) _InterlockedExchange ((long volatile *) (ptr), \
+				(long) (newVal)))
+#else
+		// Without atomics, the queue is used the same way as the
+		// keyboard character buffer in sdl/input.c. At worst, the
+		// consumer wakes up late or once too often.
+#	define EVQ_LOAD(ptr) \
+		(*(volatile DWORD *) (ptr))
+#	define EVQ_STORE(ptr, newVal) \
+		(*(volatile DWORD *) (ptr) = (newVal))
+#	define EVQ_EXCHANGE(ptr, newVal) \
+		evq_exchange ((ptr), (newVal))
+
+static inline DWORD
+evq_exchange (volatile DWORD *ptr, DWORD newVal)
+{
+	DWORD oldVal = *ptr;
+	*ptr = newVal;
+	return oldVal;
+}
+#endif
+
+// Must be a power of 2
+#define INPUT_EVENT_QUEUE_SIZE (1 << 8)
+
+// A single-producer, single-consumer ring. The head and the tail only
+// ever increase; they are reduced modulo the queue size on use.
+static InputEvent eventQueue[INPUT_EVENT_QUEUE_SIZE];
+static volatile DWORD eventHead;
+		// Written by the consumer only
+static volatile DWORD eventTail;
+		// Written by the producer only
+static volatile DWORD eventResync;
+		// Set when events have been dropped
+static volatile DWORD eventWaiting;
+		// Set while the consumer is, or is about to be, waiting on
+		// eventSem. Whoever clears it owns the wake-up.
+static DWORD eventSeen;
+		// The tail at the last GetInputEvent() or WaitInputEventUntil();
+		// private to the consumer
+static Semaphore eventSem;
+
+void
+InitInputEvents (void)
+{
+	eventHead = eventTail = eventSeen = 0;
+	eventResync = eventWaiting = 0;
+	eventSem = CreateSemaphore (0, "InputEvents", SYNC_CLASS_TOPLEVEL);
+}
+
+void
+UninitInputEvents (void)
+{
+	DestroySemaphore (eventSem);
+	eventSem = NULL;
+}
+
+static void
+wakeInputConsumer (void)
+{
+	if (EVQ_EXCHANGE (&eventWaiting, 0))
+		ClearSemaphore (eventSem);
+}
+
+void
+PostInputEvent (BYTE type, BYTE templat, BYTE control, int value)
+{
+	DWORD tail = eventTail;
+
+	if (tail - EVQ_LOAD (&eventHead) >= INPUT_EVENT_QUEUE_SIZE)
+	{	// Nobody is reading the queue right now; the consumer will
+		// pick up the state of the controls directly.
+		EVQ_STORE (&eventResync, 1);
+	}
+	else
+	{
+		InputEvent *event = &eventQueue[tail & (INPUT_EVENT_QUEUE_SIZE - 1)];
+		event->type = type;
+		event->templat = templat;
+		event->control = control;
+		event->value = value;
+		event->time = GetTimeCounter ();
+		event->perfTime = GetPerfCounter ();
+		EVQ_STORE (&eventTail, tail + 1);
+	}
+
+	wakeInputConsumer ();
+}
+
+void
+ResyncInputEvents (void)
+{
+	EVQ_STORE (&eventResync, 1);
+	if (eventSem)
+		wakeInputConsumer ();
+}
+
+BOOLEAN
+GetInputEvent (InputEvent *event)
+{
+	DWORD head = eventHead;
+	DWORD tail = EVQ_LOAD (&eventTail);
+
+	eventSeen = tail;
+
+	if (EVQ_EXCHANGE (&eventResync, 0))
+	{	// Whatever is in the queue now predates the resync.
+		EVQ_STORE (&eventHead, tail);
+		memset (event, 0, sizeof *event);
+		event->type = INPUT_EVENT_RESYNC;
+		event->time = GetTimeCounter ();
+		event->perfTime = GetPerfCounter ();
+		return TRUE;
+	}
+
+	if (head == tail)
+		return FALSE;
+
+	*event = eventQueue[head & (INPUT_EVENT_QUEUE_SIZE - 1)];
+	EVQ_STORE (&eventHead, head + 1);
+	return TRUE;
+}
+
+BOOLEAN
+WaitInputEventUntil (TimeCount wakeTime)
+{
+	BOOLEAN woken = FALSE;
+	DWORD tail;
+
+	EVQ_STORE (&eventWaiting, 1);
+	if (EVQ_LOAD (&eventTail) == eventSeen)
+		woken = SetSemaphoreUntil (eventSem, wakeTime);
+	if (!woken && !EVQ_EXCHANGE (&eventWaiting, 0))
+	{	// The producer got to the flag first, and has posted, or is
+		// about to post, the semaphore. Take that post, or it would
+		// cut short the next wait.
+		SetSemaphore (eventSem);
+	}
+
+	tail = EVQ_LOAD (&eventTail);
+	if (tail == eventSeen)
+		return FALSE;
+	eventSeen = tail;
+	return TRUE;
+}
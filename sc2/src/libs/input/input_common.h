@@ -19,6 +19,8 @@
 #ifndef INPUT_COMMON_H
 #define INPUT_COMMON_H
 
+#include "libs/compiler.h"
+
 // driver for TFB_InitInput
 enum
 {
@@ -36,4 +38,13 @@ extern void TFB_UninitInput (void);
 extern void TFB_SetInputVectors (volatile int menu[], int num_menu,
 		volatile int flight[], int num_templ, int num_flight);
 
+// The producer side of the input event queue (see libs/inplib.h).
+// PostInputEvent() must only be called from one thread.
+extern void InitInputEvents (void);
+extern void UninitInputEvents (void);
+extern void PostInputEvent (BYTE type, BYTE templat, BYTE control,
+		int value);
+// Drops all queued events; may be called from any thread.
+extern void ResyncInputEvents (void);
+
 #endif
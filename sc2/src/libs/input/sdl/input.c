@@ -199,6 +199,33 @@ initKeyConfig (void)
 	return;
 }
 
+// Queues the new state of a control, after VControl or the character
+// buffer has changed it.
+static void
+postControlChange (volatile int *target)
+{
+	int value = *target & VCONTROL_MASK;
+
+	if (target >= menu_vec && target < menu_vec + num_menu)
+	{
+		PostInputEvent (INPUT_EVENT_MENU, 0, (BYTE)(target - menu_vec),
+				value);
+	}
+	else if (target >= flight_vec
+			&& target < flight_vec + num_templ * num_flight)
+	{
+		int index = (int)(target - flight_vec);
+		PostInputEvent (INPUT_EVENT_FLIGHT, (BYTE)(index / num_flight),
+				(BYTE)(index % num_flight), value);
+	}
+}
+
+static void
+controlChanged (int *target)
+{
+	postControlChange (target);
+}
+
 static void
 resetKeyboardState (void)
 {
@@ -280,12 +307,16 @@ TFB_InitInput (int driver, int flags)
 	in_character_mode = FALSE;
 	resetKeyboardState ();
 
+	InitInputEvents ();
+
 	/* Prepare the Virtual Controller system. */
 	VControl_Init ();
+	VControl_SetChangeCallback (controlChanged);
 
 	initKeyConfig ();
 	
 	VControl_ResetInput ();
+	ResyncInputEvents ();
 	InputInitialized = TRUE;
 
 	return 0;
@@ -294,7 +325,9 @@ TFB_InitInput (int driver, int flags)
 void
 TFB_UninitInput (void)
 {
+	VControl_SetChangeCallback (NULL);
 	VControl_Uninit ();
+	UninitInputEvents ();
 	HFree (controls);
 #if SDL_MAJOR_VERSION == 1
 	HFree (kbdstate);
@@ -308,12 +341,14 @@ EnterCharacterMode (void)
 	lastchar = 0;
 	in_character_mode = TRUE;
 	VControl_ResetInput ();
+	ResyncInputEvents ();
 }
 
 void
 ExitCharacterMode (void)
 {
 	VControl_ResetInput ();
+	ResyncInputEvents ();
 	in_character_mode = FALSE;
 	kbdhead = kbdtail = 0;
 	lastchar = 0;
@@ -407,6 +442,7 @@ ProcessInputEvent (const SDL_Event *Event)
 				kbdtail = newtail;
 				lastchar = map_key;
 				menu_vec[KEY_MENU_ANY]++;
+				postControlChange (&menu_vec[KEY_MENU_ANY]);
 			}
 		}
 		else if (Event->type == SDL_KEYUP)
@@ -422,6 +458,7 @@ ProcessInputEvent (const SDL_Event *Event)
 				if (menu_vec[KEY_MENU_ANY] > 0)
 					menu_vec[KEY_MENU_ANY]--;
 			}
+			postControlChange (&menu_vec[KEY_MENU_ANY]);
 		}
 	}
 }
@@ -525,6 +562,7 @@ TFB_ResetControls (void)
 {
 	VControl_ResetInput ();
 	resetKeyboardState ();
+	ResyncInputEvents ();
 	// flush character buffer
 	kbdhead = kbdtail = 0;
 	lastchar = 0;
@@ -82,6 +82,8 @@ static keypool *pool;
 static int event_ready;
 static SDL_Event last_interesting;
 
+static VControl_ChangeCallback *change_callback;
+
 static keypool *
 allocate_key_chunk (void)
 {
@@ -379,6 +381,8 @@ activate (keybinding *i, sdl_key_t keycode)
 		if (i->keycode == keycode)
 		{
 			*(i->target) = (*(i->target)+1) | VCONTROL_STARTBIT;
+			if (change_callback)
+				change_callback (i->target);
 		}
 		i = i->next;
 	}
@@ -393,6 +397,8 @@ deactivate (keybinding *i, sdl_key_t keycode)
 		if ((i->keycode == keycode) && (v > 0))
 		{
 			*(i->target) = (v-1) | (*(i->target) & VCONTROL_STARTBIT);
+			if (change_callback)
+				change_callback (i->target);
 		}
 		i = i->next;
 	}
@@ -890,6 +896,12 @@ VControl_ProcessJoyHat (int port, int which, Uint8 value)
 #endif /* HAVE_JOYSTICK */
 }
 
+void
+VControl_SetChangeCallback (VControl_ChangeCallback *callback)
+{
+	change_callback = callback;
+}
+
 void
 VControl_ResetInput (void)
 {
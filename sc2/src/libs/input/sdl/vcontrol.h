@@ -82,6 +82,11 @@ void VControl_ProcessJoyButtonUp (int port, int button);
 void VControl_ProcessJoyAxis (int port, int axis, int value);
 void VControl_ProcessJoyHat (int port, int which, Uint8 value);
 
+/* Listening for changes.  The callback is called from VControl_HandleEvent
+ * and the VControl_Process* routines, after a target has been changed. */
+typedef void (VControl_ChangeCallback) (int *target);
+void VControl_SetChangeCallback (VControl_ChangeCallback *callback);
+
 /* Force the input into the blank state.  For preventing "sticky" keys. */
 void VControl_ResetInput (void);
 
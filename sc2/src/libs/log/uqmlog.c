@@ -23,7 +23,61 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "libs/threadlib.h"
+#include "libs/timelib.h"
+
+// Messages logged by threads are put in a ring buffer of their thread, with
+// the arguments unformatted, and written out by a separate thread. This
+// needs thread-local storage and atomic operations; where they are not
+// available, messages are formatted and written right away.
+#if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#	define LOG_THREAD_LOCAL __thread
+#	define LOG_LOAD(ptr) \
+		__atomic_load_n ((ptr), __ATOMIC_ACQUIRE)
+#	define LOG_STORE(ptr, newVal) \
+		__atomic_store_n ((ptr), (newVal), __ATOMIC_RELEASE)
+#	define LOG_CAS_PTR(ptr, oldVal, newVal) \
+		__atomic_compare_exchange_n ((ptr), &(oldVal), (newVal), 0, \
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#	define LOG_CAS_INT(ptr, oldVal, newVal) \
+		__atomic_compare_exchange_n ((ptr), &(oldVal), (newVal), 0, \
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#	define LOG_INC(ptr) \
+		__atomic_fetch_add ((ptr), 1, __ATOMIC_RELAXED)
+#	define LOG_FENCE() \
+		__atomic_thread_fence (__ATOMIC_SEQ_CST)
+#	define LOG_ASYNC
+#elif defined(_MSC_VER) && _MSC_VER >= 1400
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#	define LOG_THREAD_LOCAL __declspec(thread)
+#	define LOG_LOAD(ptr) \
+		(*(volatile LONG *) (ptr))
+#	define LOG_STORE(ptr, newVal) \
+		InterlockedExchange ((LONG volatile *) (ptr), (newVal))
+		// Note: the Interlocked functions return the old value instead
+		// of updating 'oldVal' like the GCC builtins.
+#	define LOG_CAS_PTR(ptr, oldVal, newVal) \
+		(InterlockedCompareExchangePointer ((PVOID volatile *) (ptr), \
+				(newVal), (oldVal)) == (oldVal) ? 1 : \
+				((oldVal) = *(ptr), 0))
+#	define LOG_CAS_INT(ptr, oldVal, newVal) \
+		(InterlockedCompareExchange ((LONG volatile *) (ptr), \
+				(newVal), (oldVal)) == (oldVal) ? 1 : \
+				((oldVal) = *(ptr), 0))
+#	define LOG_INC(ptr) \
+		InterlockedExchangeAdd ((LONG volatile *) (ptr), 1)
+#	define LOG_FENCE() \
+		MemoryBarrier ()
+#	define LOG_ASYNC
+#endif
+
+#if defined(LOG_ASYNC) && !defined(va_copy)
+	// Older MSVC; there va_list is a pointer
+#	define va_copy(dest, src) ((dest) = (src))
+#endif
 
 #ifndef MAX_LOG_ENTRY_SIZE
 #	define MAX_LOG_ENTRY_SIZE 256
@@ -124,6 +178,809 @@ queueNonThreaded (void)
 	memcpy (queue[slot], msgNoThread, sizeof (msgNoThread));
 }
 
+#ifdef LOG_ASYNC
+
+// Records per thread; must be a power of 2
+#define LOG_RING_SIZE 128
+#define LOG_MAX_ARGS 16
+#define LOG_DATA_SIZE 320
+		// Room for copies of the strings passed for "%s"
+
+// The log thread is woken up when a ring becomes half full, or when an
+// error is logged. Other messages wait at most this long.
+#define LOG_DRAIN_PERIOD (ONE_SECOND / 4)
+
+// Size of the buffer in which the log thread collects formatted messages,
+// so that it writes several at once.
+#define LOG_WRITE_BUF_SIZE 4096
+
+typedef union
+{
+	long long i;
+	double d;
+	const void *p;
+	size_t str;
+			// Offset of a string in log_Record.data
+} log_Arg;
+
+typedef struct
+{
+	DWORD stamp;
+			// When the message was logged, counted in messages logged
+			// by all threads. Used to write them out in order.
+	int level;
+	const char *fmt;
+			// NULL if 'data' holds the formatted message
+	log_Arg args[LOG_MAX_ARGS];
+	char data[LOG_DATA_SIZE];
+} log_Record;
+
+typedef struct log_Ring log_Ring;
+struct log_Ring
+{
+	log_Ring *next;
+	volatile int inUse;
+			// Set while a thread logs to this ring
+	volatile DWORD head;
+			// Written only by the thread which logs to this ring
+	volatile DWORD tail;
+			// Written only while holding drainMutex
+	log_Record records[LOG_RING_SIZE];
+};
+
+// The rings are never freed; when a thread ends, another can take over
+// its ring.
+static log_Ring *rings;
+static LOG_THREAD_LOCAL log_Ring *myRing;
+static volatile DWORD logStamp;
+
+static volatile int asyncOn = 0;
+		// Set while messages go through the rings. Read and written
+		// with LOG_LOAD() and LOG_STORE().
+static Mutex drainMutex;
+		// Held while writing out records, so that it is done by one
+		// thread at a time, in order
+static Semaphore drainSem;
+		// Cleared to wake up the log thread
+static volatile int drainAsleep;
+		// Set while the log thread waits; whoever resets it clears
+		// drainSem, so that it is only cleared once for each wait
+
+// Kinds of printf() arguments
+enum
+{
+	LOG_ARG_NONE,
+			// "%%"
+	LOG_ARG_INT,
+	LOG_ARG_LONG,
+	LOG_ARG_LLONG,
+	LOG_ARG_SIZE,
+	LOG_ARG_INTMAX,
+	LOG_ARG_PTRDIFF,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_PTR,
+	LOG_ARG_STR,
+	LOG_ARG_BAD,
+			// Not supported; the message is formatted right away
+};
+
+typedef struct
+{
+	const char *start;
+	const char *end;
+			// The conversion specification is [start, end)
+	int type;
+	int numStars;
+			// Number of int arguments for '*' width and precision
+	bool starWidth;
+	bool starPrecision;
+	int precision;
+			// -1 if none is given, or if it is given by a '*'
+	bool plain;
+			// No flags, width, precision or 'h'; the conversion can be
+			// done without snprintf()
+	char conversion;
+} log_Spec;
+
+// Parses the conversion specification at 'p', which points to a '%'.
+static const char *
+parseSpec (const char *p, log_Spec *spec)
+{
+	int length = 0;
+			// 'h' counts -1, 'l' counts 1
+	char special = '\0';
+
+	spec->start = p++;
+	spec->plain = false;
+	spec->numStars = 0;
+	spec->starWidth = false;
+	spec->starPrecision = false;
+	spec->precision = -1;
+
+	while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0'
+			|| *p == '\'')
+		p++;
+	if (*p == '*')
+	{
+		spec->numStars++;
+		spec->starWidth = true;
+		p++;
+	}
+	while (*p >= '0' && *p <= '9')
+		p++;
+	if (*p == '.')
+	{
+		p++;
+		if (*p == '*')
+		{
+			spec->numStars++;
+			spec->starPrecision = true;
+			p++;
+		}
+		else
+		{
+			spec->precision = 0;
+			while (*p >= '0' && *p <= '9')
+			{
+				if (spec->precision < LOG_DATA_SIZE)
+					spec->precision = spec->precision * 10 + (*p - '0');
+				p++;
+			}
+		}
+	}
+	for (;; p++)
+	{
+		if (*p == 'h')
+			length--;
+		else if (*p == 'l')
+			length++;
+		else if (*p == 'z' || *p == 'j' || *p == 't' || *p == 'L')
+			special = *p;
+		else
+			break;
+	}
+
+	spec->plain = (p == spec->start + 1 + (length > 0 ? length : 0))
+			&& length >= 0 && special == '\0';
+	spec->conversion = *p;
+	switch (*p)
+	{
+		case '%':
+			spec->type = LOG_ARG_NONE;
+			break;
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+			if (special == 'z')
+				spec->type = LOG_ARG_SIZE;
+			else if (special == 'j')
+				spec->type = LOG_ARG_INTMAX;
+			else if (special == 't')
+				spec->type = LOG_ARG_PTRDIFF;
+			else if (special != '\0')
+				spec->type = LOG_ARG_BAD;
+			else if (length >= 2)
+				spec->type = LOG_ARG_LLONG;
+			else if (length == 1)
+				spec->type = LOG_ARG_LONG;
+			else
+				spec->type = LOG_ARG_INT;
+			break;
+		case 'c':
+			spec->type = (length || special) ? LOG_ARG_BAD : LOG_ARG_INT;
+			break;
+		case 'e': case 'E': case 'f': case 'F':
+		case 'g': case 'G': case 'a': case 'A':
+			spec->type = special ? LOG_ARG_BAD : LOG_ARG_DOUBLE;
+			break;
+		case 'p':
+			spec->type = LOG_ARG_PTR;
+			break;
+		case 's':
+			spec->type = (length || special) ? LOG_ARG_BAD : LOG_ARG_STR;
+			break;
+		default:
+			// Includes "%n" and a '%' at the end
+			spec->type = LOG_ARG_BAD;
+			return p;
+	}
+	spec->end = ++p;
+	return p;
+}
+
+// Stores the arguments for 'fmt' in 'rec'. Returns false, with 'list'
+// partly used, if they cannot be stored. Strings which do not fit are
+// truncated.
+// As with printf(), a string with a precision is read no further than the
+// precision, so it need not be '\0'-terminated.
+static bool
+packArgs (log_Record *rec, const char *fmt, va_list list)
+{
+	const char *p = fmt;
+	log_Spec spec;
+	log_Arg *arg = rec->args;
+	size_t used = 0;
+	int i;
+
+	while ((p = strchr (p, '%')) != NULL)
+	{
+		p = parseSpec (p, &spec);
+		if (spec.type == LOG_ARG_BAD || arg + spec.numStars
+				+ (spec.type != LOG_ARG_NONE) > rec->args + LOG_MAX_ARGS)
+			return false;
+		for (i = 0; i < spec.numStars; i++, arg++)
+			arg->i = va_arg (list, int);
+
+		switch (spec.type)
+		{
+			case LOG_ARG_NONE:
+				continue;
+			case LOG_ARG_INT:
+				arg->i = va_arg (list, int);
+				break;
+			case LOG_ARG_LONG:
+				arg->i = va_arg (list, long);
+				break;
+			case LOG_ARG_LLONG:
+				arg->i = va_arg (list, long long);
+				break;
+			case LOG_ARG_SIZE:
+				arg->i = (long long) va_arg (list, size_t);
+				break;
+			case LOG_ARG_INTMAX:
+				arg->i = (long long) va_arg (list, intmax_t);
+				break;
+			case LOG_ARG_PTRDIFF:
+				arg->i = va_arg (list, ptrdiff_t);
+				break;
+			case LOG_ARG_DOUBLE:
+				arg->d = va_arg (list, double);
+				break;
+			case LOG_ARG_PTR:
+				arg->p = va_arg (list, void *);
+				break;
+			case LOG_ARG_STR:
+			{
+				const char *str = va_arg (list, const char *);
+				size_t maxLen = LOG_DATA_SIZE - 1 - used;
+				const char *end;
+				size_t len;
+
+				if (spec.starPrecision)
+				{
+					// The precision is the last '*' argument
+					if (arg[-1].i >= 0 && (size_t) arg[-1].i < maxLen)
+						maxLen = (size_t) arg[-1].i;
+				}
+				else if (spec.precision >= 0
+						&& (size_t) spec.precision < maxLen)
+					maxLen = (size_t) spec.precision;
+
+				if (str == NULL)
+					str = "(null)";
+				end = memchr (str, '\0', maxLen);
+				len = end ? (size_t) (end - str) : maxLen;
+				memcpy (rec->data + used, str, len);
+				rec->data[used + len] = '\0';
+				arg->str = used;
+				used += len;
+				// Once full, all further strings share the last '\0'
+				if (used < LOG_DATA_SIZE - 1)
+					used++;
+				break;
+			}
+		}
+		arg++;
+	}
+	return true;
+}
+
+// Does the conversion of a plain "%d", "%lu", "%s", etc, into 'buf', of
+// 'size' bytes, without snprintf(), and returns the length of the result,
+// which is cut off to fit. Returns -1 for conversions it does not do.
+static int
+formatPlain (const log_Spec *spec, const log_Arg *arg, const char *data,
+		char *buf, size_t size)
+{
+	char digits[24];
+	char *d = digits + sizeof digits;
+	const char *src;
+	size_t len;
+
+	if (spec->conversion == 's')
+	{
+		src = data + arg->str;
+		len = strlen (src);
+	}
+	else
+	{
+		const char *digitChars = "0123456789abcdef";
+		unsigned base;
+		bool isSigned = false;
+		bool negative = false;
+		unsigned long long value;
+
+		switch (spec->conversion)
+		{
+			case 'd': case 'i':
+				isSigned = true;
+				base = 10;
+				break;
+			case 'u':
+				base = 10;
+				break;
+			case 'x':
+				base = 16;
+				break;
+			case 'X':
+				base = 16;
+				digitChars = "0123456789ABCDEF";
+				break;
+			default:
+				return -1;
+		}
+
+		switch (spec->type)
+		{
+			case LOG_ARG_INT:
+				value = isSigned ? (unsigned long long) (int) arg->i
+						: (unsigned int) arg->i;
+				break;
+			case LOG_ARG_LONG:
+				value = isSigned ? (unsigned long long) (long) arg->i
+						: (unsigned long) arg->i;
+				break;
+			case LOG_ARG_LLONG:
+				value = (unsigned long long) arg->i;
+				break;
+			default:
+				return -1;
+		}
+		if (isSigned && (long long) value < 0)
+		{
+			negative = true;
+			value = 0 - value;
+		}
+
+		// Constant divisors, which compile to multiplications and shifts
+		if (base == 10)
+		{
+			do
+			{
+				*--d = (char) ('0' + value % 10);
+				value /= 10;
+			} while (value != 0);
+		}
+		else
+		{
+			do
+			{
+				*--d = digitChars[value & 0xf];
+				value >>= 4;
+			} while (value != 0);
+		}
+		if (negative)
+			*--d = '-';
+		src = d;
+		len = (size_t) (digits + sizeof digits - d);
+	}
+
+	if (len > size - 1)
+		len = size - 1;
+	memcpy (buf, src, len);
+	return (int) len;
+}
+
+// Formats the message of 'rec' into 'buf', and returns its length.
+static size_t
+formatRecord (const log_Record *rec, char *buf, size_t size)
+{
+	const char *p = rec->fmt;
+	const char *lit;
+	const log_Arg *arg = rec->args;
+	log_Spec spec;
+	char specBuf[64];
+	size_t len = 0;
+	size_t specLen;
+	int written;
+
+	if (rec->fmt == NULL)
+	{
+		strncpy (buf, rec->data, size - 1);
+		buf[size - 1] = '\0';
+		return strlen (buf);
+	}
+
+	for (lit = p; len < size - 1; lit = p)
+	{
+		size_t litLen;
+
+		p = strchr (lit, '%');
+		litLen = p ? (size_t) (p - lit) : strlen (lit);
+		if (litLen > size - 1 - len)
+			litLen = size - 1 - len;
+		memcpy (buf + len, lit, litLen);
+		len += litLen;
+		if (p == NULL)
+			break;
+
+		p = parseSpec (p, &spec);
+		if (spec.type == LOG_ARG_NONE)
+		{
+			if (len < size - 1)
+				buf[len++] = '%';
+			continue;
+		}
+
+		if (spec.plain)
+		{
+			written = formatPlain (&spec, arg, rec->data, buf + len,
+					size - len);
+			if (written >= 0)
+			{
+				len += (size_t) written;
+				arg++;
+				continue;
+			}
+		}
+
+		// Put the '*' arguments in the specification itself
+		specLen = 0;
+		{
+			const char *s;
+			int star = 0;
+
+			for (s = spec.start; s < spec.end &&
+					specLen < sizeof specBuf - 12; s++)
+			{
+				if (*s != '*')
+				{
+					specBuf[specLen++] = *s;
+					continue;
+				}
+				if (arg[star].i >= 0 || (star == 0 && spec.starWidth))
+				{
+					// A negative width becomes the '-' flag
+					specLen += sprintf (specBuf + specLen, "%d",
+							(int) arg[star].i);
+				}
+				else
+				{
+					// A negative precision counts as none; drop the '.'
+					specLen--;
+				}
+				star++;
+			}
+			specBuf[specLen] = '\0';
+			arg += spec.numStars;
+		}
+
+		switch (spec.type)
+		{
+			case LOG_ARG_INT:
+				written = snprintf (buf + len, size - len, specBuf,
+						(int) arg->i);
+				break;
+			case LOG_ARG_LONG:
+				written = snprintf (buf + len, size - len, specBuf,
+						(long) arg->i);
+				break;
+			case LOG_ARG_LLONG:
+				written = snprintf (buf + len, size - len, specBuf,
+						arg->i);
+				break;
+			case LOG_ARG_SIZE:
+				written = snprintf (buf + len, size - len, specBuf,
+						(size_t) arg->i);
+				break;
+			case LOG_ARG_INTMAX:
+				written = snprintf (buf + len, size - len, specBuf,
+						(intmax_t) arg->i);
+				break;
+			case LOG_ARG_PTRDIFF:
+				written = snprintf (buf + len, size - len, specBuf,
+						(ptrdiff_t) arg->i);
+				break;
+			case LOG_ARG_DOUBLE:
+				written = snprintf (buf + len, size - len, specBuf,
+						arg->d);
+				break;
+			case LOG_ARG_PTR:
+				written = snprintf (buf + len, size - len, specBuf,
+						arg->p);
+				break;
+			case LOG_ARG_STR:
+				written = snprintf (buf + len, size - len, specBuf,
+						rec->data + arg->str);
+				break;
+			default:
+				written = 0;
+				break;
+		}
+		arg++;
+		if (written > 0)
+			len += (size_t) written;
+		if (len > size - 1)
+			len = size - 1;
+	}
+	buf[len] = '\0';
+	return len;
+}
+
+#endif /* LOG_ASYNC */
+
+// Adds a formatted message to the queue of messages to show on exit.
+static void
+keepMessage (const char *msg)
+{
+	int slot;
+
+	queueNonThreaded ();
+
+	slot = acquireSlot ();
+	memcpy (queue[slot], msg, sizeof (queue[0]));
+}
+
+// Writes a formatted message to the output stream and the queue of
+// messages to show on exit.
+static void
+emitMessage (int level, const char *msg)
+{
+	if (level <= maxStreamLevel)
+	{
+		fprintf (streamOut, "%s\n", msg);
+	}
+
+	if (level <= maxLevel)
+		keepMessage (msg);
+}
+
+#ifdef LOG_ASYNC
+
+// Returns the ring of the calling thread, or NULL if there is none and
+// none could be made.
+static log_Ring *
+getRing (void)
+{
+	log_Ring *ring = myRing;
+	log_Ring *first;
+
+	if (ring != NULL)
+		return ring;
+
+	// Take over the ring of a thread which has ended, if any
+	for (ring = LOG_LOAD (&rings); ring != NULL; ring = ring->next)
+	{
+		int unused = 0;
+		if (LOG_CAS_INT (&ring->inUse, unused, 1))
+		{
+			myRing = ring;
+			return ring;
+		}
+	}
+
+	// Not HMalloc(); it may log
+	ring = calloc (1, sizeof (log_Ring));
+	if (ring == NULL)
+		return NULL;
+	ring->inUse = 1;
+
+	first = LOG_LOAD (&rings);
+	do
+		ring->next = first;
+	while (!LOG_CAS_PTR (&rings, first, ring));
+
+	myRing = ring;
+	return ring;
+}
+
+// Writes out all records in the rings, oldest first. The messages for the
+// output stream are collected in a buffer and written several at once.
+// Must be called with drainMutex held.
+static void
+drainRings (void)
+{
+	char writeBuf[LOG_WRITE_BUF_SIZE];
+	size_t writeLen = 0;
+
+	for (;;)
+	{
+		log_Ring *ring;
+		log_Ring *oldest = NULL;
+		DWORD oldestStamp = 0;
+		DWORD nextStamp = 0;
+		bool haveNext = false;
+		DWORD head;
+		DWORD tail;
+
+		// Find the ring with the oldest record, and the stamp of the
+		// oldest record in the other rings. Records of the oldest ring
+		// up to that stamp can be written without looking again.
+		for (ring = LOG_LOAD (&rings); ring != NULL; ring = ring->next)
+		{
+			DWORD stamp;
+
+			if (LOG_LOAD (&ring->head) == ring->tail)
+				continue;
+			stamp = ring->records[ring->tail % LOG_RING_SIZE].stamp;
+			if (oldest == NULL || (sint32) (stamp - oldestStamp) < 0)
+			{
+				if (oldest != NULL)
+				{
+					nextStamp = oldestStamp;
+					haveNext = true;
+				}
+				oldest = ring;
+				oldestStamp = stamp;
+			}
+			else if (!haveNext || (sint32) (stamp - nextStamp) < 0)
+			{
+				nextStamp = stamp;
+				haveNext = true;
+			}
+		}
+		if (oldest == NULL)
+			break;
+
+		head = LOG_LOAD (&oldest->head);
+		for (tail = oldest->tail; tail != head; tail++)
+		{
+			const log_Record *rec = &oldest->records[tail % LOG_RING_SIZE];
+			char *msg;
+			size_t msgLen;
+
+			if (haveNext && (sint32) (rec->stamp - nextStamp) > 0)
+				break;
+
+			if (sizeof writeBuf - writeLen < sizeof (log_Entry) + 1)
+			{
+				fwrite (writeBuf, 1, writeLen, streamOut);
+				writeLen = 0;
+			}
+			msg = writeBuf + writeLen;
+			msgLen = formatRecord (rec, msg, sizeof (log_Entry) - 1);
+			if (rec->level <= maxLevel)
+				keepMessage (msg);
+			if (rec->level <= maxStreamLevel)
+			{
+				msg[msgLen] = '\n';
+				writeLen += msgLen + 1;
+			}
+		}
+		LOG_STORE (&oldest->tail, tail);
+	}
+
+	if (writeLen > 0)
+		fwrite (writeBuf, 1, writeLen, streamOut);
+}
+
+// Writes out what has been logged so far, on the calling thread.
+static void
+flushRings (void)
+{
+	LockMutex (drainMutex);
+	drainRings ();
+	UnlockMutex (drainMutex);
+}
+
+// Wakes up the log thread, if it is waiting.
+static void
+wakeDrainThread (void)
+{
+	int asleep = 1;
+
+	if (LOG_CAS_INT (&drainAsleep, asleep, 0))
+		ClearSemaphore (drainSem);
+}
+
+static int
+drainThread (void *data)
+{
+	(void) data;  /* Satisfying compiler (unused parameter) */
+
+	while (LOG_LOAD (&asyncOn))
+	{
+		flushRings ();
+
+		LOG_STORE (&drainAsleep, 1);
+		if (!SetSemaphoreUntil (drainSem,
+				GetTimeCounter () + LOG_DRAIN_PERIOD))
+		{
+			// Timed out. Unless a thread has just woken us up, and
+			// cleared the semaphore, nobody else will touch it now.
+			int asleep = 1;
+			if (!LOG_CAS_INT (&drainAsleep, asleep, 0))
+				SetSemaphore (drainSem);
+		}
+	}
+	return 0;
+}
+
+// Puts a message in the ring of the calling thread. Returns false if it
+// has to be written out right away instead.
+static bool
+queueMessage (log_Level level, const char *fmt, va_list list)
+{
+	log_Ring *ring;
+	log_Record *rec;
+	DWORD head;
+	va_list packList;
+
+	if (!LOG_LOAD (&asyncOn))
+	{
+		// The messages that this thread queued before must come first.
+		if (myRing != NULL && myRing->head != LOG_LOAD (&myRing->tail))
+			flushRings ();
+		return false;
+	}
+	
+	ring = getRing ();
+	if (ring == NULL)
+		return false;
+
+	head = ring->head;
+	if (head - LOG_LOAD (&ring->tail) == LOG_RING_SIZE)
+	{
+		// Full; make room rather than losing the message
+		flushRings ();
+	}
+
+	rec = &ring->records[head % LOG_RING_SIZE];
+	rec->stamp = LOG_INC (&logStamp);
+	rec->level = level;
+	va_copy (packList, list);
+	if (packArgs (rec, fmt, packList))
+		rec->fmt = fmt;
+	else
+	{
+		rec->fmt = NULL;
+		vsnprintf (rec->data, sizeof (rec->data), fmt, list);
+	}
+	va_end (packList);
+	LOG_STORE (&ring->head, head + 1);
+
+	// log_exit() clears asyncOn and then writes out the rings; if it got
+	// there before the record was in, write it out here. The fences make
+	// sure that one of the two sees the other's store.
+	LOG_FENCE ();
+	if (!LOG_LOAD (&asyncOn))
+	{
+		flushRings ();
+		return true;
+	}
+
+	if (head + 1 - LOG_LOAD (&ring->tail) == LOG_RING_SIZE / 2
+			|| level <= log_Error)
+		wakeDrainThread ();
+
+	return true;
+}
+
+#endif /* LOG_ASYNC */
+
+// Writes out what other threads have logged so far. Must not be called
+// while holding locks which the logging thread may need.
+void
+log_flush (void)
+{
+#ifdef LOG_ASYNC
+	if (LOG_LOAD (&asyncOn))
+		flushRings ();
+#endif
+}
+
+// Called when a thread ends, so that its ring can be used by another one.
+void
+log_threadCleanup (void)
+{
+#ifdef LOG_ASYNC
+	if (myRing != NULL)
+	{
+		LOG_STORE (&myRing->inUse, 0);
+		myRing = NULL;
+	}
+#endif
+}
+
+
 void
 log_init (int max_lines)
 {
@@ -152,6 +1009,14 @@ log_initThreads (void)
 {
 	qmutex = CreateMutex ("Logging Lock", SYNC_CLASS_RESOURCE);
 	qlock = 1;
+
+#ifdef LOG_ASYNC
+	drainMutex = CreateMutex ("Logging drain Lock", SYNC_CLASS_RESOURCE);
+	drainSem = CreateSemaphore (0, "Logging drain wakeup",
+			SYNC_CLASS_RESOURCE);
+	LOG_STORE (&asyncOn, 1);
+	StartThread (drainThread, NULL, 0, "log writer");
+#endif
 }
 
 int
@@ -159,6 +1024,20 @@ log_exit (int code)
 {
 	showBox = false;
 
+#ifdef LOG_ASYNC
+	if (LOG_LOAD (&asyncOn))
+	{
+		// Write out everything still queued; from here on, messages are
+		// written out right away. The log thread ends by itself.
+		// Threads still in queueMessage() write out their own records.
+		flushRings ();
+		LOG_STORE (&asyncOn, 0);
+		LOG_FENCE ();
+		wakeDrainThread ();
+		flushRings ();
+	}
+#endif
+
 	if (qlock)
 	{
 		qlock = 0;
@@ -179,7 +1058,11 @@ log_setLevel (int level)
 FILE *
 log_setOutput (FILE *out)
 {
-	FILE *old = streamOut;
+	FILE *old;
+
+	// What was logged before goes to the old stream
+	log_flush ();
+	old = streamOut;
 	streamOut = out;
 	
 	return old;
@@ -189,23 +1072,19 @@ void
 log_addV (log_Level level, const char *fmt, va_list list)
 {
 	log_Entry full_msg;
+
+	if ((int)level > maxStreamLevel && (int)level > maxLevel)
+		return;
+
+#ifdef LOG_ASYNC
+	if (queueMessage (level, fmt, list))
+		return;
+#endif
+
 	vsnprintf (full_msg, sizeof (full_msg) - 1, fmt, list);
 	full_msg[sizeof (full_msg) - 1] = '\0';
 	
-	if ((int)level <= maxStreamLevel)
-	{
-		fprintf (streamOut, "%s\n", full_msg);
-	}
-
-	if ((int)level <= maxLevel)
-	{
-		int slot;
-
-		queueNonThreaded ();
-		
-		slot = acquireSlot ();
-		memcpy (queue[slot], full_msg, sizeof (queue[0]));
-	}
+	emitMessage (level, full_msg);
 }
 
 void
@@ -277,6 +1156,7 @@ log_captureLines (int num)
 static void
 exitCallback (void)
 {
+	log_flush ();
 	if (showBox)
 		displayLog (errorBox);
 
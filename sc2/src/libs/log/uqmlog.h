@@ -25,6 +25,10 @@
 extern void log_init (int max_lines);
 extern void log_initThreads (void);
 extern int log_exit (int code);
+extern void log_flush (void);
+		// writes out what other threads have logged so far
+extern void log_threadCleanup (void);
+		// called by the thread library when a thread ends
 
 extern FILE * log_setOutput (FILE *out);
 		// sets the new output stream and returns the previous one
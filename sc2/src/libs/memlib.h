@@ -35,6 +35,32 @@ extern void HFree (void *p);
 extern void *HCalloc (size_t size);
 extern void *HRealloc (void *p, size_t size);
 
+// For small objects of which the size is known when they are freed.
+// These come straight from the pools, without the header HMalloc() adds.
+// 'size' must be the same in both calls.
+extern void *HMallocObject (size_t size);
+extern void HFreeObject (void *p, size_t size);
+
+// Returns the objects cached by the calling thread to the pools.
+// Called by the thread library when a thread ends.
+extern void mem_threadCleanup (void);
+
+typedef struct
+{
+	size_t objectSize;
+	uint64 allocs;
+	uint64 frees;
+	uint64 slabBytes;
+} mem_PoolStats;
+
+// Fills in the statistics of up to 'maxStats' size classes and returns
+// the number of size classes (0 if the pools are not used).
+extern int mem_getPoolStats (mem_PoolStats *stats, int maxStats);
+
+// Replays an allocation trace written when UQM_MEMTRACE was set, and
+// logs how long it took with HMalloc() and with plain malloc().
+extern bool mem_replayTrace (const char *fileName);
+
 #if defined(__cplusplus)
 }
 #endif
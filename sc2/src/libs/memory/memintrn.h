@@ -0,0 +1,111 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Internal definitions shared by the files of the memory library.
+
+#ifndef LIBS_MEMORY_MEMINTRN_H_
+#define LIBS_MEMORY_MEMINTRN_H_
+
+#include <stddef.h>
+
+#include "libs/memlib.h"
+
+// Thread-local storage and atomic operations are needed for the pools.
+// Where they are not available, all allocations go to malloc().
+#if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#	define MEM_THREAD_LOCAL __thread
+#	define MEM_LOAD_PTR(ptr) \
+		__atomic_load_n ((ptr), __ATOMIC_ACQUIRE)
+#	define MEM_CAS_PTR(ptr, oldVal, newVal) \
+		__atomic_compare_exchange_n ((ptr), &(oldVal), (newVal), 0, \
+				__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#	define MEM_XCHG_PTR(ptr, newVal) \
+		__atomic_exchange_n ((ptr), (newVal), __ATOMIC_ACQ_REL)
+#	define MEM_XCHG_INT(ptr, newVal) \
+		__atomic_exchange_n ((ptr), (newVal), __ATOMIC_ACQUIRE)
+#	define MEM_STORE_INT(ptr, newVal) \
+		__atomic_store_n ((ptr), (newVal), __ATOMIC_RELEASE)
+#	define MEM_ADD_COUNT(ptr, val) \
+		((void) __atomic_fetch_add ((ptr), (val), __ATOMIC_RELAXED))
+#	define MEM_USE_POOLS
+#elif defined(_MSC_VER) && _MSC_VER >= 1400
+#	define WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#	define MEM_THREAD_LOCAL __declspec(thread)
+#	define MEM_LOAD_PTR(ptr) \
+		(*(void *volatile *) (ptr))
+		// Note: InterlockedCompareExchangePointer() returns the old
+		// value instead of updating 'oldVal' like the GCC builtin.
+#	define MEM_CAS_PTR(ptr, oldVal, newVal) \
+		(InterlockedCompareExchangePointer ((PVOID volatile *) (ptr), \
+				(newVal), (oldVal)) == (oldVal) ? 1 : \
+				((oldVal) = *(ptr), 0))
+#	define MEM_XCHG_PTR(ptr, newVal) \
+		InterlockedExchangePointer ((PVOID volatile *) (ptr), (newVal))
+#	define MEM_XCHG_INT(ptr, newVal) \
+		InterlockedExchange ((LONG volatile *) (ptr), (newVal))
+#	define MEM_STORE_INT(ptr, newVal) \
+		InterlockedExchange ((LONG volatile *) (ptr), (newVal))
+#	define MEM_ADD_COUNT(ptr, val) \
+		((void) InterlockedExchangeAdd64 ((LONGLONG volatile *) (ptr), \
+				(LONGLONG) (val)))
+#	define MEM_USE_POOLS
+#endif
+
+// Objects up to this size (including the header HMalloc() adds) are
+// allocated from the pools.
+#define MEM_MAX_POOLED_SIZE 256
+#define MEM_CLASS_GRANULARITY 16
+#define MEM_NUM_CLASSES (MEM_MAX_POOLED_SIZE / MEM_CLASS_GRANULARITY)
+
+// HMalloc() puts this in front of each allocation. Its size keeps the
+// returned memory aligned as well as malloc() would.
+typedef union
+{
+	size_t sizeClass;
+			// 0 for memory from malloc(), otherwise the size class + 1
+	double alignDouble;
+	void *alignPtr;
+	char pad[MEM_CLASS_GRANULARITY];
+} mem_Header;
+
+static inline int
+mem_sizeClass (size_t size)
+{
+	return (int) ((size + MEM_CLASS_GRANULARITY - 1) /
+			MEM_CLASS_GRANULARITY) - 1;
+}
+
+static inline size_t
+mem_classSize (int sizeClass)
+{
+	return (size_t) (sizeClass + 1) * MEM_CLASS_GRANULARITY;
+}
+
+#ifdef MEM_USE_POOLS
+void *mem_poolAlloc (int sizeClass);
+void mem_poolFree (int sizeClass, void *p);
+#endif
+
+// Allocation tracing; see memtrace.c
+extern volatile int mem_tracing;
+bool mem_startTrace (const char *fileName);
+void mem_stopTrace (void);
+void mem_traceAlloc (const void *p, size_t size);
+void mem_traceFree (const void *p);
+void mem_traceRealloc (const void *oldP, const void *newP, size_t size);
+
+#endif /* LIBS_MEMORY_MEMINTRN_H_ */
@@ -0,0 +1,441 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Allocation traces.
+// When the environment variable UQM_MEMTRACE names a file, every
+// HMalloc(), HFree() and HRealloc() of the session is recorded in it.
+// mem_replayTrace() performs the allocations of such a trace again,
+// once through HMalloc() and once directly through malloc(), and
+// reports how long each took. This is a benchmark of the allocator with
+// the allocation pattern of a real game session.
+//
+// A trace file starts with TRACE_MAGIC, followed by records of
+// TRACE_RECORD_SIZE bytes: the operation ('a', 'f' or 'r'), the address
+// (8 bytes), the new address for 'r' (8 bytes), and the size (4 bytes).
+// Numbers are stored little endian.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memintrn.h"
+#include "libs/log.h"
+#include "libs/timelib.h"
+
+#define TRACE_MAGIC "UQMmtrc1"
+#define TRACE_MAGIC_SIZE 8
+#define TRACE_RECORD_SIZE 21
+
+volatile int mem_tracing = 0;
+
+#ifdef MEM_USE_POOLS
+static FILE *traceFile = NULL;
+static int traceLock = 0;
+#endif
+
+
+#ifdef MEM_USE_POOLS
+static void
+putUInt (unsigned char *buf, uint64 value, int numBytes)
+{
+	int i;
+
+	for (i = 0; i < numBytes; i++)
+	{
+		buf[i] = (unsigned char) (value & 0xff);
+		value >>= 8;
+	}
+}
+
+static void
+writeRecord (char op, const void *p, const void *newP, size_t size)
+{
+	unsigned char buf[TRACE_RECORD_SIZE];
+
+	buf[0] = (unsigned char) op;
+	putUInt (buf + 1, (uint64) (size_t) p, 8);
+	putUInt (buf + 9, (uint64) (size_t) newP, 8);
+	putUInt (buf + 17, (uint64) size, 4);
+
+	while (MEM_XCHG_INT (&traceLock, 1))
+		;
+	if (traceFile != NULL)
+		fwrite (buf, TRACE_RECORD_SIZE, 1, traceFile);
+	MEM_STORE_INT (&traceLock, 0);
+}
+#endif
+
+bool
+mem_startTrace (const char *fileName)
+{
+#ifdef MEM_USE_POOLS
+	traceFile = fopen (fileName, "wb");
+	if (traceFile == NULL)
+	{
+		log_add (log_Warning, "Warning: Could not open memory trace "
+				"file '%s'.", fileName);
+		return false;
+	}
+	fwrite (TRACE_MAGIC, TRACE_MAGIC_SIZE, 1, traceFile);
+	mem_tracing = 1;
+	log_add (log_Info, "Tracing memory allocations to '%s'.", fileName);
+	return true;
+#else
+	log_add (log_Warning, "Warning: Memory allocation tracing is not "
+			"supported in this build.");
+	(void) fileName;
+	return false;
+#endif
+}
+
+void
+mem_stopTrace (void)
+{
+#ifdef MEM_USE_POOLS
+	FILE *file;
+
+	if (!mem_tracing)
+		return;
+	mem_tracing = 0;
+
+	while (MEM_XCHG_INT (&traceLock, 1))
+		;
+	file = traceFile;
+	traceFile = NULL;
+	MEM_STORE_INT (&traceLock, 0);
+
+	fclose (file);
+#endif
+}
+
+void
+mem_traceAlloc (const void *p, size_t size)
+{
+#ifdef MEM_USE_POOLS
+	writeRecord ('a', p, NULL, size);
+#else
+	(void) p;
+	(void) size;
+#endif
+}
+
+void
+mem_traceFree (const void *p)
+{
+#ifdef MEM_USE_POOLS
+	writeRecord ('f', p, NULL, 0);
+#else
+	(void) p;
+#endif
+}
+
+void
+mem_traceRealloc (const void *oldP, const void *newP, size_t size)
+{
+#ifdef MEM_USE_POOLS
+	writeRecord ('r', oldP, newP, size);
+#else
+	(void) oldP;
+	(void) newP;
+	(void) size;
+#endif
+}
+
+
+// Replaying
+
+typedef struct
+{
+	char op;
+	uint32 slot;
+	uint32 size;
+} ReplayOp;
+
+// Maps the addresses in a trace to slots while the trace is read.
+typedef struct
+{
+	uint64 *keys;
+	uint32 *values;
+	size_t mask;
+} AddrMap;
+
+static uint64
+getUInt (const unsigned char *buf, int numBytes)
+{
+	uint64 result = 0;
+
+	while (numBytes--)
+		result = (result << 8) | buf[numBytes];
+	return result;
+}
+
+static size_t
+AddrMap_find (const AddrMap *map, uint64 key)
+{
+	size_t i = (size_t) ((key >> 4) * 0x9E3779B97F4A7C15ULL) & map->mask;
+
+	while (map->keys[i] != 0 && map->keys[i] != key)
+		i = (i + 1) & map->mask;
+	return i;
+}
+
+static void
+AddrMap_remove (AddrMap *map, size_t i)
+{
+	// Backward-shift deletion, to keep the probe sequences intact.
+	size_t j = i;
+
+	map->keys[i] = 0;
+	for (;;)
+	{
+		size_t home;
+
+		j = (j + 1) & map->mask;
+		if (map->keys[j] == 0)
+			break;
+		home = AddrMap_find (map, map->keys[j]);
+		if (home == j)
+			continue;
+		map->keys[i] = map->keys[j];
+		map->values[i] = map->values[j];
+		map->keys[j] = 0;
+		i = j;
+	}
+}
+
+// Turns the records of a trace into operations on slots. Returns the
+// number of operations, or 0 on failure.
+static size_t
+buildReplayOps (const unsigned char *data, size_t numRecords,
+		ReplayOp *ops, uint32 *numSlots)
+{
+	AddrMap map;
+	size_t mapSize = 1024;
+	size_t numOps = 0;
+	uint32 nextSlot = 0;
+	size_t recordI;
+
+	while (mapSize < numRecords * 2)
+		mapSize *= 2;
+	map.keys = calloc (mapSize, sizeof *map.keys);
+	map.values = malloc (mapSize * sizeof *map.values);
+	map.mask = mapSize - 1;
+	if (map.keys == NULL || map.values == NULL)
+	{
+		free (map.keys);
+		free (map.values);
+		return 0;
+	}
+
+	for (recordI = 0; recordI < numRecords; recordI++)
+	{
+		const unsigned char *rec = data + recordI * TRACE_RECORD_SIZE;
+		uint64 addr = getUInt (rec + 1, 8);
+		uint64 newAddr = getUInt (rec + 9, 8);
+		uint32 size = (uint32) getUInt (rec + 17, 4);
+		size_t i;
+
+		switch (rec[0])
+		{
+			case 'a':
+				i = AddrMap_find (&map, addr);
+				map.keys[i] = addr;
+				map.values[i] = nextSlot;
+				ops[numOps].op = 'a';
+				ops[numOps].slot = nextSlot++;
+				ops[numOps].size = size;
+				numOps++;
+				break;
+			case 'f':
+				i = AddrMap_find (&map, addr);
+				if (map.keys[i] == 0)
+					break;  // Allocated before the trace started.
+				ops[numOps].op = 'f';
+				ops[numOps].slot = map.values[i];
+				ops[numOps].size = 0;
+				numOps++;
+				AddrMap_remove (&map, i);
+				break;
+			case 'r':
+			{
+				uint32 slot;
+
+				i = AddrMap_find (&map, addr);
+				if (map.keys[i] == 0)
+					break;
+				slot = map.values[i];
+				AddrMap_remove (&map, i);
+				i = AddrMap_find (&map, newAddr);
+				map.keys[i] = newAddr;
+				map.values[i] = slot;
+				ops[numOps].op = 'r';
+				ops[numOps].slot = slot;
+				ops[numOps].size = size;
+				numOps++;
+				break;
+			}
+			default:
+				log_add (log_Error, "Error: Bad record in memory trace.");
+				free (map.keys);
+				free (map.values);
+				return 0;
+		}
+	}
+
+	free (map.keys);
+	free (map.values);
+	*numSlots = nextSlot;
+	return numOps;
+}
+
+static double
+replayHMalloc (const ReplayOp *ops, size_t numOps, void **slots)
+{
+	uint64 start = GetPerfCounter ();
+	size_t i;
+
+	for (i = 0; i < numOps; i++)
+	{
+		const ReplayOp *op = &ops[i];
+		switch (op->op)
+		{
+			case 'a':
+				slots[op->slot] = HMalloc (op->size);
+				break;
+			case 'f':
+				HFree (slots[op->slot]);
+				slots[op->slot] = NULL;
+				break;
+			case 'r':
+				slots[op->slot] = HRealloc (slots[op->slot], op->size);
+				break;
+		}
+	}
+	return (double) (GetPerfCounter () - start) / GetPerfFrequency ();
+}
+
+static double
+replayMalloc (const ReplayOp *ops, size_t numOps, void **slots)
+{
+	uint64 start = GetPerfCounter ();
+	size_t i;
+
+	for (i = 0; i < numOps; i++)
+	{
+		const ReplayOp *op = &ops[i];
+		switch (op->op)
+		{
+			case 'a':
+				slots[op->slot] = malloc (op->size);
+				break;
+			case 'f':
+				free (slots[op->slot]);
+				slots[op->slot] = NULL;
+				break;
+			case 'r':
+				slots[op->slot] = realloc (slots[op->slot], op->size);
+				break;
+		}
+	}
+	return (double) (GetPerfCounter () - start) / GetPerfFrequency ();
+}
+
+bool
+mem_replayTrace (const char *fileName)
+{
+	FILE *file;
+	long fileSize;
+	unsigned char *data = NULL;
+	size_t numRecords;
+	ReplayOp *ops = NULL;
+	size_t numOps;
+	uint32 numSlots;
+	void **slots = NULL;
+	double poolTime, mallocTime;
+	uint32 slotI;
+	bool result = false;
+
+	file = fopen (fileName, "rb");
+	if (file == NULL)
+	{
+		log_add (log_Error, "Error: Could not open memory trace '%s'.",
+				fileName);
+		return false;
+	}
+	fseek (file, 0, SEEK_END);
+	fileSize = ftell (file);
+	fseek (file, 0, SEEK_SET);
+	if (fileSize < TRACE_MAGIC_SIZE)
+		goto bad;
+	data = malloc (fileSize);
+	if (data == NULL || fread (data, fileSize, 1, file) != 1 ||
+			memcmp (data, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0)
+		goto bad;
+	fclose (file);
+	file = NULL;
+
+	numRecords = (fileSize - TRACE_MAGIC_SIZE) / TRACE_RECORD_SIZE;
+	ops = malloc ((numRecords + 1) * sizeof *ops);
+	if (ops == NULL)
+		goto out;
+	numOps = buildReplayOps (data + TRACE_MAGIC_SIZE, numRecords, ops,
+			&numSlots);
+	free (data);
+	data = NULL;
+	if (numOps == 0)
+		goto out;
+	slots = calloc (numSlots, sizeof *slots);
+	if (slots == NULL)
+		goto out;
+
+	// A first run to warm up the pools and the system allocator.
+	replayHMalloc (ops, numOps, slots);
+	for (slotI = 0; slotI < numSlots; slotI++)
+	{
+		HFree (slots[slotI]);
+		slots[slotI] = NULL;
+	}
+
+	poolTime = replayHMalloc (ops, numOps, slots);
+	for (slotI = 0; slotI < numSlots; slotI++)
+	{
+		HFree (slots[slotI]);
+		slots[slotI] = NULL;
+	}
+
+	mallocTime = replayMalloc (ops, numOps, slots);
+	for (slotI = 0; slotI < numSlots; slotI++)
+		free (slots[slotI]);
+
+	log_add (log_Info, "Replayed %lu allocation operations from '%s':",
+			(unsigned long) numOps, fileName);
+	log_add (log_Info, "    HMalloc(): %.3f ms (%.1f ns per operation)",
+			poolTime * 1000.0, poolTime * 1e9 / numOps);
+	log_add (log_Info, "    malloc():  %.3f ms (%.1f ns per operation)",
+			mallocTime * 1000.0, mallocTime * 1e9 / numOps);
+	result = true;
+	goto out;
+
+bad:
+	log_add (log_Error, "Error: '%s' is not a memory trace.", fileName);
+out:
+	if (file != NULL)
+		fclose (file);
+	free (data);
+	free (ops);
+	free (slots);
+	return result;
+}
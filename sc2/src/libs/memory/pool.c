@@ -0,0 +1,309 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Size-class pools for small allocations.
+//
+// Each thread keeps a free list per size class, which is used without
+// any locking. When a thread's list runs empty, it takes a batch of
+// objects from the central free list of that size class; when it grows
+// too long, a batch is handed back.
+// The central free lists are lock-free stacks of batches. Batches are
+// only ever pushed one at a time, or all popped at once, so the stacks
+// do not suffer from the ABA problem. A thread that needs a batch takes
+// the entire stack, keeps the first batch and pushes the rest back.
+// When the central list is empty as well, a new slab is carved up.
+// Slabs are never returned to the system.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "memintrn.h"
+#include "libs/log.h"
+#include "libs/misc.h"
+
+#ifdef MEM_USE_POOLS
+
+// Number of objects moved between a thread and the central list at once.
+#define MEM_BATCH_SIZE 32
+// Size of the blocks that objects are carved from.
+#define MEM_SLAB_SIZE 0x4000
+
+typedef struct mem_FreeObject mem_FreeObject;
+struct mem_FreeObject
+{
+	mem_FreeObject *next;
+			// Next object in a thread's free list, or in a batch.
+	mem_FreeObject *nextBatch;
+			// Only used in the first object of a batch in the
+			// central list.
+};
+
+typedef struct
+{
+	mem_FreeObject *head;
+	size_t count;
+	// Counts which have not been added to the central statistics yet.
+	uint64 allocs;
+	uint64 frees;
+} mem_ThreadCache;
+
+typedef struct
+{
+	mem_FreeObject *batches;
+	uint64 allocs;
+	uint64 frees;
+	uint64 slabBytes;
+} mem_SizeClass;
+
+static MEM_THREAD_LOCAL mem_ThreadCache threadCaches[MEM_NUM_CLASSES];
+static mem_SizeClass sizeClasses[MEM_NUM_CLASSES];
+
+
+static void
+flushStats (mem_SizeClass *sc, mem_ThreadCache *cache)
+{
+	MEM_ADD_COUNT (&sc->allocs, cache->allocs);
+	MEM_ADD_COUNT (&sc->frees, cache->frees);
+	cache->allocs = 0;
+	cache->frees = 0;
+}
+
+// Push a list of batches onto the central list.
+static void
+pushBatches (mem_SizeClass *sc, mem_FreeObject *first, mem_FreeObject *last)
+{
+	mem_FreeObject *oldHead = MEM_LOAD_PTR (&sc->batches);
+	do
+	{
+		last->nextBatch = oldHead;
+	} while (!MEM_CAS_PTR (&sc->batches, oldHead, first));
+}
+
+// Carve a new slab into objects. The first batch goes to the calling
+// thread, the rest to the central list.
+static void
+carveSlab (int sizeClass, mem_ThreadCache *cache)
+{
+	mem_SizeClass *sc = &sizeClasses[sizeClass];
+	size_t objSize = mem_classSize (sizeClass);
+	size_t numObjs = MEM_SLAB_SIZE / objSize;
+	char *slab;
+	mem_FreeObject *firstBatch = NULL;
+	mem_FreeObject *lastBatch = NULL;
+	size_t i;
+
+	slab = malloc (MEM_SLAB_SIZE);
+	if (slab == NULL)
+	{
+		log_add (log_Fatal, "HMalloc() FATAL: out of memory.");
+		fflush (stderr);
+		explode ();
+	}
+	MEM_ADD_COUNT (&sc->slabBytes, MEM_SLAB_SIZE);
+
+	for (i = 0; i < numObjs; i += MEM_BATCH_SIZE)
+	{
+		size_t batchEnd = i + MEM_BATCH_SIZE;
+		size_t j;
+		mem_FreeObject *batch = (mem_FreeObject *) (slab + i * objSize);
+
+		if (batchEnd > numObjs)
+			batchEnd = numObjs;
+		for (j = i; j < batchEnd; j++)
+		{
+			mem_FreeObject *obj = (mem_FreeObject *) (slab + j * objSize);
+			obj->next = (j + 1 < batchEnd) ?
+					(mem_FreeObject *) (slab + (j + 1) * objSize) : NULL;
+		}
+
+		if (i == 0)
+		{
+			cache->head = batch;
+			cache->count = batchEnd;
+			continue;
+		}
+		batch->nextBatch = NULL;
+		if (lastBatch == NULL)
+			firstBatch = batch;
+		else
+			lastBatch->nextBatch = batch;
+		lastBatch = batch;
+	}
+
+	if (firstBatch != NULL)
+		pushBatches (sc, firstBatch, lastBatch);
+}
+
+static void
+refill (int sizeClass, mem_ThreadCache *cache)
+{
+	mem_SizeClass *sc = &sizeClasses[sizeClass];
+	mem_FreeObject *batches;
+	mem_FreeObject *obj;
+
+	flushStats (sc, cache);
+
+	batches = MEM_XCHG_PTR (&sc->batches, NULL);
+	if (batches == NULL)
+	{
+		carveSlab (sizeClass, cache);
+		return;
+	}
+
+	if (batches->nextBatch != NULL)
+	{
+		mem_FreeObject *last = batches->nextBatch;
+		while (last->nextBatch != NULL)
+			last = last->nextBatch;
+		pushBatches (sc, batches->nextBatch, last);
+	}
+
+	cache->head = batches;
+	cache->count = 0;
+	for (obj = batches; obj != NULL; obj = obj->next)
+		cache->count++;
+}
+
+// Hand a batch of objects from the thread's list to the central list.
+static void
+spill (int sizeClass, mem_ThreadCache *cache)
+{
+	mem_SizeClass *sc = &sizeClasses[sizeClass];
+	mem_FreeObject *first = cache->head;
+	mem_FreeObject *last = first;
+	size_t i;
+
+	flushStats (sc, cache);
+
+	for (i = 1; i < MEM_BATCH_SIZE && last->next != NULL; i++)
+		last = last->next;
+	cache->head = last->next;
+	cache->count -= i;
+	last->next = NULL;
+	first->nextBatch = NULL;
+	pushBatches (sc, first, first);
+}
+
+void *
+mem_poolAlloc (int sizeClass)
+{
+	mem_ThreadCache *cache = &threadCaches[sizeClass];
+	mem_FreeObject *obj;
+
+	if (cache->head == NULL)
+		refill (sizeClass, cache);
+
+	obj = cache->head;
+	cache->head = obj->next;
+	cache->count--;
+	cache->allocs++;
+	return obj;
+}
+
+void
+mem_poolFree (int sizeClass, void *p)
+{
+	mem_ThreadCache *cache = &threadCaches[sizeClass];
+	mem_FreeObject *obj = (mem_FreeObject *) p;
+
+	obj->next = cache->head;
+	cache->head = obj;
+	cache->count++;
+	cache->frees++;
+
+	if (cache->count >= 2 * MEM_BATCH_SIZE)
+		spill (sizeClass, cache);
+}
+
+#endif  /* MEM_USE_POOLS */
+
+void *
+HMallocObject (size_t size)
+{
+#ifdef MEM_USE_POOLS
+	if (size > 0 && size <= MEM_MAX_POOLED_SIZE)
+	{
+		void *p = mem_poolAlloc (mem_sizeClass (size));
+		if (mem_tracing)
+			mem_traceAlloc (p, size);
+		return p;
+	}
+#endif
+	return HMalloc (size);
+}
+
+void
+HFreeObject (void *p, size_t size)
+{
+	if (p == NULL)
+		return;
+#ifdef MEM_USE_POOLS
+	if (size > 0 && size <= MEM_MAX_POOLED_SIZE)
+	{
+		if (mem_tracing)
+			mem_traceFree (p);
+		mem_poolFree (mem_sizeClass (size), p);
+		return;
+	}
+#endif
+	HFree (p);
+}
+
+// Return all objects in the calling thread's lists to the central lists.
+// Called when a thread ends, so that its objects are not lost.
+void
+mem_threadCleanup (void)
+{
+#ifdef MEM_USE_POOLS
+	int sizeClass;
+
+	for (sizeClass = 0; sizeClass < MEM_NUM_CLASSES; sizeClass++)
+	{
+		mem_ThreadCache *cache = &threadCaches[sizeClass];
+
+		while (cache->head != NULL)
+			spill (sizeClass, cache);
+		flushStats (&sizeClasses[sizeClass], cache);
+	}
+#endif
+}
+
+int
+mem_getPoolStats (mem_PoolStats *stats, int maxStats)
+{
+#ifdef MEM_USE_POOLS
+	int sizeClass;
+
+	for (sizeClass = 0; sizeClass < MEM_NUM_CLASSES; sizeClass++)
+		flushStats (&sizeClasses[sizeClass], &threadCaches[sizeClass]);
+
+	for (sizeClass = 0; sizeClass < MEM_NUM_CLASSES &&
+			sizeClass < maxStats; sizeClass++)
+	{
+		const mem_SizeClass *sc = &sizeClasses[sizeClass];
+
+		stats[sizeClass].objectSize = mem_classSize (sizeClass);
+		stats[sizeClass].allocs = sc->allocs;
+		stats[sizeClass].frees = sc->frees;
+		stats[sizeClass].slabBytes = sc->slabBytes;
+	}
+	return MEM_NUM_CLASSES;
+#else
+	(void) stats;
+	(void) maxStats;
+	return 0;
+#endif
+}
@@ -21,40 +21,111 @@
 #include <stdarg.h>
 #include <string.h>
 #include "libs/memlib.h"
+#include "memintrn.h"
 #include "libs/log.h"
 #include "libs/misc.h"
 
+// Small allocations are served from the size-class pools in pool.c.
+// HMalloc() puts a mem_Header in front of every allocation, so that
+// HFree() and HRealloc() know where the memory came from.
+
+
+static void
+logPoolStats (void)
+{
+	mem_PoolStats stats[MEM_NUM_CLASSES];
+	int numStats;
+	int i;
+
+	numStats = mem_getPoolStats (stats, MEM_NUM_CLASSES);
+	if (numStats == 0)
+		return;
+
+	log_add (log_Debug, "Memory pool statistics:");
+	for (i = 0; i < numStats; i++)
+	{
+		if (stats[i].allocs == 0)
+			continue;
+		log_add (log_Debug, "    %3lu bytes: %10lu allocs, %10lu frees, "
+				"%7lu KiB in slabs", (unsigned long) stats[i].objectSize,
+				(unsigned long) stats[i].allocs,
+				(unsigned long) stats[i].frees,
+				(unsigned long) (stats[i].slabBytes / 1024));
+	}
+}
 
 bool
 mem_init (void)
-{	// This is a stub
+{
+	const char *traceFile = getenv ("UQM_MEMTRACE");
+	if (traceFile != NULL)
+		mem_startTrace (traceFile);
 	return true;
 }
 
 bool
 mem_uninit (void)
-{	// This is a stub
+{
+	mem_stopTrace ();
+	logPoolStats ();
 	return true;
 }
 
+static void
+outOfMemory (const char *funcName)
+{
+	log_add (log_Fatal, "%s FATAL: out of memory.", funcName);
+	fflush (stderr);
+	explode ();
+}
+
 void *
 HMalloc (size_t size)
 {
-	void *p = malloc (size);
-	if (p == NULL && size > 0)
+	mem_Header *header;
+	size_t totalSize = size + sizeof (mem_Header);
+
+#ifdef MEM_USE_POOLS
+	if (totalSize <= MEM_MAX_POOLED_SIZE)
 	{
-		log_add (log_Fatal, "HMalloc() FATAL: out of memory.");
-		fflush (stderr);
-		explode ();
+		int sizeClass = mem_sizeClass (totalSize);
+		header = mem_poolAlloc (sizeClass);
+		header->sizeClass = sizeClass + 1;
+	}
+	else
+#endif
+	{
+		header = malloc (totalSize);
+		if (header == NULL)
+			outOfMemory ("HMalloc()");
+		header->sizeClass = 0;
 	}
 
-	return p;
+	if (mem_tracing)
+		mem_traceAlloc (header + 1, size);
+	return header + 1;
 }
 
 void
 HFree (void *p)
 {
-	free (p);
+	mem_Header *header;
+
+	if (p == NULL)
+		return;
+
+	if (mem_tracing)
+		mem_traceFree (p);
+
+	header = (mem_Header *) p - 1;
+#ifdef MEM_USE_POOLS
+	if (header->sizeClass != 0)
+	{
+		mem_poolFree ((int) header->sizeClass - 1, header);
+		return;
+	}
+#endif
+	free (header);
 }
 
 void *
@@ -71,14 +142,41 @@ HCalloc (size_t size)
 void *
 HRealloc (void *p, size_t size)
 {
-	p = realloc (p, size);
-	if (p == NULL && size > 0)
+	mem_Header *header;
+	void *newP;
+
+	if (p == NULL)
+		return HMalloc (size);
+
+	header = (mem_Header *) p - 1;
+#ifdef MEM_USE_POOLS
+	if (header->sizeClass != 0)
 	{
-		log_add (log_Fatal, "HRealloc() FATAL: out of memory.");
-		fflush (stderr);
-		explode ();
+		int sizeClass = (int) header->sizeClass - 1;
+		size_t oldSize = mem_classSize (sizeClass) - sizeof (mem_Header);
+
+		if (mem_sizeClass (size + sizeof (mem_Header)) == sizeClass)
+		{
+			// Still the same size class.
+			if (mem_tracing)
+				mem_traceRealloc (p, p, size);
+			return p;
+		}
+
+		// HMalloc() and HFree() do their own tracing.
+		newP = HMalloc (size);
+		memcpy (newP, p, size < oldSize ? size : oldSize);
+		HFree (p);
+		return newP;
 	}
+#endif
 
-	return p;
+	header = realloc (header, size + sizeof (mem_Header));
+	if (header == NULL)
+		outOfMemory ("HRealloc()");
+	newP = header + 1;
+	if (mem_tracing)
+		mem_traceRealloc (p, newP, size);
+	return newP;
 }
 
@@ -89,6 +89,24 @@ static SAMPLE **md_sample = NULL;
 /* Previous driver in use */
 static SWORD olddevice = -1;
 
+/* UQM addition: the state which belongs to the module being played. The
+   state of the selected context lives in the globals above, the mixer and
+   the player; it is only stored in the context while another one is
+   selected. */
+struct MikMod_Context {
+	BOOL isplaying;
+	UBYTE numchn, sngchn, sfxchn, hardchn, softchn;
+	UWORD bpm;
+	SAMPLE **sample;
+	UBYTE *sfxinfo;
+	int sfxpool;
+	MODULE *pf;
+	VIRTCH_STATE vc;
+};
+
+static MikMod_Context default_context;
+static MikMod_Context *md_context = &default_context;
+
 /* Limits the number of hardware voices to the specified amount.
    This function should only be used by the low-level drivers. */
 static	void LimitHardVoices(int limit)
@@ -589,6 +607,8 @@ void MikMod_Exit_internal(void)
 	MikMod_free(md_sample);
 	md_sample  = NULL;
 	sfxinfo    = NULL;
+	/* the mixer state of the selected context is gone with the driver */
+	memset(&md_context->vc, 0, sizeof(md_context->vc));
 
 	initialized = 0;
 }
@@ -885,6 +905,102 @@ MIKMODAPI void MikMod_Lock(void)
 	MUTEX_LOCK(lists);
 }
 
+/*========== Contexts */
+
+/* The state of the software mixer can only be switched if it is in use */
+static BOOL SoftMixerActive(void)
+{
+	return initialized && md_driver->PlayStart == VC_PlayStart;
+}
+
+static void SaveContext(MikMod_Context *ctx)
+{
+	ctx->isplaying = isplaying;
+	ctx->numchn    = md_numchn;
+	ctx->sngchn    = md_sngchn;
+	ctx->sfxchn    = md_sfxchn;
+	ctx->hardchn   = md_hardchn;
+	ctx->softchn   = md_softchn;
+	ctx->bpm       = md_bpm;
+	ctx->sample    = md_sample;
+	ctx->sfxinfo   = sfxinfo;
+	ctx->sfxpool   = sfxpool;
+	ctx->pf        = pf;
+	if (SoftMixerActive()) VC_SaveState(&ctx->vc);
+}
+
+static void LoadContext(const MikMod_Context *ctx)
+{
+	isplaying  = ctx->isplaying;
+	md_numchn  = ctx->numchn;
+	md_sngchn  = ctx->sngchn;
+	md_sfxchn  = ctx->sfxchn;
+	md_hardchn = ctx->hardchn;
+	md_softchn = ctx->softchn;
+	md_bpm     = ctx->bpm;
+	md_sample  = ctx->sample;
+	sfxinfo    = ctx->sfxinfo;
+	sfxpool    = ctx->sfxpool;
+	pf         = ctx->pf;
+	if (SoftMixerActive()) VC_LoadState(&ctx->vc);
+}
+
+static void MikMod_SelectContext_internal(MikMod_Context *ctx)
+{
+	if (!ctx) ctx = &default_context;
+	if (ctx == md_context) return;
+
+	SaveContext(md_context);
+	LoadContext(ctx);
+	md_context = ctx;
+}
+
+MIKMODAPI MikMod_Context *MikMod_NewContext(void)
+{
+	MikMod_Context *ctx;
+
+	if (!(ctx = (MikMod_Context *)MikMod_calloc(1, sizeof(MikMod_Context))))
+		return NULL;
+	ctx->bpm = 125;
+	return ctx;
+}
+
+MIKMODAPI void MikMod_SelectContext(MikMod_Context *ctx)
+{
+	MUTEX_LOCK(vars);
+	MikMod_SelectContext_internal(ctx);
+	MUTEX_UNLOCK(vars);
+}
+
+/* Stops the module of the context, if any, but does not free it */
+MIKMODAPI void MikMod_FreeContext(MikMod_Context *ctx)
+{
+	MikMod_Context *prev;
+	int t;
+
+	if (!ctx || ctx == &default_context) return;
+
+	MUTEX_LOCK(vars);
+	prev = (ctx == md_context) ? &default_context : md_context;
+	MikMod_SelectContext_internal(ctx);
+	Player_Stop_internal();
+	MikMod_DisableOutput_internal();
+	MikMod_free(sfxinfo);
+	MikMod_free(md_sample);
+	md_sample = NULL;
+	sfxinfo   = NULL;
+	/* this stores the mixer state of 'ctx' in 'ctx', for freeing below */
+	MikMod_SelectContext_internal(prev);
+	MUTEX_UNLOCK(vars);
+
+	MikMod_free(ctx->vc.vinf);
+	for (t = 0; t < 8; t++) {
+		MikMod_free(ctx->vc.RVbufL[t]);
+		MikMod_free(ctx->vc.RVbufR[t]);
+	}
+	MikMod_free(ctx);
+}
+
 /*========== Parameter extraction helper */
 
 CHAR *MD_GetAtom(const CHAR *atomname, const CHAR *cmdline, BOOL implicit)
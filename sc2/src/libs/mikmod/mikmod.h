@@ -302,6 +302,16 @@ MIKMODAPI extern BOOL   MikMod_InitThreads(void);
 MIKMODAPI extern void   MikMod_Lock(void);
 MIKMODAPI extern void   MikMod_Unlock(void);
 
+/* UQM addition: a context holds the state of the player and the software
+   mixer, so that several modules can be played at the same time, each in a
+   context of its own. The functions above work on the selected context.
+   NULL stands for the default context, which is selected initially. */
+typedef struct MikMod_Context MikMod_Context;
+
+MIKMODAPI extern MikMod_Context* MikMod_NewContext(void);
+MIKMODAPI extern void   MikMod_FreeContext(MikMod_Context*);
+MIKMODAPI extern void   MikMod_SelectContext(MikMod_Context*);
+
 MIKMODAPI extern void*  MikMod_malloc(size_t);
 MIKMODAPI extern void*  MikMod_calloc(size_t,size_t);
 MIKMODAPI extern void*  MikMod_realloc(void*,size_t);
@@ -678,6 +678,21 @@ extern void VC_SetupPointers(void);
 extern int  VC1_Init(void);
 extern int  VC2_Init(void);
 
+/* The part of the state of the software mixer which belongs to what is
+   being played, as opposed to the loaded samples and the settings. */
+typedef struct VIRTCH_STATE {
+	void  *vinf;                 /* the VINFO of the mixer in use */
+	int    softchn;
+	long   tickleft, samplesthatfit;
+	int    RVc[8];
+	ULONG  RVRindex;
+	SLONG *RVbufL[8], *RVbufR[8];
+	int    nLeftNR, nRightNR;
+} VIRTCH_STATE;
+
+extern void VC_SaveState(VIRTCH_STATE*);
+extern void VC_LoadState(const VIRTCH_STATE*);
+
 #if (MIKMOD_UNIX)
 /* POSIX helper functions */
 extern BOOL MD_Access(const CHAR *);
@@ -1144,6 +1144,8 @@ static void AddChannel(SLONG* ptr,NATIVE todo)
 #define VC1_VoiceStopped VC_VoiceStopped
 #define VC1_WriteBytes VC_WriteBytes
 #define VC1_WriteSamples VC_WriteSamples
+#define VC1_SaveState VC_SaveState
+#define VC1_LoadState VC_LoadState
 #endif
 
 #define _IN_VIRTCH_
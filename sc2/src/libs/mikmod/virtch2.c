@@ -1147,6 +1147,8 @@ static void AddChannel(SLONG* ptr,NATIVE todo)
 #define VC1_SampleSpace       VC2_SampleSpace
 #define VC1_SampleLength      VC2_SampleLength
 #define VC1_VoiceRealVolume   VC2_VoiceRealVolume
+#define VC1_SaveState         VC2_SaveState
+#define VC1_LoadState         VC2_LoadState
 
 #include "virtch_common.c"
 #undef _IN_VIRTCH_
@@ -69,6 +69,10 @@ extern ULONG VC1_SampleLength(int,SAMPLE*);
 extern ULONG VC2_SampleLength(int,SAMPLE*);
 extern ULONG VC1_VoiceRealVolume(UBYTE);
 extern ULONG VC2_VoiceRealVolume(UBYTE);
+extern void  VC1_SaveState(VIRTCH_STATE*);
+extern void  VC2_SaveState(VIRTCH_STATE*);
+extern void  VC1_LoadState(const VIRTCH_STATE*);
+extern void  VC2_LoadState(const VIRTCH_STATE*);
 #endif
 
 
@@ -108,6 +112,8 @@ static void (*VC_VoiceStop_ptr)(UBYTE);
 static BOOL (*VC_VoiceStopped_ptr)(UBYTE);
 static SLONG (*VC_VoiceGetPosition_ptr)(UBYTE);
 static ULONG (*VC_VoiceRealVolume_ptr)(UBYTE);
+static void (*VC_SaveState_ptr)(VIRTCH_STATE*);
+static void (*VC_LoadState_ptr)(const VIRTCH_STATE*);
 
 #if defined __STDC__ || defined _MSC_VER || defined MPW_C
 #define VC_PROC0(suffix) \
@@ -175,6 +181,8 @@ VC_PROC1(VoiceStop,UBYTE)
 VC_FUNC1(VoiceStopped,BOOL,UBYTE)
 VC_FUNC1(VoiceGetPosition,SLONG,UBYTE)
 VC_FUNC1(VoiceRealVolume,ULONG,UBYTE)
+VC_PROC1(SaveState,VIRTCH_STATE*)
+VC_PROC1(LoadState,const VIRTCH_STATE*)
 
 void VC_SetupPointers(void)
 {
@@ -201,6 +209,8 @@ void VC_SetupPointers(void)
 		VC_VoiceStopped_ptr=VC2_VoiceStopped;
 		VC_VoiceGetPosition_ptr=VC2_VoiceGetPosition;
 		VC_VoiceRealVolume_ptr=VC2_VoiceRealVolume;
+		VC_SaveState_ptr=VC2_SaveState;
+		VC_LoadState_ptr=VC2_LoadState;
 	} else {
 		VC_Init_ptr=VC1_Init;
 		VC_Exit_ptr=VC1_Exit;
@@ -224,6 +234,8 @@ void VC_SetupPointers(void)
 		VC_VoiceStopped_ptr=VC1_VoiceStopped;
 		VC_VoiceGetPosition_ptr=VC1_VoiceGetPosition;
 		VC_VoiceRealVolume_ptr=VC1_VoiceRealVolume;
+		VC_SaveState_ptr=VC1_SaveState;
+		VC_LoadState_ptr=VC1_LoadState;
 	}
 }
 #endif/* !NO_HQMIXER */
@@ -468,6 +480,55 @@ ULONG VC1_VoiceRealVolume(UBYTE voice)
 	return abs(k-j);
 }
 
+/* Save the state of what is being played into 'state'. Used with
+   VC1_LoadState() to switch between MikMod contexts. */
+void VC1_SaveState(VIRTCH_STATE* state)
+{
+	state->vinf           = vinf;
+	state->softchn        = vc_softchn;
+	state->tickleft       = tickleft;
+	state->samplesthatfit = samplesthatfit;
+	state->RVc[0] = RVc1; state->RVc[1] = RVc2;
+	state->RVc[2] = RVc3; state->RVc[3] = RVc4;
+	state->RVc[4] = RVc5; state->RVc[5] = RVc6;
+	state->RVc[6] = RVc7; state->RVc[7] = RVc8;
+	state->RVRindex       = RVRindex;
+	state->RVbufL[0] = RVbufL1; state->RVbufL[1] = RVbufL2;
+	state->RVbufL[2] = RVbufL3; state->RVbufL[3] = RVbufL4;
+	state->RVbufL[4] = RVbufL5; state->RVbufL[5] = RVbufL6;
+	state->RVbufL[6] = RVbufL7; state->RVbufL[7] = RVbufL8;
+	state->RVbufR[0] = RVbufR1; state->RVbufR[1] = RVbufR2;
+	state->RVbufR[2] = RVbufR3; state->RVbufR[3] = RVbufR4;
+	state->RVbufR[4] = RVbufR5; state->RVbufR[5] = RVbufR6;
+	state->RVbufR[6] = RVbufR7; state->RVbufR[7] = RVbufR8;
+	state->nLeftNR        = nLeftNR;
+	state->nRightNR       = nRightNR;
+}
+
+/* Make the state saved in 'state' the one that is played. */
+void VC1_LoadState(const VIRTCH_STATE* state)
+{
+	vinf           = (VINFO*)state->vinf;
+	vc_softchn     = state->softchn;
+	tickleft       = state->tickleft;
+	samplesthatfit = state->samplesthatfit;
+	RVc1 = state->RVc[0]; RVc2 = state->RVc[1];
+	RVc3 = state->RVc[2]; RVc4 = state->RVc[3];
+	RVc5 = state->RVc[4]; RVc6 = state->RVc[5];
+	RVc7 = state->RVc[6]; RVc8 = state->RVc[7];
+	RVRindex       = state->RVRindex;
+	RVbufL1 = state->RVbufL[0]; RVbufL2 = state->RVbufL[1];
+	RVbufL3 = state->RVbufL[2]; RVbufL4 = state->RVbufL[3];
+	RVbufL5 = state->RVbufL[4]; RVbufL6 = state->RVbufL[5];
+	RVbufL7 = state->RVbufL[6]; RVbufL8 = state->RVbufL[7];
+	RVbufR1 = state->RVbufR[0]; RVbufR2 = state->RVbufR[1];
+	RVbufR3 = state->RVbufR[2]; RVbufR4 = state->RVbufR[3];
+	RVbufR5 = state->RVbufR[4]; RVbufR6 = state->RVbufR[5];
+	RVbufR7 = state->RVbufR[6]; RVbufR8 = state->RVbufR[7];
+	nLeftNR        = state->nLeftNR;
+	nRightNR       = state->nRightNR;
+}
+
 #endif /* _VIRTCH_COMMON_ */
 
 #endif /* _IN_VIRTCH_ */
@@ -16,18 +16,24 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+// NetManager using poll(). Unlike select(), poll() does not limit the
+// values of the file descriptors, and its cost does not depend on them.
+// On Linux, netmanager_epoll.c is used instead.
+
+#define NETMANAGER_INTERNAL
 #define SOCKET_INTERNAL
 #define NETDESCRIPTOR_INTERNAL
 #include "netmanager_bsd.h"
 #include "ndesc.h"
 #include "../socket/socket.h"
 
-#include "ndesc.h"
 #include "types.h"
 #include "libs/log.h"
+#include "libs/timelib.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <poll.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -35,92 +41,192 @@
 #include "ndindex.ci"
 
 
-// INV: The following sets only contain sockets present in the netDescriptor
-// array.
-static fd_set readSet;
-static fd_set writeSet;
-static fd_set exceptionSet;
+// The elements of the following arrays with the same index belong to
+// eachother. There is one for each registered NetDescriptor. Entries of
+// descriptors which currently do not wait for anything have fd set to -1,
+// which makes poll() ignore them.
+// INV: for all i < numPollFds: pollNDs[i]->smd->index == i
+static struct pollfd *pollFds;
+static NetDescriptor **pollNDs;
+static size_t numPollFds;
+static size_t pollFdsSize;
+
+// NetManager_process() polls on a copy of pollFds, as callbacks may
+// add and remove descriptors. readyGens[i] is the generation of the
+// descriptor of readyFds[i].
+static struct pollfd *readyFds;
+static uint32 *readyGens;
+static size_t readyFdsSize;
 
 
 void
 NetManager_init(void) {
 	NDIndex_init();
 
-	FD_ZERO(&readSet);
-	FD_ZERO(&writeSet);
-	FD_ZERO(&exceptionSet);
+	pollFds = NULL;
+	pollNDs = NULL;
+	numPollFds = 0;
+	pollFdsSize = 0;
+	readyFds = NULL;
+	readyGens = NULL;
+	readyFdsSize = 0;
 }
 
 void
 NetManager_uninit(void) {
+	assert(numPollFds == 0);
+
+	free(pollFds);
+	pollFds = NULL;
+	free(pollNDs);
+	pollNDs = NULL;
+	pollFdsSize = 0;
+	free(readyFds);
+	readyFds = NULL;
+	free(readyGens);
+	readyGens = NULL;
+	readyFdsSize = 0;
+
 	NDIndex_uninit();
 }
 
+static inline SocketManagementDataBsd *
+SocketManagementData_alloc(void) {
+	return malloc(sizeof (SocketManagementDataBsd));
+}
+
+static inline void
+SocketManagementData_free(SocketManagementDataBsd *smd) {
+	free(smd);
+}
+
+static void
+updatePollFd(NetDescriptor *nd) {
+	struct pollfd *pfd = &pollFds[nd->smd->index];
+
+	pfd->events = (short) nd->smd->events;
+	pfd->fd = (nd->smd->events != 0) ? nd->socket->fd : -1;
+}
+
 // Register the NetDescriptor with the NetManager.
 int
 NetManager_addDesc(NetDescriptor *nd) {
-	int fd;
 	assert(nd->socket != Socket_noSocket);
 	assert(!NDIndex_socketRegistered(nd->socket));
 
+	if (numPollFds == pollFdsSize) {
+		size_t newSize = pollFdsSize == 0 ? 16 : pollFdsSize * 2;
+		struct pollfd *newFds;
+		NetDescriptor **newNDs;
+
+		newFds = realloc(pollFds, newSize * sizeof (struct pollfd));
+		if (newFds == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		pollFds = newFds;
+		newNDs = realloc(pollNDs, newSize * sizeof (NetDescriptor *));
+		if (newNDs == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		pollNDs = newNDs;
+		pollFdsSize = newSize;
+	}
+
+	nd->smd = SocketManagementData_alloc();
+	if (nd->smd == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
 	if (NDIndex_registerNDWithSocket(nd->socket, nd) == -1) {
 		// errno is set
+		int savedErrno = errno;
+		SocketManagementData_free(nd->smd);
+		nd->smd = NULL;
+		errno = savedErrno;
 		return -1;
 	}
 
-	fd = nd->socket->fd;
+	nd->smd->index = numPollFds;
+	nd->smd->events = 0;
+	nd->smd->generation = NetManager_newGeneration();
 	if (nd->readCallback != NULL)
-		FD_SET(fd, &readSet);
+		nd->smd->events |= POLLIN;
 	if (nd->writeCallback != NULL)
-		FD_SET(fd, &writeSet);
+		nd->smd->events |= POLLOUT;
 	if (nd->exceptionCallback != NULL)
-		FD_SET(fd, &exceptionSet);
+		nd->smd->events |= POLLPRI;
+	pollFds[numPollFds].revents = 0;
+	pollNDs[numPollFds] = nd;
+	numPollFds++;
+	updatePollFd(nd);
 	return 0;
 }
 
 void
 NetManager_removeDesc(NetDescriptor *nd) {
-	int fd;
+	size_t index;
 	
 	assert(nd->socket != Socket_noSocket);
 	assert(NDIndex_getNDForSocket(nd->socket) == nd);
 
-	fd = nd->socket->fd;
-	FD_CLR(fd, &readSet);
-	FD_CLR(fd, &writeSet);
-	FD_CLR(fd, &exceptionSet);
+	// Move the last entry into the freed position.
+	index = nd->smd->index;
+	numPollFds--;
+	if (index != numPollFds) {
+		pollFds[index] = pollFds[numPollFds];
+		pollNDs[index] = pollNDs[numPollFds];
+		pollNDs[index]->smd->index = index;
+	}
 
 	NDIndex_unregisterNDForSocket(nd->socket);
+
+	SocketManagementData_free(nd->smd);
+	nd->smd = NULL;
+}
+
+static inline void
+activateEvents(NetDescriptor *nd, uint32 events) {
+	nd->smd->events |= events;
+	updatePollFd(nd);
+}
+
+static inline void
+deactivateEvents(NetDescriptor *nd, uint32 events) {
+	nd->smd->events &= ~events;
+	updatePollFd(nd);
 }
 
 void
 NetManager_activateReadCallback(NetDescriptor *nd) {
-	FD_SET(nd->socket->fd, &readSet);
+	activateEvents(nd, POLLIN);
 }
 
 void
 NetManager_deactivateReadCallback(NetDescriptor *nd) {
-	FD_CLR(nd->socket->fd, &readSet);
+	deactivateEvents(nd, POLLIN);
 }
 
 void
 NetManager_activateWriteCallback(NetDescriptor *nd) {
-	FD_SET(nd->socket->fd, &writeSet);
+	activateEvents(nd, POLLOUT);
 }
 
 void
 NetManager_deactivateWriteCallback(NetDescriptor *nd) {
-	FD_CLR(nd->socket->fd, &writeSet);
+	deactivateEvents(nd, POLLOUT);
 }
 
 void
 NetManager_activateExceptionCallback(NetDescriptor *nd) {
-	FD_SET(nd->socket->fd, &exceptionSet);
+	activateEvents(nd, POLLPRI);
 }
 
 void
 NetManager_deactivateExceptionCallback(NetDescriptor *nd) {
-	FD_CLR(nd->socket->fd, &exceptionSet);
+	deactivateEvents(nd, POLLPRI);
 }
 
 // This function may be called again from inside a callback function
@@ -129,95 +235,75 @@ NetManager_deactivateExceptionCallback(NetDescriptor *nd) {
 // This function should however not be called from multiple threads at once.
 int
 NetManager_process(uint32 *timeoutMs) {
-	struct timeval timeout;
+	uint64 deadline;
+	size_t numFds;
 	size_t i;
-	int selectResult;
-	fd_set newReadSet;
-	fd_set newWriteSet;
-	fd_set newExceptionSet;
-	bool bitSet;
+	int pollResult;
+
+	deadline = NetManager_getDeadline(*timeoutMs);
 
-	timeout.tv_sec = *timeoutMs / 1000;
-	timeout.tv_usec = (*timeoutMs % 1000) * 1000;
+	numFds = numPollFds;
+	if (numFds > readyFdsSize) {
+		struct pollfd *newFds;
+		uint32 *newGens;
 
-	// Structure assignment:
-	newReadSet = readSet;
-	newWriteSet = writeSet;
-	newExceptionSet = exceptionSet;
+		newFds = realloc(readyFds, numFds * sizeof (struct pollfd));
+		if (newFds == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		readyFds = newFds;
+		newGens = realloc(readyGens, numFds * sizeof (uint32));
+		if (newGens == NULL) {
+			errno = ENOMEM;
+			return -1;
+		}
+		readyGens = newGens;
+		readyFdsSize = numFds;
+	}
+	if (numFds > 0)
+		memcpy(readyFds, pollFds, numFds * sizeof (struct pollfd));
+	for (i = 0; i < numFds; i++)
+		readyGens[i] = pollNDs[i]->smd->generation;
 
 	do {
-		selectResult = select(NDIndex_getSelectNumND(),
-				&newReadSet, &newWriteSet, &newExceptionSet, &timeout);
-		// BUG: If select() is restarted because of EINTR, the timeout
-		//      may start over. (Linux changes 'timeout' to the time left,
-		//      but most other platforms don't.)
-	} while (selectResult == -1 && errno == EINTR);
-	if (selectResult == -1) {
+		pollResult = poll(readyFds, (nfds_t) numFds,
+				(int) NetManager_msUntil(deadline, true));
+	} while (pollResult == -1 && errno == EINTR);
+	if (pollResult == -1) {
 		int savedErrno = errno;
-		log_add(log_Error, "select() failed: %s.", strerror(errno));
+		log_add(log_Error, "poll() failed: %s.", strerror(errno));
+		*timeoutMs = NetManager_msUntil(deadline, false);
 		errno = savedErrno;
-		*timeoutMs = (timeout.tv_sec * 1000) + (timeout.tv_usec / 1000);
-				// XXX: rounding microseconds down. Is that the correct
-				// thing to do?
 		return -1;
 	}
 
-	for (i = 0; i < maxND; i++) {
+	for (i = 0; i < numFds && pollResult > 0; i++) {
+		struct pollfd *pfd = &readyFds[i];
 		NetDescriptor *nd;
-	
-		if (selectResult == 0) {
-			// No more bits set in the fd_sets
-			break;
-		}
+		short revents = pfd->revents;
 
-		nd = NDIndex_getNDForSocketFd(i);
-		if (nd == NULL)
+		if (revents == 0)
 			continue;
+		pollResult--;
 
-		bitSet = false;
-				// Is one of the bits in the fd_sets set?
-		
 		// A callback may cause a NetDescriptor to be closed. The deletion
 		// of the structure will be scheduled, but will still be
-		// available at least until this function returns.
-
-		if (FD_ISSET(i, &newExceptionSet))
-		{
-			bool closed;
-			bitSet = true;			
-			closed = NetManager_doExceptionCallback(nd);
-			if (closed)
-				goto next;
-		}
-
-		if (FD_ISSET(i, &newWriteSet))
-		{
-			bool closed;
-			bitSet = true;			
-			closed = NetManager_doWriteCallback(nd);
-			if (closed)
-				goto next;
-		}
-
-		if (FD_ISSET(i, &newReadSet))
-		{
-			bool closed;
-			bitSet = true;			
-			closed = NetManager_doReadCallback(nd);
-			if (closed)
-				goto next;
-		}
+		// available at least until this function returns. A closed
+		// NetDescriptor is no longer found in the index.
+		nd = NDIndex_getNDForSocketFd(pfd->fd);
+		if (nd == NULL || nd->smd->generation != readyGens[i])
+			continue;
 
-next:
-		if (bitSet)
-			selectResult--;
+		// select() reports errors and hangups as the descriptor being
+		// readable and writable; the callbacks expect the same.
+		NetManager_dispatch(nd,
+				(revents & (POLLIN | POLLERR | POLLHUP)) != 0,
+				(revents & (POLLOUT | POLLERR | POLLHUP)) != 0,
+				(revents & POLLPRI) != 0);
 	}
 
-	*timeoutMs = (timeout.tv_sec * 1000) + (timeout.tv_usec / 1000);
-			// XXX: rounding microseconds down. Is that the correct
-			// thing to do?
+	*timeoutMs = NetManager_msUntil(deadline, false);
 	return 0;
 }
 
-
-
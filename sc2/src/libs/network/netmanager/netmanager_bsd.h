@@ -19,8 +19,25 @@
 #ifndef LIBS_NETWORK_NETMANAGER_NETMANAGER_BSD_H_
 #define LIBS_NETWORK_NETMANAGER_NETMANAGER_BSD_H_
 
+#include "types.h"
+
+#include <stddef.h>
+
 typedef struct SocketManagementDataBsd SocketManagementDataBsd;
 typedef SocketManagementDataBsd SocketManagementData;
 
+#ifdef NETMANAGER_INTERNAL
+struct SocketManagementDataBsd {
+	size_t index;
+			// Index in the array passed to poll(). Unused with epoll.
+	uint32 events;
+			// The events which are waited for (POLLIN, EPOLLIN, etc).
+	uint32 generation;
+			// Different for each registration, so that readiness of a
+			// closed descriptor is not taken for that of a new one which
+			// got the same fd.
+};
+#endif  /* NETMANAGER_INTERNAL */
+
 #endif  /* LIBS_NETWORK_NETMANAGER_NETMANAGER_BSD_H_ */
 
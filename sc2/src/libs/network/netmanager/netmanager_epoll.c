@@ -0,0 +1,263 @@
+/*
+ *  Copyright 2006  Serge van den Boom <svdb@stack.nl>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// NetManager using epoll, for Linux. The kernel keeps the set of
+// descriptors, so a call to NetManager_process() only costs time for the
+// descriptors which are ready, however many idle ones there are.
+// Readiness is level-triggered, like with select() and poll(); the
+// callbacks are not required to read or write until EAGAIN.
+
+#define NETMANAGER_INTERNAL
+#define SOCKET_INTERNAL
+#define NETDESCRIPTOR_INTERNAL
+#include "netmanager_bsd.h"
+#include "ndesc.h"
+#include "../socket/socket.h"
+
+#include "types.h"
+#include "libs/log.h"
+#include "libs/timelib.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "netmanager_common.ci"
+#include "ndindex.ci"
+
+
+// Maximum number of events handled by one NetManager_process() call.
+// Any further ready descriptors are reported by the next call.
+#define MAX_EVENTS 64
+
+static int epollFd = -1;
+
+
+void
+NetManager_init(void) {
+	NDIndex_init();
+
+	epollFd = epoll_create(MAX_EVENTS);
+			// The argument is only a hint, and ignored by newer kernels.
+	if (epollFd == -1) {
+		log_add(log_Error, "epoll_create() failed: %s.",
+				strerror(errno));
+	}
+}
+
+void
+NetManager_uninit(void) {
+	if (epollFd != -1) {
+		close(epollFd);
+		epollFd = -1;
+	}
+
+	NDIndex_uninit();
+}
+
+static inline SocketManagementDataBsd *
+SocketManagementData_alloc(void) {
+	return malloc(sizeof (SocketManagementDataBsd));
+}
+
+static inline void
+SocketManagementData_free(SocketManagementDataBsd *smd) {
+	free(smd);
+}
+
+// Changes the events that are waited for on the socket of 'nd'.
+// epoll always reports errors and hangups, so a descriptor which does not
+// wait for anything is removed from the epoll set altogether; otherwise
+// it would be reported over and over.
+static int
+setEvents(NetDescriptor *nd, uint32 events) {
+	struct epoll_event event;
+	int op;
+
+	if (events == nd->smd->events)
+		return 0;
+
+	if (events == 0) {
+		op = EPOLL_CTL_DEL;
+	} else if (nd->smd->events == 0) {
+		op = EPOLL_CTL_ADD;
+	} else
+		op = EPOLL_CTL_MOD;
+
+	memset(&event, '\0', sizeof event);
+	event.events = events;
+	event.data.u64 = ((uint64) nd->smd->generation << 32)
+			| (uint32) nd->socket->fd;
+	if (epoll_ctl(epollFd, op, nd->socket->fd, &event) == -1) {
+		int savedErrno = errno;
+		log_add(log_Error, "epoll_ctl() failed: %s.", strerror(errno));
+		errno = savedErrno;
+		return -1;
+	}
+
+	nd->smd->events = events;
+	return 0;
+}
+
+// Register the NetDescriptor with the NetManager.
+int
+NetManager_addDesc(NetDescriptor *nd) {
+	uint32 events;
+
+	assert(nd->socket != Socket_noSocket);
+	assert(!NDIndex_socketRegistered(nd->socket));
+
+	if (epollFd == -1) {
+		errno = EBADF;
+		return -1;
+	}
+
+	nd->smd = SocketManagementData_alloc();
+	if (nd->smd == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+	nd->smd->index = 0;
+	nd->smd->events = 0;
+	nd->smd->generation = NetManager_newGeneration();
+
+	if (NDIndex_registerNDWithSocket(nd->socket, nd) == -1) {
+		// errno is set
+		int savedErrno = errno;
+		SocketManagementData_free(nd->smd);
+		nd->smd = NULL;
+		errno = savedErrno;
+		return -1;
+	}
+
+	events = 0;
+	if (nd->readCallback != NULL)
+		events |= EPOLLIN;
+	if (nd->writeCallback != NULL)
+		events |= EPOLLOUT;
+	if (nd->exceptionCallback != NULL)
+		events |= EPOLLPRI;
+	if (setEvents(nd, events) == -1) {
+		int savedErrno = errno;
+		NDIndex_unregisterNDForSocket(nd->socket);
+		SocketManagementData_free(nd->smd);
+		nd->smd = NULL;
+		errno = savedErrno;
+		return -1;
+	}
+
+	return 0;
+}
+
+void
+NetManager_removeDesc(NetDescriptor *nd) {
+	assert(nd->socket != Socket_noSocket);
+	assert(NDIndex_getNDForSocket(nd->socket) == nd);
+
+	(void) setEvents(nd, 0);
+
+	NDIndex_unregisterNDForSocket(nd->socket);
+
+	SocketManagementData_free(nd->smd);
+	nd->smd = NULL;
+}
+
+void
+NetManager_activateReadCallback(NetDescriptor *nd) {
+	(void) setEvents(nd, nd->smd->events | EPOLLIN);
+}
+
+void
+NetManager_deactivateReadCallback(NetDescriptor *nd) {
+	(void) setEvents(nd, nd->smd->events & ~EPOLLIN);
+}
+
+void
+NetManager_activateWriteCallback(NetDescriptor *nd) {
+	(void) setEvents(nd, nd->smd->events | EPOLLOUT);
+}
+
+void
+NetManager_deactivateWriteCallback(NetDescriptor *nd) {
+	(void) setEvents(nd, nd->smd->events & ~EPOLLOUT);
+}
+
+void
+NetManager_activateExceptionCallback(NetDescriptor *nd) {
+	(void) setEvents(nd, nd->smd->events | EPOLLPRI);
+}
+
+void
+NetManager_deactivateExceptionCallback(NetDescriptor *nd) {
+	(void) setEvents(nd, nd->smd->events & ~EPOLLPRI);
+}
+
+// This function may be called again from inside a callback function
+// triggered by this function. BUG: This may result in callbacks being
+// called multiple times.
+// This function should however not be called from multiple threads at once.
+int
+NetManager_process(uint32 *timeoutMs) {
+	struct epoll_event events[MAX_EVENTS];
+	uint64 deadline;
+	int numEvents;
+	int i;
+
+	deadline = NetManager_getDeadline(*timeoutMs);
+
+	do {
+		numEvents = epoll_wait(epollFd, events, MAX_EVENTS,
+				(int) NetManager_msUntil(deadline, true));
+	} while (numEvents == -1 && errno == EINTR);
+	if (numEvents == -1) {
+		int savedErrno = errno;
+		log_add(log_Error, "epoll_wait() failed: %s.", strerror(errno));
+		*timeoutMs = NetManager_msUntil(deadline, false);
+		errno = savedErrno;
+		return -1;
+	}
+
+	for (i = 0; i < numEvents; i++) {
+		uint32 revents = events[i].events;
+		int fd = (int) (uint32) events[i].data.u64;
+		uint32 generation = (uint32) (events[i].data.u64 >> 32);
+		NetDescriptor *nd;
+
+		// A callback may cause a NetDescriptor to be closed. The deletion
+		// of the structure will be scheduled, but will still be
+		// available at least until this function returns. A closed
+		// NetDescriptor is no longer found in the index.
+		nd = NDIndex_getNDForSocketFd(fd);
+		if (nd == NULL || nd->smd->generation != generation)
+			continue;
+
+		// select() reports errors and hangups as the descriptor being
+		// readable and writable; the callbacks expect the same.
+		NetManager_dispatch(nd,
+				(revents & (EPOLLIN | EPOLLERR | EPOLLHUP)) != 0,
+				(revents & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0,
+				(revents & EPOLLPRI) != 0);
+	}
+
+	*timeoutMs = NetManager_msUntil(deadline, false);
+	return 0;
+}
+
@@ -30,6 +30,7 @@
 #include "types.h"
 #include "libs/misc.h"
 #include "libs/log.h"
+#include "libs/timelib.h"
 
 #include <assert.h>
 #include <winsock2.h>
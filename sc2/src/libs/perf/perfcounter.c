@@ -0,0 +1,284 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include "libs/perflib.h"
+#include "libs/log.h"
+
+// Each thread claims a slot of counters the first time it counts
+// something, and is the only one to write to it. Slots are not given
+// back when a thread ends; when they have run out, threads share the
+// last slot, and add to it atomically.
+// This needs thread-local storage and atomic operations; where they are
+// not available, all threads share the last slot, and counts may be
+// lost when two threads add to the same counter at once.
+#if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#	define PERF_THREAD_LOCAL __thread
+#	define PERF_LOAD(ptr) \
+		__atomic_load_n ((ptr), __ATOMIC_RELAXED)
+#	define PERF_STORE(ptr, newVal) \
+		__atomic_store_n ((ptr), (newVal), __ATOMIC_RELAXED)
+#	define PERF_ADD(ptr, amount) \
+		__atomic_fetch_add ((ptr), (amount), __ATOMIC_RELAXED)
+#	define PERF_CLAIM(ptr) \
+		(__atomic_exchange_n ((ptr), 1, __ATOMIC_ACQ_REL) == 0)
+		// Keeps the slots of two threads out of the same cache line.
+#	define PERF_SLOT_ALIGN __attribute__ ((aligned (64)))
+#else
+#	define PERF_SLOT_ALIGN
+#	define PERF_LOAD(ptr) (*(ptr))
+#	define PERF_ADD(ptr, amount) (*(ptr) += (amount))
+#endif
+
+#define PERF_MAX_THREADS 32
+
+#define PERF_INTERVAL_MS 1000
+
+typedef struct
+{
+	int claimed;
+	uint64 values[PERF_NUM_COUNTERS];
+} PERF_SLOT_ALIGN perf_Slot;
+
+static perf_Slot slots[PERF_MAX_THREADS + 1];
+#define sharedSlot (&slots[PERF_MAX_THREADS])
+
+#ifdef PERF_THREAD_LOCAL
+static PERF_THREAD_LOCAL perf_Slot *mySlot;
+#endif
+
+static const perf_CounterInfo counterInfo[PERF_NUM_COUNTERS] =
+{
+	/* PERF_DCQ_FLUSHES */      { "dcq_flushes",      perf_COUNT, -1,
+			100.0 },
+	/* PERF_DCQ_DEPTH */        { "dcq_depth",        perf_COUNT,
+			PERF_DCQ_FLUSHES, 512.0 },
+	/* PERF_DCQ_COMMANDS */     { "dcq_commands",     perf_COUNT,
+			PERF_DCQ_FLUSHES, 512.0 },
+	/* PERF_SCALER_TIME */      { "scaler_ms",        perf_TIME,  -1,
+			250.0 },
+	/* PERF_MIXER_CALLS */      { "mixer_calls",      perf_COUNT, -1,
+			100.0 },
+	/* PERF_MIXER_TIME */       { "mixer_ms",         perf_TIME,  -1,
+			100.0 },
+	/* PERF_STREAM_UNDERRUNS */ { "stream_underruns", perf_COUNT, -1,
+			10.0 },
+	/* PERF_COLLISION_PAIRS */  { "collision_pairs",  perf_COUNT, -1,
+			10000.0 },
+	/* PERF_RESOURCE_LOADS */   { "resource_loads",   perf_COUNT, -1,
+			100.0 },
+	/* PERF_RESOURCE_BYTES */   { "resource_bytes",   perf_COUNT, -1,
+			16.0 * 1024 * 1024 },
+};
+
+// Used by perf_update(), on the main() thread only.
+static perf_Snapshot lastSnapshot;
+static perf_Snapshot lastInterval;
+static BOOLEAN haveLastInterval = FALSE;
+static FILE *exportFile = NULL;
+static BOOLEAN exportJSON;
+
+void
+perf_add (perf_CounterId id, uint64 amount)
+{
+#ifdef PERF_THREAD_LOCAL
+	perf_Slot *slot = mySlot;
+
+	if (slot == NULL)
+	{
+		int i;
+
+		for (i = 0; i < PERF_MAX_THREADS; i++)
+		{
+			if (PERF_LOAD (&slots[i].claimed) == 0
+					&& PERF_CLAIM (&slots[i].claimed))
+				break;
+		}
+		slot = &slots[i];
+				// sharedSlot if none was free
+		mySlot = slot;
+	}
+
+	if (slot != sharedSlot)
+	{
+		// Only this thread writes to the slot; the store only needs to
+		// be atomic for the threads that read it.
+		PERF_STORE (&slot->values[id], slot->values[id] + amount);
+		return;
+	}
+#endif
+
+	PERF_ADD (&sharedSlot->values[id], amount);
+}
+
+const perf_CounterInfo *
+perf_getCounterInfo (perf_CounterId id)
+{
+	return &counterInfo[id];
+}
+
+void
+perf_takeSnapshot (perf_Snapshot *snapshot)
+{
+	int slotI;
+	int id;
+
+	memset (snapshot->values, 0, sizeof snapshot->values);
+	for (slotI = 0; slotI <= PERF_MAX_THREADS; slotI++)
+	{
+		for (id = 0; id < PERF_NUM_COUNTERS; id++)
+			snapshot->values[id] += PERF_LOAD (&slots[slotI].values[id]);
+	}
+	snapshot->time = GetPerfCounter ();
+}
+
+void
+perf_setExportFile (const char *fileName)
+{
+	const char *ext;
+
+	if (exportFile != NULL)
+	{
+		fclose (exportFile);
+		exportFile = NULL;
+	}
+	if (fileName == NULL)
+		return;
+
+	exportFile = fopen (fileName, "w");
+	if (exportFile == NULL)
+	{
+		log_add (log_Warning, "Warning: Could not open '%s' for writing "
+				"the performance counters: %s", fileName, strerror (errno));
+		return;
+	}
+
+	ext = strrchr (fileName, '.');
+	exportJSON = ext != NULL && strcmp (ext, ".json") == 0;
+	if (!exportJSON)
+		perf_writeCSVHeader (exportFile);
+}
+
+void
+perf_update (void)
+{
+	perf_Snapshot now;
+	int id;
+
+	if (lastSnapshot.time == 0)
+	{
+		perf_takeSnapshot (&lastSnapshot);
+		return;
+	}
+	if (GetPerfCounter () - lastSnapshot.time
+			< GetPerfFrequency () * PERF_INTERVAL_MS / 1000)
+		return;
+
+	perf_takeSnapshot (&now);
+	for (id = 0; id < PERF_NUM_COUNTERS; id++)
+		lastInterval.values[id] = now.values[id] - lastSnapshot.values[id];
+	lastInterval.time = now.time - lastSnapshot.time;
+	lastSnapshot = now;
+	haveLastInterval = TRUE;
+
+	if (exportFile != NULL)
+	{
+		if (exportJSON)
+			perf_writeJSON (exportFile, &lastInterval);
+		else
+			perf_writeCSV (exportFile, &lastInterval);
+		fflush (exportFile);
+	}
+}
+
+const perf_Snapshot *
+perf_getLastInterval (void)
+{
+	return haveLastInterval ? &lastInterval : NULL;
+}
+
+double
+perf_getDisplayValue (const perf_Snapshot *interval, perf_CounterId id)
+{
+	const perf_CounterInfo *info = &counterInfo[id];
+	uint64 frequency = GetPerfFrequency ();
+	double value = (double) interval->values[id];
+	double per;
+
+	if (info->kind == perf_TIME)
+		value = value * 1000.0 / (double) frequency;
+
+	if (info->per >= 0)
+		per = (double) interval->values[info->per];
+	else
+		per = (double) interval->time / (double) frequency;
+
+	return per > 0.0 ? value / per : 0.0;
+}
+
+void
+perf_writeCSVHeader (FILE *out)
+{
+	int id;
+
+	fprintf (out, "interval_ms");
+	for (id = 0; id < PERF_NUM_COUNTERS; id++)
+		fprintf (out, ",%s", counterInfo[id].name);
+	fputc ('\n', out);
+}
+
+// Times are written in milliseconds, counts as they are.
+static double
+exportValue (const perf_Snapshot *interval, int id)
+{
+	if (counterInfo[id].kind == perf_TIME)
+	{
+		uint64 frequency = GetPerfFrequency ();
+		return (double) interval->values[id] * 1000.0 / (double) frequency;
+	}
+	return (double) interval->values[id];
+}
+
+void
+perf_writeCSV (FILE *out, const perf_Snapshot *interval)
+{
+	uint64 frequency = GetPerfFrequency ();
+	int id;
+
+	fprintf (out, "%.3f", (double) interval->time * 1000.0
+			/ (double) frequency);
+	for (id = 0; id < PERF_NUM_COUNTERS; id++)
+		fprintf (out, ",%.15g", exportValue (interval, id));
+	fputc ('\n', out);
+}
+
+void
+perf_writeJSON (FILE *out, const perf_Snapshot *interval)
+{
+	uint64 frequency = GetPerfFrequency ();
+	int id;
+
+	fprintf (out, "{\"interval_ms\": %.3f", (double) interval->time
+			* 1000.0 / (double) frequency);
+	for (id = 0; id < PERF_NUM_COUNTERS; id++)
+	{
+		fprintf (out, ", \"%s\": %.15g", counterInfo[id].name,
+				exportValue (interval, id));
+	}
+	fprintf (out, "}\n");
+}
+
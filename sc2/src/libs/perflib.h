@@ -0,0 +1,126 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Counters for what the hot paths of the game cost at run time.
+// Each thread adds to counters of its own, without locking, and the
+// counters of all threads are only summed when they are read, so the
+// counters are always on.
+// The counters only ever increase. perf_update(), called regularly on
+// the main() thread, computes how much they increased over the last
+// interval, for display, and optionally writes that to a file.
+
+#ifndef LIBS_PERFLIB_H_
+#define LIBS_PERFLIB_H_
+
+#include <stdio.h>
+#include "libs/compiler.h"
+#include "libs/timelib.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum
+{
+	PERF_DCQ_FLUSHES,
+			// Draws of the draw command queue.
+	PERF_DCQ_DEPTH,
+			// Sum of the queue lengths at the start of each draw.
+	PERF_DCQ_COMMANDS,
+			// Draw commands processed.
+	PERF_SCALER_TIME,
+	PERF_MIXER_CALLS,
+	PERF_MIXER_TIME,
+			// Time spent in mixer_MixChannels().
+	PERF_STREAM_UNDERRUNS,
+	PERF_COLLISION_PAIRS,
+			// Pairs of elements tested for intersection in battle.
+	PERF_RESOURCE_LOADS,
+	PERF_RESOURCE_BYTES,
+			// Bytes read or mapped while resources were loaded.
+
+	PERF_NUM_COUNTERS
+} perf_CounterId;
+
+typedef enum
+{
+	perf_COUNT,
+	perf_TIME,
+			// In GetPerfCounter() counts; reported in milliseconds.
+} perf_CounterKind;
+
+typedef struct
+{
+	const char *name;
+	perf_CounterKind kind;
+	int per;
+			// The counter by which this one is divided for display, or
+			// -1 to display it per second.
+	double full;
+			// The displayed value at which its bar in the overlay is full.
+} perf_CounterInfo;
+
+typedef struct
+{
+	uint64 time;
+			// GetPerfCounter() when the values were read, or the length
+			// of the interval.
+	uint64 values[PERF_NUM_COUNTERS];
+} perf_Snapshot;
+
+// Can be called on any thread.
+void perf_add (perf_CounterId id, uint64 amount);
+
+static inline void
+perf_inc (perf_CounterId id)
+{
+	perf_add (id, 1);
+}
+
+// Adds the time since 'start', which was returned by GetPerfCounter().
+static inline void
+perf_addTimeSince (perf_CounterId id, uint64 start)
+{
+	perf_add (id, GetPerfCounter () - start);
+}
+
+const perf_CounterInfo *perf_getCounterInfo (perf_CounterId id);
+
+// Sums the counters of all threads. Can be called on any thread.
+void perf_takeSnapshot (perf_Snapshot *snapshot);
+
+// Write the counters to 'fileName' after every interval, as CSV, or as
+// one JSON object per line if the name ends in ".json". NULL to stop.
+void perf_setExportFile (const char *fileName);
+// Called on the main() thread, regularly.
+void perf_update (void);
+// The increase of the counters over the last interval that ended, or
+// NULL if none has ended yet. Main() thread only.
+const perf_Snapshot *perf_getLastInterval (void);
+// The value of a counter to display, for an interval.
+double perf_getDisplayValue (const perf_Snapshot *interval,
+		perf_CounterId id);
+
+void perf_writeCSVHeader (FILE *out);
+void perf_writeCSV (FILE *out, const perf_Snapshot *interval);
+void perf_writeJSON (FILE *out, const perf_Snapshot *interval);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* LIBS_PERFLIB_H_ */
+
@@ -54,6 +54,8 @@ void *LoadResourceFromPath(const char *pathname, ResourceLoadFileFun fn);
 
 uio_Stream *res_OpenResFile (uio_DirHandle *dir, const char *filename, const char *mode);
 size_t ReadResFile (void *lpBuf, size_t size, size_t count, uio_Stream *fp);
+const void *MapResFile (uio_Stream *fp, size_t length, uio_FileMap **map);
+void UnmapResFile (uio_FileMap *map);
 size_t WriteResFile (const void *lpBuf, size_t size, size_t count, uio_Stream *fp);
 int GetResFileChar (uio_Stream *fp);
 int PutResFileChar (char ch, uio_Stream *fp);
@@ -79,6 +81,8 @@ void LoadResourceIndex (uio_DirHandle *dir, const char *filename, const char *pr
 void SaveResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *root, BOOLEAN strip_root);
 
 void *GetResourceData (uio_Stream *fp, DWORD length);
+const void *MapResourceData (uio_Stream *fp, DWORD length,
+		uio_FileMap **map);
 
 #define AllocResourceData HMalloc
 BOOLEAN FreeResourceData (void *);
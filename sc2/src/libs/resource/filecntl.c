@@ -70,6 +70,21 @@ ReadResFile (void *lpBuf, size_t size, size_t count, uio_Stream *fp)
 	return (retval);
 }
 
+// Map the next 'length' bytes of the file into memory, read-only.
+// Where the file system does not support that, they are read into a
+// buffer instead. Either way, release the data with UnmapResFile().
+const void *
+MapResFile (uio_Stream *fp, size_t length, uio_FileMap **map)
+{
+	return uio_fmap (fp, length, 0, map);
+}
+
+void
+UnmapResFile (uio_FileMap *map)
+{
+	uio_unmapFile (map);
+}
+
 size_t
 WriteResFile (const void *lpBuf, size_t size, size_t count, uio_Stream *fp)
 {
@@ -21,6 +21,8 @@
 #include "resintrn.h"
 #include "libs/memlib.h"
 #include "libs/log.h"
+#include "libs/timelib.h"
+#include "libs/perflib.h"
 #include "libs/uio/charhashtable.h"
 
 const char *_cur_resfile_name;
@@ -36,7 +38,26 @@ lookupResourceDesc (RESOURCE_INDEX idx, RESOURCE res)
 void
 loadResourceDesc (ResourceDesc *desc)
 {
-	desc->vtable->loadFun (desc->fname, &desc->resdata);
+	ResourceHandlers *vtable = desc->vtable;
+	uio_IOStats before, after;
+	uint64 startTime;
+
+	// Only count this thread's I/O; other threads may read streams or
+	// load resources at the same time.
+	uio_getThreadIOStats (&before);
+	startTime = GetPerfCounter ();
+
+	vtable->loadFun (desc->fname, &desc->resdata);
+
+	vtable->loadTime += GetPerfCounter () - startTime;
+	uio_getThreadIOStats (&after);
+	vtable->bytesCopied += after.bytesCopied - before.bytesCopied;
+	vtable->bytesMapped += after.bytesMapped - before.bytesMapped;
+	vtable->numLoads++;
+
+	perf_inc (PERF_RESOURCE_LOADS);
+	perf_add (PERF_RESOURCE_BYTES, (after.bytesCopied - before.bytesCopied)
+			+ (after.bytesMapped - before.bytesMapped));
 }
 
 void *
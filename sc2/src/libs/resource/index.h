@@ -32,6 +32,13 @@ struct resource_handlers
 	ResourceLoadFun *loadFun;
 	ResourceFreeFun *freeFun;
 	ResourceStringFun *toString;
+
+	// Load statistics for this type, reported by UninitResourceSystem()
+	COUNT numLoads;
+	uint64 loadTime;
+			// In GetPerfCounter() units
+	uint64 bytesCopied;
+	uint64 bytesMapped;
 };
 
 struct resource_desc
@@ -52,3 +52,24 @@ GetResourceData (uio_Stream *fp, DWORD length)
 
 	return result;
 }
+
+// Like GetResourceData(), but for loaders that only parse the data.
+// The returned data is read-only; release it with UnmapResFile().
+const void *
+MapResourceData (uio_Stream *fp, DWORD length, uio_FileMap **map)
+{
+	DWORD compLen;
+
+	if (length < sizeof (DWORD))
+		return NULL;
+	if (ReadResFile (&compLen, sizeof (compLen), 1, fp) != 1)
+		return NULL;
+	if (compLen != ~(DWORD)0)
+	{
+		log_add (log_Warning, "LZ-compressed binary data not supported");
+		return NULL;
+	}
+	length -= sizeof (DWORD);
+
+	return MapResFile (fp, length, map);
+}
@@ -23,15 +23,22 @@
 #include "propfile.h"
 #include "libs/reslib.h"
 
-void
-PropFile_from_string (char *d, PROPERTY_HANDLER handler, const char *prefix)
+// Parses 'len' bytes of property data at 'd'. The data is not modified
+// (it may be a read-only file mapping); keys and values are copied into
+// a scratch buffer before being passed to the handler.
+static void
+parse_properties (const char *d, size_t len, PROPERTY_HANDLER handler,
+		const char *prefix)
 {
-	int len, i;
+	size_t i;
+	char *line = NULL;
+	size_t lineSize = 0;
 
-	len = strlen(d);
 	i = 0;
 	while (i < len) {
-		int key_start, key_end, value_start, value_end;
+		size_t key_start, key_end, value_start, value_end;
+		size_t needed;
+		char *key, *value;
 		/* Starting a line: search for non-whitespace */
 		while ((i < len) && isspace (d[i])) i++;
 		if (i >= len) break;  /* Done parsing! */
@@ -80,41 +87,64 @@ PropFile_from_string (char *d, PROPERTY_HANDLER handler, const char *prefix)
 		i++;
 
 		/* We now have start and end values for key and value.
-		   We terminate the strings for both by writing \0s, then
-		   make a new map entry. */
-		d[key_end] = '\0';
-		d[value_end] = '\0';
+		   Copy both out as terminated strings, then make a new
+		   map entry. */
+		needed = (key_end - key_start) + (value_end - value_start) + 2;
+		if (needed > lineSize) {
+			char *newLine = realloc (line, needed);
+			if (!newLine) {
+				log_add (log_Error, "Error: Out of memory while "
+						"parsing properties");
+				break;
+			}
+			line = newLine;
+			lineSize = needed;
+		}
+		key = line;
+		memcpy (key, d + key_start, key_end - key_start);
+		key[key_end - key_start] = '\0';
+		value = key + (key_end - key_start) + 1;
+		memcpy (value, d + value_start, value_end - value_start);
+		value[value_end - value_start] = '\0';
+
 		if (prefix) {
 			char buf[256];
-			snprintf(buf, 255, "%s%s", prefix, d+key_start);
+			snprintf(buf, 255, "%s%s", prefix, key);
 			buf[255]=0;
-			handler(buf, d+value_start);
+			handler(buf, value);
 		} else {
-			handler (d+key_start, d+value_start);
+			handler (key, value);
 		}
 	}
+	free (line);
+}
+
+void
+PropFile_from_string (char *d, PROPERTY_HANDLER handler, const char *prefix)
+{
+	parse_properties (d, strlen (d), handler, prefix);
 }
 
 void
 PropFile_from_file (uio_Stream *f, PROPERTY_HANDLER handler, const char *prefix)
 {
 	size_t flen;
-	char *data;
+	uio_FileMap *map;
+	const char *data;
 
 	flen = LengthResFile (f);
+	if (flen == 0)
+		return;
 
-	data = malloc (flen + 1);
+	// Text-mode newline conversion is not applied to the mapped data;
+	// the parser treats the '\r' of a "\r\n" as trailing whitespace.
+	data = MapResFile (f, flen, &map);
 	if (!data) {
 		return;
 	}
 
-	// We may end up with less bytes than we asked for due to the
-	// DOS->Unix newline conversion
-	flen = ReadResFile (data, 1, flen, f);
-	data[flen] = '\0';
-
-	PropFile_from_string (data, handler, prefix);
-	free (data);
+	parse_properties (data, flen, handler, prefix);
+	UnmapResFile (map);
 }
 
 void
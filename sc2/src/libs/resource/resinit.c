@@ -25,6 +25,7 @@
 #include "libs/reslib.h"
 #include "libs/sndlib.h"
 #include "libs/vidlib.h"
+#include "libs/timelib.h"
 #include "propfile.h"
 #include <ctype.h>
 #include <stdlib.h>
@@ -416,9 +417,42 @@ SaveResourceIndex (uio_DirHandle *dir, const char *rmpfile, const char *root, BO
 	CharHashTable_freeIterator (it);
 }
 
+static void
+logLoadStats (RESOURCE_INDEX idx)
+{
+	CharHashTable_Iterator *it;
+	uint64 perfFrequency = GetPerfFrequency ();
+
+	log_add (log_Info, "Resource loading statistics:");
+	for (it = CharHashTable_getIterator (idx->map);
+			!CharHashTable_iteratorDone (it);
+			it = CharHashTable_iteratorNext (it))
+	{
+		const char *key = CharHashTable_iteratorKey (it);
+		ResourceDesc *desc = CharHashTable_iteratorValue (it);
+		ResourceHandlers *handlers;
+
+		// The type handlers are stored as "sys.<type>" entries.
+		if (strncmp (key, "sys.", 4) != 0 || desc == NULL)
+			continue;
+		handlers = (ResourceHandlers *) desc->resdata.ptr;
+		if (handlers->numLoads == 0)
+			continue;
+
+		log_add (log_Info, "    %-12s %5u loads, %9.2f ms, "
+				"%10lu bytes copied, %10lu bytes mapped",
+				handlers->resType, (unsigned) handlers->numLoads,
+				handlers->loadTime * 1000.0 / (double) perfFrequency,
+				(unsigned long) handlers->bytesCopied,
+				(unsigned long) handlers->bytesMapped);
+	}
+	CharHashTable_freeIterator (it);
+}
+
 void
 UninitResourceSystem (void)
 {
+	logLoadStats (_get_current_index_header ());
 	freeResourceIndex (_get_current_index_header ());
 	_set_current_index_header (NULL);
 }
@@ -446,6 +480,10 @@ InstallResTypeVectors (const char *resType, ResourceLoadFun *loadFun,
 	handlers->freeFun = freeFun;
 	handlers->toString = stringFun;
 	handlers->resType = resType;
+	handlers->numLoads = 0;
+	handlers->loadTime = 0;
+	handlers->bytesCopied = 0;
+	handlers->bytesMapped = 0;
 	
 	result = HMalloc (sizeof (ResourceDesc));
 	if (result == NULL)
@@ -319,7 +319,7 @@ SoundDecoder_Lookup (const char* fileext)
 }
 
 TFB_SoundDecoder*
-SoundDecoder_Load (uio_DirHandle *dir, char *filename,
+SoundDecoder_Load (uio_DirHandle *dir, const char *filename,
 		uint32 buffer_size, uint32 startTime, sint32 runTime)
 			// runTime < 0 specifies a default length for a nul decoder
 {	
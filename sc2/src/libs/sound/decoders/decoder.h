@@ -39,6 +39,10 @@ typedef struct tfb_decoderformats
 	uint32 stereo8;
 	uint32 mono16;
 	uint32 stereo16;
+	uint32 frequency;
+			// The rate the audio is played at, or 0 if not fixed.
+			// Decoders which can produce any rate should use it, so
+			// that the mixer does not have to resample.
 } TFB_DecoderFormats;
 
 // forward-declare
@@ -116,7 +120,7 @@ void SoundDecoder_SwapWords (uint16* data, uint32 size);
 sint32 SoundDecoder_Init (int flags, TFB_DecoderFormats* formats);
 void SoundDecoder_Uninit (void);
 TFB_SoundDecoder* SoundDecoder_Load (uio_DirHandle *dir,
-		char *filename, uint32 buffer_size, uint32 startTime, sint32 runTime);
+		const char *filename, uint32 buffer_size, uint32 startTime, sint32 runTime);
 uint32 SoundDecoder_Decode (TFB_SoundDecoder *decoder);
 uint32 SoundDecoder_DecodeAll (TFB_SoundDecoder *decoder);
 float SoundDecoder_GetTime (TFB_SoundDecoder *decoder);
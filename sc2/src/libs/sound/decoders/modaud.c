@@ -28,6 +28,7 @@
 #include "decoder.h"
 #include "libs/sound/audiocore.h"
 #include "libs/log.h"
+#include "libs/threadlib.h"
 #include "modaud.h"
 
 #ifdef USE_INTERNAL_MIKMOD
@@ -75,9 +76,26 @@ typedef struct tfb_modsounddecoder
 	// private
 	sint32 last_error;
 	MODULE* module;
+#ifdef USE_INTERNAL_MIKMOD
+	MikMod_Context* context;
+			// Player and mixer state of this module, so that several
+			// modules can be decoded at the same time
+#endif
 
 } TFB_ModSoundDecoder;
 
+// MikMod works on one context at a time; this guards switching between
+// them, and the output buffer below
+static Mutex moda_mutex;
+
+#ifdef USE_INTERNAL_MIKMOD
+#	define moda_SelectContext(moda) MikMod_SelectContext ((moda)->context)
+#else
+	// The external library has no contexts; only one module
+	// can be played at a time
+#	define moda_SelectContext(moda)
+#endif
+
 
 
 // MikMod Output driver
@@ -279,6 +297,12 @@ moda_InitModule (int flags, const TFB_DecoderFormats* fmts)
 		md_mixfreq = 44100;
 		md_reverb = 0;
 	}
+
+	// Mix at the rate of the output, instead of having the mixer
+	// resample. Low quality keeps its low rate, which is cheaper.
+	if (!(flags & audio_QUALITY_LOW) && fmts->frequency != 0
+			&& fmts->frequency <= 0xffff)
+		md_mixfreq = (UWORD) fmts->frequency;
 	
 	md_pansep = 64;
 
@@ -289,6 +313,7 @@ moda_InitModule (int flags, const TFB_DecoderFormats* fmts)
 		return false;
 	}
 
+	moda_mutex = CreateMutex ("MikMod decoder mutex", SYNC_CLASS_AUDIO);
 	moda_formats = fmts;
 
 	return true;
@@ -298,6 +323,8 @@ static void
 moda_TermModule (void)
 {
 	MikMod_Exit ();
+	DestroyMutex (moda_mutex);
+	moda_mutex = NULL;
 }
 
 static uint32
@@ -354,14 +381,29 @@ moda_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
 		return false;
 	}
 
+	LockMutex (moda_mutex);
+#ifdef USE_INTERNAL_MIKMOD
+	moda->context = MikMod_NewContext ();
+	if (!moda->context)
+	{
+		UnlockMutex (moda_mutex);
+		moda_delete_uioReader (reader);
+		uio_fclose (fp);
+		moda->last_error = -1;
+		return false;
+	}
+#endif
+	moda_SelectContext (moda);
 	mod = Player_LoadGeneric (reader, 8, 0);
-	
+	UnlockMutex (moda_mutex);
+
 	// can already dispose of reader and fileh
 	moda_delete_uioReader (reader);
 	uio_fclose (fp);
 	if (!mod)
 	{
 		log_add (log_Warning, "moda_Open(): could not load %s", filename);
+		moda_Close (This);
 		return false;
 	}
 
@@ -384,12 +426,22 @@ static void
 moda_Close (THIS_PTR)
 {
 	TFB_ModSoundDecoder* moda = (TFB_ModSoundDecoder*) This;
-	
+
+	LockMutex (moda_mutex);
+	moda_SelectContext (moda);
 	if (moda->module)
 	{
 		Player_Free (moda->module);
 		moda->module = NULL;
 	}
+#ifdef USE_INTERNAL_MIKMOD
+	if (moda->context)
+	{
+		MikMod_FreeContext (moda->context);
+		moda->context = NULL;
+	}
+#endif
+	UnlockMutex (moda_mutex);
 }
 
 static int
@@ -397,15 +449,23 @@ moda_Decode (THIS_PTR, void* buf, sint32 bufsize)
 {
 	TFB_ModSoundDecoder* moda = (TFB_ModSoundDecoder*) This;
 	volatile ULONG* poutsize;
+	int ret;
 
+	LockMutex (moda_mutex);
+	moda_SelectContext (moda);
 	Player_Start (moda->module);
 	if (!Player_Active())
+	{
+		UnlockMutex (moda_mutex);
 		return 0;
+	}
 
 	poutsize = moda_mmout_SetOutputBuffer (buf, bufsize);
 	MikMod_Update ();
-	
-	return *poutsize;
+	ret = *poutsize;
+	UnlockMutex (moda_mutex);
+
+	return ret;
 }
 
 static uint32
@@ -413,11 +473,14 @@ moda_Seek (THIS_PTR, uint32 pcm_pos)
 {
 	TFB_ModSoundDecoder* moda = (TFB_ModSoundDecoder*) This;
 	
+	LockMutex (moda_mutex);
+	moda_SelectContext (moda);
 	Player_Start (moda->module);
 	if (pcm_pos)
 		log_add (log_Debug, "moda_Seek(): "
 				"non-zero seek positions not supported for mod");
 	Player_SetPosition (0);
+	UnlockMutex (moda_mutex);
 
 	return 0;
 }
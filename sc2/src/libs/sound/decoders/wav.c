@@ -19,6 +19,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <errno.h>
 #include "port.h"
 #include "types.h"
@@ -103,6 +104,10 @@ typedef struct tfb_wavesounddecoder
 	uint32 data_size;
 	uint32 max_pcm;
 	uint32 cur_pcm;
+	// When the file system can map the data chunk in place, samples are
+	// copied straight from the mapping instead of through the stream.
+	uio_FileMap *map;
+	const uint8 *data;
 
 } TFB_WaveSoundDecoder;
 
@@ -236,6 +241,8 @@ wava_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
 
 	wava->data_size = 0;
 	wava->data_ofs = 0;
+	wava->map = NULL;
+	wava->data = NULL;
 
 	// read wave header
 	if (!wava_readFileHeader (wava, &fileHdr))
@@ -324,6 +331,11 @@ wava_Open (THIS_PTR, uio_DirHandle *dir, const char *filename)
 	This->frequency = wava->fmtHdr.samplesPerSec;
 
 	uio_fseek (wava->fp, wava->data_ofs, SEEK_SET);
+	// Not being able to map is fine; the stream is used instead.
+	wava->data = uio_mapFile (uio_streamHandle (wava->fp), wava->data_ofs,
+			wava->data_size, uio_MAP_NOCOPY, &wava->map);
+	if (!wava->data)
+		wava->map = NULL;
 	wava->max_pcm = wava->data_size / wava->fmtHdr.blockAlign;
 	wava->cur_pcm = 0;
 	This->length = (float) wava->max_pcm / wava->fmtHdr.samplesPerSec;
@@ -337,6 +349,12 @@ wava_Close (THIS_PTR)
 {
 	TFB_WaveSoundDecoder* wava = (TFB_WaveSoundDecoder*) This;
 
+	if (wava->map)
+	{
+		uio_unmapFile (wava->map);
+		wava->map = NULL;
+		wava->data = NULL;
+	}
 	if (wava->fp)
 	{
 		uio_fclose (wava->fp);
@@ -354,7 +372,12 @@ wava_Decode (THIS_PTR, void* buf, sint32 bufsize)
 	if (dec_pcm > wava->max_pcm - wava->cur_pcm)
 		dec_pcm = wava->max_pcm - wava->cur_pcm;
 
-	dec_pcm = uio_fread (buf, wava->fmtHdr.blockAlign, dec_pcm, wava->fp);
+	if (wava->data)
+		memcpy (buf, wava->data + wava->cur_pcm * wava->fmtHdr.blockAlign,
+				dec_pcm * wava->fmtHdr.blockAlign);
+	else
+		dec_pcm = uio_fread (buf, wava->fmtHdr.blockAlign, dec_pcm,
+				wava->fp);
 	wava->cur_pcm += dec_pcm;
 	
 	return dec_pcm * wava->fmtHdr.blockAlign;
@@ -24,6 +24,7 @@
 #include "mixerint.h"
 #include "libs/misc.h"
 #include "libs/threadlib.h"
+#include "libs/perflib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
 
@@ -133,6 +134,7 @@ mixer_MixChannels (void *userdata, uint8 *stream, sint32 len)
 {
 	uint8 *end_stream = stream + len;
 	bool left = true;
+	uint64 startTime = GetPerfCounter ();
 
 	/* keep this order or die */
 	LockRecursiveMutex (src_mutex);
@@ -192,6 +194,9 @@ mixer_MixChannels (void *userdata, uint8 *stream, sint32 len)
 	UnlockRecursiveMutex (buf_mutex);
 	UnlockRecursiveMutex (src_mutex);
 
+	perf_inc (PERF_MIXER_CALLS);
+	perf_addTimeSince (PERF_MIXER_TIME, startTime);
+
 	(void) userdata; // satisfying compiler - unused arg
 }
 
@@ -221,6 +221,7 @@ mixSDL_Init (audio_Driver *driver, sint32 flags)
 	log_add (log_Info, "Mixer initialized.");
 
 	log_add (log_Info, "Initializing sound decoders.");
+	formats.frequency = obtained.freq;
 	if (SoundDecoder_Init (flags, &formats))
 	{
 		log_add (log_Error, "Sound decoders initialization failed.");
@@ -23,6 +23,7 @@
 #include "libs/tasklib.h"
 #include "libs/timelib.h"
 #include "libs/threadlib.h"
+#include "libs/perflib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
 
@@ -382,6 +383,7 @@ process_stream (TFB_SoundSource *source)
  			{
 				log_add (log_Warning, "StreamDecoderTaskFunc(): "
 						"buffer underrun playing %s", decoder->filename);
+				perf_inc (PERF_STREAM_UNDERRUNS);
 				audio_SourcePlay (source->handle);
 			}
 		}
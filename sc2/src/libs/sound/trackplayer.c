@@ -20,6 +20,7 @@
 #include "trackint.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/timelib.h"
 #include "options.h"
 #include <ctype.h>
 #include <stdlib.h>
@@ -42,6 +43,8 @@ static TFB_SoundChunk *chunks_head;   // first decoder in linked list
 static TFB_SoundChunk *chunks_tail;   // last decoder in linked list
 static TFB_SoundChunk *last_sub;      // last chunk in the list with a subtitle
 
+static uint64 splice_start;           // perf counter at the first
+                                      // SpliceTrack() of a conversation
 static TFB_SoundChunk *cur_chunk;     // currently playing chunk
 static TFB_SoundChunk *cur_sub_chunk; // currently displayed subtitle chunk
 
@@ -113,6 +116,15 @@ PlayTrack (void)
 	// Always scope the speech data, we may need it
 	PlayStream (sound_sample, SPEECH_SOURCE, false, true, true);
  	UnlockMutex (soundSource[SPEECH_SOURCE].stream_mutex);
+
+	if (splice_start != 0)
+	{
+		log_add (log_Debug, "PlayTrack(): %.1f ms from the first "
+				"SpliceTrack() to the start of playback",
+				(double) (GetPerfCounter () - splice_start) * 1000.0
+				/ GetPerfFrequency ());
+		splice_start = 0;
+	}
 }
 
 void
@@ -175,6 +187,7 @@ StopTrack (void)
 	StopStream (SPEECH_SOURCE);
 	track_count = 0;
 	tracks_length = 0;
+	splice_start = 0;
 	cur_chunk = NULL;
 	cur_sub_chunk = NULL;
 	UnlockMutex (soundSource[SPEECH_SOURCE].stream_mutex);
@@ -359,11 +372,14 @@ SplitSubPages (UNICODE *text, UNICODE *pages[], sint32 timestamp[], int size)
 // track list is NULL-terminated
 // May only be called after at least one SpliceTrack(). This is a limitation
 // for the sake of timestamps, but it does not have to be so.
+// Only the headers of the tracks are read here, which is enough to know
+// their lengths. The audio itself is decoded by the stream decoder task
+// as playback reaches each track, no further ahead than the buffers of
+// the stream.
 void
 SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText)
 {
 #define MAX_MULTI_TRACKS  20
-#define MAX_MULTI_BUFFERS 100
 	TFB_SoundDecoder* track_decs[MAX_MULTI_TRACKS + 1];
 	int tracks;
 	int slen1, slen2;
@@ -384,7 +400,7 @@ SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText)
 	for (tracks = 0; *TrackNames && tracks < MAX_MULTI_TRACKS; TrackNames++, tracks++)
 	{
 		track_decs[tracks] = SoundDecoder_Load (contentDir, *TrackNames,
-				32768, 0, - 3 * TEXT_SPEED);
+				4096, 0, - 3 * TEXT_SPEED);
 		if (track_decs[tracks])
 		{
 			log_add (log_Info, "  track: %s, decoder: %s, rate %d format %x",
@@ -392,7 +408,6 @@ SpliceMultiTrack (UNICODE *TrackNames[], UNICODE *TrackText)
 					SoundDecoder_GetName (track_decs[tracks]),
 					track_decs[tracks]->frequency,
 					track_decs[tracks]->format);
-			SoundDecoder_DecodeAll (track_decs[tracks]);
 
 			chunks_tail->next = create_SoundChunk (track_decs[tracks], sound_sample->length);
 			chunks_tail = chunks_tail->next;
@@ -568,6 +583,7 @@ SpliceTrack (UNICODE *TrackName, UNICODE *TrackText, UNICODE *TimeStamp, Callbac
 
 			if (!sound_sample)
 			{
+				splice_start = GetPerfCounter ();
 				sound_sample = TFB_CreateSoundSample (NULL, 8, &trackCBs);
 				chunks_head = create_SoundChunk (decoder, 0.0);
 				chunks_tail = chunks_head;
@@ -22,24 +22,17 @@
 #include "libs/reslib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/timelib.h"
 
 
 #define MAX_STRINGS 2048
 #define POOL_SIZE 4096
 
-static void
-dword_convert (DWORD *dword_array, COUNT num_dwords)
+// Binary string tables are stored big-endian.
+static DWORD
+get_dword (const BYTE *p)
 {
-	BYTE *p = (BYTE*)dword_array;
-
-	do
-	{
-		*dword_array++ = MAKE_DWORD (
-				MAKE_WORD (p[3], p[2]),
-				MAKE_WORD (p[1], p[0])
-				);
-		p += 4;
-	} while (--num_dwords);
+	return MAKE_DWORD (MAKE_WORD (p[3], p[2]), MAKE_WORD (p[1], p[0]));
 }
 
 static STRING
@@ -112,6 +105,65 @@ ensureBufSize (char **buf, size_t *curSize, size_t minSize, size_t increment)
 	return TRUE;
 }
 
+// Text of a mapped string table file, which is read line by line.
+typedef struct
+{
+	const char *pos;
+	const char *end;
+} TEXT_READER;
+
+// Works like uio_fgets().
+static char *
+get_line (TEXT_READER *reader, char *buf, size_t size)
+{
+	size_t len;
+	const char *newLinePos;
+
+	if (reader->pos >= reader->end)
+		return NULL;
+
+	len = reader->end - reader->pos;
+	if (len > size - 1)
+		len = size - 1;
+	newLinePos = memchr (reader->pos, '\n', len);
+	if (newLinePos != NULL)
+		len = newLinePos + 1 - reader->pos;
+
+	memcpy (buf, reader->pos, len);
+	buf[len] = '\0';
+	reader->pos += len;
+	return buf;
+}
+
+// Identify the text and timestamp files of a conversation by their size
+// and modification time. Returns FALSE if the text file is not there.
+static BOOLEAN
+getConversationCacheKey (const char *text_path, const char *ts_path,
+		STRING_CACHE_KEY *key)
+{
+	struct stat sb;
+
+	if (uio_stat (contentDir, text_path, &sb) != 0)
+		return FALSE;
+	key->textSize = (uint64) sb.st_size;
+	key->textMTime = (uint64) sb.st_mtime;
+
+	key->timestampSize = 0;
+	key->timestampMTime = 0;
+	if (ts_path != NULL && uio_stat (contentDir, ts_path, &sb) == 0)
+	{
+		key->timestampSize = (uint64) sb.st_size;
+		key->timestampMTime = (uint64) sb.st_mtime;
+	}
+	return TRUE;
+}
+
+static unsigned long
+perfCounterToUs (uint64 count)
+{
+	return (unsigned long) (count * 1000000 / GetPerfFrequency ());
+}
+
 void
 _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 {
@@ -120,7 +172,6 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 	int stringI;
 	int path_len;
 	int num_data_sets;
-	DWORD opos;
 	
 	char *namedata = NULL;
 			// Contains the names (indexes) of the dialogs.
@@ -157,10 +208,16 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 	char *ts_path;
 
 	uio_Stream *fp = NULL;
-	uio_Stream *timestamp_fp = NULL;
+	uio_FileMap *map = NULL;
+	TEXT_READER reader;
+	uio_FileMap *timestamp_map = NULL;
+	TEXT_READER timestamp_reader;
 	StringHashTable_HashTable *nameHashTable = NULL;
 			// Hash table of string names (such as "GLAD_WHEN_YOU_COME_BACK")
 			// to a STRING.
+	uint64 startTime = GetPerfCounter ();
+	STRING_CACHE_KEY cacheKey;
+	BOOLEAN haveCacheKey;
 
 	/* Parse out the conversation components. */
 	strncpy (paths, path, 1023);
@@ -183,6 +240,20 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 		}
 	}
 
+	haveCacheKey = getConversationCacheKey (paths, ts_path, &cacheKey);
+	if (haveCacheKey)
+	{
+		result = _LoadCompiledConversation (path, &cacheKey);
+		if (result != NULL)
+		{
+			log_add (log_Info, "\t'%s' -- compiled conversation phrases "
+					"-- loaded in %lu us", paths,
+					perfCounterToUs (GetPerfCounter () - startTime));
+			resdata->ptr = result;
+			return;
+		}
+	}
+
 	fp = res_OpenResFile (contentDir, paths, "rb");
 	if (fp == NULL)
 	{
@@ -209,6 +280,13 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 				path);
 		goto err;
 	}
+
+	reader.pos = MapResFile (fp, dataLen, &map);
+	if (reader.pos == NULL)
+		goto err;
+	reader.end = reader.pos + dataLen;
+	res_CloseResFile (fp);
+	fp = NULL;
 	
 	tot_string_size = POOL_SIZE;
 	strdata = HMalloc (tot_string_size);
@@ -235,8 +313,19 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 
 	if (ts_path)
 	{
-		timestamp_fp = uio_fopen (contentDir, ts_path, "rb");
+		uio_Stream *timestamp_fp = uio_fopen (contentDir, ts_path, "rb");
 		if (timestamp_fp != NULL)
+		{
+			size_t tsLen = LengthResFile (timestamp_fp);
+			if (tsLen > 0)
+			{
+				timestamp_reader.pos = MapResFile (timestamp_fp, tsLen,
+						&timestamp_map);
+				timestamp_reader.end = timestamp_reader.pos + tsLen;
+			}
+			uio_fclose (timestamp_fp);
+		}
+		if (timestamp_map != NULL)
 		{
 			tot_ts_size = POOL_SIZE;
 			ts_data = HMalloc (tot_ts_size);
@@ -245,7 +334,6 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 		}
 	}
 	
-	opos = uio_ftell (fp);
 	stringI = -1;
 	NameOffs = 0;
 	StringOffs = 0;
@@ -255,7 +343,7 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 	{
 		int l;
 
-		if (uio_fgets (CurrentLine, sizeof (CurrentLine), fp) == NULL)
+		if (get_line (&reader, CurrentLine, sizeof (CurrentLine)) == NULL)
 		{
 			// EOF or read error.
 			break;
@@ -303,13 +391,15 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 				nlen[stringI] = l;
 
 				// now lets check for timestamp data
-				if (timestamp_fp)
+				if (timestamp_map)
 				{
 					// We have a time stamp file.
 					char TimeStampLine[1024];
 					char *tsptr;
 					BOOLEAN ts_ok = FALSE;
-					uio_fgets (TimeStampLine, sizeof (TimeStampLine), timestamp_fp);
+					if (get_line (&timestamp_reader, TimeStampLine,
+							sizeof (TimeStampLine)) == NULL)
+						TimeStampLine[0] = '\0';
 					if (TimeStampLine[0] == '#')
 					{
 						// Line is of the following form:
@@ -342,8 +432,8 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 								"for '%s'.  Disabling timestamps", name);
 						HFree (ts_data);
 						ts_data = NULL;
-						uio_fclose (timestamp_fp);
-						timestamp_fp = NULL;
+						UnmapResFile (timestamp_map);
+						timestamp_map = NULL;
 						TSOffs = 0;
 					}
 				}
@@ -384,9 +474,6 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 
 			strcpy (s, CurrentLine);
 		}
-
-		if ((int)uio_ftell (fp) - (int)opos >= (int)dataLen)
-			break;
 	}
 	if (stringI >= 0)
 	{
@@ -399,8 +486,9 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 		}
 	}
 
-	if (timestamp_fp)
-		uio_fclose (timestamp_fp);
+	if (timestamp_map)
+		UnmapResFile (timestamp_map);
+	UnmapResFile (map);
 
 	result = NULL;
 	num_data_sets = (ClipOffs ? 1 : 0) + (TSOffs ? 1 : 0) + 1;
@@ -459,14 +547,24 @@ _GetConversationData (const char *path, RESOURCE_DATA *resdata)
 			}
 
 			lpST->nameIndex = nameHashTable;
+			nameHashTable = NULL;
 		}
 	}
+	if (nameHashTable != NULL)
+		StringHashTable_deleteHashTable (nameHashTable);
 	HFree (strdata);
+	HFree (namedata);
 	if (clipdata != NULL)
 		HFree (clipdata);
 	if (ts_data != NULL)
 		HFree (ts_data);
 
+	log_add (log_Info, "\t%d conversation phrases parsed in %lu us",
+			result ? ((STRING_TABLE) result)->size : 0,
+			perfCounterToUs (GetPerfCounter () - startTime));
+	if (result != NULL && haveCacheKey)
+		_StoreCompiledConversation (path, &cacheKey, result);
+
 	resdata->ptr = result;
 	return;
 
@@ -477,9 +575,16 @@ err:
 		HFree (ts_data);
 	if (clipdata != NULL)
 		HFree (clipdata);
+	if (namedata != NULL)
+		HFree (namedata);
 	if (strdata != NULL)
 		HFree (strdata);
-	res_CloseResFile (fp);
+	if (timestamp_map != NULL)
+		UnmapResFile (timestamp_map);
+	if (map != NULL)
+		UnmapResFile (map);
+	if (fp != NULL)
+		res_CloseResFile (fp);
 	resdata->ptr = NULL;
 }
 
@@ -489,7 +594,8 @@ _GetStringData (uio_Stream *fp, DWORD length)
 	void *result;
 
 	int stringI;
-	DWORD opos;
+	uio_FileMap *map = NULL;
+	TEXT_READER reader;
 	DWORD slen[MAX_STRINGS];
 	DWORD StringOffs;
 	size_t tot_string_size;
@@ -501,14 +607,18 @@ _GetStringData (uio_Stream *fp, DWORD length)
 	if (strdata == 0)
 		goto err;
 
-	opos = uio_ftell (fp);
+	reader.pos = MapResFile (fp, length, &map);
+	if (reader.pos == NULL)
+		goto err;
+	reader.end = reader.pos + length;
+
 	stringI = -1;
 	StringOffs = 0;
 	for (;;)
 	{
 		int l;
 
-		if (uio_fgets (CurrentLine, sizeof (CurrentLine), fp) == NULL)
+		if (get_line (&reader, CurrentLine, sizeof (CurrentLine)) == NULL)
 		{
 			// EOF or read error.
 			break;
@@ -564,9 +674,6 @@ _GetStringData (uio_Stream *fp, DWORD length)
 
 			strcpy (s, CurrentLine);
 		}
-
-		if ((int)uio_ftell (fp) - (int)opos >= (int)length)
-			break;
 	}
 	if (stringI >= 0)
 	{
@@ -593,51 +700,71 @@ _GetStringData (uio_Stream *fp, DWORD length)
 		}
 	}
 	HFree (strdata);
+	UnmapResFile (map);
 
 	return result;
 
 err:
 	if (strdata != NULL)
 		HFree (strdata);
+	if (map != NULL)
+		UnmapResFile (map);
 	return 0;
 }
 
 
+// The file consists of the number of strings, the number of dwords to
+// skip after the table of string lengths, the table of string lengths,
+// and then the strings themselves.
 void *
 _GetBinaryTableData (uio_Stream *fp, DWORD length)
 {
-	void *result;
-	result = GetResourceData (fp, length);
-
-	if (result)
+	uio_FileMap *map;
+	const BYTE *fileData;
+	const BYTE *fileEnd;
+	const BYTE *stringptr;
+	STRING_TABLE lpST;
+	DWORD size;
+	DWORD i;
+
+	fileData = MapResourceData (fp, length, &map);
+	if (fileData == NULL)
+		return NULL;
+	fileEnd = fileData + (length - sizeof (DWORD));
+
+	if (fileEnd - fileData < 2 * 4)
+		goto bad;
+	size = get_dword (fileData);
+	if ((DWORD) (fileEnd - fileData) / 4 - 2 < size)
+		goto bad;
+	stringptr = fileData + 4 * (2 + size);
+	if ((DWORD) (fileEnd - stringptr) / 4 < get_dword (fileData + 4))
+		goto bad;
+	stringptr += 4 * get_dword (fileData + 4);
+
+	lpST = AllocStringTable (size, 0);
+	if (lpST)
 	{
-		DWORD *fileData;
-		STRING_TABLE lpST;
-
-		fileData = (DWORD *)result;
-
-		dword_convert (fileData, 1); /* Length */
-
-		lpST = AllocStringTable (fileData[0], 0);
-		if (lpST)
+		for (i = 0; i < size; i++)
 		{
-			int i, size;
-			BYTE *stringptr;
-
-			size = lpST->size;
-
-			dword_convert (fileData+1, size + 1);
-			stringptr = (BYTE *)(fileData + 2 + size + fileData[1]);
-			for (i = 0; i < size; i++)
+			DWORD len = get_dword (fileData + 4 * (2 + i));
+			if ((DWORD) (fileEnd - stringptr) < len)
 			{
-				set_strtab_entry (lpST, i, (char *)stringptr, fileData[2+i]);
-				stringptr += fileData[2+i];
+				log_add (log_Warning, "Warning: Binary string table is "
+						"truncated.");
+				break;
 			}
+			set_strtab_entry (lpST, i, (const char *) stringptr, len);
+			stringptr += len;
 		}
-		HFree (result);
-		result = lpST;
 	}
 
-	return result;
+	UnmapResFile (map);
+	return lpST;
+
+bad:
+	log_add (log_Warning, "Warning: Bad binary string table header.");
+	UnmapResFile (map);
+	return NULL;
 }
 
@@ -0,0 +1,355 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Compiled conversation string tables.
+// After a conversation has been parsed from its text and timestamp files,
+// the resulting string table is written to a file in the dir set with
+// SetStringTableCacheDir(). The next time the same conversation is
+// loaded, the file is read back with a single read, and the strings are
+// used where they are in the buffer; nothing is parsed or allocated per
+// string, and names are looked up in a hash table that was built when
+// the file was written.
+// A compiled table is identified by the resource path of the
+// conversation, and by the size and modification time of its text and
+// timestamp files.
+//
+// The format of a compiled table (all numbers are little endian):
+//   header:  "UQMs", version (4 bytes), text file size (8), text file
+//            mtime (8), timestamp file size (8), timestamp file mtime (8),
+//            flags (4), string count (4), entry count (4), name bucket
+//            count (4), path length (4), string data size (4)
+//   path:    the resource path ('\0'-terminated)
+//   entries: offset into the string data (4), length (4); first the
+//            strings, then their names, sound clips and timestamps, as
+//            present in the flags, like in a STRING_TABLE
+//   buckets: 0 for an empty bucket, or 1 + the index of a string; open
+//            addressing with linear probing on stringCacheHash() of the
+//            name of the string. The count is a power of two.
+//   data:    the string data
+
+#include "strintrn.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+
+#define STRCACHE_MAGIC "UQMs"
+#define STRCACHE_VERSION 1
+#define STRCACHE_HEADER_SIZE 64
+#define STRCACHE_ENTRY_SIZE 8
+
+static uio_DirHandle *stringCacheDir = NULL;
+
+void
+SetStringTableCacheDir (uio_DirHandle *dir)
+{
+	if (stringCacheDir != NULL)
+		uio_closeDir (stringCacheDir);
+	stringCacheDir = dir;
+}
+
+static inline void
+putUInt (BYTE *buf, uint64 value, int numBytes)
+{
+	int i;
+
+	for (i = 0; i < numBytes; i++)
+	{
+		buf[i] = (BYTE) (value & 0xff);
+		value >>= 8;
+	}
+}
+
+static inline uint64
+getUInt (const BYTE *buf, int numBytes)
+{
+	uint64 result = 0;
+
+	while (numBytes--)
+		result = (result << 8) | buf[numBytes];
+	return result;
+}
+
+// FNV-1a
+static DWORD
+stringCacheHash (const char *str)
+{
+	DWORD hash = 2166136261u;
+
+	while (*str != '\0')
+	{
+		hash ^= (BYTE) *str++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static void
+makeCacheName (const char *path, char *buf, size_t bufSize)
+{
+	snprintf (buf, bufSize, "%08lx.strtab",
+			(unsigned long) stringCacheHash (path));
+}
+
+static DWORD
+nameBucketCount (DWORD numStrings)
+{
+	DWORD count = 8;
+
+	while (count < numStrings * 2)
+		count *= 2;
+	return count;
+}
+
+STRING
+_FindCompiledStringName (STRING_TABLE strtab, const char *name)
+{
+	DWORD mask = strtab->nameBucketCount - 1;
+	DWORD bucketI = stringCacheHash (name) & mask;
+
+	for (;;)
+	{
+		DWORD stringI = (DWORD) getUInt (strtab->nameBuckets + 4 * bucketI, 4);
+		STRING nameStr;
+
+		if (stringI == 0)
+			return NULL;
+		stringI--;
+
+		// Like the name index of parsed tables, this gives the entry
+		// with the name.
+		nameStr = &strtab->strings[strtab->size + stringI];
+		if (nameStr->data != NULL && strcmp (nameStr->data, name) == 0)
+			return nameStr;
+
+		bucketI = (bucketI + 1) & mask;
+	}
+}
+
+STRING_TABLE
+_LoadCompiledConversation (const char *path, const STRING_CACHE_KEY *key)
+{
+	char name[32];
+	uio_Stream *fp;
+	size_t fileSize;
+	BYTE *buf;
+	const BYTE *ptr;
+	DWORD flags;
+	DWORD numStrings;
+	DWORD numEntries;
+	DWORD numBuckets;
+	DWORD pathLen;
+	DWORD dataSize;
+	BYTE *data;
+	STRING_TABLE strtab;
+	DWORD i;
+
+	if (stringCacheDir == NULL)
+		return NULL;
+
+	makeCacheName (path, name, sizeof name);
+	fp = res_OpenResFile (stringCacheDir, name, "rb");
+	if (fp == NULL)
+		return NULL;
+	fileSize = LengthResFile (fp);
+	if (fileSize < STRCACHE_HEADER_SIZE)
+	{
+		res_CloseResFile (fp);
+		uio_unlink (stringCacheDir, name);
+		return NULL;
+	}
+
+	buf = HMalloc (fileSize);
+	if (buf == NULL || ReadResFile (buf, 1, fileSize, fp) != fileSize)
+	{
+		res_CloseResFile (fp);
+		goto bad;
+	}
+	res_CloseResFile (fp);
+
+	if (memcmp (buf, STRCACHE_MAGIC, 4) != 0 ||
+			getUInt (buf + 4, 4) != STRCACHE_VERSION ||
+			getUInt (buf + 8, 8) != key->textSize ||
+			getUInt (buf + 16, 8) != key->textMTime ||
+			getUInt (buf + 24, 8) != key->timestampSize ||
+			getUInt (buf + 32, 8) != key->timestampMTime)
+		goto stale;
+
+	flags = (DWORD) getUInt (buf + 40, 4);
+	numStrings = (DWORD) getUInt (buf + 44, 4);
+	numEntries = (DWORD) getUInt (buf + 48, 4);
+	numBuckets = (DWORD) getUInt (buf + 52, 4);
+	pathLen = (DWORD) getUInt (buf + 56, 4);
+	dataSize = (DWORD) getUInt (buf + 60, 4);
+
+	// Check the entire file before the table is made.
+	if ((flags & ~(HAS_SOUND_CLIPS | HAS_TIMESTAMP)) != HAS_NAMEINDEX ||
+			numStrings == 0 || numStrings > 0xffff ||
+			numEntries != numStrings * _GetStringTableMultiplier (flags) ||
+			numBuckets != nameBucketCount (numStrings) || pathLen == 0 ||
+			(uint64) STRCACHE_HEADER_SIZE + pathLen
+			+ (uint64) numEntries * STRCACHE_ENTRY_SIZE
+			+ (uint64) numBuckets * 4 + dataSize != fileSize)
+		goto bad;
+
+	ptr = buf + STRCACHE_HEADER_SIZE;
+	if (ptr[pathLen - 1] != '\0' || strcmp ((const char *) ptr, path) != 0)
+		goto stale;
+	ptr += pathLen;
+
+	// The strings point into 'buf', which the table keeps.
+	data = buf + STRCACHE_HEADER_SIZE + pathLen
+			+ numEntries * STRCACHE_ENTRY_SIZE + numBuckets * 4;
+	for (i = 0; i < numEntries; i++)
+	{
+		DWORD offset = (DWORD) getUInt (ptr + i * STRCACHE_ENTRY_SIZE, 4);
+		DWORD length = (DWORD) getUInt (ptr + i * STRCACHE_ENTRY_SIZE + 4, 4);
+		if (offset > dataSize || length > dataSize - offset ||
+				(length != 0 && data[offset + length - 1] != '\0'))
+			goto bad;
+	}
+	for (i = 0; i < numBuckets; i++)
+	{
+		if (getUInt (ptr + numEntries * STRCACHE_ENTRY_SIZE + 4 * i, 4)
+				> numStrings)
+			goto bad;
+	}
+
+	strtab = AllocStringTable (numStrings, flags);
+	if (strtab == NULL)
+		goto bad;
+	for (i = 0; i < numEntries; i++)
+	{
+		DWORD offset = (DWORD) getUInt (ptr + i * STRCACHE_ENTRY_SIZE, 4);
+		DWORD length = (DWORD) getUInt (ptr + i * STRCACHE_ENTRY_SIZE + 4, 4);
+		if (length != 0)
+		{
+			strtab->strings[i].data = (STRINGPTR) (data + offset);
+			strtab->strings[i].length = length;
+		}
+	}
+	strtab->blob = buf;
+	strtab->nameBuckets = ptr + numEntries * STRCACHE_ENTRY_SIZE;
+	strtab->nameBucketCount = numBuckets;
+	return strtab;
+
+bad:
+	log_add (log_Warning, "Warning: Ignoring bad compiled string table "
+			"'%s' for '%s'.", name, path);
+stale:
+	if (buf != NULL)
+		HFree (buf);
+	// The caller parses the text and stores a new table, which
+	// uio_rename() would not put in place of this one.
+	uio_unlink (stringCacheDir, name);
+	return NULL;
+}
+
+void
+_StoreCompiledConversation (const char *path, const STRING_CACHE_KEY *key,
+		STRING_TABLE strtab)
+{
+	char name[32];
+	char tempName[40];
+	DWORD numStrings = strtab->size;
+	DWORD numEntries = numStrings * _GetStringTableMultiplier (strtab->flags);
+	DWORD numBuckets = nameBucketCount (numStrings);
+	DWORD pathLen = strlen (path) + 1;
+	DWORD dataSize = 0;
+	size_t fileSize;
+	BYTE *buf;
+	BYTE *entries;
+	BYTE *buckets;
+	BYTE *data;
+	uio_Stream *fp;
+	BOOLEAN ok;
+	DWORD i;
+
+	if (stringCacheDir == NULL || !(strtab->flags & HAS_NAMEINDEX))
+		return;
+
+	for (i = 0; i < numEntries; i++)
+		dataSize += strtab->strings[i].length;
+
+	fileSize = STRCACHE_HEADER_SIZE + pathLen
+			+ numEntries * STRCACHE_ENTRY_SIZE + numBuckets * 4 + dataSize;
+	buf = HCalloc (fileSize);
+	if (buf == NULL)
+		return;
+
+	memcpy (buf, STRCACHE_MAGIC, 4);
+	putUInt (buf + 4, STRCACHE_VERSION, 4);
+	putUInt (buf + 8, key->textSize, 8);
+	putUInt (buf + 16, key->textMTime, 8);
+	putUInt (buf + 24, key->timestampSize, 8);
+	putUInt (buf + 32, key->timestampMTime, 8);
+	putUInt (buf + 40, strtab->flags, 4);
+	putUInt (buf + 44, numStrings, 4);
+	putUInt (buf + 48, numEntries, 4);
+	putUInt (buf + 52, numBuckets, 4);
+	putUInt (buf + 56, pathLen, 4);
+	putUInt (buf + 60, dataSize, 4);
+	memcpy (buf + STRCACHE_HEADER_SIZE, path, pathLen);
+
+	entries = buf + STRCACHE_HEADER_SIZE + pathLen;
+	buckets = entries + numEntries * STRCACHE_ENTRY_SIZE;
+	data = buckets + numBuckets * 4;
+
+	dataSize = 0;
+	for (i = 0; i < numEntries; i++)
+	{
+		STRING str = &strtab->strings[i];
+		putUInt (entries + i * STRCACHE_ENTRY_SIZE, dataSize, 4);
+		putUInt (entries + i * STRCACHE_ENTRY_SIZE + 4, str->length, 4);
+		if (str->length != 0)
+			memcpy (data + dataSize, str->data, str->length);
+		dataSize += str->length;
+	}
+
+	for (i = 0; i < numStrings; i++)
+	{
+		STRING nameStr = &strtab->strings[numStrings + i];
+		DWORD bucketI;
+
+		if (nameStr->data == NULL)
+			continue;
+		bucketI = stringCacheHash (nameStr->data) & (numBuckets - 1);
+		while (getUInt (buckets + 4 * bucketI, 4) != 0)
+			bucketI = (bucketI + 1) & (numBuckets - 1);
+		putUInt (buckets + 4 * bucketI, i + 1, 4);
+	}
+
+	// Write to a temporary file first, so that an interrupted write
+	// does not leave a truncated table behind.
+	makeCacheName (path, name, sizeof name);
+	snprintf (tempName, sizeof tempName, "%s.tmp", name);
+	fp = res_OpenResFile (stringCacheDir, tempName, "wb");
+	if (fp == NULL)
+	{
+		HFree (buf);
+		return;
+	}
+	ok = WriteResFile (buf, 1, fileSize, fp) == fileSize;
+	res_CloseResFile (fp);
+	if (ok)
+	{
+		// uio_rename() does not replace an existing file.
+		uio_unlink (stringCacheDir, name);
+		ok = uio_rename (stringCacheDir, tempName, stringCacheDir,
+				name) == 0;
+	}
+	if (!ok)
+		uio_unlink (stringCacheDir, tempName);
+	HFree (buf);
+}
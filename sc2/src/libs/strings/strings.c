@@ -19,11 +19,10 @@
 #include "strintrn.h"
 #include "libs/memlib.h"
 
-STRING_TABLE
-AllocStringTable (int num_entries, int flags)
+int
+_GetStringTableMultiplier (int flags)
 {
-	STRING_TABLE strtab = HMalloc (sizeof (STRING_TABLE_DESC));
-	int i, multiplier = 1;
+	int multiplier = 1;
 
 	if (flags & HAS_NAMEINDEX)
 	{
@@ -37,9 +36,18 @@ AllocStringTable (int num_entries, int flags)
 	{
 		multiplier++;
 	}
+	return multiplier;
+}
+
+STRING_TABLE
+AllocStringTable (int num_entries, int flags)
+{
+	STRING_TABLE strtab = HMalloc (sizeof (STRING_TABLE_DESC));
+	int i;
+
 	strtab->flags = flags;
 	strtab->size = num_entries;
-	num_entries *= multiplier;
+	num_entries *= _GetStringTableMultiplier (flags);
 	strtab->strings = HMalloc (sizeof (STRING_TABLE_ENTRY_DESC) * num_entries);
 	for (i = 0; i < num_entries; i++)
 	{
@@ -49,34 +57,42 @@ AllocStringTable (int num_entries, int flags)
 		strtab->strings[i].index = i;
 	}
 	strtab->nameIndex = NULL;
+	strtab->blob = NULL;
+	strtab->nameBuckets = NULL;
+	strtab->nameBucketCount = 0;
 	return strtab;
 }
 
 void
 FreeStringTable (STRING_TABLE strtab)
 {
-	int i, multiplier = 1;
+	int i, num_entries;
 
 	if (strtab == NULL)
 	{
 		return;
 	}
 
-	if (strtab->flags & HAS_SOUND_CLIPS)
+	if (strtab->blob != NULL)
 	{
-		multiplier++;
+		HFree (strtab->blob);
 	}
-	if (strtab->flags & HAS_TIMESTAMP)
+	else
 	{
-		multiplier++;
+		num_entries = strtab->size
+				* _GetStringTableMultiplier (strtab->flags);
+		for (i = 0; i < num_entries; i++)
+		{
+			if (strtab->strings[i].data != NULL)
+			{
+				HFree (strtab->strings[i].data);
+			}
+		}
 	}
 
-	for (i = 0; i < strtab->size * multiplier; i++)
+	if (strtab->nameIndex != NULL)
 	{
-		if (strtab->strings[i].data != NULL)
-		{
-			HFree (strtab->strings[i].data);
-		}
+		StringHashTable_deleteHashTable (strtab->nameIndex);
 	}
 
 	HFree (strtab->strings);
@@ -341,6 +357,8 @@ GetStringAddress (STRING String)
 STRING
 GetStringByName (STRING_TABLE StringTable, const char *index)
 {
+	if (StringTable->nameBuckets != NULL)
+		return _FindCompiledStringName (StringTable, index);
 	return (STRING) StringHashTable_find (StringTable->nameIndex, index);
 }
 
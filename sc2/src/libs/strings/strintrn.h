@@ -39,14 +39,38 @@ struct string_table
 	int size;
 	STRING_TABLE_ENTRY_DESC *strings;
 	StringHashTable_HashTable *nameIndex;
+	void *blob;
+			// For a compiled table, the buffer that all strings point
+			// into. It is freed with the table.
+	const BYTE *nameBuckets;
+	DWORD nameBucketCount;
+			// For a compiled table, the name index; see strcache.c.
 };
 
 #define HAS_SOUND_CLIPS  (1 << 0)
 #define HAS_TIMESTAMP    (1 << 1)
 #define HAS_NAMEINDEX    (1 << 2)
 
+// Identifies the version of the files that a conversation was parsed from.
+typedef struct
+{
+	uint64 textSize;
+	uint64 textMTime;
+	uint64 timestampSize;
+	uint64 timestampMTime;
+			// 0 if there is no timestamp file
+} STRING_CACHE_KEY;
+
 STRING_TABLE AllocStringTable (int num_entries, int flags);
 void FreeStringTable (STRING_TABLE strtab);
+// The number of entries per string for a table with these flags.
+int _GetStringTableMultiplier (int flags);
+
+STRING_TABLE _LoadCompiledConversation (const char *path,
+		const STRING_CACHE_KEY *key);
+void _StoreCompiledConversation (const char *path,
+		const STRING_CACHE_KEY *key, STRING_TABLE strtab);
+STRING _FindCompiledStringName (STRING_TABLE strtab, const char *name);
 
 void *_GetStringData (uio_Stream *fp, DWORD length);
 void *_GetBinaryTableData (uio_Stream *fp, DWORD length);
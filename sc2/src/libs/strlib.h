@@ -62,6 +62,10 @@ extern STRINGPTR GetStringSoundClip (STRING String);
 extern STRINGPTR GetStringTimeStamp (STRING String);
 extern STRING GetStringByName (STRING_TABLE StringTable, const char *index);
 
+// Compiled conversation string tables are kept in this dir; NULL to not
+// keep them. The dir handle is closed when it is replaced.
+extern void SetStringTableCacheDir (uio_DirHandle *dir);
+
 #define UNICHAR_DEGREE_SIGN   0x00b0
 #define STR_DEGREE_SIGN     "\xC2\xB0"
 #define UNICHAR_INFINITY_SIGN 0x221e
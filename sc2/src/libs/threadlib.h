@@ -163,6 +163,9 @@ void PrintThreadsStats (void);
 
 void DestroySemaphore (Semaphore sem);
 void SetSemaphore (Semaphore sem);
+// As SetSemaphore(), but gives up at wakeTime. Returns TRUE if the
+// semaphore was acquired.
+BOOLEAN SetSemaphoreUntil (Semaphore sem, TimeCount wakeTime);
 void ClearSemaphore (Semaphore sem);
 
 void DestroyMutex (Mutex sem);
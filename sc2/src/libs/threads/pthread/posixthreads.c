@@ -21,11 +21,32 @@
 #include "posixthreads.h"
 #include <pthread.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 
 #include <semaphore.h>
 
 #include "libs/log/uqmlog.h"
 
+// sem_clockwait() can wait on CLOCK_MONOTONIC, as GetTimeCounter() counts.
+// sem_timedwait() waits on CLOCK_REALTIME, which may be set forward or back
+// while waiting.
+#ifndef HAVE_SEM_CLOCKWAIT
+#	if defined(__GLIBC__) && (__GLIBC__ > 2 || \
+			(__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+#		define HAVE_SEM_CLOCKWAIT 1
+#	else
+#		define HAVE_SEM_CLOCKWAIT 0
+#	endif
+#endif
+
+#if !HAVE_SEM_CLOCKWAIT
+// The longest that one sem_timedwait() waits. The time left is then
+// checked against GetTimeCounter() and the wait is continued, so that a
+// real-time clock that is set back delays a wakeup by at most this long.
+#	define SEM_WAIT_SLICE (ONE_SECOND / 10)
+#endif
+
 typedef struct _thread {
 	pthread_t native;
 #ifdef NAMED_SYNCHRO
@@ -161,6 +182,8 @@ ThreadHelper (void *startInfo) {
 	UnQueueThread (thread);
 	DestroyThreadLocal (thread->localData);
 	FinishThread (thread);
+	mem_threadCleanup ();
+	log_threadCleanup ();
 	/* Destroying the thread is the responsibility of ProcessThreadLifecycles() */
 	return (void*)result;
 }
@@ -258,11 +281,7 @@ SleepThreadUntil_PT (TimeCount wakeTime) {
 
 void
 TaskSwitch_PT (void) {
-#ifdef EMSCRIPTEN
-	TaskSwitch_Emscripten ();
-#else
 	usleep (1000);
-#endif
 }
 
 void
@@ -475,6 +494,52 @@ SetSemaphore_PT (Semaphore s)
 #endif
 }
 
+BOOLEAN
+SetSemaphoreUntil_PT (Semaphore s, TimeCount wakeTime)
+{
+	Sem *sem = (Sem *)s;
+	TimeCount now;
+	TimeCount wait;
+	struct timespec ts;
+
+	for (;;)
+	{
+		int result;
+
+		now = GetTimeCounter ();
+		if ((sint32) (wakeTime - now) <= 0)
+			return sem_trywait (&sem->sem) == 0;
+
+		wait = wakeTime - now;
+#if HAVE_SEM_CLOCKWAIT
+		clock_gettime (CLOCK_MONOTONIC, &ts);
+#else
+		if (wait > SEM_WAIT_SLICE)
+			wait = SEM_WAIT_SLICE;
+		clock_gettime (CLOCK_REALTIME, &ts);
+#endif
+		ts.tv_sec += wait / ONE_SECOND;
+		ts.tv_nsec += (long) (wait % ONE_SECOND) * (1000000000 / ONE_SECOND);
+		if (ts.tv_nsec >= 1000000000)
+		{
+			ts.tv_nsec -= 1000000000;
+			ts.tv_sec++;
+		}
+
+#if HAVE_SEM_CLOCKWAIT
+		result = sem_clockwait (&sem->sem, CLOCK_MONOTONIC, &ts);
+#else
+		result = sem_timedwait (&sem->sem, &ts);
+#endif
+		if (result == 0)
+			return TRUE;
+		// On ETIMEDOUT, the time left is checked again; the clocks may
+		// disagree, and a slice may have ended.
+		if (errno != ETIMEDOUT && errno != EINTR)
+			TaskSwitch_PT ();
+	}
+}
+
 void
 ClearSemaphore_PT (Semaphore s)
 {
@@ -53,6 +53,7 @@ void UnlockMutex_PT (Mutex m);
 
 void DestroySemaphore_PT (Semaphore sem);
 void SetSemaphore_PT (Semaphore sem);
+BOOLEAN SetSemaphoreUntil_PT (Semaphore sem, TimeCount wakeTime);
 void ClearSemaphore_PT (Semaphore sem);
 
 void DestroyCondVar_PT (CondVar c);
@@ -85,6 +86,7 @@ int  GetRecursiveMutexDepth_PT (RecursiveMutex m);
 #define NativeCreateSemaphore CreateSemaphore_PT
 #define NativeDestroySemaphore DestroySemaphore_PT
 #define NativeSetSemaphore SetSemaphore_PT
+#define NativeSetSemaphoreUntil SetSemaphoreUntil_PT
 #define NativeClearSemaphore ClearSemaphore_PT
 
 #define NativeCreateCondVar CreateCondVar_PT
@@ -225,6 +225,8 @@ ThreadHelper (void *startInfo) {
 	UnQueueThread (thread);
 	DestroyThreadLocal (thread->localData);
 	FinishThread (thread);
+	mem_threadCleanup ();
+	log_threadCleanup ();
 	/* Destroying the thread is the responsibility of ProcessThreadLifecycles() */
 	return result;
 }
@@ -317,11 +319,7 @@ SleepThreadUntil_SDL (TimeCount wakeTime) {
 
 void
 TaskSwitch_SDL (void) {
-#ifdef EMSCRIPTEN
-	TaskSwitch_Emscripten ();
-#else
 	SDL_Delay (1);
-#endif
 }
 
 void
@@ -512,6 +510,30 @@ SetSemaphore_SDL (Semaphore s)
 #endif
 }
 
+BOOLEAN
+SetSemaphoreUntil_SDL (Semaphore s, TimeCount wakeTime)
+{
+	Sem *sem = (Sem *)s;
+	TimeCount now;
+	int result;
+
+	for (;;)
+	{
+		now = GetTimeCounter ();
+		if ((sint32) (wakeTime - now) <= 0)
+			return SDL_SemTryWait (sem->sem) == 0;
+
+		result = SDL_SemWaitTimeout (sem->sem,
+				(wakeTime - now) * 1000 / ONE_SECOND);
+		if (result == 0)
+			return TRUE;
+		// On a timeout, the time left is checked again; the wait was
+		// rounded down to whole milliseconds.
+		if (result != SDL_MUTEX_TIMEDOUT)
+			TaskSwitch_SDL ();
+	}
+}
+
 void
 ClearSemaphore_SDL (Semaphore s)
 {
@@ -56,6 +56,7 @@ void UnlockMutex_SDL (Mutex m);
 
 void DestroySemaphore_SDL (Semaphore sem);
 void SetSemaphore_SDL (Semaphore sem);
+BOOLEAN SetSemaphoreUntil_SDL (Semaphore sem, TimeCount wakeTime);
 void ClearSemaphore_SDL (Semaphore sem);
 
 void DestroyCondVar_SDL (CondVar c);
@@ -88,6 +89,7 @@ int  GetRecursiveMutexDepth_SDL (RecursiveMutex m);
 #define NativeCreateSemaphore CreateSemaphore_SDL
 #define NativeDestroySemaphore DestroySemaphore_SDL
 #define NativeSetSemaphore SetSemaphore_SDL
+#define NativeSetSemaphoreUntil SetSemaphoreUntil_SDL
 #define NativeClearSemaphore ClearSemaphore_SDL
 
 #define NativeCreateCondVar CreateCondVar_SDL
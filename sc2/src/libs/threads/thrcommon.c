@@ -16,9 +16,6 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#ifdef EMSCRIPTEN
-#include <emscripten.h>
-#endif
 
 #include "libs/threadlib.h"
 #include "libs/timelib.h"
@@ -400,6 +397,12 @@ SetSemaphore (Semaphore sem)
 	NativeSetSemaphore (sem);
 }
 
+BOOLEAN
+SetSemaphoreUntil (Semaphore sem, TimeCount wakeTime)
+{
+	return NativeSetSemaphoreUntil (sem, wakeTime);
+}
+
 void
 ClearSemaphore (Semaphore sem)
 {
@@ -453,13 +456,3 @@ GetRecursiveMutexDepth (RecursiveMutex mutex)
 {
 	return NativeGetRecursiveMutexDepth (mutex);
 }
-
-#ifdef EMSCRIPTEN
-/* Emscripten needs special treatment to convert synchronous code to async.
- * See https://emscripten.org/docs/porting/asyncify.html
- */
-void
-TaskSwitch_Emscripten (void) {
-	emscripten_sleep (1);
-}
-#endif
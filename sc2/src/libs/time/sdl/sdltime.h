@@ -29,6 +29,17 @@
 extern Uint32 SDLWrapper_GetTimeCounter (void);
 #define NativeGetTimeCounter() \
 		SDLWrapper_GetTimeCounter ()
+#if SDL_MAJOR_VERSION == 1
+#	define NativeGetPerfCounter() \
+		((uint64) SDL_GetTicks ())
+#	define NativeGetPerfFrequency() \
+		((uint64) 1000)
+#else
+#	define NativeGetPerfCounter() \
+		((uint64) SDL_GetPerformanceCounter ())
+#	define NativeGetPerfFrequency() \
+		((uint64) SDL_GetPerformanceFrequency ())
+#endif
 
 
 #endif  /* LIBS_TIME_SDL_SDLTIME_H_ */
@@ -39,3 +39,15 @@ GetTimeCounter (void)
 	return NativeGetTimeCounter ();
 }
 
+uint64
+GetPerfCounter (void)
+{
+	return NativeGetPerfCounter ();
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return NativeGetPerfFrequency ();
+}
+
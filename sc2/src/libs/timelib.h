@@ -42,6 +42,13 @@ extern void InitTimeSystem (void);
 extern void UnInitTimeSystem (void);
 extern TimeCount GetTimeCounter (void);
 
+/* A high resolution counter, for measuring how long things take.
+ * It is unrelated to TimeCount; only differences between two values
+ * are meaningful. GetPerfFrequency() returns the number of counts
+ * per second. */
+extern uint64 GetPerfCounter (void);
+extern uint64 GetPerfFrequency (void);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -25,12 +25,18 @@ extern uio_FileSystemHandler stdio_fileSystemHandler;
 #ifdef HAVE_ZIP
 extern uio_FileSystemHandler zip_fileSystemHandler;
 #endif
+#ifdef HAVE_HTTP
+extern uio_FileSystemHandler http_fileSystemHandler;
+#endif
 
 const uio_DefaultFileSystemSetup defaultFileSystems[] = {
 	{ uio_FSTYPE_STDIO, "stdio", &stdio_fileSystemHandler },
 #ifdef HAVE_ZIP
 	{ uio_FSTYPE_ZIP, "zip", &zip_fileSystemHandler },
 #endif
+#ifdef HAVE_HTTP
+	{ uio_FSTYPE_HTTP, "http", &http_fileSystemHandler },
+#endif
 };
 
 int
@@ -24,6 +24,7 @@
 typedef int uio_FileSystemID;
 #define uio_FSTYPE_STDIO 1
 #define uio_FSTYPE_ZIP   2
+#define uio_FSTYPE_HTTP  3
 
 
 #ifdef uio_INTERNAL
@@ -76,6 +77,11 @@ struct uio_FileSystemHandler {
 	off_t             (*seek)     (uio_Handle *, off_t, int);
 	ssize_t           (*write)    (uio_Handle *, const void *, size_t);
 	int               (*unlink)   (uio_PDirHandle *, const char *);
+	int               (*map)      (uio_Handle *, off_t, size_t,
+			struct uio_FileMap *);
+			// Map part of a file into memory, read-only. NULL if the
+			// file system can't do this without copying the data.
+	int               (*unmap)    (struct uio_FileMap *);
 
 	uio_NativeEntriesContext (*openEntries) (uio_PDirHandle *);
 	int               (*readEntries) (uio_NativeEntriesContext *, char *,
@@ -0,0 +1,325 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ * Nota bene: later versions of the GNU General Public License do not apply
+ * to this program.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Transport for the http file system.
+// In the wasm build this uses the Emscripten fetch API (which needs
+// -s FETCH). Elsewhere a minimal HTTP/1.0 client is used, which only
+// understands plain "http://host[:port]/path" URLs; it is meant for
+// testing against a local server.
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+
+#include "fetch.h"
+#include "../mem.h"
+
+#ifdef EMSCRIPTEN
+#	include <emscripten/fetch.h>
+#elif !defined(WIN32)
+#	include <sys/types.h>
+#	include <sys/socket.h>
+#	include <netdb.h>
+#	include <unistd.h>
+#	include <stdlib.h>
+#endif
+
+#define RANGE_HEADER_SIZE 64
+
+static void
+http_makeRange(char *buf, size_t bufSize, off_t offset, size_t size) {
+	snprintf(buf, bufSize, "bytes=%lu-%lu", (unsigned long) offset,
+			(unsigned long) (offset + size - 1));
+}
+
+#ifdef EMSCRIPTEN
+ssize_t
+http_fetchRange(const char *url, off_t offset, size_t size, char *buf) {
+	emscripten_fetch_attr_t attr;
+	emscripten_fetch_t *fetch;
+	char range[RANGE_HEADER_SIZE];
+	const char *headers[3];
+	ssize_t result;
+
+	http_makeRange(range, sizeof range, offset, size);
+	headers[0] = "Range";
+	headers[1] = range;
+	headers[2] = NULL;
+
+	emscripten_fetch_attr_init(&attr);
+	strcpy(attr.requestMethod, "GET");
+	attr.attributes = EMSCRIPTEN_FETCH_LOAD_TO_MEMORY |
+			EMSCRIPTEN_FETCH_SYNCHRONOUS;
+	attr.requestHeaders = headers;
+
+	fetch = emscripten_fetch(&attr, url);
+	if (fetch == NULL) {
+		errno = EIO;
+		return -1;
+	}
+
+	if (fetch->status == 206) {
+		result = fetch->numBytes < size ? fetch->numBytes : size;
+		memcpy(buf, fetch->data, result);
+	} else if (fetch->status == 200) {
+		// The server ignored the range; the whole resource was sent.
+		if ((off_t) fetch->numBytes <= offset) {
+			result = 0;
+		} else {
+			result = fetch->numBytes - offset;
+			if ((size_t) result > size)
+				result = size;
+			memcpy(buf, fetch->data + offset, result);
+		}
+	} else if (fetch->status == 416) {
+		// Range not satisfiable; reading past the end.
+		result = 0;
+	} else {
+		fprintf(stderr, "Warning: Fetching '%s' failed with HTTP status "
+				"%d.\n", url, (int) fetch->status);
+		errno = fetch->status == 404 ? ENOENT : EIO;
+		result = -1;
+	}
+
+	emscripten_fetch_close(fetch);
+	return result;
+}
+
+#elif !defined(WIN32)
+
+// Splits "http://host[:port]/path" into its parts. 'host' and 'port'
+// must be freed by the caller. '*path' points into 'url'.
+static int
+http_splitURL(const char *url, char **host, char **port, const char **path) {
+	const char *hostStart, *hostEnd, *portStart;
+
+	if (strncmp(url, "http://", 7) != 0) {
+		errno = EPROTONOSUPPORT;
+		return -1;
+	}
+	hostStart = url + 7;
+	*path = strchr(hostStart, '/');
+	if (*path == NULL)
+		*path = hostStart + strlen(hostStart);
+	hostEnd = *path;
+	portStart = memchr(hostStart, ':', hostEnd - hostStart);
+	if (portStart != NULL) {
+		*port = uio_memdup0(portStart + 1, hostEnd - portStart - 1);
+		hostEnd = portStart;
+	} else {
+		*port = uio_strdup("80");
+	}
+	*host = uio_memdup0(hostStart, hostEnd - hostStart);
+	return 0;
+}
+
+static int
+http_connect(const char *host, const char *port) {
+	struct addrinfo hints, *info, *ai;
+	int fd;
+
+	memset(&hints, '\0', sizeof hints);
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &info) != 0) {
+		errno = EHOSTUNREACH;
+		return -1;
+	}
+
+	fd = -1;
+	for (ai = info; ai != NULL; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd == -1)
+			continue;
+		if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		close(fd);
+		fd = -1;
+	}
+	freeaddrinfo(info);
+	return fd;
+}
+
+static int
+http_sendAll(int fd, const char *buf, size_t len) {
+	while (len > 0) {
+		ssize_t numSent = send(fd, buf, len, 0);
+		if (numSent == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += numSent;
+		len -= numSent;
+	}
+	return 0;
+}
+
+static ssize_t
+http_recvAll(int fd, char *buf, size_t len) {
+	size_t total = 0;
+
+	while (total < len) {
+		ssize_t numRead = recv(fd, buf + total, len - total, 0);
+		if (numRead == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (numRead == 0)
+			break;
+		total += numRead;
+	}
+	return total;
+}
+
+ssize_t
+http_fetchRange(const char *url, off_t offset, size_t size, char *buf) {
+	char *host, *port;
+	const char *path;
+	char *request;
+	size_t requestSize;
+	char range[RANGE_HEADER_SIZE];
+	char header[4096];
+	size_t headerFill;
+	char *bodyStart;
+	int status;
+	off_t skip;
+	size_t bodyInHeader;
+	ssize_t result;
+	int fd;
+
+	if (http_splitURL(url, &host, &port, &path) == -1)
+		return -1;
+
+	fd = http_connect(host, port);
+	if (fd == -1) {
+		uio_free(host);
+		uio_free(port);
+		errno = ECONNREFUSED;
+		return -1;
+	}
+
+	http_makeRange(range, sizeof range, offset, size);
+	requestSize = strlen(path) + strlen(host) + strlen(range) + 64;
+	request = uio_malloc(requestSize);
+	snprintf(request, requestSize, "GET %s HTTP/1.0\r\nHost: %s\r\n"
+			"Range: %s\r\n\r\n", path[0] == '\0' ? "/" : path, host, range);
+	uio_free(host);
+	uio_free(port);
+	if (http_sendAll(fd, request, strlen(request)) == -1) {
+		int savedErrno = errno;
+		uio_free(request);
+		close(fd);
+		errno = savedErrno;
+		return -1;
+	}
+	uio_free(request);
+
+	// Read until the end of the response header.
+	headerFill = 0;
+	bodyStart = NULL;
+	while (bodyStart == NULL) {
+		ssize_t numRead;
+
+		if (headerFill == sizeof header - 1)
+			goto badResponse;
+		numRead = recv(fd, header + headerFill,
+				sizeof header - 1 - headerFill, 0);
+		if (numRead == -1 && errno == EINTR)
+			continue;
+		if (numRead <= 0)
+			goto badResponse;
+		headerFill += numRead;
+		header[headerFill] = '\0';
+		bodyStart = strstr(header, "\r\n\r\n");
+	}
+	bodyStart += 4;
+	bodyInHeader = header + headerFill - bodyStart;
+
+	if (sscanf(header, "HTTP/%*d.%*d %d", &status) != 1)
+		goto badResponse;
+	if (status == 206) {
+		skip = 0;
+	} else if (status == 200) {
+		// The server ignored the range; skip to the part we want.
+		skip = offset;
+	} else if (status == 416) {
+		close(fd);
+		return 0;
+	} else {
+		fprintf(stderr, "Warning: Fetching '%s' failed with HTTP status "
+				"%d.\n", url, status);
+		close(fd);
+		errno = status == 404 ? ENOENT : EIO;
+		return -1;
+	}
+
+	// Body data that came along with the header.
+	if ((off_t) bodyInHeader <= skip) {
+		skip -= bodyInHeader;
+		bodyInHeader = 0;
+	} else {
+		bodyStart += skip;
+		bodyInHeader -= skip;
+		skip = 0;
+	}
+	if (bodyInHeader > size)
+		bodyInHeader = size;
+	memcpy(buf, bodyStart, bodyInHeader);
+
+	while (skip > 0) {
+		char discard[4096];
+		ssize_t numRead = http_recvAll(fd, discard,
+				skip < (off_t) sizeof discard ? (size_t) skip :
+				sizeof discard);
+		if (numRead <= 0) {
+			close(fd);
+			return numRead;
+		}
+		skip -= numRead;
+	}
+
+	result = http_recvAll(fd, buf + bodyInHeader, size - bodyInHeader);
+	close(fd);
+	if (result == -1)
+		return -1;
+	return bodyInHeader + result;
+
+badResponse:
+	fprintf(stderr, "Warning: Bad HTTP response while fetching '%s'.\n",
+			url);
+	close(fd);
+	errno = EIO;
+	return -1;
+}
+
+#else  /* WIN32 */
+
+ssize_t
+http_fetchRange(const char *url, off_t offset, size_t size, char *buf) {
+	(void) url;
+	(void) offset;
+	(void) size;
+	(void) buf;
+	errno = ENOSYS;
+	return -1;
+}
+
+#endif
+
@@ -0,0 +1,34 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ * Nota bene: later versions of the GNU General Public License do not apply
+ * to this program.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef LIBS_UIO_HTTP_FETCH_H_
+#define LIBS_UIO_HTTP_FETCH_H_
+
+#include <sys/types.h>
+#include "../uioport.h"
+
+// Fetch the bytes [offset, offset + size) of the resource at 'url' into
+// 'buf'. Blocks until the data is there; this must not be called from
+// the browser main thread in the wasm build.
+// Returns the number of bytes fetched (less than 'size' only at the end
+// of the resource), or -1 on error, with errno set.
+ssize_t http_fetchRange(const char *url, off_t offset, size_t size,
+		char *buf);
+
+#endif  /* LIBS_UIO_HTTP_FETCH_H_ */
+
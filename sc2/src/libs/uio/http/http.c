@@ -0,0 +1,892 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ * Nota bene: later versions of the GNU General Public License do not apply
+ * to this program.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// A read-only file system of which the files are fetched over HTTP on
+// first access. See http.h for the manifest format.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef EMSCRIPTEN
+#	include <emscripten.h>
+#endif
+
+#include "http.h"
+#include "fetch.h"
+#include "../physical.h"
+#include "../uioport.h"
+#include "../paths.h"
+#include "../uioutils.h"
+#ifdef uio_MEM_DEBUG
+#	include "../memdebug.h"
+#endif
+
+#define http_MANIFEST_MAGIC "# uqm content manifest 1"
+
+#ifdef EMSCRIPTEN
+// Persisted blocks only reach IndexedDB when the file system is synced.
+// Do so after this many bytes have been written to the persistent cache.
+#	define http_PERSIST_SYNC_BYTES (1024 * 1024)
+#endif
+
+struct http_Block {
+	http_GPFileData *file;
+	uio_uint32 index;
+	size_t size;
+	http_Block *prev;
+	http_Block *next;
+			// LRU list; 'next' is the less recently used one.
+	// The data follows the structure.
+};
+
+static int http_init(void);
+static int http_unInit(void);
+static int http_fillDirStructure(uio_GPDir *top, http_GPRootData *rootData,
+		char *manifest);
+static int http_foundFile(uio_GPDir *gPDir, const char *path,
+		http_GPFileData *gPFileData);
+static ssize_t http_readBlock(http_GPFileData *fileData, uio_uint32 index,
+		size_t blockOffset, char *buf, size_t count);
+static http_Block *http_fetchBlock(http_GPFileData *fileData,
+		uio_uint32 index);
+static char *http_makeURL(const http_GPRootData *rootData,
+		const char *path);
+static void http_makePersistName(const http_GPFileData *fileData,
+		uio_uint32 index, char *buf, size_t bufSize);
+static ssize_t http_loadPersisted(const http_GPFileData *fileData,
+		uio_uint32 index, char *buf, size_t size);
+static void http_storePersisted(const http_GPFileData *fileData,
+		uio_uint32 index, const char *buf, size_t size);
+static void http_Block_unlink(http_Block *block);
+static void http_Block_linkFront(http_Block *block);
+static void http_evict(size_t needed);
+
+static inline http_GPRootData *http_GPRootData_new(char *baseURL);
+static void http_GPRootData_delete(http_GPRootData *rootData);
+static inline http_GPFileData *http_GPFileData_new(
+		const http_GPRootData *root, char *path, off_t size, time_t mtime);
+static void http_GPFileData_delete(http_GPFileData *gPFileData);
+static inline http_Block *http_Block_new(http_GPFileData *file,
+		uio_uint32 index, size_t size);
+static inline void http_Block_delete(http_Block *block);
+
+uio_FileSystemHandler http_fileSystemHandler = {
+	/* .init    = */  http_init,
+	/* .unInit  = */  http_unInit,
+	/* .cleanup = */  NULL,
+
+	/* .mount  = */  http_mount,
+	/* .umount = */  uio_GPRoot_umount,
+
+	/* .access = */  http_access,
+	/* .close  = */  http_close,
+	/* .fstat  = */  http_fstat,
+	/* .stat   = */  http_stat,
+	/* .mkdir  = */  NULL,
+	/* .open   = */  http_open,
+	/* .read   = */  http_read,
+	/* .rename = */  NULL,
+	/* .rmdir  = */  NULL,
+	/* .seek   = */  http_seek,
+	/* .write  = */  NULL,
+	/* .unlink = */  NULL,
+	/* .map    = */  NULL,
+	/* .unmap  = */  NULL,
+
+	/* .openEntries  = */  uio_GPDir_openEntries,
+	/* .readEntries  = */  uio_GPDir_readEntries,
+	/* .closeEntries = */  uio_GPDir_closeEntries,
+
+	/* .getPDirEntryHandle     = */  uio_GPDir_getPDirEntryHandle,
+	/* .deletePRootExtra       = */  uio_GPRoot_delete,
+	/* .deletePDirHandleExtra  = */  uio_GPDirHandle_delete,
+	/* .deletePFileHandleExtra = */  uio_GPFileHandle_delete,
+};
+
+uio_GPRoot_Operations http_GPRootOperations = {
+	/* .fillGPDir         = */  NULL,
+	/* .deleteGPRootExtra = */  http_GPRootData_delete,
+	/* .deleteGPDirExtra  = */  NULL,
+	/* .deleteGPFileExtra = */  http_GPFileData_delete,
+};
+
+
+// The block cache is shared between all threads and all mounted http
+// file systems; everything below is protected by cacheMutex.
+static pthread_mutex_t cacheMutex;
+static http_Block *cacheFront = NULL;
+static http_Block *cacheBack = NULL;
+static size_t cacheUsed = 0;
+static size_t cacheLimit = uio_HTTP_DEFAULT_CACHE_SIZE;
+static uio_DirHandle *persistDir = NULL;
+#ifdef EMSCRIPTEN
+static size_t persistUnsynced = 0;
+#endif
+
+static struct {
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long persistHits;
+	unsigned long long bytesFetched;
+	unsigned long evictions;
+} cacheStats;
+
+
+static int
+http_init(void) {
+	pthread_mutex_init(&cacheMutex, NULL);
+	memset(&cacheStats, '\0', sizeof cacheStats);
+	return 0;
+}
+
+static int
+http_unInit(void) {
+	// All mounts are gone by now, and with them all cached blocks.
+	assert(cacheFront == NULL);
+#ifdef DEBUG
+	fprintf(stderr, "http cache: %lu hits, %lu misses (%lu from the "
+			"persistent cache), %llu bytes fetched, %lu evictions.\n",
+			cacheStats.hits, cacheStats.misses, cacheStats.persistHits,
+			cacheStats.bytesFetched, cacheStats.evictions);
+#endif
+	if (persistDir != NULL) {
+		uio_DirHandle_unref(persistDir);
+		persistDir = NULL;
+	}
+	pthread_mutex_destroy(&cacheMutex);
+	return 0;
+}
+
+void
+uio_setHttpCacheOptions(size_t memoryLimit, uio_DirHandle *dir) {
+	pthread_mutex_lock(&cacheMutex);
+	cacheLimit = memoryLimit;
+	if (persistDir != NULL)
+		uio_DirHandle_unref(persistDir);
+	persistDir = dir;
+	if (persistDir != NULL)
+		uio_DirHandle_ref(persistDir);
+	http_evict(0);
+	pthread_mutex_unlock(&cacheMutex);
+}
+
+void
+http_close(uio_Handle *handle) {
+	http_Handle *httpHandle;
+
+	httpHandle = handle->native;
+	uio_GPFile_unref(httpHandle->file);
+	uio_free(httpHandle);
+}
+
+static void
+http_fillStat(struct stat *statBuf, const http_GPFileData *gPFileData) {
+	memset(statBuf, '\0', sizeof (struct stat));
+	statBuf->st_size = gPFileData->size;
+	statBuf->st_mode = S_IFREG | S_IRUSR | S_IRGRP | S_IROTH;
+	statBuf->st_atime = gPFileData->mtime;
+	statBuf->st_mtime = gPFileData->mtime;
+	statBuf->st_ctime = gPFileData->mtime;
+}
+
+int
+http_access(uio_PDirHandle *pDirHandle, const char *name, int mode) {
+	if (!(name[0] == '.' && name[1] == '\0') &&
+			uio_GPDir_getGPDirEntry(pDirHandle->extra, name) == NULL) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (mode & W_OK) {
+		errno = EACCES;
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+http_fstat(uio_Handle *handle, struct stat *statBuf) {
+	http_fillStat(statBuf, handle->native->file->extra);
+	return 0;
+}
+
+int
+http_stat(uio_PDirHandle *pDirHandle, const char *name,
+		struct stat *statBuf) {
+	uio_GPDirEntry *entry;
+
+	if (name[0] == '.' && name[1] == '\0') {
+		entry = (uio_GPDirEntry *) pDirHandle->extra;
+	} else {
+		entry = uio_GPDir_getGPDirEntry(pDirHandle->extra, name);
+		if (entry == NULL) {
+			errno = ENOENT;
+			return -1;
+		}
+	}
+
+	if (uio_GPDirEntry_isDir(entry)) {
+		memset(statBuf, '\0', sizeof (struct stat));
+		statBuf->st_mode = S_IFDIR | S_IRUSR | S_IXUSR |
+				S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH;
+		return 0;
+	}
+
+	http_fillStat(statBuf, (http_GPFileData *) entry->extra);
+	return 0;
+}
+
+/*
+ * Function name: http_open
+ * Description:   open a file in an http file system. No data is fetched
+ *                until the file is read from.
+ * Arguments:     pDirHandle - handle to the dir where to open the file
+ *                name - the name of the file to open
+ *                flags - flags, as to stdio open()
+ *                mode - mode, as to stdio open()
+ * Returns:       handle, for use in functions accessing the opened file.
+ *                If failed, errno is set and NULL is returned.
+ */
+uio_Handle *
+http_open(uio_PDirHandle *pDirHandle, const char *name, int flags,
+		mode_t mode) {
+	http_Handle *handle;
+	uio_GPFile *gPFile;
+
+	if ((flags & O_ACCMODE) != O_RDONLY) {
+		errno = EACCES;
+		return NULL;
+	}
+
+	gPFile = (uio_GPFile *) uio_GPDir_getGPDirEntry(pDirHandle->extra, name);
+	if (gPFile == NULL) {
+		errno = ENOENT;
+		return NULL;
+	}
+
+	handle = uio_malloc(sizeof (http_Handle));
+	uio_GPFile_ref(gPFile);
+	handle->file = gPFile;
+	handle->offset = 0;
+
+	(void) mode;
+	return uio_Handle_new(pDirHandle->pRoot, handle, flags);
+}
+
+ssize_t
+http_read(uio_Handle *handle, void *buf, size_t count) {
+	http_Handle *httpHandle;
+	http_GPFileData *fileData;
+	size_t numRead;
+
+	httpHandle = handle->native;
+	fileData = httpHandle->file->extra;
+
+	if (httpHandle->offset >= fileData->size)
+		return 0;
+	if (count > (size_t) (fileData->size - httpHandle->offset))
+		count = fileData->size - httpHandle->offset;
+
+	numRead = 0;
+	while (numRead < count) {
+		uio_uint32 index;
+		size_t blockOffset;
+		ssize_t result;
+
+		index = (uio_uint32) (httpHandle->offset / http_BLOCK_SIZE);
+		blockOffset = (size_t) (httpHandle->offset % http_BLOCK_SIZE);
+		result = http_readBlock(fileData, index, blockOffset,
+				(char *) buf + numRead, count - numRead);
+		if (result == -1) {
+			if (numRead > 0)
+				break;
+			// errno is set
+			return -1;
+		}
+		if (result == 0)
+			break;
+		numRead += result;
+		httpHandle->offset += result;
+	}
+	return numRead;
+}
+
+off_t
+http_seek(uio_Handle *handle, off_t offset, int whence) {
+	http_Handle *httpHandle;
+
+	httpHandle = handle->native;
+
+	assert(whence == SEEK_SET || whence == SEEK_CUR || whence == SEEK_END);
+	switch(whence) {
+		case SEEK_SET:
+			break;
+		case SEEK_CUR:
+			offset += httpHandle->offset;
+			break;
+		case SEEK_END:
+			offset += httpHandle->file->extra->size;
+			break;
+	}
+	if (offset < 0) {
+		offset = 0;
+	} else if (offset > httpHandle->file->extra->size) {
+		offset = httpHandle->file->extra->size;
+	}
+	httpHandle->offset = offset;
+	return offset;
+}
+
+// 'handle' is the manifest file.
+uio_PRoot *
+http_mount(uio_Handle *handle, int flags) {
+	uio_PRoot *result;
+	uio_PDirHandle *rootDirHandle;
+	http_GPRootData *rootData;
+	struct stat statBuf;
+	char *manifest;
+	ssize_t numRead;
+
+	if ((flags & uio_MOUNT_RDONLY) != uio_MOUNT_RDONLY) {
+		errno = EACCES;
+		return NULL;
+	}
+	if (handle == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (uio_fstat(handle, &statBuf) == -1) {
+		// errno is set
+		return NULL;
+	}
+	manifest = uio_malloc(statBuf.st_size + 1);
+	numRead = uio_read(handle, manifest, statBuf.st_size);
+	if (numRead != statBuf.st_size) {
+		uio_free(manifest);
+		errno = EIO;
+		return NULL;
+	}
+	manifest[numRead] = '\0';
+
+	rootData = http_GPRootData_new(NULL);
+	result = uio_GPRoot_makePRoot(
+			uio_getFileSystemHandler(uio_FSTYPE_HTTP), flags,
+			&http_GPRootOperations, rootData, uio_GPRoot_PERSISTENT,
+			NULL, NULL, uio_GPDir_COMPLETE);
+
+	rootDirHandle = uio_PRoot_getRootDirHandle(result);
+	if (http_fillDirStructure(rootDirHandle->extra, rootData, manifest)
+			== -1) {
+		int savedErrno = errno;
+#ifdef DEBUG
+		fprintf(stderr, "Error: failed to read the http content "
+				"manifest - %s.\n", strerror(errno));
+#endif
+		uio_free(manifest);
+		uio_GPRoot_umount(result);
+		errno = savedErrno;
+		return NULL;
+	}
+
+	uio_free(manifest);
+	return result;
+}
+
+// 'manifest' is modified.
+static int
+http_fillDirStructure(uio_GPDir *top, http_GPRootData *rootData,
+		char *manifest) {
+	char *line, *next;
+	int lineNr;
+
+	if (strncmp(manifest, http_MANIFEST_MAGIC,
+			sizeof http_MANIFEST_MAGIC - 1) != 0) {
+		fprintf(stderr, "Error: Not an http content manifest.\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	lineNr = 0;
+	for (line = manifest; line != NULL; line = next) {
+		unsigned long size, mtime;
+		int pathStart;
+		size_t lineLen;
+
+		lineNr++;
+		next = strchr(line, '\n');
+		if (next != NULL)
+			*(next++) = '\0';
+		lineLen = strlen(line);
+		if (lineLen > 0 && line[lineLen - 1] == '\r')
+			line[--lineLen] = '\0';
+
+		if (line[0] == '#' || line[0] == '\0')
+			continue;
+
+		if (strncmp(line, "base ", 5) == 0) {
+			if (rootData->baseURL != NULL)
+				uio_free(rootData->baseURL);
+			rootData->baseURL = uio_strdup(line + 5);
+			continue;
+		}
+
+		if (sscanf(line, "%lu %lu %n", &size, &mtime, &pathStart) < 2 ||
+				line[pathStart] == '\0') {
+			fprintf(stderr, "Error: Bad line %d in http content "
+					"manifest.\n", lineNr);
+			errno = EINVAL;
+			return -1;
+		}
+
+		{
+			http_GPFileData *gPFileData;
+
+			gPFileData = http_GPFileData_new(rootData,
+					uio_strdup(line + pathStart), (off_t) size,
+					(time_t) mtime);
+			if (http_foundFile(top, gPFileData->path, gPFileData) == -1)
+				http_GPFileData_delete(gPFileData);
+		}
+	}
+
+	if (rootData->baseURL == NULL) {
+		fprintf(stderr, "Error: http content manifest does not specify "
+				"a base URL.\n");
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+http_foundFile(uio_GPDir *gPDir, const char *path,
+		http_GPFileData *gPFileData) {
+	uio_GPFile *file;
+	size_t pathLen;
+	const char *rest;
+	const char *pathEnd;
+	const char *start, *end;
+	char *buf;
+
+	if (path[0] == '/')
+		path++;
+	pathLen = strlen(path);
+	pathEnd = path + pathLen;
+
+	switch (uio_walkGPPath(gPDir, path, pathLen, &gPDir, &rest)) {
+		case 0:
+			fprintf(stderr, "Warning: '%s' already exists as a dir - "
+					"skipped.\n", path);
+			errno = EISDIR;
+			return -1;
+		case ENOTDIR:
+			fprintf(stderr, "Warning: A component to '%s' is not a "
+					"directory - file skipped.\n", path);
+			errno = ENOTDIR;
+			return -1;
+		case ENOENT:
+			break;
+	}
+
+	buf = uio_malloc(pathLen + 1);
+	getFirstPathComponent(rest, pathEnd, &start, &end);
+	while (1) {
+		uio_GPDir *newGPDir;
+
+		if (end == start || (end - start == 1 && start[0] == '.') ||
+				(end - start == 2 && start[0] == '.' && start[1] == '.')) {
+			fprintf(stderr, "Warning: file '%s' has an invalid path - "
+					"skipped.\n", path);
+			uio_free(buf);
+			errno = EINVAL;
+			return -1;
+		}
+		if (end == pathEnd) {
+			// This is the last component; the name of the file.
+			rest = start;
+			break;
+		}
+		memcpy(buf, start, end - start);
+		buf[end - start] = '\0';
+		newGPDir = uio_GPDir_prepareSubDir(gPDir, buf);
+		newGPDir->flags |= uio_GPDir_COMPLETE;
+				// The manifest lists all files, so the dir is complete
+				// once the manifest has been read.
+		uio_GPDir_commitSubDir(gPDir, buf, newGPDir);
+
+		gPDir = newGPDir;
+		getNextPathComponent(pathEnd, &start, &end);
+	}
+
+	uio_free(buf);
+
+	file = uio_GPFile_new(gPDir->pRoot, (uio_GPFileExtra) gPFileData,
+			uio_gPFileFlagsFromPRootFlags(gPDir->pRoot->flags));
+	uio_GPDir_addFile(gPDir, rest, file);
+	return 0;
+}
+
+// Copy up to 'count' bytes, starting at 'blockOffset' within block
+// 'index' of the file, to 'buf'.
+// Returns the number of bytes copied, or -1 on error (errno is set).
+static ssize_t
+http_readBlock(http_GPFileData *fileData, uio_uint32 index,
+		size_t blockOffset, char *buf, size_t count) {
+	http_Block *block;
+	http_Block *fetched;
+	size_t numCopy;
+
+	pthread_mutex_lock(&cacheMutex);
+	if (fileData->blocks == NULL) {
+		fileData->blocks = uio_calloc(fileData->numBlocks,
+				sizeof (http_Block *));
+	}
+	block = fileData->blocks[index];
+	if (block != NULL) {
+		cacheStats.hits++;
+	} else {
+		// Fetch without holding the lock, so that other threads can
+		// still read blocks that are already in memory.
+		cacheStats.misses++;
+		pthread_mutex_unlock(&cacheMutex);
+		fetched = http_fetchBlock(fileData, index);
+		if (fetched == NULL) {
+			// errno is set
+			return -1;
+		}
+		pthread_mutex_lock(&cacheMutex);
+		block = fileData->blocks[index];
+		if (block != NULL) {
+			// Another thread beat us to it.
+			http_Block_delete(fetched);
+		} else {
+			http_evict(fetched->size);
+			block = fetched;
+			fileData->blocks[index] = block;
+			cacheUsed += block->size;
+			http_Block_linkFront(block);
+		}
+	}
+
+	if (block != cacheFront) {
+		http_Block_unlink(block);
+		http_Block_linkFront(block);
+	}
+
+	numCopy = 0;
+	if (blockOffset < block->size) {
+		numCopy = block->size - blockOffset;
+		if (numCopy > count)
+			numCopy = count;
+		memcpy(buf, (char *) (block + 1) + blockOffset, numCopy);
+	}
+	pthread_mutex_unlock(&cacheMutex);
+
+	return numCopy;
+}
+
+// Get a block from the persistent cache or from the server.
+// Called without cacheMutex held.
+static http_Block *
+http_fetchBlock(http_GPFileData *fileData, uio_uint32 index) {
+	http_Block *block;
+	off_t blockStart;
+	size_t blockSize;
+	ssize_t numRead;
+	char *url;
+
+	blockStart = (off_t) index * http_BLOCK_SIZE;
+	blockSize = http_BLOCK_SIZE;
+	if (blockStart + (off_t) blockSize > fileData->size)
+		blockSize = (size_t) (fileData->size - blockStart);
+
+	block = http_Block_new(fileData, index, blockSize);
+
+	numRead = http_loadPersisted(fileData, index, (char *) (block + 1),
+			blockSize);
+	if (numRead == (ssize_t) blockSize) {
+		pthread_mutex_lock(&cacheMutex);
+		cacheStats.persistHits++;
+		pthread_mutex_unlock(&cacheMutex);
+		return block;
+	}
+
+	url = http_makeURL(fileData->root, fileData->path);
+	numRead = http_fetchRange(url, blockStart, blockSize,
+			(char *) (block + 1));
+	if (numRead != (ssize_t) blockSize) {
+		int savedErrno = numRead == -1 ? errno : EIO;
+		fprintf(stderr, "Warning: Could not fetch '%s' (block %lu).\n",
+				url, (unsigned long) index);
+		uio_free(url);
+		http_Block_delete(block);
+		errno = savedErrno;
+		return NULL;
+	}
+	uio_free(url);
+
+	pthread_mutex_lock(&cacheMutex);
+	cacheStats.bytesFetched += blockSize;
+	pthread_mutex_unlock(&cacheMutex);
+
+	http_storePersisted(fileData, index, (char *) (block + 1), blockSize);
+	return block;
+}
+
+// Make room in the cache for 'needed' more bytes.
+// Called with cacheMutex held.
+static void
+http_evict(size_t needed) {
+	while (cacheBack != NULL && cacheUsed + needed > cacheLimit) {
+		http_Block *block = cacheBack;
+
+		http_Block_unlink(block);
+		block->file->blocks[block->index] = NULL;
+		cacheUsed -= block->size;
+		cacheStats.evictions++;
+		http_Block_delete(block);
+	}
+}
+
+static void
+http_Block_unlink(http_Block *block) {
+	if (block->prev != NULL)
+		block->prev->next = block->next;
+	else
+		cacheFront = block->next;
+	if (block->next != NULL)
+		block->next->prev = block->prev;
+	else
+		cacheBack = block->prev;
+	block->prev = NULL;
+	block->next = NULL;
+}
+
+static void
+http_Block_linkFront(http_Block *block) {
+	block->prev = NULL;
+	block->next = cacheFront;
+	if (cacheFront != NULL)
+		cacheFront->prev = block;
+	else
+		cacheBack = block;
+	cacheFront = block;
+}
+
+// Characters which can be put in a URL path without escaping.
+static uio_bool
+http_isURLSafe(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+			(c >= '0' && c <= '9') || c == '/' || c == '-' || c == '_' ||
+			c == '.' || c == '~';
+}
+
+static char *
+http_makeURL(const http_GPRootData *rootData, const char *path) {
+	static const char hexDigits[] = "0123456789ABCDEF";
+	size_t baseLen;
+	char *result;
+	char *out;
+
+	baseLen = strlen(rootData->baseURL);
+	result = uio_malloc(baseLen + 1 + 3 * strlen(path) + 1);
+	memcpy(result, rootData->baseURL, baseLen);
+	out = result + baseLen;
+	if (baseLen > 0 && out[-1] != '/')
+		*(out++) = '/';
+	for (; *path != '\0'; path++) {
+		if (http_isURLSafe(*path)) {
+			*(out++) = *path;
+		} else {
+			*(out++) = '%';
+			*(out++) = hexDigits[((unsigned char) *path) >> 4];
+			*(out++) = hexDigits[((unsigned char) *path) & 0x0f];
+		}
+	}
+	*out = '\0';
+	return result;
+}
+
+// The name of a block in the persistent cache encodes the path, size
+// and modification time of the file, so that stale blocks are not used
+// after the content on the server has changed.
+static void
+http_makePersistName(const http_GPFileData *fileData, uio_uint32 index,
+		char *buf, size_t bufSize) {
+	uio_uint32 hash;
+	const char *ptr;
+
+	// FNV-1a
+	hash = 2166136261u;
+	for (ptr = fileData->path; *ptr != '\0'; ptr++) {
+		hash ^= (unsigned char) *ptr;
+		hash *= 16777619u;
+	}
+	snprintf(buf, bufSize, "%08lx-%lx-%lx-%lu.blk", (unsigned long) hash,
+			(unsigned long) fileData->size, (unsigned long) fileData->mtime,
+			(unsigned long) index);
+}
+
+static ssize_t
+http_loadPersisted(const http_GPFileData *fileData, uio_uint32 index,
+		char *buf, size_t size) {
+	char name[64];
+	uio_Handle *handle;
+	ssize_t numRead;
+
+	if (persistDir == NULL)
+		return -1;
+
+	http_makePersistName(fileData, index, name, sizeof name);
+	handle = uio_open(persistDir, name, O_RDONLY
+#ifdef WIN32
+			| O_BINARY
+#endif
+			, 0);
+	if (handle == NULL)
+		return -1;
+	numRead = uio_read(handle, buf, size);
+	uio_close(handle);
+	return numRead;
+}
+
+static void
+http_storePersisted(const http_GPFileData *fileData, uio_uint32 index,
+		const char *buf, size_t size) {
+	char name[64];
+	uio_Handle *handle;
+	ssize_t numWritten;
+
+	if (persistDir == NULL)
+		return;
+
+	http_makePersistName(fileData, index, name, sizeof name);
+	handle = uio_open(persistDir, name, O_WRONLY | O_CREAT | O_TRUNC
+#ifdef WIN32
+			| O_BINARY
+#endif
+			, S_IRUSR | S_IWUSR);
+	if (handle == NULL)
+		return;
+	numWritten = uio_write(handle, buf, size);
+	uio_close(handle);
+	if (numWritten != (ssize_t) size) {
+		// Don't leave a partial block behind.
+		uio_unlink(persistDir, name);
+		return;
+	}
+
+#ifdef EMSCRIPTEN
+	pthread_mutex_lock(&cacheMutex);
+	persistUnsynced += size;
+	if (persistUnsynced >= http_PERSIST_SYNC_BYTES) {
+		persistUnsynced = 0;
+		MAIN_THREAD_ASYNC_EM_ASM(
+			FS.syncfs( /*populate=*/ false, err => {
+				if (err)
+					console.log("Persisting the content cache failed");
+			})
+		);
+	}
+	pthread_mutex_unlock(&cacheMutex);
+#endif
+}
+
+static inline http_GPRootData *
+http_GPRootData_new(char *baseURL) {
+	http_GPRootData *result = uio_malloc(sizeof (http_GPRootData));
+#ifdef uio_MEM_DEBUG
+	uio_MemDebug_debugAlloc(http_GPRootData, (void *) result);
+#endif
+	result->baseURL = baseURL;
+	return result;
+}
+
+static void
+http_GPRootData_delete(http_GPRootData *rootData) {
+#ifdef uio_MEM_DEBUG
+	uio_MemDebug_debugFree(http_GPRootData, (void *) rootData);
+#endif
+	if (rootData->baseURL != NULL)
+		uio_free(rootData->baseURL);
+	uio_free(rootData);
+}
+
+static inline http_GPFileData *
+http_GPFileData_new(const http_GPRootData *root, char *path, off_t size,
+		time_t mtime) {
+	http_GPFileData *result = uio_malloc(sizeof (http_GPFileData));
+#ifdef uio_MEM_DEBUG
+	uio_MemDebug_debugAlloc(http_GPFileData, (void *) result);
+#endif
+	result->root = root;
+	result->path = path;
+	result->size = size;
+	result->mtime = mtime;
+	result->numBlocks = (uio_uint32) ((size + http_BLOCK_SIZE - 1) /
+			http_BLOCK_SIZE);
+	result->blocks = NULL;
+	return result;
+}
+
+static void
+http_GPFileData_delete(http_GPFileData *gPFileData) {
+#ifdef uio_MEM_DEBUG
+	uio_MemDebug_debugFree(http_GPFileData, (void *) gPFileData);
+#endif
+	if (gPFileData->blocks != NULL) {
+		uio_uint32 i;
+
+		pthread_mutex_lock(&cacheMutex);
+		for (i = 0; i < gPFileData->numBlocks; i++) {
+			http_Block *block = gPFileData->blocks[i];
+			if (block == NULL)
+				continue;
+			http_Block_unlink(block);
+			cacheUsed -= block->size;
+			http_Block_delete(block);
+		}
+		pthread_mutex_unlock(&cacheMutex);
+		uio_free(gPFileData->blocks);
+	}
+	uio_free(gPFileData->path);
+	uio_free(gPFileData);
+}
+
+static inline http_Block *
+http_Block_new(http_GPFileData *file, uio_uint32 index, size_t size) {
+	http_Block *result = uio_malloc(sizeof (http_Block) + size);
+	result->file = file;
+	result->index = index;
+	result->size = size;
+	result->prev = NULL;
+	result->next = NULL;
+	return result;
+}
+
+static inline void
+http_Block_delete(http_Block *block) {
+	uio_free(block);
+}
+
@@ -0,0 +1,87 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ * Nota bene: later versions of the GNU General Public License do not apply
+ * to this program.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+typedef struct http_Handle *uio_NativeHandle;
+typedef struct http_GPRootData *uio_GPRootExtra;
+typedef struct http_GPFileData *uio_GPFileExtra;
+typedef void *uio_GPDirExtra;
+typedef struct uio_GPDirEntries_Iterator *uio_NativeEntriesContext;
+
+#define uio_INTERNAL_PHYSICAL
+
+#include "../gphys.h"
+#include "../iointrn.h"
+#include "../uioport.h"
+#include "../physical.h"
+#include "../types.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// The http file system is a read-only tree of files that are fetched
+// from a web server on demand. The tree itself is described by a
+// manifest file, which is what gets mounted:
+//
+//     # uqm content manifest 1
+//     base <url>
+//     <size> <mtime> <path>
+//     ...
+//
+// The base URL may be relative (to the page, for the wasm build).
+// File data is fetched in blocks of http_BLOCK_SIZE bytes with HTTP
+// range requests, and kept in an LRU cache shared by all mounted
+// http file systems. Optionally, fetched blocks are also written to a
+// persistent cache directory.
+
+#define http_BLOCK_SIZE 0x10000
+
+typedef struct http_GPRootData {
+	char *baseURL;
+} http_GPRootData;
+
+typedef struct http_Block http_Block;
+
+typedef struct http_GPFileData {
+	const http_GPRootData *root;
+	char *path;
+			// Path of the file relative to the base URL.
+	off_t size;
+	time_t mtime;
+	uio_uint32 numBlocks;
+	http_Block **blocks;
+			// Cached blocks, or NULL for blocks not in memory.
+			// Allocated on first read.
+} http_GPFileData;
+
+typedef struct http_Handle {
+	uio_GPFile *file;
+	off_t offset;
+} http_Handle;
+
+
+uio_PRoot *http_mount(uio_Handle *handle, int flags);
+uio_Handle *http_open(uio_PDirHandle *pDirHandle, const char *file,
+		int flags, mode_t mode);
+void http_close(uio_Handle *handle);
+int http_access(uio_PDirHandle *pDirHandle, const char *name, int mode);
+int http_fstat(uio_Handle *handle, struct stat *statBuf);
+int http_stat(uio_PDirHandle *pDirHandle, const char *name,
+		struct stat *statBuf);
+ssize_t http_read(uio_Handle *handle, void *buf, size_t count);
+off_t http_seek(uio_Handle *handle, off_t offset, int whence);
+
@@ -39,6 +39,11 @@
 #	include "memdebug.h"
 #endif
 
+uio_IOStats uio_ioStats;
+#ifdef uio_THREAD_IOSTATS
+__thread uio_IOStats uio_threadIOStats;
+#endif
+
 #if 0
 static int uio_accessDir(uio_DirHandle *dirHandle, const char *path,
 		int mode);
@@ -1042,6 +1047,96 @@ uio_write(uio_Handle *handle, const void *buf, size_t count) {
 	return (handle->root->handler->write)(handle, buf, count);
 }
 
+static uio_FileMap *
+uio_mapFileCopy(uio_Handle *handle, off_t offset, size_t size,
+		uio_FileMap *map) {
+	char *buf;
+	off_t oldPos;
+	ssize_t numRead;
+
+	oldPos = uio_lseek(handle, 0, SEEK_CUR);
+	if (oldPos == -1 || uio_lseek(handle, offset, SEEK_SET) == -1) {
+		// errno is set
+		return NULL;
+	}
+
+	buf = uio_malloc(size > 0 ? size : 1);
+	numRead = uio_read(handle, buf, size);
+	uio_lseek(handle, oldPos, SEEK_SET);
+	if (numRead == -1 || (size_t) numRead != size) {
+		uio_free(buf);
+		if (numRead != -1)
+			errno = EIO;
+		return NULL;
+	}
+
+	map->data = buf;
+	map->size = size;
+	map->base = buf;
+	map->baseSize = size;
+	map->handler = NULL;
+	uio_addIOStat(bytesCopied, size);
+	return map;
+}
+
+const void *
+uio_mapFile(uio_Handle *handle, off_t offset, size_t size, int flags,
+		uio_FileMap **map) {
+	uio_FileSystemHandler *handler;
+	uio_FileMap *result;
+
+	result = uio_malloc(sizeof (uio_FileMap));
+	handler = handle->root->handler;
+	if (handler->map != NULL &&
+			(handler->map)(handle, offset, size, result) == 0) {
+		uio_addIOStat(bytesMapped, size);
+		*map = result;
+		return result->data;
+	}
+
+	if (flags & uio_MAP_NOCOPY) {
+		uio_free(result);
+		errno = ENOSYS;
+		return NULL;
+	}
+
+	if (uio_mapFileCopy(handle, offset, size, result) == NULL) {
+		int savedErrno = errno;
+		uio_free(result);
+		errno = savedErrno;
+		return NULL;
+	}
+	*map = result;
+	return result->data;
+}
+
+int
+uio_unmapFile(uio_FileMap *map) {
+	int result = 0;
+
+	if (map->handler != NULL) {
+		result = (map->handler->unmap)(map);
+	} else
+		uio_free(map->base);
+	uio_free(map);
+	return result;
+}
+
+void
+uio_getIOStats(uio_IOStats *stats) {
+	stats->bytesMapped = uio_loadIOStat(bytesMapped);
+	stats->bytesCopied = uio_loadIOStat(bytesCopied);
+}
+
+void
+uio_getThreadIOStats(uio_IOStats *stats) {
+#ifdef uio_THREAD_IOSTATS
+	*stats = uio_threadIOStats;
+#else
+	uio_getIOStats(stats);
+#endif
+}
+
 int
 uio_unlink(uio_DirHandle *dirHandle, const char *path) {
 	int numPDirHandles;
@@ -28,6 +28,7 @@ typedef struct uio_Handle uio_Handle;
 typedef struct uio_DirHandle uio_DirHandle;
 typedef struct uio_DirList uio_DirList;
 typedef struct uio_MountHandle uio_MountHandle;
+typedef struct uio_FileMap uio_FileMap;
 
 typedef enum {
 	uio_MOUNT_BOTTOM = (0 << 2),
@@ -36,6 +37,7 @@ typedef enum {
 	uio_MOUNT_ABOVE =  (3 << 2)
 } uio_MountLocation;
 
+#include "types.h"
 #include "match.h"
 #include "fstypes.h"
 #include "mount.h"
@@ -126,6 +128,17 @@ int uio_lseek(uio_Handle *handle, off_t offset, int whence);
 
 ssize_t uio_write(uio_Handle *handle, const void *buf, size_t count);
 
+// Map 'size' bytes of a file, starting at 'offset', into memory for
+// reading. Returns a pointer to the data, which stays valid until
+// uio_unmapFile() is called for '*map', or NULL on error.
+// If the file system can't map the file (compressed .zip entries, for
+// instance), the data is read into a buffer instead, unless
+// uio_MAP_NOCOPY is set in 'flags', in which case errno is set to ENOSYS.
+const void *uio_mapFile(uio_Handle *handle, off_t offset, size_t size,
+		int flags, uio_FileMap **map);
+#define uio_MAP_NOCOPY 1
+int uio_unmapFile(uio_FileMap *map);
+
 int uio_unlink(uio_DirHandle *dirHandle, const char *path);
 
 int uio_getFileLocation(uio_DirHandle *dir, const char *inPath,
@@ -147,6 +160,34 @@ uio_DirList *uio_getDirList(uio_DirHandle *dirHandle, const char *path,
 		const char *pattern, match_MatchType matchType);
 void uio_DirList_free(uio_DirList *dirList);
 
+#ifdef HAVE_HTTP
+// Configure the block cache of the http file system: the number of bytes
+// of file data to keep in memory, and an optional directory where fetched
+// data is kept across runs (NULL for none).
+#define uio_HTTP_DEFAULT_CACHE_SIZE (32 * 1024 * 1024)
+void uio_setHttpCacheOptions(size_t memoryLimit, uio_DirHandle *persistDir);
+#endif
+
+#ifdef HAVE_ZIP
+// Keep the directory structure of mounted .zip files in 'dir', so that
+// an unchanged .zip file does not need to have its central directory
+// parsed again on the next run (NULL to disable).
+void uio_setZipCacheDir(uio_DirHandle *dir);
+#endif
+
+typedef struct uio_IOStats {
+	uio_uint64 bytesMapped;
+			// Bytes handed out by uio_mapFile() without copying.
+	uio_uint64 bytesCopied;
+			// Bytes copied out of streams by uio_fread() and uio_fgets(),
+			// and by uio_mapFile() when the file could not be mapped.
+} uio_IOStats;
+// Can be called from any thread.
+void uio_getIOStats(uio_IOStats *stats);
+// Only the I/O done by the calling thread. Where the compiler has no
+// thread-local storage, this is the I/O of all threads.
+void uio_getThreadIOStats(uio_IOStats *stats);
+
 // For debugging purposes
 void uio_DirHandle_print(const uio_DirHandle *dirHandle, FILE *out);
 
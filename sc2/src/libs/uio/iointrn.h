@@ -100,6 +100,39 @@ struct uio_EntriesContext {
 	uio_NativeEntriesContext native;
 };
 
+struct uio_FileMap {
+	const char *data;
+			// The data that was asked for.
+	size_t size;
+	void *base;
+			// Start of the native mapping, or of the buffer with a copy
+			// of the data.
+	size_t baseSize;
+	uio_FileSystemHandler *handler;
+			// File system that unmaps 'base', or NULL if 'base' is a
+			// buffer allocated by uio_mapFile().
+};
+
+extern uio_IOStats uio_ioStats;
+// The counters are updated from whichever thread does the I/O.
+// Each thread also counts its own I/O, in uio_threadIOStats.
+// Without the GCC atomic builtins and thread-local storage, counts may be
+// lost when two threads add to a counter at once, and there are only the
+// counters for all threads.
+#if defined(__GNUC__) && defined(__ATOMIC_SEQ_CST)
+#	define uio_THREAD_IOSTATS
+extern __thread uio_IOStats uio_threadIOStats;
+#	define uio_addIOStat(field, amount) \
+		((void) (__atomic_fetch_add(&uio_ioStats.field, (amount), \
+				__ATOMIC_RELAXED), uio_threadIOStats.field += (amount)))
+#	define uio_loadIOStat(field) \
+		__atomic_load_n(&uio_ioStats.field, __ATOMIC_RELAXED)
+#else
+#	define uio_addIOStat(field, amount) \
+		((void) (uio_ioStats.field += (amount)))
+#	define uio_loadIOStat(field) (uio_ioStats.field)
+#endif
+
 
 uio_Handle *uio_Handle_new(uio_PRoot *root, uio_NativeHandle native,
 		int openFlags);
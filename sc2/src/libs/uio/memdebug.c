@@ -60,6 +60,11 @@ const uio_MemDebug_LogTypeInfo uio_MemDebug_logTypeInfo[] = {
 #ifdef HAVE_ZIP
 	{ "zip_GPFileData",     NULL,                   0 },
 	{ "zip_GPDirData",      NULL,                   0 },
+	{ "zip_GPRootData",     NULL,                   0 },
+#endif
+#ifdef HAVE_HTTP
+	{ "http_GPRootData",    NULL,                   0 },
+	{ "http_GPFileData",    NULL,                   0 },
 #endif
 };
 
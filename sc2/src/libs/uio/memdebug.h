@@ -46,6 +46,9 @@ typedef enum {
 	uio_MemDebug_LogType_stdio_GPDirData,
 	uio_MemDebug_LogType_zip_GPFileData,
 	uio_MemDebug_LogType_zip_GPDirData,
+	uio_MemDebug_LogType_zip_GPRootData,
+	uio_MemDebug_LogType_http_GPRootData,
+	uio_MemDebug_LogType_http_GPFileData,
 
 	uio_MemDebug_numLogTypes,  /* This needs to be the last entry */
 } uio_MemDebug_LogType;
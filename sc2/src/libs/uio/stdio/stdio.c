@@ -34,6 +34,9 @@
 #	include <unistd.h>
 #	include <dirent.h>
 #endif
+#ifdef HAVE_MMAP
+#	include <sys/mman.h>
+#endif
 #include <stdio.h>
 #include <sys/types.h>
 #include <errno.h>
@@ -82,6 +85,13 @@ uio_FileSystemHandler stdio_fileSystemHandler = {
 	/* .seek   = */  stdio_seek,
 	/* .write  = */  stdio_write,
 	/* .unlink = */  stdio_unlink,
+#ifdef HAVE_MMAP
+	/* .map    = */  stdio_map,
+	/* .unmap  = */  stdio_unmap,
+#else
+	/* .map    = */  NULL,
+	/* .unmap  = */  NULL,
+#endif
 
 	/* .openEntries  = */  stdio_openEntries,
 	/* .readEntries  = */  stdio_readEntries,
@@ -332,6 +342,50 @@ stdio_write(uio_Handle *handle, const void *buf, size_t count) {
 	return write(handle->native->fd, buf, count);
 }
 
+#ifdef HAVE_MMAP
+int
+stdio_map(uio_Handle *handle, off_t offset, size_t size, uio_FileMap *map) {
+	struct stat statBuf;
+	off_t mapStart;
+	size_t mapSize;
+	void *base;
+
+	if (fstat(handle->native->fd, &statBuf) == -1) {
+		// errno is set
+		return -1;
+	}
+	// Pages beyond the end of the file can't be accessed, and mmap()
+	// can't map nothing.
+	if (size == 0 || offset < 0 || offset > statBuf.st_size ||
+			(off_t) size > statBuf.st_size - offset) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	// The mapping must start at a page boundary.
+	mapStart = offset - offset % sysconf(_SC_PAGESIZE);
+	mapSize = size + (size_t) (offset - mapStart);
+	base = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, handle->native->fd,
+			mapStart);
+	if (base == MAP_FAILED) {
+		// errno is set
+		return -1;
+	}
+
+	map->data = (const char *) base + (offset - mapStart);
+	map->size = size;
+	map->base = base;
+	map->baseSize = mapSize;
+	map->handler = handle->root->handler;
+	return 0;
+}
+
+int
+stdio_unmap(uio_FileMap *map) {
+	return munmap(map->base, map->baseSize);
+}
+#endif  /* HAVE_MMAP */
+
 int
 stdio_unlink(uio_PDirHandle *pDirHandle, const char *name) {
 	char *path;
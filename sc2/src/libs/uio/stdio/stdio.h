@@ -95,6 +95,11 @@ int stdio_rmdir(uio_PDirHandle *pDirHandle, const char *name);
 off_t stdio_seek(uio_Handle *handle, off_t offset, int whence);
 ssize_t stdio_write(uio_Handle *handle, const void *buf, size_t count);
 int stdio_unlink(uio_PDirHandle *pDirHandle, const char *name);
+#ifdef HAVE_MMAP
+int stdio_map(uio_Handle *handle, off_t offset, size_t size,
+		uio_FileMap *map);
+int stdio_unmap(uio_FileMap *map);
+#endif
 
 stdio_EntriesIterator *stdio_openEntries(uio_PDirHandle *pDirHandle);
 int stdio_readEntries(stdio_EntriesIterator **iterator,
@@ -55,6 +55,7 @@ typedef unsigned short uio_uint16;
 typedef   signed short uio_sint16;
 typedef unsigned int   uio_uint32;
 typedef   signed int   uio_sint32;
+typedef unsigned long long uio_uint64;
 
 typedef unsigned long  uio_uintptr;
 		// Needs to be adapted for 64 bits systems
@@ -120,7 +120,9 @@ uio_fclose(uio_Stream *stream) {
 	if (stream->operation == uio_StreamOperation_write) {
 		uio_Stream_flushWriteBuffer(stream);
 #ifdef EMSCRIPTEN
-		MAIN_THREAD_EM_ASM(
+		// Fire and forget; don't make the game thread wait for the
+		// browser main thread.
+		MAIN_THREAD_ASYNC_EM_ASM(
 			FS.syncfs( /*populate=*/ false, err => {
 				if (err)
 					throw err;
@@ -165,6 +167,7 @@ uio_fread(void *buf, size_t size, size_t nmemb, uio_Stream *stream) {
 	}
 	if (bytesToRead == 0) {
 		// Done already
+		uio_addIOStat(bytesCopied, bytesRead);
 		return nmemb;
 	}
 
@@ -186,6 +189,7 @@ uio_fread(void *buf, size_t size, size_t nmemb, uio_Stream *stream) {
 	}
 	
 out:
+	uio_addIOStat(bytesCopied, bytesRead);
 	if (bytesToRead == 0)
 		return nmemb;
 	return bytesRead / size;
@@ -233,12 +237,14 @@ uio_fgets(char *s, int size, uio_Stream *stream) {
 			maxRead = newLinePos + 1 - stream->dataStart;
 			memcpy(buf, stream->dataStart, maxRead);
 			stream->dataStart += maxRead;
+			uio_addIOStat(bytesCopied, maxRead);
 			buf[maxRead] = '\0';
 			return buf;
 		}
 		// No newline present.
 		memcpy(buf, stream->dataStart, maxRead);
 		stream->dataStart += maxRead;
+		uio_addIOStat(bytesCopied, maxRead);
 		buf += maxRead;
 		size -= maxRead;
 	}
@@ -495,6 +501,34 @@ uio_streamHandle(uio_Stream *stream) {
 	return stream->handle;	
 }
 
+// Map the next 'size' bytes of the stream into memory, and advance the
+// stream past them. See uio_mapFile().
+const void *
+uio_fmap(uio_Stream *stream, size_t size, int flags, uio_FileMap **map) {
+	long pos;
+	const void *result;
+
+	pos = uio_ftell(stream);
+	if (pos == -1) {
+		// errno is set
+		return NULL;
+	}
+
+	result = uio_mapFile(stream->handle, (off_t) pos, size, flags, map);
+	if (result == NULL) {
+		// errno is set
+		return NULL;
+	}
+
+	if (uio_fseek(stream, pos + (long) size, SEEK_SET) == -1) {
+		int savedErrno = errno;
+		uio_unmapFile(*map);
+		errno = savedErrno;
+		return NULL;
+	}
+	return result;
+}
+
 #ifndef NDEBUG
 static void
 uio_assertReadSanity(uio_Stream *stream) {
@@ -50,6 +50,8 @@ int uio_feof(uio_Stream *stream);
 int uio_ferror(uio_Stream *stream);
 void uio_clearerr(uio_Stream *stream);
 uio_Handle *uio_streamHandle(uio_Stream *stream);
+const void *uio_fmap(uio_Stream *stream, size_t size, int flags,
+		uio_FileMap **map);
 
 
 /* *** Internal definitions follow *** */
@@ -29,6 +29,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -55,9 +56,33 @@ static int zip_fillDirStructureLocalProcessEntry(uio_GPDir *topGPDir,
 #if zip_USE_HEADERS == zip_USE_CENTRAL_HEADERS
 static off_t zip_findEndOfCentralDirectoryRecord(uio_Handle *handle,
 		uio_FileBlock *fileBlock);
+
+// Identifies a .zip file for the directory cache.
+typedef struct zip_DirCacheKey {
+	uio_uint64 fileSize;
+	uio_uint64 mtime;
+	uio_uint32 centralDirOffset;
+	uio_uint32 centralDirSize;
+	uio_uint32 numEntries;
+} zip_DirCacheKey;
+// The directory cache of a .zip file, as it is being built.
+typedef struct zip_DirCache {
+	unsigned char *buf;
+	size_t bufSize;
+	size_t bufFill;
+	uio_uint32 numRecords;
+} zip_DirCache;
+
 static int zip_fillDirStructureCentral(uio_GPDir *top, uio_Handle *handle);
 static int zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
-		uio_FileBlock *fileBlock, off_t *pos);
+		uio_FileBlock *fileBlock, off_t *pos, zip_DirCache *cache);
+static void zip_DirCache_init(zip_DirCache *cache);
+static void zip_DirCache_uninit(zip_DirCache *cache);
+static void zip_DirCache_addEntry(zip_DirCache *cache, const char *name,
+		uio_bool isDir, const zip_GPFileData *gPFileData);
+static int zip_loadDirCache(uio_GPDir *top, const zip_DirCacheKey *key);
+static void zip_storeDirCache(const zip_DirCacheKey *key,
+		zip_DirCache *cache);
 static int zip_updatePFileDataFromLocalFileHeader(zip_GPFileData *gPFileData,
 		uio_FileBlock *fileBlock, int pos);
 int zip_updateFileDataFromLocalHeader(uio_Handle *handle,
@@ -78,12 +103,12 @@ static int zip_reInitZipStream(z_stream *zipStream);
 static voidpf zip_alloc(voidpf opaque, uInt items, uInt size);
 static void zip_free(voidpf opaque, voidpf address);
 
-static inline zip_GPFileData * zip_GPFileData_new(void);
+static inline zip_GPRootData *zip_GPRootData_new(void);
+static void zip_GPRootData_delete(zip_GPRootData *gPRootData);
+static void zip_GPRootData_reserve(zip_GPRootData *gPRootData, size_t count);
+static inline zip_GPFileData *zip_GPFileData_new(zip_GPRootData *gPRootData);
 static inline void zip_GPFileData_delete(zip_GPFileData *gPFileData);
-static inline zip_GPFileData *zip_GPFileData_alloc(void);
-static inline void zip_GPFileData_free(zip_GPFileData *gPFileData);
 static inline void zip_GPDirData_delete(zip_GPDirData *gPDirData);
-static inline void zip_GPDirData_free(zip_GPDirData *gPDirData);
 
 static ssize_t zip_readStored(uio_Handle *handle, void *buf, size_t count);
 static ssize_t zip_readDeflated(uio_Handle *handle, void *buf, size_t count);
@@ -92,7 +117,7 @@ static off_t zip_seekDeflated(uio_Handle *handle, off_t offset);
 
 uio_FileSystemHandler zip_fileSystemHandler = {
 	/* .init    = */  NULL,
-	/* .unInit  = */  NULL,
+	/* .unInit  = */  zip_unInit,
 	/* .cleanup = */  NULL,
 
 	/* .mount  = */  zip_mount,
@@ -110,6 +135,8 @@ uio_FileSystemHandler zip_fileSystemHandler = {
 	/* .seek   = */  zip_seek,
 	/* .write  = */  NULL,
 	/* .unlink = */  NULL,
+	/* .map    = */  zip_map,
+	/* .unmap  = */  NULL,
 
 	/* .openEntries  = */  uio_GPDir_openEntries,
 	/* .readEntries  = */  uio_GPDir_readEntries,
@@ -123,7 +150,7 @@ uio_FileSystemHandler zip_fileSystemHandler = {
 
 uio_GPRoot_Operations zip_GPRootOperations = {
 	/* .fillGPDir         = */  NULL,
-	/* .deleteGPRootExtra = */  NULL,
+	/* .deleteGPRootExtra = */  zip_GPRootData_delete,
 	/* .deleteGPDirExtra  = */  zip_GPDirData_delete,
 	/* .deleteGPFileExtra = */  zip_GPFileData_delete,
 };
@@ -192,6 +219,33 @@ static mode_t zip_makeFileMode(zip_OSType creatorOS, uio_uint32 modeBytes);
 		// TODO: make this configurable a la sysctl?
 #define zip_SEEK_BUFFER_SIZE zip_INPUT_BUFFER_SIZE
 
+#define zip_GPFILEDATA_BLOCK_SIZE 64
+		// Number of zip_GPFileData allocated at once when the number
+		// of entries is not known in advance.
+
+// Where the directory structure of mounted .zip files is cached.
+// NULL if caching is disabled.
+static uio_DirHandle *zip_cacheDir = NULL;
+
+
+int
+zip_unInit(void) {
+	if (zip_cacheDir != NULL) {
+		uio_DirHandle_unref(zip_cacheDir);
+		zip_cacheDir = NULL;
+	}
+	return 0;
+}
+
+void
+uio_setZipCacheDir(uio_DirHandle *dir) {
+	if (zip_cacheDir != NULL)
+		uio_DirHandle_unref(zip_cacheDir);
+	zip_cacheDir = dir;
+	if (zip_cacheDir != NULL)
+		uio_DirHandle_ref(zip_cacheDir);
+}
+
 
 void
 zip_close(uio_Handle *handle) {
@@ -408,6 +462,33 @@ zip_read(uio_Handle *handle, void *buf, size_t count) {
 	return result;
 }
 
+// Only entries that are stored uncompressed can be mapped; their data is
+// mapped straight from the archive.
+int
+zip_map(uio_Handle *handle, off_t offset, size_t size, uio_FileMap *map) {
+	zip_GPFileData *fileData;
+	uio_Handle *archive;
+
+	fileData = handle->native->file->extra;
+	if (fileData->compressionMethod != 0) {
+		errno = ENOSYS;
+		return -1;
+	}
+	if (offset < 0 || offset > fileData->uncompressedSize ||
+			(off_t) size > fileData->uncompressedSize - offset) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	archive = handle->root->handle;
+	if (archive->root->handler->map == NULL) {
+		errno = ENOSYS;
+		return -1;
+	}
+	return (archive->root->handler->map)(archive,
+			fileData->fileOffset + offset, size, map);
+}
+
 static ssize_t
 zip_readStored(uio_Handle *handle, void *buf, size_t count) {
 	int numBytes;
@@ -629,8 +710,8 @@ zip_mount(uio_Handle *handle, int flags) {
 	uio_Handle_ref(handle);
 	result = uio_GPRoot_makePRoot(
 			uio_getFileSystemHandler(uio_FSTYPE_ZIP), flags,
-			&zip_GPRootOperations, NULL, uio_GPRoot_PERSISTENT,
-			handle, NULL, uio_GPDir_COMPLETE);
+			&zip_GPRootOperations, zip_GPRootData_new(),
+			uio_GPRoot_PERSISTENT, handle, NULL, uio_GPDir_COMPLETE);
 
 	rootDirHandle = uio_PRoot_getRootDirHandle(result);
 	if (zip_fillDirStructure(rootDirHandle->extra, handle) == -1) {
@@ -669,6 +750,10 @@ zip_fillDirStructureCentral(uio_GPDir *top, uio_Handle *handle) {
 			//       to a smart size
 	off_t eocdr;
 	off_t startCentralDir;
+	uio_uint32 centralDirSize;
+	zip_DirCacheKey key;
+	zip_DirCache cache;
+	zip_DirCache *cachePtr = NULL;
 
 	fileBlock = uio_openFileBlock(handle);
 	if (fileBlock == NULL) {
@@ -700,21 +785,57 @@ zip_fillDirStructureCentral(uio_GPDir *top, uio_Handle *handle) {
 		goto err;
 	}
 
+	centralDirSize = makeUInt32(buf[12], buf[13], buf[14], buf[15]);
 	startCentralDir = makeUInt32(buf[16], buf[17], buf[18], buf[19]);
 
+	if (zip_cacheDir != NULL) {
+		struct stat statBuf;
+
+		if (uio_fstat(handle, &statBuf) == -1) {
+			// errno is set
+			goto err;
+		}
+		key.fileSize = (uio_uint64) statBuf.st_size;
+		key.mtime = (uio_uint64) statBuf.st_mtime;
+		key.centralDirOffset = (uio_uint32) startCentralDir;
+		key.centralDirSize = centralDirSize;
+		key.numEntries = numEntries;
+
+		switch (zip_loadDirCache(top, &key)) {
+			case 1:
+				uio_closeFileBlock(fileBlock);
+				return 0;
+			case 0:  // not cached
+				break;
+			case -1:
+				// errno is set
+				goto err;
+		}
+
+		zip_DirCache_init(&cache);
+		cachePtr = &cache;
+	}
+
+	// Allocate the zip_GPFileData for all entries at once.
+	zip_GPRootData_reserve(top->pRoot->extra->extra, numEntries);
+
 	// Enable read-ahead buffering, for speed.
 	uio_setFileBlockUsageHint(fileBlock, uio_FB_USAGE_FORWARD,
 			DIR_STRUCTURE_READ_BUFSIZE);
 
 	pos = startCentralDir;
 	while (numEntries--) {
-		if (zip_fillDirStructureCentralProcessEntry(top, fileBlock, &pos)
-				== -1) {
+		if (zip_fillDirStructureCentralProcessEntry(top, fileBlock, &pos,
+				cachePtr) == -1) {
 			// errno is set
 			goto err;
 		}
 	}
 
+	if (cachePtr != NULL) {
+		zip_storeDirCache(&key, cachePtr);
+		zip_DirCache_uninit(cachePtr);
+	}
 	uio_closeFileBlock(fileBlock);
 	return 0;
 
@@ -722,6 +843,8 @@ err:
 	{
 		int savedErrno = errno;
 
+		if (cachePtr != NULL)
+			zip_DirCache_uninit(cachePtr);
 		if (fileBlock != NULL)
 			uio_closeFileBlock(fileBlock);
 		errno = savedErrno;
@@ -729,9 +852,10 @@ err:
 	}
 }
 
+// If 'cache' is not NULL, the entry is added to it when it is accepted.
 static int
 zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
-		uio_FileBlock *fileBlock, off_t *pos) {
+		uio_FileBlock *fileBlock, off_t *pos, zip_DirCache *cache) {
 	char *buf;
 	zip_GPFileData *gPFileData;
 	ssize_t numBytes;
@@ -759,7 +883,7 @@ zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
 		return -1;
 	}
 	
-	gPFileData = zip_GPFileData_new();
+	gPFileData = zip_GPFileData_new(topGPDir->pRoot->extra->extra);
 	creatorOS = (zip_OSType) buf[5];
 	gPFileData->compressionFlags = makeUInt16(buf[8], buf[9]);
 	gPFileData->compressionMethod = makeUInt16(buf[10], buf[11]);
@@ -850,6 +974,8 @@ zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
 			}
 			return zip_badFile(gPFileData, fileName);
 		}
+		if (cache != NULL)
+			zip_DirCache_addEntry(cache, fileName, false, gPFileData);
 
 #if defined(DEBUG) && DEBUG > 1
 		fprintf(stderr, "Debug: Found file '%s'.\n", fileName);
@@ -867,6 +993,8 @@ zip_fillDirStructureCentralProcessEntry(uio_GPDir *topGPDir,
 			}
 			return zip_badFile(gPFileData, fileName);
 		}
+		if (cache != NULL)
+			zip_DirCache_addEntry(cache, fileName, true, gPFileData);
 #if defined(DEBUG) && DEBUG > 1
 		fprintf(stderr, "Debug: Found dir '%s'.\n", fileName);
 #endif
@@ -931,6 +1059,272 @@ zip_findEndOfCentralDirectoryRecord(uio_Handle *handle,
 	return startPos + (bufPtr - buf);
 }
 
+// The directory cache.
+// After the central directory of a .zip file has been processed, the
+// accepted entries are written to a file in the dir set with
+// uio_setZipCacheDir(). When the same .zip file is mounted again, they
+// are read back with a single read, and no central directory entries
+// need to be parsed.
+// A cache file is identified by the size and modification time of the
+// .zip file, and by the location and size of its central directory.
+// The mount function only gets an open handle, so the path of the .zip
+// file can not be used.
+//
+// The format of a cache file (all numbers are little endian):
+//   header:  "UQMz", version (4 bytes), .zip file size (8), .zip file
+//            mtime (8), central dir offset (4), central dir size (4),
+//            central dir entry count (4), record count (4)
+//   records: is dir (1), compressionFlags (2), compressionMethod (2),
+//            compressedSize (4), uncompressedSize (4), headerOffset (4),
+//            mode (4), uid (4), gid (4), atime (8), mtime (8),
+//            ctime (8), name length (2), name ('\0'-terminated)
+
+#define zip_DIRCACHE_MAGIC "UQMz"
+#define zip_DIRCACHE_VERSION 1
+#define zip_DIRCACHE_HEADER_SIZE 40
+#define zip_DIRCACHE_RECORD_SIZE 55
+		// Not including the name.
+
+static inline void
+zip_putUInt(unsigned char *buf, uio_uint64 value, int numBytes) {
+	int i;
+
+	for (i = 0; i < numBytes; i++) {
+		buf[i] = (unsigned char) (value & 0xff);
+		value >>= 8;
+	}
+}
+
+static inline uio_uint64
+zip_getUInt(const unsigned char *buf, int numBytes) {
+	uio_uint64 result = 0;
+
+	while (numBytes--)
+		result = (result << 8) | buf[numBytes];
+	return result;
+}
+
+static void
+zip_DirCache_init(zip_DirCache *cache) {
+	cache->bufSize = 0x4000;
+	cache->buf = uio_malloc(cache->bufSize);
+	cache->bufFill = zip_DIRCACHE_HEADER_SIZE;
+			// The header is filled in when the cache is stored.
+	cache->numRecords = 0;
+}
+
+static void
+zip_DirCache_uninit(zip_DirCache *cache) {
+	uio_free(cache->buf);
+}
+
+static void
+zip_DirCache_addEntry(zip_DirCache *cache, const char *name,
+		uio_bool isDir, const zip_GPFileData *gPFileData) {
+	size_t nameLen;
+	size_t recordSize;
+	unsigned char *ptr;
+
+	nameLen = strlen(name);
+	recordSize = zip_DIRCACHE_RECORD_SIZE + nameLen + 1;
+	if (cache->bufFill + recordSize > cache->bufSize) {
+		do {
+			cache->bufSize *= 2;
+		} while (cache->bufFill + recordSize > cache->bufSize);
+		cache->buf = uio_realloc(cache->buf, cache->bufSize);
+	}
+
+	ptr = cache->buf + cache->bufFill;
+	ptr[0] = isDir ? 1 : 0;
+	zip_putUInt(ptr + 1, gPFileData->compressionFlags, 2);
+	zip_putUInt(ptr + 3, gPFileData->compressionMethod, 2);
+	zip_putUInt(ptr + 5, (uio_uint64) gPFileData->compressedSize, 4);
+	zip_putUInt(ptr + 9, (uio_uint64) gPFileData->uncompressedSize, 4);
+	zip_putUInt(ptr + 13, (uio_uint64) gPFileData->headerOffset, 4);
+	zip_putUInt(ptr + 17, (uio_uint64) gPFileData->mode, 4);
+	zip_putUInt(ptr + 21, (uio_uint64) gPFileData->uid, 4);
+	zip_putUInt(ptr + 25, (uio_uint64) gPFileData->gid, 4);
+	zip_putUInt(ptr + 29, (uio_uint64) gPFileData->atime, 8);
+	zip_putUInt(ptr + 37, (uio_uint64) gPFileData->mtime, 8);
+	zip_putUInt(ptr + 45, (uio_uint64) gPFileData->ctime, 8);
+	zip_putUInt(ptr + 53, nameLen, 2);
+	memcpy(ptr + zip_DIRCACHE_RECORD_SIZE, name, nameLen + 1);
+
+	cache->bufFill += recordSize;
+	cache->numRecords++;
+}
+
+static void
+zip_makeDirCacheName(const zip_DirCacheKey *key, char *buf,
+		size_t bufSize) {
+	snprintf(buf, bufSize, "%lx-%lx-%lx.zipdir",
+			(unsigned long) key->fileSize, (unsigned long) key->mtime,
+			(unsigned long) key->centralDirOffset);
+}
+
+// Returns 1 if the directory structure was filled from the cache,
+// 0 if there is no (valid) cache file, and -1 on error, with errno set.
+static int
+zip_loadDirCache(uio_GPDir *top, const zip_DirCacheKey *key) {
+	char name[64];
+	uio_Handle *handle;
+	struct stat statBuf;
+	unsigned char *buf;
+	const unsigned char *ptr;
+	const unsigned char *end;
+	ssize_t numRead;
+	uio_uint32 numRecords;
+	uio_uint32 recordI;
+
+	zip_makeDirCacheName(key, name, sizeof name);
+	handle = uio_open(zip_cacheDir, name, O_RDONLY
+#ifdef WIN32
+			| O_BINARY
+#endif
+			, 0);
+	if (handle == NULL)
+		return 0;
+	if (uio_fstat(handle, &statBuf) == -1) {
+		uio_close(handle);
+		return 0;
+	}
+	if (statBuf.st_size < zip_DIRCACHE_HEADER_SIZE) {
+		uio_close(handle);
+		uio_unlink(zip_cacheDir, name);
+		return 0;
+	}
+
+	buf = uio_malloc(statBuf.st_size);
+	numRead = uio_read(handle, buf, statBuf.st_size);
+	uio_close(handle);
+	if (numRead != statBuf.st_size)
+		goto bad;
+	end = buf + numRead;
+
+	if (memcmp(buf, zip_DIRCACHE_MAGIC, 4) != 0 ||
+			zip_getUInt(buf + 4, 4) != zip_DIRCACHE_VERSION ||
+			zip_getUInt(buf + 8, 8) != key->fileSize ||
+			zip_getUInt(buf + 16, 8) != key->mtime ||
+			zip_getUInt(buf + 24, 4) != key->centralDirOffset ||
+			zip_getUInt(buf + 28, 4) != key->centralDirSize ||
+			zip_getUInt(buf + 32, 4) != key->numEntries)
+		goto bad;
+	numRecords = (uio_uint32) zip_getUInt(buf + 36, 4);
+
+	// Check the entire file before anything is added to the directory
+	// structure.
+	ptr = buf + zip_DIRCACHE_HEADER_SIZE;
+	for (recordI = 0; recordI < numRecords; recordI++) {
+		size_t nameLen;
+
+		if (end - ptr < zip_DIRCACHE_RECORD_SIZE)
+			goto bad;
+		nameLen = (size_t) zip_getUInt(ptr + 53, 2);
+		if ((size_t) (end - ptr) < zip_DIRCACHE_RECORD_SIZE + nameLen + 1
+				|| ptr[zip_DIRCACHE_RECORD_SIZE + nameLen] != '\0')
+			goto bad;
+		ptr += zip_DIRCACHE_RECORD_SIZE + nameLen + 1;
+	}
+	if (ptr != end)
+		goto bad;
+
+	zip_GPRootData_reserve(top->pRoot->extra->extra, numRecords);
+	ptr = buf + zip_DIRCACHE_HEADER_SIZE;
+	for (recordI = 0; recordI < numRecords; recordI++) {
+		zip_GPFileData *gPFileData;
+		const char *fileName;
+		size_t nameLen;
+		int result;
+
+		gPFileData = zip_GPFileData_new(top->pRoot->extra->extra);
+		gPFileData->compressionFlags = (uio_uint16) zip_getUInt(ptr + 1, 2);
+		gPFileData->compressionMethod =
+				(uio_uint16) zip_getUInt(ptr + 3, 2);
+		gPFileData->compressedSize = (off_t) zip_getUInt(ptr + 5, 4);
+		gPFileData->uncompressedSize = (off_t) zip_getUInt(ptr + 9, 4);
+		gPFileData->headerOffset = (off_t) zip_getUInt(ptr + 13, 4);
+		gPFileData->fileOffset = (off_t) -1;
+		gPFileData->mode = (mode_t) zip_getUInt(ptr + 17, 4);
+		gPFileData->uid = (uid_t) zip_getUInt(ptr + 21, 4);
+		gPFileData->gid = (gid_t) zip_getUInt(ptr + 25, 4);
+		gPFileData->atime = (time_t) zip_getUInt(ptr + 29, 8);
+		gPFileData->mtime = (time_t) zip_getUInt(ptr + 37, 8);
+		gPFileData->ctime = (time_t) zip_getUInt(ptr + 45, 8);
+		nameLen = (size_t) zip_getUInt(ptr + 53, 2);
+		fileName = (const char *) ptr + zip_DIRCACHE_RECORD_SIZE;
+
+		if (ptr[0])
+			result = zip_foundDir(top, fileName, gPFileData);
+		else
+			result = zip_foundFile(top, fileName, gPFileData);
+		if (result == -1) {
+			// These entries were all accepted when the cache was
+			// written. The directory structure is incomplete now, so
+			// the mount fails.
+			int savedErrno = errno;
+			uio_free(buf);
+			errno = savedErrno;
+			return -1;
+		}
+
+		ptr += zip_DIRCACHE_RECORD_SIZE + nameLen + 1;
+	}
+
+	uio_free(buf);
+	return 1;
+
+bad:
+#ifdef DEBUG
+	fprintf(stderr, "Warning: Ignoring bad .zip directory cache file "
+			"'%s'.\n", name);
+#endif
+	uio_free(buf);
+	// zip_storeDirCache() will write a new one. uio_rename() does not
+	// replace an existing file.
+	uio_unlink(zip_cacheDir, name);
+	return 0;
+}
+
+static void
+zip_storeDirCache(const zip_DirCacheKey *key, zip_DirCache *cache) {
+	char name[64];
+	char tempName[72];
+	uio_Handle *handle;
+	ssize_t numWritten;
+
+	memcpy(cache->buf, zip_DIRCACHE_MAGIC, 4);
+	zip_putUInt(cache->buf + 4, zip_DIRCACHE_VERSION, 4);
+	zip_putUInt(cache->buf + 8, key->fileSize, 8);
+	zip_putUInt(cache->buf + 16, key->mtime, 8);
+	zip_putUInt(cache->buf + 24, key->centralDirOffset, 4);
+	zip_putUInt(cache->buf + 28, key->centralDirSize, 4);
+	zip_putUInt(cache->buf + 32, key->numEntries, 4);
+	zip_putUInt(cache->buf + 36, cache->numRecords, 4);
+
+	// Write to a temporary file first, so that an interrupted write
+	// does not leave a truncated cache file behind.
+	zip_makeDirCacheName(key, name, sizeof name);
+	snprintf(tempName, sizeof tempName, "%s.tmp", name);
+	handle = uio_open(zip_cacheDir, tempName, O_WRONLY | O_CREAT | O_TRUNC
+#ifdef WIN32
+			| O_BINARY
+#endif
+			, S_IRUSR | S_IWUSR);
+	if (handle == NULL)
+		return;
+	numWritten = uio_write(handle, cache->buf, cache->bufFill);
+	uio_close(handle);
+	if (numWritten != (ssize_t) cache->bufFill) {
+		uio_unlink(zip_cacheDir, tempName);
+		return;
+	}
+	// uio_rename() fails if the target exists, as with a cache file
+	// that another process wrote in the meantime.
+	uio_unlink(zip_cacheDir, name);
+	if (uio_rename(zip_cacheDir, tempName, zip_cacheDir, name) == -1)
+		uio_unlink(zip_cacheDir, tempName);
+}
+
 static mode_t
 zip_makeFileMode(zip_OSType creatorOS, uio_uint32 modeBytes) {
 	switch (creatorOS) {
@@ -1101,7 +1495,7 @@ zip_fillDirStructureLocalProcessEntry(uio_GPDir *topGPDir,
 	if (numBytes != 26)
 		return zip_badFile(NULL, NULL);
 
-	gPFileData = zip_GPFileData_new();
+	gPFileData = zip_GPFileData_new(topGPDir->pRoot->extra->extra);
 	gPFileData->compressionFlags = makeUInt16(buf[2], buf[3]);
 	gPFileData->compressionMethod = makeUInt16(buf[4], buf[5]);
 	lastModTime = makeUInt16(buf[6], buf[7]);
@@ -1636,44 +2030,69 @@ zip_free(voidpf opaque, voidpf address) {
 	uio_free((void *) address);
 }
 
-static inline zip_GPFileData *
-zip_GPFileData_new(void) {
-	return zip_GPFileData_alloc();
-}
-
-static inline void
-zip_GPFileData_delete(zip_GPFileData *gPFileData) {
-	zip_GPFileData_free(gPFileData);
-}
-
-static inline zip_GPFileData *
-zip_GPFileData_alloc(void) {
-	zip_GPFileData *result = uio_malloc(sizeof (zip_GPFileData));
+static inline zip_GPRootData *
+zip_GPRootData_new(void) {
+	zip_GPRootData *result = uio_malloc(sizeof (zip_GPRootData));
 #ifdef uio_MEM_DEBUG
-	uio_MemDebug_debugAlloc(zip_GPFileData, (void *) result);
+	uio_MemDebug_debugAlloc(zip_GPRootData, (void *) result);
 #endif
+	result->blocks = NULL;
 	return result;
 }
 
-static inline void
-zip_GPFileData_free(zip_GPFileData *gPFileData) {
+static void
+zip_GPRootData_delete(zip_GPRootData *gPRootData) {
+	while (gPRootData->blocks != NULL) {
+		zip_GPFileDataBlock *next = gPRootData->blocks->next;
+		uio_free(gPRootData->blocks->entries);
+		uio_free(gPRootData->blocks);
+		gPRootData->blocks = next;
+	}
 #ifdef uio_MEM_DEBUG
-	uio_MemDebug_debugFree(zip_GPFileData, (void *) gPFileData);
+	uio_MemDebug_debugFree(zip_GPRootData, (void *) gPRootData);
 #endif
-	uio_free(gPFileData);
+	uio_free(gPRootData);
+}
+
+// Make sure that the next 'count' calls to zip_GPFileData_new() are
+// served from a single allocation.
+static void
+zip_GPRootData_reserve(zip_GPRootData *gPRootData, size_t count) {
+	zip_GPFileDataBlock *block = gPRootData->blocks;
+
+	if (count == 0 ||
+			(block != NULL && block->numEntries - block->numUsed >= count))
+		return;
+
+	block = uio_malloc(sizeof (zip_GPFileDataBlock));
+	block->entries = uio_malloc(count * sizeof (zip_GPFileData));
+	block->numUsed = 0;
+	block->numEntries = count;
+	block->next = gPRootData->blocks;
+	gPRootData->blocks = block;
+}
+
+static inline zip_GPFileData *
+zip_GPFileData_new(zip_GPRootData *gPRootData) {
+	zip_GPFileDataBlock *block = gPRootData->blocks;
+
+	if (block == NULL || block->numUsed == block->numEntries) {
+		zip_GPRootData_reserve(gPRootData, zip_GPFILEDATA_BLOCK_SIZE);
+		block = gPRootData->blocks;
+	}
+	return &block->entries[block->numUsed++];
 }
 
+// zip_GPFileData are freed along with the zip_GPRootData they were
+// allocated from.
 static inline void
-zip_GPDirData_delete(zip_GPDirData *gPDirData) {
-	zip_GPDirData_free(gPDirData);
+zip_GPFileData_delete(zip_GPFileData *gPFileData) {
+	(void) gPFileData;
 }
 
 static inline void
-zip_GPDirData_free(zip_GPDirData *gPDirData) {
-#ifdef uio_MEM_DEBUG
-	uio_MemDebug_debugFree(zip_GPFileData, (void *) gPDirData);
-#endif
-	uio_free(gPDirData);
+zip_GPDirData_delete(zip_GPDirData *gPDirData) {
+	zip_GPFileData_delete(gPDirData);
 }
 
 
@@ -19,7 +19,7 @@
  */
 
 typedef struct zip_Handle *uio_NativeHandle;
-typedef void *uio_GPRootExtra;
+typedef struct zip_GPRootData *uio_GPRootExtra;
 typedef struct zip_GPFileData *uio_GPFileExtra;
 typedef struct zip_GPFileData *uio_GPDirExtra;
 typedef struct uio_GPDirEntries_Iterator *uio_NativeEntriesContext;
@@ -77,6 +77,20 @@ typedef zip_GPFileData zip_GPDirData;
 // directories. A few bytes could be saved here by making a seperate
 // structure.
 
+// The zip_GPFileData of a mounted .zip file are allocated in blocks,
+// as the number of entries is known up front. They are all freed
+// together when the file system is unmounted.
+typedef struct zip_GPFileDataBlock {
+	struct zip_GPFileDataBlock *next;
+	size_t numUsed;
+	size_t numEntries;
+	zip_GPFileData *entries;
+} zip_GPFileDataBlock;
+
+typedef struct zip_GPRootData {
+	zip_GPFileDataBlock *blocks;
+} zip_GPRootData;
+
 typedef struct zip_Handle {
 	uio_GPFile *file;
 	z_stream zipStream;
@@ -89,6 +103,7 @@ typedef struct zip_Handle {
 } zip_Handle;
 
 
+int zip_unInit(void);
 uio_PRoot *zip_mount(uio_Handle *handle, int flags);
 int zip_umount(struct uio_PRoot *);
 uio_Handle *zip_open(uio_PDirHandle *pDirHandle, const char *file, int flags,
@@ -100,6 +115,7 @@ int zip_stat(uio_PDirHandle *pDirHandle, const char *name,
 		struct stat *statBuf);
 ssize_t zip_read(uio_Handle *handle, void *buf, size_t count);
 off_t zip_seek(uio_Handle *handle, off_t offset, int whence);
+int zip_map(uio_Handle *handle, off_t offset, size_t size, uio_FileMap *map);
 
 
 
@@ -31,6 +31,7 @@
 #include "libs/log.h"
 #include "libs/reslib.h"
 #include "libs/memlib.h"
+#include "libs/timelib.h"
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -83,6 +84,11 @@ static void mountAddonDir (uio_Repository *repository,
 
 static void mountDirZips (uio_DirHandle *dirHandle, const char *mountPoint,
 		int relativeFlags, uio_MountHandle *relativeHandle);
+#ifdef HAVE_HTTP
+static void mountContentManifest (uio_MountHandle *contentMountHandle);
+#endif
+static uio_DirHandle *openCacheDir (void);
+static double perfCounterToMs (uint64 count);
 
 
 // Looks for a file 'file' in all 'numLocs' locations from 'locs'.
@@ -137,6 +143,7 @@ prepareContentDir (const char *contentDirName, const char* addonDirName, const c
 {
 	const char *testFile = "version";
 	const char *loc;
+	uint64 mountStart;
 
 	if (contentDirName == NULL)
 	{
@@ -190,11 +197,17 @@ prepareContentDir (const char *contentDirName, const char* addonDirName, const c
 	}
 	
 	log_add (log_Debug, "Using '%s' as base content dir.", baseContentPath);
+	mountStart = GetPerfCounter ();
 	contentMountHandle = mountContentDir (repository, baseContentPath);
+	log_add (log_Info, "Base content mounted in %.1f ms.",
+			perfCounterToMs (GetPerfCounter () - mountStart));
 
 	if (addonDirName)
 		log_add (log_Debug, "Using '%s' as addon dir.", addonDirName);
+	mountStart = GetPerfCounter ();
 	mountAddonDir (repository, contentMountHandle, addonDirName);
+	log_add (log_Info, "Addons mounted in %.1f ms.",
+			perfCounterToMs (GetPerfCounter () - mountStart));
 
 #ifndef __APPLE__
 	(void) execFile;
@@ -351,6 +364,25 @@ mountContentDir (uio_Repository *repository, const char *contentPath)
 		exit (EXIT_FAILURE);
 	}
 
+#ifdef HAVE_ZIP
+	{
+		// Remember the directory structure of the .zip packages, so
+		// that it does not need to be read again on the next start.
+		uio_DirHandle *cacheDir = openCacheDir ();
+		uio_setZipCacheDir (cacheDir);
+		if (cacheDir != NULL)
+			uio_closeDir (cacheDir);
+	}
+#endif
+
+	// Keep compiled conversation string tables, so that conversations
+	// do not need to be parsed again on the next start.
+	SetStringTableCacheDir (openCacheDir ());
+
+#ifdef HAVE_HTTP
+	mountContentManifest (contentMountHandle);
+#endif
+
 	packagesDir = uio_openDir (repository, "/packages", 0);
 	if (packagesDir != NULL)
 	{
@@ -361,6 +393,60 @@ mountContentDir (uio_Repository *repository, const char *contentPath)
 	return contentMountHandle;
 }
 
+#ifdef HAVE_HTTP
+// If the content dir contains a manifest, the files listed in it are
+// fetched over HTTP when they are first used. This is how the wasm build
+// gets its content without downloading all of it up front.
+// The fetched data is also kept in the 'cache' dir in the config dir.
+static void
+mountContentManifest (uio_MountHandle *contentMountHandle)
+{
+	static uio_AutoMount *autoMount[] = { NULL };
+	const char *manifestName = "content.manifest";
+	uio_DirHandle *cacheDir;
+
+	if (!fileExists2 (contentDir, manifestName))
+		return;
+
+	cacheDir = openCacheDir ();
+	uio_setHttpCacheOptions (uio_HTTP_DEFAULT_CACHE_SIZE, cacheDir);
+	if (cacheDir != NULL)
+		uio_closeDir (cacheDir);
+
+	if (uio_mountDir (repository, "/", uio_FSTYPE_HTTP, contentDir,
+			manifestName, "/", autoMount,
+			uio_MOUNT_BELOW | uio_MOUNT_RDONLY, contentMountHandle) == NULL)
+	{
+		log_add (log_Warning, "Warning: Could not mount '%s': %s.",
+				manifestName, strerror (errno));
+		return;
+	}
+	log_add (log_Debug, "Content is fetched as listed in '%s'.",
+			manifestName);
+}
+#endif
+
+// The 'cache' dir in the config dir holds data derived from the content,
+// which is kept across runs. Returns NULL if it can not be used.
+static uio_DirHandle *
+openCacheDir (void)
+{
+	if (uio_mkdir (configDir, "cache", 0777) == -1 && errno != EEXIST)
+	{
+		log_add (log_Warning, "Warning: Could not create the content "
+				"cache dir: %s", strerror (errno));
+		return NULL;
+	}
+	return uio_openDirRelative (configDir, "cache", 0);
+}
+
+static double
+perfCounterToMs (uint64 count)
+{
+	uint64 frequency = GetPerfFrequency ();
+	return (double) count * 1000.0 / (double) frequency;
+}
+
 static void
 mountAddonDir (uio_Repository *repository, uio_MountHandle *contentMountHandle,
 		const char *addonDirName)
@@ -474,6 +560,8 @@ mountDirZips (uio_DirHandle *dirHandle, const char *mountPoint,
 		
 		for (i = 0; i < dirList->numNames; i++)
 		{
+			uint64 start = GetPerfCounter ();
+
 			if (uio_mountDir (repository, mountPoint, uio_FSTYPE_ZIP,
 					dirHandle, dirList->names[i], "/", autoMount,
 					relativeFlags | uio_MOUNT_RDONLY,
@@ -481,7 +569,11 @@ mountDirZips (uio_DirHandle *dirHandle, const char *mountPoint,
 			{
 				log_add (log_Warning, "Warning: Could not mount '%s': %s.",
 						dirList->names[i], strerror (errno));
+				continue;
 			}
+			log_add (log_Debug, "Mounted '%s' in %.1f ms.",
+					dirList->names[i],
+					perfCounterToMs (GetPerfCounter () - start));
 		}
 	}
 	uio_DirList_free (dirList);
@@ -613,6 +705,7 @@ prepareAddons (const char **addons)
 void
 unprepareAllDirs (void)
 {
+	SetStringTableCacheDir (NULL);
 	if (saveDir)
 	{
 		uio_closeDir (saveDir);
@@ -0,0 +1,410 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Runs the game clock of uqm/clock.c for 10 years, with a handler in
+// place of that of the game which adds a new event for each one that is
+// handled, at distances like those of the game. Each handler call is
+// hashed with its date. Checks that the hash is the same when the clock
+// is moved with MoveGameClockDays() as when it ticks day by day, and the
+// same as that of the sorted list that the events were kept in before,
+// and that the date is drawn once by MoveGameClockDays(). This is done
+// with and without an event which comes back every day, as the
+// hyperspace encounter event does in the game. It prints how long 10
+// years take each way.
+//
+// Then it checks that an event put at a date that has passed, as when
+// loading a game, is handled on the next day, and that ForAllEvents()
+// and MoveGameClockToNextEvent() give the events in date order.
+//
+// Usage: clocktest [repetitions]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "uqm/clock.h"
+#include "uqm/gameev.h"
+#include "uqm/globdata.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+#include "libs/threadlib.h"
+
+// The hashes that the sorted list of events gave, with and without the
+// daily event.
+#define REFERENCE_HASH_DAILY 0xfa6a30befe7e5a59ULL
+#define REFERENCE_HASH 0xbb4559f42d80692cULL
+
+#define NUM_DAYS 3652
+		// 10 years.
+#define END_YEAR (START_YEAR + 10)
+#define END_MONTH 2
+#define END_DAY 16
+
+// What the rest of the game would provide.
+
+GLOBDATA GlobData;
+
+static uint64 handlerHash;
+static unsigned long numHandlers;
+static unsigned long numDraws;
+static BOOLEAN addDailyEvent;
+static BYTE lastHandled;
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	(void) level;
+	(void) fmt;
+}
+
+void *
+HMalloc (size_t size)
+{
+	return malloc (size);
+}
+
+void *
+HCalloc (size_t size)
+{
+	return calloc (1, size);
+}
+
+void *
+HRealloc (void *p, size_t size)
+{
+	return realloc (p, size);
+}
+
+void
+HFree (void *p)
+{
+	free (p);
+}
+
+void *
+HMallocObject (size_t size)
+{
+	return malloc (size);
+}
+
+void
+HFreeObject (void *p, size_t size)
+{
+	(void) size;
+	free (p);
+}
+
+Mutex
+CreateMutex_Core (const char *name, DWORD syncClass)
+{
+	(void) name;
+	(void) syncClass;
+	return (Mutex) 1;
+}
+
+void
+DestroyMutex (Mutex mutex)
+{
+	(void) mutex;
+}
+
+void
+LockMutex (Mutex mutex)
+{
+	(void) mutex;
+}
+
+void
+UnlockMutex (Mutex mutex)
+{
+	(void) mutex;
+}
+
+void
+DrawStatusMessage (const UNICODE *pStr)
+{
+	(void) pStr;
+	numDraws++;
+}
+
+static uint64
+hashValue (uint64 hash, DWORD value)
+{
+	hash ^= value;
+	hash *= 1099511628211ULL;
+	return hash;
+}
+
+void
+EventHandler (BYTE selector)
+{
+	handlerHash = hashValue (handlerHash,
+			GLOBAL (GameClock.year_index) * 10000u
+			+ GLOBAL (GameClock.month_index) * 100u
+			+ GLOBAL (GameClock.day_index));
+	handlerHash = hashValue (handlerHash, selector);
+	numHandlers++;
+	lastHandled = selector;
+
+	switch (selector)
+	{
+		case HYPERSPACE_ENCOUNTER_EVENT:
+			if (addDailyEvent)
+				AddEvent (RELATIVE_EVENT, 0, 1, 0, selector);
+			break;
+		case ARILOU_ENTRANCE_EVENT:
+			AddEvent (RELATIVE_EVENT, 0, 3, 0, ARILOU_EXIT_EVENT);
+			break;
+		case ARILOU_EXIT_EVENT:
+		{
+			COUNT month = GLOBAL (GameClock.month_index) + 1;
+			COUNT year = GLOBAL (GameClock.year_index);
+
+			if (month > 12)
+			{
+				month = 1;
+				++year;
+			}
+			AddEvent (ABSOLUTE_EVENT, month, 17, year, ARILOU_ENTRANCE_EVENT);
+			break;
+		}
+		case KOHR_AH_GENOCIDE_EVENT:
+		case ZOQFOT_DISTRESS_EVENT:
+		case SPATHI_SHIELD_EVENT:
+			AddEvent (RELATIVE_EVENT, 0, 7, 0, selector);
+			break;
+		case ADVANCE_PKUNK_MISSION:
+		case SHOFIXTI_RETURN_EVENT:
+			AddEvent (RELATIVE_EVENT, 3, 0, 0, selector);
+			break;
+		case ZOQFOT_DEATH_EVENT:
+			AddEvent (RELATIVE_EVENT, 6, 0, 0, selector);
+			break;
+		case ADVANCE_MYCON_MISSION:
+			AddEvent (RELATIVE_EVENT, 0, 14, 0, selector);
+			break;
+		case ARILOU_UMGAH_CHECK:
+			AddEvent (RELATIVE_EVENT, 0, 10, 0, selector);
+			break;
+		case SLYLANDRO_RAMP_UP:
+			AddEvent (RELATIVE_EVENT, 0, 182, 0, selector);
+			break;
+		case SLYLANDRO_RAMP_DOWN:
+			AddEvent (RELATIVE_EVENT, 0, 23, 0, selector);
+			break;
+		case KOHR_AH_VICTORIOUS_EVENT:
+			AddEvent (RELATIVE_EVENT, 1, 13, 1, selector);
+			break;
+		default:
+			AddEvent (RELATIVE_EVENT, 0, 5 + selector, 0, selector);
+			break;
+	}
+}
+
+static void
+addStartEvents (void)
+{
+	BYTE selector;
+
+	AddEvent (ABSOLUTE_EVENT, 3, 17, START_YEAR, ARILOU_ENTRANCE_EVENT);
+	for (selector = 2; selector < NUM_EVENTS; selector++)
+		AddEvent (RELATIVE_EVENT, (selector * 7) % 13 / 5, selector * 3, 0,
+				selector);
+}
+
+static double
+msSince (const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start->tv_sec) * 1000.0
+			+ (double) (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// Runs the clock for 10 years 'numReps' times, and checks the outcome.
+// Returns the number of failures.
+static int
+runYears (BOOLEAN dayByDay, int numReps)
+{
+	const char *how = dayByDay ? "day by day" : "MoveGameClockDays";
+	uint64 expectedHash = addDailyEvent ? REFERENCE_HASH_DAILY :
+			REFERENCE_HASH;
+	struct timespec start;
+	int failures = 0;
+	int numRun = 0;
+	int rep;
+
+	numHandlers = 0;
+	numDraws = 0;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (rep = 0; rep < numReps; rep++)
+	{
+		uint64 repHash;
+
+		handlerHash = 14695981039346656037ULL;
+		InitGameClock ();
+		addStartEvents ();
+		if (dayByDay)
+		{
+			int day;
+
+			SetGameClockRate (HYPERSPACE_CLOCK_RATE);
+			for (day = 0; day < NUM_DAYS; day++)
+			{
+				// Make the next tick start a new day.
+				GLOBAL (GameClock.tick_count) = 1;
+				GameClockTick ();
+			}
+		}
+		else
+			MoveGameClockDays (NUM_DAYS);
+
+		repHash = handlerHash;
+		if (GLOBAL (GameClock.year_index) != END_YEAR ||
+				GLOBAL (GameClock.month_index) != END_MONTH ||
+				GLOBAL (GameClock.day_index) != END_DAY)
+		{
+			printf ("%s: the clock ended at %u-%u-%u\n", how,
+					GLOBAL (GameClock.year_index),
+					GLOBAL (GameClock.month_index),
+					GLOBAL (GameClock.day_index));
+			failures++;
+		}
+		UninitGameClock ();
+		numRun++;
+
+		if (repHash != expectedHash)
+		{
+			printf ("%s: hash %016llx, expected %016llx\n", how,
+					(unsigned long long) repHash,
+					(unsigned long long) expectedHash);
+			failures++;
+			break;
+		}
+	}
+
+	printf ("%s%s: %lu handlers, %lu date draws, %.1f us per 10 years\n",
+			how, addDailyEvent ? ", daily event" : "",
+			numHandlers / numRun, numDraws / numRun,
+			msSince (&start) * 1000.0 / numRun);
+	if (numDraws / numRun != (dayByDay ? NUM_DAYS : 1))
+	{
+		printf ("%s: the date was drawn %lu times\n", how,
+				numDraws / numRun);
+		failures++;
+	}
+	return failures;
+}
+
+static void
+collectEvent (const EVENT *event, void *arg)
+{
+	BYTE **next = arg;
+
+	*(*next)++ = event->func_index;
+}
+
+static int
+checkEventOrder (void)
+{
+	static const BYTE expected[] = {
+		SHOFIXTI_RETURN_EVENT, SPATHI_SHIELD_EVENT, ZOQFOT_DISTRESS_EVENT,
+		ARILOU_EXIT_EVENT,
+	};
+	EVENT past;
+	BYTE order[4];
+	BYTE *next = order;
+	BYTE selector;
+	int failures = 0;
+
+	InitGameClock ();
+	addDailyEvent = FALSE;
+
+	// A loaded game may hold an event for a day that has passed.
+	past.month_index = 1;
+	past.day_index = 1;
+	past.year_index = START_YEAR;
+	past.func_index = SHOFIXTI_RETURN_EVENT;
+	PutEvent (&past);
+	// Two events for the same date keep their order.
+	AddEvent (RELATIVE_EVENT, 0, 5, 0, ZOQFOT_DISTRESS_EVENT);
+	AddEvent (RELATIVE_EVENT, 0, 5, 0, ARILOU_EXIT_EVENT);
+	AddEvent (RELATIVE_EVENT, 0, 2, 0, SPATHI_SHIELD_EVENT);
+
+	ForAllEvents (collectEvent, &next);
+	if (next != order + 4 || memcmp (order, expected, 4) != 0)
+	{
+		printf ("ForAllEvents: the events are not in date order\n");
+		failures++;
+	}
+
+	SetGameClockRate (HYPERSPACE_CLOCK_RATE);
+	numHandlers = 0;
+	GLOBAL (GameClock.tick_count) = 1;
+	GameClockTick ();
+	if (numHandlers != 1 || lastHandled != SHOFIXTI_RETURN_EVENT)
+	{
+		printf ("GameClockTick: the event from the past was not handled\n");
+		failures++;
+	}
+
+	// That handler added one for 3 months later; the others come first.
+	numHandlers = 0;
+	if (!MoveGameClockToNextEvent (&selector) ||
+			selector != SPATHI_SHIELD_EVENT || numHandlers != 1 ||
+			GLOBAL (GameClock.day_index) != 19)
+	{
+		printf ("MoveGameClockToNextEvent: the wrong event was handled\n");
+		failures++;
+	}
+	numHandlers = 0;
+	if (!MoveGameClockToNextEvent (&selector) ||
+			selector != ZOQFOT_DISTRESS_EVENT || numHandlers != 2 ||
+			lastHandled != ARILOU_EXIT_EVENT)
+	{
+		printf ("MoveGameClockToNextEvent: the events of a day were not "
+				"all handled, in order\n");
+		failures++;
+	}
+
+	UninitGameClock ();
+	return failures;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int numReps = argc > 1 ? atoi (argv[1]) : 1000;
+	int failures = 0;
+
+	if (numReps < 1)
+		numReps = 1;
+
+	addDailyEvent = TRUE;
+	failures += runYears (FALSE, numReps);
+	failures += runYears (TRUE, numReps);
+	addDailyEvent = FALSE;
+	failures += runYears (FALSE, numReps);
+	failures += runYears (TRUE, numReps);
+
+	failures += checkEventOrder ();
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
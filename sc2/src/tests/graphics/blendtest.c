@@ -0,0 +1,421 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Checks the blending kernels of libs/graphics/blend.c against the
+// results that blend.h describes. TFB_BlendPixels() and TFB_BlendFill()
+// are checked for every source value, destination value and alpha, also
+// for rows that do not fill a whole SIMD register and for rows that do
+// not start at an aligned address; pixels outside the rectangle must not
+// change. TFB_BlendColors() is checked for every pair of channel values,
+// at a range of weights, against the per-channel formula that
+// XFormColorMap_step() used before.
+//
+// Then it prints the time per frame of a crossfade and of a fade to a
+// colour, at 1x, 2x and 3x the size of the screen, and the time to blend
+// a palette, with the kernels and with that per-channel formula. The
+// kernel that is used is chosen when blend.c is compiled; build this
+// also with -U__SSE2__ for the plain C version.
+//
+// Usage: blendtest [repetitions]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "libs/graphics/blend.h"
+
+#define NUM_PAIRS 0x10000
+		// Every pair of channel values.
+#define GUARD 16
+		// Bytes before and after each row that must not change.
+
+static BYTE srcBytes[NUM_PAIRS + 2 * GUARD];
+static BYTE dstBytes[NUM_PAIRS + 2 * GUARD];
+static BYTE expected[NUM_PAIRS + 2 * GUARD];
+
+// What blend.h describes.
+
+static BYTE
+refPixelChan (BYTE src, BYTE dst, BYTE alpha)
+{
+	DWORD t = (DWORD) src * alpha + (DWORD) dst * (255 - alpha);
+	// No value of 't' is exactly halfway two multiples of 255.
+	return (BYTE) ((t + 127) / 255);
+}
+
+// blendChan() of XFormColorMap_step(), before the kernels.
+static BYTE
+refColorChan (BYTE c1, BYTE c2, int weight, int scale)
+{
+	return c1 + ((int) c2 - c1) * weight / scale;
+}
+
+static const char *
+kernelName (void)
+{
+	// The same choice as in blend.c.
+#if defined(__SSE2__) || defined(_M_X64) \
+		|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return "SSE2";
+#else
+	return "plain C";
+#endif
+}
+
+// Fills the source and destination rows so that channel i has
+// source value i >> 8 and destination value i & 0xff, with guard bytes
+// around them.
+static void
+fillPairs (void)
+{
+	int i;
+
+	memset (srcBytes, 0x5a, sizeof srcBytes);
+	memset (dstBytes, 0xa5, sizeof dstBytes);
+	for (i = 0; i < NUM_PAIRS; i++)
+	{
+		srcBytes[GUARD + i] = (BYTE) (i >> 8);
+		dstBytes[GUARD + i] = (BYTE) i;
+	}
+}
+
+static int
+checkBlendPixels (void)
+{
+	int failures = 0;
+	int alpha;
+	int i;
+
+	for (alpha = 0; alpha < 256; alpha++)
+	{
+		fillPairs ();
+		memcpy (expected, dstBytes, sizeof expected);
+		for (i = 0; i < NUM_PAIRS; i++)
+			expected[GUARD + i] = refPixelChan ((BYTE) (i >> 8), (BYTE) i,
+					(BYTE) alpha);
+
+		TFB_BlendPixels (dstBytes + GUARD, NUM_PAIRS, srcBytes + GUARD,
+				NUM_PAIRS, NUM_PAIRS / 4, 1, (BYTE) alpha);
+		if (memcmp (dstBytes, expected, sizeof expected) != 0)
+		{
+			printf ("TFB_BlendPixels: wrong result with alpha %d\n", alpha);
+			failures++;
+		}
+	}
+
+	// Short rows, at every pixel offset from an aligned address, and a
+	// rectangle of more than one row.
+	for (alpha = 0; alpha < 256; alpha += 15)
+	{
+		int w;
+
+		for (w = 1; w <= 20; w++)
+		{
+			int offset;
+
+			for (offset = 0; offset < 4; offset++)
+			{
+				const int pitch = 25 * 4;
+				const int h = 3;
+				BYTE *dst = dstBytes + GUARD + offset * 4;
+				const BYTE *src = srcBytes + GUARD + 1000 + offset * 4;
+				int y;
+
+				fillPairs ();
+				memcpy (expected, dstBytes, sizeof expected);
+				for (y = 0; y < h; y++)
+				{
+					for (i = 0; i < w * 4; i++)
+					{
+						size_t pos = (size_t) (dst - dstBytes)
+								+ y * pitch + i;
+						expected[pos] = refPixelChan (src[y * pitch + i],
+								dstBytes[pos], (BYTE) alpha);
+					}
+				}
+
+				TFB_BlendPixels (dst, pitch, src, pitch, w, h,
+						(BYTE) alpha);
+				if (memcmp (dstBytes, expected, sizeof expected) != 0)
+				{
+					printf ("TFB_BlendPixels: wrong result for %d pixels "
+							"at offset %d, alpha %d\n", w, offset, alpha);
+					failures++;
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+static int
+checkBlendFill (void)
+{
+	int failures = 0;
+	int alpha;
+	int value;
+	int i;
+
+	for (alpha = 0; alpha < 256; alpha++)
+	{
+		for (value = 0; value < 256; value++)
+		{
+			// Every destination value, for every fill value.
+			uint32 pixel = (uint32) value * 0x01010101U;
+
+			fillPairs ();
+			memcpy (expected, dstBytes, sizeof expected);
+			for (i = 0; i < 256; i++)
+				expected[GUARD + i] = refPixelChan ((BYTE) value, (BYTE) i,
+						(BYTE) alpha);
+
+			TFB_BlendFill (dstBytes + GUARD, 256, 64, 1, pixel, (BYTE) alpha);
+			if (memcmp (dstBytes, expected, sizeof expected) != 0)
+			{
+				printf ("TFB_BlendFill: wrong result for %d with alpha %d\n",
+						value, alpha);
+				failures++;
+				break;
+			}
+		}
+	}
+
+	// A pixel of different channels, for rows of every length up to 20.
+	for (alpha = 1; alpha < 256; alpha += 17)
+	{
+		const uint32 pixel = 0x11c07f3aU;
+		BYTE pixelBytes[4];
+		int w;
+
+		memcpy (pixelBytes, &pixel, 4);
+		for (w = 1; w <= 20; w++)
+		{
+			fillPairs ();
+			memcpy (expected, dstBytes, sizeof expected);
+			for (i = 0; i < w * 4; i++)
+				expected[GUARD + 4 + i] = refPixelChan (pixelBytes[i & 3],
+						dstBytes[GUARD + 4 + i], (BYTE) alpha);
+
+			TFB_BlendFill (dstBytes + GUARD + 4, w * 4, w, 1, pixel,
+					(BYTE) alpha);
+			if (memcmp (dstBytes, expected, sizeof expected) != 0)
+			{
+				printf ("TFB_BlendFill: wrong result for %d pixels, "
+						"alpha %d\n", w, alpha);
+				failures++;
+			}
+		}
+	}
+	return failures;
+}
+
+static int
+checkBlendColors (void)
+{
+	static Color from[NUM_PAIRS / 4];
+	static Color to[NUM_PAIRS / 4];
+	static Color result[NUM_PAIRS / 4];
+	static Color want[NUM_PAIRS / 4];
+	const COUNT numColors = NUM_PAIRS / 4;
+	int failures = 0;
+	DWORD seed = 1;
+	int step;
+	int i;
+
+	for (i = 0; i < NUM_PAIRS; i++)
+	{
+		((BYTE *) from)[i] = (BYTE) (i >> 8);
+		((BYTE *) to)[i] = (BYTE) i;
+	}
+
+	// The weights that a transformation of a given number of ticks
+	// gives, as in XFormColorMap_step(), and some others.
+	for (step = 0; step < 600; step++)
+	{
+		DWORD frac;
+		COUNT count;
+
+		if (step < 100)
+			frac = (DWORD) step * BLEND_FRAC_ONE / 100;
+		else if (step < 110)
+			frac = BLEND_FRAC_ONE - 1 - (step - 100);
+		else
+		{
+			seed = seed * 1103515245 + 12345;
+			frac = (seed >> 8) % BLEND_FRAC_ONE;
+		}
+
+		// A count that is not a multiple of the SIMD width, now and
+		// then.
+		count = step % 7 == 0 ? numColors - step % 5 : numColors;
+
+		memset (result, 0xee, sizeof result);
+		memcpy (want, result, sizeof want);
+		for (i = 0; i < count * 4; i++)
+			((BYTE *) want)[i] = refColorChan (((BYTE *) from)[i],
+					((BYTE *) to)[i], (int) frac, BLEND_FRAC_ONE);
+
+		TFB_BlendColors (result, from, to, count, frac);
+		if (memcmp (result, want, sizeof want) != 0)
+		{
+			printf ("TFB_BlendColors: wrong result with weight %lu\n",
+					(unsigned long) frac);
+			failures++;
+		}
+	}
+
+	// In place, as 'dst' may be 'from'.
+	memcpy (result, from, sizeof result);
+	for (i = 0; i < NUM_PAIRS; i++)
+		((BYTE *) want)[i] = refColorChan (((BYTE *) from)[i],
+				((BYTE *) to)[i], 0x4000, BLEND_FRAC_ONE);
+	TFB_BlendColors (result, result, to, numColors, 0x4000);
+	if (memcmp (result, want, sizeof want) != 0)
+	{
+		printf ("TFB_BlendColors: wrong result in place\n");
+		failures++;
+	}
+	return failures;
+}
+
+static double
+nsSince (const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start->tv_sec) * 1e9
+			+ (double) (now.tv_nsec - start->tv_nsec);
+}
+
+static void
+timeFrames (int numReps)
+{
+	int scale;
+
+	for (scale = 1; scale <= 3; scale++)
+	{
+		const int w = 320 * scale;
+		const int h = 240 * scale;
+		const int pitch = w * 4;
+		BYTE *screen = malloc ((size_t) pitch * h);
+		BYTE *other = malloc ((size_t) pitch * h);
+		struct timespec start;
+		double crossfadeMs;
+		double fadeMs;
+		int rep;
+		int i;
+
+		for (i = 0; i < pitch * h; i++)
+		{
+			screen[i] = (BYTE) (i * 7);
+			other[i] = (BYTE) (i * 13 + 5);
+		}
+
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (rep = 0; rep < numReps; rep++)
+			TFB_BlendPixels (screen, pitch, other, pitch, w, h,
+					(BYTE) (rep * 37));
+		crossfadeMs = nsSince (&start) / 1e6 / numReps;
+
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (rep = 0; rep < numReps; rep++)
+			TFB_BlendFill (screen, pitch, w, h, 0x00102030U,
+					(BYTE) (rep * 37));
+		fadeMs = nsSince (&start) / 1e6 / numReps;
+
+		printf ("%dx%d: crossfade %.3f ms, fade to a colour %.3f ms "
+				"per frame\n", w, h, crossfadeMs, fadeMs);
+		free (screen);
+		free (other);
+	}
+}
+
+static void
+timePalette (int numReps)
+{
+	enum { NUM_COLORS = 256 };
+	static Color from[NUM_COLORS];
+	static Color to[NUM_COLORS];
+	static Color result[NUM_COLORS];
+	struct timespec start;
+	double kernelNs;
+	double oldNs;
+	int rep;
+	int i;
+
+	for (i = 0; i < NUM_COLORS; i++)
+	{
+		from[i].r = (BYTE) i;
+		from[i].g = (BYTE) (i * 3);
+		from[i].b = (BYTE) (255 - i);
+		to[i].r = (BYTE) (i * 5);
+		to[i].g = (BYTE) (i * 7);
+		to[i].b = (BYTE) i;
+	}
+
+	numReps *= 100;
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (rep = 0; rep < numReps; rep++)
+		TFB_BlendColors (result, from, to, NUM_COLORS,
+				(DWORD) rep % BLEND_FRAC_ONE);
+	kernelNs = nsSince (&start) / numReps;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (rep = 0; rep < numReps; rep++)
+	{
+		int frac = rep % BLEND_FRAC_ONE;
+
+		for (i = 0; i < NUM_COLORS; i++)
+		{
+			result[i].a = 0xff;
+			result[i].r = refColorChan (from[i].r, to[i].r, frac,
+					BLEND_FRAC_ONE);
+			result[i].g = refColorChan (from[i].g, to[i].g, frac,
+					BLEND_FRAC_ONE);
+			result[i].b = refColorChan (from[i].b, to[i].b, frac,
+					BLEND_FRAC_ONE);
+		}
+		// Keep the loop from being folded into one pass.
+		__asm__ volatile ("" : : "r" (result) : "memory");
+	}
+	oldNs = nsSince (&start) / numReps;
+
+	printf ("palette of %d colours: %.2f us, %.2f us per channel as "
+			"before\n", NUM_COLORS, kernelNs / 1000, oldNs / 1000);
+}
+
+int
+main (int argc, char *argv[])
+{
+	int numReps = argc > 1 ? atoi (argv[1]) : 200;
+	int failures = 0;
+
+	if (numReps < 1)
+		numReps = 1;
+
+	printf ("kernel: %s\n", kernelName ());
+	failures += checkBlendPixels ();
+	failures += checkBlendFill ();
+	failures += checkBlendColors ();
+
+	timeFrames (numReps);
+	timePalette (numReps);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,542 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Checks the indexed blitter that TFB_DrawCanvas_BlitIndexed() uses
+// (libs/graphics/indexblit.c) against a plain loop over the pixels.
+// TFB_BlitIndexed() and TFB_BlitIndexedKeyed() are checked on rows of
+// every width up to 67 pixels, at every byte offset of the source and
+// pixel offset of the destination from an aligned address, with
+// transparent pixels alone, in runs, and scattered, for colorkeys at
+// both ends of the range and in between. Transparent pixels and the
+// pixels around the rectangle must not change.
+//
+// Then it checks that the table of pixels that GetNativePalettePixels()
+// (libs/graphics/sdl/palette.c) keeps for a palette follows the colours
+// set with SetNativePaletteColor() and SetNativePaletteColors(), and the
+// destination format, through a colormap animation, and that it is not
+// remapped while neither changes. palette.c is included here, with
+// stand-ins for the few SDL types and functions it uses, and for
+// HCalloc() and HFree().
+//
+// Last, it prints the time per blit at a few image sizes, with and
+// without a colorkey, for the blitter and for the plain loop. The plain
+// loop does what SDL's 8 to 32 bits per pixel blitters do: one lookup
+// and, with a colorkey, one test per pixel.
+//
+// Usage: indexblittest [repetitions]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "port.h"
+#include "libs/graphics/indexblit.h"
+
+// Stand-ins for what palette.c needs from SDL.
+
+#undef SDL_INCLUDE
+#define SDL_INCLUDE(file) <stddef.h>
+
+#define SDL_MAJOR_VERSION 2
+
+typedef BYTE Uint8;
+typedef uint32 Uint32;
+
+typedef struct
+{
+	Uint8 r, g, b, a;
+} SDL_Color;
+
+typedef struct
+{
+	int Rshift, Gshift, Bshift, Ashift;
+} SDL_PixelFormat;
+
+static long numMapped;
+		// Calls of SDL_MapRGBA(), to tell when the table is remapped.
+
+static Uint32
+SDL_MapRGBA (const SDL_PixelFormat *fmt, Uint8 r, Uint8 g, Uint8 b,
+		Uint8 a)
+{
+	numMapped++;
+	return ((Uint32) r << fmt->Rshift) | ((Uint32) g << fmt->Gshift)
+			| ((Uint32) b << fmt->Bshift) | ((Uint32) a << fmt->Ashift);
+}
+
+// And for the memory functions, which it uses to allocate a palette.
+
+void *
+HCalloc (size_t size)
+{
+	return calloc (1, size);
+}
+
+void
+HFree (void *p)
+{
+	free (p);
+}
+
+#include "libs/graphics/sdl/palette.c"
+
+#define MAX_WIDTH 67
+#define HEIGHT 3
+#define SRC_PITCH 80
+#define DST_PITCH (80 * 4)
+#define GUARD 8
+		// Pixels before and after the rectangle that must not change.
+#define DST_PIXELS (GUARD + HEIGHT * DST_PITCH / 4 + GUARD)
+
+static BYTE srcBytes[4 + HEIGHT * SRC_PITCH];
+static uint32 dstPixels[DST_PIXELS];
+static uint32 expected[DST_PIXELS];
+static uint32 lut[256];
+
+static DWORD seed = 1;
+
+static DWORD
+nextRandom (void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+// What indexblit.h describes, one pixel at a time.
+static void __attribute__ ((noinline))
+refBlit (void *dst, int dstPitch, const BYTE *src, int srcPitch,
+		int w, int h, const uint32 *table, int key)
+{
+	BYTE *d = (BYTE *) dst;
+	int x;
+
+	for (; h > 0; --h, d += dstPitch, src += srcPitch)
+	{
+		uint32 *row = (uint32 *) d;
+
+		for (x = 0; x < w; x++)
+		{
+			if (src[x] != key)
+				row[x] = table[src[x]];
+		}
+	}
+}
+
+enum
+{
+	PATTERN_OPAQUE,
+	PATTERN_TRANSPARENT,
+	PATTERN_RUNS,
+	PATTERN_SCATTERED,
+	PATTERN_NEAR_KEY,
+	NUM_PATTERNS
+};
+
+static const char *patternNames[NUM_PATTERNS] =
+{
+	"opaque",
+	"transparent",
+	"runs",
+	"scattered",
+	"near the key",
+};
+
+// An index that is not 'key'.
+static BYTE
+opaqueIndex (BYTE key)
+{
+	BYTE index = (BYTE) nextRandom ();
+	return index == key ? (BYTE) (key + 1) : index;
+}
+
+// Fills the whole source with a pattern of transparent pixels.
+static void
+fillSource (int pattern, BYTE key)
+{
+	int runLeft = 0;
+	BOOLEAN inKey = FALSE;
+	size_t i;
+
+	for (i = 0; i < sizeof srcBytes; i++)
+	{
+		BYTE index = opaqueIndex (key);
+
+		switch (pattern)
+		{
+			case PATTERN_OPAQUE:
+				break;
+			case PATTERN_TRANSPARENT:
+				index = key;
+				break;
+			case PATTERN_RUNS:
+				// Runs of 1 to 12 pixels, so that they start and end
+				// anywhere in a group of four.
+				if (runLeft == 0)
+				{
+					inKey = !inKey;
+					runLeft = 1 + nextRandom () % 12;
+				}
+				runLeft--;
+				if (inKey)
+					index = key;
+				break;
+			case PATTERN_SCATTERED:
+				if (nextRandom () % 3 == 0)
+					index = key;
+				break;
+			case PATTERN_NEAR_KEY:
+				// Indices that differ from the key in one bit, or are one
+				// off, with the key now and then.
+				switch (nextRandom () % 5)
+				{
+					case 0:
+						index = key;
+						break;
+					case 1:
+						index = (BYTE) (key + 1);
+						break;
+					case 2:
+						index = (BYTE) (key - 1);
+						break;
+					default:
+						index = (BYTE) (key ^ (1 << nextRandom () % 8));
+						break;
+				}
+				break;
+		}
+		srcBytes[i] = index;
+	}
+}
+
+static void
+fillDest (void)
+{
+	int i;
+
+	for (i = 0; i < DST_PIXELS; i++)
+		dstPixels[i] = 0xd0000000U | (uint32) i;
+	memcpy (expected, dstPixels, sizeof expected);
+}
+
+static int
+checkBlit (void)
+{
+	static const int keys[] = { 0x00, 0x01, 0x7f, 0x80, 0xfe, 0xff, 0x5a };
+	int failures = 0;
+	int k;
+	int i;
+
+	for (i = 0; i < 256; i++)
+		lut[i] = 0x01000193U * (uint32) (i + 1);
+
+	for (k = -1; k < (int) (sizeof keys / sizeof keys[0]); k++)
+	{
+		// k == -1 is TFB_BlitIndexed(), without a colorkey.
+		BYTE key = k < 0 ? 0 : (BYTE) keys[k];
+		int pattern;
+
+		for (pattern = 0; pattern < NUM_PATTERNS; pattern++)
+		{
+			int w;
+
+			if (k < 0 && pattern != PATTERN_OPAQUE
+					&& pattern != PATTERN_SCATTERED)
+				continue;
+
+			for (w = 0; w <= MAX_WIDTH; w++)
+			{
+				int srcOffset;
+				int dstOffset;
+
+				for (srcOffset = 0; srcOffset < 4; srcOffset++)
+				{
+					for (dstOffset = 0; dstOffset < 4; dstOffset++)
+					{
+						const BYTE *src = srcBytes + srcOffset;
+						uint32 *dst = dstPixels + GUARD + dstOffset;
+
+						fillSource (pattern, key);
+						fillDest ();
+						refBlit (expected + GUARD + dstOffset, DST_PITCH,
+								src, SRC_PITCH, w, HEIGHT, lut,
+								k < 0 ? -1 : key);
+						if (k < 0)
+							TFB_BlitIndexed (dst, DST_PITCH, src,
+									SRC_PITCH, w, HEIGHT, lut);
+						else
+							TFB_BlitIndexedKeyed (dst, DST_PITCH, src,
+									SRC_PITCH, w, HEIGHT, lut, key);
+
+						if (memcmp (dstPixels, expected, sizeof expected)
+								!= 0)
+						{
+							if (k < 0)
+								printf ("TFB_BlitIndexed: ");
+							else
+								printf ("TFB_BlitIndexedKeyed, key %d: ",
+										key);
+							printf ("wrong result for %s, %d pixels, "
+									"source offset %d, destination "
+									"offset %d\n", patternNames[pattern],
+									w, srcOffset, dstOffset);
+							failures++;
+						}
+					}
+				}
+			}
+		}
+	}
+	return failures;
+}
+
+static const SDL_PixelFormat formatARGB = { 16, 8, 0, 24 };
+static const SDL_PixelFormat formatABGR = { 0, 8, 16, 24 };
+
+static Color
+randomColor (void)
+{
+	DWORD r = nextRandom ();
+	return BUILD_COLOR_RGBA ((BYTE) r, (BYTE) (r >> 8), (BYTE) (r >> 16),
+			0xff);
+}
+
+// Checks 'table' against the colours of 'palette' in format 'fmt'.
+static BOOLEAN
+tableMatches (NativePalette *palette, const uint32 *table,
+		const SDL_PixelFormat *fmt)
+{
+	int i;
+
+	for (i = 0; i < NUMBER_OF_PLUTVALS; i++)
+	{
+		Color c = GetNativePaletteColor (palette, i);
+		uint32 want = ((uint32) c.r << fmt->Rshift)
+				| ((uint32) c.g << fmt->Gshift)
+				| ((uint32) c.b << fmt->Bshift)
+				| ((uint32) 0xff << fmt->Ashift);
+		if (table[i] != want)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+// Gets the table of 'palette' for 'fmt' and checks it. 'remap' tells
+// whether it should have been mapped again.
+static int
+checkTable (NativePalette *palette, const SDL_PixelFormat *fmt,
+		BOOLEAN remap, const char *what)
+{
+	long mappedBefore = numMapped;
+	const uint32 *table = GetNativePalettePixels (palette, fmt);
+	long mapped = numMapped - mappedBefore;
+	int failures = 0;
+
+	if (!tableMatches (palette, table, fmt))
+	{
+		printf ("GetNativePalettePixels: wrong table %s\n", what);
+		failures++;
+	}
+	if (mapped != (remap ? NUMBER_OF_PLUTVALS : 0))
+	{
+		printf ("GetNativePalettePixels: %ld colours mapped %s, "
+				"expected %d\n", mapped, what,
+				remap ? NUMBER_OF_PLUTVALS : 0);
+		failures++;
+	}
+	return failures;
+}
+
+static int
+checkPalette (void)
+{
+	NativePalette *palette = AllocNativePalette ();
+	Color colors[NUMBER_OF_PLUTVALS];
+	int failures = 0;
+	int step;
+	int i;
+
+	for (i = 0; i < NUMBER_OF_PLUTVALS; i++)
+		colors[i] = randomColor ();
+	SetNativePaletteColors (palette, 0, NUMBER_OF_PLUTVALS, colors);
+
+	failures += checkTable (palette, &formatARGB, TRUE, "at first");
+	failures += checkTable (palette, &formatARGB, FALSE, "unchanged");
+
+	SetNativePaletteColor (palette, 17, BUILD_COLOR_RGBA (1, 2, 3, 0xff));
+	failures += checkTable (palette, &formatARGB, TRUE,
+			"after SetNativePaletteColor()");
+	failures += checkTable (palette, &formatARGB, FALSE,
+			"unchanged after SetNativePaletteColor()");
+
+	failures += checkTable (palette, &formatABGR, TRUE,
+			"for another format");
+	failures += checkTable (palette, &formatARGB, TRUE,
+			"for the first format again");
+
+	// A colormap animation: each step changes some colours, as
+	// XFormColorMap_step() and the palette cycling of the comm screens
+	// do, and then the image is drawn. The image must show the colours
+	// of that step.
+	fillSource (PATTERN_SCATTERED, 0);
+	for (step = 0; step < 200; step++)
+	{
+		const uint32 *table;
+		int first = nextRandom () % NUMBER_OF_PLUTVALS;
+		int count = 1 + nextRandom () % (NUMBER_OF_PLUTVALS - first);
+		uint32 want[NUMBER_OF_PLUTVALS];
+
+		if (step % 2 == 0)
+		{
+			for (i = 0; i < count; i++)
+				colors[i] = randomColor ();
+			SetNativePaletteColors (palette, first, count, colors);
+		}
+		else
+		{
+			for (i = first; i < first + count; i++)
+				SetNativePaletteColor (palette, i, randomColor ());
+		}
+
+		for (i = 0; i < NUMBER_OF_PLUTVALS; i++)
+		{
+			Color c = GetNativePaletteColor (palette, i);
+			want[i] = ((uint32) 0xff << 24) | ((uint32) c.r << 16)
+					| ((uint32) c.g << 8) | c.b;
+		}
+
+		table = GetNativePalettePixels (palette, &formatARGB);
+		fillDest ();
+		refBlit (expected + GUARD, DST_PITCH, srcBytes, SRC_PITCH,
+				MAX_WIDTH, HEIGHT, want, 0);
+		TFB_BlitIndexedKeyed (dstPixels + GUARD, DST_PITCH, srcBytes,
+				SRC_PITCH, MAX_WIDTH, HEIGHT, table, 0);
+		if (memcmp (dstPixels, expected, sizeof expected) != 0)
+		{
+			printf ("colormap animation: old colours drawn at step %d "
+					"(colours %d to %d changed)\n", step, first,
+					first + count - 1);
+			failures++;
+		}
+	}
+
+	FreeNativePalette (palette);
+	return failures;
+}
+
+static double
+nsSince (const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start->tv_sec) * 1e9
+			+ (double) (now.tv_nsec - start->tv_nsec);
+}
+
+static void
+timeBlits (int numReps)
+{
+	static const struct
+	{
+		int w, h;
+		const char *what;
+	} sizes[] =
+	{
+		{ 16, 16, "small sprite" },
+		{ 40, 40, "ship" },
+		{ 100, 80, "comm animation frame" },
+		{ 320, 240, "screen" },
+	};
+	const BYTE key = 0;
+	int s;
+	int i;
+
+	for (s = 0; s < (int) (sizeof sizes / sizeof sizes[0]); s++)
+	{
+		const int w = sizes[s].w;
+		const int h = sizes[s].h;
+		const int reps = numReps * (320 * 240) / (w * h);
+		BYTE *src = malloc ((size_t) w * h);
+		uint32 *dst = calloc ((size_t) w * h, sizeof *dst);
+		int keyed;
+
+		// An image with transparent pixels around a shape, as most
+		// sprites are, and some inside it.
+		for (i = 0; i < w * h; i++)
+		{
+			int x = i % w - w / 2;
+			int y = i / w - h / 2;
+			BOOLEAN inside = x * x * h * h + y * y * w * w
+					< w * w * h * h / 4;
+			src[i] = inside && nextRandom () % 16 != 0
+					? opaqueIndex (key) : key;
+		}
+
+		for (keyed = 0; keyed < 2; keyed++)
+		{
+			struct timespec start;
+			double beforeNs;
+			double afterNs;
+			int rep;
+
+			clock_gettime (CLOCK_MONOTONIC, &start);
+			for (rep = 0; rep < reps; rep++)
+			{
+				refBlit (dst, w * 4, src, w, w, h, lut, keyed ? key : -1);
+				__asm__ volatile ("" : : "r" (dst) : "memory");
+			}
+			beforeNs = nsSince (&start) / reps;
+
+			clock_gettime (CLOCK_MONOTONIC, &start);
+			for (rep = 0; rep < reps; rep++)
+			{
+				if (keyed)
+					TFB_BlitIndexedKeyed (dst, w * 4, src, w, w, h, lut,
+							key);
+				else
+					TFB_BlitIndexed (dst, w * 4, src, w, w, h, lut);
+				__asm__ volatile ("" : : "r" (dst) : "memory");
+			}
+			afterNs = nsSince (&start) / reps;
+
+			printf ("%dx%d %s, %s: %.2f us per blit, %.2f us with the "
+					"plain loop\n", w, h, sizes[s].what,
+					keyed ? "colorkey" : "no colorkey", afterNs / 1000,
+					beforeNs / 1000);
+		}
+		free (src);
+		free (dst);
+	}
+}
+
+int
+main (int argc, char *argv[])
+{
+	int numReps = argc > 1 ? atoi (argv[1]) : 200;
+	int failures = 0;
+
+	if (numReps < 1)
+		numReps = 1;
+
+	failures += checkBlit ();
+	failures += checkPalette ();
+
+	timeBlits (numReps);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
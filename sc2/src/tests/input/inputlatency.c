@@ -0,0 +1,365 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Tests SetSemaphoreUntil() of the pthread backend
+// (libs/threads/pthread/posixthreads.c), and the input event queue of
+// libs/input/input_common.c on top of it:
+// - a wait without a wakeup must last until its deadline, and not much
+//   longer;
+// - a wait must end soon after the semaphore is cleared;
+// - a wait with a deadline that has passed must not block;
+// - presses posted from another thread, some released right away, must
+//   all be seen, and are timed from being posted until being read, once
+//   by a loop that sleeps 1/30 s between reads, and once by one that
+//   waits with WaitInputEventUntil().
+//
+// Usage: inputlatency
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
+#include "libs/inplib.h"
+#include "libs/log.h"
+#include "libs/input/input_common.h"
+#include "libs/threads/pthread/posixthreads.h"
+
+#define NUM_WAITS 20
+#define NUM_PRESSES 200
+
+static volatile int producerDone;
+static Semaphore testSem;
+
+// What the rest of the game would provide.
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+}
+
+void
+log_add_nothread (log_Level level, const char *fmt, ...)
+{
+	(void) level;
+	(void) fmt;
+}
+
+void
+log_threadCleanup (void)
+{
+}
+
+void
+mem_threadCleanup (void)
+{
+}
+
+void *
+HMalloc (size_t size)
+{
+	return malloc (size);
+}
+
+void
+HFree (void *p)
+{
+	free (p);
+}
+
+ThreadLocal *
+CreateThreadLocal (void)
+{
+	return calloc (1, sizeof (ThreadLocal));
+}
+
+void
+DestroyThreadLocal (ThreadLocal *tl)
+{
+	free (tl);
+}
+
+void
+FinishThread (Thread thread)
+{
+	(void) thread;
+}
+
+uint64
+GetPerfCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return 1000000000;
+}
+
+TimeCount
+GetTimeCounter (void)
+{
+	return (TimeCount) (GetPerfCounter () * ONE_SECOND / 1000000000);
+}
+
+// The threadlib functions that input_common.c uses, as thrcommon.c
+// forwards them.
+
+Semaphore
+CreateSemaphore_Core (DWORD initial, const char *name, DWORD syncClass)
+{
+	return CreateSemaphore_PT (initial, name, syncClass);
+}
+
+void
+DestroySemaphore (Semaphore sem)
+{
+	DestroySemaphore_PT (sem);
+}
+
+void
+SetSemaphore (Semaphore sem)
+{
+	SetSemaphore_PT (sem);
+}
+
+BOOLEAN
+SetSemaphoreUntil (Semaphore sem, TimeCount wakeTime)
+{
+	return SetSemaphoreUntil_PT (sem, wakeTime);
+}
+
+void
+ClearSemaphore (Semaphore sem)
+{
+	ClearSemaphore_PT (sem);
+}
+
+static double
+msSince (uint64 start)
+{
+	return (double) (GetPerfCounter () - start) / 1e6;
+}
+
+static void *
+clearLater (void *arg)
+{
+	uint64 *clearTime = arg;
+
+	usleep (10000);
+	*clearTime = GetPerfCounter ();
+	ClearSemaphore (testSem);
+	return NULL;
+}
+
+static int
+testSemaphore (void)
+{
+	int failures = 0;
+	double total = 0.0;
+	double worst = 0.0;
+	int i;
+
+	testSem = CreateSemaphore (0, "test", 0);
+
+	// A deadline 50 ms ahead; measured from the start of the tick in
+	// which it falls, as that is what a TimeCount deadline means.
+	for (i = 0; i < NUM_WAITS; i++)
+	{
+		TimeCount now = GetTimeCounter ();
+		TimeCount wakeTime = now + ONE_SECOND / 20;
+		uint64 tickStart;
+		double late;
+
+		while (GetTimeCounter () == now)
+			;
+		tickStart = GetPerfCounter ();
+		wakeTime = GetTimeCounter () + ONE_SECOND / 20;
+		if (SetSemaphoreUntil (testSem, wakeTime))
+		{
+			printf ("a wait without a wakeup returned TRUE\n");
+			failures++;
+		}
+		if ((sint32) (GetTimeCounter () - wakeTime) < 0)
+		{
+			printf ("a wait ended before its deadline\n");
+			failures++;
+		}
+		late = msSince (tickStart) - 50.0;
+		total += late;
+		if (late > worst)
+			worst = late;
+	}
+	printf ("timeouts of 50 ms: %.2f ms late on average, %.2f ms at most\n",
+			total / NUM_WAITS, worst);
+	if (worst > 20.0)
+	{
+		printf ("a timeout was far too late\n");
+		failures++;
+	}
+
+	total = 0.0;
+	worst = 0.0;
+	for (i = 0; i < NUM_WAITS; i++)
+	{
+		pthread_t thread;
+		uint64 clearTime = 0;
+		double latency;
+
+		pthread_create (&thread, NULL, clearLater, &clearTime);
+		if (!SetSemaphoreUntil (testSem, GetTimeCounter () + ONE_SECOND))
+		{
+			printf ("a wait with a wakeup returned FALSE\n");
+			failures++;
+		}
+		latency = (double) (GetPerfCounter () - clearTime) / 1e6;
+		pthread_join (thread, NULL);
+		total += latency;
+		if (latency > worst)
+			worst = latency;
+	}
+	printf ("wakeups: %.3f ms from ClearSemaphore() on average, "
+			"%.3f ms at most\n", total / NUM_WAITS, worst);
+
+	{
+		uint64 start = GetPerfCounter ();
+
+		if (SetSemaphoreUntil (testSem, GetTimeCounter () - 1))
+		{
+			printf ("a wait with a past deadline returned TRUE\n");
+			failures++;
+		}
+		ClearSemaphore (testSem);
+		if (!SetSemaphoreUntil (testSem, GetTimeCounter () - 1))
+		{
+			printf ("a wait with a past deadline missed a wakeup\n");
+			failures++;
+		}
+		if (msSince (start) > 5.0)
+		{
+			printf ("a wait with a past deadline blocked\n");
+			failures++;
+		}
+	}
+
+	DestroySemaphore (testSem);
+	return failures;
+}
+
+static void *
+pressButtons (void *arg)
+{
+	int i;
+
+	(void) arg;
+	for (i = 0; i < NUM_PRESSES; i++)
+	{
+		usleep (3000 + rand () % 20000);
+		PostInputEvent (INPUT_EVENT_MENU, 0, 1, 1);
+		if (i % 2)
+		{
+			// A tap: released right away
+			PostInputEvent (INPUT_EVENT_MENU, 0, 1, 0);
+		}
+		else
+		{
+			usleep (1000);
+			PostInputEvent (INPUT_EVENT_MENU, 0, 1, 0);
+		}
+	}
+	producerDone = 1;
+	return NULL;
+}
+
+static int
+testInput (BOOLEAN wake)
+{
+	pthread_t producer;
+	InputEvent event;
+	int numPresses = 0;
+	BOOLEAN held = FALSE;
+	double total = 0.0;
+	double worst = 0.0;
+
+	producerDone = 0;
+	InitInputEvents ();
+	pthread_create (&producer, NULL, pressButtons, NULL);
+	for (;;)
+	{
+		TimeCount next = GetTimeCounter () + ONE_SECOND / 30;
+		BOOLEAN done = producerDone;
+
+		while (GetInputEvent (&event))
+		{
+			if (event.type != INPUT_EVENT_MENU)
+				continue;
+			if (event.value && !held)
+			{
+				double latency = msSince (event.perfTime);
+				numPresses++;
+				total += latency;
+				if (latency > worst)
+					worst = latency;
+			}
+			held = event.value != 0;
+		}
+		if (done)
+			break;
+
+		if (wake)
+			WaitInputEventUntil (next);
+		else
+			usleep ((useconds_t) ((sint32) (next - GetTimeCounter ()))
+					* (1000000 / ONE_SECOND));
+	}
+	pthread_join (producer, NULL);
+	UninitInputEvents ();
+
+	printf ("%s: %d of %d presses seen, read %.2f ms after being posted "
+			"on average, %.2f ms at most\n",
+			wake ? "waking on input" : "polling at 30 Hz", numPresses,
+			NUM_PRESSES, total / numPresses, worst);
+	return numPresses == NUM_PRESSES ? 0 : 1;
+}
+
+int
+main (void)
+{
+	int failures = 0;
+
+	failures += testSemaphore ();
+	failures += testInput (FALSE);
+	failures += testInput (TRUE);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,499 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Tests the logger of libs/log/uqmlog.c, with the thread library replaced
+// by pthreads:
+// - "check" logs a set of formats through the log thread and compares
+//   the output with that of vsnprintf();
+// - otherwise, the given number of threads each log the given number of
+//   messages as fast as they can, to the given file, and the number of
+//   messages per second is reported. With a fourth argument N, they log
+//   in bursts of N messages every 5 ms instead, and the time per call is
+//   reported;
+// - "exit" has the given number of threads log the given number of
+//   messages each while log_exit() is called, as happens when the game
+//   quits, and checks that none of them is lost.
+//
+// Usage: logbench check <output file>
+//        logbench <threads> <messages per thread> <output file> [burst]
+//        logbench exit <threads> <messages per thread> <output file>
+// See tests/README for how to build it.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "libs/log/uqmlog.h"
+#include "libs/log/msgbox.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
+
+#define MAX_THREADS 16
+
+static char expected[1 << 16];
+static size_t expectedLen;
+static long numMessages;
+static int burst;
+static double callTime[MAX_THREADS];
+static const char *fileNames[] = { "foo.ogg", "bar.mod" };
+static volatile int numStarted;
+
+// The thread library, on pthreads.
+
+Mutex
+CreateMutex_Core (const char *name, DWORD syncClass)
+{
+	pthread_mutex_t *mutex = malloc (sizeof *mutex);
+
+	(void) name;
+	(void) syncClass;
+	pthread_mutex_init (mutex, NULL);
+	return mutex;
+}
+
+void
+DestroyMutex (Mutex mutex)
+{
+	pthread_mutex_destroy (mutex);
+	free (mutex);
+}
+
+void
+LockMutex (Mutex mutex)
+{
+	pthread_mutex_lock (mutex);
+}
+
+void
+UnlockMutex (Mutex mutex)
+{
+	pthread_mutex_unlock (mutex);
+}
+
+Semaphore
+CreateSemaphore_Core (DWORD initial, const char *name, DWORD syncClass)
+{
+	sem_t *sem = malloc (sizeof *sem);
+
+	(void) name;
+	(void) syncClass;
+	sem_init (sem, 0, initial);
+	return sem;
+}
+
+void
+DestroySemaphore (Semaphore sem)
+{
+	sem_destroy (sem);
+	free (sem);
+}
+
+void
+SetSemaphore (Semaphore sem)
+{
+	while (sem_wait (sem) == -1 && errno == EINTR)
+		;
+}
+
+void
+ClearSemaphore (Semaphore sem)
+{
+	sem_post (sem);
+}
+
+TimeCount
+GetTimeCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (TimeCount) ((uint64) ts.tv_sec * ONE_SECOND
+			+ (uint64) ts.tv_nsec * ONE_SECOND / 1000000000);
+}
+
+BOOLEAN
+SetSemaphoreUntil (Semaphore sem, TimeCount wakeTime)
+{
+	struct timespec ts;
+	long waitNs;
+
+	waitNs = (long) ((sint32) (wakeTime - GetTimeCounter ()))
+			* (1000000000 / ONE_SECOND);
+	if (waitNs < 0)
+		waitNs = 0;
+	clock_gettime (CLOCK_REALTIME, &ts);
+	ts.tv_sec += waitNs / 1000000000;
+	ts.tv_nsec += waitNs % 1000000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	while (sem_timedwait (sem, &ts) == -1)
+	{
+		if (errno != EINTR)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+typedef struct
+{
+	ThreadFunction func;
+	void *data;
+} StartInfo;
+
+static void *
+threadStart (void *arg)
+{
+	StartInfo info = *(StartInfo *) arg;
+
+	free (arg);
+	(*info.func) (info.data);
+	return NULL;
+}
+
+void
+StartThread_Core (ThreadFunction func, void *data, SDWORD stackSize,
+		const char *name)
+{
+	StartInfo *info = malloc (sizeof *info);
+	pthread_t thread;
+
+	(void) stackSize;
+	(void) name;
+	info->func = func;
+	info->data = data;
+	pthread_create (&thread, NULL, threadStart, info);
+	pthread_detach (thread);
+}
+
+void
+HibernateThread (TimePeriod timePeriod)
+{
+	usleep ((useconds_t) ((uint64) timePeriod * 1000000 / ONE_SECOND));
+}
+
+void
+log_displayBox (const char *title, int isError, const char *msg)
+{
+	(void) title;
+	(void) isError;
+	(void) msg;
+}
+
+static double
+now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Logs the message, and adds what vsnprintf() makes of it to 'expected'.
+static void
+logBoth (const char *fmt, ...)
+{
+	va_list args;
+	char buf[256];
+
+	va_start (args, fmt);
+	log_addV (log_Info, fmt, args);
+	va_end (args);
+
+	va_start (args, fmt);
+	vsnprintf (buf, sizeof buf - 1, fmt, args);
+	va_end (args);
+	buf[sizeof buf - 1] = '\0';
+	expectedLen += sprintf (expected + expectedLen, "%s\n", buf);
+}
+
+static int
+checkFormats (const char *outName)
+{
+	static char got[1 << 16];
+	char big[600];
+	char unterminated[8];
+	FILE *out;
+	size_t gotLen;
+
+	memset (big, 'x', sizeof big - 1);
+	big[sizeof big - 1] = '\0';
+	// Only the part within the precision may be read.
+	memcpy (unterminated, "abcdefgh", sizeof unterminated);
+
+	out = fopen (outName, "w");
+	if (out == NULL)
+	{
+		perror (outName);
+		return EXIT_FAILURE;
+	}
+	log_setOutput (out);
+
+	logBoth ("plain");
+	logBoth ("%d %5.2f %-10s|%*d|%.*s|%lu|%zu|%%|%c|%x|%lld|%+08.3e",
+			-42, 3.14159, "abc", 6, 7, 3, "abcdef", 123456789UL,
+			(size_t) 77, 'Q', 0xbeef, -5LL, 12345.678);
+	logBoth ("%*d|%-*d|%.*f", -6, 1, 4, 2, -1, 2.5);
+	logBoth ("%s", (char *) NULL);
+	logBoth ("long %s", big);
+	logBoth ("%s %s %s", big, "tail", "x");
+	logBoth ("%Lf fallback", (long double) 1.5);
+	logBoth ("%hhd %hd %ld %jd %td", 300, 70000, -1L, (intmax_t) 9,
+			(ptrdiff_t) -3);
+	logBoth ("%p", (void *) 0x1234);
+	logBoth ("%#o %#x %5c|", 8, 255, 'z');
+	logBoth ("%.3s|%.*s|%-6.2s|%*.*s|", unterminated, 5, unterminated,
+			unterminated, 4, 1, unterminated);
+	logBoth ("%.*s|", -1, "negative precision");
+	logBoth ("end%%");
+
+	log_flush ();
+	log_setOutput (stderr);
+	fclose (out);
+
+	out = fopen (outName, "r");
+	gotLen = fread (got, 1, sizeof got - 1, out);
+	got[gotLen] = '\0';
+	fclose (out);
+	if (gotLen != expectedLen || memcmp (got, expected, gotLen) != 0)
+	{
+		printf ("The output differs.\n--- logged:\n%s--- expected:\n%s",
+				got, expected);
+		printf ("FAILED\n");
+		return EXIT_FAILURE;
+	}
+	printf ("%u bytes of output, as expected\n", (unsigned) gotLen);
+	printf ("OK\n");
+	return EXIT_SUCCESS;
+}
+
+// Checks that the file has every message of a flood, and the messages of
+// each thread in order.
+static bool
+checkFlood (const char *outName, int numThreads)
+{
+	long next[MAX_THREADS];
+	char line[256];
+	FILE *out;
+	long numLines = 0;
+	bool ok = true;
+	int i;
+
+	for (i = 0; i < numThreads; i++)
+		next[i] = 0;
+	out = fopen (outName, "r");
+	if (out == NULL)
+		return false;
+	while (fgets (line, sizeof line, out) != NULL)
+	{
+		int id;
+		unsigned long n;
+
+		if (sscanf (line, "process_stream(): source %d underrun at %lu",
+				&id, &n) != 2 || id < 0 || id >= numThreads
+				|| (long) n != next[id])
+		{
+			ok = false;
+			break;
+		}
+		next[id]++;
+		numLines++;
+	}
+	fclose (out);
+	if (numLines != numThreads * numMessages)
+		ok = false;
+	if (!ok)
+		printf ("Messages are missing or out of order, after %ld.\n",
+				numLines);
+	return ok;
+}
+
+static void *
+logThread (void *arg)
+{
+	int id = (int) (intptr_t) arg;
+	long i;
+
+	__atomic_fetch_add (&numStarted, 1, __ATOMIC_RELAXED);
+	if (burst == 0)
+	{
+		for (i = 0; i < numMessages; i++)
+		{
+			log_add (log_Debug, "process_stream(): source %d underrun "
+					"at %lu, file %s", id, (unsigned long) i,
+					fileNames[i & 1]);
+		}
+		return NULL;
+	}
+
+	for (i = 0; i < numMessages; i += burst)
+	{
+		double start = now ();
+		int j;
+
+		for (j = 0; j < burst; j++)
+		{
+			log_add (log_Debug, "process_stream(): source %d underrun "
+					"at %lu, file %s", id, (unsigned long) j,
+					fileNames[j & 1]);
+		}
+		callTime[id] += now () - start;
+		usleep (5000);
+	}
+	return NULL;
+}
+
+// Calls log_exit() while the threads log, and checks that every message
+// is written, whether it was queued before or after.
+static int
+checkExit (int numThreads, const char *outName)
+{
+	pthread_t threads[MAX_THREADS];
+	FILE *out;
+	int i;
+
+	out = fopen (outName, "w");
+	if (out == NULL)
+	{
+		perror (outName);
+		return EXIT_FAILURE;
+	}
+	log_setOutput (out);
+
+	for (i = 0; i < numThreads; i++)
+	{
+		pthread_create (&threads[i], NULL, logThread,
+				(void *) (intptr_t) i);
+	}
+	while (__atomic_load_n (&numStarted, __ATOMIC_RELAXED) < numThreads)
+		sched_yield ();
+	log_exit (0);
+	for (i = 0; i < numThreads; i++)
+		pthread_join (threads[i], NULL);
+
+	log_setOutput (stderr);
+	fclose (out);
+
+	if (!checkFlood (outName, numThreads))
+	{
+		printf ("FAILED\n");
+		return EXIT_FAILURE;
+	}
+	printf ("%d threads: all %ld messages written\n", numThreads,
+			numThreads * numMessages);
+	printf ("OK\n");
+	return EXIT_SUCCESS;
+}
+
+int
+main (int argc, char *argv[])
+{
+	pthread_t threads[MAX_THREADS];
+	int numThreads;
+	FILE *out;
+	double start;
+	double end;
+	double flushed;
+	int i;
+
+	log_init (15);
+	log_initThreads ();
+
+	if (argc == 3 && strcmp (argv[1], "check") == 0)
+		return checkFormats (argv[2]);
+	if (argc == 5 && strcmp (argv[1], "exit") == 0)
+	{
+		numThreads = atoi (argv[2]);
+		if (numThreads < 1 || numThreads > MAX_THREADS)
+			numThreads = 1;
+		numMessages = atol (argv[3]);
+		return checkExit (numThreads, argv[4]);
+	}
+	if (argc < 4 || argc > 5)
+	{
+		fprintf (stderr, "Usage: %s check <output file>\n"
+				"       %s <threads> <messages per thread> <output file> "
+				"[burst]\n"
+				"       %s exit <threads> <messages per thread> "
+				"<output file>\n", argv[0], argv[0], argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	numThreads = atoi (argv[1]);
+	if (numThreads < 1 || numThreads > MAX_THREADS)
+		numThreads = 1;
+	numMessages = atol (argv[2]);
+	if (argc == 5)
+		burst = atoi (argv[4]);
+	out = fopen (argv[3], "w");
+	if (out == NULL)
+	{
+		perror (argv[3]);
+		return EXIT_FAILURE;
+	}
+	log_setOutput (out);
+
+	start = now ();
+	for (i = 0; i < numThreads; i++)
+	{
+		pthread_create (&threads[i], NULL, logThread,
+				(void *) (intptr_t) i);
+	}
+	for (i = 0; i < numThreads; i++)
+		pthread_join (threads[i], NULL);
+	end = now ();
+	log_flush ();
+	flushed = now ();
+
+	if (burst == 0)
+	{
+		printf ("%d threads: %.2f M calls/s, all written after %.3f s\n",
+				numThreads, numThreads * numMessages / (end - start) / 1e6,
+				flushed - start);
+	}
+	else
+	{
+		double total = 0.0;
+
+		for (i = 0; i < numThreads; i++)
+			total += callTime[i];
+		printf ("%d threads, bursts of %d: %.0f ns per call\n",
+				numThreads, burst, total * 1e9 / (numThreads * numMessages));
+	}
+
+	log_setOutput (stderr);
+	fclose (out);
+	log_exit (0);
+
+	if (burst == 0 && !checkFlood (argv[3], numThreads))
+	{
+		printf ("FAILED\n");
+		return EXIT_FAILURE;
+	}
+	printf ("OK\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Tests the NetManager (libs/network/netmanager) over local socket pairs:
+// - the time from a write to the dispatch of its read callback, with
+//   many idle descriptors registered;
+// - that the timeout of NetManager_process() is kept;
+// - that a socket which was closed by a callback, and whose fd was then
+//   reused by a new socket, does not get the readiness of the old one
+//   dispatched to the new one;
+// - that a hangup of every peer closes every descriptor once.
+//
+// Usage: netbench [number of idle descriptors]
+// See tests/README for how to build it.
+
+#define SOCKET_INTERNAL
+#define NETDESCRIPTOR_INTERNAL
+#include "libs/network/netmanager/netmanager.h"
+#include "libs/network/socket/socket.h"
+#include "libs/callback/callback.h"
+#include "libs/log.h"
+#include "libs/timelib.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_ROUNDS 2000
+
+static int numReads;
+static int numClosed;
+static int numStaleReads;
+
+void
+log_add(log_Level level, const char *fmt, ...) {
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+
+// Only called for descriptors with a close callback; none have one here.
+CallbackID
+Callback_add(CallbackFunction callback, CallbackArg arg) {
+	(*callback)(arg);
+	return CallbackID_invalid;
+}
+
+uint64
+GetPerfCounter(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency(void) {
+	return 1000000000;
+}
+
+static Socket *
+wrapFd(int fd) {
+	Socket *sock = malloc(sizeof (Socket));
+
+	sock->fd = fd;
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	return sock;
+}
+
+static void
+readCallback(NetDescriptor *nd) {
+	char buf[64];
+	ssize_t numRead;
+
+	numRead = read(NetDescriptor_getSocket(nd)->fd, buf, sizeof buf);
+	if (numRead == 0) {
+		NetDescriptor_close(nd);
+		numClosed++;
+		return;
+	}
+	if (numRead == -1 && errno == EAGAIN) {
+		// Called without anything to read.
+		numStaleReads++;
+		return;
+	}
+	numReads++;
+}
+
+// Opens a socket pair, and registers the first socket of it. The fd of
+// the other is returned in 'peerFd'.
+static NetDescriptor *
+openPair(int *peerFd) {
+	int fds[2];
+	NetDescriptor *nd;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == -1) {
+		perror("socketpair");
+		exit(EXIT_FAILURE);
+	}
+	nd = NetDescriptor_new(wrapFd(fds[0]), NULL);
+	if (nd == NULL) {
+		perror("NetDescriptor_new");
+		exit(EXIT_FAILURE);
+	}
+	NetDescriptor_setReadCallback(nd, readCallback);
+	*peerFd = fds[1];
+	return nd;
+}
+
+// For the fd reuse test. Whichever of the two descriptors is dispatched
+// first closes the other, and opens a new socket in its place, with the
+// same fd. Nothing is written to the new socket.
+static NetDescriptor *reuseNDs[2];
+static int reusePeers[2];
+static NetDescriptor *reuseNew;
+static int reuseNewPeer;
+
+static void
+reuseCallback(NetDescriptor *nd) {
+	char buf[64];
+	int other;
+	int oldFd;
+	int newFd;
+
+	(void) read(NetDescriptor_getSocket(nd)->fd, buf, sizeof buf);
+	if (reuseNew != NULL)
+		return;
+
+	other = (nd == reuseNDs[0]) ? 1 : 0;
+	oldFd = NetDescriptor_getSocket(reuseNDs[other])->fd;
+	NetDescriptor_close(reuseNDs[other]);
+	reuseNDs[other] = NULL;
+	close(reusePeers[other]);
+
+	reuseNew = openPair(&reuseNewPeer);
+	newFd = NetDescriptor_getSocket(reuseNew)->fd;
+	if (newFd != oldFd) {
+		// Move the new socket to the old fd.
+		Socket *sock = NetDescriptor_getSocket(reuseNew);
+		NetDescriptor_detach(reuseNew);
+		NetDescriptor_decRef(reuseNew);
+		dup2(newFd, oldFd);
+		close(newFd);
+		sock->fd = oldFd;
+		reuseNew = NetDescriptor_new(sock, NULL);
+		NetDescriptor_setReadCallback(reuseNew, readCallback);
+	}
+}
+
+int
+main(int argc, char *argv[]) {
+	int numIdle = (argc > 1) ? atoi(argv[1]) : 2000;
+	struct rlimit limit;
+	NetDescriptor **nds;
+	int *peers;
+	int failures = 0;
+	uint64 total;
+	uint64 start;
+	uint32 timeoutMs;
+	int round;
+	int i;
+
+	limit.rlim_cur = limit.rlim_max = 2 * numIdle + 64;
+	if (setrlimit(RLIMIT_NOFILE, &limit) == -1)
+		perror("setrlimit");
+
+	NetManager_init();
+	nds = malloc(numIdle * sizeof (NetDescriptor *));
+	peers = malloc(numIdle * sizeof (int));
+	for (i = 0; i < numIdle; i++)
+		nds[i] = openPair(&peers[i]);
+
+	total = 0;
+	for (round = 0; round < NUM_ROUNDS; round++) {
+		int readsBefore = numReads;
+
+		start = GetPerfCounter();
+		(void) write(peers[(round * 7919) % numIdle], "x", 1);
+		while (numReads == readsBefore) {
+			timeoutMs = 1000;
+			NetManager_process(&timeoutMs);
+		}
+		total += GetPerfCounter() - start;
+	}
+	printf("%d idle descriptors: %.2f us from a write to its callback\n",
+			numIdle, (double) total / 1000.0 / NUM_ROUNDS);
+
+	timeoutMs = 50;
+	start = GetPerfCounter();
+	NetManager_process(&timeoutMs);
+	printf("a 50 ms timeout waited %.1f ms, %u ms left\n",
+			(double) (GetPerfCounter() - start) / 1e6, timeoutMs);
+	if (GetPerfCounter() - start < 50 * 1000000 || timeoutMs != 0)
+		failures++;
+
+	reuseNDs[0] = openPair(&reusePeers[0]);
+	reuseNDs[1] = openPair(&reusePeers[1]);
+	NetDescriptor_setReadCallback(reuseNDs[0], reuseCallback);
+	NetDescriptor_setReadCallback(reuseNDs[1], reuseCallback);
+	(void) write(reusePeers[0], "x", 1);
+	(void) write(reusePeers[1], "x", 1);
+	timeoutMs = 1000;
+	NetManager_process(&timeoutMs);
+	timeoutMs = 0;
+	NetManager_process(&timeoutMs);
+	if (reuseNew == NULL) {
+		printf("the fd reuse test did not run\n");
+		failures++;
+	}
+	if (numStaleReads != 0) {
+		printf("a reused fd got the readiness of its old socket\n");
+		failures++;
+	}
+
+	for (i = 0; i < numIdle; i++)
+		close(peers[i]);
+	while (numClosed < numIdle) {
+		timeoutMs = 1000;
+		NetManager_process(&timeoutMs);
+	}
+	timeoutMs = 0;
+	NetManager_process(&timeoutMs);
+	printf("%d descriptors closed on hangup\n", numClosed);
+	if (numClosed != numIdle)
+		failures++;
+
+	for (i = 0; i < 2; i++) {
+		if (reuseNDs[i] != NULL) {
+			NetDescriptor_close(reuseNDs[i]);
+			close(reusePeers[i]);
+		}
+	}
+	NetDescriptor_close(reuseNew);
+	close(reuseNewPeer);
+	NetManager_uninit();
+	free(nds);
+	free(peers);
+
+	printf("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,540 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Tests the broadcasting of matches to spectators
+// (uqm/supermelee/netplay/spectator.c) and the receiving of them
+// (spectate.c), with everything in one process, over loopback.
+// The host plays two matches, of three battles each. Of the 50
+// spectators, 20 connect before the first match, 20 halfway through it,
+// and 10 halfway through the second, and catch up from the snapshot.
+// One more connection never reads, and must be dropped.
+//
+// In place of the battle code, both sides run the same toy simulation
+// over what the host broadcasts and what the spectators turn it into:
+// the events of a replay. Its state is the checksum of each frame. The
+// test checks that the checksums of every spectator match those of the
+// host for every frame they both have, that each spectator ends each
+// match in the same state as the host, and that the snapshot had the
+// frames played before it connected.
+//
+// Usage: spectatortest [port]
+// See tests/README for how to build it.
+
+#define SOCKET_INTERNAL
+#define NETDESCRIPTOR_INTERNAL
+#include "uqm/supermelee/netplay/spectate.h"
+#include "uqm/supermelee/netplay/spectator.h"
+#include "uqm/supermelee/replay.h"
+#include "libs/network/netmanager/netmanager.h"
+#include "libs/network/network.h"
+#include "libs/callback/callback.h"
+#include "libs/alarm.h"
+#include "libs/log.h"
+#include "libs/timelib.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define NUM_MATCHES 2
+#define NUM_BATTLES 3
+#define BATTLE_FRAMES 2000
+#define NUM_SPECTATORS 50
+#define NUM_SIDES 2
+
+// How many spectators connect before each match, and halfway each match.
+static const int joinBefore[NUM_MATCHES] = { 20, 0 };
+static const int joinHalfway[NUM_MATCHES] = { 20, 10 };
+
+typedef struct {
+	SpectateStream *stream;
+	int firstMatch;
+			// The first match it sees.
+	uint32 expectedCatchUp;
+			// The frames of that match played before it connected.
+	bool playing;
+	uint32 state;
+	uint32 frameNr;
+	uint32 runLeft;
+	uint8 runInput[NUM_SIDES];
+	uint32 catchUpFrames;
+	int matchesDone;
+	bool failed;
+} Spectator;
+
+static Spectator spectators[NUM_SPECTATORS];
+static int numSpectators;
+
+static uint32 hostFinalState[NUM_MATCHES];
+static uint32 hostFrames[NUM_MATCHES];
+static int matchNr;
+
+static int numErrors;
+
+
+void
+log_add(log_Level level, const char *fmt, ...) {
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fputc('\n', stderr);
+	if (level <= log_Error)
+		numErrors++;
+}
+
+uint64
+GetPerfCounter(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency(void) {
+	return 1000000000;
+}
+
+void
+explode(void) {
+	abort();
+}
+
+// Connections to localhost do not time out here.
+static char dummyAlarm;
+
+Alarm *
+Alarm_addRelativeMs(uint32 ms, AlarmCallback callback,
+		AlarmCallbackArg arg) {
+	(void) ms;
+	(void) callback;
+	(void) arg;
+	return (Alarm *) &dummyAlarm;
+}
+
+void
+Alarm_remove(Alarm *alarm) {
+	(void) alarm;
+}
+
+// Callbacks are queued until Callback_process(), as by
+// libs/callback/callback.c, but without the locking.
+#define MAX_CALLBACKS 1024
+
+typedef struct {
+	CallbackFunction func;
+	CallbackArg arg;
+} QueuedCallback;
+
+static QueuedCallback callbacks[MAX_CALLBACKS];
+static size_t numCallbacks;
+
+CallbackID
+Callback_add(CallbackFunction func, CallbackArg arg) {
+	if (numCallbacks == MAX_CALLBACKS) {
+		fprintf(stderr, "Too many callbacks.\n");
+		exit(EXIT_FAILURE);
+	}
+	callbacks[numCallbacks].func = func;
+	callbacks[numCallbacks].arg = arg;
+	numCallbacks++;
+	return (CallbackID) &callbacks[numCallbacks - 1];
+}
+
+bool
+Callback_remove(CallbackID id) {
+	((QueuedCallback *) id)->func = NULL;
+	return true;
+}
+
+void
+Callback_process(void) {
+	size_t num = numCallbacks;
+	size_t i;
+
+	for (i = 0; i < num; i++) {
+		if (callbacks[i].func != NULL)
+			(*callbacks[i].func)(callbacks[i].arg);
+	}
+	memmove(callbacks, callbacks + num,
+			(numCallbacks - num) * sizeof callbacks[0]);
+	numCallbacks -= num;
+}
+
+// The toy simulation. Every step mixes something into the state.
+static uint32
+mix(uint32 state, uint32 value) {
+	state ^= value + 0x9e3779b9 + (state << 6) + (state >> 2);
+	return state * 2654435761u;
+}
+
+static uint32 randomState;
+
+static uint32
+nextRandom(void) {
+	randomState = randomState * 1103515245 + 12345;
+	return randomState >> 8;
+}
+
+static void
+pump(void) {
+	uint32 timeout = 0;
+
+	NetManager_process(&timeout);
+	Callback_process();
+}
+
+// Play what a spectator has received, as the replay code would.
+static void
+runSpectator(Spectator *spec) {
+	SpectateStream *stream = spec->stream;
+	const uint8 *data;
+	size_t size;
+	size_t pos;
+
+	if (spec->failed)
+		return;
+
+	if (!spec->playing) {
+		if (!SpectateStream_matchReady(stream))
+			return;
+		data = SpectateStream_takeData(stream, &size);
+		if (size < REPLAY_MAGIC_SIZE + 8 + NUM_SIDES *
+				(1 + MELEE_FLEET_SIZE) ||
+				memcmp(data, REPLAY_MAGIC, REPLAY_MAGIC_SIZE) != 0) {
+			printf("spectator %d: bad replay header\n",
+					(int) (spec - spectators));
+			spec->failed = true;
+			return;
+		}
+		pos = REPLAY_MAGIC_SIZE + 4;
+		spec->state = mix(0, (uint32) data[pos] | (data[pos + 1] << 8) |
+				(data[pos + 2] << 16) | ((uint32) data[pos + 3] << 24));
+		pos += 4 + NUM_SIDES;
+		for (size_t i = 0; i < NUM_SIDES * MELEE_FLEET_SIZE; i++)
+			spec->state = mix(spec->state, data[pos++]);
+		for (int side = 0; side < NUM_SIDES; side++) {
+			size_t len = data[pos++];
+			for (size_t i = 0; i < len; i++)
+				spec->state = mix(spec->state, data[pos++]);
+		}
+		spec->playing = true;
+		spec->frameNr = 0;
+		spec->runLeft = 0;
+		spec->catchUpFrames = SpectateStream_getCatchUpFrames(stream);
+		if (spec->matchesDone == 0 &&
+				spec->catchUpFrames != spec->expectedCatchUp) {
+			printf("spectator %d: the snapshot has %lu frames instead "
+					"of %lu\n", (int) (spec - spectators),
+					(unsigned long) spec->catchUpFrames,
+					(unsigned long) spec->expectedCatchUp);
+			spec->failed = true;
+		}
+		data += pos;
+		size -= pos;
+	} else
+		data = SpectateStream_takeData(stream, &size);
+
+	pos = 0;
+	while (pos < size) {
+		switch (data[pos]) {
+			case 'i':
+				memcpy(spec->runInput, data + pos + 1, NUM_SIDES);
+				spec->runLeft = data[pos + 1 + NUM_SIDES] |
+						(data[pos + 2 + NUM_SIDES] << 8);
+				pos += 1 + NUM_SIDES + 2;
+				while (spec->runLeft > 0) {
+					SpectateStream_localChecksum(stream, spec->frameNr,
+							spec->state);
+					spec->state = mix(spec->state, spec->runInput[0] |
+							(spec->runInput[1] << 8));
+					spec->frameNr++;
+					spec->runLeft--;
+				}
+				break;
+			case 's':
+				spec->state = mix(spec->state, 0x10000 | data[pos + 1] |
+						(data[pos + 2] << 8) | (data[pos + 3] << 16));
+				pos += 4;
+				break;
+			case 'b':
+				spec->state = mix(spec->state, 0x20000);
+				pos++;
+				break;
+			case 'e': {
+				int match = spec->firstMatch + spec->matchesDone;
+
+				pos++;
+				if (match >= NUM_MATCHES ||
+						spec->state != hostFinalState[match] ||
+						spec->frameNr != hostFrames[match]) {
+					printf("spectator %d: match %d ended differently\n",
+							(int) (spec - spectators), match);
+					spec->failed = true;
+				}
+				spec->matchesDone++;
+				spec->playing = false;
+				SpectateStream_nextMatch(stream);
+				runSpectator(spec);
+				return;
+			}
+			default:
+				printf("spectator %d: bad event %d\n",
+						(int) (spec - spectators), data[pos]);
+				spec->failed = true;
+				return;
+		}
+	}
+}
+
+static void
+runSpectators(void) {
+	int i;
+
+	pump();
+	for (i = 0; i < numSpectators; i++)
+		runSpectator(&spectators[i]);
+}
+
+// 'frameNr' is the number of frames of the current match played so far.
+static void
+addSpectators(const char *port, int num, uint32 frameNr) {
+	size_t wanted = Spectator_getNumClients() + num;
+	int tries;
+
+	while (num-- > 0) {
+		Spectator *spec = &spectators[numSpectators];
+
+		spec->stream = SpectateStream_open("127.0.0.1", port);
+		if (spec->stream == NULL) {
+			printf("could not open a spectator stream\n");
+			exit(EXIT_FAILURE);
+		}
+		spec->firstMatch = matchNr;
+		spec->expectedCatchUp = frameNr;
+		numSpectators++;
+	}
+
+	for (tries = 0; tries < 10000 && Spectator_getNumClients() < wanted;
+			tries++) {
+		runSpectators();
+		usleep(100);
+	}
+	if (Spectator_getNumClients() < wanted) {
+		printf("not all spectators got connected\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+// Connects a socket which never reads anything. A small receive buffer
+// and segment size keep the buffers of the kernel at both ends small, so
+// that the send buffer of the spectator fills up soon.
+static int
+addStalledSpectator(int port) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	int bufSize = 1;
+	int segSize = 536;
+	size_t numBefore = Spectator_getNumClients();
+	int tries;
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof bufSize);
+	setsockopt(fd, IPPROTO_TCP, TCP_MAXSEG, &segSize, sizeof segSize);
+	memset(&addr, 0, sizeof addr);
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons((uint16) port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (connect(fd, (struct sockaddr *) &addr, sizeof addr) == -1) {
+		perror("connect");
+		exit(EXIT_FAILURE);
+	}
+	for (tries = 0; tries < 10000 &&
+			Spectator_getNumClients() == numBefore; tries++) {
+		pump();
+		usleep(100);
+	}
+	return fd;
+}
+
+static void
+playMatch(const char *port) {
+	uint32 seed = 1000 + matchNr;
+	uint32 state;
+	uint32 frameNr = 0;
+	uint8 input[NUM_SIDES] = { 0, 0 };
+	int battle;
+
+	static const char *names[NUM_SIDES] = { "Bottom team", "Top team" };
+
+	addSpectators(port, joinBefore[matchNr], 0);
+
+	// The state follows the order of the replay header: the seed, the
+	// fleets of both sides, then the team names.
+	Spectator_matchStart(seed);
+	state = mix(0, seed);
+	for (int side = 0; side < NUM_SIDES; side++) {
+		uint8 ships[MELEE_FLEET_SIZE];
+
+		for (int i = 0; i < MELEE_FLEET_SIZE; i++) {
+			ships[i] = (uint8) (nextRandom() % 26);
+			state = mix(state, ships[i]);
+		}
+		Spectator_fleet((uint8) side, ships, MELEE_FLEET_SIZE);
+	}
+	for (int side = 0; side < NUM_SIDES; side++) {
+		Spectator_teamName((uint8) side, names[side]);
+		for (const char *c = names[side]; *c != '\0'; c++)
+			state = mix(state, (uint8) *c);
+	}
+	Spectator_flush();
+
+	for (battle = 0; battle < NUM_BATTLES; battle++) {
+		for (int side = 0; side < NUM_SIDES; side++) {
+			uint16 choice;
+
+			if (battle > 0 && side != battle % NUM_SIDES)
+				continue;
+			choice = nextRandom() % 3 == 0 ? SPECTATOR_RANDOM_SHIP :
+					(uint16) (nextRandom() % MELEE_FLEET_SIZE);
+			Spectator_selectShip((uint8) side, choice);
+			state = mix(state, 0x10000 | side | (choice << 8));
+		}
+		Spectator_flush();
+
+		for (int i = 0; i < BATTLE_FRAMES; i++) {
+			Spectator_checksum(frameNr, state);
+			if (nextRandom() % 16 == 0)
+				input[nextRandom() % NUM_SIDES] = nextRandom() % 32;
+			Spectator_frame(frameNr, input, NUM_SIDES);
+			Spectator_flush();
+			state = mix(state, input[0] | (input[1] << 8));
+			frameNr++;
+
+			if (battle == NUM_BATTLES / 2 && i == BATTLE_FRAMES / 2)
+				addSpectators(port, joinHalfway[matchNr], frameNr);
+			runSpectators();
+		}
+
+		Spectator_battleEnd();
+		state = mix(state, 0x20000);
+	}
+
+	hostFinalState[matchNr] = state;
+	hostFrames[matchNr] = frameNr;
+	Spectator_matchEnd();
+	matchNr++;
+}
+
+int
+main(int argc, char *argv[]) {
+	const char *port = argc > 1 ? argv[1] : "29876";
+	int stalledFd;
+	bool stalledDropped;
+	uint32 minVerified = 0xffffffff;
+	int numOk = 0;
+	int tries;
+	int i;
+
+	Network_init();
+	NetManager_init();
+	if (!Spectator_open(port)) {
+		printf("could not listen on port %s\n", port);
+		return EXIT_FAILURE;
+	}
+	pump();
+
+	stalledFd = addStalledSpectator(atoi(port));
+
+	for (i = 0; i < NUM_MATCHES; i++)
+		playMatch(port);
+
+	// Let the spectators finish.
+	for (tries = 0; tries < 1000; tries++) {
+		bool allDone = true;
+
+		runSpectators();
+		for (i = 0; i < numSpectators; i++) {
+			if (!spectators[i].failed && spectators[i].matchesDone <
+					NUM_MATCHES - spectators[i].firstMatch)
+				allDone = false;
+		}
+		if (allDone)
+			break;
+		usleep(1000);
+	}
+
+	for (i = 0; i < numSpectators; i++) {
+		Spectator *spec = &spectators[i];
+		int expected = NUM_MATCHES - spec->firstMatch;
+
+		uint32 numVerified = SpectateStream_getNumVerified(spec->stream);
+		uint32 liveFrames = hostFrames[spec->firstMatch] -
+				spec->expectedCatchUp;
+		int matchI;
+
+		// Every frame played after it connected has been checked.
+		for (matchI = spec->firstMatch + 1; matchI < NUM_MATCHES; matchI++)
+			liveFrames += hostFrames[matchI];
+		if (numVerified < minVerified)
+			minVerified = numVerified;
+
+		if (spec->failed || spec->matchesDone != expected ||
+				numVerified < liveFrames ||
+				!SpectateStream_inSync(spec->stream) ||
+				!SpectateStream_isOpen(spec->stream)) {
+			printf("spectator %d: %d of %d matches, %lu of %lu frames "
+					"checked, %s\n", i, spec->matchesDone, expected,
+					(unsigned long) numVerified, (unsigned long) liveFrames,
+					SpectateStream_inSync(spec->stream) ?
+					"in sync" : "out of sync");
+			continue;
+		}
+		numOk++;
+	}
+
+	stalledDropped = Spectator_getNumClients() == (size_t) numSpectators;
+	printf("%d of %d spectators saw every match in sync; at least %lu "
+			"frames checked by each\n", numOk, numSpectators,
+			(unsigned long) minVerified);
+	printf("the stalled connection %s\n",
+			stalledDropped ? "was dropped" : "was not dropped");
+
+	for (i = 0; i < numSpectators; i++)
+		SpectateStream_close(spectators[i].stream);
+	close(stalledFd);
+	Spectator_close();
+	NetManager_uninit();
+	Network_uninit();
+
+	if (numOk == numSpectators && numErrors == 0 && stalledDropped) {
+		printf("OK\n");
+		return EXIT_SUCCESS;
+	}
+	printf("FAILED\n");
+	return EXIT_FAILURE;
+}
+
@@ -0,0 +1,249 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Times the performance counters of libs/perf in a tight loop, on one
+// thread and on several threads at once, and checks that no counts are
+// lost. It also checks that uio_getThreadIOStats() only counts the I/O
+// of the calling thread, as loadResourceDesc() relies on.
+//
+// Usage: perfbench <empty scratch dir>
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "libs/perflib.h"
+#include "libs/uio.h"
+#include "libs/log.h"
+
+#define NUM_CALLS 20000000
+#define NUM_THREADS 4
+#define BIG_FILE_SIZE (1024 * 1024)
+#define SMALL_FILE_SIZE 1000
+#define FRAME_NS (1000000000.0 / 60)
+
+static uio_Repository *repository;
+static uio_DirHandle *scratchDir;
+static volatile int stopReading;
+static volatile int numBigReads;
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+}
+
+uint64
+GetPerfCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return 1000000000;
+}
+
+static void *
+incThread (void *arg)
+{
+	int i;
+
+	(void) arg;
+	for (i = 0; i < NUM_CALLS; i++)
+		perf_inc (PERF_COLLISION_PAIRS);
+	return NULL;
+}
+
+static void *
+timeThread (void *arg)
+{
+	int i;
+
+	(void) arg;
+	for (i = 0; i < NUM_CALLS / 10; i++)
+		perf_addTimeSince (PERF_MIXER_TIME, GetPerfCounter ());
+	return NULL;
+}
+
+// Nanoseconds per call of 'func', run on 'numThreads' threads at once.
+// This is the time of all calls together, divided by their number; with
+// fewer processors than threads, it is the cost of one call plus that of
+// switching threads.
+static double
+timeCalls (void *(*func) (void *), int numThreads, int callsPerThread)
+{
+	pthread_t threads[NUM_THREADS];
+	uint64 start;
+	int i;
+
+	start = GetPerfCounter ();
+	for (i = 0; i < numThreads; i++)
+		pthread_create (&threads[i], NULL, func, NULL);
+	for (i = 0; i < numThreads; i++)
+		pthread_join (threads[i], NULL);
+	return (double) (GetPerfCounter () - start)
+			/ ((double) callsPerThread * numThreads);
+}
+
+static BOOLEAN
+writeFile (const char *name, size_t size)
+{
+	uio_Stream *stream;
+	char *buf;
+	BOOLEAN ok;
+
+	stream = uio_fopen (scratchDir, name, "wb");
+	if (stream == NULL)
+		return FALSE;
+	buf = calloc (1, size);
+	ok = uio_fwrite (buf, 1, size, stream) == size;
+	free (buf);
+	uio_fclose (stream);
+	return ok;
+}
+
+static size_t
+readFile (const char *name)
+{
+	static char buf[BIG_FILE_SIZE];
+	uio_Stream *stream;
+	size_t numRead;
+
+	stream = uio_fopen (scratchDir, name, "rb");
+	if (stream == NULL)
+		return 0;
+	numRead = uio_fread (buf, 1, sizeof buf, stream);
+	uio_fclose (stream);
+	return numRead;
+}
+
+static void *
+readerThread (void *arg)
+{
+	(void) arg;
+	while (!stopReading)
+	{
+		readFile ("big");
+		numBigReads++;
+	}
+	return NULL;
+}
+
+int
+main (int argc, char *argv[])
+{
+	perf_Snapshot snapshot;
+	int failures = 0;
+	double ns;
+
+	if (argc != 2)
+	{
+		fprintf (stderr, "Usage: %s <empty scratch dir>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	ns = timeCalls (incThread, 1, NUM_CALLS);
+	printf ("perf_inc, 1 thread:            %6.2f ns per call\n", ns);
+	printf ("    1%% of a 60 fps frame is %.0f calls\n", FRAME_NS / 100 / ns);
+	ns = timeCalls (incThread, NUM_THREADS, NUM_CALLS);
+	printf ("perf_inc, %d threads:           %6.2f ns per call\n",
+			NUM_THREADS, ns);
+	ns = timeCalls (timeThread, 1, NUM_CALLS / 10);
+	printf ("perf_addTimeSince, 1 thread:   %6.2f ns per call\n", ns);
+	ns = timeCalls (timeThread, NUM_THREADS, NUM_CALLS / 10);
+	printf ("perf_addTimeSince, %d threads:  %6.2f ns per call\n",
+			NUM_THREADS, ns);
+
+	perf_takeSnapshot (&snapshot);
+	if (snapshot.values[PERF_COLLISION_PAIRS]
+			!= (uint64) NUM_CALLS * (1 + NUM_THREADS))
+	{
+		printf ("counted %llu collision pairs instead of %llu\n",
+				(unsigned long long) snapshot.values[PERF_COLLISION_PAIRS],
+				(unsigned long long) NUM_CALLS * (1 + NUM_THREADS));
+		failures++;
+	}
+
+	// Read a small file while another thread keeps reading a big one.
+	// Only the small file may be counted for this thread.
+	uio_init ();
+	repository = uio_openRepository (0);
+	uio_mountDir (repository, "/", uio_FSTYPE_STDIO, NULL, NULL, argv[1],
+			NULL, uio_MOUNT_TOP, NULL);
+	scratchDir = uio_openDir (repository, "/", 0);
+	if (scratchDir == NULL || !writeFile ("big", BIG_FILE_SIZE)
+			|| !writeFile ("small", SMALL_FILE_SIZE))
+	{
+		fprintf (stderr, "Could not write to the scratch dir.\n");
+		return EXIT_FAILURE;
+	}
+	{
+		pthread_t reader;
+		uio_IOStats threadBefore, threadAfter;
+		uio_IOStats allBefore, allAfter;
+		int i;
+
+		pthread_create (&reader, NULL, readerThread, NULL);
+		while (numBigReads == 0)
+			sched_yield ();
+		uio_getThreadIOStats (&threadBefore);
+		uio_getIOStats (&allBefore);
+		for (i = 0; i < 100; i++)
+		{
+			readFile ("small");
+			// Let the other thread read in between.
+			sched_yield ();
+		}
+		uio_getIOStats (&allAfter);
+		uio_getThreadIOStats (&threadAfter);
+		stopReading = 1;
+		pthread_join (reader, NULL);
+
+		printf ("bytes read by this thread: %llu, by all threads: %llu\n",
+				(unsigned long long) (threadAfter.bytesCopied
+				- threadBefore.bytesCopied),
+				(unsigned long long) (allAfter.bytesCopied
+				- allBefore.bytesCopied));
+		if (threadAfter.bytesCopied - threadBefore.bytesCopied
+				!= 100 * SMALL_FILE_SIZE)
+		{
+			printf ("the thread's I/O counter includes other threads\n");
+			failures++;
+		}
+	}
+	uio_closeDir (scratchDir);
+	uio_closeRepository (repository);
+	uio_unInit ();
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
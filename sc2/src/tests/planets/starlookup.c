@@ -0,0 +1,289 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Looks up the stars around random points of HyperSpace with FindStar()
+// (uqm/starmap.c), and checks that it finds the same stars, in the same
+// order, as going through all of star_array, for the areas that the game
+// searches. Checks that SeedUniverse() in uqm/hyper.c finds the same
+// stars to place in HyperSpace by searching the small area around the
+// flagship as it did by going through the radar area and skipping the
+// stars outside it. It prints the time per FindStar() pass over each
+// area, and the time of the lookups of SeedUniverse() in a frame, done
+// both ways.
+//
+// Usage: starlookup [number of points]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "uqm/starmap.h"
+#include "uqm/globdata.h"
+#include "uqm/hyper.h"
+#include "uqm/units.h"
+
+// As in uqm/hyper.c: half the size of the radar area.
+#define XOFFS ((RADAR_SCAN_WIDTH + (UNIT_SCREEN_WIDTH << 2)) >> 1)
+#define YOFFS ((RADAR_SCAN_HEIGHT + (UNIT_SCREEN_HEIGHT << 2)) >> 1)
+
+#define MAX_FOUND 64
+
+extern STAR_DESC starmap_array[];
+
+// What the rest of the game would provide.
+
+GLOBDATA GlobData;
+
+// Only ARILOU_SPACE_SIDE is asked for; 0 is HyperSpace.
+BYTE
+getGameState (BYTE *state, int startBit, int endBit)
+{
+	(void) state;
+	(void) startBit;
+	(void) endBit;
+	return 0;
+}
+
+typedef struct
+{
+	const char *name;
+	SIZE xbounds;
+	SIZE ybounds;
+} Area;
+
+// The areas that the game searches.
+static const Area areas[] = {
+	{ "radar", XOFFS, YOFFS },
+	{ "star map", 75, 75 },
+	{ "collision", 5, 5 },
+	{ "exact", 0, 0 },
+};
+
+#define NUM_AREAS (sizeof areas / sizeof areas[0])
+
+static DWORD randomState = 1;
+
+static COORD
+randomCoord (COORD max)
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (COORD) ((randomState >> 8) % (DWORD) (max + 1));
+}
+
+static POINT
+randomPoint (void)
+{
+	POINT pt;
+
+	pt.x = randomCoord (MAX_X_UNIVERSE);
+	pt.y = randomCoord (MAX_Y_UNIVERSE);
+	return pt;
+}
+
+static BOOLEAN
+inArea (const STAR_DESC *star, const POINT *pt, SIZE xbounds, SIZE ybounds)
+{
+	return star->star_pt.x >= pt->x - xbounds
+			&& star->star_pt.x <= pt->x + xbounds
+			&& star->star_pt.y >= pt->y - ybounds
+			&& star->star_pt.y <= pt->y + ybounds;
+}
+
+// Fills 'found' with the stars in the area, as FindStar() returns them.
+static COUNT
+findAll (POINT *pt, SIZE xbounds, SIZE ybounds, STAR_DESC **found)
+{
+	STAR_DESC *SDPtr = NULL;
+	COUNT count = 0;
+
+	while ((SDPtr = FindStar (SDPtr, pt, xbounds, ybounds)))
+	{
+		if (count < MAX_FOUND)
+			found[count] = SDPtr;
+		count++;
+	}
+	return count;
+}
+
+// The same by going through all of star_array.
+static COUNT
+findAllSlowly (const POINT *pt, SIZE xbounds, SIZE ybounds,
+		STAR_DESC **found)
+{
+	COUNT count = 0;
+	COUNT i;
+
+	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
+	{
+		if (!inArea (&star_array[i], pt, xbounds, ybounds))
+			continue;
+		if (count < MAX_FOUND)
+			found[count] = &star_array[i];
+		count++;
+	}
+	return count;
+}
+
+// The stars to place in HyperSpace, found as SeedUniverse() did before:
+// the stars of the radar area, skipping those too far away.
+static COUNT
+findNearbyFromRadar (POINT *pt, STAR_DESC **found)
+{
+	STAR_DESC *SDPtr = NULL;
+	COUNT count = 0;
+
+	while ((SDPtr = FindStar (SDPtr, pt, XOFFS, YOFFS)))
+	{
+		if (!inArea (SDPtr, pt, XOFFS / NUM_RADAR_SCREENS,
+				YOFFS / NUM_RADAR_SCREENS))
+			continue;
+		if (count < MAX_FOUND)
+			found[count] = SDPtr;
+		count++;
+	}
+	return count;
+}
+
+static BOOLEAN
+sameStars (STAR_DESC **found1, COUNT count1, STAR_DESC **found2,
+		COUNT count2)
+{
+	COUNT i;
+
+	if (count1 != count2)
+		return FALSE;
+	for (i = 0; i < count1 && i < MAX_FOUND; i++)
+	{
+		if (found1[i] != found2[i])
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static double
+nsSince (const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start->tv_sec) * 1e9
+			+ (double) (now.tv_nsec - start->tv_nsec);
+}
+
+int
+main (int argc, char *argv[])
+{
+	int numPoints = argc > 1 ? atoi (argv[1]) : 100000;
+	POINT *points;
+	STAR_DESC *found1[MAX_FOUND];
+	STAR_DESC *found2[MAX_FOUND];
+	int failures = 0;
+	unsigned long numFound = 0;
+	struct timespec start;
+	double oldNs;
+	double newNs;
+	size_t areaI;
+	int i;
+
+	if (numPoints < 1)
+		numPoints = 1;
+
+	star_array = starmap_array;
+	points = malloc (numPoints * sizeof *points);
+	if (points == NULL)
+		return EXIT_FAILURE;
+	for (i = 0; i < numPoints; i++)
+		points[i] = randomPoint ();
+
+	for (areaI = 0; areaI < NUM_AREAS; areaI++)
+	{
+		const Area *area = &areas[areaI];
+		int mismatches = 0;
+
+		for (i = 0; i < numPoints; i++)
+		{
+			COUNT count1 = findAll (&points[i], area->xbounds,
+					area->ybounds, found1);
+			COUNT count2 = findAllSlowly (&points[i], area->xbounds,
+					area->ybounds, found2);
+
+			if (!sameStars (found1, count1, found2, count2))
+				mismatches++;
+		}
+		if (mismatches > 0)
+		{
+			printf ("%s area: FindStar() differs at %d of %d points\n",
+					area->name, mismatches, numPoints);
+			failures++;
+		}
+
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (i = 0; i < numPoints; i++)
+			numFound += findAll (&points[i], area->xbounds, area->ybounds,
+					found1);
+		printf ("%s area (%d, %d): %.0f ns per pass\n", area->name,
+				area->xbounds, area->ybounds, nsSince (&start) / numPoints);
+	}
+
+	// SeedUniverse() goes through the radar area to draw the radar, and
+	// then looks up the stars to place in HyperSpace.
+	{
+		int mismatches = 0;
+
+		for (i = 0; i < numPoints; i++)
+		{
+			COUNT count1 = findAll (&points[i], XOFFS / NUM_RADAR_SCREENS,
+					YOFFS / NUM_RADAR_SCREENS, found1);
+			COUNT count2 = findNearbyFromRadar (&points[i], found2);
+
+			if (!sameStars (found1, count1, found2, count2))
+				mismatches++;
+		}
+		if (mismatches > 0)
+		{
+			printf ("SeedUniverse: different stars at %d of %d points\n",
+					mismatches, numPoints);
+			failures++;
+		}
+	}
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (i = 0; i < numPoints; i++)
+	{
+		numFound += findAll (&points[i], XOFFS, YOFFS, found1);
+		numFound += findNearbyFromRadar (&points[i], found2);
+	}
+	oldNs = nsSince (&start) / numPoints;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	for (i = 0; i < numPoints; i++)
+	{
+		numFound += findAll (&points[i], XOFFS, YOFFS, found1);
+		numFound += findAll (&points[i], XOFFS / NUM_RADAR_SCREENS,
+				YOFFS / NUM_RADAR_SCREENS, found2);
+	}
+	newNs = nsSince (&start) / numPoints;
+
+	printf ("SeedUniverse lookups per frame: %.0f ns through the radar "
+			"area, %.0f ns with the small area\n", oldNs, newNs);
+	// So that the timed loops are not optimized away.
+	printf ("(%lu stars found in all)\n", numFound);
+
+	free (points);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
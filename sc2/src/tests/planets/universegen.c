@@ -0,0 +1,369 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Generates every star system that uses the default generate functions,
+// as buildUniverseIndex() in uqm/uqmdebug.c does: each thread with its
+// own SOLARSYS_STATE and random context, and the systems divided over
+// the threads in turn. It hashes the planets, moons, planetary analysis,
+// and mineral and bio nodes of all of them, and checks that the hash is
+// the same with 1, 2 and 4 threads, and the same as that of the code
+// before the systems were generated from an explicit context. It prints
+// how long generating them all takes, with each number of threads.
+//
+// Usage: universegen [repetitions]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "uqm/planets/planets.h"
+#include "uqm/planets/generate/gendefault.h"
+#include "uqm/starmap.h"
+#include "libs/log.h"
+#include "libs/mathlib.h"
+#include "libs/memlib.h"
+
+// The hash that the generation code gave before the systems were
+// generated from an explicit context, with SysGenRNG, pSolarSysState and
+// CurStarDescPtr set for each system in turn.
+#define REFERENCE_HASH 0xe68d58cab5d6eeebULL
+
+#define MAX_THREADS 4
+
+extern STAR_DESC starmap_array[];
+extern const BYTE element_array[];
+extern const PlanetFrame planet_array[];
+
+// The generate functions that are used here, from
+// generateDefaultFunctions. The others need most of the game; the
+// program is linked with --gc-sections so that they are left out.
+static const GenerateFunctions generateFunctions = {
+	/* .initNpcs         = */ NULL,
+	/* .reinitNpcs       = */ NULL,
+	/* .uninitNpcs       = */ NULL,
+	/* .generatePlanets  = */ GenerateDefault_generatePlanets,
+	/* .generateMoons    = */ GenerateDefault_generateMoons,
+	/* .generateName     = */ NULL,
+	/* .generateOrbital  = */ GenerateDefault_generateOrbital,
+	/* .generateMinerals = */ GenerateDefault_generateMinerals,
+	/* .generateEnergy   = */ GenerateDefault_generateEnergy,
+	/* .generateLife     = */ GenerateDefault_generateLife,
+	/* .pickupMinerals   = */ NULL,
+	/* .pickupEnergy     = */ NULL,
+	/* .pickupLife       = */ NULL,
+};
+
+static uint64 systemHashes[NUM_SOLAR_SYSTEMS];
+static int numThreads;
+
+// What the rest of the game would provide.
+
+RandomContext *SysGenRNG;
+int ScreenWidth = 320;
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	(void) level;
+	(void) fmt;
+}
+
+void *
+HMalloc (size_t size)
+{
+	return malloc (size);
+}
+
+void *
+HCalloc (size_t size)
+{
+	return calloc (1, size);
+}
+
+void *
+HRealloc (void *p, size_t size)
+{
+	return realloc (p, size);
+}
+
+void
+HFree (void *p)
+{
+	free (p);
+}
+
+DWORD
+GetRandomSeedForStar (const STAR_DESC *star)
+{
+	return MAKE_DWORD (star->star_pt.x, star->star_pt.y);
+}
+
+// Only called by the functions that set up the graphics of a world.
+void
+LoadPlanet (FRAME SurfDefFrame)
+{
+	(void) SurfDefFrame;
+}
+
+static uint64
+hashBytes (uint64 hash, const void *data, size_t size)
+{
+	const BYTE *bytes = data;
+
+	while (size--)
+	{
+		hash ^= *bytes++;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+static uint64
+hashValue (uint64 hash, DWORD value)
+{
+	BYTE bytes[4];
+
+	bytes[0] = (BYTE) value;
+	bytes[1] = (BYTE) (value >> 8);
+	bytes[2] = (BYTE) (value >> 16);
+	bytes[3] = (BYTE) (value >> 24);
+	return hashBytes (hash, bytes, sizeof bytes);
+}
+
+static uint64
+hashWorldDesc (uint64 hash, const PLANET_DESC *world)
+{
+	hash = hashValue (hash, world->rand_seed);
+	hash = hashValue (hash, world->data_index);
+	hash = hashValue (hash, world->NumPlanets);
+	hash = hashValue (hash, (DWORD) world->radius);
+	hash = hashValue (hash, (DWORD) world->location.x);
+	return hashValue (hash, (DWORD) world->location.y);
+}
+
+static uint64
+hashNodes (uint64 hash, const SOLARSYS_STATE *system,
+		const PLANET_DESC *world, COUNT (*generate) (const SOLARSYS_STATE *,
+		const PLANET_DESC *, COUNT, NODE_INFO *))
+{
+	COUNT numNodes = generate (system, world, GENERATE_ALL, NULL);
+	COUNT i;
+
+	hash = hashValue (hash, numNodes);
+	for (i = 0; i < numNodes; i++)
+	{
+		NODE_INFO info;
+
+		memset (&info, 0, sizeof info);
+		generate (system, world, i, &info);
+		hash = hashValue (hash, (DWORD) info.loc_pt.x);
+		hash = hashValue (hash, (DWORD) info.loc_pt.y);
+		hash = hashValue (hash, info.density);
+		hash = hashValue (hash, info.type);
+	}
+	return hash;
+}
+
+static uint64
+hashWorld (uint64 hash, SOLARSYS_STATE *system, PLANET_DESC *world)
+{
+	const PLANET_INFO *info = &system->SysInfo.PlanetInfo;
+	int i;
+
+	system->pOrbitalDesc = world;
+	GenerateDefault_analyzeWorld (system, world);
+
+	hash = hashWorldDesc (hash, world);
+	hash = hashValue (hash, (DWORD) info->AxialTilt);
+	hash = hashValue (hash, info->Tectonics);
+	hash = hashValue (hash, info->Weather);
+	hash = hashValue (hash, info->PlanetDensity);
+	hash = hashValue (hash, info->PlanetRadius);
+	hash = hashValue (hash, info->SurfaceGravity);
+	hash = hashValue (hash, (DWORD) info->SurfaceTemperature);
+	hash = hashValue (hash, info->RotationPeriod);
+	hash = hashValue (hash, info->AtmoDensity);
+	hash = hashValue (hash, (DWORD) info->LifeChance);
+	hash = hashValue (hash, info->PlanetToSunDist);
+	for (i = 0; i < NUM_SCAN_TYPES; i++)
+		hash = hashValue (hash, info->ScanSeed[i]);
+
+	hash = hashNodes (hash, system, world,
+			system->genFuncs->generateMinerals);
+	return hashNodes (hash, system, world, system->genFuncs->generateLife);
+}
+
+// As indexSystem() in uqm/uqmdebug.c.
+static uint64
+hashSystem (STAR_DESC *star, SOLARSYS_STATE *system, RandomContext *rng)
+{
+	uint64 hash = 14695981039346656037ULL;
+	BYTE i;
+	BYTE j;
+
+	memset (system, 0, sizeof *system);
+	system->genFuncs = &generateFunctions;
+	system->star = star;
+	system->rng = rng;
+
+	RandomContext_SeedRandom (rng, GetRandomSeedForStar (star));
+	system->SunDesc[0].rand_seed = RandomContext_Random (rng);
+	system->SunDesc[0].data_index = STAR_TYPE (star->Type);
+	(*system->genFuncs->generatePlanets) (system);
+
+	for (i = 0; i < system->SunDesc[0].NumPlanets; i++)
+	{
+		PLANET_DESC *planet = &system->PlanetDesc[i];
+
+		planet->pPrevDesc = &system->SunDesc[0];
+		hash = hashWorld (hash, system, planet);
+
+		RandomContext_SeedRandom (rng, planet->rand_seed);
+		(*system->genFuncs->generateMoons) (system, planet);
+
+		for (j = 0; j < planet->NumPlanets; j++)
+		{
+			PLANET_DESC *moon = &system->MoonDesc[j];
+
+			moon->pPrevDesc = planet;
+			hash = hashWorld (hash, system, moon);
+		}
+	}
+	return hash;
+}
+
+// The systems without generate functions of their own.
+static BOOLEAN
+isDefaultSystem (const STAR_DESC *star)
+{
+	return star->Index == 0;
+}
+
+static void *
+generateSystems (void *arg)
+{
+	int first = *(const int *) arg;
+	SOLARSYS_STATE system;
+	RandomContext *rng;
+	int i;
+
+	rng = RandomContext_New ();
+	for (i = first; i < NUM_SOLAR_SYSTEMS; i += numThreads)
+	{
+		if (isDefaultSystem (&starmap_array[i]))
+		{
+			systemHashes[i] = hashSystem (&starmap_array[i], &system,
+					rng);
+		}
+	}
+	RandomContext_Delete (rng);
+	return NULL;
+}
+
+static uint64
+generateUniverse (void)
+{
+	pthread_t threads[MAX_THREADS];
+	int firsts[MAX_THREADS];
+	uint64 hash = 14695981039346656037ULL;
+	int i;
+
+	memset (systemHashes, 0, sizeof systemHashes);
+	for (i = 0; i < numThreads; i++)
+	{
+		firsts[i] = i;
+		pthread_create (&threads[i], NULL, generateSystems, &firsts[i]);
+	}
+	for (i = 0; i < numThreads; i++)
+		pthread_join (threads[i], NULL);
+
+	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
+	{
+		hash = hashValue (hash, (DWORD) systemHashes[i]);
+		hash = hashValue (hash, (DWORD) (systemHashes[i] >> 32));
+	}
+	return hash;
+}
+
+static double
+msSince (const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return (double) (now.tv_sec - start->tv_sec) * 1000.0
+			+ (double) (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int numReps = argc > 1 ? atoi (argv[1]) : 20;
+	int failures = 0;
+	int numDefault = 0;
+	int i;
+
+	if (numReps < 1)
+		numReps = 1;
+
+	Elements = element_array;
+	PlanData = planet_array;
+	SysGenRNG = RandomContext_New ();
+
+	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
+	{
+		if (isDefaultSystem (&starmap_array[i]))
+			numDefault++;
+	}
+	printf ("%d of %d systems use the default generate functions\n",
+			numDefault, NUM_SOLAR_SYSTEMS);
+
+	for (numThreads = 1; numThreads <= MAX_THREADS; numThreads *= 2)
+	{
+		struct timespec start;
+		uint64 hash = 0;
+		int rep;
+
+		clock_gettime (CLOCK_MONOTONIC, &start);
+		for (rep = 0; rep < numReps; rep++)
+		{
+			uint64 repHash = generateUniverse ();
+			if (rep > 0 && repHash != hash)
+			{
+				printf ("%d threads: the hash changed between runs\n",
+						numThreads);
+				failures++;
+			}
+			hash = repHash;
+		}
+		printf ("%d threads: hash %016llx, %.2f ms per universe\n",
+				numThreads, (unsigned long long) hash,
+				msSince (&start) / numReps);
+		if (hash != REFERENCE_HASH)
+		{
+			printf ("%d threads: expected hash %016llx\n", numThreads,
+					(unsigned long long) REFERENCE_HASH);
+			failures++;
+		}
+	}
+
+	RandomContext_Delete (SysGenRNG);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
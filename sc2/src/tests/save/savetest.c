@@ -0,0 +1,1384 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Sets up a game in HyperSpace, in a solar system, in orbit and at an
+// encounter, with random fleets, escorts, groups, events and scan data,
+// and saves it with AutoSaveGame() (uqm/save.c). Checks that GlobData,
+// the queues, the three state files and the rest of the running game are
+// byte for byte the same after AutoSaveGame() as before, although
+// SaveGame() brings the location and the state files up to date on the
+// way. Then it loads the game with LoadGame() (uqm/load.c) over another
+// one, and checks that everything that is saved comes back as it was
+// when the game was serialized. The state files that LoadGame() builds
+// anew may be laid out differently; their groups are compared instead.
+// Prints the time that AutoSaveGame() takes on the game thread, that of
+// SaveGame() alone, and the time until the saved game is on disk.
+//
+// The parts of the game around the save code are stand-ins: the location
+// of the flagship is updated the way SaveSisHyperState() and
+// SaveSolarSysLocation() do it, and the thread library runs on pthreads.
+//
+// Usage: savetest <save directory> [number of timed saves]
+// See tests/README for how to build it.
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "uqm/build.h"
+#include "uqm/clock.h"
+#include "uqm/controls.h"
+#include "uqm/encount.h"
+#include "uqm/gameev.h"
+#include "uqm/gamestr.h"
+#include "uqm/globdata.h"
+#include "uqm/grpinfo.h"
+#include "uqm/grpintrn.h"
+#include "uqm/hyper.h"
+#include "uqm/init.h"
+#include "uqm/races.h"
+#include "uqm/save.h"
+#include "uqm/setup.h"
+#include "uqm/shipcont.h"
+#include "uqm/starmap.h"
+#include "uqm/state.h"
+#include "uqm/util.h"
+#include "libs/file.h"
+#include "libs/log.h"
+#include "libs/threadlib.h"
+#include "libs/uio.h"
+
+#define NUM_RACES (KOHR_AH_ID - ARILOU_ID + 1 + 2)
+#define NUM_STARINFO_DWORDS (NUM_SOLAR_SYSTEMS + 300)
+#define NUM_RANDOM_GROUPS 6
+#define DUMP_SIZE 0x20000
+#define MAX_RUNS 1000
+
+extern STAR_DESC starmap_array[];
+
+// What the rest of the game would provide.
+
+uio_DirHandle *saveDir;
+QUEUE race_q[NUM_PLAYERS];
+SIZE EncounterRace;
+BYTE EncounterGroup;
+STRING GameStrings;
+
+static uio_Repository *repository;
+
+// Where the flagship is, for the stand-ins below.
+static BOOLEAN inSystem;
+static BOOLEAN inOrbit;
+static BOOLEAN inInnerSystem;
+static UWORD flagshipFacing;
+static POINT planetLocation;
+static BYTE planetNumber;
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+}
+
+uint64
+GetPerfCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + (uint64) ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return 1000000000;
+}
+
+Mutex
+CreateMutex_Core (const char *name, DWORD syncClass)
+{
+	pthread_mutex_t *mutex = malloc (sizeof *mutex);
+
+	(void) name;
+	(void) syncClass;
+	pthread_mutex_init (mutex, NULL);
+	return mutex;
+}
+
+void
+DestroyMutex (Mutex mutex)
+{
+	pthread_mutex_destroy (mutex);
+	free (mutex);
+}
+
+void
+LockMutex (Mutex mutex)
+{
+	pthread_mutex_lock (mutex);
+}
+
+void
+UnlockMutex (Mutex mutex)
+{
+	pthread_mutex_unlock (mutex);
+}
+
+Semaphore
+CreateSemaphore_Core (DWORD initial, const char *name, DWORD syncClass)
+{
+	sem_t *sem = malloc (sizeof *sem);
+
+	(void) name;
+	(void) syncClass;
+	sem_init (sem, 0, initial);
+	return sem;
+}
+
+void
+SetSemaphore (Semaphore sem)
+{
+	while (sem_wait (sem) == -1 && errno == EINTR)
+		;
+}
+
+void
+ClearSemaphore (Semaphore sem)
+{
+	sem_post (sem);
+}
+
+typedef struct
+{
+	ThreadFunction func;
+	void *data;
+} StartInfo;
+
+static void *
+threadStart (void *arg)
+{
+	StartInfo info = *(StartInfo *) arg;
+
+	free (arg);
+	(*info.func) (info.data);
+	return NULL;
+}
+
+Thread
+CreateThread_Core (ThreadFunction func, void *data, SDWORD stackSize,
+		const char *name)
+{
+	static int thread;
+	StartInfo *info = malloc (sizeof *info);
+	pthread_t pthread;
+
+	(void) stackSize;
+	(void) name;
+	info->func = func;
+	info->data = data;
+	if (pthread_create (&pthread, NULL, threadStart, info) != 0)
+	{
+		free (info);
+		return NULL;
+	}
+	pthread_detach (pthread);
+	return &thread;
+}
+
+void
+EventHandler (BYTE selector)
+{
+	(void) selector;
+}
+
+BOOLEAN
+LoadLegacyGame (COUNT which_game, SUMMARY_DESC *SummPtr)
+{
+	(void) which_game;
+	(void) SummPtr;
+	return FALSE;
+}
+
+STRINGPTR
+GetStringAddress (STRING string)
+{
+	(void) string;
+	return NULL;
+}
+
+STRING
+SetAbsStringTableIndex (STRING String, COUNT StringTableIndex)
+{
+	(void) String;
+	(void) StringTableIndex;
+	return NULL;
+}
+
+// As saveNonOrbitalLocation() and SaveSolarSysLocation() in
+// uqm/planets/solarsys.c.
+void
+SaveSolarSysLocation (void)
+{
+	if (!inOrbit)
+	{
+		GLOBAL (ShipFacing) = flagshipFacing + 1;
+		GLOBAL (in_orbit) = 0;
+		if (!inInnerSystem)
+		{
+			GLOBAL (ip_planet) = 0;
+		}
+		else
+		{
+			GLOBAL (ip_planet) = 1 + planetNumber;
+			GLOBAL (ip_location) = planetLocation;
+		}
+	}
+	else
+	{
+		if (GET_GAME_STATE (PLANETARY_CHANGE))
+		{
+			// PutPlanetInfo() writes the scan masks of the planet.
+			GAME_STATE_FILE *fp = OpenStateFile (STARINFO_FILE, "r+b");
+			DWORD masks[3] = { 0x11111111, 0x22222222, 0x33333333 };
+
+			SeekStateFile (fp, (NUM_SOLAR_SYSTEMS + 12) * 4, SEEK_SET);
+			WriteStateFile (masks, 4, 3, fp);
+			CloseStateFile (fp);
+			SET_GAME_STATE (PLANETARY_CHANGE, 0);
+		}
+		GLOBAL (in_orbit) = 1 + planetNumber;
+	}
+}
+
+// As in uqm/hyper.c.
+void
+SaveSisHyperState (void)
+{
+	GLOBAL (ShipFacing) = flagshipFacing + 1;
+}
+
+bool
+playerInSolarSystem (void)
+{
+	return inSystem;
+}
+
+bool
+playerInPlanetOrbit (void)
+{
+	return inOrbit;
+}
+
+void
+GetPlanetOrMoonName (UNICODE *buf, COUNT bufsize)
+{
+	// The name that is in the game already.
+	strncpy (buf, GLOBAL_SIS (PlanetName), bufsize);
+}
+
+// SaveProblem() draws a message box. The test does not get there.
+
+CONTEXT SpaceContext;
+FONT StarConFont;
+int ScreenWidth;
+int ScreenHeight;
+
+CONTEXT SetContext (CONTEXT Context) { return Context; }
+FONT SetContextFont (FONT Font) { return Font; }
+Color SetContextForeGroundColor (Color Color) { return Color; }
+void BatchGraphics (void) { }
+void UnbatchGraphics (void) { }
+void FlushGraphics (void) { }
+void font_DrawText (TEXT *pText) { (void) pText; }
+void DrawStamp (STAMP *pStamp) { (void) pStamp; }
+DRAWABLE ReleaseDrawable (FRAME Frame) { (void) Frame; return NULL; }
+BOOLEAN DestroyDrawable (DRAWABLE Drawable) { (void) Drawable; return TRUE; }
+
+BOOLEAN
+TextRect (TEXT *pText, RECT *pRect, BYTE *pdelta)
+{
+	(void) pText;
+	(void) pdelta;
+	memset (pRect, 0, sizeof (*pRect));
+	return TRUE;
+}
+
+void
+DrawStarConBox (RECT *pRect, SIZE BorderWidth, Color TopLeftColor,
+		Color BottomRightColor, BOOLEAN FillInterior, Color InteriorColor)
+{
+	(void) pRect;
+	(void) BorderWidth;
+	(void) TopLeftColor;
+	(void) BottomRightColor;
+	(void) FillInterior;
+	(void) InteriorColor;
+}
+
+STAMP
+SaveContextFrame (const RECT *saveRect)
+{
+	STAMP s;
+
+	(void) saveRect;
+	memset (&s, 0, sizeof (s));
+	return s;
+}
+
+BOOLEAN
+WaitForAnyButton (BOOLEAN newButton, TimePeriod duration, BOOLEAN resetInput)
+{
+	(void) newButton;
+	(void) duration;
+	(void) resetInput;
+	return TRUE;
+}
+
+// A byte string of the things that are saved, to compare.
+
+typedef struct
+{
+	BYTE data[DUMP_SIZE];
+	DWORD len;
+} Dump;
+
+static void
+put (Dump *d, const void *v, DWORD size)
+{
+	if (d->len + size > DUMP_SIZE)
+	{
+		fprintf (stderr, "Dump too large\n");
+		exit (EXIT_FAILURE);
+	}
+	memcpy (d->data + d->len, v, size);
+	d->len += size;
+}
+
+#define PUT(d, v) put ((d), &(v), sizeof (v))
+
+static void
+dumpShipQueue (Dump *d, QUEUE *q)
+{
+	HSHIPFRAG h, hNext;
+	COUNT count = CountLinks (q);
+
+	PUT (d, count);
+	for (h = GetHeadLink (q); h; h = hNext)
+	{
+		SHIP_FRAGMENT *FragPtr = LockShipFrag (q, h);
+
+		hNext = _GetSuccLink (FragPtr);
+		PUT (d, FragPtr->captains_name_index);
+		PUT (d, FragPtr->race_id);
+		PUT (d, FragPtr->index);
+		PUT (d, FragPtr->crew_level);
+		PUT (d, FragPtr->max_crew);
+		PUT (d, FragPtr->energy_level);
+		PUT (d, FragPtr->max_energy);
+		UnlockShipFrag (q, h);
+	}
+}
+
+static void
+dumpRaceQueue (Dump *d, QUEUE *q)
+{
+	HFLEETINFO h, hNext;
+
+	for (h = GetHeadLink (q); h; h = hNext)
+	{
+		FLEET_INFO *FleetPtr = LockFleetInfo (q, h);
+
+		hNext = _GetSuccLink (FleetPtr);
+		PUT (d, FleetPtr->allied_state);
+		PUT (d, FleetPtr->days_left);
+		PUT (d, FleetPtr->growth_fract);
+		PUT (d, FleetPtr->crew_level);
+		PUT (d, FleetPtr->max_crew);
+		PUT (d, FleetPtr->growth);
+		PUT (d, FleetPtr->max_energy);
+		PUT (d, FleetPtr->loc);
+		PUT (d, FleetPtr->actual_strength);
+		PUT (d, FleetPtr->known_strength);
+		PUT (d, FleetPtr->known_loc);
+		PUT (d, FleetPtr->growth_err_term);
+		PUT (d, FleetPtr->func_index);
+		PUT (d, FleetPtr->dest_loc);
+		UnlockFleetInfo (q, h);
+	}
+}
+
+static void
+dumpGroupQueue (Dump *d, QUEUE *q)
+{
+	HIPGROUP h, hNext;
+	COUNT count = CountLinks (q);
+
+	PUT (d, count);
+	for (h = GetHeadLink (q); h; h = hNext)
+	{
+		IP_GROUP *GroupPtr = LockIpGroup (q, h);
+
+		hNext = _GetSuccLink (GroupPtr);
+		PUT (d, GroupPtr->group_counter);
+		PUT (d, GroupPtr->race_id);
+		PUT (d, GroupPtr->sys_loc);
+		PUT (d, GroupPtr->task);
+		PUT (d, GroupPtr->in_system);
+		PUT (d, GroupPtr->dest_loc);
+		PUT (d, GroupPtr->orbit_pos);
+		PUT (d, GroupPtr->group_id);
+		PUT (d, GroupPtr->loc);
+		UnlockIpGroup (q, h);
+	}
+}
+
+static void
+dumpEncounters (Dump *d)
+{
+	HENCOUNTER h, hNext;
+	COUNT count = CountLinks (&GLOBAL (encounter_q));
+
+	PUT (d, count);
+	for (h = GetHeadEncounter (); h; h = hNext)
+	{
+		ENCOUNTER *EncounterPtr;
+		COUNT i;
+
+		LockEncounter (h, &EncounterPtr);
+		hNext = GetSuccEncounter (EncounterPtr);
+		PUT (d, EncounterPtr->transition_state);
+		PUT (d, EncounterPtr->origin);
+		PUT (d, EncounterPtr->radius);
+		PUT (d, EncounterPtr->loc_pt);
+		PUT (d, EncounterPtr->race_id);
+		PUT (d, EncounterPtr->num_ships);
+		PUT (d, EncounterPtr->flags);
+		for (i = 0; i < MAX_HYPER_SHIPS; i++)
+		{
+			PUT (d, EncounterPtr->ShipList[i].race_id);
+			PUT (d, EncounterPtr->ShipList[i].crew_level);
+			PUT (d, EncounterPtr->ShipList[i].max_crew);
+			PUT (d, EncounterPtr->ShipList[i].max_energy);
+		}
+		PUT (d, EncounterPtr->log_x);
+		PUT (d, EncounterPtr->log_y);
+		UnlockEncounter (h);
+	}
+}
+
+static void
+dumpEvent (const EVENT *EventPtr, void *arg)
+{
+	Dump *d = arg;
+
+	PUT (d, EventPtr->day_index);
+	PUT (d, EventPtr->month_index);
+	PUT (d, EventPtr->year_index);
+	PUT (d, EventPtr->func_index);
+}
+
+static void
+dumpEvents (Dump *d)
+{
+	COUNT count = CountEvents ();
+
+	PUT (d, count);
+	ForAllEvents (dumpEvent, d);
+}
+
+// The groups under the header at 'offset', as SaveBattleGroup() reads
+// them.
+static void
+dumpBattleGroup (Dump *d, GAME_STATE_FILE *fp, DWORD offset)
+{
+	GROUP_HEADER h;
+	COUNT i;
+
+	SeekStateFile (fp, offset, SEEK_SET);
+	ReadGroupHeader (fp, &h);
+	PUT (d, h.star_index);
+	PUT (d, h.day_index);
+	PUT (d, h.month_index);
+	PUT (d, h.year_index);
+	PUT (d, h.NumGroups);
+	for (i = 1; i <= h.NumGroups; ++i)
+	{
+		BYTE icon, NumShips;
+		COUNT j;
+
+		SeekStateFile (fp, h.GroupOffset[i], SEEK_SET);
+		sread_8 (fp, &icon);
+		sread_8 (fp, &NumShips);
+		PUT (d, icon);
+		PUT (d, NumShips);
+		for (j = 0; j < NumShips; ++j)
+		{
+			BYTE race_outer;
+			SHIP_FRAGMENT sf;
+
+			sread_8 (fp, &race_outer);
+			ReadShipFragment (fp, &sf);
+			PUT (d, race_outer);
+			PUT (d, sf.captains_name_index);
+			PUT (d, sf.race_id);
+			PUT (d, sf.index);
+			PUT (d, sf.crew_level);
+			PUT (d, sf.max_crew);
+			PUT (d, sf.energy_level);
+			PUT (d, sf.max_energy);
+		}
+	}
+}
+
+// The contents of the group files and the group offsets in the game
+// state, whatever the layout of the files.
+static void
+dumpGroups (Dump *d)
+{
+	GAME_STATE_FILE *fp;
+	COUNT state_index;
+
+	fp = OpenStateFile (RANDGRPINFO_FILE, "rb");
+	{
+		GROUP_HEADER h;
+		BYTE lastenc, count;
+		COUNT i;
+
+		ReadGroupHeader (fp, &h);
+		SeekStateFile (fp, h.GroupOffset[0], SEEK_SET);
+		sread_8 (fp, &lastenc);
+		sread_8 (fp, &count);
+		PUT (d, lastenc);
+		PUT (d, count);
+		for (i = 0; i < count; ++i)
+		{
+			BYTE race_outer;
+			IP_GROUP ip;
+
+			sread_8 (fp, &race_outer);
+			ReadIpGroup (fp, &ip);
+			PUT (d, race_outer);
+			PUT (d, ip.group_counter);
+			PUT (d, ip.race_id);
+			PUT (d, ip.sys_loc);
+			PUT (d, ip.task);
+			PUT (d, ip.in_system);
+			PUT (d, ip.dest_loc);
+			PUT (d, ip.orbit_pos);
+			PUT (d, ip.group_id);
+			PUT (d, ip.loc);
+		}
+		dumpBattleGroup (d, fp, 0);
+	}
+	CloseStateFile (fp);
+
+	fp = OpenStateFile (DEFGRPINFO_FILE, "rb");
+	for (state_index = SHOFIXTI_GRPOFFS0; state_index < NUM_GAME_STATE_BITS;
+			state_index += 32)
+	{
+		DWORD grpoffs = GET_GAME_STATE_32 (state_index);
+		BYTE current = grpoffs && grpoffs == GLOBAL (BattleGroupRef);
+
+		if (!grpoffs)
+			continue;
+		PUT (d, state_index);
+		PUT (d, current);
+		dumpBattleGroup (d, fp, grpoffs);
+	}
+	CloseStateFile (fp);
+}
+
+static void
+dumpStarInfo (Dump *d)
+{
+	GAME_STATE_FILE *fp = OpenStateFile (STARINFO_FILE, "rb");
+	DWORD len = LengthStateFile (fp);
+	BYTE *data = malloc (len);
+
+	PUT (d, len);
+	ReadStateFile (data, 1, (COUNT) len, fp);
+	put (d, data, len);
+	free (data);
+	CloseStateFile (fp);
+}
+
+// What is saved, as it should come back from LoadGame().
+static void
+dumpSaved (Dump *d)
+{
+	const GAME_STATE *gs = &GlobData.Game_state;
+	ACTIVITY activity = gs->CurrentActivity;
+	COUNT i;
+
+	d->len = 0;
+	PUT (d, GlobData.SIS_state);
+	PUT (d, gs->glob_flags);
+	PUT (d, gs->CrewCost);
+	PUT (d, gs->FuelCost);
+	PUT (d, gs->ModuleCost);
+	PUT (d, gs->ElementWorth);
+	PUT (d, activity);
+	PUT (d, gs->GameClock.day_index);
+	PUT (d, gs->GameClock.month_index);
+	PUT (d, gs->GameClock.year_index);
+	PUT (d, gs->GameClock.tick_count);
+	PUT (d, gs->GameClock.day_in_ticks);
+	PUT (d, gs->autopilot);
+	PUT (d, gs->ip_location);
+	PUT (d, gs->ShipStamp.origin);
+	PUT (d, gs->ShipFacing);
+	PUT (d, gs->ip_planet);
+	PUT (d, gs->in_orbit);
+	PUT (d, gs->velocity);
+	// The group offsets are set anew by LoadGame(); dumpGroups()
+	// compares the groups instead.
+	put (d, gs->GameState, SHOFIXTI_GRPOFFS0 >> 3);
+	for (i = SHOFIXTI_GRPOFFS0 >> 3; i < sizeof (gs->GameState); ++i)
+	{
+		BYTE set = gs->GameState[i] != 0;
+		PUT (d, set);
+	}
+
+	dumpRaceQueue (d, &GLOBAL (avail_race_q));
+	if (!(activity & START_INTERPLANETARY))
+	{
+		if (activity & START_ENCOUNTER)
+			dumpShipQueue (d, &GLOBAL (npc_built_ship_q));
+		else if (LOBYTE (activity) == IN_INTERPLANETARY)
+			dumpGroupQueue (d, &GLOBAL (ip_group_q));
+	}
+	dumpShipQueue (d, &GLOBAL (built_ship_q));
+	dumpEvents (d);
+	dumpEncounters (d);
+	dumpStarInfo (d);
+	dumpGroups (d);
+	PUT (d, CurStarDescPtr);
+}
+
+static Dump expected;
+static Dump actual;
+static BOOLEAN takeSnapshot = TRUE;
+		// Turned off while the saves are timed.
+
+// Called by PrepareSummary() with the game as it is saved.
+SIZE
+InventoryDevices (BYTE *pDeviceMap, COUNT Size)
+{
+	(void) pDeviceMap;
+	(void) Size;
+	if (takeSnapshot)
+		dumpSaved (&expected);
+	return 0;
+}
+
+// The running game, byte for byte.
+
+typedef struct
+{
+	GLOBDATA globData;
+	BYTE *queueTabs[5];
+	STATE_FILE_COPY stateFiles[DEFGRPINFO_FILE + 1];
+	BYTE lastEncGroup;
+	STAR_DESC *curStarDesc;
+	ACTIVITY nextActivity;
+	Dump events;
+} GameCopy;
+
+static QUEUE *
+gameQueue (int i)
+{
+	QUEUE *queues[5] = {
+		&GLOBAL (avail_race_q), &GLOBAL (npc_built_ship_q),
+		&GLOBAL (ip_group_q), &GLOBAL (encounter_q),
+		&GLOBAL (built_ship_q),
+	};
+	return queues[i];
+}
+
+static size_t
+queueTabSize (const QUEUE *q)
+{
+	return (size_t) q->object_size * q->num_objects;
+}
+
+static void
+copyGame (GameCopy *c)
+{
+	int i;
+
+	c->globData = GlobData;
+	for (i = 0; i < 5; ++i)
+	{
+		QUEUE *q = gameQueue (i);
+		c->queueTabs[i] = malloc (queueTabSize (q));
+		memcpy (c->queueTabs[i], q->pq_tab, queueTabSize (q));
+	}
+	for (i = 0; i <= DEFGRPINFO_FILE; ++i)
+		CopyStateFile (i, &c->stateFiles[i]);
+	c->lastEncGroup = GetLastEncGroup ();
+	c->curStarDesc = CurStarDescPtr;
+	c->nextActivity = NextActivity;
+	c->events.len = 0;
+	dumpEvents (&c->events);
+}
+
+static void
+freeGameCopy (GameCopy *c)
+{
+	int i;
+
+	for (i = 0; i < 5; ++i)
+		free (c->queueTabs[i]);
+	for (i = 0; i <= DEFGRPINFO_FILE; ++i)
+		HFree (c->stateFiles[i].data);
+}
+
+static BOOLEAN
+sameGame (const GameCopy *a, const GameCopy *b, const char *scenario)
+{
+	static const char *queueNames[5] = {
+		"avail_race_q", "npc_built_ship_q", "ip_group_q", "encounter_q",
+		"built_ship_q",
+	};
+	static const char *fileNames[DEFGRPINFO_FILE + 1] = {
+		"STARINFO", "RANDGRPINFO", "DEFGRPINFO",
+	};
+	BOOLEAN same = TRUE;
+	int i;
+
+	if (memcmp (&a->globData, &b->globData, sizeof (GLOBDATA)) != 0)
+	{
+		printf ("%s: GlobData changed\n", scenario);
+		same = FALSE;
+	}
+	for (i = 0; i < 5; ++i)
+	{
+		if (memcmp (a->queueTabs[i], b->queueTabs[i],
+				queueTabSize (gameQueue (i))) != 0)
+		{
+			printf ("%s: %s changed\n", scenario, queueNames[i]);
+			same = FALSE;
+		}
+	}
+	for (i = 0; i <= DEFGRPINFO_FILE; ++i)
+	{
+		const STATE_FILE_COPY *fa = &a->stateFiles[i];
+		const STATE_FILE_COPY *fb = &b->stateFiles[i];
+
+		if (fa->used != fb->used || fa->size != fb->size
+				|| memcmp (fa->data, fb->data, fa->size) != 0)
+		{
+			printf ("%s: state file %s changed\n", scenario, fileNames[i]);
+			same = FALSE;
+		}
+	}
+	if (a->lastEncGroup != b->lastEncGroup)
+	{
+		printf ("%s: LastEncGroup changed\n", scenario);
+		same = FALSE;
+	}
+	if (a->curStarDesc != b->curStarDesc || a->nextActivity != b->nextActivity)
+	{
+		printf ("%s: CurStarDescPtr or NextActivity changed\n", scenario);
+		same = FALSE;
+	}
+	if (a->events.len != b->events.len
+			|| memcmp (a->events.data, b->events.data, a->events.len) != 0)
+	{
+		printf ("%s: the events changed\n", scenario);
+		same = FALSE;
+	}
+	return same;
+}
+
+// Setting up a game.
+
+static DWORD randomState = 1;
+
+static DWORD
+randomNumber (DWORD range)
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % range;
+}
+
+static void
+randomBytes (void *buf, size_t size)
+{
+	BYTE *b = buf;
+
+	while (size--)
+		*b++ = (BYTE) randomNumber (256);
+}
+
+static void
+randomName (UNICODE *name, COUNT size)
+{
+	COUNT len = 1 + (COUNT) randomNumber (size - 1);
+	COUNT i;
+
+	memset (name, 0, size);
+	for (i = 0; i < len; ++i)
+		name[i] = (UNICODE) ('A' + randomNumber (26));
+}
+
+static void
+addShips (QUEUE *q, COUNT count, COUNT race)
+{
+	while (count--)
+	{
+		HSHIPFRAG h = CloneShipFragment (race, q,
+				(COUNT) (1 + randomNumber (20)));
+		SHIP_FRAGMENT *FragPtr = LockShipFrag (q, h);
+
+		FragPtr->energy_level = (BYTE) randomNumber (30);
+		FragPtr->index = (BYTE) randomNumber (4);
+		UnlockShipFrag (q, h);
+	}
+}
+
+// The random groups of the system, written out as the game does when the
+// player enters it, and then moved on. The ones in the file are older,
+// and LastEncGroup is set.
+static void
+setupRandomGroups (void)
+{
+	COUNT g;
+
+	InitGroupInfo (FALSE);
+	for (g = 1; g <= NUM_RANDOM_GROUPS; ++g)
+	{
+		COUNT race = (COUNT) randomNumber (NUM_RACES - 2);
+
+		addShips (&GLOBAL (npc_built_ship_q),
+				(COUNT) (1 + randomNumber (4)), race);
+		PutGroupInfo (GROUPS_RANDOM, (BYTE) g);
+		ReinitQueue (&GLOBAL (npc_built_ship_q));
+
+		{
+			HIPGROUP h = BuildGroup (&GLOBAL (ip_group_q), (BYTE) race);
+			IP_GROUP *GroupPtr = LockIpGroup (&GLOBAL (ip_group_q), h);
+
+			GroupPtr->group_counter = (UWORD) randomNumber (1000);
+			GroupPtr->sys_loc = (BYTE) randomNumber (16);
+			GroupPtr->task = (BYTE) randomNumber (16);
+			GroupPtr->in_system = 1;
+			GroupPtr->dest_loc = (BYTE) randomNumber (16);
+			GroupPtr->orbit_pos = (BYTE) randomNumber (16);
+			GroupPtr->group_id = (BYTE) g;
+			GroupPtr->loc.x = (COORD) randomNumber (2000) - 1000;
+			GroupPtr->loc.y = (COORD) randomNumber (2000) - 1000;
+			UnlockIpGroup (&GLOBAL (ip_group_q), h);
+		}
+	}
+	SetLastEncGroup (0);
+	PutGroupInfo (GROUPS_RANDOM, GROUP_LIST);
+
+	for (g = 0; g < 2; ++g)
+	{
+		HIPGROUP h = GetStarShipFromIndex (&GLOBAL (ip_group_q),
+				(COUNT) randomNumber (NUM_RANDOM_GROUPS));
+		IP_GROUP *GroupPtr = LockIpGroup (&GLOBAL (ip_group_q), h);
+
+		GroupPtr->loc.x += 50;
+		GroupPtr->task = (GroupPtr->task + 1) & 0x0f;
+		UnlockIpGroup (&GLOBAL (ip_group_q), h);
+	}
+	SetLastEncGroup ((BYTE) (1 + randomNumber (NUM_RANDOM_GROUPS)));
+}
+
+// Groups of races that the story places, one of them the one that the
+// player is meeting.
+static void
+setupDefinedGroups (void)
+{
+	static const COUNT slots[] = { 0, 3, 7 };
+	COUNT i;
+
+	for (i = 0; i < sizeof slots / sizeof slots[0]; ++i)
+	{
+		DWORD offset;
+		COUNT g;
+		COUNT numGroups = (COUNT) (1 + randomNumber (3));
+
+		offset = PutGroupInfo (GROUPS_ADD_NEW, 1);
+		for (g = 1; g <= numGroups; ++g)
+		{
+			addShips (&GLOBAL (npc_built_ship_q),
+					(COUNT) (1 + randomNumber (5)),
+					(COUNT) randomNumber (NUM_RACES - 2));
+			PutGroupInfo (offset, (BYTE) g);
+			ReinitQueue (&GLOBAL (npc_built_ship_q));
+		}
+		SET_GAME_STATE_32 (SHOFIXTI_GRPOFFS0 + slots[i] * 32, offset);
+		if (i == 1)
+			GLOBAL (BattleGroupRef) = offset;
+	}
+}
+
+static void
+setupStarInfo (void)
+{
+	GAME_STATE_FILE *fp = OpenStateFile (STARINFO_FILE, "wb");
+	COUNT i;
+
+	for (i = 0; i < NUM_STARINFO_DWORDS; ++i)
+	{
+		DWORD v = randomNumber (0x7fffffff);
+		swrite_32 (fp, v);
+	}
+	CloseStateFile (fp);
+}
+
+static void
+setupEncounters (void)
+{
+	COUNT n = (COUNT) (1 + randomNumber (MAX_ENCOUNTERS - 1));
+
+	while (n--)
+	{
+		HENCOUNTER h = AllocEncounter ();
+		ENCOUNTER *EncounterPtr;
+		COUNT i;
+
+		LockEncounter (h, &EncounterPtr);
+		memset (EncounterPtr, 0, sizeof (*EncounterPtr));
+		EncounterPtr->transition_state = (SIZE) randomNumber (100) - 50;
+		EncounterPtr->origin.x = (COORD) randomNumber (10000);
+		EncounterPtr->origin.y = (COORD) randomNumber (10000);
+		EncounterPtr->radius = (COUNT) randomNumber (1000);
+		EncounterPtr->loc_pt.x = (COORD) randomNumber (10000);
+		EncounterPtr->loc_pt.y = (COORD) randomNumber (10000);
+		EncounterPtr->race_id = (BYTE) randomNumber (NUM_RACES - 2);
+		EncounterPtr->num_ships = (BYTE) (1 + randomNumber (MAX_HYPER_SHIPS));
+		EncounterPtr->flags = (BYTE) (randomNumber (4) << 6);
+		for (i = 0; i < EncounterPtr->num_ships; ++i)
+		{
+			EncounterPtr->ShipList[i].race_id = EncounterPtr->race_id;
+			EncounterPtr->ShipList[i].crew_level =
+					(COUNT) randomNumber (40);
+			EncounterPtr->ShipList[i].max_crew = 42;
+			EncounterPtr->ShipList[i].max_energy =
+					(BYTE) randomNumber (40);
+		}
+		EncounterPtr->log_x = (SDWORD) randomNumber (1000000);
+		EncounterPtr->log_y = (SDWORD) randomNumber (1000000);
+		UnlockEncounter (h);
+		PutEncounter (h);
+	}
+}
+
+typedef enum
+{
+	SCENARIO_HYPERSPACE,
+	SCENARIO_OUTER_SYSTEM,
+	SCENARIO_INNER_SYSTEM,
+	SCENARIO_ORBIT,
+	SCENARIO_ENCOUNTER,
+	SCENARIO_HOMEWORLD,
+	NUM_SCENARIOS
+} Scenario;
+
+static const char *scenarioNames[NUM_SCENARIOS] = {
+	"HyperSpace", "outer system", "inner system", "orbit", "encounter",
+	"homeworld",
+};
+
+static void
+setupGame (Scenario scenario, DWORD seed)
+{
+	GAME_STATE *gs = &GlobData.Game_state;
+	COUNT i;
+
+	randomState = seed;
+	srand (seed);
+
+	ReinitQueue (&GLOBAL (avail_race_q));
+	ReinitQueue (&GLOBAL (built_ship_q));
+	ReinitQueue (&GLOBAL (npc_built_ship_q));
+	ReinitQueue (&GLOBAL (ip_group_q));
+	ReinitQueue (&GLOBAL (encounter_q));
+	ClearEvents ();
+	SetLastEncGroup (0);
+
+	for (i = 0; i < NUM_RACES; ++i)
+	{
+		HFLEETINFO h = AllocLink (&GLOBAL (avail_race_q));
+		FLEET_INFO *FleetPtr = LockFleetInfo (&GLOBAL (avail_race_q), h);
+
+		memset (FleetPtr, 0, sizeof (*FleetPtr));
+		FleetPtr->SpeciesID = (SPECIES_ID) (i + 1);
+		FleetPtr->allied_state = (UWORD) randomNumber (3);
+		FleetPtr->days_left = (BYTE) randomNumber (256);
+		FleetPtr->growth_fract = (BYTE) randomNumber (256);
+		FleetPtr->crew_level = (COUNT) (1 + randomNumber (42));
+		FleetPtr->max_crew = 42;
+		FleetPtr->growth = (BYTE) randomNumber (256);
+		FleetPtr->max_energy = (BYTE) (1 + randomNumber (40));
+		FleetPtr->loc.x = (COORD) randomNumber (10000);
+		FleetPtr->loc.y = (COORD) randomNumber (10000);
+		FleetPtr->actual_strength = (COUNT) randomNumber (1000);
+		FleetPtr->known_strength = (COUNT) randomNumber (1000);
+		FleetPtr->known_loc.x = (COORD) randomNumber (10000);
+		FleetPtr->known_loc.y = (COORD) randomNumber (10000);
+		FleetPtr->growth_err_term = (BYTE) randomNumber (256);
+		FleetPtr->func_index = (BYTE) randomNumber (256);
+		FleetPtr->dest_loc.x = (COORD) randomNumber (10000);
+		FleetPtr->dest_loc.y = (COORD) randomNumber (10000);
+		UnlockFleetInfo (&GLOBAL (avail_race_q), h);
+		PutQueue (&GLOBAL (avail_race_q), h);
+	}
+
+	for (i = (COUNT) (1 + randomNumber (MAX_BUILT_SHIPS)); i > 0; --i)
+		addShips (&GLOBAL (built_ship_q), 1,
+				(COUNT) randomNumber (NUM_RACES - 2));
+
+	memset (&GlobData.SIS_state, 0, sizeof (GlobData.SIS_state));
+	randomBytes (&GLOBAL_SIS (log_x), sizeof (GLOBAL_SIS (log_x)));
+	randomBytes (&GLOBAL_SIS (log_y), sizeof (GLOBAL_SIS (log_y)));
+	GLOBAL_SIS (ResUnits) = randomNumber (100000);
+	GLOBAL_SIS (FuelOnBoard) = randomNumber (100000);
+	GLOBAL_SIS (CrewEnlisted) = (COUNT) randomNumber (500);
+	GLOBAL_SIS (TotalElementMass) = (COUNT) randomNumber (1000);
+	GLOBAL_SIS (TotalBioMass) = (COUNT) randomNumber (1000);
+	randomBytes (GLOBAL_SIS (ModuleSlots), sizeof (GLOBAL_SIS (ModuleSlots)));
+	randomBytes (GLOBAL_SIS (DriveSlots), sizeof (GLOBAL_SIS (DriveSlots)));
+	randomBytes (GLOBAL_SIS (JetSlots), sizeof (GLOBAL_SIS (JetSlots)));
+	GLOBAL_SIS (NumLanders) = (BYTE) randomNumber (10);
+	for (i = 0; i < NUM_ELEMENT_CATEGORIES; ++i)
+		GLOBAL_SIS (ElementAmounts[i]) = (COUNT) randomNumber (1000);
+	randomName (GLOBAL_SIS (ShipName), SIS_NAME_SIZE);
+	randomName (GLOBAL_SIS (CommanderName), SIS_NAME_SIZE);
+	randomName (GLOBAL_SIS (PlanetName), SIS_NAME_SIZE);
+
+	gs->glob_flags = (BYTE) randomNumber (256);
+	gs->CrewCost = (BYTE) randomNumber (256);
+	gs->FuelCost = (BYTE) randomNumber (256);
+	randomBytes (gs->ModuleCost, sizeof (gs->ModuleCost));
+	randomBytes (gs->ElementWorth, sizeof (gs->ElementWorth));
+	gs->GameClock.day_index = (BYTE) (1 + randomNumber (28));
+	gs->GameClock.month_index = (BYTE) (1 + randomNumber (12));
+	gs->GameClock.year_index = (COUNT) (START_YEAR + randomNumber (4));
+	gs->GameClock.tick_count = (SIZE) randomNumber (100);
+	gs->GameClock.day_in_ticks = (SIZE) randomNumber (100);
+	for (i = 0; i < 20; ++i)
+		AddEvent (RELATIVE_EVENT, 0, (COUNT) (1 + randomNumber (400)),
+				0, (BYTE) randomNumber (NUM_EVENTS));
+	gs->autopilot.x = (COORD) randomNumber (10000);
+	gs->autopilot.y = (COORD) randomNumber (10000);
+	gs->ip_location.x = (COORD) randomNumber (2000) - 1000;
+	gs->ip_location.y = (COORD) randomNumber (2000) - 1000;
+	gs->ShipStamp.origin.x = (COORD) randomNumber (300);
+	gs->ShipStamp.origin.y = (COORD) randomNumber (300);
+	gs->ShipFacing = (UWORD) (1 + randomNumber (16));
+	gs->ip_planet = (BYTE) randomNumber (8);
+	gs->in_orbit = 0;
+	randomBytes (&gs->velocity, sizeof (gs->velocity));
+	gs->BattleGroupRef = 0;
+
+	// The group offsets are set below.
+	randomBytes (gs->GameState, SHOFIXTI_GRPOFFS0 >> 3);
+	memset (gs->GameState + (SHOFIXTI_GRPOFFS0 >> 3), 0,
+			sizeof (gs->GameState) - (SHOFIXTI_GRPOFFS0 >> 3));
+	SET_GAME_STATE (GLOBAL_FLAGS_AND_DATA, 0);
+	// CurStarDescPtr is a star of HyperSpace, not a QuasiSpace portal.
+	SET_GAME_STATE (ARILOU_SPACE_SIDE, 0);
+
+	star_array = starmap_array;
+	CurStarDescPtr = &star_array[randomNumber (NUM_SOLAR_SYSTEMS)];
+	NextActivity = 0;
+
+	inSystem = scenario != SCENARIO_HYPERSPACE;
+	inOrbit = scenario == SCENARIO_ORBIT;
+	inInnerSystem = scenario == SCENARIO_INNER_SYSTEM
+			|| scenario == SCENARIO_ORBIT;
+	flagshipFacing = (UWORD) randomNumber (16);
+	planetNumber = (BYTE) randomNumber (8);
+	planetLocation.x = (COORD) randomNumber (600);
+	planetLocation.y = (COORD) randomNumber (600);
+	if (inOrbit)
+	{
+		gs->ip_planet = 1 + planetNumber;
+		SET_GAME_STATE (PLANETARY_CHANGE, 1);
+	}
+
+	setupStarInfo ();
+	InitGroupInfo (TRUE);
+	setupDefinedGroups ();
+
+	switch (scenario)
+	{
+		case SCENARIO_HYPERSPACE:
+			gs->CurrentActivity = IN_HYPERSPACE;
+			setupEncounters ();
+			break;
+		case SCENARIO_OUTER_SYSTEM:
+		case SCENARIO_INNER_SYSTEM:
+		case SCENARIO_ORBIT:
+			gs->CurrentActivity = IN_INTERPLANETARY;
+			setupRandomGroups ();
+			break;
+		case SCENARIO_ENCOUNTER:
+			gs->CurrentActivity = IN_INTERPLANETARY | START_ENCOUNTER;
+			setupRandomGroups ();
+			addShips (&GLOBAL (npc_built_ship_q),
+					(COUNT) (1 + randomNumber (MAX_SHIPS_PER_SIDE)),
+					(COUNT) randomNumber (NUM_RACES - 2));
+			break;
+		case SCENARIO_HOMEWORLD:
+			gs->CurrentActivity = IN_INTERPLANETARY | START_INTERPLANETARY;
+			setupRandomGroups ();
+			break;
+		default:
+			break;
+	}
+}
+
+// The slot that AutoSaveGame() wrote, when all of them were deleted first.
+static COUNT
+savedSlot (void)
+{
+	COUNT which_game;
+	char file[32];
+
+	for (which_game = FIRST_AUTOSAVE_GAME;
+			which_game < FIRST_AUTOSAVE_GAME + NUM_AUTOSAVE_SLOTS;
+			++which_game)
+	{
+		sprintf (file, "uqmsave.%02u", which_game);
+		if (fileExists2 (saveDir, file))
+			return which_game;
+	}
+	return (COUNT)~0;
+}
+
+static void
+deleteSaves (void)
+{
+	COUNT which_game;
+	char file[32];
+
+	for (which_game = FIRST_AUTOSAVE_GAME;
+			which_game < FIRST_AUTOSAVE_GAME + NUM_AUTOSAVE_SLOTS;
+			++which_game)
+	{
+		sprintf (file, "uqmsave.%02u", which_game);
+		if (fileExists2 (saveDir, file))
+			DeleteResFile (saveDir, file);
+	}
+}
+
+static BOOLEAN
+checkScenario (Scenario scenario, DWORD seed)
+{
+	const char *name = scenarioNames[scenario];
+	GameCopy before, after;
+	COUNT which_game;
+	BOOLEAN ok;
+
+	deleteSaves ();
+	setupGame (scenario, seed);
+	copyGame (&before);
+	expected.len = 0;
+	if (!AutoSaveGame ())
+	{
+		printf ("%s: AutoSaveGame() failed\n", name);
+		freeGameCopy (&before);
+		return FALSE;
+	}
+	copyGame (&after);
+	ok = sameGame (&before, &after, name);
+	freeGameCopy (&before);
+	freeGameCopy (&after);
+
+	if (!WaitSaveGameWrite ())
+	{
+		printf ("%s: the save was not written\n", name);
+		return FALSE;
+	}
+	which_game = savedSlot ();
+	if (expected.len == 0 || which_game == (COUNT)~0)
+	{
+		printf ("%s: no game was saved\n", name);
+		return FALSE;
+	}
+
+	// Load it over another game.
+	setupGame ((scenario + 1) % NUM_SCENARIOS, seed + 1000);
+	if (!LoadGame (which_game, NULL))
+	{
+		printf ("%s: LoadGame() failed\n", name);
+		return FALSE;
+	}
+	// As the game does with the loaded activity.
+	GLOBAL (CurrentActivity) = NextActivity & ~START_INTERPLANETARY;
+	if (scenario == SCENARIO_HOMEWORLD)
+		GLOBAL (CurrentActivity) |= START_INTERPLANETARY;
+	if (LOBYTE (NextActivity) == IN_INTERPLANETARY
+			&& !(NextActivity & (START_ENCOUNTER | START_INTERPLANETARY)))
+	{
+		printf ("%s: START_INTERPLANETARY is not set after loading\n",
+				name);
+		ok = FALSE;
+	}
+
+	dumpSaved (&actual);
+	if (actual.len != expected.len
+			|| memcmp (actual.data, expected.data, expected.len) != 0)
+	{
+		DWORD i;
+
+		for (i = 0; i < actual.len && i < expected.len
+				&& actual.data[i] == expected.data[i]; ++i)
+			;
+		printf ("%s: the loaded game differs from the saved one at byte "
+				"%lu of %lu\n", name, (unsigned long) i,
+				(unsigned long) expected.len);
+		ok = FALSE;
+	}
+	return ok;
+}
+
+static int
+compareDouble (const void *a, const void *b)
+{
+	double da = *(const double *) a;
+	double db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+static double
+now (void)
+{
+	uint64 counter = GetPerfCounter ();
+	return (double) counter / 1e9;
+}
+
+static double
+median (double *times, int runs)
+{
+	qsort (times, runs, sizeof times[0], compareDouble);
+	return times[runs / 2];
+}
+
+// AutoSaveGame() against SaveGame() alone, which leaves the changes to
+// the game in place; the difference is the copying and putting back of
+// what SaveGame() changes.
+static void
+timeSaves (Scenario scenario, int runs)
+{
+	static double autoTime[MAX_RUNS];
+	static double saveTime[MAX_RUNS];
+	static double writeTime[MAX_RUNS];
+	SUMMARY_DESC summary;
+	int i;
+
+	setupGame (scenario, 77);
+	takeSnapshot = FALSE;
+	for (i = 0; i < runs; ++i)
+	{
+		double start = now ();
+
+		AutoSaveGame ();
+		autoTime[i] = now () - start;
+		start = now ();
+		WaitSaveGameWrite ();
+		writeTime[i] = now () - start;
+	}
+	for (i = 0; i < runs; ++i)
+	{
+		double start = now ();
+
+		SaveGame (FIRST_AUTOSAVE_GAME, &summary, "Timing");
+		saveTime[i] = now () - start;
+		WaitSaveGameWrite ();
+	}
+	takeSnapshot = TRUE;
+	printf ("%-13s AutoSaveGame() %6.1f us on the game thread, of which "
+			"SaveGame() %6.1f us; written %6.1f us later\n",
+			scenarioNames[scenario], median (autoTime, runs) * 1e6,
+			median (saveTime, runs) * 1e6, median (writeTime, runs) * 1e6);
+}
+
+int
+main (int argc, char *argv[])
+{
+	BOOLEAN ok = TRUE;
+	int runs = 200;
+	int scenario;
+	DWORD seed;
+
+	if (argc < 2)
+	{
+		fprintf (stderr, "Usage: %s <save directory> [number of timed "
+				"saves]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc > 2)
+		runs = atoi (argv[2]);
+	if (runs < 1 || runs > MAX_RUNS)
+		runs = 200;
+
+	uio_init ();
+	repository = uio_openRepository (0);
+	uio_mountDir (repository, "/", uio_FSTYPE_STDIO, NULL, NULL, argv[1],
+			NULL, uio_MOUNT_TOP, NULL);
+	saveDir = uio_openDir (repository, "/", 0);
+
+	InitQueue (&GLOBAL (avail_race_q), NUM_RACES, sizeof (FLEET_INFO));
+	InitQueue (&GLOBAL (built_ship_q), MAX_BUILT_SHIPS,
+			sizeof (SHIP_FRAGMENT));
+	InitQueue (&GLOBAL (npc_built_ship_q), MAX_SHIPS_PER_SIDE,
+			sizeof (SHIP_FRAGMENT));
+	InitQueue (&GLOBAL (ip_group_q), MAX_BATTLE_GROUPS, sizeof (IP_GROUP));
+	InitQueue (&GLOBAL (encounter_q), MAX_ENCOUNTERS, sizeof (ENCOUNTER));
+	InitQueue (&race_q[0], MAX_SHIPS_PER_SIDE, sizeof (SHIP_FRAGMENT));
+	InitQueue (&race_q[1], MAX_SHIPS_PER_SIDE, sizeof (SHIP_FRAGMENT));
+	InitGameClock ();
+
+	for (seed = 1; seed <= 20; ++seed)
+	{
+		for (scenario = 0; scenario < NUM_SCENARIOS; ++scenario)
+		{
+			if (!checkScenario (scenario, seed))
+				ok = FALSE;
+		}
+	}
+
+	for (scenario = 0; scenario < NUM_SCENARIOS; ++scenario)
+		timeSaves (scenario, runs);
+	deleteSaves ();
+
+	uio_closeDir (saveDir);
+	uio_closeRepository (repository);
+	uio_unInit ();
+
+	printf ("%s\n", ok ? "OK" : "FAILED");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
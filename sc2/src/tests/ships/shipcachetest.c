@@ -0,0 +1,885 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Loads every ship of the base content with load_ship() (uqm/loadship.c),
+// once with its battle data not in the cache and once right after it was
+// freed, checks that the second load shares the data of the first, and
+// prints how long each takes. Then it checks the reference counts of
+// battle data shared by ships in battle at the same time, that data in
+// use is never freed, and that a random run of loads and frees leaves the
+// cache as a model of it that frees the least recently used data first
+// when it takes more than SHIP_MEDIA_CACHE_SIZE bytes.
+//
+// The ship code, the resource index and the .ani loader
+// (libs/graphics/gfxload.c) are those of the game. The graphics driver is
+// a stand-in that decodes the PNGs with libpng, and the sound banks and
+// ditties are read into memory whole instead of being decoded, so the
+// times are those of the game's loading apart from the work of SDL and
+// the sound decoders. The files come from the operating system's cache
+// after the first round in either case.
+//
+// Usage: shipcachetest <content dir> [number of rounds]
+// See tests/README for how to build it.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <png.h>
+
+// The battle data of all the ships of the base content takes about 4 MB,
+// which fits in the cache of the game, so a smaller one is used to have
+// data freed.
+#define SHIP_MEDIA_CACHE_SIZE (1024 * 1024)
+
+// The test looks into the cache, so it is built with the file.
+#include "uqm/loadship.c"
+
+#include "libs/graphics/context.h"
+#include "libs/graphics/drawable.h"
+#include "libs/graphics/tfb_draw.h"
+#include "libs/reslib.h"
+#include "libs/sndlib.h"
+#include "libs/strings/strintrn.h"
+#include "libs/uio.h"
+#include "libs/vidlib.h"
+
+#define MAX_ROUNDS 100
+#define MAX_HELD 8
+#define NUM_RANDOM_STEPS 400
+
+uio_Repository *repository;
+uio_DirHandle *contentDir;
+
+// What the rest of the game would provide.
+
+CONTEXT _pCurContext;
+GRAPHICS_STATUS _GraphicsStatusFlags;
+
+static char lastLoadLog[256];
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start (args, fmt);
+	if (level <= log_Warning)
+	{
+		vfprintf (stderr, fmt, args);
+		fputc ('\n', stderr);
+	}
+	else if (strncmp (fmt, "load_ship(", 10) == 0)
+	{
+		vsnprintf (lastLoadLog, sizeof lastLoadLog, fmt, args);
+	}
+	va_end (args);
+}
+
+uint64
+GetPerfCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + (uint64) ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return 1000000000;
+}
+
+Mutex
+CreateMutex_Core (const char *name, DWORD syncClass)
+{
+	(void) name;
+	(void) syncClass;
+	return NULL;
+}
+
+void
+DestroyMutex (Mutex mutex)
+{
+	(void) mutex;
+}
+
+// The graphics driver: canvases are decoded PNGs, either indexed with
+// their palette or 32-bit RGBA, as SDL_image gives them.
+
+typedef struct
+{
+	int width;
+	int height;
+	BOOLEAN paletted;
+	BYTE *pixels;
+	png_color_16 transparent;
+} TestCanvas;
+
+static char canvasError[64];
+
+static BYTE *
+readFile (uio_DirHandle *dir, const char *fileName, size_t *size)
+{
+	uio_Stream *fp;
+	BYTE *data;
+	long length;
+
+	fp = uio_fopen (dir, fileName, "rb");
+	if (!fp)
+		return NULL;
+	uio_fseek (fp, 0, SEEK_END);
+	length = uio_ftell (fp);
+	uio_fseek (fp, 0, SEEK_SET);
+	data = HMalloc (length > 0 ? (size_t) length : 1);
+	if (length > 0 && uio_fread (data, (size_t) length, 1, fp) != 1)
+	{
+		HFree (data);
+		data = NULL;
+	}
+	uio_fclose (fp);
+	*size = (size_t) length;
+	return data;
+}
+
+TFB_Canvas
+TFB_DrawCanvas_LoadFromFile (void *dir, const char *fileName)
+{
+	png_image image;
+	TestCanvas *canvas;
+	BYTE *data;
+	size_t size;
+	BYTE colormap[256 * 4];
+
+	data = readFile (dir, fileName, &size);
+	if (!data)
+	{
+		snprintf (canvasError, sizeof canvasError, "could not read %s",
+				fileName);
+		return NULL;
+	}
+
+	memset (&image, 0, sizeof image);
+	image.version = PNG_IMAGE_VERSION;
+	if (!png_image_begin_read_from_memory (&image, data, size))
+	{
+		strcpy (canvasError, image.message);
+		HFree (data);
+		return NULL;
+	}
+
+	canvas = HCalloc (sizeof *canvas);
+	canvas->width = (int) image.width;
+	canvas->height = (int) image.height;
+	canvas->paletted = (image.format & PNG_FORMAT_FLAG_COLORMAP) != 0;
+	if (canvas->paletted)
+		image.format = PNG_FORMAT_RGBA_COLORMAP;
+	else
+		image.format = PNG_FORMAT_RGBA;
+	canvas->pixels = HMalloc (PNG_IMAGE_SIZE (image));
+	if (!png_image_finish_read (&image, NULL, canvas->pixels, 0,
+			canvas->paletted ? colormap : NULL))
+	{
+		strcpy (canvasError, image.message);
+		HFree (canvas->pixels);
+		HFree (canvas);
+		canvas = NULL;
+	}
+
+	HFree (data);
+	return canvas;
+}
+
+const char *
+TFB_DrawCanvas_GetError (void)
+{
+	return canvasError;
+}
+
+BOOLEAN
+TFB_DrawCanvas_IsPaletted (TFB_Canvas canvas)
+{
+	return ((TestCanvas *) canvas)->paletted;
+}
+
+void
+TFB_DrawCanvas_SetTransparentIndex (TFB_Canvas canvas, int i,
+		BOOLEAN rleaccel)
+{
+	((TestCanvas *) canvas)->transparent.index = (png_byte) i;
+	(void) rleaccel;
+}
+
+void
+TFB_DrawCanvas_SetTransparentColor (TFB_Canvas canvas, Color color,
+		BOOLEAN rleaccel)
+{
+	TestCanvas *c = canvas;
+
+	c->transparent.red = color.r;
+	c->transparent.green = color.g;
+	c->transparent.blue = color.b;
+	(void) rleaccel;
+}
+
+void
+TFB_DrawCanvas_GetExtent (TFB_Canvas canvas, EXTENT *size)
+{
+	size->width = ((TestCanvas *) canvas)->width;
+	size->height = ((TestCanvas *) canvas)->height;
+}
+
+void
+TFB_DrawCanvas_Delete (TFB_Canvas canvas)
+{
+	if (!canvas)
+		return;
+	HFree (((TestCanvas *) canvas)->pixels);
+	HFree (canvas);
+}
+
+BOOLEAN
+TFB_DrawCanvas_GetFontCharData (TFB_Canvas canvas, BYTE *outData,
+		unsigned dataPitch)
+{
+	(void) canvas;
+	(void) outData;
+	(void) dataPitch;
+	return FALSE;
+}
+
+TFB_Image *
+TFB_DrawImage_New (TFB_Canvas canvas)
+{
+	TFB_Image *img = HCalloc (sizeof (TFB_Image));
+
+	img->NormalImg = canvas;
+	img->colormap_index = -1;
+	TFB_DrawCanvas_GetExtent (canvas, &img->extent);
+	return img;
+}
+
+// The game has the graphics thread delete images; here it is done
+// right away.
+void
+TFB_DrawScreen_DeleteImage (TFB_Image *img)
+{
+	TFB_DrawCanvas_Delete (img->NormalImg);
+	HFree (img);
+}
+
+void
+TFB_DrawScreen_DeleteData (void *data)
+{
+	HFree (data);
+}
+
+// The sound library: a sound bank is a string table of the files it
+// lists, and a ditty the file itself, read whole.
+
+typedef struct
+{
+	size_t size;
+	BYTE *data;
+} TestSound;
+
+static void *
+getSoundBankData (uio_Stream *fp, DWORD length)
+{
+	char line[1024], fileName[1024];
+	TestSound sounds[256];
+	const char *slash;
+	STRING_TABLE table;
+	int count = 0;
+	size_t dirLength = 0;
+	int i;
+
+	(void) length;
+	slash = strrchr (_cur_resfile_name, '/');
+	if (slash)
+	{
+		dirLength = slash - _cur_resfile_name + 1;
+		memcpy (fileName, _cur_resfile_name, dirLength);
+	}
+	while (uio_fgets (line, sizeof line, fp) && count < 256)
+	{
+		if (sscanf (line, "%s", &fileName[dirLength]) != 1)
+			continue;
+		sounds[count].data = readFile (contentDir, fileName,
+				&sounds[count].size);
+		if (!sounds[count].data)
+		{
+			log_add (log_Warning, "Could not read %s", fileName);
+			continue;
+		}
+		++count;
+	}
+	if (count == 0)
+		return NULL;
+
+	table = AllocStringTable (count, 0);
+	for (i = 0; i < count; ++i)
+	{
+		TestSound *sound = HMalloc (sizeof *sound);
+
+		*sound = sounds[i];
+		table->strings[i].data = (STRINGPTR) sound;
+		table->strings[i].length = sizeof *sound;
+	}
+	return table;
+}
+
+static BOOLEAN
+releaseSoundBankData (void *data)
+{
+	STRING_TABLE table = data;
+	COUNT i;
+
+	if (!table)
+		return FALSE;
+	for (i = 0; i < table->size; ++i)
+		HFree (((TestSound *) table->strings[i].data)->data);
+	FreeStringTable (table);
+	return TRUE;
+}
+
+static void
+getSoundBankFileData (const char *pathname, RESOURCE_DATA *resdata)
+{
+	resdata->ptr = LoadResourceFromPath (pathname, getSoundBankData);
+}
+
+static void *
+getMusicData (uio_Stream *fp, DWORD length)
+{
+	TestSound *music = HMalloc (sizeof *music);
+
+	music->size = length;
+	music->data = HMalloc (length > 0 ? length : 1);
+	if (length > 0 && uio_fread (music->data, length, 1, fp) != 1)
+	{
+		HFree (music->data);
+		HFree (music);
+		return NULL;
+	}
+	return music;
+}
+
+static BOOLEAN
+releaseMusicData (void *data)
+{
+	TestSound *music = data;
+
+	if (!music)
+		return FALSE;
+	HFree (music->data);
+	HFree (music);
+	return TRUE;
+}
+
+static void
+getMusicFileData (const char *pathname, RESOURCE_DATA *resdata)
+{
+	resdata->ptr = LoadResourceFromPath (pathname, getMusicData);
+}
+
+BOOLEAN
+InstallAudioResTypes (void)
+{
+	InstallResTypeVectors ("SNDRES", getSoundBankFileData,
+			releaseSoundBankData, NULL);
+	InstallResTypeVectors ("MUSICRES", getMusicFileData, releaseMusicData,
+			NULL);
+	return TRUE;
+}
+
+SOUND_REF
+LoadSoundInstance (RESOURCE res)
+{
+	void *hData;
+
+	hData = res_GetResource (res);
+	if (hData)
+		res_DetachResource (res);
+	return (SOUND_REF) hData;
+}
+
+MUSIC_REF
+LoadMusicInstance (RESOURCE res)
+{
+	void *hData;
+
+	hData = res_GetResource (res);
+	if (hData)
+		res_DetachResource (res);
+	return (MUSIC_REF) hData;
+}
+
+BOOLEAN
+DestroySound (SOUND_REF SoundRef)
+{
+	return releaseSoundBankData (SoundRef);
+}
+
+BOOLEAN
+DestroyMusic (MUSIC_REF MusicRef)
+{
+	return releaseMusicData (MusicRef);
+}
+
+BOOLEAN
+InstallVideoResType (void)
+{
+	return TRUE;
+}
+
+// The test.
+
+static BOOLEAN ok = TRUE;
+
+static void
+fail (const char *fmt, ...)
+{
+	va_list args;
+
+	va_start (args, fmt);
+	vfprintf (stderr, fmt, args);
+	va_end (args);
+	fputc ('\n', stderr);
+	ok = FALSE;
+}
+
+static uint64
+now (void)
+{
+	return GetPerfCounter ();
+}
+
+static int
+compareTimes (const void *a, const void *b)
+{
+	uint64 t1 = *(const uint64 *) a;
+	uint64 t2 = *(const uint64 *) b;
+
+	return (t1 > t2) - (t1 < t2);
+}
+
+static double
+medianMs (uint64 *times, int count)
+{
+	qsort (times, count, sizeof times[0], compareTimes);
+	return (double) times[count / 2] / 1000000.0;
+}
+
+// The probe has no battle data; the game only loads its icons.
+#define NUM_BATTLE_SHIPS UR_QUAN_PROBE_ID
+
+// For each ship, the first ship whose battle data is the same; the cache
+// keeps one copy for both.
+static SPECIES_ID mediaOwner[NUM_BATTLE_SHIPS];
+static DWORD mediaSize[NUM_BATTLE_SHIPS];
+
+static void
+findMediaOwners (void)
+{
+	RACE_DESC *ships[NUM_BATTLE_SHIPS];
+	SPECIES_ID i, j;
+
+	for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+	{
+		ships[i] = load_ship (i, FALSE);
+		if (!ships[i])
+		{
+			fail ("%d: load_ship() without battle data failed", (int) i);
+			exit (EXIT_FAILURE);
+		}
+		mediaOwner[i] = i;
+		for (j = ARILOU_ID; j < i; ++j)
+		{
+			if (sameResources (&ships[j]->ship_data, &ships[i]->ship_data))
+			{
+				mediaOwner[i] = mediaOwner[j];
+				break;
+			}
+		}
+	}
+	for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+		free_ship (ships[i], TRUE, FALSE);
+}
+
+static BOOLEAN
+lastLoadWas (const char *how)
+{
+	return strstr (lastLoadLog, how) != NULL;
+}
+
+// Loads each ship with its battle data not in the cache, and again right
+// after freeing it, and prints the median of each.
+static void
+timeLoads (int rounds)
+{
+	static uint64 coldTimes[NUM_BATTLE_SHIPS][MAX_ROUNDS];
+	static uint64 cachedTimes[NUM_BATTLE_SHIPS][MAX_ROUNDS];
+	double coldTotal = 0.0;
+	double cachedTotal = 0.0;
+	DWORD totalSize = 0;
+	SPECIES_ID i;
+	int round;
+
+	for (round = 0; round < rounds; ++round)
+	{
+		for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+		{
+			RACE_DESC *ship;
+			SHIP_MEDIA *media;
+			FRAME frame;
+			uint64 start;
+
+			FreeShipMediaCache ();
+			if (media_cache)
+				fail ("%d: the cache is not empty", (int) i);
+
+			start = now ();
+			ship = load_ship (i, TRUE);
+			coldTimes[i][round] = now () - start;
+			if (!ship || !ship->MediaRef)
+			{
+				fail ("%d: load_ship() failed", (int) i);
+				continue;
+			}
+			if (!lastLoadWas ("loaded"))
+				fail ("%d: no debug message for the load", (int) i);
+			media = ship->MediaRef;
+			frame = ship->ship_data.ship[0];
+			mediaSize[i] = media->size;
+			free_ship (ship, TRUE, TRUE);
+			if (media_cache != media || media->refCount != 0)
+				fail ("%d: the battle data is not kept", (int) i);
+
+			start = now ();
+			ship = load_ship (i, TRUE);
+			cachedTimes[i][round] = now () - start;
+			if (!ship || ship->MediaRef != media
+					|| ship->ship_data.ship[0] != frame)
+				fail ("%d: the battle data is loaded again", (int) i);
+			if (!lastLoadWas ("found in the cache"))
+				fail ("%d: no debug message for the cache", (int) i);
+			if (ship)
+				free_ship (ship, TRUE, TRUE);
+		}
+	}
+
+	printf ("Median load_ship() times in ms, not cached and cached, and "
+			"the size of the battle data:\n");
+	for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+	{
+		double cold = medianMs (coldTimes[i], rounds);
+		double cached = medianMs (cachedTimes[i], rounds);
+
+		printf ("  %2d %8.3f %8.3f %9lu\n", (int) i, cold, cached,
+				(unsigned long) mediaSize[i]);
+		coldTotal += cold;
+		cachedTotal += cached;
+		if (mediaOwner[i] == i)
+			totalSize += mediaSize[i];
+	}
+	printf ("All ships: %.2f ms not cached, %.2f ms cached; battle data "
+			"%lu bytes\n", coldTotal, cachedTotal,
+			(unsigned long) totalSize);
+}
+
+// A model of the cache: what it holds, most recently loaded first.
+typedef struct
+{
+	SPECIES_ID owner;
+	SHIP_MEDIA *media;
+	COUNT refCount;
+	DWORD size;
+} ModelEntry;
+
+static ModelEntry model[NUM_BATTLE_SHIPS];
+static int modelCount;
+static DWORD modelSize;
+static int modelEvictions;
+
+static void
+modelReset (void)
+{
+	FreeShipMediaCache ();
+	modelCount = 0;
+	modelSize = 0;
+	modelEvictions = 0;
+}
+
+static void
+modelTrim (void)
+{
+	while (modelSize > SHIP_MEDIA_CACHE_SIZE)
+	{
+		int i = modelCount;
+
+		while (i-- > 0 && model[i].refCount != 0)
+			continue;
+		if (i < 0)
+			break;
+		modelSize -= model[i].size;
+		memmove (&model[i], &model[i + 1],
+				(modelCount - i - 1) * sizeof model[0]);
+		--modelCount;
+		++modelEvictions;
+	}
+}
+
+static void
+modelAcquire (SPECIES_ID species, SHIP_MEDIA *media)
+{
+	SPECIES_ID owner = mediaOwner[species];
+	ModelEntry entry;
+	int i;
+
+	for (i = 0; i < modelCount && model[i].owner != owner; ++i)
+		continue;
+	if (i < modelCount)
+	{
+		entry = model[i];
+		memmove (&model[1], &model[0], i * sizeof model[0]);
+		if (entry.media != media)
+			fail ("Model: %d was not found in the cache", (int) species);
+	}
+	else
+	{
+		entry.owner = owner;
+		entry.media = media;
+		entry.refCount = 0;
+		entry.size = mediaSize[owner];
+		memmove (&model[1], &model[0], modelCount * sizeof model[0]);
+		++modelCount;
+		modelSize += entry.size;
+	}
+	++entry.refCount;
+	model[0] = entry;
+	modelTrim ();
+}
+
+static void
+modelRelease (SPECIES_ID species)
+{
+	SPECIES_ID owner = mediaOwner[species];
+	int i;
+
+	for (i = 0; i < modelCount && model[i].owner != owner; ++i)
+		continue;
+	if (i == modelCount)
+	{
+		fail ("Model: released %d, which it does not hold", (int) species);
+		return;
+	}
+	--model[i].refCount;
+	modelTrim ();
+}
+
+static BOOLEAN
+sameAsModel (void)
+{
+	SHIP_MEDIA *media = media_cache;
+	int i;
+
+	for (i = 0; i < modelCount; ++i, media = media->next)
+	{
+		if (!media || media != model[i].media
+				|| media->refCount != model[i].refCount
+				|| media->size != model[i].size)
+			return FALSE;
+	}
+	return media == NULL && media_cache_size == modelSize;
+}
+
+// Two ships of a kind in battle at the same time share their data.
+static void
+checkSharing (void)
+{
+	RACE_DESC *first, *second;
+	SHIP_MEDIA *media;
+
+	modelReset ();
+	first = load_ship (SPATHI_ID, TRUE);
+	second = load_ship (SPATHI_ID, TRUE);
+	if (!first || !second)
+	{
+		fail ("Sharing: load_ship() failed");
+		return;
+	}
+	media = first->MediaRef;
+	if (second->MediaRef != media || media->refCount != 2
+			|| second->ship_data.ship[0] != first->ship_data.ship[0]
+			|| second->ship_data.ship_sounds != first->ship_data.ship_sounds)
+		fail ("Sharing: the second ship does not share the data");
+
+	free_ship (first, TRUE, TRUE);
+	if (media_cache != media || media->refCount != 1
+			|| GetFrameCount (second->ship_data.ship[0]) == 0)
+		fail ("Sharing: freeing one ship affects the other");
+	free_ship (second, TRUE, TRUE);
+	if (media_cache != media || media->refCount != 0)
+		fail ("Sharing: the data is not kept after the last ship");
+	FreeShipMediaCache ();
+	if (media_cache || media_cache_size)
+		fail ("Sharing: FreeShipMediaCache() leaves data in the cache");
+}
+
+// Every ship in battle at once, which is more than the cache holds:
+// nothing in use is freed, and as they go the cache is trimmed to its
+// size, the least recently loaded first.
+static void
+checkAllInUse (void)
+{
+	RACE_DESC *ships[NUM_BATTLE_SHIPS];
+	FRAME frames[NUM_BATTLE_SHIPS];
+	SPECIES_ID i;
+
+	modelReset ();
+	for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+	{
+		ships[i] = load_ship (i, TRUE);
+		if (!ships[i])
+		{
+			fail ("All in use: load_ship(%d) failed", (int) i);
+			exit (EXIT_FAILURE);
+		}
+		frames[i] = ships[i]->ship_data.ship[0];
+		modelAcquire (i, ships[i]->MediaRef);
+	}
+	if (media_cache_size <= SHIP_MEDIA_CACHE_SIZE)
+		fail ("All in use: the ships fit in the cache; nothing is checked");
+	if (!sameAsModel ())
+		fail ("All in use: the cache differs from the model");
+	for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+	{
+		if (ships[i]->MediaRef->data.ship[0] != frames[i])
+			fail ("All in use: the data of %d was changed", (int) i);
+	}
+
+	for (i = ARILOU_ID; i < NUM_BATTLE_SHIPS; ++i)
+	{
+		free_ship (ships[i], TRUE, TRUE);
+		modelRelease (i);
+		if (!sameAsModel ())
+			fail ("All in use: the cache differs from the model after "
+					"freeing %d", (int) i);
+	}
+	if (media_cache_size > SHIP_MEDIA_CACHE_SIZE)
+		fail ("All in use: the cache is not trimmed after the battle");
+}
+
+// Random loads and frees of up to MAX_HELD ships at a time, with the
+// cache compared to the model after each one.
+static void
+checkRandomUse (void)
+{
+	RACE_DESC *held[MAX_HELD];
+	SPECIES_ID heldSpecies[MAX_HELD];
+	int numHeld = 0;
+	int step;
+
+	modelReset ();
+	srand (1);
+	for (step = 0; step < NUM_RANDOM_STEPS; ++step)
+	{
+		if (numHeld < MAX_HELD && (numHeld == 0 || rand () % 2 == 0))
+		{
+			SPECIES_ID species = (SPECIES_ID) (ARILOU_ID
+					+ rand () % (NUM_BATTLE_SHIPS - ARILOU_ID));
+			RACE_DESC *ship = load_ship (species, TRUE);
+
+			if (!ship)
+			{
+				fail ("Random use: load_ship(%d) failed", (int) species);
+				break;
+			}
+			held[numHeld] = ship;
+			heldSpecies[numHeld] = species;
+			++numHeld;
+			modelAcquire (species, ship->MediaRef);
+		}
+		else
+		{
+			int which = rand () % numHeld;
+
+			free_ship (held[which], TRUE, TRUE);
+			modelRelease (heldSpecies[which]);
+			--numHeld;
+			held[which] = held[numHeld];
+			heldSpecies[which] = heldSpecies[numHeld];
+		}
+
+		if (!sameAsModel ())
+		{
+			fail ("Random use: the cache differs from the model at step "
+					"%d", step);
+			break;
+		}
+	}
+
+	while (numHeld > 0)
+		free_ship (held[--numHeld], TRUE, TRUE);
+	printf ("Random use: %d loads and frees, of which %d freed data\n",
+			step, modelEvictions);
+	if (modelEvictions == 0)
+		fail ("Random use: nothing was ever freed");
+}
+
+int
+main (int argc, char *argv[])
+{
+	int rounds = 5;
+
+	if (argc < 2)
+	{
+		fprintf (stderr, "Usage: %s <content dir> [number of rounds]\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc > 2)
+		rounds = atoi (argv[2]);
+	if (rounds < 1 || rounds > MAX_ROUNDS)
+		rounds = 5;
+
+	uio_init ();
+	repository = uio_openRepository (0);
+	uio_mountDir (repository, "/", uio_FSTYPE_STDIO, NULL, NULL, argv[1],
+			NULL, uio_MOUNT_TOP | uio_MOUNT_RDONLY, NULL);
+	contentDir = uio_openDir (repository, "/", 0);
+
+	InitResourceSystem ();
+	LoadResourceIndex (contentDir, "uqm.rmp", NULL);
+
+	findMediaOwners ();
+	timeLoads (rounds);
+	checkSharing ();
+	checkAllInUse ();
+	checkRandomUse ();
+	FreeShipMediaCache ();
+
+	UninitResourceSystem ();
+	uio_closeDir (contentDir);
+	uio_closeRepository (repository);
+	uio_unInit ();
+
+	printf ("%s\n", ok ? "OK" : "FAILED");
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,507 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Renders two generated 4-channel MODs with the bundled MikMod
+// (libs/mikmod), as the MOD decoder (libs/sound/decoders/modaud.c) does,
+// each in a context of its own. Checks that rendering one of them gives
+// the same output whether the other is being rendered at the same time,
+// in turns, or not at all. This is done at the normal and at the high
+// quality setting. It prints the CPU time that a second of music takes
+// to render, for one module alone and for both in turns.
+//
+// Usage: modtest [mixing frequency]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "libs/mikmod/mikmod.h"
+
+#define CHUNK_SIZE 4096
+#define NUM_CHUNKS 400
+#define TIMED_SECONDS 60
+
+#define NUM_PATTERNS 4
+#define NUM_ROWS 64
+#define NUM_CHANNELS 4
+#define NUM_SAMPLE_HEADERS 31
+#define WAVE_SIZE 512
+#define MOD_SIZE (20 + NUM_SAMPLE_HEADERS * 30 + 2 + 128 + 4 \
+		+ NUM_PATTERNS * NUM_ROWS * NUM_CHANNELS * 4 + 2 * WAVE_SIZE)
+
+// The output driver of the MOD decoder.
+
+static void *outBuffer;
+static ULONG outSize;
+static ULONG outWritten;
+
+static BOOL
+mmout_IsThere (void)
+{
+	return 1;
+}
+
+static BOOL
+mmout_Init (void)
+{
+	md_mode |= DMODE_SOFT_MUSIC | DMODE_SOFT_SNDFX;
+	return VC_Init ();
+}
+
+static void
+mmout_Exit (void)
+{
+	VC_Exit ();
+}
+
+static void
+mmout_Update (void)
+{
+	outWritten = 0;
+	if (outBuffer != NULL && outSize != 0)
+		outWritten = VC_WriteBytes (outBuffer, outSize);
+}
+
+static BOOL
+mmout_Reset (void)
+{
+	return 0;
+}
+
+static char driverName[] = "Mem Buffer";
+static char driverVersion[] = "Mem Buffer driver v1.1";
+static char driverAlias[] = "membuf";
+
+static MDRIVER mmoutDriver =
+{
+	NULL,
+	driverName,
+	driverVersion,
+	0, 255,
+	driverAlias,
+	NULL,
+	NULL,
+	mmout_IsThere,
+	VC_SampleLoad,
+	VC_SampleUnload,
+	VC_SampleSpace,
+	VC_SampleLength,
+	mmout_Init,
+	mmout_Exit,
+	mmout_Reset,
+	VC_SetNumVoices,
+	VC_PlayStart,
+	VC_PlayStop,
+	mmout_Update,
+	NULL,
+	VC_VoiceSetVolume,
+	VC_VoiceGetVolume,
+	VC_VoiceSetFrequency,
+	VC_VoiceGetFrequency,
+	VC_VoiceSetPanning,
+	VC_VoiceGetPanning,
+	VC_VoicePlay,
+	VC_VoiceStop,
+	VC_VoiceStopped,
+	VC_VoiceGetPosition,
+	VC_VoiceRealVolume
+};
+
+// Reading a module from memory.
+
+typedef struct
+{
+	MREADER core;
+	const UBYTE *data;
+	long size;
+	long pos;
+} MemReader;
+
+static BOOL
+memReader_Eof (MREADER *reader)
+{
+	MemReader *mem = (MemReader *) reader;
+	return mem->pos >= mem->size;
+}
+
+static BOOL
+memReader_Read (MREADER *reader, void *ptr, size_t size)
+{
+	MemReader *mem = (MemReader *) reader;
+
+	if (mem->pos + (long) size > mem->size)
+	{
+		mem->pos = mem->size;
+		return 0;
+	}
+	memcpy (ptr, mem->data + mem->pos, size);
+	mem->pos += (long) size;
+	return 1;
+}
+
+static int
+memReader_Get (MREADER *reader)
+{
+	MemReader *mem = (MemReader *) reader;
+
+	if (mem->pos >= mem->size)
+		return EOF;
+	return mem->data[mem->pos++];
+}
+
+static int
+memReader_Seek (MREADER *reader, long offset, int whence)
+{
+	MemReader *mem = (MemReader *) reader;
+	long pos;
+
+	if (whence == SEEK_SET)
+		pos = offset;
+	else if (whence == SEEK_CUR)
+		pos = mem->pos + offset;
+	else
+		pos = mem->size + offset;
+	if (pos < 0 || pos > mem->size)
+		return -1;
+	mem->pos = pos;
+	return 0;
+}
+
+static long
+memReader_Tell (MREADER *reader)
+{
+	return ((MemReader *) reader)->pos;
+}
+
+// The test modules. Two looped samples, a sine and a sawtooth, played on
+// four channels over four patterns, with a speed command and volume
+// slides; 'seed' and 'speed' make the two modules differ.
+
+static UBYTE *
+putBE16 (UBYTE *p, UWORD value)
+{
+	p[0] = (UBYTE) (value >> 8);
+	p[1] = (UBYTE) value;
+	return p + 2;
+}
+
+static void
+makeMod (UBYTE *out, int seed, int speed)
+{
+	static const UWORD periods[] = {
+		856, 808, 762, 720, 678, 640, 604, 570,
+		538, 508, 480, 453, 428, 404, 381, 360,
+	};
+	UBYTE *p = out;
+	int i;
+	int pattern;
+	int row;
+	int channel;
+
+	memset (out, 0, MOD_SIZE);
+	sprintf ((char *) p, "test%d", seed);
+	p += 20;
+
+	for (i = 0; i < NUM_SAMPLE_HEADERS; i++)
+	{
+		if (i < 2)
+		{
+			memcpy (p, "smp", 3);
+			p += 22;
+			p = putBE16 (p, WAVE_SIZE / 2);
+			*p++ = 0;
+					// Finetune
+			*p++ = 64;
+					// Volume
+			p = putBE16 (p, 0);
+			p = putBE16 (p, WAVE_SIZE / 2);
+		}
+		else
+		{
+			p += 22 + 2 + 1 + 1 + 2;
+			p = putBE16 (p, 1);
+		}
+	}
+
+	*p++ = NUM_PATTERNS;
+	*p++ = 127;
+	for (i = 0; i < 128; i++)
+		*p++ = (UBYTE) (i < NUM_PATTERNS ? i : 0);
+	memcpy (p, "M.K.", 4);
+	p += 4;
+
+	for (pattern = 0; pattern < NUM_PATTERNS; pattern++)
+	{
+		for (row = 0; row < NUM_ROWS; row++)
+		{
+			for (channel = 0; channel < NUM_CHANNELS; channel++)
+			{
+				UWORD period;
+				int sample;
+				int effect = 0;
+
+				if ((row + channel + seed) % (2 + channel) != 0)
+				{
+					p += 4;
+					continue;
+				}
+
+				period = periods[(row * 3 + channel * 5 + pattern + seed)
+						% (sizeof periods / sizeof periods[0])];
+				sample = 1 + (row + channel) % 2;
+				if (row == 0 && channel == 0)
+					effect = (0xf << 8) | speed;
+				else if (channel == 3 && row % 8 == 4)
+					effect = (0xa << 8) | 0x02;
+				*p++ = (UBYTE) ((sample & 0xf0) | (period >> 8));
+				*p++ = (UBYTE) period;
+				*p++ = (UBYTE) (((sample & 0xf) << 4) | (effect >> 8));
+				*p++ = (UBYTE) effect;
+			}
+		}
+	}
+
+	for (i = 0; i < WAVE_SIZE; i++)
+		*p++ = (UBYTE) (int) (100 * sin (2 * M_PI * i / 64 * (1 + seed % 3)));
+	for (i = 0; i < WAVE_SIZE; i++)
+		*p++ = (UBYTE) ((i * 37 + seed * 11) % 200 - 100);
+}
+
+// A module being played, as in the MOD decoder.
+
+typedef struct
+{
+	MikMod_Context *context;
+	MODULE *module;
+} Player;
+
+static UBYTE modData[2][MOD_SIZE];
+
+static BOOL
+openPlayer (Player *player, int modNr)
+{
+	MemReader reader;
+
+	reader.core.Eof = memReader_Eof;
+	reader.core.Read = memReader_Read;
+	reader.core.Get = memReader_Get;
+	reader.core.Seek = memReader_Seek;
+	reader.core.Tell = memReader_Tell;
+	reader.data = modData[modNr];
+	reader.size = MOD_SIZE;
+	reader.pos = 0;
+
+	player->context = MikMod_NewContext ();
+	if (player->context == NULL)
+		return 0;
+	MikMod_SelectContext (player->context);
+	player->module = Player_LoadGeneric (&reader.core, 8, 0);
+	if (player->module == NULL)
+	{
+		printf ("Could not load module %d: %s\n", modNr,
+				MikMod_strerror (MikMod_errno));
+		MikMod_FreeContext (player->context);
+		return 0;
+	}
+	player->module->extspd = 1;
+	player->module->panflag = 1;
+	player->module->wrap = 0;
+	player->module->loop = 1;
+	return 1;
+}
+
+static void
+closePlayer (Player *player)
+{
+	MikMod_SelectContext (player->context);
+	Player_Free (player->module);
+	MikMod_FreeContext (player->context);
+}
+
+static ULONG
+decode (Player *player, void *buf, ULONG size)
+{
+	MikMod_SelectContext (player->context);
+	Player_Start (player->module);
+	if (!Player_Active ())
+		return 0;
+	outBuffer = buf;
+	outSize = size;
+	outWritten = 0;
+	MikMod_Update ();
+	return outWritten;
+}
+
+// Starts the module over, as moda_Seek() does when the mixer loops it.
+static void
+rewindPlayer (Player *player)
+{
+	MikMod_SelectContext (player->context);
+	Player_Start (player->module);
+	Player_SetPosition (0);
+}
+
+// Decodes a chunk, starting over at the end of the module.
+static ULONG
+decodeLooped (Player *player, void *buf, ULONG size)
+{
+	ULONG written = decode (player, buf, size);
+
+	if (written == 0)
+	{
+		rewindPlayer (player);
+		written = decode (player, buf, size);
+	}
+	return written;
+}
+
+static double
+cpuSeconds (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static UBYTE soloOutput[2][NUM_CHUNKS][CHUNK_SIZE];
+static UBYTE mixedOutput[2][NUM_CHUNKS][CHUNK_SIZE];
+
+static int
+runQuality (BOOL high, UWORD frequency)
+{
+	const char *name = high ? "high quality" : "normal quality";
+	static UBYTE buf[CHUNK_SIZE];
+	Player players[2];
+	int failures = 0;
+	int modNr;
+	int i;
+	long bytesPerSecond = (long) frequency * 4;
+	long bytes;
+	double start;
+
+	if (high)
+	{
+		md_mode = DMODE_HQMIXER | DMODE_STEREO | DMODE_16BITS
+				| DMODE_INTERP | DMODE_SURROUND;
+		md_reverb = 1;
+	}
+	else
+	{
+		md_mode = DMODE_SOFT_MUSIC | DMODE_STEREO | DMODE_16BITS
+				| DMODE_INTERP;
+		md_reverb = 0;
+	}
+	md_mixfreq = frequency;
+	md_pansep = 64;
+	if (MikMod_Init (NULL))
+	{
+		printf ("%s: MikMod_Init() failed: %s\n", name,
+				MikMod_strerror (MikMod_errno));
+		return 1;
+	}
+
+	for (modNr = 0; modNr < 2; modNr++)
+	{
+		if (!openPlayer (&players[modNr], modNr))
+			return 1;
+		for (i = 0; i < NUM_CHUNKS; i++)
+			decode (&players[modNr], soloOutput[modNr][i], CHUNK_SIZE);
+		closePlayer (&players[modNr]);
+	}
+
+	if (!openPlayer (&players[0], 0) || !openPlayer (&players[1], 1))
+		return 1;
+	for (i = 0; i < NUM_CHUNKS; i++)
+	{
+		decode (&players[0], mixedOutput[0][i], CHUNK_SIZE);
+		decode (&players[1], mixedOutput[1][i], CHUNK_SIZE);
+	}
+	closePlayer (&players[0]);
+	closePlayer (&players[1]);
+
+	for (modNr = 0; modNr < 2; modNr++)
+	{
+		if (memcmp (soloOutput[modNr], mixedOutput[modNr],
+				sizeof soloOutput[modNr]) != 0)
+		{
+			printf ("%s: module %d sounds different when the other is "
+					"played too\n", name, modNr);
+			failures++;
+		}
+	}
+	if (memcmp (soloOutput[0], soloOutput[1], sizeof soloOutput[0]) == 0)
+	{
+		printf ("%s: the modules sound the same\n", name);
+		failures++;
+	}
+	for (i = 0; i < CHUNK_SIZE && soloOutput[0][NUM_CHUNKS / 2][i] == 0;
+			i++)
+		;
+	if (i == CHUNK_SIZE)
+	{
+		printf ("%s: module 0 is silent\n", name);
+		failures++;
+	}
+
+	openPlayer (&players[0], 0);
+	start = cpuSeconds ();
+	for (bytes = 0; bytes < bytesPerSecond * TIMED_SECONDS; )
+		bytes += decodeLooped (&players[0], buf, CHUNK_SIZE);
+	printf ("%s, %u Hz: %.2f ms of CPU per second of music", name,
+			frequency, (cpuSeconds () - start) * 1000 / TIMED_SECONDS);
+
+	openPlayer (&players[1], 1);
+	start = cpuSeconds ();
+	for (bytes = 0; bytes < bytesPerSecond * TIMED_SECONDS; )
+	{
+		bytes += decodeLooped (&players[0], buf, CHUNK_SIZE);
+		decodeLooped (&players[1], buf, CHUNK_SIZE);
+	}
+	printf ("; %.2f ms for both modules in turns\n",
+			(cpuSeconds () - start) * 1000 / TIMED_SECONDS);
+	closePlayer (&players[0]);
+	closePlayer (&players[1]);
+
+	MikMod_Exit ();
+	return failures;
+}
+
+int
+main (int argc, char *argv[])
+{
+	int frequency = argc > 1 ? atoi (argv[1]) : 44100;
+	int failures = 0;
+
+	if (frequency < 8000 || frequency > 0xffff)
+	{
+		fprintf (stderr, "Usage: %s [mixing frequency]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	makeMod (modData[0], 1, 6);
+	makeMod (modData[1], 2, 4);
+	MikMod_RegisterDriver (&mmoutDriver);
+	MikMod_RegisterLoader (&load_mod);
+
+	failures += runQuality (0, (UWORD) frequency);
+	failures += runQuality (1, (UWORD) frequency);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,287 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Loads every conversation of the base content, both by parsing the text
+// and from a compiled string table (see libs/strings/strcache.c), checks
+// that both give the same table, and reports how long each takes.
+// It also checks that a damaged compiled table is replaced.
+//
+// Usage: strcachetest <content dir> <empty cache dir>
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "libs/strings/strintrn.h"
+#include "libs/uio.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+#include "libs/timelib.h"
+
+#define NUM_RUNS 25
+
+uio_Repository *repository;
+uio_DirHandle *contentDir;
+
+static const char *conversations[] =
+{
+	"arilou", "chmmr", "commander", "druuge", "ilwrath", "kohrah",
+	"melnorme", "mycon", "orz", "pkunk", "probe", "safeones", "shofixti",
+	"slylandro", "spathi", "starbase", "supox", "syreen", "talkingpet",
+	"thraddash", "umgah", "urquan", "utwig", "vux", "yehat",
+	"yehatrebels", "zoqfotpik",
+};
+#define NUM_CONVERSATIONS \
+		(sizeof conversations / sizeof conversations[0])
+
+static int numWarnings;
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	if (level <= log_Warning)
+	{
+		va_list args;
+
+		va_start (args, fmt);
+		vfprintf (stderr, fmt, args);
+		va_end (args);
+		fputc ('\n', stderr);
+		numWarnings++;
+	}
+}
+
+uint64
+GetPerfCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return 1000000000;
+}
+
+// Only needed by loaders that are not used here.
+BOOLEAN
+FreeResourceData (void *data)
+{
+	HFree (data);
+	return TRUE;
+}
+
+static int
+compareDouble (const void *a, const void *b)
+{
+	double da = *(const double *) a;
+	double db = *(const double *) b;
+	return (da > db) - (da < db);
+}
+
+// Median time in microseconds of loading the conversation.
+static double
+timeLoad (const char *path, STRING_TABLE *result)
+{
+	double times[NUM_RUNS];
+	int runI;
+
+	for (runI = 0; runI < NUM_RUNS; runI++)
+	{
+		RESOURCE_DATA resdata;
+		uint64 start = GetPerfCounter ();
+
+		_GetConversationData (path, &resdata);
+		times[runI] = (double) (GetPerfCounter () - start) / 1000.0;
+		if (runI == NUM_RUNS - 1)
+			*result = resdata.ptr;
+		else
+			FreeStringTable (resdata.ptr);
+	}
+	qsort (times, NUM_RUNS, sizeof times[0], compareDouble);
+	return times[NUM_RUNS / 2];
+}
+
+static BOOLEAN
+sameTable (STRING_TABLE a, STRING_TABLE b)
+{
+	int numEntries;
+	int i;
+
+	if (a == NULL || b == NULL || a->size != b->size
+			|| a->flags != b->flags)
+		return FALSE;
+	numEntries = a->size * _GetStringTableMultiplier (a->flags);
+	for (i = 0; i < numEntries; i++)
+	{
+		if (a->strings[i].length != b->strings[i].length)
+			return FALSE;
+		if (a->strings[i].length != 0 && memcmp (a->strings[i].data,
+				b->strings[i].data, a->strings[i].length) != 0)
+			return FALSE;
+	}
+	// The name index gives the entry with the name.
+	for (i = 0; i < a->size; i++)
+	{
+		STRINGPTR name = a->strings[a->size + i].data;
+		if (name != NULL && GetStringByName (b, name)
+				!= &b->strings[b->size + i])
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static BOOLEAN
+cacheFileLoads (const char *path)
+{
+	RESOURCE_DATA resdata;
+	int warningsBefore = numWarnings;
+
+	_GetConversationData (path, &resdata);
+	if (resdata.ptr == NULL)
+		return FALSE;
+	FreeStringTable (resdata.ptr);
+	return numWarnings == warningsBefore;
+}
+
+int
+main (int argc, char *argv[])
+{
+	uio_DirHandle *cacheDir;
+	char path[256];
+	char cacheFile[1024];
+	double totalParse = 0.0;
+	double totalCompiled = 0.0;
+	int failures = 0;
+	size_t convI;
+
+	if (argc != 3)
+	{
+		fprintf (stderr, "Usage: %s <content dir> <empty cache dir>\n",
+				argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	uio_init ();
+	repository = uio_openRepository (0);
+	uio_mountDir (repository, "/", uio_FSTYPE_STDIO, NULL, NULL, argv[1],
+			NULL, uio_MOUNT_TOP | uio_MOUNT_RDONLY, NULL);
+	uio_mountDir (repository, "/cache", uio_FSTYPE_STDIO, NULL, NULL,
+			argv[2], NULL, uio_MOUNT_TOP, NULL);
+	contentDir = uio_openDir (repository, "/", 0);
+	cacheDir = uio_openDir (repository, "/cache", 0);
+	if (contentDir == NULL || cacheDir == NULL)
+	{
+		fprintf (stderr, "Could not open the directories.\n");
+		return EXIT_FAILURE;
+	}
+
+	printf ("%-12s %8s %8s %8s\n", "conversation", "parse_us",
+			"cache_us", "speedup");
+	for (convI = 0; convI < NUM_CONVERSATIONS; convI++)
+	{
+		STRING_TABLE parsed;
+		STRING_TABLE compiled;
+		double parseUs;
+		double compiledUs;
+
+		snprintf (path, sizeof path, "base/comm/%s/%s.txt",
+				conversations[convI], conversations[convI]);
+
+		SetStringTableCacheDir (NULL);
+		parseUs = timeLoad (path, &parsed);
+
+		// The first load with a cache dir parses the text and stores
+		// the compiled table; the timed ones load it.
+		// Takes over the handle.
+		SetStringTableCacheDir (uio_openDir (repository, "/cache", 0));
+		if (!cacheFileLoads (path))
+			failures++;
+		compiledUs = timeLoad (path, &compiled);
+
+		if (compiled == NULL || compiled->blob == NULL
+				|| !sameTable (parsed, compiled))
+		{
+			printf ("%s: the compiled table differs\n", path);
+			failures++;
+		}
+		FreeStringTable (parsed);
+		FreeStringTable (compiled);
+
+		printf ("%-12s %8.1f %8.1f %7.1fx\n", conversations[convI],
+				parseUs, compiledUs, parseUs / compiledUs);
+		totalParse += parseUs;
+		totalCompiled += compiledUs;
+	}
+	printf ("%-12s %8.1f %8.1f %7.1fx\n", "total", totalParse,
+			totalCompiled, totalParse / totalCompiled);
+
+	// Cut one compiled table short. The next load must reject it and
+	// put a good one in its place, which the load after that uses
+	// without complaint.
+	{
+		uio_DirList *list;
+
+		list = uio_getDirList (cacheDir, "", ".strtab", match_MATCH_SUFFIX);
+		if (list == NULL || list->numNames != NUM_CONVERSATIONS)
+		{
+			printf ("expected %d compiled tables\n",
+					(int) NUM_CONVERSATIONS);
+			failures++;
+		}
+		if (list != NULL && list->numNames > 0)
+		{
+			snprintf (cacheFile, sizeof cacheFile, "%s/%s", argv[2],
+					list->names[0]);
+			if (truncate (cacheFile, 100) != 0)
+				failures++;
+		}
+		if (list != NULL)
+			uio_DirList_free (list);
+
+		for (convI = 0; convI < NUM_CONVERSATIONS; convI++)
+		{
+			snprintf (path, sizeof path, "base/comm/%s/%s.txt",
+					conversations[convI], conversations[convI]);
+			cacheFileLoads (path);
+		}
+		for (convI = 0; convI < NUM_CONVERSATIONS; convI++)
+		{
+			snprintf (path, sizeof path, "base/comm/%s/%s.txt",
+					conversations[convI], conversations[convI]);
+			if (!cacheFileLoads (path))
+			{
+				printf ("%s: the damaged table was not replaced\n", path);
+				failures++;
+			}
+		}
+	}
+
+	SetStringTableCacheDir (NULL);
+	uio_closeDir (cacheDir);
+	uio_closeDir (contentDir);
+	uio_closeRepository (repository);
+	uio_unInit ();
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
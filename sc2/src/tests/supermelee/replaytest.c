@@ -0,0 +1,677 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Records a match with uqm/supermelee/replay.c and plays it back, with a
+// toy simulation in place of the battle code: its state depends on the
+// input of both players and on the game's random number generator, which
+// the computer players also draw from. Checks that playback gives the
+// same state on every frame, also when starting at a keyframe with
+// seeking, and when the recording is received in pieces as a spectator
+// does. Checks that a damaged keyframe and a cut off recording stop the
+// playback at the right frame.
+//
+// It prints how many frames per second the replay code and the toy
+// simulation play back together, and the same without the replay code.
+// The battle code itself is not run, so this is not how fast a real
+// match plays back; the game logs that at the end of each playback.
+//
+// Usage: replaytest <directory for the recording> [repetitions]
+// See tests/README for how to build it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include "uqm/supermelee/replay.h"
+#include "uqm/supermelee/melee.h"
+#include "uqm/globdata.h"
+#include "uqm/intel.h"
+#include "libs/log.h"
+#include "libs/mathlib.h"
+
+#define NUM_BATTLES 3
+#define MIN_BATTLE_FRAMES 5000
+#define MAX_FRAMES 100000
+#define SEEK_FRAME 5000
+#define BAD_KEYFRAME (10 * REPLAY_KEYFRAME_INTERVAL)
+#define LIVE_CHUNK_SIZE 37
+
+// What the rest of the game would provide.
+
+GLOBDATA GlobData;
+BYTE PlayerControl[NUM_PLAYERS];
+UWORD nth_frame;
+
+static MeleeShip fleets[NUM_PLAYERS][MELEE_FLEET_SIZE];
+static char teamNames[NUM_PLAYERS][MAX_TEAM_CHARS + 1];
+static char lastWarning[256];
+static int numWarnings;
+
+bool
+MeleeSetup_setShip (MeleeSetup *setup, size_t teamNr, FleetShipIndex slotNr,
+		MeleeShip ship)
+{
+	(void) setup;
+	fleets[teamNr][slotNr] = ship;
+	return true;
+}
+
+MeleeShip
+MeleeSetup_getShip (const MeleeSetup *setup, size_t teamNr,
+		FleetShipIndex slotNr)
+{
+	(void) setup;
+	return fleets[teamNr][slotNr];
+}
+
+bool
+MeleeSetup_setTeamName (MeleeSetup *setup, size_t teamNr, const char *name)
+{
+	(void) setup;
+	strncpy (teamNames[teamNr], name, MAX_TEAM_CHARS);
+	teamNames[teamNr][MAX_TEAM_CHARS] = '\0';
+	return true;
+}
+
+const char *
+MeleeSetup_getTeamName (const MeleeSetup *setup, size_t teamNr)
+{
+	(void) setup;
+	return teamNames[teamNr];
+}
+
+uint64
+GetPerfCounter (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (uint64) ts.tv_sec * 1000000000ULL + (uint64) ts.tv_nsec;
+}
+
+uint64
+GetPerfFrequency (void)
+{
+	return 1000000000ULL;
+}
+
+void
+log_add (log_Level level, const char *fmt, ...)
+{
+	va_list args;
+
+	if (level > log_Warning)
+		return;
+
+	va_start (args, fmt);
+	vsnprintf (lastWarning, sizeof lastWarning, fmt, args);
+	va_end (args);
+	numWarnings++;
+}
+
+// The toy simulation.
+
+typedef enum
+{
+	MODE_RECORD,
+	MODE_PLAY,
+	MODE_BARE,
+			// Run the recorded input again without the replay code.
+} RunMode;
+
+typedef struct
+{
+	int frames;
+			// Frames simulated.
+	int mismatch;
+			// The first frame at which the state differed from the
+			// recording, or -1.
+	int seekEnd;
+			// The first frame drawn after seeking, or -1.
+	BOOLEAN aborted;
+} RunResult;
+
+static DWORD trace[MAX_FRAMES];
+static BATTLE_INPUT_STATE traceInput[MAX_FRAMES][NUM_PLAYERS];
+static int battleFrames[NUM_BATTLES];
+static DWORD inputRandom;
+
+static DWORD
+nextInputRandom (void)
+{
+	inputRandom = inputRandom * 1103515245 + 12345;
+	return inputRandom >> 16;
+}
+
+// Input that is held for a while, as that of a player is.
+static void
+makeInput (BATTLE_INPUT_STATE *inputs)
+{
+	static BATTLE_INPUT_STATE held[NUM_PLAYERS];
+	static int left[NUM_PLAYERS];
+	COUNT playerI;
+
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+	{
+		if (left[playerI] == 0)
+		{
+			held[playerI] = (BATTLE_INPUT_STATE) (nextInputRandom () & 0x1f);
+			left[playerI] = 1 + (int) (nextInputRandom () %
+					(playerI == 0 ? 40 : 10));
+		}
+		left[playerI]--;
+		inputs[playerI] = held[playerI];
+	}
+}
+
+static COUNT
+shipChoice (int battle, COUNT playerNr)
+{
+	// (COUNT) ~0 is a random choice.
+	return battle == 1 ? (COUNT) ~0 : (COUNT) (playerNr + battle);
+}
+
+static RunResult
+runMatch (RunMode mode)
+{
+	RunResult result;
+	DWORD state = 0;
+	int frame = 0;
+	int battle;
+
+	result.frames = 0;
+	result.mismatch = -1;
+	result.seekEnd = -1;
+	result.aborted = FALSE;
+
+	GLOBAL (CurrentActivity) = SUPER_MELEE;
+	if (mode == MODE_BARE)
+		TFB_SeedRandom (12345);
+	else
+		Replay_matchStart (NULL);
+
+	for (battle = 0; battle < NUM_BATTLES; battle++)
+	{
+		int battleFrame;
+		COUNT playerI;
+
+		for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+		{
+			COUNT choice;
+
+			if (mode == MODE_RECORD)
+				Replay_shipSelected (playerI, shipChoice (battle, playerI));
+			else if (mode == MODE_PLAY)
+			{
+				if (Replay_getShipSelection (playerI, &choice)
+						!= REPLAY_SELECT_DONE)
+				{
+					result.aborted = TRUE;
+					goto done;
+				}
+				if (choice != shipChoice (battle, playerI) &&
+						result.mismatch < 0)
+					result.mismatch = frame;
+			}
+		}
+
+		for (battleFrame = 0; frame < MAX_FRAMES; battleFrame++, frame++)
+		{
+			BATTLE_INPUT_STATE inputs[NUM_PLAYERS];
+
+			if (mode != MODE_BARE)
+			{
+				Replay_frameStart ();
+				if (GLOBAL (CurrentActivity) & CHECK_ABORT)
+				{
+					result.aborted = TRUE;
+					goto done;
+				}
+			}
+			if (mode == MODE_PLAY && result.seekEnd < 0 &&
+					nth_frame != MAKE_WORD (1, REPLAY_SPEED_MAX))
+				result.seekEnd = frame;
+
+			if (mode == MODE_RECORD)
+			{
+				makeInput (inputs);
+				memcpy (traceInput[frame], inputs, sizeof inputs);
+			}
+			else if (mode == MODE_PLAY)
+			{
+				for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+					inputs[playerI] = Replay_getInput (playerI);
+			}
+			else
+				memcpy (inputs, traceInput[frame], sizeof inputs);
+
+			// The "AI" of the second player thinks.
+			(void) TFB_Random ();
+			state = state * 31 + inputs[0] * 7 + inputs[1] + TFB_Random ();
+
+			if (mode != MODE_BARE)
+				Replay_frameEnd (inputs);
+
+			if (mode == MODE_RECORD)
+				trace[frame] = state;
+			else if (trace[frame] != state && result.mismatch < 0)
+				result.mismatch = frame;
+
+			if (mode == MODE_RECORD)
+			{
+				if (battleFrame >= MIN_BATTLE_FRAMES &&
+						nextInputRandom () % 50 == 0)
+				{
+					battleFrames[battle] = battleFrame + 1;
+					Replay_battleEnd ();
+					frame++;
+					break;
+				}
+			}
+			else if (mode == MODE_PLAY)
+			{
+				if (battleFrame >= MIN_BATTLE_FRAMES &&
+						Replay_battleEndReady ())
+				{
+					frame++;
+					break;
+				}
+			}
+			else if (battleFrame + 1 == battleFrames[battle])
+			{
+				frame++;
+				break;
+			}
+		}
+	}
+
+done:
+	result.frames = frame;
+	if (mode != MODE_BARE)
+		Replay_matchEnd ();
+	return result;
+}
+
+// Recordings in memory.
+
+static BYTE *
+readFile (const char *path, size_t *size)
+{
+	FILE *file = fopen (path, "rb");
+	BYTE *data;
+	long len;
+
+	if (file == NULL)
+		return NULL;
+	fseek (file, 0, SEEK_END);
+	len = ftell (file);
+	fseek (file, 0, SEEK_SET);
+	data = malloc (len);
+	if (data != NULL && fread (data, len, 1, file) != 1)
+	{
+		free (data);
+		data = NULL;
+	}
+	fclose (file);
+	*size = (size_t) len;
+	return data;
+}
+
+static BOOLEAN
+writeFile (const char *path, const BYTE *data, size_t size)
+{
+	FILE *file = fopen (path, "wb");
+	BOOLEAN ok;
+
+	if (file == NULL)
+		return FALSE;
+	ok = fwrite (data, size, 1, file) == 1;
+	return fclose (file) == 0 && ok;
+}
+
+// The size of the header of a recording: magic, version, number of
+// players, seed, controls, fleets and team names.
+static size_t
+headerSize (const BYTE *data)
+{
+	size_t pos = REPLAY_MAGIC_SIZE + 8 + NUM_PLAYERS * (1 + MELEE_FLEET_SIZE);
+	COUNT playerI;
+
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+		pos += 1 + data[pos];
+	return pos;
+}
+
+static size_t
+eventSize (BYTE type)
+{
+	switch (type)
+	{
+		case 'k':
+			return 1 + 4 + 4;
+		case 'i':
+			return 1 + NUM_PLAYERS + 2;
+		case 's':
+			return 1 + 1 + 2;
+		default:
+			return 1;
+	}
+}
+
+// Returns the position of the keyframe for 'frame', or 0.
+static size_t
+findKeyframe (const BYTE *data, size_t size, DWORD frame)
+{
+	size_t pos;
+
+	for (pos = headerSize (data); pos < size; pos += eventSize (data[pos]))
+	{
+		if (data[pos] == 'k' && data[pos + 1] == (BYTE) frame &&
+				data[pos + 2] == (BYTE) (frame >> 8) &&
+				data[pos + 3] == (BYTE) (frame >> 16) &&
+				data[pos + 4] == (BYTE) (frame >> 24))
+			return pos;
+	}
+	return 0;
+}
+
+// Copies the recording without its keyframes, as a spectator receives
+// it. Returns the new size.
+static size_t
+stripKeyframes (BYTE *dest, const BYTE *data, size_t size)
+{
+	size_t pos = headerSize (data);
+	size_t destSize = pos;
+
+	memcpy (dest, data, pos);
+	for (; pos < size; pos += eventSize (data[pos]))
+	{
+		if (data[pos] == 'k')
+			continue;
+		memcpy (dest + destSize, data + pos, eventSize (data[pos]));
+		destSize += eventSize (data[pos]);
+	}
+	return destSize;
+}
+
+// Playing back what is received, in pieces.
+
+static const BYTE *liveData;
+static size_t liveSize;
+static size_t livePos;
+static int numFetches;
+
+static BOOLEAN
+fetchLive (void)
+{
+	size_t len = liveSize - livePos;
+
+	if (len == 0)
+		return FALSE;
+	if (len > LIVE_CHUNK_SIZE)
+		len = LIVE_CHUNK_SIZE;
+	Replay_addData (liveData + livePos, len);
+	livePos += len;
+	numFetches++;
+	return TRUE;
+}
+
+static void
+clearSetup (void)
+{
+	memset (fleets, 0, sizeof fleets);
+	memset (teamNames, 0, sizeof teamNames);
+	memset (PlayerControl, 0, sizeof PlayerControl);
+	// A different seed; playback must set its own.
+	TFB_SeedRandom (999);
+}
+
+static int
+checkPlayback (const char *what, RunResult result, int expectedFrames,
+		int expectedSeekEnd)
+{
+	int failures = 0;
+
+	if (result.mismatch >= 0)
+	{
+		printf ("%s: the state differs from the recording at frame %d\n",
+				what, result.mismatch);
+		failures++;
+	}
+	if (result.aborted || result.frames != expectedFrames)
+	{
+		printf ("%s: %d of %d frames played%s\n", what, result.frames,
+				expectedFrames, result.aborted ? ", then stopped" : "");
+		failures++;
+	}
+	if (result.seekEnd != expectedSeekEnd)
+	{
+		printf ("%s: seeking ended at frame %d instead of %d\n", what,
+				result.seekEnd, expectedSeekEnd);
+		failures++;
+	}
+	if (numWarnings > 0)
+	{
+		printf ("%s: warning: %s\n", what, lastWarning);
+		failures++;
+	}
+	return failures;
+}
+
+static double
+secondsSince (uint64 start)
+{
+	return (double) (GetPerfCounter () - start) / 1e9;
+}
+
+int
+main (int argc, char *argv[])
+{
+	char goodPath[1024];
+	char badPath[1024];
+	char cutPath[1024];
+	int numReps;
+	int failures = 0;
+	int totalFrames;
+	BYTE *data;
+	BYTE *liveCopy;
+	size_t size;
+	size_t pos;
+	RunResult result;
+	MeleeShip ship;
+	uint64 start;
+	double replaySeconds;
+	double bareSeconds;
+	int rep;
+
+	if (argc < 2)
+	{
+		fprintf (stderr, "Usage: %s <directory> [repetitions]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	numReps = argc > 2 ? atoi (argv[2]) : 20;
+	if (numReps < 1)
+		numReps = 1;
+	snprintf (goodPath, sizeof goodPath, "%s/match.rpl", argv[1]);
+	snprintf (badPath, sizeof badPath, "%s/badkey.rpl", argv[1]);
+	snprintf (cutPath, sizeof cutPath, "%s/cut.rpl", argv[1]);
+
+	// Record.
+	PlayerControl[0] = HUMAN_CONTROL | STANDARD_RATING;
+	PlayerControl[1] = COMPUTER_CONTROL | AWESOME_RATING;
+	for (ship = 0; ship < MELEE_FLEET_SIZE; ship++)
+	{
+		fleets[0][ship] = ship;
+		fleets[1][ship] = ship % 2 ? MELEE_NONE : ship;
+	}
+	strcpy (teamNames[0], "Alpha");
+	strcpy (teamNames[1], "Beta");
+	TFB_SeedRandom (12345);
+	inputRandom = 1;
+	replayOptions.recordFile = goodPath;
+	result = runMatch (MODE_RECORD);
+	replayOptions.recordFile = NULL;
+	totalFrames = result.frames;
+	data = readFile (goodPath, &size);
+	if (data == NULL)
+	{
+		printf ("Could not record to %s\n", goodPath);
+		return EXIT_FAILURE;
+	}
+	printf ("recorded %d frames in %d battles: %lu bytes, %.2f per frame\n",
+			totalFrames, NUM_BATTLES, (unsigned long) size,
+			(double) size / totalFrames);
+
+	// Play back from the start, as fast as possible.
+	replayOptions.playFile = goodPath;
+	replayOptions.playSpeed = REPLAY_SPEED_MAX;
+	replayOptions.seekFrame = 0;
+	clearSetup ();
+	numWarnings = 0;
+	if (!Replay_load (NULL))
+	{
+		printf ("Could not load %s\n", goodPath);
+		return EXIT_FAILURE;
+	}
+	if (PlayerControl[0] != (HUMAN_CONTROL | STANDARD_RATING) ||
+			PlayerControl[1] != (COMPUTER_CONTROL | AWESOME_RATING) ||
+			fleets[0][5] != 5 || fleets[1][1] != MELEE_NONE ||
+			strcmp (teamNames[1], "Beta") != 0)
+	{
+		printf ("playback: the setup was not restored\n");
+		failures++;
+	}
+	result = runMatch (MODE_PLAY);
+	failures += checkPlayback ("playback", result, totalFrames, -1);
+	if (Replay_getPlayedFrames () != (DWORD) totalFrames)
+	{
+		printf ("playback: %lu frames counted instead of %d\n",
+				(unsigned long) Replay_getPlayedFrames (), totalFrames);
+		failures++;
+	}
+	if (nth_frame != 0)
+	{
+		printf ("playback: the speed was not reset\n");
+		failures++;
+	}
+
+	// Time it, with and without the replay code.
+	start = GetPerfCounter ();
+	for (rep = 0; rep < numReps; rep++)
+	{
+		Replay_load (NULL);
+		runMatch (MODE_PLAY);
+	}
+	replaySeconds = secondsSince (start);
+	start = GetPerfCounter ();
+	for (rep = 0; rep < numReps; rep++)
+		runMatch (MODE_BARE);
+	bareSeconds = secondsSince (start);
+	printf ("playback: %.0f frames/s; the toy simulation alone: "
+			"%.0f frames/s\n",
+			(double) totalFrames * numReps / replaySeconds,
+			(double) totalFrames * numReps / bareSeconds);
+	printf ("playback: the replay code takes %.1f ns per frame\n",
+			(replaySeconds - bareSeconds) * 1e9 / totalFrames / numReps);
+
+	// Seek; the playback is drawn from the last keyframe before the
+	// frame sought.
+	replayOptions.playSpeed = 0;
+	replayOptions.seekFrame = SEEK_FRAME;
+	clearSetup ();
+	numWarnings = 0;
+	Replay_load (NULL);
+	start = GetPerfCounter ();
+	result = runMatch (MODE_PLAY);
+	failures += checkPlayback ("seek", result, totalFrames,
+			SEEK_FRAME / REPLAY_KEYFRAME_INTERVAL * REPLAY_KEYFRAME_INTERVAL);
+	printf ("seek: to frame %d, then played to the end, in %.2f ms\n",
+			SEEK_FRAME, secondsSince (start) * 1e3);
+	replayOptions.seekFrame = 0;
+
+	// Received in pieces, with seeking.
+	liveData = liveCopy = malloc (size);
+	liveSize = stripKeyframes (liveCopy, data, size);
+	livePos = headerSize (data);
+	numFetches = 0;
+	clearSetup ();
+	numWarnings = 0;
+	if (!Replay_loadLive (NULL, data, livePos, fetchLive, SEEK_FRAME))
+	{
+		printf ("live: the header was not accepted\n");
+		failures++;
+	}
+	else
+	{
+		result = runMatch (MODE_PLAY);
+		failures += checkPlayback ("live", result, totalFrames, SEEK_FRAME);
+		printf ("live: played in %d pieces of %d bytes\n", numFetches,
+				LIVE_CHUNK_SIZE);
+	}
+	free (liveCopy);
+	replayOptions.playSpeed = REPLAY_SPEED_MAX;
+
+	// A damaged keyframe stops the playback there.
+	pos = findKeyframe (data, size, BAD_KEYFRAME);
+	if (pos == 0)
+	{
+		printf ("badkey: keyframe %d not found\n", BAD_KEYFRAME);
+		failures++;
+	}
+	else
+	{
+		data[pos + 5] ^= 1;
+		writeFile (badPath, data, size);
+		data[pos + 5] ^= 1;
+		replayOptions.playFile = badPath;
+		clearSetup ();
+		numWarnings = 0;
+		Replay_load (NULL);
+		result = runMatch (MODE_PLAY);
+		if (!result.aborted || result.frames != BAD_KEYFRAME ||
+				numWarnings != 1 || strstr (lastWarning, "out of sync") == NULL)
+		{
+			printf ("badkey: stopped at frame %d (%s), expected %d\n",
+					result.frames, numWarnings ? lastWarning : "no warning",
+					BAD_KEYFRAME);
+			failures++;
+		}
+	}
+
+	// So does the end of a recording that was cut off.
+	writeFile (cutPath, data, size / 2);
+	replayOptions.playFile = cutPath;
+	clearSetup ();
+	numWarnings = 0;
+	Replay_load (NULL);
+	result = runMatch (MODE_PLAY);
+	if (!result.aborted || result.frames >= totalFrames ||
+			result.mismatch >= 0 || numWarnings != 1)
+	{
+		printf ("cut: stopped at frame %d of %d (%s)\n", result.frames,
+				totalFrames, numWarnings ? lastWarning : "no warning");
+		failures++;
+	}
+
+	free (data);
+	remove (goodPath);
+	remove (badPath);
+	remove (cutPath);
+
+	printf ("%s\n", failures == 0 ? "OK" : "FAILED");
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -28,6 +28,7 @@
 
 #include <stdarg.h>
 #include <errno.h>
+#include <stdlib.h>
 #include "libs/alarm.h"
 #include "libs/graphics/gfx_common.h"
 #include "libs/graphics/cmap.h"
@@ -44,6 +45,7 @@
 #include "libs/memlib.h"
 #include "libs/platform.h"
 #include "libs/log.h"
+#include "libs/perflib.h"
 #include "options.h"
 #include "uqmversion.h"
 #include "uqm/comm.h"
@@ -52,9 +54,12 @@
 #	include "libs/net.h"
 #	include "uqm/supermelee/netplay/netoptions.h"
 #	include "uqm/supermelee/netplay/netplay.h"
+#	include "uqm/supermelee/netplay/spectator.h"
 #endif
 #include "uqm/setup.h"
 #include "uqm/starcon.h"
+#include "uqm/supermelee/replay.h"
+#include "uqm/uqmbench.h"
 
 
 #if defined (GFXMODULE_SDL)
@@ -62,6 +67,9 @@
 			// Including this is actually necessary on OSX.
 #endif
 
+// Upper limit for --framerate and config.framerate
+#define MAX_FRAME_RATE 1000
+
 struct bool_option
 {
 	bool value;
@@ -103,6 +111,7 @@ struct options_struct
 	int numAddons;
 
 	const char *graphicsBackend;
+	const char *perfCounterFile;
 	
 	// Commandline and user config options
 	DECL_CONFIG_OPTION(bool, opengl);
@@ -111,6 +120,7 @@ struct options_struct
 	DECL_CONFIG_OPTION(bool, scanlines);
 	DECL_CONFIG_OPTION(int, scaler);
 	DECL_CONFIG_OPTION(bool, showFps);
+	DECL_CONFIG_OPTION(int, frameRate);
 	DECL_CONFIG_OPTION(bool, keepAspectRatio);
 	DECL_CONFIG_OPTION(float, gamma);
 	DECL_CONFIG_OPTION(int, soundDriver);
@@ -239,6 +249,7 @@ main (int argc, char *argv[])
 		/* .addons = */             NULL,
 		/* .numAddons = */          0,
 		/* .graphicsBackend = */     NULL,
+		/* .perfCounterFile = */     NULL,
 
 		INIT_CONFIG_OPTION(  opengl,            false ),
 		INIT_CONFIG_OPTION2( resolution,        640, 480 ),
@@ -246,6 +257,7 @@ main (int argc, char *argv[])
 		INIT_CONFIG_OPTION(  scanlines,         false ),
 		INIT_CONFIG_OPTION(  scaler,            0 ),
 		INIT_CONFIG_OPTION(  showFps,           false ),
+		INIT_CONFIG_OPTION(  frameRate,         0 ),
 		INIT_CONFIG_OPTION(  keepAspectRatio,   false ),
 		INIT_CONFIG_OPTION(  gamma,             1.0f ),
 #if defined(EMSCRIPTEN) && defined(HAVE_OPENAL)
@@ -276,6 +288,9 @@ main (int argc, char *argv[])
 	int gfxDriver;
 	int gfxFlags;
 	int i;
+#ifdef DEBUG_INPUT_LATENCY
+	TimeCount nextInputProbe = 0;
+#endif
 
 	// NOTE: we cannot use the logging facility yet because we may have to
 	//   log to a file, and we'll only get the log file name after parsing
@@ -340,8 +355,21 @@ main (int argc, char *argv[])
 		return optionsResult;
 	}
 
+	if (benchFile != NULL)
+	{
+		// The benchmarks need no window and no sound device.
+		setenv ("SDL_VIDEODRIVER", "dummy", 0);
+		setenv ("SDL_AUDIODRIVER", "dummy", 0);
+	}
+
 	TFB_PreInit ();
 	mem_init ();
+	{
+		// Replay an allocation trace instead of starting the game.
+		const char *memBench = getenv ("UQM_MEMBENCH");
+		if (memBench != NULL)
+			return mem_replayTrace (memBench) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 	InitThreadSystem ();
 	log_initThreads ();
 	initIO ();
@@ -415,9 +443,12 @@ main (int argc, char *argv[])
 #ifdef NETPLAY
 	Network_init ();
 	NetManager_init ();
+	if (netplayOptions.spectatorPort != NULL &&
+			netplayOptions.spectateHost == NULL)
+		Spectator_open (netplayOptions.spectatorPort);
 #endif
 
-	gfxDriver = options.opengl.value ?
+	gfxDriver = options.opengl.value && benchFile == NULL ?
 			TFB_GFXDRIVER_SDL_OPENGL : TFB_GFXDRIVER_SDL_PURE;
 	gfxFlags = options.scaler.value;
 	if (options.fullscreen.value)
@@ -426,6 +457,9 @@ main (int argc, char *argv[])
 		gfxFlags |= TFB_GFXFLAGS_SCANLINES;
 	if (options.showFps.value)
 		gfxFlags |= TFB_GFXFLAGS_SHOWFPS;
+	TFB_SetFrameRate (options.frameRate.value);
+	if (options.perfCounterFile != NULL)
+		perf_setExportFile (options.perfCounterFile);
 	TFB_InitGraphics (gfxDriver, gfxFlags, options.graphicsBackend,
 			options.resolution.width, options.resolution.height);
 	if (options.gamma.set && setGammaCorrection (options.gamma.value))
@@ -461,9 +495,19 @@ main (int argc, char *argv[])
 		}
 
 		TFB_ProcessEvents ();
+#ifdef DEBUG_INPUT_LATENCY
+		if (GetTimeCounter () >= nextInputProbe)
+		{	// A synthetic event; the game thread logs how long it
+			// takes to get drawn.
+			PostInputEvent (INPUT_EVENT_PROBE, 0, 0, 0);
+			nextInputProbe = GetTimeCounter () + ONE_SECOND / 4;
+		}
+#endif
 		ProcessUtilityKeys ();
 		ProcessThreadLifecycles ();
 		TFB_FlushGraphics ();
+		perf_update ();
+		TFB_WaitForFrame ();
 	}
 
 	/* Currently, we use atexit() callbacks everywhere, so we
@@ -479,8 +523,10 @@ main (int argc, char *argv[])
 		// Purge above refers to colormaps which have to be still up
 		UninitColorMaps ();
 		TFB_UninitGraphics ();
+		perf_setExportFile (NULL);
 
 #ifdef NETPLAY
+		Spectator_close ();
 		NetManager_uninit ();
 		Network_uninit ();
 #endif
@@ -644,6 +690,18 @@ getUserConfigOptions (struct options_struct *options)
 	getBoolConfigValue (&options->fullscreen, "config.fullscreen");
 	getBoolConfigValue (&options->scanlines, "config.scanlines");
 	getBoolConfigValue (&options->showFps, "config.showfps");
+	if (res_IsInteger ("config.framerate") && !options->frameRate.set)
+	{
+		int rate = res_GetInteger ("config.framerate");
+		if (rate >= 0 && rate <= MAX_FRAME_RATE)
+		{
+			options->frameRate.value = rate;
+			options->frameRate.set = true;
+		}
+		else
+			log_add (log_Warning, "Ignoring invalid frame rate %d in the "
+					"config.", rate);
+	}
 	getBoolConfigValue (&options->keepAspectRatio, "config.keepaspectratio");
 	getGammaConfigValue (&options->gamma, "config.gamma");
 
@@ -717,12 +775,21 @@ enum
 	ACCEL_OPT,
 	SAFEMODE_OPT,
 	RENDERER_OPT,
+	RECORDMELEE_OPT,
+	REPLAYMELEE_OPT,
+	REPLAYSPEED_OPT,
+	REPLAYSEEK_OPT,
+	FRAMERATE_OPT,
+	PERFCOUNTERS_OPT,
+	BENCH_OPT,
 #ifdef NETPLAY
 	NETHOST1_OPT,
 	NETPORT1_OPT,
 	NETHOST2_OPT,
 	NETPORT2_OPT,
 	NETDELAY_OPT,
+	NETSPECTPORT_OPT,
+	NETSPECTATE_OPT,
 #endif
 };
 
@@ -765,12 +832,21 @@ static struct option longOptions[] =
 	{"accel", 1, NULL, ACCEL_OPT},
 	{"safe", 0, NULL, SAFEMODE_OPT},
 	{"renderer", 1, NULL, RENDERER_OPT},
+	{"recordmelee", 1, NULL, RECORDMELEE_OPT},
+	{"replaymelee", 1, NULL, REPLAYMELEE_OPT},
+	{"replayspeed", 1, NULL, REPLAYSPEED_OPT},
+	{"replayseek", 1, NULL, REPLAYSEEK_OPT},
+	{"framerate", 1, NULL, FRAMERATE_OPT},
+	{"perfcounters", 1, NULL, PERFCOUNTERS_OPT},
+	{"bench", 1, NULL, BENCH_OPT},
 #ifdef NETPLAY
 	{"nethost1", 1, NULL, NETHOST1_OPT},
 	{"netport1", 1, NULL, NETPORT1_OPT},
 	{"nethost2", 1, NULL, NETHOST2_OPT},
 	{"netport2", 1, NULL, NETPORT2_OPT},
 	{"netdelay", 1, NULL, NETDELAY_OPT},
+	{"netspectport", 1, NULL, NETSPECTPORT_OPT},
+	{"netspectate", 1, NULL, NETSPECTATE_OPT},
 #endif
 	{0, 0, 0, 0}
 };
@@ -1062,6 +1138,81 @@ parseOptions (int argc, char *argv[], struct options_struct *options)
 			case RENDERER_OPT:
 				options->graphicsBackend = optarg;
 				break;
+			case RECORDMELEE_OPT:
+				replayOptions.recordFile = optarg;
+				break;
+			case REPLAYMELEE_OPT:
+				replayOptions.playFile = optarg;
+				break;
+			case REPLAYSPEED_OPT:
+			{
+				int temp;
+
+				if (!strcmp (optarg, "max"))
+				{
+					replayOptions.playSpeed = REPLAY_SPEED_MAX;
+					break;
+				}
+				if (parseIntOption (optarg, &temp, "replay speed") == -1)
+				{
+					badArg = true;
+					break;
+				}
+				if (temp < 1 || temp >= REPLAY_SPEED_MAX)
+				{
+					saveError ("Replay speed must be 'max' or between 1 "
+							"and %d.", REPLAY_SPEED_MAX - 1);
+					badArg = true;
+					break;
+				}
+				replayOptions.playSpeed = (BYTE) (temp - 1);
+				break;
+			}
+			case REPLAYSEEK_OPT:
+			{
+				int temp;
+
+				if (parseIntOption (optarg, &temp, "replay seek frame")
+						== -1)
+				{
+					badArg = true;
+					break;
+				}
+				if (temp < 0)
+				{
+					saveError ("Replay seek frame must not be negative.");
+					badArg = true;
+					break;
+				}
+				replayOptions.seekFrame = (DWORD) temp;
+				break;
+			}
+			case FRAMERATE_OPT:
+			{
+				int temp;
+
+				if (parseIntOption (optarg, &temp, "frame rate") == -1)
+				{
+					badArg = true;
+					break;
+				}
+				if (temp < 0 || temp > MAX_FRAME_RATE)
+				{
+					saveError ("Frame rate must be between 0 and %d.",
+							MAX_FRAME_RATE);
+					badArg = true;
+					break;
+				}
+				options->frameRate.value = temp;
+				options->frameRate.set = true;
+				break;
+			}
+			case PERFCOUNTERS_OPT:
+				options->perfCounterFile = optarg;
+				break;
+			case BENCH_OPT:
+				benchFile = optarg;
+				break;
 #ifdef NETPLAY
 			case NETHOST1_OPT:
 				netplayOptions.peer[0].isServer = false;
@@ -1095,6 +1246,12 @@ parseOptions (int argc, char *argv[], struct options_struct *options)
 				}
 				break;
 			}
+			case NETSPECTPORT_OPT:
+				netplayOptions.spectatorPort = optarg;
+				break;
+			case NETSPECTATE_OPT:
+				netplayOptions.spectateHost = optarg;
+				break;
 #endif
 			default:
 				saveError ("Error: Unknown option '%s'",
@@ -1111,6 +1268,16 @@ parseOptions (int argc, char *argv[], struct options_struct *options)
 		badArg = true;
 	}
 
+#ifdef NETPLAY
+	if (!badArg && netplayOptions.spectateHost != NULL &&
+			netplayOptions.spectatorPort == NULL)
+	{
+		saveError ("Error: --netspectate needs the port to connect to, "
+				"given with --netspectport.");
+		badArg = true;
+	}
+#endif
+
 	return badArg ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
@@ -1204,6 +1371,13 @@ usage (FILE *out, const struct options_struct *defaults)
 			boolOptString (&defaults->scanlines));
 	log_add (log_User, "  -p, --fps (default %s)",
 			boolOptString (&defaults->showFps));
+	log_add (log_User, "  --framerate=FPS (present at most FPS frames per "
+			"second; 0, the default, for the display refresh rate)");
+	log_add (log_User, "  --perfcounters=FILE (write the performance "
+			"counters to FILE every second, as JSON if FILE ends in "
+			".json, otherwise as CSV)");
+	log_add (log_User, "  --bench=FILE (run the benchmarks without a "
+			"window, write the results to FILE as JSON, then quit)");
 	log_add (log_User, "  -g, --gamma=CORRECTIONVALUE (default 1.0, which "
 			"causes no change)");
 	log_add (log_User, "  -C, --configdir=CONFIGDIR");
@@ -1227,6 +1401,14 @@ usage (FILE *out, const struct options_struct *defaults)
 	log_add (log_User, "  --stereosfx (enables positional sound effects, "
 			"currently only for openal)");
 	log_add (log_User, "  --safe (start in safe mode)");
+	log_add (log_User, "  --recordmelee=FILE (record each SuperMelee match "
+			"to FILE)");
+	log_add (log_User, "  --replaymelee=FILE (play back a recorded "
+			"SuperMelee match, then quit)");
+	log_add (log_User, "  --replayspeed=SPEED (1, 2, ... times normal speed, "
+			"or 'max' to play back without drawing; default 1)");
+	log_add (log_User, "  --replayseek=FRAME (play back without drawing up "
+			"to the last keyframe before FRAME)");
 #ifdef NETPLAY
 	log_add (log_User, "  --nethostN=HOSTNAME (server to connect to for "
 			"player N (1=bottom, 2=top)");
@@ -1234,6 +1416,11 @@ usage (FILE *out, const struct options_struct *defaults)
 			"player N (1=bottom, 2=top)");
 	log_add (log_User, "  --netdelay=FRAMES (number of frames to "
 			"buffer/delay network input for");
+	log_add (log_User, "  --netspectport=PORT (port on which to accept "
+			"spectators of network matches, or to connect to with "
+			"--netspectate)");
+	log_add (log_User, "  --netspectate=HOSTNAME (watch the network matches "
+			"of HOSTNAME, then quit)");
 #endif
 	log_add (log_User, "The following options can take either '3do' or 'pc' "
 			"as an option:");
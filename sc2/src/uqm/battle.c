@@ -33,8 +33,10 @@
 #		include "supermelee/netplay/checksum.h"
 #	endif
 #	include "supermelee/netplay/notifyall.h"
+#	include "supermelee/netplay/spectator.h"
 #endif
 #include "supermelee/pickmele.h"
+#include "supermelee/replay.h"
 #include "resinst.h"
 #include "nameref.h"
 #include "setup.h"
@@ -45,6 +47,8 @@
 #include "libs/log.h"
 #include "libs/mathlib.h"
 
+#include <string.h>
+
 
 BYTE battle_counter[NUM_SIDES];
 		// The number of ships still available for battle to each side.
@@ -141,12 +145,27 @@ frameInputHuman (HumanInputContext *context, STARSHIP *StarShipPtr)
 	return CurrentInputToBattleInput (context->playerNr);
 }
 
+BATTLE_INPUT_STATE
+frameInputReplay (ReplayInputContext *context, STARSHIP *StarShipPtr)
+{
+	// The computer still decides what it would do, as it draws random
+	// numbers while doing so, but the recorded input is used.
+	if (PlayerControl[context->playerNr] & COMPUTER_CONTROL)
+		(void) computer_intelligence ((ComputerInputContext *) context,
+				StarShipPtr);
+	return Replay_getInput (context->playerNr);
+}
+
 static void
 ProcessInput (void)
 {
 	BOOLEAN CanRunAway;
 	size_t sideI;
+	BATTLE_INPUT_STATE playerInput[NUM_PLAYERS];
+			// The input used for each player, for recording.
 
+	memset (playerInput, 0, sizeof playerInput);
+	Replay_frameStart ();
 #ifdef NETPLAY
 	netInput ();
 #endif
@@ -192,6 +211,7 @@ ProcessInput (void)
 							// Get the input from the front of the buffer.
 				}
 #endif
+				playerInput[cur_player] = InputState;
 
 				StarShipPtr->ship_input_state = 0;
 				if (StarShipPtr->RaceDescPtr->ship_info.crew_level)
@@ -217,8 +237,11 @@ ProcessInput (void)
 		}
 	}
 	
+	Replay_frameEnd (playerInput);
 #ifdef NETPLAY
 	flushPacketQueues ();
+	Spectator_frame ((uint32) battleFrameCount, playerInput, NUM_PLAYERS);
+	Spectator_flush ();
 #endif
 
 	if (GLOBAL (CurrentActivity) & (CHECK_LOAD | CHECK_ABORT))
@@ -265,7 +288,8 @@ DoBattle (BATTLE_STATE *bs)
 	SetMenuSounds (MENU_SOUND_NONE, MENU_SOUND_NONE);
 
 #if defined (NETPLAY) && defined (NETPLAY_CHECKSUM)
-	if (getNumNetConnections() > 0 &&
+	if ((getNumNetConnections() > 0 || Spectator_matchActive () ||
+			spectateStream != NULL) &&
 			battleFrameCount % NETPLAY_CHECKSUM_INTERVAL == 0)
 	{
 		crc_State state;
@@ -279,6 +303,10 @@ DoBattle (BATTLE_STATE *bs)
 				(uint32) checksum);
 		flushPacketQueues ();
 		addLocalChecksum (battleFrameCount, checksum);
+		Spectator_checksum ((uint32) battleFrameCount, (uint32) checksum);
+		if (spectateStream != NULL)
+			SpectateStream_localChecksum (spectateStream,
+					(uint32) battleFrameCount, (uint32) checksum);
 	}
 #endif
 	ProcessInput ();
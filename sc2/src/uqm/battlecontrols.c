@@ -44,6 +44,13 @@ BattleInputHandlers HumanInputHandlers = {
 	/* .deleteContext  = */ InputContext_delete,
 };
 
+BattleInputHandlers ReplayInputHandlers = {
+	/* .frameInput     = */ (BattleFrameInputFunction) frameInputReplay,
+	/* .selectShip     = */ (SelectShipFunction) selectShipReplay,
+	/* .battleEndReady = */ (BattleEndReadyFunction) battleEndReadyReplay,
+	/* .deleteContext  = */ InputContext_delete,
+};
+
 #ifdef NETPLAY
 BattleInputHandlers NetworkInputHandlers = {
 	/* .frameInput     = */ (BattleFrameInputFunction) networkBattleInput,
@@ -86,6 +93,15 @@ HumanInputContext_new (COUNT playerNr)
 	return result;
 }
 
+ReplayInputContext *
+ReplayInputContext_new (COUNT playerNr)
+{
+	ReplayInputContext *result = HMalloc (sizeof (ReplayInputContext));
+	InputContext_init ((InputContext *) result,
+			&ReplayInputHandlers, playerNr);
+	return result;
+}
+
 #ifdef NETPLAY
 NetworkInputContext *
 NetworkInputContext_new (COUNT playerNr)
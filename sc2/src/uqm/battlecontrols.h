@@ -21,6 +21,7 @@ typedef struct BattleInputHandlers BattleInputHandlers;
 typedef struct InputContext InputContext;
 typedef struct ComputerInputContext ComputerInputContext;
 typedef struct HumanInputContext HumanInputContext;
+typedef struct ReplayInputContext ReplayInputContext;
 #ifdef NETPLAY
 typedef struct NetworkInputContext NetworkInputContext;
 #endif  /* NETPLAY */
@@ -67,6 +68,11 @@ struct HumanInputContext {
 	INPUT_CONTEXT_COMMON
 };
 
+// Input from a recorded SuperMelee match; see supermelee/replay.c
+struct ReplayInputContext {
+	INPUT_CONTEXT_COMMON
+};
+
 #ifdef NETPLAY
 struct NetworkInputContext {
 	INPUT_CONTEXT_COMMON
@@ -76,6 +82,7 @@ struct NetworkInputContext {
 
 ComputerInputContext *ComputerInputContext_new (COUNT playerNr);
 HumanInputContext *HumanInputContext_new (COUNT playerNr);
+ReplayInputContext *ReplayInputContext_new (COUNT playerNr);
 #ifdef NETPLAY
 NetworkInputContext *NetworkInputContext_new (COUNT playerNr);
 #endif  /* NETPLAY */
@@ -85,6 +92,8 @@ extern InputContext *PlayerInput[];
 
 BATTLE_INPUT_STATE frameInputHuman (HumanInputContext *context,
 		STARSHIP *StarShipPtr);
+BATTLE_INPUT_STATE frameInputReplay (ReplayInputContext *context,
+		STARSHIP *StarShipPtr);
 void InputContext_init(InputContext *context, BattleInputHandlers *handlers,
 		COUNT playerNr);
 void InputContext_delete (InputContext *context);
@@ -61,6 +61,7 @@ extern void RemoveEscortShips (COUNT race);
 extern RACE_DESC *load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData);
 extern void free_ship (RACE_DESC *RaceDescPtr, BOOLEAN FreeIconData,
 		BOOLEAN FreeBattleData);
+extern void FreeShipMediaCache (void);
 
 #if defined(__cplusplus)
 }
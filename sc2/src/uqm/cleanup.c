@@ -16,6 +16,7 @@
  *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
  */
 
+#include "build.h"
 #include "nameref.h"
 #include "libs/reslib.h"
 #include "gamestr.h"
@@ -61,6 +62,7 @@ static void
 UninitKernel (void)
 {
 	UninitSpace ();
+	FreeShipMediaCache ();
 
 	DestroySound (ReleaseSound (MenuSounds));
 	DestroyFont (MicroFont);
@@ -79,42 +79,113 @@ nextClockDay (void)
 			++GLOBAL (GameClock.year_index);
 		}
 	}
+}
 
-	// update the date on screen
-	DrawStatusMessage (NULL);
+// Days since 1 March of year 0, counting the proleptic Gregorian calendar.
+// Starting the year in March puts the leap day at the end of it.
+static DWORD
+DateToDayNumber (COUNT month, COUNT day, COUNT year)
+{
+	DWORD y = year;
+	DWORD m = month;
+
+	if (m <= 2)
+	{
+		--y;
+		m += 12;
+	}
+	m -= 3;
+	return y * 365 + y / 4 - y / 100 + y / 400
+			+ (153 * m + 2) / 5 + day - 1;
+}
+
+static void
+DayNumberToDate (DWORD day_number, BYTE *pmonth, BYTE *pday, COUNT *pyear)
+{
+	DWORD era = day_number / 146097;
+	DWORD day_of_era = day_number % 146097;
+	DWORD year_of_era = (day_of_era - day_of_era / 1460
+			+ day_of_era / 36524 - day_of_era / 146096) / 365;
+	DWORD day_of_year = day_of_era - (365 * year_of_era
+			+ year_of_era / 4 - year_of_era / 100);
+	DWORD m = (5 * day_of_year + 2) / 153;
+
+	*pday = (BYTE)(day_of_year - (153 * m + 2) / 5 + 1);
+	*pmonth = (BYTE)(m < 10 ? m + 3 : m - 9);
+	*pyear = (COUNT)(era * 400 + year_of_era + (*pmonth <= 2));
+}
+
+static DWORD
+GetClockDayNumber (void)
+{
+	return DateToDayNumber (GLOBAL (GameClock.month_index),
+			GLOBAL (GameClock.day_index), GLOBAL (GameClock.year_index));
+}
+
+static void
+SetClockDayNumber (DWORD day_number)
+{
+	DayNumberToDate (day_number, &GLOBAL (GameClock.month_index),
+			&GLOBAL (GameClock.day_index), &GLOBAL (GameClock.year_index));
+}
+
+static int
+compareEvents (const EVENT *e1, const EVENT *e2)
+{
+	if (e1->day_number != e2->day_number)
+		return e1->day_number < e2->day_number ? -1 : 1;
+	if (e1->seq != e2->seq)
+		return e1->seq < e2->seq ? -1 : 1;
+	return 0;
 }
 
+static EVENT *
+newEvent (COUNT month_index, COUNT day_index, COUNT year_index,
+		BYTE func_index)
+{
+	EVENT *EventPtr = HMallocObject (sizeof (EVENT));
+
+	EventPtr->day_index = (BYTE)day_index;
+	EventPtr->month_index = (BYTE)month_index;
+	EventPtr->year_index = year_index;
+	EventPtr->func_index = func_index;
+	EventPtr->day_number = DateToDayNumber (month_index, day_index,
+			year_index);
+	EventPtr->seq = GLOBAL (GameClock.next_event_seq)++;
+	Heap_add (GLOBAL (GameClock.events), &EventPtr->heapValue);
+
+	return EventPtr;
+}
+
+// Run the handlers of all events which are due. Handlers may add new
+// events, for today as well.
 static void
 processClockDayEvents (void)
 {
-	HEVENT hEvent;
+	DWORD today = GetClockDayNumber ();
 
-	while ((hEvent = GetHeadEvent ()))
+	while (Heap_hasMore (GLOBAL (GameClock.events)))
 	{
-		EVENT *EventPtr;
+		EVENT *EventPtr = (EVENT *) Heap_first (GLOBAL (GameClock.events));
+		BYTE func_index;
 
-		LockEvent (hEvent, &EventPtr);
-
-		if (GLOBAL (GameClock.day_index) != EventPtr->day_index
-				|| GLOBAL (GameClock.month_index) != EventPtr->month_index
-				|| GLOBAL (GameClock.year_index) != EventPtr->year_index)
-		{
-			UnlockEvent (hEvent);
+		if (EventPtr->day_number > today)
 			break;
-		}
-		RemoveEvent (hEvent);
-		EventHandler (EventPtr->func_index);
 
-		UnlockEvent (hEvent);
-		FreeEvent (hEvent);
+		Heap_pop (GLOBAL (GameClock.events));
+		func_index = EventPtr->func_index;
+		HFreeObject (EventPtr, sizeof (EVENT));
+		EventHandler (func_index);
 	}
 }
 
 BOOLEAN
 InitGameClock (void)
 {
-	if (!InitQueue (&GLOBAL (GameClock.event_q), NUM_EVENTS, sizeof (EVENT)))
-		return (FALSE);
+	GLOBAL (GameClock.events) = Heap_new (
+			(HeapValue_Comparator) compareEvents, NUM_EVENTS, NUM_EVENTS,
+			0.8);
+	GLOBAL (GameClock.next_event_seq) = 0;
 	clock_mutex = CreateMutex ("Clock Mutex", SYNC_CLASS_TOPLEVEL);
 	GLOBAL (GameClock.month_index) = 2;
 	GLOBAL (GameClock.day_index) = 17;
@@ -131,7 +202,9 @@ UninitGameClock (void)
 	DestroyMutex (clock_mutex);
 	clock_mutex = NULL;
 
-	UninitQueue (&GLOBAL (GameClock.event_q));
+	ClearEvents ();
+	Heap_delete (GLOBAL (GameClock.events));
+	GLOBAL (GameClock.events) = NULL;
 
 	return (TRUE);
 }
@@ -225,55 +298,72 @@ ValidateEvent (EVENT_TYPE type, COUNT *pmonth_index, COUNT *pday_index,
 			&& day_index < GLOBAL (GameClock.day_index))))));
 }
 
-HEVENT
+EVENT *
 AddEvent (EVENT_TYPE type, COUNT month_index, COUNT day_index, COUNT
 		year_index, BYTE func_index)
 {
-	HEVENT hNewEvent;
-
 	if (type == RELATIVE_EVENT
 			&& month_index == 0
 			&& day_index == 0
 			&& year_index == 0)
 		EventHandler (func_index);
-	else if (ValidateEvent (type, &month_index, &day_index, &year_index)
-			&& (hNewEvent = AllocEvent ()))
-	{
-		EVENT *EventPtr;
+	else if (ValidateEvent (type, &month_index, &day_index, &year_index))
+		return newEvent (month_index, day_index, year_index, func_index);
 
-		LockEvent (hNewEvent, &EventPtr);
-		EventPtr->day_index = (BYTE)day_index;
-		EventPtr->month_index = (BYTE)month_index;
-		EventPtr->year_index = year_index;
-		EventPtr->func_index = func_index;
-		UnlockEvent (hNewEvent);
+	return (0);
+}
 
-		{
-			HEVENT hEvent, hSuccEvent;
-			for (hEvent = GetHeadEvent (); hEvent != 0; hEvent = hSuccEvent)
-			{
-				LockEvent (hEvent, &EventPtr);
-				if (year_index < EventPtr->year_index
-						|| (year_index == EventPtr->year_index
-						&& (month_index < EventPtr->month_index
-						|| (month_index == EventPtr->month_index
-						&& day_index < EventPtr->day_index))))
-				{
-					UnlockEvent (hEvent);
-					break;
-				}
-
-				hSuccEvent = GetSuccEvent (EventPtr);
-				UnlockEvent (hEvent);
-			}
-			
-			InsertEvent (hNewEvent, hEvent);
-		}
+// Add an event as it is, without checking its date. For loading games;
+// events for the same date keep the order in which they are put.
+void
+PutEvent (const EVENT *event)
+{
+	newEvent (event->month_index, event->day_index, event->year_index,
+			event->func_index);
+}
 
-		return (hNewEvent);
-	}
+void
+ClearEvents (void)
+{
+	while (Heap_hasMore (GLOBAL (GameClock.events)))
+		HFreeObject (Heap_pop (GLOBAL (GameClock.events)), sizeof (EVENT));
+	GLOBAL (GameClock.next_event_seq) = 0;
+}
 
-	return (0);
+COUNT
+CountEvents (void)
+{
+	return (COUNT) Heap_count (GLOBAL (GameClock.events));
+}
+
+static int
+compareEventPtrs (const void *p1, const void *p2)
+{
+	return compareEvents (*(const EVENT * const *) p1,
+			*(const EVENT * const *) p2);
+}
+
+// Calls 'callback' for every pending event, in the order in which they
+// will happen. The callback must not add or remove events.
+void
+ForAllEvents (void (*callback) (const EVENT *event, void *arg), void *arg)
+{
+	const Heap *events = GLOBAL (GameClock.events);
+	size_t count = Heap_count (events);
+	const EVENT **sorted;
+	size_t i;
+
+	if (count == 0)
+		return;
+
+	sorted = HMalloc (count * sizeof *sorted);
+	for (i = 0; i < count; i++)
+		sorted[i] = (const EVENT *) events->entries[i];
+	qsort (sorted, count, sizeof *sorted, compareEventPtrs);
+
+	for (i = 0; i < count; i++)
+		callback (sorted[i], arg);
+	HFree (sorted);
 }
 
 void
@@ -292,23 +382,79 @@ GameClockTick (void)
 		{	
 			nextClockDay ();
 			processClockDayEvents ();
+			// update the date on screen
+			DrawStatusMessage (NULL);
 		}
 	}
 
 	UnlockMutex (clock_mutex);
 }
 
+// Moves the clock to the given day, running the handlers of the events
+// on the way on their own dates. The days in between are skipped.
+static void
+moveGameClockTo (DWORD target)
+{
+	DWORD today = GetClockDayNumber ();
+
+	while (today < target)
+	{
+		DWORD next = target;
+
+		if (Heap_hasMore (GLOBAL (GameClock.events)))
+		{
+			const EVENT *EventPtr =
+					(EVENT *) Heap_first (GLOBAL (GameClock.events));
+			if (EventPtr->day_number > today
+					&& EventPtr->day_number < next)
+				next = EventPtr->day_number;
+		}
+
+		if (next == today + 1)
+			nextClockDay ();
+		else
+			SetClockDayNumber (next);
+		today = next;
+		processClockDayEvents ();
+	}
+
+	GLOBAL (GameClock.tick_count) = GLOBAL (GameClock.day_in_ticks);
+	// update the date on screen
+	DrawStatusMessage (NULL);
+}
+
 void
 MoveGameClockDays (COUNT days)
 {
 	// XXX: This should theoretically hold the clock_mutex, but if
 	//   someone manages to hit the debug button while this function
 	//   runs, it's their own fault :-P
-	
-	for ( ; days > 0; --days)
-	{
-		nextClockDay ();
+
+	moveGameClockTo (GetClockDayNumber () + days);
+}
+
+// Moves the clock to the date of the first pending event, and runs the
+// handlers of all events for that date. Returns FALSE if no event is
+// pending. If 'pfunc_index' is not NULL, it is set to the first event
+// that was handled.
+BOOLEAN
+MoveGameClockToNextEvent (BYTE *pfunc_index)
+{
+	const EVENT *EventPtr;
+	DWORD target;
+
+	if (!Heap_hasMore (GLOBAL (GameClock.events)))
+		return FALSE;
+
+	EventPtr = (EVENT *) Heap_first (GLOBAL (GameClock.events));
+	if (pfunc_index)
+		*pfunc_index = EventPtr->func_index;
+	target = EventPtr->day_number;
+
+	if (target > GetClockDayNumber ())
+		moveGameClockTo (target);
+	else
 		processClockDayEvents ();
-	}
-	GLOBAL (GameClock.tick_count) = GLOBAL (GameClock.day_in_ticks);
+
+	return TRUE;
 }
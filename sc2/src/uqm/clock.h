@@ -19,6 +19,7 @@
 #ifndef UQM_CLOCK_H_
 #define UQM_CLOCK_H_
 
+#include "libs/heap.h"
 #include "libs/tasklib.h"
 #include "displist.h"
 
@@ -39,20 +40,25 @@ typedef struct
 	COUNT year_index;
 	SIZE tick_count, day_in_ticks;
 
-	QUEUE event_q;
-			/* Queue element is EVENT */
+	Heap *events;
+			/* Heap element is EVENT, ordered by date */
+	DWORD next_event_seq;
+			/* Orders events for the same date in the order in which
+			 * they were added */
 } CLOCK_STATE;
 
-typedef HLINK HEVENT;
-
 typedef struct event
 {
-	// LINK elements; must be first
-	HEVENT pred, succ;
+	// HeapValue; must be first
+	HeapValue heapValue;
 
 	BYTE day_index, month_index;
 	COUNT year_index;
 	BYTE func_index;
+
+	DWORD day_number;
+			/* The date as a number of days; the heap key */
+	DWORD seq;
 } EVENT;
 
 typedef enum
@@ -61,20 +67,6 @@ typedef enum
 	RELATIVE_EVENT
 } EVENT_TYPE;
 
-#define AllocEvent() AllocLink (&GLOBAL (GameClock.event_q))
-#define PutEvent(h) PutQueue (&GLOBAL (GameClock.event_q), (h))
-#define InsertEvent(h,i) InsertQueue (&GLOBAL (GameClock.event_q), (h), (i))
-#define GetHeadEvent() GetHeadLink (&GLOBAL (GameClock.event_q))
-#define GetTailEvent() GetTailLink (&GLOBAL (GameClock.event_q))
-#define LockEvent(h,ppe) (*(ppe) = (EVENT*)LockLink (&GLOBAL (GameClock.event_q), h))
-#define UnlockEvent(h) UnlockLink (&GLOBAL (GameClock.event_q), (h))
-#define RemoveEvent(h) RemoveQueue (&GLOBAL (GameClock.event_q), (h))
-#define FreeEvent(h) FreeLink (&GLOBAL (GameClock.event_q), (h))
-#define GetPredEvent(l) _GetPredLink (l)
-#define GetSuccEvent(l) _GetSuccLink (l)
-#define ForAllEvents(callback, arg) ForAllLinks(&GLOBAL (GameClock.event_q), \
-		(void (*)(LINK *, void *)) (callback), (arg))
-
 // Rates are in seconds per game day
 #define HYPERSPACE_CLOCK_RATE 5
 // XXX: the IP rate is based on 24 ticks/second (see SetGameClockRate),
@@ -89,11 +81,17 @@ extern BOOLEAN UninitGameClock (void);
 extern void SetGameClockRate (COUNT seconds_per_day);
 extern BOOLEAN ValidateEvent (EVENT_TYPE type, COUNT *pmonth_index,
 		COUNT *pday_index, COUNT *pyear_index);
-extern HEVENT AddEvent (EVENT_TYPE type, COUNT month_index, COUNT
+extern EVENT *AddEvent (EVENT_TYPE type, COUNT month_index, COUNT
 		day_index, COUNT year_index, BYTE func_index);
+extern void PutEvent (const EVENT *event);
+extern void ClearEvents (void);
+extern COUNT CountEvents (void);
+extern void ForAllEvents (void (*callback) (const EVENT *event, void *arg),
+		void *arg);
 extern void EventHandler (BYTE selector);
 extern void GameClockTick (void);
 extern void MoveGameClockDays (COUNT days);
+extern BOOLEAN MoveGameClockToNextEvent (BYTE *pfunc_index);
 
 // The lock/unlock/running functions are for debugging use only
 // Locking will block the GameClockTick() function and thus
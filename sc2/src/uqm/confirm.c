@@ -137,7 +137,7 @@ DoConfirmExit (void)
 				DrawConfirmationWindow (response);
 				PlayMenuSound (MENU_SOUND_MOVE);
 			}
-			SleepThread (ONE_SECOND / 30);
+			SleepThreadUntilInput (GetTimeCounter () + ONE_SECOND / 30);
 		} while (!done);
 
 		// Restore the screen under the confirmation window
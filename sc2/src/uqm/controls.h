@@ -100,6 +100,9 @@ extern CONTROL_TEMPLATE PlayerControls[];
 
 void UpdateInputState (void);
 extern void FlushInput (void);
+// Like SleepThreadUntil(), but wakes up early when input arrives.
+// Must be called on the Starcon2Main thread.
+BOOLEAN SleepThreadUntilInput (TimeCount wakeTime);
 void SetMenuRepeatDelay (DWORD min, DWORD max, DWORD step, BOOLEAN gestalt);
 void SetDefaultMenuRepeatDelay (void);
 void ResetKeyRepeat (void);
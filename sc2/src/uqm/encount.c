@@ -36,6 +36,7 @@
 #include "intel.h"
 #include "nameref.h"
 #include "resinst.h"
+#include "save.h"
 #include "settings.h"
 #include "setup.h"
 #include "sounds.h"
@@ -400,6 +401,9 @@ InitEncounter (void)
 		DrawMenuStateStrings (PM_CONVERSE, MenuState.CurState = HAIL);
 		SetFlashRect (SFR_MENU_3DO);
 
+		// The game could be saved from the menu right here as well.
+		AutoSaveGame ();
+
 		DoInput (&MenuState, TRUE);
 
 		SetFlashRect (NULL);
@@ -29,10 +29,14 @@
 #include "tactrans.h"
 #include "uqmdebug.h"
 #include "libs/async.h"
+#include "libs/graphics/tfb_draw.h"
 #include "libs/inplib.h"
+#include "libs/log.h"
 #include "libs/timelib.h"
 #include "libs/threadlib.h"
 
+#include <string.h>
+
 
 #define ACCELERATION_INCREMENT (ONE_SECOND / 12)
 #define MENU_REPEAT_DELAY (ONE_SECOND / 2)
@@ -55,6 +59,8 @@ typedef struct
 CONTROL_TEMPLATE PlayerControls[NUM_PLAYERS];
 CONTROLLER_INPUT_STATE CurrentInputState, PulsedInputState;
 static CONTROLLER_INPUT_STATE CachedInputState, OldInputState;
+static CONTROLLER_INPUT_STATE HeldInputState;
+		// The state of the controls, as of the last input event read
 static MENU_ANNOTATIONS RepeatDelays, Times;
 static DWORD GestaltRepeatDelay, GestaltTime;
 static BOOLEAN OldGestalt, CachedGestalt;
@@ -70,6 +76,19 @@ volatile BOOLEAN GamePaused;
 
 static InputFrameCallback *inputCallback;
 
+#ifdef DEBUG_INPUT_LATENCY
+#define LATENCY_PROBE_REPORT 16
+		// Log the latency once per this many probes
+static BOOLEAN latencyProbeRead;
+		// A probe has been read; it is sent off to be drawn at the
+		// start of the next input frame, after the drawing done in
+		// response to this one.
+static uint64 latencyProbeTime;
+static volatile BOOLEAN latencyProbeInFlight;
+static uint64 latencyMin, latencyMax, latencyTotal;
+static COUNT latencyCount;
+#endif
+
 static void
 _clear_menu_state (void)
 {
@@ -88,6 +107,7 @@ _clear_menu_state (void)
 		CachedInputState.menu[i] = 0;
 	}		
 	CachedGestalt = FALSE;
+	memset (&HeldInputState, 0, sizeof HeldInputState);
 }
 
 void
@@ -157,13 +177,13 @@ _check_gestalt (DWORD NewTime)
 	{
 		for (j = 0; j < NUM_KEYS; j++)
 		{
-			CachedGestalt |= ImmediateInputState.key[i][j];
+			CachedGestalt |= CachedInputState.key[i][j];
 			CurrentGestalt |= PulsedInputState.key[i][j];
 		}
 	}
 	for (i = 0; i < NUM_MENU_KEYS; i++)
 	{
-		CachedGestalt |= ImmediateInputState.menu[i];
+		CachedGestalt |= CachedInputState.menu[i];
 		CurrentGestalt |= PulsedInputState.menu[i];
 	}
 
@@ -221,6 +241,141 @@ _check_gestalt (DWORD NewTime)
 	}
 }
 
+#ifdef DEBUG_INPUT_LATENCY
+// Executes on the main() thread, when the draw command queue has got
+// to the frame drawn after the probe was read.
+static void
+latencyProbeDrawn (void *arg)
+{
+	uint64 latency = GetPerfCounter () - latencyProbeTime;
+
+	if (latencyCount == 0 || latency < latencyMin)
+		latencyMin = latency;
+	if (latency > latencyMax)
+		latencyMax = latency;
+	latencyTotal += latency;
+	latencyCount++;
+
+	if (latencyCount == LATENCY_PROBE_REPORT)
+	{
+		double scale = 1000.0 / GetPerfFrequency ();
+		log_add (log_Debug, "Input-to-draw latency over %u probes: "
+				"min %.2f ms, avg %.2f ms, max %.2f ms", latencyCount,
+				latencyMin * scale, latencyTotal * scale / latencyCount,
+				latencyMax * scale);
+		latencyCount = 0;
+		latencyMax = 0;
+		latencyTotal = 0;
+	}
+
+	latencyProbeInFlight = FALSE;
+	(void) arg;
+}
+
+static void
+_send_latency_probe (void)
+{
+	if (!latencyProbeRead || latencyProbeInFlight)
+		return;
+
+	latencyProbeRead = FALSE;
+	latencyProbeInFlight = TRUE;
+	TFB_DrawScreen_Callback (latencyProbeDrawn, NULL);
+}
+#endif
+
+// Reads the state of all controls from the input vectors, after queued
+// events have been dropped.
+static void
+_resync_input_state (void)
+{
+	int i, j;
+	for (i = 0; i < NUM_TEMPLATES; i++)
+	{
+		for (j = 0; j < NUM_KEYS; j++)
+		{
+			HeldInputState.key[i][j] =
+					ImmediateInputState.key[i][j] & INPUT_COUNT_MASK;
+		}
+	}
+	for (i = 0; i < NUM_MENU_KEYS; i++)
+	{
+		HeldInputState.menu[i] =
+				ImmediateInputState.menu[i] & INPUT_COUNT_MASK;
+	}
+}
+
+// Reads all queued input events, in order. CurrentInputState gets the
+// controls which are held now, and those which were pressed at any time
+// since the last call, even if they have been released since.
+static void
+_read_input_events (void)
+{
+	InputEvent event;
+	int i, j;
+
+	memset (&CurrentInputState, 0, sizeof CurrentInputState);
+
+	while (GetInputEvent (&event))
+	{
+		int *held;
+		int *current;
+
+		switch (event.type)
+		{
+			case INPUT_EVENT_MENU:
+				if (event.control >= NUM_MENU_KEYS)
+					continue;
+				held = &HeldInputState.menu[event.control];
+				current = &CurrentInputState.menu[event.control];
+				break;
+			case INPUT_EVENT_FLIGHT:
+				if (event.templat >= NUM_TEMPLATES
+						|| event.control >= NUM_KEYS)
+					continue;
+				held = &HeldInputState.key[event.templat][event.control];
+				current = &CurrentInputState.key[event.templat]
+						[event.control];
+				break;
+			case INPUT_EVENT_RESYNC:
+				_resync_input_state ();
+				continue;
+#ifdef DEBUG_INPUT_LATENCY
+			case INPUT_EVENT_PROBE:
+				if (!latencyProbeRead && !latencyProbeInFlight)
+				{
+					latencyProbeRead = TRUE;
+					latencyProbeTime = event.perfTime;
+				}
+				continue;
+#endif
+			default:
+				continue;
+		}
+
+		if (event.value && !*held)
+		{	// Pressed; keep it for this frame even if it is
+			// released before the frame is over.
+			*current = event.value;
+		}
+		*held = event.value;
+	}
+
+	for (i = 0; i < NUM_TEMPLATES; i++)
+	{
+		for (j = 0; j < NUM_KEYS; j++)
+		{
+			if (HeldInputState.key[i][j])
+				CurrentInputState.key[i][j] = HeldInputState.key[i][j];
+		}
+	}
+	for (i = 0; i < NUM_MENU_KEYS; i++)
+	{
+		if (HeldInputState.menu[i])
+			CurrentInputState.menu[i] = HeldInputState.menu[i];
+	}
+}
+
 void
 UpdateInputState (void)
 {
@@ -241,9 +396,14 @@ UpdateInputState (void)
 	if (ExitRequested)
 		ConfirmExit ();
 
-	CurrentInputState = ImmediateInputState;
+#ifdef DEBUG_INPUT_LATENCY
+	_send_latency_probe ();
+#endif
+	_read_input_events ();
 	OldInputState = CachedInputState;
-	CachedInputState = ImmediateInputState;
+	CachedInputState = CurrentInputState;
+	// ImmediateInputState is still polled directly on the main() thread
+	// and by PauseGame().
 	BeginInputFrame ();
 	NewTime = GetTimeCounter ();
 	if (_gestalt_keys)
@@ -282,6 +442,35 @@ UpdateInputState (void)
 #endif
 }
 
+// Sleep until wakeTime, but call asynchronous operations until then,
+// as SleepThreadUntil() does. Returns early, with TRUE, when an input
+// event arrives.
+BOOLEAN
+SleepThreadUntilInput (TimeCount wakeTime)
+{
+	for (;;) {
+		uint32 nextTimeMs;
+		TimeCount nextTime;
+		TimeCount now;
+
+		Async_process ();
+
+		now = GetTimeCounter ();
+		if (wakeTime <= now)
+			return FALSE;
+
+		nextTimeMs = Async_timeBeforeNextMs ();
+		nextTime = (nextTimeMs / 1000) * ONE_SECOND +
+				((nextTimeMs % 1000) * ONE_SECOND / 1000);
+				// Overflow-safe conversion.
+		if (wakeTime < nextTime)
+			nextTime = wakeTime;
+
+		if (WaitInputEventUntil (nextTime))
+			return TRUE;
+	}
+}
+
 InputFrameCallback *
 SetInputCallback (InputFrameCallback *callback)
 {
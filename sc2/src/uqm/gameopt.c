@@ -38,7 +38,7 @@
 
 extern FRAME PlayFrame;
 
-#define MAX_SAVED_GAMES 50
+#define MAX_SAVED_GAMES (FIRST_AUTOSAVE_GAME + NUM_AUTOSAVE_SLOTS)
 #define SUMMARY_X_OFFS 14
 #define SUMMARY_SIDE_OFFS 7
 #define SAVES_PER_PAGE 5
@@ -1049,8 +1049,9 @@ DoPickGame (MENU_STATE *pMS)
 	else if (PulsedInputState.menu[KEY_MENU_SELECT])
 	{
 		pSD = &pickState->summary[pMS->CurState];
-		if (pickState->saving || pSD->year_index)
-		{	// valid slot
+		if (pickState->saving ? pMS->CurState < FIRST_AUTOSAVE_GAME
+				: pSD->year_index != 0)
+		{	// valid slot; autosave slots are not for the player to save in
 			PlayMenuSound (MENU_SOUND_SUCCESS);
 			pickState->success = TRUE;
 			return FALSE;
@@ -1128,7 +1129,10 @@ SaveLoadGame (PICK_GAME_STATE *pickState, COUNT gameIndex, BOOLEAN *canceled_by_
 		{
 			PlayMenuSound (MENU_SOUND_SUCCESS);
 			ConfirmSaveLoad (pickState->saving ? &saveStamp : NULL);
-			success = SaveGame (gameIndex, desc, nameBuf);
+			// The player waits for the save to finish here, so that
+			// write errors can be reported below.
+			success = SaveGame (gameIndex, desc, nameBuf)
+					&& WaitSaveGameWrite ();
 		}
 		else
 		{
@@ -435,7 +435,7 @@ DoTextEntry (TEXTENTRY_STATE *pTES)
 	if (pTES->FrameCallback)
 		return pTES->FrameCallback (pTES);
 	else
-		SleepThread (ONE_SECOND / 30);
+		SleepThreadUntilInput (GetTimeCounter () + ONE_SECOND / 30);
 
 	return TRUE;
 }
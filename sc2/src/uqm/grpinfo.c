@@ -35,6 +35,18 @@
 static BYTE LastEncGroup;
 		// Last encountered group, saved into state files
 
+BYTE
+GetLastEncGroup (void)
+{
+	return LastEncGroup;
+}
+
+void
+SetLastEncGroup (BYTE group)
+{
+	LastEncGroup = group;
+}
+
 void
 ReadGroupHeader (GAME_STATE_FILE *fp, GROUP_HEADER *pGH)
 {
@@ -53,4 +53,7 @@ void WriteShipFragment (GAME_STATE_FILE *fp, const SHIP_FRAGMENT *FragPtr);
 void ReadIpGroup (GAME_STATE_FILE *fp, IP_GROUP *GroupPtr);
 void WriteIpGroup (GAME_STATE_FILE *fp, const IP_GROUP *GroupPtr);
 
+BYTE GetLastEncGroup (void);
+void SetLastEncGroup (BYTE group);
+
 #endif
@@ -1522,20 +1522,11 @@ SeedUniverse (void)
 
 	{
 		SDPtr = 0;
-		while ((SDPtr = FindStar (SDPtr, &universe, XOFFS, YOFFS)))
+		while ((SDPtr = FindStar (SDPtr, &universe,
+				XOFFS / NUM_RADAR_SCREENS, YOFFS / NUM_RADAR_SCREENS)))
 		{
 			BYTE star_type;
 
-			ex = SDPtr->star_pt.x - universe.x;
-			if (ex < 0)
-				ex = -ex;
-			ey = SDPtr->star_pt.y - universe.y;
-			if (ey < 0)
-				ey = -ey;
-			if (ex > (XOFFS / NUM_RADAR_SCREENS)
-					|| ey > (YOFFS / NUM_RADAR_SCREENS))
-				continue;
-
 			hHyperSpaceElement = AllocHyperElement (&SDPtr->star_pt);
 			if (hHyperSpaceElement == 0)
 				continue;
@@ -276,8 +276,6 @@ LoadEncounter (ENCOUNTER *EncounterPtr, void *fh)
 static void
 LoadEvent (EVENT *EventPtr, void *fh)
 {
-	EventPtr->pred = 0;
-	EventPtr->succ = 0;
 	read_8   (fh, &EventPtr->day_index);
 	read_8   (fh, &EventPtr->month_index);
 	read_16  (fh, &EventPtr->year_index);
@@ -616,6 +614,9 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 	DWORD chunk, chunkSize;
 	BOOLEAN first_group_spec = TRUE;
 
+	// Make sure a game that is still being saved is read complete.
+	WaitSaveGameWrite ();
+
 	sprintf (file, "uqmsave.%02u", which_game);
 	in_fp = res_OpenResFile (saveDir, file, "rb");
 	if (!in_fp)
@@ -640,7 +641,7 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 
 	GlobData.SIS_state = SummPtr->SS;
 
-	ReinitQueue (&GLOBAL (GameClock.event_q));
+	ClearEvents ();
 	ReinitQueue (&GLOBAL (encounter_q));
 	ReinitQueue (&GLOBAL (ip_group_q));
 	ReinitQueue (&GLOBAL (npc_built_ship_q));
@@ -699,23 +700,18 @@ LoadGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 #endif /* DEBUG_LOAD */
 			while (num_links--)
 			{
-				HEVENT hEvent;
-				EVENT *EventPtr;
-
-				hEvent = AllocEvent ();
-				LockEvent (hEvent, &EventPtr);
+				EVENT Event;
 
-				LoadEvent (EventPtr, in_fp);
+				LoadEvent (&Event, in_fp);
 
 #ifdef DEBUG_LOAD
 				log_add (log_Debug, "\t%u/%u/%u -- %u",
-						 EventPtr->month_index,
-						 EventPtr->day_index,
-						 EventPtr->year_index,
-						 EventPtr->func_index);
+						 Event.month_index,
+						 Event.day_index,
+						 Event.year_index,
+						 Event.func_index);
 #endif /* DEBUG_LOAD */
-				UnlockEvent (hEvent);
-				PutEvent (hEvent);
+				PutEvent (&Event);
 			}
 			break;
 		case STAR_TAG:
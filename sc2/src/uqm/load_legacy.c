@@ -434,9 +434,7 @@ static void
 LoadEvent (EVENT *EventPtr, DECODE_REF fh)
 {
 	cread_ptr (fh); /* useless ptr; HEVENT pred */
-	EventPtr->pred = 0;
 	cread_ptr (fh); /* useless ptr; HEVENT succ */
-	EventPtr->succ = 0;
 	cread_8   (fh, &EventPtr->day_index);
 	cread_8   (fh, &EventPtr->month_index);
 	cread_16  (fh, &EventPtr->year_index);
@@ -478,7 +476,7 @@ LoadClockState (CLOCK_STATE *ClockPtr, DECODE_REF fh)
 	cread_ptr (fh); /* not loading ptr; Task clock_task */
 	cread_32  (fh, NULL); /* not loading; DWORD TimeCounter */
 
-	DummyLoadQueue (&ClockPtr->event_q, fh);
+	DummyLoadQueue (NULL, fh); /* QUEUE event_q */
 }
 
 static void
@@ -660,7 +658,7 @@ LoadLegacyGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 		return FALSE;
 	}
 
-	ReinitQueue (&GLOBAL (GameClock.event_q));
+	ClearEvents ();
 	ReinitQueue (&GLOBAL (encounter_q));
 	ReinitQueue (&GLOBAL (ip_group_q));
 	ReinitQueue (&GLOBAL (npc_built_ship_q));
@@ -702,23 +700,18 @@ LoadLegacyGame (COUNT which_game, SUMMARY_DESC *SummPtr)
 #endif /* DEBUG_LOAD */
 		while (num_links--)
 		{
-			HEVENT hEvent;
-			EVENT *EventPtr;
+			EVENT Event;
 
-			hEvent = AllocEvent ();
-			LockEvent (hEvent, &EventPtr);
-
-			LoadEvent (EventPtr, fh);
+			LoadEvent (&Event, fh);
 
 #ifdef DEBUG_LOAD
 		log_add (log_Debug, "\t%u/%u/%u -- %u",
-				EventPtr->month_index,
-				EventPtr->day_index,
-				EventPtr->year_index,
-				EventPtr->func_index);
+				Event.month_index,
+				Event.day_index,
+				Event.year_index,
+				Event.func_index);
 #endif /* DEBUG_LOAD */
-			UnlockEvent (hEvent);
-			PutEvent (hEvent);
+			PutEvent (&Event);
 		}
 	}
 
@@ -23,6 +23,11 @@
 #include "nameref.h"
 #include "races.h"
 #include "init.h"
+#include "libs/log.h"
+#include "libs/memlib.h"
+#include "libs/timelib.h"
+
+#include <string.h>
 
 static RESOURCE code_resources[] = {
 		NULL_RESOURCE,
@@ -55,6 +60,254 @@ static RESOURCE code_resources[] = {
 		SAMATRA_CODE,
 		URQUAN_DRONE_CODE };
 
+// The battle data of a ship (its graphics, captain window, victory ditty
+// and sounds) is kept after the ship is freed, so that it does not have to
+// be loaded again when a ship of the same kind enters a later battle.
+// Ships in battle at the same time share it as well.
+// When the graphics of all the data kept take more than
+// SHIP_MEDIA_CACHE_SIZE bytes, the data which is not in use is freed,
+// least recently used first.
+#ifndef SHIP_MEDIA_CACHE_SIZE
+#	define SHIP_MEDIA_CACHE_SIZE (16 * 1024 * 1024)
+#endif
+
+struct ship_media
+{
+	SHIP_MEDIA *next;
+			// Next in the cache, which is in order of last use.
+	DATA_STUFF data;
+			// Only the resources and the loaded data are used, not the
+			// per-ship fields of captain_control.
+	COUNT refCount;
+	DWORD size;
+			// Estimated size of the graphics, in bytes.
+};
+
+static SHIP_MEDIA *media_cache;
+static DWORD media_cache_size;
+
+static BOOLEAN
+sameResource (RESOURCE res1, RESOURCE res2)
+{
+	if (res1 == NULL_RESOURCE || res2 == NULL_RESOURCE)
+		return res1 == res2;
+	return strcmp (res1, res2) == 0;
+}
+
+static BOOLEAN
+sameResources (const DATA_STUFF *data1, const DATA_STUFF *data2)
+{
+	COUNT i;
+
+	for (i = 0; i < NUM_VIEWS; ++i)
+	{
+		if (!sameResource (data1->ship_rsc[i], data2->ship_rsc[i])
+				|| !sameResource (data1->weapon_rsc[i],
+				data2->weapon_rsc[i])
+				|| !sameResource (data1->special_rsc[i],
+				data2->special_rsc[i]))
+			return FALSE;
+	}
+	return sameResource (data1->captain_control.captain_rsc,
+				data2->captain_control.captain_rsc)
+			&& sameResource (data1->victory_ditty_rsc,
+				data2->victory_ditty_rsc)
+			&& sameResource (data1->ship_sounds_rsc,
+				data2->ship_sounds_rsc);
+}
+
+static DWORD
+drawableSize (FRAME frame)
+{
+	DWORD size = 0;
+	COUNT i, count;
+
+	if (!frame)
+		return 0;
+
+	count = GetFrameCount (frame);
+	for (i = 0; i < count; ++i)
+	{
+		RECT r;
+
+		GetFrameRect (SetAbsFrameIndex (frame, i), &r);
+		size += (DWORD) r.extent.width * r.extent.height * 4;
+	}
+	return size;
+}
+
+// load_animation() uses the same drawable for sizes which have no
+// resource of their own.
+static DWORD
+animationSize (FRAME pixarray[])
+{
+	DWORD size = 0;
+	COUNT i;
+
+	for (i = 0; i < NUM_VIEWS; ++i)
+	{
+		if (i > 0 && pixarray[i] && ReleaseDrawable (pixarray[i])
+				== ReleaseDrawable (pixarray[i - 1]))
+			continue;
+		size += drawableSize (pixarray[i]);
+	}
+	return size;
+}
+
+static void
+freeBattleData (DATA_STUFF *shipData)
+{
+	free_image (shipData->special);
+	free_image (shipData->weapon);
+	free_image (shipData->ship);
+
+	DestroyDrawable (
+			ReleaseDrawable (shipData->captain_control.background));
+	DestroyMusic (shipData->victory_ditty);
+	DestroySound (ReleaseSound (shipData->ship_sounds));
+}
+
+static BOOLEAN
+loadBattleData (DATA_STUFF *RawPtr)
+{
+	if (!load_animation (RawPtr->ship,
+			RawPtr->ship_rsc[0],
+			RawPtr->ship_rsc[1],
+			RawPtr->ship_rsc[2]))
+		return FALSE;
+
+	if (RawPtr->weapon_rsc[0] != NULL_RESOURCE)
+	{
+		if (!load_animation (RawPtr->weapon,
+				RawPtr->weapon_rsc[0],
+				RawPtr->weapon_rsc[1],
+				RawPtr->weapon_rsc[2]))
+			return FALSE;
+	}
+
+	if (RawPtr->special_rsc[0] != NULL_RESOURCE)
+	{
+		if (!load_animation (RawPtr->special,
+				RawPtr->special_rsc[0],
+				RawPtr->special_rsc[1],
+				RawPtr->special_rsc[2]))
+			return FALSE;
+	}
+
+	if (RawPtr->captain_control.captain_rsc != NULL_RESOURCE)
+	{
+		RawPtr->captain_control.background = CaptureDrawable (LoadGraphic (
+				RawPtr->captain_control.captain_rsc));
+		if (!RawPtr->captain_control.background)
+			return FALSE;
+	}
+
+	if (RawPtr->victory_ditty_rsc != NULL_RESOURCE)
+	{
+		RawPtr->victory_ditty =
+				LoadMusic (RawPtr->victory_ditty_rsc);
+		if (!RawPtr->victory_ditty)
+			return FALSE;
+	}
+
+	if (RawPtr->ship_sounds_rsc != NULL_RESOURCE)
+	{
+		RawPtr->ship_sounds = CaptureSound (
+				LoadSound (RawPtr->ship_sounds_rsc));
+		if (!RawPtr->ship_sounds)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+// Free the least recently used data which is not in use, until the cache
+// is within its size.
+static void
+trimMediaCache (DWORD maxSize)
+{
+	while (media_cache_size > maxSize)
+	{
+		SHIP_MEDIA **ppMedia;
+		SHIP_MEDIA **ppUnused = NULL;
+		SHIP_MEDIA *media;
+
+		for (ppMedia = &media_cache; *ppMedia; ppMedia = &(*ppMedia)->next)
+		{
+			if ((*ppMedia)->refCount == 0)
+				ppUnused = ppMedia;
+		}
+		if (!ppUnused)
+			break;
+
+		media = *ppUnused;
+		*ppUnused = media->next;
+		media_cache_size -= media->size;
+		freeBattleData (&media->data);
+		HFree (media);
+	}
+}
+
+// *loaded is set to whether the data had to be loaded.
+static SHIP_MEDIA *
+acquireMedia (const DATA_STUFF *shipData, BOOLEAN *loaded)
+{
+	SHIP_MEDIA **ppMedia;
+	SHIP_MEDIA *media;
+
+	*loaded = FALSE;
+	for (ppMedia = &media_cache; *ppMedia; ppMedia = &(*ppMedia)->next)
+	{
+		media = *ppMedia;
+		if (sameResources (&media->data, shipData))
+		{
+			// Move it to the front.
+			*ppMedia = media->next;
+			media->next = media_cache;
+			media_cache = media;
+			++media->refCount;
+			return media;
+		}
+	}
+
+	*loaded = TRUE;
+	media = HCalloc (sizeof *media);
+	media->data = *shipData;
+	if (!loadBattleData (&media->data))
+	{
+		freeBattleData (&media->data);
+		HFree (media);
+		return NULL;
+	}
+	media->refCount = 1;
+	media->size = animationSize (media->data.ship)
+			+ animationSize (media->data.weapon)
+			+ animationSize (media->data.special)
+			+ drawableSize (media->data.captain_control.background);
+
+	media->next = media_cache;
+	media_cache = media;
+	media_cache_size += media->size;
+	trimMediaCache (SHIP_MEDIA_CACHE_SIZE);
+
+	return media;
+}
+
+static void
+releaseMedia (SHIP_MEDIA *media)
+{
+	--media->refCount;
+	trimMediaCache (SHIP_MEDIA_CACHE_SIZE);
+}
+
+void
+FreeShipMediaCache (void)
+{
+	trimMediaCache (0);
+	if (media_cache)
+		log_add (log_Warning, "Ship battle data still in use at exit.");
+}
+
 RACE_DESC *
 load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData)
 {
@@ -104,53 +357,29 @@ load_ship (SPECIES_ID SpeciesID, BOOLEAN LoadBattleData)
 	if (LoadBattleData)
 	{
 		DATA_STUFF *RawPtr = &RDPtr->ship_data;
-		if (!load_animation (RawPtr->ship,
-				RawPtr->ship_rsc[0],
-				RawPtr->ship_rsc[1],
-				RawPtr->ship_rsc[2]))
-			goto BadLoad;
-
-		if (RawPtr->weapon_rsc[0] != NULL_RESOURCE)
-		{
-			if (!load_animation (RawPtr->weapon,
-					RawPtr->weapon_rsc[0],
-					RawPtr->weapon_rsc[1],
-					RawPtr->weapon_rsc[2]))
-				goto BadLoad;
-		}
-
-		if (RawPtr->special_rsc[0] != NULL_RESOURCE)
-		{
-			if (!load_animation (RawPtr->special,
-					RawPtr->special_rsc[0],
-					RawPtr->special_rsc[1],
-					RawPtr->special_rsc[2]))
-				goto BadLoad;
-		}
-
-		if (RawPtr->captain_control.captain_rsc != NULL_RESOURCE)
-		{
-			RawPtr->captain_control.background = CaptureDrawable (LoadGraphic (
-					RawPtr->captain_control.captain_rsc));
-			if (!RawPtr->captain_control.background)
-				goto BadLoad;
-		}
+		SHIP_MEDIA *media;
+		BOOLEAN loaded;
+		uint64 startTime;
 
-		if (RawPtr->victory_ditty_rsc != NULL_RESOURCE)
-		{
-			RawPtr->victory_ditty =
-					LoadMusic (RawPtr->victory_ditty_rsc);
-			if (!RawPtr->victory_ditty)
-				goto BadLoad;
-		}
+		startTime = GetPerfCounter ();
+		media = acquireMedia (RawPtr, &loaded);
+		if (!media)
+			goto BadLoad;
+		log_add (log_Debug, "load_ship(%d): battle data %s in %.2f ms, "
+				"%lu bytes cached", (int) SpeciesID,
+				loaded ? "loaded" : "found in the cache",
+				(double) (GetPerfCounter () - startTime) * 1000.0
+				/ GetPerfFrequency (), (unsigned long) media_cache_size);
+		RDPtr->MediaRef = media;
 
-		if (RawPtr->ship_sounds_rsc != NULL_RESOURCE)
-		{
-			RawPtr->ship_sounds = CaptureSound (
-					LoadSound (RawPtr->ship_sounds_rsc));
-			if (!RawPtr->ship_sounds)
-				goto BadLoad;
-		}
+		memcpy (RawPtr->ship, media->data.ship, sizeof RawPtr->ship);
+		memcpy (RawPtr->weapon, media->data.weapon, sizeof RawPtr->weapon);
+		memcpy (RawPtr->special, media->data.special,
+				sizeof RawPtr->special);
+		RawPtr->captain_control.background =
+				media->data.captain_control.background;
+		RawPtr->victory_ditty = media->data.victory_ditty;
+		RawPtr->ship_sounds = media->data.ship_sounds;
 	}
 
 ExitFunc:
@@ -173,18 +402,12 @@ free_ship (RACE_DESC *raceDescPtr, BOOLEAN FreeIconData,
 	if (raceDescPtr->uninit_func != NULL)
 		(*raceDescPtr->uninit_func) (raceDescPtr);
 
-	if (FreeBattleData)
+	if (FreeBattleData && raceDescPtr->MediaRef)
 	{
-		DATA_STUFF *shipData = &raceDescPtr->ship_data;
-
-		free_image (shipData->special);
-		free_image (shipData->weapon);
-		free_image (shipData->ship);
-
-		DestroyDrawable (
-				ReleaseDrawable (shipData->captain_control.background));
-		DestroyMusic (shipData->victory_ditty);
-		DestroySound (ReleaseSound (shipData->ship_sounds));
+		// The ship code may have changed the handles in ship_data, but
+		// the cache still has the ones that were loaded.
+		releaseMedia (raceDescPtr->MediaRef);
+		raceDescPtr->MediaRef = NULL;
 	}
 
 	if (FreeIconData)
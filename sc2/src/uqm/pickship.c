@@ -241,7 +241,7 @@ ChangeSelection:
 		}
 	}
 
-	SleepThread (ONE_SECOND / 30);
+	SleepThreadUntilInput (GetTimeCounter () + ONE_SECOND / 30);
 
 	return (TRUE);
 }
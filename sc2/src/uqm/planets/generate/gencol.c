@@ -106,7 +106,7 @@ GenerateColony_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 {
 	if (matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
-		DoPlanetaryAnalysis (&solarSys->SysInfo, world);
+		DoPlanetaryAnalysis (solarSys, &solarSys->SysInfo, world);
 
 		solarSys->SysInfo.PlanetInfo.AtmoDensity =
 				EARTH_ATMOSPHERE * 98 / 100;
@@ -116,9 +116,6 @@ GenerateDefault_generateName (const SOLARSYS_STATE *solarSys,
 bool
 GenerateDefault_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 {
-	DWORD rand_val;
-	SYSTEM_INFO *sysInfo;
-
 #ifdef DEBUG_SOLARSYS
 	if (worldIsPlanet (solarSys, world))
 	{
@@ -133,29 +130,38 @@ GenerateDefault_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 	}
 #endif /* DEBUG_SOLARSYS */
 
+	GenerateDefault_analyzeWorld (solarSys, world);
+	LoadPlanet (NULL);
+
+	return true;
+}
+
+void
+GenerateDefault_analyzeWorld (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
+{
+	DWORD rand_val;
+	SYSTEM_INFO *sysInfo;
+
 	sysInfo = &solarSys->SysInfo;
 
-	DoPlanetaryAnalysis (sysInfo, world);
-	rand_val = RandomContext_GetSeed (SysGenRNG);
+	DoPlanetaryAnalysis (solarSys, sysInfo, world);
+	rand_val = RandomContext_GetSeed (solarSys->rng);
 
 	sysInfo->PlanetInfo.ScanSeed[BIOLOGICAL_SCAN] = rand_val;
-	GenerateLifeForms (sysInfo, GENERATE_ALL, NULL);
-	rand_val = RandomContext_GetSeed (SysGenRNG);
+	GenerateLifeForms (solarSys, GENERATE_ALL, NULL);
+	rand_val = RandomContext_GetSeed (solarSys->rng);
 
 	sysInfo->PlanetInfo.ScanSeed[MINERAL_SCAN] = rand_val;
-	GenerateMineralDeposits (sysInfo, GENERATE_ALL, NULL);
+	GenerateMineralDeposits (solarSys, GENERATE_ALL, NULL);
 
 	sysInfo->PlanetInfo.ScanSeed[ENERGY_SCAN] = rand_val;
-	LoadPlanet (NULL);
-
-	return true;
 }
 
 COUNT
 GenerateDefault_generateMinerals (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	return GenerateMineralDeposits (&solarSys->SysInfo, whichNode, info);
+	return GenerateMineralDeposits (solarSys, whichNode, info);
 	(void) world;
 }
 
@@ -198,7 +204,7 @@ COUNT
 GenerateDefault_generateLife (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	return GenerateLifeForms (&solarSys->SysInfo, whichNode, info);
+	return GenerateLifeForms (solarSys, whichNode, info);
 	(void) world;
 }
 
@@ -218,7 +224,7 @@ GenerateDefault_generateArtifact (const SOLARSYS_STATE *solarSys,
 		COUNT whichNode, NODE_INFO *info)
 {
 	// Generate an energy node at a random location
-	return GenerateRandomNodes (&solarSys->SysInfo, ENERGY_SCAN, 1, 0,
+	return GenerateRandomNodes (solarSys, ENERGY_SCAN, 1, 0,
 			whichNode, info);
 }
 
@@ -227,7 +233,7 @@ GenerateDefault_generateRuins (const SOLARSYS_STATE *solarSys,
 		COUNT whichNode, NODE_INFO *info)
 {
 	// Generate a standard spread of city ruins of a destroyed civilization
-	return GenerateRandomNodes (&solarSys->SysInfo, ENERGY_SCAN, NUM_RACE_RUINS,
+	return GenerateRandomNodes (solarSys, ENERGY_SCAN, NUM_RACE_RUINS,
 			0, whichNode, info);
 }
 
@@ -298,7 +304,7 @@ GeneratePlanets (SOLARSYS_STATE *solarSys)
 		BYTE num_moons;
 		BYTE type;
 
-		rand_val = RandomContext_Random (SysGenRNG);
+		rand_val = RandomContext_Random (solarSys->rng);
 		byte_val = LOBYTE (rand_val);
 
 		num_moons = 0;
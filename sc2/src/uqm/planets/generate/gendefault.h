@@ -35,6 +35,10 @@ bool GenerateDefault_generateName (const SOLARSYS_STATE *,
 		const PLANET_DESC *world);
 bool GenerateDefault_generateOrbital (SOLARSYS_STATE *solarSys,
 		PLANET_DESC *world);
+// The calculation part of GenerateDefault_generateOrbital(): fills in
+// solarSys->SysInfo for 'world', without loading anything.
+void GenerateDefault_analyzeWorld (SOLARSYS_STATE *solarSys,
+		PLANET_DESC *world);
 COUNT GenerateDefault_generateMinerals (const SOLARSYS_STATE *,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *);
 COUNT GenerateDefault_generateEnergy (const SOLARSYS_STATE *,
@@ -87,11 +87,11 @@ GenerateMycon_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 {
 	if (matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
-		if ((CurStarDescPtr->Index == MYCON_DEFINED
-				|| CurStarDescPtr->Index == SUN_DEVICE_DEFINED)
+		if ((solarSys->star->Index == MYCON_DEFINED
+				|| solarSys->star->Index == SUN_DEVICE_DEFINED)
 				&& StartSphereTracking (MYCON_SHIP))
 		{
-			if (CurStarDescPtr->Index == MYCON_DEFINED
+			if (solarSys->star->Index == MYCON_DEFINED
 					|| !GET_GAME_STATE (SUN_DEVICE_UNGUARDED))
 			{
 				NotifyOthers (MYCON_SHIP, IPNL_ALL_CLEAR);
@@ -99,7 +99,7 @@ GenerateMycon_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 				ReinitQueue (&GLOBAL (ip_group_q));
 				assert (CountLinks (&GLOBAL (npc_built_ship_q)) == 0);
 
-				if (CurStarDescPtr->Index == MYCON_DEFINED
+				if (solarSys->star->Index == MYCON_DEFINED
 						|| !GET_GAME_STATE (MYCON_FELL_FOR_AMBUSH))
 				{
 					CloneShipFragment (MYCON_SHIP,
@@ -115,7 +115,7 @@ GenerateMycon_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 				}
 
 				GLOBAL (CurrentActivity) |= START_INTERPLANETARY;
-				if (CurStarDescPtr->Index == MYCON_DEFINED)
+				if (solarSys->star->Index == MYCON_DEFINED)
 				{
 					SET_GAME_STATE (GLOBAL_FLAGS_AND_DATA, 1 << 7);
 				}
@@ -147,7 +147,7 @@ GenerateMycon_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 			}
 		}
 
-		switch (CurStarDescPtr->Index)
+		switch (solarSys->star->Index)
 		{
 			case SUN_DEVICE_DEFINED:
 				if (!GET_GAME_STATE (SUN_DEVICE))
@@ -190,7 +190,7 @@ static COUNT
 GenerateMycon_generateEnergy (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	if (CurStarDescPtr->Index == SUN_DEVICE_DEFINED
+	if (solarSys->star->Index == SUN_DEVICE_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// This check is redundant since the retrieval bit will keep the
@@ -203,9 +203,9 @@ GenerateMycon_generateEnergy (const SOLARSYS_STATE *solarSys,
 		return GenerateDefault_generateArtifact (solarSys, whichNode, info);
 	}
 
-	if ((CurStarDescPtr->Index == EGG_CASE0_DEFINED
-			|| CurStarDescPtr->Index == EGG_CASE1_DEFINED
-			|| CurStarDescPtr->Index == EGG_CASE2_DEFINED)
+	if ((solarSys->star->Index == EGG_CASE0_DEFINED
+			|| solarSys->star->Index == EGG_CASE1_DEFINED
+			|| solarSys->star->Index == EGG_CASE2_DEFINED)
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// This check is redundant since the retrieval bit will keep the
@@ -227,7 +227,7 @@ static bool
 GenerateMycon_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		COUNT whichNode)
 {
-	if (CurStarDescPtr->Index == SUN_DEVICE_DEFINED
+	if (solarSys->star->Index == SUN_DEVICE_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		assert (!GET_GAME_STATE (SUN_DEVICE) && whichNode == 0);
@@ -242,9 +242,9 @@ GenerateMycon_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		return true; // picked up
 	}
 
-	if ((CurStarDescPtr->Index == EGG_CASE0_DEFINED
-			|| CurStarDescPtr->Index == EGG_CASE1_DEFINED
-			|| CurStarDescPtr->Index == EGG_CASE2_DEFINED)
+	if ((solarSys->star->Index == EGG_CASE0_DEFINED
+			|| solarSys->star->Index == EGG_CASE1_DEFINED
+			|| solarSys->star->Index == EGG_CASE2_DEFINED)
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		assert (whichNode == 0);
@@ -252,7 +252,7 @@ GenerateMycon_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		GenerateDefault_landerReport (solarSys);
 		SetLanderTakeoff ();
 
-		switch (CurStarDescPtr->Index)
+		switch (solarSys->star->Index)
 		{
 			case EGG_CASE0_DEFINED:
 				SET_GAME_STATE (EGG_CASE0_ON_SHIP, 1);
@@ -64,7 +64,7 @@ GenerateOrz_generatePlanets (SOLARSYS_STATE *solarSys)
 
 	GenerateDefault_generatePlanets (solarSys);
 
-	if (CurStarDescPtr->Index == ORZ_DEFINED)
+	if (solarSys->star->Index == ORZ_DEFINED)
 	{
 		solarSys->PlanetDesc[0].data_index = WATER_WORLD;
 		solarSys->PlanetDesc[0].radius = EARTH_RADIUS * 156L / 100;
@@ -83,15 +83,15 @@ GenerateOrz_generatePlanets (SOLARSYS_STATE *solarSys)
 static bool
 GenerateOrz_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 {
-	if ((CurStarDescPtr->Index == ORZ_DEFINED
+	if ((solarSys->star->Index == ORZ_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
-			|| (CurStarDescPtr->Index == TAALO_PROTECTOR_DEFINED
+			|| (solarSys->star->Index == TAALO_PROTECTOR_DEFINED
 			&& matchWorld (solarSys, world, 1, 2)
 			&& !GET_GAME_STATE (TAALO_PROTECTOR)))
 	{
 		COUNT i;
 
-		if ((CurStarDescPtr->Index == ORZ_DEFINED
+		if ((solarSys->star->Index == ORZ_DEFINED
 				|| !GET_GAME_STATE (TAALO_UNPROTECTED))
 				&& StartSphereTracking (ORZ_SHIP))
 		{
@@ -100,7 +100,7 @@ GenerateOrz_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 			ReinitQueue (&GLOBAL (ip_group_q));
 			assert (CountLinks (&GLOBAL (npc_built_ship_q)) == 0);
 
-			if (CurStarDescPtr->Index == ORZ_DEFINED)
+			if (solarSys->star->Index == ORZ_DEFINED)
 			{
 				CloneShipFragment (ORZ_SHIP,
 						&GLOBAL (npc_built_ship_q), INFINITE_FLEET);
@@ -125,7 +125,7 @@ GenerateOrz_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 				BOOLEAN OrzSurvivors;
 
 				OrzSurvivors = GetHeadLink (&GLOBAL (npc_built_ship_q))
-						&& (CurStarDescPtr->Index == ORZ_DEFINED
+						&& (solarSys->star->Index == ORZ_DEFINED
 						|| !GET_GAME_STATE (TAALO_UNPROTECTED));
 
 				GLOBAL (CurrentActivity) &= ~START_INTERPLANETARY;
@@ -140,7 +140,7 @@ GenerateOrz_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 		}
 
 		SET_GAME_STATE (TAALO_UNPROTECTED, 1);
-		if (CurStarDescPtr->Index == TAALO_PROTECTOR_DEFINED)
+		if (solarSys->star->Index == TAALO_PROTECTOR_DEFINED)
 		{
 			LoadStdLanderFont (&solarSys->SysInfo.PlanetInfo);
 			solarSys->PlanetSideFrame[1] =
@@ -169,7 +169,7 @@ static COUNT
 GenerateOrz_generateEnergy (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	if (CurStarDescPtr->Index == TAALO_PROTECTOR_DEFINED
+	if (solarSys->star->Index == TAALO_PROTECTOR_DEFINED
 			&& matchWorld (solarSys, world, 1, 2))
 	{
 		// This check is redundant since the retrieval bit will keep the
@@ -182,7 +182,7 @@ GenerateOrz_generateEnergy (const SOLARSYS_STATE *solarSys,
 		return GenerateDefault_generateArtifact (solarSys, whichNode, info);
 	}
 
-	if (CurStarDescPtr->Index == ORZ_DEFINED
+	if (solarSys->star->Index == ORZ_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		return GenerateDefault_generateRuins (solarSys, whichNode, info);
@@ -195,7 +195,7 @@ static bool
 GenerateOrz_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		COUNT whichNode)
 {
-	if (CurStarDescPtr->Index == TAALO_PROTECTOR_DEFINED
+	if (solarSys->star->Index == TAALO_PROTECTOR_DEFINED
 			&& matchWorld (solarSys, world, 1, 2))
 	{
 		assert (!GET_GAME_STATE (TAALO_PROTECTOR) && whichNode == 0);
@@ -209,7 +209,7 @@ GenerateOrz_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		return true; // picked up
 	}
 
-	if (CurStarDescPtr->Index == ORZ_DEFINED
+	if (solarSys->star->Index == ORZ_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// Standard ruins report
@@ -85,7 +85,7 @@ GenerateRainbowWorld_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *wor
 
 		which_rainbow = 0;
 		SDPtr = &star_array[0];
-		while (SDPtr != CurStarDescPtr)
+		while (SDPtr != solarSys->star)
 		{
 			if (SDPtr->Index == RAINBOW_DEFINED)
 				++which_rainbow;
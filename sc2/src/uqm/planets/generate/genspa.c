@@ -102,7 +102,7 @@ GenerateSpathi_generateMoons (SOLARSYS_STATE *solarSys, PLANET_DESC *planet)
 
 		solarSys->MoonDesc[0].data_index = PELLUCID_WORLD;
 		solarSys->MoonDesc[0].radius = MIN_MOON_RADIUS + MOON_DELTA;
-		angle = NORMALIZE_ANGLE (LOWORD (RandomContext_Random (SysGenRNG)));
+		angle = NORMALIZE_ANGLE (LOWORD (RandomContext_Random (solarSys->rng)));
 		solarSys->MoonDesc[0].location.x =
 				COSINE (angle, solarSys->MoonDesc[0].radius);
 		solarSys->MoonDesc[0].location.y =
@@ -144,15 +144,15 @@ GenerateSpathi_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 			return true;
 		}
 		
-		DoPlanetaryAnalysis (&solarSys->SysInfo, world);
-		rand_val = RandomContext_GetSeed (SysGenRNG);
+		DoPlanetaryAnalysis (solarSys, &solarSys->SysInfo, world);
+		rand_val = RandomContext_GetSeed (solarSys->rng);
 
 		solarSys->SysInfo.PlanetInfo.ScanSeed[BIOLOGICAL_SCAN] = rand_val;
-		GenerateLifeForms (&solarSys->SysInfo, GENERATE_ALL, NULL);
-		rand_val = RandomContext_GetSeed (SysGenRNG);
+		GenerateLifeForms (solarSys, GENERATE_ALL, NULL);
+		rand_val = RandomContext_GetSeed (solarSys->rng);
 
 		solarSys->SysInfo.PlanetInfo.ScanSeed[MINERAL_SCAN] = rand_val;
-		GenerateMineralDeposits (&solarSys->SysInfo, GENERATE_ALL, NULL);
+		GenerateMineralDeposits (solarSys, GENERATE_ALL, NULL);
 
 		solarSys->SysInfo.PlanetInfo.ScanSeed[ENERGY_SCAN] = rand_val;
 
@@ -181,12 +181,12 @@ GenerateSpathi_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 	else if (matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		/* visiting Spathiwa */
-		DoPlanetaryAnalysis (&solarSys->SysInfo, world);
-		rand_val = RandomContext_GetSeed (SysGenRNG);
+		DoPlanetaryAnalysis (solarSys, &solarSys->SysInfo, world);
+		rand_val = RandomContext_GetSeed (solarSys->rng);
 
 		solarSys->SysInfo.PlanetInfo.ScanSeed[MINERAL_SCAN] = rand_val;
-		GenerateMineralDeposits (&solarSys->SysInfo, GENERATE_ALL, NULL);
-		rand_val = RandomContext_GetSeed (SysGenRNG);
+		GenerateMineralDeposits (solarSys, GENERATE_ALL, NULL);
+		rand_val = RandomContext_GetSeed (solarSys->rng);
 
 		solarSys->SysInfo.PlanetInfo.ScanSeed[BIOLOGICAL_SCAN] = rand_val;
 
@@ -253,7 +253,7 @@ GenerateSpathi_generateLife (const SOLARSYS_STATE *solarSys,
 	if (matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		#define NUM_EVIL_ONES  32
-		return GenerateRandomNodes (&solarSys->SysInfo, BIOLOGICAL_SCAN, NUM_EVIL_ONES,
+		return GenerateRandomNodes (solarSys, BIOLOGICAL_SCAN, NUM_EVIL_ONES,
 				NUM_CREATURE_TYPES, whichNode, info);
 	}
 
@@ -64,7 +64,7 @@ GenerateThraddash_generatePlanets (SOLARSYS_STATE *solarSys)
 
 	GenerateDefault_generatePlanets (solarSys);
 
-	if (CurStarDescPtr->Index == AQUA_HELIX_DEFINED)
+	if (solarSys->star->Index == AQUA_HELIX_DEFINED)
 	{
 		solarSys->PlanetDesc[0].data_index = PRIMORDIAL_WORLD;
 		solarSys->PlanetDesc[0].radius = EARTH_RADIUS * 65L / 100;
@@ -75,7 +75,7 @@ GenerateThraddash_generatePlanets (SOLARSYS_STATE *solarSys)
 		solarSys->PlanetDesc[0].location.y =
 				SINE (angle, solarSys->PlanetDesc[0].radius);
 	}
-	else  /* CurStarDescPtr->Index == THRADD_DEFINED */
+	else  /* solarSys->star->Index == THRADD_DEFINED */
 	{
 		solarSys->PlanetDesc[0].data_index = WATER_WORLD;
 		solarSys->PlanetDesc[0].NumPlanets = 0;
@@ -97,7 +97,7 @@ GenerateThraddash_generateOrbital (SOLARSYS_STATE *solarSys,
 	if (matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		if (StartSphereTracking (THRADDASH_SHIP)
-				&& (CurStarDescPtr->Index == THRADD_DEFINED
+				&& (solarSys->star->Index == THRADD_DEFINED
 				|| (!GET_GAME_STATE (HELIX_UNPROTECTED)
 				&& (BYTE)(GET_GAME_STATE (THRADD_MISSION) - 1) >= 3)))
 		{
@@ -110,7 +110,7 @@ GenerateThraddash_generateOrbital (SOLARSYS_STATE *solarSys,
 					INFINITE_FLEET);
 
 			GLOBAL (CurrentActivity) |= START_INTERPLANETARY;
-			if (CurStarDescPtr->Index == THRADD_DEFINED)
+			if (solarSys->star->Index == THRADD_DEFINED)
 			{
 				SET_GAME_STATE (GLOBAL_FLAGS_AND_DATA, 1 << 7);
 			}
@@ -127,7 +127,7 @@ GenerateThraddash_generateOrbital (SOLARSYS_STATE *solarSys,
 			ReinitQueue (&GLOBAL (npc_built_ship_q));
 			GetGroupInfo (GROUPS_RANDOM, GROUP_LOAD_IP);
 
-			if (CurStarDescPtr->Index == THRADD_DEFINED
+			if (solarSys->star->Index == THRADD_DEFINED
 					|| (!GET_GAME_STATE (HELIX_UNPROTECTED)
 					&& (BYTE)(GET_GAME_STATE (THRADD_MISSION) - 1) >= 3))
 				return true;
@@ -135,7 +135,7 @@ GenerateThraddash_generateOrbital (SOLARSYS_STATE *solarSys,
 			RepairSISBorder ();
 		}
 
-		if (CurStarDescPtr->Index == AQUA_HELIX_DEFINED
+		if (solarSys->star->Index == AQUA_HELIX_DEFINED
 				&& !GET_GAME_STATE (AQUA_HELIX))
 		{
 			LoadStdLanderFont (&solarSys->SysInfo.PlanetInfo);
@@ -144,7 +144,7 @@ GenerateThraddash_generateOrbital (SOLARSYS_STATE *solarSys,
 			solarSys->SysInfo.PlanetInfo.DiscoveryString =
 					CaptureStringTable (LoadStringTable (AQUA_STRTAB));
 		}
-		else if (CurStarDescPtr->Index == THRADD_DEFINED)
+		else if (solarSys->star->Index == THRADD_DEFINED)
 		{
 			LoadStdLanderFont (&solarSys->SysInfo.PlanetInfo);
 			solarSys->PlanetSideFrame[1] =
@@ -162,13 +162,13 @@ static COUNT
 GenerateThraddash_generateEnergy (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	if (CurStarDescPtr->Index == THRADD_DEFINED
+	if (solarSys->star->Index == THRADD_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		return GenerateDefault_generateRuins (solarSys, whichNode, info);
 	}
 
-	if (CurStarDescPtr->Index == AQUA_HELIX_DEFINED
+	if (solarSys->star->Index == AQUA_HELIX_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// This check is redundant since the retrieval bit will keep the
@@ -188,7 +188,7 @@ static bool
 GenerateThraddash_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		COUNT whichNode)
 {
-	if (CurStarDescPtr->Index == THRADD_DEFINED
+	if (solarSys->star->Index == THRADD_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// Standard ruins report
@@ -196,7 +196,7 @@ GenerateThraddash_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		return false;
 	}
 
-	if (CurStarDescPtr->Index == AQUA_HELIX_DEFINED
+	if (solarSys->star->Index == AQUA_HELIX_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		assert (!GET_GAME_STATE (AQUA_HELIX) && whichNode == 0);
@@ -61,7 +61,7 @@ const GenerateFunctions generateUtwigFunctions = {
 static bool
 GenerateUtwig_initNpcs (SOLARSYS_STATE *solarSys)
 {
-	if (CurStarDescPtr->Index == BOMB_DEFINED
+	if (solarSys->star->Index == BOMB_DEFINED
 			&& !GET_GAME_STATE (UTWIG_BOMB))
 	{
 		ReinitQueue (&GLOBAL (ip_group_q));
@@ -82,7 +82,7 @@ GenerateUtwig_generatePlanets (SOLARSYS_STATE *solarSys)
 
 	GenerateDefault_generatePlanets (solarSys);
 
-	if (CurStarDescPtr->Index == UTWIG_DEFINED)
+	if (solarSys->star->Index == UTWIG_DEFINED)
 	{
 		solarSys->PlanetDesc[0].data_index = WATER_WORLD;
 		solarSys->PlanetDesc[0].NumPlanets = 1;
@@ -101,13 +101,13 @@ GenerateUtwig_generatePlanets (SOLARSYS_STATE *solarSys)
 static bool
 GenerateUtwig_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 {
-	if ((CurStarDescPtr->Index == UTWIG_DEFINED
+	if ((solarSys->star->Index == UTWIG_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
-			|| (CurStarDescPtr->Index == BOMB_DEFINED
+			|| (solarSys->star->Index == BOMB_DEFINED
 			&& matchWorld (solarSys, world, 5, 1)
 			&& !GET_GAME_STATE (UTWIG_BOMB)))
 	{
-		if ((CurStarDescPtr->Index == UTWIG_DEFINED
+		if ((solarSys->star->Index == UTWIG_DEFINED
 				|| !GET_GAME_STATE (UTWIG_HAVE_ULTRON))
 				&& StartSphereTracking (UTWIG_SHIP))
 		{
@@ -120,7 +120,7 @@ GenerateUtwig_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 					&GLOBAL (npc_built_ship_q), INFINITE_FLEET);
 
 			GLOBAL (CurrentActivity) |= START_INTERPLANETARY;
-			if (CurStarDescPtr->Index == UTWIG_DEFINED)
+			if (solarSys->star->Index == UTWIG_DEFINED)
 			{
 				SET_GAME_STATE (GLOBAL_FLAGS_AND_DATA, 1 << 7);
 			}
@@ -139,7 +139,7 @@ GenerateUtwig_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 			return true;
 		}
 
-		if (CurStarDescPtr->Index == BOMB_DEFINED
+		if (solarSys->star->Index == BOMB_DEFINED
 				&& !GET_GAME_STATE (BOMB_UNPROTECTED)
 				&& StartSphereTracking (DRUUGE_SHIP))
 		{
@@ -179,7 +179,7 @@ GenerateUtwig_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 			}
 		}
 
-		if (CurStarDescPtr->Index == BOMB_DEFINED)
+		if (solarSys->star->Index == BOMB_DEFINED)
 		{
 			LoadStdLanderFont (&solarSys->SysInfo.PlanetInfo);
 			solarSys->PlanetSideFrame[1] =
@@ -199,7 +199,7 @@ GenerateUtwig_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 
 	GenerateDefault_generateOrbital (solarSys, world);
 
-	if (CurStarDescPtr->Index == UTWIG_DEFINED
+	if (solarSys->star->Index == UTWIG_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		solarSys->SysInfo.PlanetInfo.Weather = 1;
@@ -213,13 +213,13 @@ static COUNT
 GenerateUtwig_generateEnergy (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	if (CurStarDescPtr->Index == UTWIG_DEFINED
+	if (solarSys->star->Index == UTWIG_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		return GenerateDefault_generateRuins (solarSys, whichNode, info);
 	}
 
-	if (CurStarDescPtr->Index == BOMB_DEFINED
+	if (solarSys->star->Index == BOMB_DEFINED
 			&& matchWorld (solarSys, world, 5, 1))
 	{
 		// This check is redundant since the retrieval bit will keep the
@@ -239,7 +239,7 @@ static bool
 GenerateUtwig_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		COUNT whichNode)
 {
-	if (CurStarDescPtr->Index == UTWIG_DEFINED
+	if (solarSys->star->Index == UTWIG_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// Standard ruins report
@@ -247,7 +247,7 @@ GenerateUtwig_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		return false;
 	}
 
-	if (CurStarDescPtr->Index == BOMB_DEFINED
+	if (solarSys->star->Index == BOMB_DEFINED
 			&& matchWorld (solarSys, world, 5, 1))
 	{
 		assert (!GET_GAME_STATE (UTWIG_BOMB) && whichNode == 0);
@@ -70,7 +70,7 @@ GenerateVux_generatePlanets (SOLARSYS_STATE *solarSys)
 
 	GenerateDefault_generatePlanets (solarSys);
 
-	if (CurStarDescPtr->Index == MAIDENS_DEFINED)
+	if (solarSys->star->Index == MAIDENS_DEFINED)
 	{
 		GenerateDefault_generatePlanets (solarSys);
 				// XXX: this is the second time that this function is
@@ -87,14 +87,14 @@ GenerateVux_generatePlanets (SOLARSYS_STATE *solarSys)
 	}
 	else
 	{
-		if (CurStarDescPtr->Index == VUX_DEFINED)
+		if (solarSys->star->Index == VUX_DEFINED)
 		{
 			solarSys->PlanetDesc[0].data_index = REDUX_WORLD;
 			solarSys->PlanetDesc[0].NumPlanets = 1;
 			solarSys->PlanetDesc[0].radius = EARTH_RADIUS * 42L / 100;
 			angle = HALF_CIRCLE + OCTANT;
 		}
-		else /* if (CurStarDescPtr->Index == VUX_BEAST_DEFINED) */
+		else /* if (solarSys->star->Index == VUX_BEAST_DEFINED) */
 		{
 			memmove (&solarSys->PlanetDesc[1], &solarSys->PlanetDesc[0],
 					sizeof (solarSys->PlanetDesc[0])
@@ -122,8 +122,8 @@ static bool
 GenerateVux_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 {
 	if ((matchWorld (solarSys, world, 0, MATCH_PLANET)
-			&& (CurStarDescPtr->Index == VUX_DEFINED
-			|| (CurStarDescPtr->Index == MAIDENS_DEFINED
+			&& (solarSys->star->Index == VUX_DEFINED
+			|| (solarSys->star->Index == MAIDENS_DEFINED
 			&& !GET_GAME_STATE (ZEX_IS_DEAD))))
 			&& StartSphereTracking (VUX_SHIP))
 	{
@@ -134,7 +134,7 @@ GenerateVux_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 
 		CloneShipFragment (VUX_SHIP,
 				&GLOBAL (npc_built_ship_q), INFINITE_FLEET);
-		if (CurStarDescPtr->Index == VUX_DEFINED)
+		if (solarSys->star->Index == VUX_DEFINED)
 		{
 			SET_GAME_STATE (GLOBAL_FLAGS_AND_DATA, 1 << 7);
 		}
@@ -154,7 +154,7 @@ GenerateVux_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 			ReinitQueue (&GLOBAL (npc_built_ship_q));
 			GetGroupInfo (GROUPS_RANDOM, GROUP_LOAD_IP);
 
-			if (CurStarDescPtr->Index == VUX_DEFINED
+			if (solarSys->star->Index == VUX_DEFINED
 					|| !GET_GAME_STATE (ZEX_IS_DEAD))
 				return true;
 
@@ -164,7 +164,7 @@ GenerateVux_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 
 	if (matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
-		if (CurStarDescPtr->Index == MAIDENS_DEFINED)
+		if (solarSys->star->Index == MAIDENS_DEFINED)
 		{
 			if (!GET_GAME_STATE (SHOFIXTI_MAIDENS))
 			{
@@ -176,7 +176,7 @@ GenerateVux_generateOrbital (SOLARSYS_STATE *solarSys, PLANET_DESC *world)
 						LoadStringTable (MAIDENS_STRTAB));
 			}
 		}
-		else if (CurStarDescPtr->Index == VUX_BEAST_DEFINED)
+		else if (solarSys->star->Index == VUX_BEAST_DEFINED)
 		{
 			if (!GET_GAME_STATE (VUX_BEAST))
 			{
@@ -212,7 +212,7 @@ static COUNT
 GenerateVux_generateEnergy (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	if (CurStarDescPtr->Index == MAIDENS_DEFINED
+	if (solarSys->star->Index == MAIDENS_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// This check is redundant since the retrieval bit will keep the
@@ -231,7 +231,7 @@ GenerateVux_generateEnergy (const SOLARSYS_STATE *solarSys,
 		return 1; // only matters when count is requested
 	}
 
-	if (CurStarDescPtr->Index == VUX_DEFINED
+	if (solarSys->star->Index == VUX_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		return GenerateDefault_generateRuins (solarSys, whichNode, info);
@@ -244,7 +244,7 @@ static bool
 GenerateVux_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		COUNT whichNode)
 {
-	if (CurStarDescPtr->Index == MAIDENS_DEFINED
+	if (solarSys->star->Index == MAIDENS_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		assert (!GET_GAME_STATE (SHOFIXTI_MAIDENS) && whichNode == 0);
@@ -258,7 +258,7 @@ GenerateVux_pickupEnergy (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		return true; // picked up
 	}
 
-	if (CurStarDescPtr->Index == VUX_DEFINED
+	if (solarSys->star->Index == VUX_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		// Standard ruins report
@@ -274,7 +274,7 @@ static COUNT
 GenerateVux_generateLife (const SOLARSYS_STATE *solarSys,
 		const PLANET_DESC *world, COUNT whichNode, NODE_INFO *info)
 {
-	if (CurStarDescPtr->Index == MAIDENS_DEFINED
+	if (solarSys->star->Index == MAIDENS_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		static const SBYTE life[] =
@@ -284,10 +284,10 @@ GenerateVux_generateLife (const SOLARSYS_STATE *solarSys,
 			18, 18, 18, 18, /* Penguin Cyclops */
 			-1 /* term */
 		};
-		return GeneratePresetLife (&solarSys->SysInfo, life, whichNode, info);
+		return GeneratePresetLife (solarSys, life, whichNode, info);
 	}
 
-	if (CurStarDescPtr->Index == VUX_BEAST_DEFINED
+	if (solarSys->star->Index == VUX_BEAST_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		static const SBYTE life[] =
@@ -298,7 +298,7 @@ GenerateVux_generateLife (const SOLARSYS_STATE *solarSys,
 			8, 8, 8, 8, 8, /* Glowing Medusa */
 			-1 /* term */
 		};
-		return GeneratePresetLife (&solarSys->SysInfo, life, whichNode, info);
+		return GeneratePresetLife (solarSys, life, whichNode, info);
 	}
 
 	return GenerateDefault_generateLife (solarSys, world, whichNode, info);
@@ -308,7 +308,7 @@ static bool
 GenerateVux_pickupLife (SOLARSYS_STATE *solarSys, PLANET_DESC *world,
 		COUNT whichNode)
 {
-	if (CurStarDescPtr->Index == VUX_BEAST_DEFINED
+	if (solarSys->star->Index == VUX_BEAST_DEFINED
 			&& matchWorld (solarSys, world, 0, MATCH_PLANET))
 	{
 		if (whichNode == 0)
@@ -494,7 +494,7 @@ char scolor[] = {'B', 'G', 'O', 'R', 'W', 'Y'};
 
 	pPD = pBaseDesc;
 	StarSize = system->SunDesc[0].data_index;
-	StarColor = STAR_COLOR (CurStarDescPtr->Type);
+	StarColor = STAR_COLOR (system->star->Type);
 
 	if (NumPlanets == (BYTE)~0)
 	{
@@ -504,17 +504,17 @@ char scolor[] = {'B', 'G', 'O', 'R', 'W', 'Y'};
 		//   we spin in a loop until the result > 0.
 		//   Note that this behavior must be kept to preserve the universe.
 		do
-			NumPlanets = LOWORD (RandomContext_Random (SysGenRNG))
+			NumPlanets = LOWORD (RandomContext_Random (system->rng))
 					% (MAX_GENERATED_PLANETS + 1);
 		while (NumPlanets == 0);
 		system->SunDesc[0].NumPlanets = NumPlanets;
 	}
 
 #ifdef DEBUG_ORBITS
-	GetClusterName (CurStarDescPtr, buf);
+	GetClusterName (system->star, buf);
 	log_add (log_Debug, "cluster name = %s  color = %c type = %c", buf,
-			scolor[STAR_COLOR (CurStarDescPtr->Type)],
-			stype[STAR_TYPE (CurStarDescPtr->Type)]);
+			scolor[STAR_COLOR (system->star->Type)],
+			stype[STAR_TYPE (system->star->Type)]);
 #endif /* DEBUG_ORBITS */
 	GeneratingMoons = (BOOLEAN) (pBaseDesc == system->MoonDesc);
 	if (GeneratingMoons)
@@ -532,7 +532,7 @@ char scolor[] = {'B', 'G', 'O', 'R', 'W', 'Y'};
 
 		do
 		{
-			rand_val = RandomContext_Random (SysGenRNG);
+			rand_val = RandomContext_Random (system->rng);
 			if (TypesDefined)
 				rand_val = 0;
 			else
@@ -568,7 +568,7 @@ char scolor[] = {'B', 'G', 'O', 'R', 'W', 'Y'};
 		else
 			min_radius = Suns[StarSize].MinGasGDist;
 RelocatePlanet:
-		rand_val = RandomContext_Random (SysGenRNG);
+		rand_val = RandomContext_Random (system->rng);
 		if (GeneratingMoons)
 		{
 			pPD->radius = MIN_MOON_RADIUS
@@ -596,7 +596,7 @@ RelocatePlanet:
 			}
 		}
 
-		rand_val = RandomContext_Random (SysGenRNG);
+		rand_val = RandomContext_Random (system->rng);
 		angle = NORMALIZE_ANGLE (LOWORD (rand_val));
 		pPD->location.x = COSINE (angle, pPD->radius);
 		pPD->location.y = SINE (angle, pPD->radius);
@@ -234,6 +234,13 @@ struct solarsys_state
 	const GenerateFunctions *genFuncs;
 			// Functions to call to fill in various parts of this structure.
 			// See generate.h, doc/devel/generate
+	STAR_DESC *star;
+			// The star of this system.
+	RandomContext *rng;
+			// Random context used to generate this system, its worlds,
+			// and their surface nodes. SysGenRNG for the system the
+			// player is in; other systems may be generated with their
+			// own context, on any thread.
 
 	FRAME PlanetSideFrame[3 + MAX_LIFE_VARIATION];
 			/* Frames for planet-side elements.
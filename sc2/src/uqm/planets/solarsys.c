@@ -212,7 +212,7 @@ playerInInnerSystem (void)
 	return pSolarSysState->pBaseDesc != pSolarSysState->PlanetDesc;
 }
 
-// Sets the SysGenRNG to the required state first.
+// Sets the system's random context to the required state first.
 static void
 GenerateMoons (SOLARSYS_STATE *system, PLANET_DESC *planet)
 {
@@ -220,7 +220,7 @@ GenerateMoons (SOLARSYS_STATE *system, PLANET_DESC *planet)
 	COUNT facing;
 	PLANET_DESC *pMoonDesc;
 
-	RandomContext_SeedRandom (SysGenRNG, planet->rand_seed);
+	RandomContext_SeedRandom (system->rng, planet->rand_seed);
 
 	(*system->genFuncs->generateName) (system, planet);
 	(*system->genFuncs->generateMoons) (system, planet);
@@ -415,7 +415,7 @@ LoadSolarSys (void)
 			COUNT index;
 			SYSTEM_INFO SysInfo;
 
-			DoPlanetaryAnalysis (&SysInfo, pCurDesc);
+			DoPlanetaryAnalysis (pSolarSysState, &SysInfo, pCurDesc);
 			index = (SysInfo.PlanetInfo.SurfaceTemperature + 250) / 100;
 			if (index >= NUM_TEMP_RANGES)
 				index = NUM_TEMP_RANGES - 1;
@@ -1317,13 +1317,16 @@ InitSolarSys (void)
 {
 	BOOLEAN InnerSystem;
 	BOOLEAN Reentry;
+	BOOLEAN NewSystem;
 	PLANET_DESC *orbital;
 
 
 	LoadIPData ();
 	LoadLanderData ();
+	pSolarSysState->rng = SysGenRNG;
 
 	Reentry = (GLOBAL (ShipFacing) != 0);
+	NewSystem = !Reentry && !(LastActivity & CHECK_LOAD);
 	if (!Reentry)
 	{
 		GLOBAL (autopilot.x) = ~0;
@@ -1408,6 +1411,9 @@ InitSolarSys (void)
 			LastActivity &= ~CHECK_LOAD;
 		}
 	}
+
+	if (NewSystem && !orbital)
+		AutoSaveGame ();
 }
 
 static void
@@ -1735,6 +1741,7 @@ ExploreSolarSys (void)
 	memset (pSolarSysState, 0, sizeof (*pSolarSysState));
 
 	SolarSysState.genFuncs = getGenerateFunctions (CurStarDescPtr->Index);
+	SolarSysState.star = CurStarDescPtr;
 
 	InitSolarSys ();
 	SetMenuSounds (MENU_SOUND_NONE, MENU_SOUND_NONE);
@@ -21,6 +21,7 @@
 
 #include "plandata.h"
 #include "libs/compiler.h"
+#include "libs/mathlib.h"
 
 #if defined(__cplusplus)
 extern "C" {
@@ -45,15 +46,15 @@ typedef struct
 
 #define GENERATE_ALL  ((COUNT)~0)
 		
-extern COUNT GenerateMineralDeposits (const SYSTEM_INFO *, COUNT whichDeposit,
+extern COUNT GenerateMineralDeposits (const SOLARSYS_STATE *,
+		COUNT whichDeposit, NODE_INFO *info);
+extern COUNT GenerateLifeForms (const SOLARSYS_STATE *, COUNT whichLife,
 		NODE_INFO *info);
-extern COUNT GenerateLifeForms (const SYSTEM_INFO *, COUNT whichLife,
-		NODE_INFO *info);
-extern void GenerateRandomLocation (POINT *loc);
-extern COUNT GenerateRandomNodes (const SYSTEM_INFO *, COUNT scan, COUNT numNodes,
-		COUNT type, COUNT whichNode, NODE_INFO *info);
+extern void GenerateRandomLocation (RandomContext *rng, POINT *loc);
+extern COUNT GenerateRandomNodes (const SOLARSYS_STATE *, COUNT scan,
+		COUNT numNodes, COUNT type, COUNT whichNode, NODE_INFO *info);
 // Generate lifeforms from a preset lifeTypes[] array
-extern COUNT GeneratePresetLife (const SYSTEM_INFO *,
+extern COUNT GeneratePresetLife (const SOLARSYS_STATE *,
 		const SBYTE *lifeTypes, COUNT whichLife, NODE_INFO *info);
 
 #define DWARF_ELEMENT_DENSITY  1
@@ -62,8 +63,8 @@ extern COUNT GeneratePresetLife (const SYSTEM_INFO *,
 
 #define MAX_ELEMENT_DENSITY ((MAX_ELEMENT_UNITS * SUPERGIANT_ELEMENT_DENSITY) << 1)
 
-extern void DoPlanetaryAnalysis (SYSTEM_INFO *SysInfoPtr,
-		PLANET_DESC *pPlanetDesc);
+extern void DoPlanetaryAnalysis (const SOLARSYS_STATE *system,
+		SYSTEM_INFO *SysInfoPtr, PLANET_DESC *pPlanetDesc);
 
 #if defined(__cplusplus)
 }
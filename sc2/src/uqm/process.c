@@ -33,6 +33,7 @@
 #include "libs/graphics/gfx_common.h"
 #include "libs/log.h"
 #include "libs/misc.h"
+#include "libs/perflib.h"
 
 
 //#define DEBUG_PROCESS
@@ -384,6 +385,8 @@ ProcessCollisions (HELEMENT hSuccElement, ELEMENT *ElementPtr,
 			ELEMENT_FLAGS state_flags, test_state_flags;
 			TIME_VALUE time_val;
 
+			perf_inc (PERF_COLLISION_PAIRS);
+
 			state_flags = ElementPtr->state_flags;
 			test_state_flags = TestElementPtr->state_flags;
 			if (((state_flags | test_state_flags) & FINITE_LIFE)
@@ -202,6 +202,7 @@ typedef struct
 
 
 typedef struct race_desc RACE_DESC;
+typedef struct ship_media SHIP_MEDIA;
 
 typedef void (PREPROCESS_FUNC) (ELEMENT *ElementPtr);
 typedef void (POSTPROCESS_FUNC) (ELEMENT *ElementPtr);
@@ -224,6 +225,8 @@ struct race_desc
 	void* data;  // private ship data, ship code owns this
 
 	void *CodeRef;
+	SHIP_MEDIA *MediaRef;
+			// The battle data, shared with other ships; see loadship.c
 };
 
 #define SHIP_BASE_COMMON \
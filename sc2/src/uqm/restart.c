@@ -28,6 +28,7 @@
 #include "globdata.h"
 #include "intel.h"
 #include "supermelee/melee.h"
+#include "supermelee/replay.h"
 #include "resinst.h"
 #include "nameref.h"
 #include "save.h"
@@ -36,6 +37,10 @@
 #include "sounds.h"
 #include "setupmenu.h"
 #include "util.h"
+#include "uqmbench.h"
+#ifdef NETPLAY
+#	include "supermelee/netplay/netoptions.h"
+#endif
 #include "starcon.h"
 #include "uqmversion.h"
 #include "libs/graphics/gfx_common.h"
@@ -344,6 +349,29 @@ TryStartGame (void)
 	LastActivity = GLOBAL (CurrentActivity);
 	GLOBAL (CurrentActivity) = 0;
 
+	if (benchFile != NULL)
+	{
+		// Run the benchmarks, and quit.
+		finishBenchmarks ();
+		GLOBAL (CurrentActivity) = CHECK_ABORT;
+		return (FALSE);
+	}
+
+	if (replayOptions.playFile != NULL
+#ifdef NETPLAY
+			|| netplayOptions.spectateHost != NULL
+#endif
+			)
+	{
+		// Play back a recorded SuperMelee match, or watch network
+		// matches, and quit.
+		GLOBAL (CurrentActivity) = SUPER_MELEE;
+		FreeGameData ();
+		Melee ();
+		GLOBAL (CurrentActivity) = CHECK_ABORT;
+		return (FALSE);
+	}
+
 	memset (&MenuState, 0, sizeof (MenuState));
 	MenuState.InputFunc = DoRestart;
 
@@ -17,6 +17,7 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include "save.h"
 
@@ -41,70 +42,101 @@
 #include "libs/inplib.h"
 #include "libs/log.h"
 #include "libs/memlib.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
+#include "libs/uio.h"
 
-// Status boolean. If for some insane reason you need to
-// save games in different threads, you'll need to
-// protect your calls to SaveGame with a mutex.
+// The save file is first built in memory, so that the game thread does
+// not have to wait for the disk. A separate thread then writes it out.
+// If for some insane reason you need to save games in different
+// threads, you'll need to protect your calls to SaveGame with a mutex.
 
-// It's arguably over-paranoid to check for error on
-// every single write, but this preserves the older
-// behavior.
+typedef struct
+{
+	BYTE *data;
+	DWORD used;
+	DWORD size;
+	char fileName[32];
+} SAVE_BUFFER;
+
+// Initial size of a SAVE_BUFFER; a typical save is a bit smaller.
+#define SAVE_BUFFER_SIZE 0x10000
 
-static BOOLEAN io_ok = TRUE;
+static Semaphore saveWriteDone;
+static BOOLEAN saveWritePending;
+static volatile BOOLEAN saveWriteOk = TRUE;
+
+static void
+grow_buffer (SAVE_BUFFER *sb, DWORD bytes)
+{
+	DWORD newSize = sb->size ? sb->size : SAVE_BUFFER_SIZE;
+
+	while (sb->used + bytes > newSize)
+		newSize *= 2;
+	sb->data = HRealloc (sb->data, newSize);
+	sb->size = newSize;
+}
 
-// XXX: these should handle endian conversions later
+static inline BYTE *
+reserve_bytes (SAVE_BUFFER *sb, DWORD bytes)
+{
+	BYTE *p;
+
+	if (sb->used + bytes > sb->size)
+		grow_buffer (sb, bytes);
+	p = sb->data + sb->used;
+	sb->used += bytes;
+	return p;
+}
+
+// Values are stored little endian.
 static inline void
-write_8 (void *fp, BYTE v)
+write_8 (SAVE_BUFFER *sb, BYTE v)
 {
-	if (io_ok)
-		if (WriteResFile (&v, 1, 1, fp) != 1)
-			io_ok = FALSE;
+	BYTE *p = reserve_bytes (sb, 1);
+	p[0] = v;
 }
 
 static inline void
-write_16 (void *fp, UWORD v)
+write_16 (SAVE_BUFFER *sb, UWORD v)
 {
-	write_8 (fp, (BYTE)( v        & 0xff));
-	write_8 (fp, (BYTE)((v >>  8) & 0xff));
+	BYTE *p = reserve_bytes (sb, 2);
+	p[0] = (BYTE)( v        & 0xff);
+	p[1] = (BYTE)((v >>  8) & 0xff);
 }
 
 static inline void
-write_32 (void *fp, DWORD v)
+write_32 (SAVE_BUFFER *sb, DWORD v)
 {
-	write_8 (fp, (BYTE)( v        & 0xff));
-	write_8 (fp, (BYTE)((v >>  8) & 0xff));
-	write_8 (fp, (BYTE)((v >> 16) & 0xff));
-	write_8 (fp, (BYTE)((v >> 24) & 0xff));
+	BYTE *p = reserve_bytes (sb, 4);
+	p[0] = (BYTE)( v        & 0xff);
+	p[1] = (BYTE)((v >>  8) & 0xff);
+	p[2] = (BYTE)((v >> 16) & 0xff);
+	p[3] = (BYTE)((v >> 24) & 0xff);
 }
 
 static inline void
-write_a8 (void *fp, const BYTE *ar, COUNT count)
+write_a8 (SAVE_BUFFER *sb, const BYTE *ar, COUNT count)
 {
-	if (io_ok)
-		if (WriteResFile (ar, 1, count, fp) != count)
-			io_ok = FALSE;
+	memcpy (reserve_bytes (sb, count), ar, count);
 }
 
 static inline void
-write_str (void *fp, const char *str, COUNT count)
+write_str (SAVE_BUFFER *sb, const char *str, COUNT count)
 {
 	// no type conversion needed for strings
-	write_a8 (fp, (const BYTE *)str, count);
+	write_a8 (sb, (const BYTE *)str, count);
 }
 
 static inline void
-write_a16 (void *fp, const UWORD *ar, COUNT count)
+write_a16 (SAVE_BUFFER *sb, const UWORD *ar, COUNT count)
 {
 	for ( ; count > 0; --count, ++ar)
-	{
-		if (!io_ok)
-			break;
-		write_16 (fp, *ar);
-	}
+		write_16 (sb, *ar);
 }
 
 static void
-SaveShipQueue (uio_Stream *fh, QUEUE *pQueue, DWORD tag)
+SaveShipQueue (SAVE_BUFFER *fh, QUEUE *pQueue, DWORD tag)
 {
 	COUNT num_links;
 	HSHIPFRAG hStarShip;
@@ -145,7 +177,7 @@ SaveShipQueue (uio_Stream *fh, QUEUE *pQueue, DWORD tag)
 }
 
 static void
-SaveRaceQueue (uio_Stream *fh, QUEUE *pQueue)
+SaveRaceQueue (SAVE_BUFFER *fh, QUEUE *pQueue)
 {
 	COUNT num_links;
 	HFLEETINFO hFleet;
@@ -197,7 +229,7 @@ SaveRaceQueue (uio_Stream *fh, QUEUE *pQueue)
 }
 
 static void
-SaveGroupQueue (uio_Stream *fh, QUEUE *pQueue)
+SaveGroupQueue (SAVE_BUFFER *fh, QUEUE *pQueue)
 {
 	HIPGROUP hGroup, hNextGroup;
 	COUNT num_links;
@@ -231,7 +263,7 @@ SaveGroupQueue (uio_Stream *fh, QUEUE *pQueue)
 }
 
 static void
-SaveEncounters (uio_Stream *fh)
+SaveEncounters (SAVE_BUFFER *fh)
 {
 	COUNT num_links;
 	HENCOUNTER hEncounter;
@@ -283,38 +315,34 @@ SaveEncounters (uio_Stream *fh)
 }
 
 static void
-SaveEvents (uio_Stream *fh)
+SaveEvent (const EVENT *EventPtr, void *arg)
 {
-	COUNT num_links;
-	HEVENT hEvent;
-	num_links = CountLinks (&GLOBAL (GameClock.event_q));
-	if (num_links == 0)
-		return;
-	write_32 (fh, EVENTS_TAG);
-	write_32 (fh, num_links * 5); /* Event chunks are five bytes each */
+	SAVE_BUFFER *fh = (SAVE_BUFFER *) arg;
 
-	hEvent = GetHeadLink (&GLOBAL (GameClock.event_q));
-	while (num_links--)
-	{
-		HEVENT hNextEvent;
-		EVENT *EventPtr;
-
-		LockEvent (hEvent, &EventPtr);
-		hNextEvent = GetSuccEvent (EventPtr);
+	write_8   (fh, EventPtr->day_index);
+	write_8   (fh, EventPtr->month_index);
+	write_16  (fh, EventPtr->year_index);
+	write_8   (fh, EventPtr->func_index);
+}
 
-		write_8   (fh, EventPtr->day_index);
-		write_8   (fh, EventPtr->month_index);
-		write_16  (fh, EventPtr->year_index);
-		write_8   (fh, EventPtr->func_index);
+static void
+SaveEvents (SAVE_BUFFER *fh)
+{
+	COUNT num_events;
+	num_events = CountEvents ();
+	if (num_events == 0)
+		return;
+	write_32 (fh, EVENTS_TAG);
+	write_32 (fh, num_events * 5); /* Event chunks are five bytes each */
 
-		UnlockEvent (hEvent);
-		hEvent = hNextEvent;
-	}
+	// Written in date order, as earlier versions load them as they are
+	// into a sorted list.
+	ForAllEvents (SaveEvent, fh);
 }
 
 /* The clock state is folded in with the game state chunk. */
 static void
-SaveClockState (const CLOCK_STATE *ClockPtr, uio_Stream *fh)
+SaveClockState (const CLOCK_STATE *ClockPtr, SAVE_BUFFER *fh)
 {
 	write_8   (fh, ClockPtr->day_index);
 	write_8   (fh, ClockPtr->month_index);
@@ -327,7 +355,7 @@ SaveClockState (const CLOCK_STATE *ClockPtr, uio_Stream *fh)
  * State chunk is fixed size, but the Game State tag can be extended
  * by modders. */
 static void
-SaveGameState (const GAME_STATE *GSPtr, uio_Stream *fh)
+SaveGameState (const GAME_STATE *GSPtr, SAVE_BUFFER *fh)
 {
 	write_32  (fh, GLOBAL_STATE_TAG);
 	write_32  (fh, 75);
@@ -372,7 +400,7 @@ SaveGameState (const GAME_STATE *GSPtr, uio_Stream *fh)
 
 /* This is folded into the Summary chunk */
 static void
-SaveSisState (const SIS_STATE *SSPtr, void *fp)
+SaveSisState (const SIS_STATE *SSPtr, SAVE_BUFFER *fp)
 {
 	write_32  (fp, SSPtr->log_x);
 	write_32  (fp, SSPtr->log_y);
@@ -395,7 +423,7 @@ SaveSisState (const SIS_STATE *SSPtr, void *fp)
 /* Write out the Summary Chunk. This is variable length because of the
    savegame name */
 static void
-SaveSummary (const SUMMARY_DESC *SummPtr, void *fp)
+SaveSummary (const SUMMARY_DESC *SummPtr, SAVE_BUFFER *fp)
 {
 	write_32 (fp, SUMMARY_TAG);
 	write_32 (fp, 160 + strlen(SummPtr->SaveName));
@@ -419,7 +447,7 @@ SaveSummary (const SUMMARY_DESC *SummPtr, void *fp)
  * the Star *Info* chunk, which records which planetary features you
  * have exploited with your lander */
 static void
-SaveStarDesc (const STAR_DESC *SDPtr, uio_Stream *fh)
+SaveStarDesc (const STAR_DESC *SDPtr, SAVE_BUFFER *fh)
 {
 	write_32 (fh, STAR_TAG);
 	write_32 (fh, 8);
@@ -589,7 +617,7 @@ SaveFlagshipState (void)
 }
 
 static void
-SaveStarInfo (uio_Stream *fh)
+SaveStarInfo (SAVE_BUFFER *fh)
 {
 	GAME_STATE_FILE *fp;
 	fp = OpenStateFile (STARINFO_FILE, "rb");
@@ -602,14 +630,31 @@ SaveStarInfo (uio_Stream *fh)
 		}
 		else
 		{
+			DWORD *dst;
+			DWORD left;
+
 			write_32 (fh, SCAN_TAG);
 			write_32 (fh, flen);
-			while (flen)
+			// The state file holds native DWORDs; copy them in bulk.
+			// The chunks keep the count within a COUNT.
+			dst = (DWORD *) reserve_bytes (fh, flen);
+			for (left = flen / 4; left > 0; )
 			{
-				DWORD val;
-				sread_32 (fp, &val);
-				write_32 (fh, val);
-				flen -= 4;
+				COUNT count = left > 0x4000 ? 0x4000 : (COUNT) left;
+				ReadStateFile (dst, 4, count, fp);
+#ifdef WORDS_BIGENDIAN
+				{
+					COUNT i;
+					for (i = 0; i < count; ++i)
+					{	// to little endian
+						DWORD v = dst[i];
+						dst[i] = (v >> 24) | ((v >> 8) & 0xff00)
+								| ((v << 8) & 0xff0000) | (v << 24);
+					}
+				}
+#endif
+				dst += count;
+				left -= count;
 			}
 		}
 		CloseStateFile (fp);
@@ -617,7 +662,7 @@ SaveStarInfo (uio_Stream *fh)
 }
 
 static void
-SaveBattleGroup (GAME_STATE_FILE *fp, DWORD encounter_id, DWORD grpoffs, uio_Stream *fh)
+SaveBattleGroup (GAME_STATE_FILE *fp, DWORD encounter_id, DWORD grpoffs, SAVE_BUFFER *fh)
 {
 	GROUP_HEADER h;
 	DWORD size = 12;
@@ -669,7 +714,7 @@ SaveBattleGroup (GAME_STATE_FILE *fp, DWORD encounter_id, DWORD grpoffs, uio_Str
 }
 
 static void
-SaveGroups (uio_Stream *fh)
+SaveGroups (SAVE_BUFFER *fh)
 {
 	GAME_STATE_FILE *fp;
 	fp = OpenStateFile (RANDGRPINFO_FILE, "rb");
@@ -727,15 +772,86 @@ SaveGroups (uio_Stream *fh)
 	}
 }
 
-// This function first writes to a memory file, and then writes the whole
-// lot to the actual save file at once.
+// Writes the save buffer to a temporary file, which then replaces the
+// actual save file, so that a failed write does not destroy the previous
+// save. Frees the buffer.
+static BOOLEAN
+WriteSaveBuffer (SAVE_BUFFER *sb)
+{
+	char tmpFile[sizeof (sb->fileName) + 4];
+	uio_Stream *out_fp;
+	BOOLEAN ok = FALSE;
+
+	sprintf (tmpFile, "%s.tmp", sb->fileName);
+	out_fp = res_OpenResFile (saveDir, tmpFile, "wb");
+	if (out_fp)
+	{
+		ok = WriteResFile (sb->data, 1, sb->used, out_fp) == sb->used;
+		if (!res_CloseResFile (out_fp))
+			ok = FALSE;
+
+		// uio_rename() does not replace existing files. Should we crash
+		// right in between, the complete .tmp file is still there.
+		if (ok && fileExists2 (saveDir, sb->fileName)
+				&& !DeleteResFile (saveDir, sb->fileName))
+			ok = FALSE;
+		if (ok && uio_rename (saveDir, tmpFile, saveDir, sb->fileName) != 0)
+			ok = FALSE;
+		if (!ok)
+			DeleteResFile (saveDir, tmpFile);
+	}
+
+	if (!ok)
+		log_add (log_Error, "Error: Could not write saved game '%s'.",
+				sb->fileName);
+
+	HFree (sb->data);
+	HFree (sb);
+	return ok;
+}
+
+static int
+SaveWriterFunc (void *data)
+{
+	saveWriteOk = WriteSaveBuffer (data);
+	ClearSemaphore (saveWriteDone);
+	return 0;
+}
+
+BOOLEAN
+WaitSaveGameWrite (void)
+{
+	BOOLEAN ok;
+
+	if (saveWritePending)
+	{
+		SetSemaphore (saveWriteDone);
+		saveWritePending = FALSE;
+	}
+	ok = saveWriteOk;
+	// Each failure is reported once.
+	saveWriteOk = TRUE;
+	return ok;
+}
+
+// The game is serialized into a memory buffer, which is written to the
+// save file in the background.
 BOOLEAN
 SaveGame (COUNT which_game, SUMMARY_DESC *SummPtr, const char *name)
 {
-	uio_Stream *out_fp;
+	SAVE_BUFFER *out_fp;
 	POINT pt;
 	STAR_DESC SD;
-	char file[PATH_MAX];
+	uint64 startTime;
+
+	startTime = GetPerfCounter ();
+
+	// The previous save may still be on its way to disk.
+	WaitSaveGameWrite ();
+	if (!saveWriteDone)
+		saveWriteDone = CreateSemaphore (0, "SaveGame write",
+				SYNC_CLASS_TOPLEVEL);
+
 	if (CurStarDescPtr)
 		SD = *CurStarDescPtr;
 	else
@@ -749,65 +865,206 @@ SaveGame (COUNT which_game, SUMMARY_DESC *SummPtr, const char *name)
 			& (START_ENCOUNTER | START_INTERPLANETARY)))
 		PutGroupInfo (GROUPS_RANDOM, GROUP_SAVE_IP);
 
-	// Write the memory file to the actual savegame file.
-	sprintf (file, "uqmsave.%02u", which_game);
-	if ((out_fp = res_OpenResFile (saveDir, file, "wb")))
+	out_fp = HCalloc (sizeof (*out_fp));
+	sprintf (out_fp->fileName, "uqmsave.%02u", which_game);
+	grow_buffer (out_fp, SAVE_BUFFER_SIZE);
+
+	write_32 (out_fp, SAVEFILE_TAG);
+
+	PrepareSummary (SummPtr, name);
+	SaveSummary (SummPtr, out_fp);
+
+	SaveGameState (&GlobData.Game_state, out_fp);
+
+	// XXX: Restore
+	GLOBAL (ip_location) = pt;
+	// Only relevant when loading a game and must be cleaned
+	GLOBAL (in_orbit) = 0;
+
+	SaveRaceQueue (out_fp, &GLOBAL (avail_race_q));
+	// START_INTERPLANETARY is only set when saving from Homeworld
+	//   encounter screen. When the game is loaded, the
+	//   GenerateOrbitalFunction for the current star system
+	//   create the encounter anew and populate the npc queue.
+	if (!(GLOBAL (CurrentActivity) & START_INTERPLANETARY))
 	{
-		io_ok = TRUE;
-		write_32 (out_fp, SAVEFILE_TAG);
+		if (GLOBAL (CurrentActivity) & START_ENCOUNTER)
+			SaveShipQueue (out_fp, &GLOBAL (npc_built_ship_q), NPC_SHIP_Q_TAG);
+		else if (LOBYTE (GLOBAL (CurrentActivity)) == IN_INTERPLANETARY)
+			// XXX: Technically, this queue does not need to be
+			//   saved/loaded at all. IP groups will be reloaded
+			//   from group state files. But the original code did,
+			//   and so will we until we can prove we do not need to.
+			SaveGroupQueue (out_fp, &GLOBAL (ip_group_q));
+	}
+	SaveShipQueue (out_fp, &GLOBAL (built_ship_q), SHIP_Q_TAG);
+
+	// Save the game event chunk
+	SaveEvents (out_fp);
 
-		PrepareSummary (SummPtr, name);
-		SaveSummary (SummPtr, out_fp);
+	// Save the encounter chunk (black globes in HS/QS)
+	SaveEncounters (out_fp);
+
+	// Save out the data that used to be in state files
+	SaveStarInfo (out_fp);
+	SaveGroups (out_fp);
+
+	// Save out the Star Descriptor
+	SaveStarDesc (&SD, out_fp);
+
+	log_add (log_Debug, "SaveGame(): %lu bytes serialized in %.2f ms",
+			(unsigned long) out_fp->used,
+			(double) (GetPerfCounter () - startTime) * 1000.0
+			/ GetPerfFrequency ());
+
+	saveWritePending = TRUE;
+	if (!CreateThread (SaveWriterFunc, out_fp, 0, "SaveGame writer"))
+	{
+		log_add (log_Warning, "Warning: Could not start a thread to "
+				"write the saved game; writing it right away.");
+		saveWritePending = FALSE;
+		return WriteSaveBuffer (out_fp);
+	}
 
-		SaveGameState (&GlobData.Game_state, out_fp);
+	return TRUE;
+}
 
-		// XXX: Restore
-		GLOBAL (ip_location) = pt;
-		// Only relevant when loading a game and must be cleaned
-		GLOBAL (in_orbit) = 0;
+// The parts of the running game that SaveGame() changes on the way.
+// SaveFlagshipState() and PutGroupInfo() bring the location and the
+// state files up to date, as the game itself does when the player
+// leaves the system or the orbit. Doing that in the middle of play
+// would change how the game goes on, so an autosave puts these back.
+typedef struct
+{
+	STATE_FILE_COPY stateFiles[DEFGRPINFO_FILE + 1];
+	BYTE gameState[sizeof (GLOBAL (GameState))];
+	POINT ip_location;
+	UWORD ShipFacing;
+	BYTE ip_planet;
+	BYTE in_orbit;
+	BYTE lastEncGroup;
+} SAVE_SIDE_EFFECTS;
+
+static BOOLEAN
+CaptureSaveSideEffects (SAVE_SIDE_EFFECTS *se)
+{
+	int i;
 
-		SaveRaceQueue (out_fp, &GLOBAL (avail_race_q));
-		// START_INTERPLANETARY is only set when saving from Homeworld
-		//   encounter screen. When the game is loaded, the
-		//   GenerateOrbitalFunction for the current star system
-		//   create the encounter anew and populate the npc queue.
-		if (!(GLOBAL (CurrentActivity) & START_INTERPLANETARY))
+	for (i = 0; i <= DEFGRPINFO_FILE; ++i)
+	{
+		if (!CopyStateFile (i, &se->stateFiles[i]))
 		{
-			if (GLOBAL (CurrentActivity) & START_ENCOUNTER)
-				SaveShipQueue (out_fp, &GLOBAL (npc_built_ship_q), NPC_SHIP_Q_TAG);
-			else if (LOBYTE (GLOBAL (CurrentActivity)) == IN_INTERPLANETARY)
-				// XXX: Technically, this queue does not need to be
-				//   saved/loaded at all. IP groups will be reloaded
-				//   from group state files. But the original code did,
-				//   and so will we until we can prove we do not need to.
-				SaveGroupQueue (out_fp, &GLOBAL (ip_group_q));
+			while (i-- > 0)
+				HFree (se->stateFiles[i].data);
+			return FALSE;
 		}
-		SaveShipQueue (out_fp, &GLOBAL (built_ship_q), SHIP_Q_TAG);
+	}
+	memcpy (se->gameState, GLOBAL (GameState), sizeof (se->gameState));
+	se->ip_location = GLOBAL (ip_location);
+	se->ShipFacing = GLOBAL (ShipFacing);
+	se->ip_planet = GLOBAL (ip_planet);
+	se->in_orbit = GLOBAL (in_orbit);
+	se->lastEncGroup = GetLastEncGroup ();
+	return TRUE;
+}
 
-		// Save the game event chunk
-		SaveEvents (out_fp);
+static void
+RestoreSaveSideEffects (SAVE_SIDE_EFFECTS *se)
+{
+	int i;
 
-		// Save the encounter chunk (black globes in HS/QS)
-		SaveEncounters (out_fp);
+	for (i = 0; i <= DEFGRPINFO_FILE; ++i)
+		RestoreStateFile (i, &se->stateFiles[i]);
+	memcpy (GLOBAL (GameState), se->gameState, sizeof (se->gameState));
+	GLOBAL (ip_location) = se->ip_location;
+	GLOBAL (ShipFacing) = se->ShipFacing;
+	GLOBAL (ip_planet) = se->ip_planet;
+	GLOBAL (in_orbit) = se->in_orbit;
+	SetLastEncGroup (se->lastEncGroup);
+}
 
-		// Save out the data that used to be in state files
-		SaveStarInfo (out_fp);
-		SaveGroups (out_fp);
+// PutGroupInfo() also drops the groups that left the system from
+// ip_group_q, which cannot be put back.
+static BOOLEAN
+GroupsLeftSystem (void)
+{
+	HIPGROUP hGroup, hNextGroup;
+	BOOLEAN left = FALSE;
 
-		// Save out the Star Descriptor
-		SaveStarDesc (&SD, out_fp);
+	for (hGroup = GetHeadLink (&GLOBAL (ip_group_q));
+			hGroup && !left; hGroup = hNextGroup)
+	{
+		IP_GROUP *GroupPtr = LockIpGroup (&GLOBAL (ip_group_q), hGroup);
+		hNextGroup = _GetSuccLink (GroupPtr);
+		left = !GroupPtr->in_system;
+		UnlockIpGroup (&GLOBAL (ip_group_q), hGroup);
+	}
+	return left;
+}
 
-		res_CloseResFile (out_fp);
-		if (!io_ok)
+// The autosave slot after the one that was written last, judged by
+// the modification times of the files.
+static COUNT
+FirstAutoSaveSlot (void)
+{
+	COUNT slot;
+	COUNT newest = NUM_AUTOSAVE_SLOTS - 1;
+	time_t newestTime = 0;
+	char file[32];
+	struct stat sb;
+
+	for (slot = 0; slot < NUM_AUTOSAVE_SLOTS; ++slot)
+	{
+		sprintf (file, "uqmsave.%02u", FIRST_AUTOSAVE_GAME + slot);
+		if (uio_stat (saveDir, file, &sb) != 0)
+			continue;
+		if (sb.st_mtime >= newestTime)
 		{
-			DeleteResFile(saveDir, file);
-			return FALSE;
+			newestTime = sb.st_mtime;
+			newest = slot;
 		}
 	}
-	else
+	return (newest + 1) % NUM_AUTOSAVE_SLOTS;
+}
+
+// Saving only costs the game thread the serialization into memory, so
+// the game can afford to save whenever the player enters a solar system
+// or meets someone.
+BOOLEAN
+AutoSaveGame (void)
+{
+	static COUNT nextSlot = (COUNT)~0;
+	SUMMARY_DESC summary;
+	SAVE_SIDE_EFFECTS sideEffects;
+	COUNT which_game;
+	BOOLEAN result;
+
+	if (GLOBAL (CurrentActivity) & (CHECK_ABORT | CHECK_LOAD))
+		return FALSE;
+
+	if (LOBYTE (GLOBAL (CurrentActivity)) == IN_INTERPLANETARY
+			&& !(GLOBAL (CurrentActivity)
+			& (START_ENCOUNTER | START_INTERPLANETARY))
+			&& GroupsLeftSystem ())
 	{
+		log_add (log_Debug, "AutoSaveGame(): skipped; groups have left "
+				"the system.");
 		return FALSE;
 	}
 
-	return TRUE;
+	// Nobody waited for the last autosave to be written; a failure
+	// is reported now.
+	if (!WaitSaveGameWrite ())
+		SaveProblem ();
+
+	if (nextSlot == (COUNT)~0)
+		nextSlot = FirstAutoSaveSlot ();
+	which_game = FIRST_AUTOSAVE_GAME + nextSlot;
+	nextSlot = (nextSlot + 1) % NUM_AUTOSAVE_SLOTS;
+
+	if (!CaptureSaveSideEffects (&sideEffects))
+		return FALSE;
+	result = SaveGame (which_game, &summary, "Autosave");
+	RestoreSaveSideEffects (&sideEffects);
+	return result;
 }
@@ -33,6 +33,10 @@ extern "C" {
 #define MAX_EXCLUSIVE_DEVICES 16
 #define SAVE_NAME_SIZE 64
 
+// The last save slots are reserved for autosaves, which rotate.
+#define FIRST_AUTOSAVE_GAME 50
+#define NUM_AUTOSAVE_SLOTS 5
+
 // The savefile tag numbers.
 #define SAVEFILE_TAG     0x01534d55 // "UMS\x01": UQM Save version 1
 #define SUMMARY_TAG      0x6d6d7553 // "Summ": Summary. Must be first!
@@ -70,6 +74,14 @@ extern BOOLEAN LoadLegacyGame (COUNT which_game, SUMMARY_DESC *summary_desc);
 
 extern void SaveProblem (void);
 extern BOOLEAN SaveGame (COUNT which_game, SUMMARY_DESC *summary_desc, const char *name);
+		// The file is written in the background; write errors are
+		// only reported by WaitSaveGameWrite().
+extern BOOLEAN WaitSaveGameWrite (void);
+		// Waits until the last saved game is on disk. Returns FALSE
+		// if writing it failed, the first time it is called after
+		// the failure.
+extern BOOLEAN AutoSaveGame (void);
+		// Saves the game in the next autosave slot.
 
 #if defined(__cplusplus)
 }
@@ -30,6 +30,7 @@
 #include "status.h"
 #include "resinst.h"
 #include "sounds.h"
+#include "supermelee/replay.h"
 #include "libs/compiler.h"
 #include "libs/uio.h"
 #include "libs/file.h"
@@ -244,6 +245,13 @@ SetPlayerInput (COUNT playerI)
 {
 	assert (PlayerInput[playerI] == NULL);
 
+	if (Replay_isPlaying ())
+	{
+		PlayerInput[playerI] =
+				(InputContext *) ReplayInputContext_new (playerI);
+		return PlayerInput[playerI] != NULL;
+	}
+
 	switch (PlayerControl[playerI] & CONTROL_MASK) {
 		case HUMAN_CONTROL:
 			PlayerInput[playerI] =
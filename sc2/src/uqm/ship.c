@@ -178,7 +178,8 @@ ship_preprocess (ELEMENT *ElementPtr)
 			s.origin.x = s.origin.y = 0;
 			s.frame = RDPtr->ship_data.captain_control.background;
 			DrawStamp (&s);
-			DestroyDrawable (ReleaseDrawable (s.frame));
+			// Only drawn once. The drawable is freed with the rest of
+			// the battle data of the ship.
 			RDPtr->ship_data.captain_control.background = 0;
 			SetContext (OldContext);
 		}
@@ -1265,7 +1265,7 @@ DoModifyShips (MENU_STATE *pMS)
 
 	}
 
-	SleepThread (ONE_SECOND / 30);
+	SleepThreadUntilInput (GetTimeCounter () + ONE_SECOND / 30);
 
 	return TRUE;
 }
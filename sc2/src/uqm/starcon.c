@@ -38,6 +38,7 @@
 		// for SeedUniverse()
 #include "planets/planets.h"
 		// for ExploreSolarSys()
+#include "uqmbench.h"
 #include "uqmdebug.h"
 #include "libs/tasklib.h"
 #include "libs/log.h"
@@ -186,6 +187,8 @@ while (--ac > 0)
 		 *       is gone.
 		 */
 		extern sint32 initAudio (sint32 driver, sint32 flags);
+		if (benchFile != NULL)
+			startBenchmarks ();
 		initAudio (snddriver, soundflags);
 	}
 
@@ -310,6 +313,9 @@ while (--ac > 0)
 	}
 //	CloseJournal ();
 
+	// Do not quit while a saved game is still being written.
+	WaitSaveGameWrite ();
+
 	UninitGameKernel ();
 	FreeMasterShipList ();
 	FreeKernel ();
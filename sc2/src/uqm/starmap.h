@@ -29,6 +29,13 @@ extern STAR_DESC *star_array;
 
 #define NUM_SOLAR_SYSTEMS 502
 
+// Returns the first star after 'pLastStar' (or the first star, if NULL)
+// within 'xbounds' and 'ybounds' of 'puniverse', in the order of
+// star_array. Only the stars of the current space (HyperSpace or
+// QuasiSpace) are considered.
+// star_array is sorted on the y coordinate, so the cost of going through
+// all the stars in an area depends on its height, not on the number of
+// stars in the universe; keep areas which are searched often small.
 extern STAR_DESC* FindStar (STAR_DESC *pLastStar, POINT *puniverse,
 		SIZE xbounds, SIZE ybounds);
 
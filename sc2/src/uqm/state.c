@@ -128,6 +128,50 @@ DeleteStateFile (int stateFile)
 	fp->data = 0;
 }
 
+BOOLEAN
+CopyStateFile (int stateFile, STATE_FILE_COPY *copy)
+{
+	GAME_STATE_FILE *fp;
+
+	if (stateFile < 0 || stateFile >= NUM_STATE_FILES)
+		return FALSE;
+
+	fp = &state_files[stateFile];
+	copy->used = fp->used;
+	copy->size = fp->size;
+	copy->data = NULL;
+	if (fp->data)
+	{
+		copy->data = HMalloc (fp->size);
+		if (!copy->data)
+			return FALSE;
+		memcpy (copy->data, fp->data, fp->size);
+	}
+	return TRUE;
+}
+
+void
+RestoreStateFile (int stateFile, STATE_FILE_COPY *copy)
+{
+	GAME_STATE_FILE *fp;
+
+	if (stateFile < 0 || stateFile >= NUM_STATE_FILES)
+		return;
+
+	fp = &state_files[stateFile];
+	if (fp->open_count != 0)
+		log_add (log_Warning, "WARNING: "
+				"State file %s open count is %d during restore()",
+				fp->symname, fp->open_count);
+
+	HFree (fp->data);
+	fp->data = copy->data;
+	fp->used = copy->used;
+	fp->size = copy->size;
+	fp->ptr = 0;
+	copy->data = NULL;
+}
+
 DWORD
 LengthStateFile (GAME_STATE_FILE *fp)
 {
@@ -73,6 +73,19 @@ typedef enum
 GAME_STATE_FILE* OpenStateFile (int stateFile, const char *mode);
 void CloseStateFile (GAME_STATE_FILE *fp);
 void DeleteStateFile (int stateFile);
+
+// A copy of the contents of a state file.
+typedef struct
+{
+	BYTE *data;
+	DWORD used;
+	DWORD size;
+} STATE_FILE_COPY;
+
+BOOLEAN CopyStateFile (int stateFile, STATE_FILE_COPY *copy);
+// Puts the contents back the way they were copied. The file takes over
+// the buffer of the copy.
+void RestoreStateFile (int stateFile, STATE_FILE_COPY *copy);
 DWORD LengthStateFile (GAME_STATE_FILE *fp);
 int ReadStateFile (void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp);
 int WriteStateFile (const void *lpBuf, COUNT size, COUNT count, GAME_STATE_FILE *fp);
@@ -21,6 +21,7 @@
 #include "options.h"
 #include "buildpick.h"
 #include "meleeship.h"
+#include "replay.h"
 #include "../battle.h"
 #include "../build.h"
 #include "../status.h"
@@ -40,6 +41,7 @@
 #	include "netplay/netmelee.h"
 #	include "netplay/notify.h"
 #	include "netplay/notifyall.h"
+#	include "netplay/spectator.h"
 #	include "libs/graphics/widgets.h"
 		// for DrawShadowedBox()
 #	include "../cnctdlg.h"
@@ -54,6 +56,7 @@
 #include "../planets/planets.h"
 		// for NUMBER_OF_PLANET_TYPES
 #include "libs/gfxlib.h"
+#include "libs/inplib.h"
 #include "libs/mathlib.h"
 		// for TFB_Random()
 #include "libs/reslib.h"
@@ -1268,6 +1271,36 @@ numPlayersReady (void)
 
 	return numDone;
 }
+
+// Tell the spectators, if any, with what a match starts.
+static void
+broadcastMatchStart (MELEE_STATE *pMS)
+{
+	DWORD seed;
+	COUNT side;
+
+	// Read the seed without changing it.
+	seed = TFB_SeedRandom (0);
+	TFB_SeedRandom (seed);
+	Spectator_matchStart (seed);
+
+	for (side = 0; side < NUM_SIDES; side++)
+	{
+		uint8 ships[MELEE_FLEET_SIZE];
+		FleetShipIndex slotI;
+
+		for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++)
+		{
+			MeleeShip ship = MeleeSetup_getShip (pMS->meleeSetup, side,
+					slotI);
+			ships[slotI] = (uint8) ship;
+		}
+		Spectator_fleet (side, ships, MELEE_FLEET_SIZE);
+		Spectator_teamName (side,
+				MeleeSetup_getTeamName (pMS->meleeSetup, side));
+	}
+	Spectator_flush ();
+}
 #endif  /* NETPLAY */
 
 // The player has pressed "Start Game", and all Network players are
@@ -1388,7 +1421,9 @@ DoConfirmSettings (MELEE_STATE *pMS)
 	
 	pMS->InputFunc = DoMelee;
 	
+	broadcastMatchStart (pMS);
 	StartMelee (pMS);
+	Spectator_matchEnd ();
 	if (GLOBAL (CurrentActivity) & CHECK_ABORT)
 		return FALSE;
 
@@ -1446,6 +1481,7 @@ BuildAndDrawShipList (MELEE_STATE *pMS)
 static void
 StartMelee (MELEE_STATE *pMS)
 {
+	Replay_matchStart (pMS->meleeSetup);
 	{
 		FadeMusic (0, ONE_SECOND / 2);
 		SleepThreadUntil (FadeScreen (FadeAllToBlack, ONE_SECOND / 2)
@@ -1475,18 +1511,112 @@ StartMelee (MELEE_STATE *pMS)
 		ClearPlayerInputAll ();
 
 		if (GLOBAL (CurrentActivity) & CHECK_ABORT)
+		{
+			Replay_matchEnd ();
 			return;
+		}
 
 		SleepThreadUntil (FadeScreen (FadeAllToBlack, ONE_SECOND / 2)
 				+ ONE_SECOND / 60);
 		FlushColorXForms ();
 
 	} while (0 /* !(GLOBAL (CurrentActivity) & CHECK_ABORT) */);
+	Replay_matchEnd ();
 	GLOBAL (CurrentActivity) = SUPER_MELEE;
 
 	pMS->Initialized = FALSE;
 }
 
+#ifdef NETPLAY
+// Passes more of the match being watched to the replay code. Returns
+// FALSE when no more will come.
+static BOOLEAN
+fetchSpectated (void)
+{
+	for (;;)
+	{
+		const uint8 *data;
+		size_t size;
+
+		if (!SpectateStream_inSync (spectateStream))
+			return FALSE;
+
+		data = SpectateStream_takeData (spectateStream, &size);
+		if (size > 0)
+		{
+			Replay_addData (data, size);
+			return TRUE;
+		}
+
+		if (!SpectateStream_isOpen (spectateStream) || QuitPosted ||
+				(GLOBAL (CurrentActivity) & CHECK_ABORT))
+			return FALSE;
+		netInputBlocking (100);
+	}
+}
+
+// Watch the matches of 'netplayOptions.spectateHost', until the
+// connection is closed or the player quits. Each match is played back
+// while it is received, after catching up on what was played before the
+// connection was made.
+static void
+spectateMatches (MELEE_STATE *pMS)
+{
+	spectateStream = SpectateStream_open (netplayOptions.spectateHost,
+			netplayOptions.spectatorPort);
+	if (spectateStream == NULL)
+	{
+		log_add (log_Error, "Error: Could not connect to %s to watch its "
+				"matches.", netplayOptions.spectateHost);
+		return;
+	}
+
+	while (!QuitPosted)
+	{
+		const uint8 *data;
+		size_t size;
+
+		if (!SpectateStream_matchReady (spectateStream))
+		{
+			if (!SpectateStream_isOpen (spectateStream))
+				break;
+			UpdateInputState ();
+			if (PulsedInputState.menu[KEY_MENU_CANCEL])
+				break;
+			netInputBlocking (100);
+			continue;
+		}
+
+		data = SpectateStream_takeData (spectateStream, &size);
+		if (Replay_loadLive (pMS->meleeSetup, data, size, fetchSpectated,
+				SpectateStream_getCatchUpFrames (spectateStream)))
+		{
+			log_add (log_Info, "Watching a match of %s.",
+					netplayOptions.spectateHost);
+			StartMelee (pMS);
+			if (!SpectateStream_inSync (spectateStream))
+				log_add (log_Error, "Stopped watching the match, as it "
+						"went out of sync.");
+
+			// An abort which does not come from the stream is the
+			// player's.
+			if ((GLOBAL (CurrentActivity) & CHECK_ABORT) &&
+					!SpectateStream_matchEnded (spectateStream) &&
+					SpectateStream_isOpen (spectateStream) &&
+					SpectateStream_inSync (spectateStream))
+				break;
+			GLOBAL (CurrentActivity) = SUPER_MELEE;
+		}
+		SpectateStream_nextMatch (spectateStream);
+	}
+
+	log_add (log_Info, "Checksums of %lu frames matched those of the host.",
+			(unsigned long) SpectateStream_getNumVerified (spectateStream));
+	SpectateStream_close (spectateStream);
+	spectateStream = NULL;
+}
+#endif  /* NETPLAY */
+
 static void
 StartMeleeButtonPressed (MELEE_STATE *pMS)
 {
@@ -2079,14 +2209,36 @@ Melee (void)
 					MenuState.load.preBuiltList[1]);
 		}
 
-		MenuState.side = 0;
-		SetMenuSounds (MENU_SOUND_ARROWS, MENU_SOUND_SELECT);
-		DoInput (&MenuState, TRUE);
+		if (replayOptions.playFile != NULL)
+		{
+			// Play back a recorded match instead of showing the menu.
+			if (Replay_load (MenuState.meleeSetup))
+				StartMelee (&MenuState);
+		}
+#ifdef NETPLAY
+		else if (netplayOptions.spectateHost != NULL)
+		{
+			// Watch the matches of another host instead of showing the
+			// menu.
+			spectateMatches (&MenuState);
+		}
+#endif
+		else
+		{
+			MenuState.side = 0;
+			SetMenuSounds (MENU_SOUND_ARROWS, MENU_SOUND_SELECT);
+			DoInput (&MenuState, TRUE);
+		}
 
 		StopMusic ();
 		WaitForSoundEnd (TFBSOUND_WAIT_ALL);
 
-		WriteMeleeConfig (&MenuState);
+		if (replayOptions.playFile == NULL
+#ifdef NETPLAY
+				&& netplayOptions.spectateHost == NULL
+#endif
+				)
+			WriteMeleeConfig (&MenuState);
 		FreeMeleeInfo (&MenuState);
 		DestroySound (ReleaseSound (GameSounds));
 		GameSounds = 0;
@@ -49,6 +49,7 @@
 
 
 NetConnection *netConnections[NUM_PLAYERS];
+SpectateStream *spectateStream;
 size_t numNetConnections;
 
 void
@@ -23,6 +23,7 @@
 #include "netinput.h"
 #include "netconnection.h"
 #include "packetsenders.h"
+#include "spectate.h"
 
 #include "../../battlecontrols.h"
 		// for NetworkInputContext
@@ -36,6 +37,8 @@ extern "C" {
 #endif
 
 extern struct NetConnection *netConnections[];
+extern SpectateStream *spectateStream;
+		// The matches of another host which are being watched, if any.
 
 
 void addNetConnection(NetConnection *conn, int playerNr);
@@ -34,6 +34,8 @@ NetplayOptions netplayOptions = {
 		},
 	},
 	/* .inputDelay = */ 2,
+	/* .spectatorPort = */ NULL,
+	/* .spectateHost = */ NULL,
 };
 
 
@@ -45,6 +45,12 @@ typedef struct {
 			// May be given as a service name.
 	NetplayPeerOptions peer[NETPLAY_NUM_PLAYERS];
 	size_t inputDelay;
+	const char *spectatorPort;
+			// Port on which to accept spectators, or NULL not to.
+			// May be given as a service name.
+	const char *spectateHost;
+			// Host whose matches to watch, on port 'spectatorPort',
+			// instead of playing, or NULL.
 } NetplayOptions;
 extern NetplayOptions netplayOptions;
 
@@ -22,6 +22,7 @@
 #include "packetq.h"
 #include "netsend.h"
 #include "packetsenders.h"
+#include "libs/memlib.h"
 #ifdef NETPLAY_DEBUG
 #	include "libs/log.h"
 #endif
@@ -32,13 +33,12 @@
 
 static inline PacketQueueLink *
 PacketQueueLink_alloc(void) {
-	// XXX: perhaps keep a pool of links?
-	return malloc(sizeof (PacketQueueLink));
+	return HMallocObject(sizeof (PacketQueueLink));
 }
 
 static inline void
 PacketQueueLink_delete(PacketQueueLink *link) {
-	free(link);
+	HFreeObject(link, sizeof (PacketQueueLink));
 }
 
 // 'maxSize' should at least be 1
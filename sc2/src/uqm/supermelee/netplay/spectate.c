@@ -0,0 +1,677 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+// Receiving of a SuperMelee match broadcast by spectator.c.
+//
+// The records received are turned into the events of a replay (see
+// ../replay.c), so that the match can be played back while it is
+// received. A spectator which connects halfway a match first receives a
+// snapshot of the match so far; the frames in it are the ones to catch up
+// on.
+// The checksums received are compared with those of the local simulation,
+// which are passed to SpectateStream_localChecksum().
+//
+// One match is handled at a time; after the end of a match, nothing more
+// is handled until SpectateStream_nextMatch() is called.
+
+#define NETDESCRIPTOR_INTERNAL
+#include "spectate.h"
+
+#include "spectator.h"
+#include "../melee.h"
+#include "../replay.h"
+#include "../../init.h"
+#include "../../intel.h"
+#include "libs/log.h"
+#include "libs/network/bytesex.h"
+#include "libs/network/connect/connect.h"
+#include "libs/network/netmanager/netmanager.h"
+#include "libs/network/socket/socket.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	SpectateState_init,
+			// Waiting for the INIT record.
+	SpectateState_idle,
+			// Waiting for a match to start.
+	SpectateState_setup,
+			// Receiving the fleets and team names of a match.
+	SpectateState_match,
+	SpectateState_ended,
+			// Waiting for SpectateStream_nextMatch().
+} SpectateState;
+
+typedef struct {
+	uint32 frameNr;
+	uint32 checksum;
+} SpectateChecksum;
+
+typedef struct {
+	SpectateChecksum entries[SPECTATE_MAX_CHECKSUMS];
+	size_t start;
+	size_t count;
+} SpectateChecksumQueue;
+
+struct SpectateStream {
+	ConnectState *connectState;
+	NetDescriptor *nd;
+	bool open;
+	bool readPaused;
+
+	uint8 *in;
+	size_t inLen;
+
+	SpectateState state;
+	uint8 uqmVersion[3];
+	uint32 seed;
+	uint8 fleets[NUM_PLAYERS][MELEE_FLEET_SIZE];
+	char teamNames[NUM_PLAYERS][MAX_TEAM_CHARS + 1];
+	uint32 setupReceived;
+			// Bit 'side' for the fleet, bit NUM_PLAYERS + 'side' for the
+			// team name.
+	uint32 catchUpFrames;
+	bool matchReady;
+
+	uint8 *out;
+	size_t outLen;
+	size_t outSize;
+	size_t outTaken;
+			// Replay data of the match; what is before 'outTaken' has
+			// been passed to the game.
+
+	SpectateChecksumQueue localChecksums;
+	SpectateChecksumQueue remoteChecksums;
+	bool desynced;
+	uint32 numVerified;
+};
+
+typedef enum {
+	Record_handled,
+	Record_later,
+			// Not handled before the next match.
+	Record_error,
+} RecordResult;
+
+static void SpectateStream_readCallback(NetDescriptor *nd);
+
+
+static void
+SpectateStream_disconnect(SpectateStream *stream) {
+	if (stream->connectState != NULL) {
+		ConnectState_close(stream->connectState);
+		stream->connectState = NULL;
+	}
+	if (stream->nd != NULL) {
+		NetDescriptor_setCloseCallback(stream->nd, NULL);
+		NetDescriptor_close(stream->nd);
+		stream->nd = NULL;
+	}
+	stream->open = false;
+}
+
+static void
+SpectateStream_closeCallback(NetDescriptor *nd) {
+	SpectateStream *stream = (SpectateStream *) NetDescriptor_getExtra(nd);
+
+	stream->nd = NULL;
+	stream->open = false;
+}
+
+static void
+SpectateStream_connectCallback(ConnectState *connectState,
+		NetDescriptor *nd, const struct sockaddr *addr,
+		socklen_t addrLen) {
+	SpectateStream *stream =
+			(SpectateStream *) ConnectState_getExtra(connectState);
+
+	ConnectState_close(connectState);
+	stream->connectState = NULL;
+
+	stream->nd = nd;
+			// No incRef(); the caller gives up ownership.
+	NetDescriptor_setExtra(nd, (void *) stream);
+	NetDescriptor_setReadCallback(nd, SpectateStream_readCallback);
+	NetDescriptor_setCloseCallback(nd, SpectateStream_closeCallback);
+	log_add(log_Info, "Connected to the match; waiting for it to start.");
+	(void) addr;
+	(void) addrLen;
+}
+
+static void
+SpectateStream_connectErrorCallback(ConnectState *connectState,
+		const ConnectError *error) {
+	SpectateStream *stream =
+			(SpectateStream *) ConnectState_getExtra(connectState);
+
+	log_add(log_Error, "Could not connect to the match: %s.",
+			error->state == Connect_resolving ?
+			"the host name could not be resolved" : strerror(error->err));
+	SpectateStream_disconnect(stream);
+}
+
+// Start connecting to a host which broadcasts matches.
+SpectateStream *
+SpectateStream_open(const char *host, const char *port) {
+	SpectateStream *stream;
+	ConnectFlags connectFlags;
+
+	stream = calloc(1, sizeof (SpectateStream));
+	if (stream == NULL)
+		return NULL;
+	stream->in = malloc(SPECTATE_INBUF_SIZE);
+	if (stream->in == NULL) {
+		free(stream);
+		return NULL;
+	}
+	stream->state = SpectateState_init;
+	stream->open = true;
+
+	memset(&connectFlags, 0, sizeof connectFlags);
+	connectFlags.familyDemand =
+#if NETPLAY == NETPLAY_IPV4
+			PF_inet;
+#else
+			PF_unspec;
+#endif
+	connectFlags.familyPrefer = PF_unspec;
+	connectFlags.timeout = NETPLAY_CONNECTTIMEOUT;
+	connectFlags.retryDelayMs = NETPLAY_RETRYDELAY;
+
+	stream->connectState = connectHostByName(host, port, IPProto_tcp,
+			&connectFlags, SpectateStream_connectCallback,
+			SpectateStream_connectErrorCallback, (void *) stream);
+	if (stream->connectState == NULL) {
+		SpectateStream_close(stream);
+		return NULL;
+	}
+	return stream;
+}
+
+void
+SpectateStream_close(SpectateStream *stream) {
+	SpectateStream_disconnect(stream);
+	free(stream->in);
+	free(stream->out);
+	free(stream);
+}
+
+// False when the connection has failed or has been closed. What was
+// received before then can still be taken.
+bool
+SpectateStream_isOpen(const SpectateStream *stream) {
+	return stream->open;
+}
+
+static bool
+addOutput(SpectateStream *stream, const uint8 *data, size_t len) {
+	if (stream->outTaken == stream->outLen) {
+		stream->outLen = 0;
+		stream->outTaken = 0;
+	}
+
+	if (stream->outLen + len > stream->outSize) {
+		size_t newSize = stream->outSize == 0 ? 0x1000 : stream->outSize * 2;
+		uint8 *newOut;
+
+		while (newSize < stream->outLen + len)
+			newSize *= 2;
+		newOut = realloc(stream->out, newSize);
+		if (newOut == NULL)
+			return false;
+		stream->out = newOut;
+		stream->outSize = newSize;
+	}
+
+	memcpy(stream->out + stream->outLen, data, len);
+	stream->outLen += len;
+	return true;
+}
+
+static inline void
+putUInt16LE(uint8 *buf, uint16 val) {
+	buf[0] = (uint8) (val & 0xff);
+	buf[1] = (uint8) (val >> 8);
+}
+
+static inline void
+putUInt32LE(uint8 *buf, uint32 val) {
+	putUInt16LE(buf, (uint16) (val & 0xffff));
+	putUInt16LE(buf + 2, (uint16) (val >> 16));
+}
+
+static inline uint16
+getUint16(const uint8 *buf) {
+	uint16 val;
+	memcpy(&val, buf, 2);
+	return ntoh16(val);
+}
+
+static inline uint32
+getUint32(const uint8 *buf) {
+	uint32 val;
+	memcpy(&val, buf, 4);
+	return ntoh32(val);
+}
+
+// The replay header, from the setup of the match. Both sides of a network
+// match are human.
+static bool
+addReplayHeader(SpectateStream *stream) {
+	uint8 header[REPLAY_MAGIC_SIZE + 8 + NUM_PLAYERS];
+	size_t playerI;
+
+	memcpy(header, REPLAY_MAGIC, REPLAY_MAGIC_SIZE);
+	memcpy(header + REPLAY_MAGIC_SIZE, stream->uqmVersion, 3);
+	header[REPLAY_MAGIC_SIZE + 3] = NUM_PLAYERS;
+	putUInt32LE(header + REPLAY_MAGIC_SIZE + 4, stream->seed);
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+		header[REPLAY_MAGIC_SIZE + 8 + playerI] =
+				HUMAN_CONTROL | STANDARD_RATING;
+	if (!addOutput(stream, header, sizeof header))
+		return false;
+
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++) {
+		if (!addOutput(stream, stream->fleets[playerI], MELEE_FLEET_SIZE))
+			return false;
+	}
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++) {
+		uint8 len = (uint8) strlen(stream->teamNames[playerI]);
+
+		if (!addOutput(stream, &len, 1) || !addOutput(stream,
+				(const uint8 *) stream->teamNames[playerI], len))
+			return false;
+	}
+
+	stream->matchReady = true;
+	stream->state = SpectateState_match;
+	return true;
+}
+
+static bool
+addInput(SpectateStream *stream, const uint8 *inputs, uint32 count) {
+	uint8 event[1 + NUM_PLAYERS + 2];
+
+	event[0] = 'i';
+	memcpy(event + 1, inputs, NUM_PLAYERS);
+	while (count > 0) {
+		uint16 run = count > REPLAY_MAX_RUN ? REPLAY_MAX_RUN : count;
+
+		putUInt16LE(event + 1 + NUM_PLAYERS, run);
+		if (!addOutput(stream, event, sizeof event))
+			return false;
+		count -= run;
+	}
+	return true;
+}
+
+static void
+resetChecksums(SpectateStream *stream) {
+	stream->localChecksums.start = 0;
+	stream->localChecksums.count = 0;
+	stream->remoteChecksums.start = 0;
+	stream->remoteChecksums.count = 0;
+}
+
+static void
+pushChecksum(SpectateChecksumQueue *queue, uint32 frameNr,
+		uint32 checksum) {
+	SpectateChecksum *entry;
+
+	if (queue->count == SPECTATE_MAX_CHECKSUMS) {
+		// The other side is too far behind; the oldest is not compared.
+		queue->start = (queue->start + 1) % SPECTATE_MAX_CHECKSUMS;
+		queue->count--;
+	}
+
+	entry = &queue->entries[(queue->start + queue->count) %
+			SPECTATE_MAX_CHECKSUMS];
+	entry->frameNr = frameNr;
+	entry->checksum = checksum;
+	queue->count++;
+}
+
+static inline const SpectateChecksum *
+frontChecksum(const SpectateChecksumQueue *queue) {
+	return &queue->entries[queue->start];
+}
+
+static inline void
+popChecksum(SpectateChecksumQueue *queue) {
+	queue->start = (queue->start + 1) % SPECTATE_MAX_CHECKSUMS;
+	queue->count--;
+}
+
+// Compare the checksums of the frames for which both are known. Both
+// queues are in order of frame, so a checksum which is older than the
+// first one of the other side will never be matched.
+static void
+compareChecksums(SpectateStream *stream) {
+	SpectateChecksumQueue *local = &stream->localChecksums;
+	SpectateChecksumQueue *remote = &stream->remoteChecksums;
+
+	while (local->count > 0 && remote->count > 0) {
+		const SpectateChecksum *l = frontChecksum(local);
+		const SpectateChecksum *r = frontChecksum(remote);
+
+		if (l->frameNr < r->frameNr) {
+			popChecksum(local);
+		} else if (l->frameNr > r->frameNr) {
+			popChecksum(remote);
+		} else {
+			if (l->checksum != r->checksum) {
+				if (!stream->desynced)
+					log_add(log_Error, "The spectated match went out of "
+							"sync at frame %lu.",
+							(unsigned long) l->frameNr);
+				stream->desynced = true;
+			} else
+				stream->numVerified++;
+			popChecksum(local);
+			popChecksum(remote);
+		}
+	}
+}
+
+static RecordResult
+handleMatchRecord(SpectateStream *stream, uint16 type, const uint8 *body,
+		size_t bodyLen) {
+	uint8 event[4];
+	bool ok = true;
+
+	switch (type) {
+		case SPECTATOR_SELECTSHIP:
+			if (bodyLen < 4 || body[0] >= NUM_PLAYERS)
+				return Record_error;
+			event[0] = 's';
+			event[1] = body[0];
+			putUInt16LE(event + 2, getUint16(body + 2));
+			ok = addOutput(stream, event, 4);
+			break;
+		case SPECTATOR_FRAME:
+			if (bodyLen < 4 + NUM_PLAYERS)
+				return Record_error;
+			ok = addInput(stream, body + 4, 1);
+			break;
+		case SPECTATOR_INPUTRUN:
+			if (bodyLen < 4 + NUM_PLAYERS)
+				return Record_error;
+			ok = addInput(stream, body + 4, getUint32(body));
+			break;
+		case SPECTATOR_CHECKSUM:
+			if (bodyLen < 8)
+				return Record_error;
+			pushChecksum(&stream->remoteChecksums, getUint32(body),
+					getUint32(body + 4));
+			compareChecksums(stream);
+			break;
+		case SPECTATOR_BATTLEEND:
+			event[0] = 'b';
+			ok = addOutput(stream, event, 1);
+			break;
+		case SPECTATOR_MATCHSTART:
+			// The match was broken off without its end being sent.
+			event[0] = 'e';
+			ok = addOutput(stream, event, 1);
+			stream->state = SpectateState_ended;
+			return ok ? Record_later : Record_error;
+		case SPECTATOR_MATCHEND:
+			event[0] = 'e';
+			ok = addOutput(stream, event, 1);
+			stream->state = SpectateState_ended;
+			break;
+		default:
+			// Unknown records are skipped.
+			break;
+	}
+	return ok ? Record_handled : Record_error;
+}
+
+static RecordResult
+handleRecord(SpectateStream *stream, uint16 type, const uint8 *body,
+		size_t bodyLen) {
+	switch (stream->state) {
+		case SpectateState_init:
+			if (type != SPECTATOR_INIT || bodyLen < 8)
+				return Record_error;
+			if (body[0] != SPECTATOR_PROTOCOL_VERSION_MAJOR ||
+					body[1] != SPECTATOR_PROTOCOL_VERSION_MINOR) {
+				log_add(log_Error, "The match is broadcast with version "
+						"%d.%d of the spectator protocol; version %d.%d "
+						"is needed.", body[0], body[1],
+						SPECTATOR_PROTOCOL_VERSION_MAJOR,
+						SPECTATOR_PROTOCOL_VERSION_MINOR);
+				SpectateStream_disconnect(stream);
+				return Record_error;
+			}
+			memcpy(stream->uqmVersion, body + 4, 3);
+			stream->state = SpectateState_idle;
+			return Record_handled;
+		case SpectateState_idle:
+			if (type == SPECTATOR_SNAPSHOT) {
+				if (bodyLen < 4)
+					return Record_error;
+				stream->catchUpFrames = getUint32(body);
+			} else if (type == SPECTATOR_MATCHSTART) {
+				if (bodyLen < 4)
+					return Record_error;
+				stream->seed = getUint32(body);
+				memset(stream->fleets, MELEE_NONE, sizeof stream->fleets);
+				memset(stream->teamNames, 0, sizeof stream->teamNames);
+				stream->setupReceived = 0;
+				stream->state = SpectateState_setup;
+			}
+			return Record_handled;
+		case SpectateState_setup:
+			if (type == SPECTATOR_FLEET) {
+				size_t numShips;
+
+				if (bodyLen < 4 || body[0] >= NUM_PLAYERS)
+					return Record_error;
+				numShips = getUint16(body + 2);
+				if (numShips > MELEE_FLEET_SIZE)
+					numShips = MELEE_FLEET_SIZE;
+				if (bodyLen < 4 + numShips)
+					return Record_error;
+				memcpy(stream->fleets[body[0]], body + 4, numShips);
+				stream->setupReceived |= 1 << body[0];
+			} else if (type == SPECTATOR_TEAMNAME) {
+				const uint8 *end;
+				size_t len;
+
+				if (bodyLen < 4 || body[0] >= NUM_PLAYERS)
+					return Record_error;
+				end = memchr(body + 4, '\0', bodyLen - 4);
+				len = end == NULL ? bodyLen - 4 : (size_t) (end - (body + 4));
+				if (len > MAX_TEAM_CHARS)
+					len = MAX_TEAM_CHARS;
+				memcpy(stream->teamNames[body[0]], body + 4, len);
+				stream->teamNames[body[0]][len] = '\0';
+				stream->setupReceived |= 1 << (NUM_PLAYERS + body[0]);
+			} else {
+				// The setup is complete. What is missing is left empty.
+				if (!addReplayHeader(stream))
+					return Record_error;
+				return handleMatchRecord(stream, type, body, bodyLen);
+			}
+
+			if (stream->setupReceived == (1 << (2 * NUM_PLAYERS)) - 1 &&
+					!addReplayHeader(stream))
+				return Record_error;
+			return Record_handled;
+		case SpectateState_match:
+			return handleMatchRecord(stream, type, body, bodyLen);
+		case SpectateState_ended:
+			return Record_later;
+	}
+	return Record_error;
+}
+
+// Handle the complete records in the input buffer.
+static void
+handleInput(SpectateStream *stream) {
+	size_t pos = 0;
+
+	while (stream->inLen - pos >= 4) {
+		uint16 len = getUint16(stream->in + pos);
+		uint16 type = getUint16(stream->in + pos + 2);
+		RecordResult result;
+
+		if (len < 4 || len % 4 != 0 || len > SPECTATOR_RECORD_MAXSIZE) {
+			log_add(log_Error, "Invalid data received from the match.");
+			SpectateStream_disconnect(stream);
+			return;
+		}
+		if (stream->inLen - pos < len)
+			break;
+
+		result = handleRecord(stream, type, stream->in + pos + 4, len - 4);
+		if (result == Record_error) {
+			if (stream->open)
+				log_add(log_Error, "Invalid data received from the match.");
+			SpectateStream_disconnect(stream);
+			return;
+		}
+		if (result == Record_later)
+			break;
+		pos += len;
+	}
+
+	memmove(stream->in, stream->in + pos, stream->inLen - pos);
+	stream->inLen -= pos;
+}
+
+static void
+SpectateStream_setReadPaused(SpectateStream *stream, bool pause) {
+	if (stream->readPaused == pause || stream->nd == NULL)
+		return;
+	stream->readPaused = pause;
+	NetDescriptor_setReadCallback(stream->nd,
+			pause ? NULL : SpectateStream_readCallback);
+}
+
+static void
+SpectateStream_readCallback(NetDescriptor *nd) {
+	SpectateStream *stream = (SpectateStream *) NetDescriptor_getExtra(nd);
+	Socket *socket = NetDescriptor_getSocket(nd);
+
+	for (;;) {
+		ssize_t numRead;
+
+		if (stream->inLen == SPECTATE_INBUF_SIZE) {
+			// Nothing more can be handled until the next match.
+			SpectateStream_setReadPaused(stream, true);
+			return;
+		}
+
+		numRead = Socket_recv(socket, stream->in + stream->inLen,
+				SPECTATE_INBUF_SIZE - stream->inLen, 0);
+		if (numRead > 0) {
+			stream->inLen += numRead;
+			handleInput(stream);
+			if (!stream->open)
+				return;
+			continue;
+		}
+		if (numRead == -1) {
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return;
+			if (errno == EINTR)
+				continue;
+			log_add(log_Error, "Lost the connection to the match: %s.",
+					strerror(errno));
+		} else
+			log_add(log_Info, "The match host closed the connection.");
+		SpectateStream_disconnect(stream);
+		return;
+	}
+}
+
+// True when the replay header of a match has been received.
+bool
+SpectateStream_matchReady(const SpectateStream *stream) {
+	return stream->matchReady;
+}
+
+// True when the end of the match has been received.
+bool
+SpectateStream_matchEnded(const SpectateStream *stream) {
+	return stream->state == SpectateState_ended;
+}
+
+// The number of frames of the match which were played before the
+// connection was made.
+uint32
+SpectateStream_getCatchUpFrames(const SpectateStream *stream) {
+	return stream->catchUpFrames;
+}
+
+// Take the replay data received since the last call. The data stays valid
+// until the next call to a SpectateStream function or NetManager_process().
+const uint8 *
+SpectateStream_takeData(SpectateStream *stream, size_t *size) {
+	const uint8 *data = stream->out + stream->outTaken;
+
+	*size = stream->outLen - stream->outTaken;
+	stream->outTaken = stream->outLen;
+	return data;
+}
+
+// Done with the current match; start handling the next one.
+void
+SpectateStream_nextMatch(SpectateStream *stream) {
+	if (stream->state == SpectateState_init)
+		return;
+
+	stream->state = SpectateState_idle;
+	stream->matchReady = false;
+	stream->catchUpFrames = 0;
+	stream->outLen = 0;
+	stream->outTaken = 0;
+	resetChecksums(stream);
+	stream->desynced = false;
+
+	if (stream->open) {
+		handleInput(stream);
+		if (stream->open && stream->inLen < SPECTATE_INBUF_SIZE)
+			SpectateStream_setReadPaused(stream, false);
+	}
+}
+
+// The checksum of the local simulation at the start of a frame.
+void
+SpectateStream_localChecksum(SpectateStream *stream, uint32 frameNr,
+		uint32 checksum) {
+	pushChecksum(&stream->localChecksums, frameNr, checksum);
+	compareChecksums(stream);
+}
+
+// False once a checksum of the local simulation differed from that of the
+// host, until the next match.
+bool
+SpectateStream_inSync(const SpectateStream *stream) {
+	return !stream->desynced;
+}
+
+// The number of frames for which the checksums have matched.
+uint32
+SpectateStream_getNumVerified(const SpectateStream *stream) {
+	return stream->numVerified;
+}
+
@@ -0,0 +1,58 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef UQM_SUPERMELEE_NETPLAY_SPECTATE_H_
+#define UQM_SUPERMELEE_NETPLAY_SPECTATE_H_
+
+#include "netplay.h"
+#include "types.h"
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SPECTATE_INBUF_SIZE 0x10000
+		/* Received data which has not been handled yet. Reading stops
+		 * while this is full. */
+#define SPECTATE_MAX_CHECKSUMS 1024
+		/* Checksums kept for comparison, of each side. */
+
+typedef struct SpectateStream SpectateStream;
+
+SpectateStream *SpectateStream_open(const char *host, const char *port);
+void SpectateStream_close(SpectateStream *stream);
+bool SpectateStream_isOpen(const SpectateStream *stream);
+
+bool SpectateStream_matchReady(const SpectateStream *stream);
+bool SpectateStream_matchEnded(const SpectateStream *stream);
+uint32 SpectateStream_getCatchUpFrames(const SpectateStream *stream);
+const uint8 *SpectateStream_takeData(SpectateStream *stream, size_t *size);
+void SpectateStream_nextMatch(SpectateStream *stream);
+
+void SpectateStream_localChecksum(SpectateStream *stream, uint32 frameNr,
+		uint32 checksum);
+bool SpectateStream_inSync(const SpectateStream *stream);
+uint32 SpectateStream_getNumVerified(const SpectateStream *stream);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_SUPERMELEE_NETPLAY_SPECTATE_H_ */
+
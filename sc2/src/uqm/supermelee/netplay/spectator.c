@@ -0,0 +1,603 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+// Broadcasting of SuperMelee matches to spectators.
+//
+// Spectators connect over TCP and only receive. They are sent the seed
+// and fleets with which a match starts, every ship selection, and the
+// input of both players for every battle frame, as it is used by the
+// simulation. This is enough for a spectator to simulate the match
+// itself. The checksums of the game state let it verify that it has
+// stayed in sync.
+//
+// A summary of the current match is kept: how it started, the ship
+// selections, and the input of the frames, with runs of frames with the
+// same input merged. A spectator which connects while a match is in
+// progress is first sent this snapshot, and then the same records as the
+// others, so that it can catch up by simulating the match so far.
+//
+// Sending never blocks. Each spectator has a buffer of its own, and a
+// spectator which cannot keep up is disconnected.
+
+#define NETDESCRIPTOR_INTERNAL
+#include "spectator.h"
+
+#include "uqmversion.h"
+#include "libs/log.h"
+#include "libs/network/bytesex.h"
+#include "libs/network/connect/listen.h"
+#include "libs/network/netmanager/netmanager.h"
+#include "libs/network/socket/socket.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SpectatorClient SpectatorClient;
+struct SpectatorClient {
+	NetDescriptor *nd;
+
+	uint8 *pending;
+	size_t pendingLen;
+	size_t pendingPos;
+			// The INIT record and the snapshot of the match, which are
+			// sent before anything in 'buf'. NULL when sent.
+
+	uint8 *buf;
+	size_t bufStart;
+	size_t bufFill;
+			// The data to send; a cyclic buffer of
+			// SPECTATOR_CLIENT_BUFSIZE bytes.
+
+	bool waitingForWrite;
+			// The write callback is active.
+
+	SpectatorClient *next;
+};
+
+static ListenState *listenState;
+static SpectatorClient *clients;
+static size_t numClients;
+
+#define NO_RUN ((size_t) -1)
+
+static uint8 *history;
+static size_t historyLen;
+static size_t historySize;
+static size_t lastRunPos = NO_RUN;
+		// The position in the history of the INPUTRUN record to which the
+		// next frame may be added, or NO_RUN.
+static uint32 historyFrames;
+		// The number of frames in the history.
+static bool matchActive;
+
+static void SpectatorClient_send(SpectatorClient *client);
+
+
+static void
+SpectatorClient_drop(SpectatorClient *client) {
+	SpectatorClient **ptr;
+
+	for (ptr = &clients; *ptr != NULL; ptr = &(*ptr)->next) {
+		if (*ptr == client) {
+			*ptr = client->next;
+			break;
+		}
+	}
+	numClients--;
+
+	NetDescriptor_setCloseCallback(client->nd, NULL);
+	NetDescriptor_close(client->nd);
+	free(client->pending);
+	free(client->buf);
+	free(client);
+}
+
+// Add data to the send buffer of a client. Returns false if it does not
+// fit.
+static bool
+SpectatorClient_queue(SpectatorClient *client, const uint8 *data,
+		size_t len) {
+	size_t end;
+	size_t part;
+
+	if (SPECTATOR_CLIENT_BUFSIZE - client->bufFill < len)
+		return false;
+
+	end = (client->bufStart + client->bufFill) % SPECTATOR_CLIENT_BUFSIZE;
+	part = SPECTATOR_CLIENT_BUFSIZE - end;
+	if (part > len)
+		part = len;
+	memcpy(client->buf + end, data, part);
+	memcpy(client->buf, data + part, len - part);
+	client->bufFill += len;
+	return true;
+}
+
+static void
+SpectatorClient_writeCallback(NetDescriptor *nd) {
+	SpectatorClient_send((SpectatorClient *) NetDescriptor_getExtra(nd));
+}
+
+static void
+SpectatorClient_setWaitingForWrite(SpectatorClient *client, bool wait) {
+	if (client->waitingForWrite == wait)
+		return;
+	client->waitingForWrite = wait;
+	NetDescriptor_setWriteCallback(client->nd,
+			wait ? SpectatorClient_writeCallback : NULL);
+}
+
+// Send as much as the socket accepts, without blocking.
+// The client may be dropped.
+static void
+SpectatorClient_send(SpectatorClient *client) {
+	Socket *socket = NetDescriptor_getSocket(client->nd);
+
+	for (;;) {
+		const uint8 *data;
+		size_t len;
+		ssize_t numSent;
+
+		if (client->pending != NULL) {
+			data = client->pending + client->pendingPos;
+			len = client->pendingLen - client->pendingPos;
+		} else if (client->bufFill > 0) {
+			data = client->buf + client->bufStart;
+			len = SPECTATOR_CLIENT_BUFSIZE - client->bufStart;
+			if (len > client->bufFill)
+				len = client->bufFill;
+		} else {
+			SpectatorClient_setWaitingForWrite(client, false);
+			return;
+		}
+
+		numSent = Socket_send(socket, data, len, 0);
+		if (numSent == -1) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EWOULDBLOCK || errno == EAGAIN) {
+				SpectatorClient_setWaitingForWrite(client, true);
+				return;
+			}
+			log_add(log_Info, "Spectator disconnected: %s.",
+					strerror(errno));
+			SpectatorClient_drop(client);
+			return;
+		}
+
+		if (client->pending != NULL) {
+			client->pendingPos += numSent;
+			if (client->pendingPos == client->pendingLen) {
+				free(client->pending);
+				client->pending = NULL;
+			}
+		} else {
+			client->bufStart = (client->bufStart + numSent) %
+					SPECTATOR_CLIENT_BUFSIZE;
+			client->bufFill -= numSent;
+		}
+	}
+}
+
+// Spectators do not send anything; this only notices when they hang up.
+static void
+SpectatorClient_readCallback(NetDescriptor *nd) {
+	SpectatorClient *client = (SpectatorClient *) NetDescriptor_getExtra(nd);
+	Socket *socket = NetDescriptor_getSocket(nd);
+	uint8 discard[256];
+
+	for (;;) {
+		ssize_t numRead = Socket_recv(socket, discard, sizeof discard, 0);
+		if (numRead > 0)
+			continue;
+		if (numRead == -1) {
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				return;
+			if (errno == EINTR)
+				continue;
+		}
+		log_add(log_Info, "Spectator disconnected.");
+		SpectatorClient_drop(client);
+		return;
+	}
+}
+
+static inline void
+putUint32(uint8 *buf, uint32 val) {
+	val = hton32(val);
+	memcpy(buf, &val, 4);
+}
+
+static inline void
+putUint16(uint8 *buf, uint16 val) {
+	val = hton16(val);
+	memcpy(buf, &val, 2);
+}
+
+// The records are padded to a multiple of 4 bytes, as packets are.
+static inline size_t
+padRecord(uint8 *record, size_t len) {
+	while (len % 4 != 0)
+		record[len++] = 0;
+	return len;
+}
+
+static size_t
+makeInitRecord(uint8 *record) {
+	record[4] = SPECTATOR_PROTOCOL_VERSION_MAJOR;
+	record[5] = SPECTATOR_PROTOCOL_VERSION_MINOR;
+	record[6] = 0;
+	record[7] = 0;
+	record[8] = UQM_MAJOR_VERSION;
+	record[9] = UQM_MINOR_VERSION;
+	record[10] = UQM_PATCH_VERSION;
+	record[11] = 0;
+	return 12;
+}
+
+static void
+setRecordHeader(uint8 *record, size_t len, SpectatorRecordType type) {
+	uint16 len16 = hton16((uint16) len);
+	uint16 type16 = hton16((uint16) type);
+	memcpy(record, &len16, 2);
+	memcpy(record + 2, &type16, 2);
+}
+
+// The caller gives up ownership of newNd.
+static void
+Spectator_connectCallback(ListenState *state, NetDescriptor *listenNd,
+		NetDescriptor *newNd, const struct sockaddr *addr,
+		SOCKLEN_T addrLen) {
+	SpectatorClient *client;
+	size_t len;
+
+	if (numClients >= SPECTATOR_MAX_CLIENTS) {
+		log_add(log_Warning, "Refusing spectator; there are already %d.",
+				SPECTATOR_MAX_CLIENTS);
+		NetDescriptor_close(newNd);
+		return;
+	}
+
+	client = malloc(sizeof (SpectatorClient));
+	if (client == NULL) {
+		NetDescriptor_close(newNd);
+		return;
+	}
+	// The snapshot is a copy of the history, as it is now; all that is
+	// added to the history from now on is also sent through 'buf'.
+	len = 12;
+	if (matchActive)
+		len += 8 + historyLen;
+	client->pending = malloc(len);
+	client->buf = malloc(SPECTATOR_CLIENT_BUFSIZE);
+	if (client->pending == NULL || client->buf == NULL) {
+		free(client->pending);
+		free(client->buf);
+		free(client);
+		NetDescriptor_close(newNd);
+		return;
+	}
+
+	client->pendingLen = makeInitRecord(client->pending);
+	setRecordHeader(client->pending, client->pendingLen, SPECTATOR_INIT);
+	if (matchActive) {
+		uint8 *snapshot = client->pending + client->pendingLen;
+		putUint32(snapshot + 4, historyFrames);
+		setRecordHeader(snapshot, 8, SPECTATOR_SNAPSHOT);
+		memcpy(snapshot + 8, history, historyLen);
+		client->pendingLen += 8 + historyLen;
+	}
+	client->pendingPos = 0;
+
+	client->nd = newNd;
+	client->bufStart = 0;
+	client->bufFill = 0;
+	client->waitingForWrite = false;
+	client->next = clients;
+	clients = client;
+	numClients++;
+
+	NetDescriptor_setExtra(newNd, (void *) client);
+	NetDescriptor_setReadCallback(newNd, SpectatorClient_readCallback);
+
+	log_add(log_Info, "Spectator connected (%lu in total).",
+			(unsigned long) numClients);
+
+	SpectatorClient_send(client);
+	(void) state;
+	(void) listenNd;
+	(void) addr;
+	(void) addrLen;
+}
+
+static void
+Spectator_listenErrorCallback(ListenState *state, const ListenError *error) {
+	log_add(log_Error, "Could not listen for spectators: %s.",
+			strerror(error->err));
+	ListenState_close(state);
+	if (state == listenState)
+		listenState = NULL;
+}
+
+// Start accepting spectators on 'port'.
+bool
+Spectator_open(const char *port) {
+	ListenFlags listenFlags;
+
+	assert(listenState == NULL);
+
+	memset(&listenFlags, 0, sizeof listenFlags);
+	listenFlags.familyDemand =
+#if NETPLAY == NETPLAY_IPV4
+			PF_inet;
+#else
+			PF_unspec;
+#endif
+	listenFlags.familyPrefer = PF_unspec;
+	listenFlags.backlog = SPECTATOR_LISTEN_BACKLOG;
+
+	listenState = listenPort(port, IPProto_tcp, &listenFlags,
+			Spectator_connectCallback, Spectator_listenErrorCallback, NULL);
+	if (listenState == NULL)
+		return false;
+
+	log_add(log_Info, "Accepting spectators on port %s.", port);
+	return true;
+}
+
+void
+Spectator_close(void) {
+	while (clients != NULL)
+		SpectatorClient_drop(clients);
+
+	if (listenState != NULL) {
+		ListenState_close(listenState);
+		listenState = NULL;
+	}
+
+	free(history);
+	history = NULL;
+	historyLen = 0;
+	historySize = 0;
+	lastRunPos = NO_RUN;
+	historyFrames = 0;
+	matchActive = false;
+}
+
+size_t
+Spectator_getNumClients(void) {
+	return numClients;
+}
+
+// Keep a record for the snapshot of the match.
+static bool
+addToHistory(const uint8 *record, size_t len) {
+	if (historyLen + len > historySize) {
+		size_t newSize = historySize == 0 ? 0x10000 : historySize * 2;
+		uint8 *newHistory;
+
+		while (newSize < historyLen + len)
+			newSize *= 2;
+		newHistory = realloc(history, newSize);
+		if (newHistory == NULL)
+			return false;
+		history = newHistory;
+		historySize = newSize;
+	}
+
+	memcpy(history + historyLen, record, len);
+	historyLen += len;
+	lastRunPos = NO_RUN;
+	return true;
+}
+
+static void
+historyFailed(void) {
+	log_add(log_Error, "Out of memory for the spectator stream; "
+			"disconnecting all spectators.");
+	while (clients != NULL)
+		SpectatorClient_drop(clients);
+}
+
+// Add a record to the stream for all spectators, and to the snapshot of
+// the match if 'keep' is set.
+// The data is sent on the next Spectator_flush().
+static void
+broadcast(uint8 *record, size_t len, SpectatorRecordType type, bool keep) {
+	SpectatorClient *client;
+	SpectatorClient *next;
+
+	assert(len % 4 == 0 && len <= SPECTATOR_RECORD_MAXSIZE);
+	setRecordHeader(record, len, type);
+
+	if (keep && !addToHistory(record, len)) {
+		historyFailed();
+		return;
+	}
+
+	for (client = clients; client != NULL; client = next) {
+		next = client->next;
+
+		if (!SpectatorClient_queue(client, record, len)) {
+			log_add(log_Info, "Dropping spectator which cannot keep up.");
+			SpectatorClient_drop(client);
+		}
+	}
+}
+
+// Send what has been broadcast, as far as possible without blocking.
+void
+Spectator_flush(void) {
+	SpectatorClient *client;
+	SpectatorClient *next;
+
+	for (client = clients; client != NULL; client = next) {
+		next = client->next;
+		if (!client->waitingForWrite)
+			SpectatorClient_send(client);
+	}
+}
+
+void
+Spectator_matchStart(uint32 seed) {
+	uint8 record[8];
+
+	if (listenState == NULL)
+		return;
+
+	historyLen = 0;
+	historyFrames = 0;
+
+	matchActive = true;
+	putUint32(record + 4, seed);
+	broadcast(record, sizeof record, SPECTATOR_MATCHSTART, true);
+}
+
+void
+Spectator_fleet(uint8 side, const uint8 *ships, size_t numShips) {
+	uint8 record[SPECTATOR_RECORD_MAXSIZE];
+	size_t len;
+
+	if (!matchActive)
+		return;
+
+	assert(8 + numShips <= SPECTATOR_RECORD_MAXSIZE);
+	record[4] = side;
+	record[5] = 0;
+	putUint16(record + 6, (uint16) numShips);
+	memcpy(record + 8, ships, numShips);
+	len = padRecord(record, 8 + numShips);
+	broadcast(record, len, SPECTATOR_FLEET, true);
+}
+
+void
+Spectator_teamName(uint8 side, const char *name) {
+	uint8 record[SPECTATOR_RECORD_MAXSIZE];
+	size_t nameLen;
+	size_t len;
+
+	if (!matchActive)
+		return;
+
+	nameLen = strlen(name);
+	if (nameLen > SPECTATOR_RECORD_MAXSIZE - 12)
+		nameLen = SPECTATOR_RECORD_MAXSIZE - 12;
+	record[4] = side;
+	record[5] = 0;
+	record[6] = 0;
+	record[7] = 0;
+	memcpy(record + 8, name, nameLen);
+	record[8 + nameLen] = '\0';
+	len = padRecord(record, 8 + nameLen + 1);
+	broadcast(record, len, SPECTATOR_TEAMNAME, true);
+}
+
+void
+Spectator_selectShip(uint8 side, uint16 choice) {
+	uint8 record[8];
+
+	if (!matchActive)
+		return;
+
+	record[4] = side;
+	record[5] = 0;
+	putUint16(record + 6, choice);
+	broadcast(record, sizeof record, SPECTATOR_SELECTSHIP, true);
+}
+
+void
+Spectator_frame(uint32 frameNr, const uint8 *inputs, size_t numInputs) {
+	uint8 record[SPECTATOR_RECORD_MAXSIZE];
+	size_t len;
+
+	if (!matchActive)
+		return;
+
+	assert(8 + numInputs <= SPECTATOR_RECORD_MAXSIZE);
+	putUint32(record + 4, frameNr);
+	memcpy(record + 8, inputs, numInputs);
+	len = padRecord(record, 8 + numInputs);
+	broadcast(record, len, SPECTATOR_FRAME, false);
+
+	// In the snapshot, the frame is added to the last run of frames if
+	// it has the same input.
+	historyFrames++;
+	if (lastRunPos != NO_RUN &&
+			memcmp(history + lastRunPos + 8, inputs, numInputs) == 0) {
+		uint32 count;
+
+		memcpy(&count, history + lastRunPos + 4, 4);
+		count = ntoh32(count);
+		if (count < 0xffffffff) {
+			putUint32(history + lastRunPos + 4, count + 1);
+			return;
+		}
+	}
+
+	putUint32(record + 4, 1);
+	setRecordHeader(record, len, SPECTATOR_INPUTRUN);
+	if (!addToHistory(record, len)) {
+		historyFailed();
+		return;
+	}
+	lastRunPos = historyLen - len;
+}
+
+void
+Spectator_checksum(uint32 frameNr, uint32 checksum) {
+	uint8 record[12];
+
+	if (!matchActive)
+		return;
+
+	putUint32(record + 4, frameNr);
+	putUint32(record + 8, checksum);
+	broadcast(record, sizeof record, SPECTATOR_CHECKSUM, false);
+}
+
+// The battle goes on after a ship has died. When this happens depends on
+// the music, so it is sent along with the input.
+void
+Spectator_battleEnd(void) {
+	uint8 record[4];
+
+	if (!matchActive)
+		return;
+
+	broadcast(record, sizeof record, SPECTATOR_BATTLEEND, true);
+	Spectator_flush();
+}
+
+void
+Spectator_matchEnd(void) {
+	uint8 record[4];
+
+	if (!matchActive)
+		return;
+
+	broadcast(record, sizeof record, SPECTATOR_MATCHEND, true);
+	matchActive = false;
+	Spectator_flush();
+}
+
+bool
+Spectator_matchActive(void) {
+	return matchActive;
+}
+
@@ -0,0 +1,80 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+
+#ifndef UQM_SUPERMELEE_NETPLAY_SPECTATOR_H_
+#define UQM_SUPERMELEE_NETPLAY_SPECTATOR_H_
+
+#include "netplay.h"
+#include "types.h"
+
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SPECTATOR_PROTOCOL_VERSION_MAJOR 0
+#define SPECTATOR_PROTOCOL_VERSION_MINOR 2
+
+#define SPECTATOR_MAX_CLIENTS 128
+#define SPECTATOR_LISTEN_BACKLOG 16
+#define SPECTATOR_CLIENT_BUFSIZE 0x10000
+		/* Size of the send buffer of each spectator. A spectator
+		 * which falls this far behind is disconnected. */
+#define SPECTATOR_RECORD_MAXSIZE 256
+
+// The record types of the spectator stream. See
+// doc/devel/netplay/spectator for the format.
+typedef enum {
+	SPECTATOR_INIT,
+	SPECTATOR_MATCHSTART,
+	SPECTATOR_FLEET,
+	SPECTATOR_TEAMNAME,
+	SPECTATOR_SELECTSHIP,
+	SPECTATOR_FRAME,
+	SPECTATOR_CHECKSUM,
+	SPECTATOR_MATCHEND,
+	SPECTATOR_SNAPSHOT,
+	SPECTATOR_INPUTRUN,
+	SPECTATOR_BATTLEEND,
+} SpectatorRecordType;
+
+#define SPECTATOR_RANDOM_SHIP 0xffff
+		/* 'choice' in SPECTATOR_SELECTSHIP for a random ship. */
+
+bool Spectator_open(const char *port);
+void Spectator_close(void);
+size_t Spectator_getNumClients(void);
+
+void Spectator_matchStart(uint32 seed);
+void Spectator_fleet(uint8 side, const uint8 *ships, size_t numShips);
+void Spectator_teamName(uint8 side, const char *name);
+void Spectator_selectShip(uint8 side, uint16 choice);
+void Spectator_frame(uint32 frameNr, const uint8 *inputs, size_t numInputs);
+void Spectator_checksum(uint32 frameNr, uint32 checksum);
+void Spectator_battleEnd(void);
+void Spectator_matchEnd(void);
+bool Spectator_matchActive(void);
+
+void Spectator_flush(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_SUPERMELEE_NETPLAY_SPECTATOR_H_ */
+
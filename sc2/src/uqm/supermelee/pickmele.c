@@ -29,10 +29,12 @@
 #include "../master.h"
 #include "../nameref.h"
 #include "melee.h"
+#include "replay.h"
 #ifdef NETPLAY
 #	include "netplay/netmelee.h"
 #	include "netplay/netmisc.h"
 #	include "netplay/notify.h"
+#	include "netplay/spectator.h"
 #endif
 #include "../races.h"
 #include "../setup.h"
@@ -287,6 +289,28 @@ selectShipComputer (ComputerInputContext *context, GETMELEE_STATE *gms)
 			// Simulate selection of the random choice button.
 }
 
+BOOLEAN
+selectShipReplay (ReplayInputContext *context, GETMELEE_STATE *gms)
+{
+	COUNT choice;
+
+	switch (Replay_getShipSelection (context->playerNr, &choice))
+	{
+		case REPLAY_SELECT_WAIT:
+			return TRUE;
+		case REPLAY_SELECT_DONE:
+			if (!setShipSelected (gms, context->playerNr, choice, false))
+			{
+				log_add (log_Warning, "Invalid ship selection in the "
+						"replay.");
+				return FALSE;
+			}
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
 #ifdef NETPLAY
 BOOLEAN
 selectShipNetwork (NetworkInputContext *context, GETMELEE_STATE *gms)
@@ -661,6 +685,9 @@ MeleeGameOver (void)
 	negotiateReadyConnections(true, NetState_inSetup);
 #endif
 
+	if (Replay_isPlaying ())
+		return;
+
 	TimeOut = GetTimeCounter () + (ONE_SECOND * 4);
 
 	PressState = PulsedInputState.menu[KEY_MENU_SELECT] ||
@@ -827,6 +854,27 @@ GetMeleeStarShips (COUNT playerMask, HSTARSHIP *ships)
 		setStateConnections (NetState_interBattle);
 #endif
 
+	if (ok)
+	{
+		for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+		{
+			COUNT choice;
+
+			if (!gmstate.player[playerI].selecting)
+				continue;
+
+			choice = gmstate.player[playerI].choice;
+			Replay_shipSelected (playerI, choice);
+#ifdef NETPLAY
+			Spectator_selectShip (playerI, choice == (COUNT) ~0 ?
+					SPECTATOR_RANDOM_SHIP : (uint16) choice);
+#endif
+		}
+#ifdef NETPLAY
+		Spectator_flush ();
+#endif
+	}
+
 	if (!ok)
 	{
 		// Aborting.
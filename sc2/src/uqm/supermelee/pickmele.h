@@ -41,6 +41,7 @@ bool updateMeleeSelection (GETMELEE_STATE *gms, COUNT player, COUNT ship);
 BOOLEAN selectShipHuman (HumanInputContext *context, GETMELEE_STATE *gms);
 BOOLEAN selectShipComputer (ComputerInputContext *context,
 		GETMELEE_STATE *gms);
+BOOLEAN selectShipReplay (ReplayInputContext *context, GETMELEE_STATE *gms);
 #ifdef NETPLAY
 BOOLEAN selectShipNetwork (NetworkInputContext *context, GETMELEE_STATE *gms);
 #endif  /* NETPLAY */
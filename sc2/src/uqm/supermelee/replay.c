@@ -0,0 +1,709 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Recording and playback of SuperMelee matches.
+//
+// The simulation of a battle only depends on the random number generator
+// and on the input of the players, so a match can be replayed from the
+// seed, the fleets, the ships selected, and the input of each frame.
+// The only other thing which influences it is when the next ship is
+// selected after a ship has died; this depends on the music, so it is
+// recorded as well.
+// The computer players still think during playback, as they draw random
+// numbers while doing so, but their recorded input is used.
+//
+// A replay file starts with REPLAY_MAGIC, followed by:
+//     uqm version (major, minor, patch), NUM_PLAYERS      4 bytes
+//     random seed at the start of the match              4 bytes
+//     PlayerControl[] for each player                    NUM_PLAYERS bytes
+//     the fleet of each player                           NUM_PLAYERS *
+//                                                        MELEE_FLEET_SIZE
+//     the team name of each player: length, then name
+// and then by events, each starting with a type byte:
+//     'i' input[NUM_PLAYERS], count (2 bytes)
+//             The input of 'count' consecutive frames.
+//     'k' frame (4 bytes), random seed (4 bytes)
+//             A keyframe, written every REPLAY_KEYFRAME_INTERVAL frames
+//             at the start of the frame.
+//     's' player (1 byte), choice (2 bytes)
+//             A ship selection, as passed to setShipSelected().
+//     'b' The battle continues after a ship has died.
+//     'e' End of the match.
+// Frames are counted from the start of the match. Numbers are stored
+// little endian.
+//
+// A match can also be played back live, while it is received; see
+// netplay/spectate.c. The data then comes in as it is needed, and there
+// are no keyframes.
+
+#include "replay.h"
+
+#include "melee.h"
+#include "../globdata.h"
+#include "../init.h"
+#include "../intel.h"
+#include "../setup.h"
+#include "uqmversion.h"
+#include "libs/log.h"
+#include "libs/mathlib.h"
+#include "libs/timelib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+ReplayOptions replayOptions = {
+	/* .recordFile = */ NULL,
+	/* .playFile   = */ NULL,
+	/* .playSpeed  = */ 0,
+	/* .seekFrame  = */ 0,
+};
+
+static DWORD matchFrame;
+		// Frames since the start of the match being recorded or played.
+
+// Recording
+static FILE *recordFile;
+static BATTLE_INPUT_STATE runInput[NUM_PLAYERS];
+static DWORD runLength;
+		// Frames with input 'runInput' which are not written yet.
+
+// Playback
+static BOOLEAN playing;
+static BYTE *playData;
+static size_t playSize;
+static size_t playPos;
+static size_t playAlloc;
+static ReplayFetchFunc playFetch;
+		// Gets more data during live playback; NULL otherwise, or when
+		// no more will come.
+static BOOLEAN playLive;
+static DWORD playSeed;
+static BATTLE_INPUT_STATE playInput[NUM_PLAYERS];
+static DWORD playInputLeft;
+		// Frames left for which 'playInput' is the input.
+static DWORD seekTarget;
+static BOOLEAN seeking;
+
+static DWORD playedFrames;
+static uint64 playTime;
+static uint64 lastFrameTime;
+		// 0 when the previous frame was not part of the same run of
+		// battle frames.
+
+
+static void
+putUInt (BYTE *buf, DWORD value, int numBytes)
+{
+	int i;
+
+	for (i = 0; i < numBytes; i++)
+	{
+		buf[i] = (BYTE) (value & 0xff);
+		value >>= 8;
+	}
+}
+
+static DWORD
+getUInt (const BYTE *buf, int numBytes)
+{
+	DWORD result = 0;
+
+	while (numBytes--)
+		result = (result << 8) | buf[numBytes];
+	return result;
+}
+
+static DWORD
+peekRandomSeed (void)
+{
+	DWORD seed = TFB_SeedRandom (0);
+	TFB_SeedRandom (seed);
+	return seed;
+}
+
+static void
+writeData (const BYTE *data, size_t size)
+{
+	if (fwrite (data, size, 1, recordFile) != 1)
+	{
+		log_add (log_Warning, "Warning: Could not write to the replay "
+				"file; recording stopped.");
+		fclose (recordFile);
+		recordFile = NULL;
+	}
+}
+
+static void
+flushRun (void)
+{
+	BYTE buf[1 + NUM_PLAYERS + 2];
+
+	if (runLength == 0 || recordFile == NULL)
+		return;
+
+	buf[0] = 'i';
+	memcpy (buf + 1, runInput, NUM_PLAYERS);
+	putUInt (buf + 1 + NUM_PLAYERS, runLength, 2);
+	writeData (buf, sizeof buf);
+	runLength = 0;
+}
+
+static void
+writeEvent (const BYTE *event, size_t size)
+{
+	if (recordFile == NULL)
+		return;
+	flushRun ();
+	if (recordFile != NULL)
+		writeData (event, size);
+}
+
+BOOLEAN
+Replay_isPlaying (void)
+{
+	return playing;
+}
+
+static size_t
+eventSize (BYTE type)
+{
+	switch (type)
+	{
+		case 'i':
+			return 1 + NUM_PLAYERS + 2;
+		case 'k':
+			return 1 + 4 + 4;
+		case 's':
+			return 1 + 1 + 2;
+		case 'b':
+		case 'e':
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// Returns the next event without consuming it, or NULL if there is none.
+static const BYTE *
+peekEvent (void)
+{
+	size_t size;
+
+	for (;;)
+	{
+		if (playPos < playSize)
+		{
+			size = eventSize (playData[playPos]);
+			if (size == 0)
+				return NULL;
+			if (playPos + size <= playSize)
+				return playData + playPos;
+		}
+
+		if (playFetch == NULL || !playFetch ())
+			return NULL;
+	}
+}
+
+static void
+nextEvent (void)
+{
+	playPos += eventSize (playData[playPos]);
+}
+
+static void
+setPlaySpeed (BYTE speed)
+{
+	extern UWORD nth_frame;
+
+	nth_frame = speed == 0 ? 0 : MAKE_WORD (1, speed);
+}
+
+// Stop the playback halfway a match. 'reason' is NULL if the match was
+// ended there when it was recorded.
+static void
+stopPlaying (const char *reason)
+{
+	if (reason != NULL)
+		log_add (log_Warning, "Warning: Stopping the replay at frame %lu: "
+				"%s.", (unsigned long) matchFrame, reason);
+	GLOBAL (CurrentActivity) |= CHECK_ABORT;
+	memset (playInput, 0, sizeof playInput);
+	playInputLeft = 0;
+	playPos = playSize;
+	playFetch = NULL;
+}
+
+// Set up 'setup' and PlayerControl[] from the header of the replay in
+// 'playData'. Returns FALSE if the header is not valid.
+static BOOLEAN
+parseHeader (MeleeSetup *setup)
+{
+	size_t pos;
+	COUNT playerI;
+
+	if (playSize < REPLAY_MAGIC_SIZE + 8 ||
+			memcmp (playData, REPLAY_MAGIC, REPLAY_MAGIC_SIZE) != 0 ||
+			playData[REPLAY_MAGIC_SIZE + 3] != NUM_PLAYERS)
+		return FALSE;
+
+	pos = REPLAY_MAGIC_SIZE;
+	if (playData[pos] != UQM_MAJOR_VERSION ||
+			playData[pos + 1] != UQM_MINOR_VERSION ||
+			playData[pos + 2] != UQM_PATCH_VERSION)
+	{
+		log_add (log_Warning, "Warning: The replay was recorded with UQM "
+				"%d.%d.%d; it may not play back the same.",
+				playData[pos], playData[pos + 1], playData[pos + 2]);
+	}
+	pos += 4;
+	playSeed = getUInt (playData + pos, 4);
+	pos += 4;
+
+	if (pos + NUM_PLAYERS * (1 + MELEE_FLEET_SIZE) > playSize)
+		return FALSE;
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+	{
+		BYTE control = playData[pos++];
+
+		// There is no network during playback; the recorded input of
+		// a network player is used like that of any human player.
+		if (control & NETWORK_CONTROL)
+			control = (control & ~NETWORK_CONTROL) | HUMAN_CONTROL;
+		PlayerControl[playerI] = control;
+	}
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+	{
+		FleetShipIndex slotI;
+
+		for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++)
+			MeleeSetup_setShip (setup, playerI, slotI,
+					(MeleeShip) playData[pos++]);
+	}
+	for (playerI = 0; playerI < NUM_PLAYERS; playerI++)
+	{
+		char name[MAX_TEAM_CHARS + 1];
+		size_t len;
+
+		if (pos >= playSize)
+			return FALSE;
+		len = playData[pos++];
+		if (len > MAX_TEAM_CHARS || pos + len > playSize)
+			return FALSE;
+		memcpy (name, playData + pos, len);
+		name[len] = '\0';
+		MeleeSetup_setTeamName (setup, playerI, name);
+		pos += len;
+	}
+	playPos = pos;
+	return TRUE;
+}
+
+// Read 'replayOptions.playFile' and set up 'setup' and PlayerControl[]
+// for playing it back.
+BOOLEAN
+Replay_load (MeleeSetup *setup)
+{
+	FILE *file;
+	long fileSize;
+	const BYTE *event;
+
+	file = fopen (replayOptions.playFile, "rb");
+	if (file == NULL)
+	{
+		log_add (log_Error, "Error: Could not open replay '%s'.",
+				replayOptions.playFile);
+		return FALSE;
+	}
+	fseek (file, 0, SEEK_END);
+	fileSize = ftell (file);
+	fseek (file, 0, SEEK_SET);
+
+	playData = NULL;
+	if (fileSize > REPLAY_MAGIC_SIZE + 8)
+		playData = malloc (fileSize);
+	if (playData == NULL || fread (playData, fileSize, 1, file) != 1)
+		goto bad;
+	fclose (file);
+	file = NULL;
+	playSize = (size_t) fileSize;
+	playAlloc = playSize;
+	playFetch = NULL;
+	playLive = FALSE;
+	if (!parseHeader (setup))
+		goto bad;
+
+
+	// Find the keyframe to start at.
+	{
+		size_t pos = playPos;
+
+		seekTarget = 0;
+		while ((event = peekEvent ()) != NULL)
+		{
+			if (event[0] == 'k')
+			{
+				DWORD frame = getUInt (event + 1, 4);
+				if (frame > replayOptions.seekFrame)
+					break;
+				seekTarget = frame;
+			}
+			nextEvent ();
+		}
+		playPos = pos;
+	}
+
+	playing = TRUE;
+	log_add (log_Info, "Playing back replay '%s'.", replayOptions.playFile);
+	return TRUE;
+
+bad:
+	log_add (log_Error, "Error: '%s' is not a valid replay.",
+			replayOptions.playFile);
+	if (file != NULL)
+		fclose (file);
+	free (playData);
+	playData = NULL;
+	return FALSE;
+}
+
+// Start playing back a match while it is received. 'data' must hold at
+// least the header. 'fetch' is called when more is needed. Up to frame
+// 'seekFrame', the match is played at full speed without drawing.
+BOOLEAN
+Replay_loadLive (MeleeSetup *setup, const BYTE *data, size_t size,
+		ReplayFetchFunc fetch, DWORD seekFrame)
+{
+	playData = malloc (size);
+	if (playData == NULL)
+		return FALSE;
+	memcpy (playData, data, size);
+	playSize = size;
+	playAlloc = size;
+	if (!parseHeader (setup))
+	{
+		log_add (log_Error, "Error: Received an invalid match header.");
+		free (playData);
+		playData = NULL;
+		return FALSE;
+	}
+
+	playFetch = fetch;
+	playLive = TRUE;
+	seekTarget = seekFrame;
+	playing = TRUE;
+	return TRUE;
+}
+
+// Add received data during live playback.
+void
+Replay_addData (const BYTE *data, size_t size)
+{
+	if (playData == NULL)
+		return;
+
+	// What has been played is no longer needed.
+	if (playPos > 0)
+	{
+		memmove (playData, playData + playPos, playSize - playPos);
+		playSize -= playPos;
+		playPos = 0;
+	}
+
+	if (playSize + size > playAlloc)
+	{
+		size_t newAlloc = playAlloc * 2;
+		BYTE *newData;
+
+		while (newAlloc < playSize + size)
+			newAlloc *= 2;
+		newData = realloc (playData, newAlloc);
+		if (newData == NULL)
+		{
+			stopPlaying ("out of memory");
+			return;
+		}
+		playData = newData;
+		playAlloc = newAlloc;
+	}
+
+	memcpy (playData + playSize, data, size);
+	playSize += size;
+}
+
+// Called when a match starts, before anything random happens.
+void
+Replay_matchStart (const MeleeSetup *setup)
+{
+	BYTE buf[REPLAY_MAGIC_SIZE + 8];
+	COUNT playerI;
+
+	matchFrame = 0;
+	runLength = 0;
+
+	if (playing)
+	{
+		TFB_SeedRandom (playSeed);
+		playInputLeft = 0;
+		playedFrames = 0;
+		playTime = 0;
+		lastFrameTime = 0;
+		seeking = seekTarget > 0;
+		setPlaySpeed (seeking ? REPLAY_SPEED_MAX : replayOptions.playSpeed);
+		return;
+	}
+
+	if (replayOptions.recordFile == NULL)
+		return;
+
+	recordFile = fopen (replayOptions.recordFile, "wb");
+	if (recordFile == NULL)
+	{
+		log_add (log_Warning, "Warning: Could not open '%s' to record the "
+				"match to.", replayOptions.recordFile);
+		return;
+	}
+
+	memcpy (buf, REPLAY_MAGIC, REPLAY_MAGIC_SIZE);
+	buf[REPLAY_MAGIC_SIZE] = UQM_MAJOR_VERSION;
+	buf[REPLAY_MAGIC_SIZE + 1] = UQM_MINOR_VERSION;
+	buf[REPLAY_MAGIC_SIZE + 2] = UQM_PATCH_VERSION;
+	buf[REPLAY_MAGIC_SIZE + 3] = NUM_PLAYERS;
+	putUInt (buf + REPLAY_MAGIC_SIZE + 4, peekRandomSeed (), 4);
+	writeData (buf, sizeof buf);
+
+	for (playerI = 0; playerI < NUM_PLAYERS && recordFile != NULL;
+			playerI++)
+		writeData (&PlayerControl[playerI], 1);
+	for (playerI = 0; playerI < NUM_PLAYERS && recordFile != NULL;
+			playerI++)
+	{
+		BYTE fleet[MELEE_FLEET_SIZE];
+		FleetShipIndex slotI;
+
+		for (slotI = 0; slotI < MELEE_FLEET_SIZE; slotI++)
+		{
+			MeleeShip ship = MeleeSetup_getShip (setup, playerI, slotI);
+			fleet[slotI] = (BYTE) ship;
+		}
+		writeData (fleet, MELEE_FLEET_SIZE);
+	}
+	for (playerI = 0; playerI < NUM_PLAYERS && recordFile != NULL;
+			playerI++)
+	{
+		const char *name = MeleeSetup_getTeamName (setup, playerI);
+		BYTE len = (BYTE) strlen (name);
+
+		writeData (&len, 1);
+		if (recordFile != NULL)
+			writeData ((const BYTE *) name, len);
+	}
+}
+
+void
+Replay_matchEnd (void)
+{
+	if (recordFile != NULL)
+	{
+		BYTE event = 'e';
+
+		writeEvent (&event, 1);
+		if (recordFile != NULL)
+		{
+			fclose (recordFile);
+			recordFile = NULL;
+			log_add (log_Info, "Recorded %lu frames to '%s'.",
+					(unsigned long) matchFrame, replayOptions.recordFile);
+		}
+	}
+
+	if (playing)
+	{
+		double seconds = (double) playTime / GetPerfFrequency ();
+
+		log_add (log_Info, "Replayed %lu frames in %.3f s: %.1f frames/s.",
+				(unsigned long) playedFrames, seconds,
+				seconds > 0 ? playedFrames / seconds : 0.0);
+		playing = FALSE;
+		playFetch = NULL;
+		playLive = FALSE;
+		free (playData);
+		playData = NULL;
+		setPlaySpeed (0);
+	}
+}
+
+DWORD
+Replay_getPlayedFrames (void)
+{
+	return playedFrames;
+}
+
+// Called at the start of each battle frame, before the input is read.
+void
+Replay_frameStart (void)
+{
+	const BYTE *event;
+
+	if (matchFrame % REPLAY_KEYFRAME_INTERVAL == 0)
+	{
+		if (recordFile != NULL)
+		{
+			BYTE buf[9];
+
+			buf[0] = 'k';
+			putUInt (buf + 1, matchFrame, 4);
+			putUInt (buf + 5, peekRandomSeed (), 4);
+			writeEvent (buf, sizeof buf);
+		}
+		else if (playing && !playLive)
+		{
+			event = peekEvent ();
+			if (event == NULL || event[0] != 'k' ||
+					getUInt (event + 1, 4) != matchFrame)
+			{
+				stopPlaying ("keyframe missing");
+				return;
+			}
+			if (getUInt (event + 5, 4) != peekRandomSeed ())
+			{
+				stopPlaying ("the simulation is out of sync");
+				return;
+			}
+			nextEvent ();
+		}
+	}
+
+	if (playing)
+	{
+		uint64 now;
+
+		if (seeking && matchFrame >= seekTarget)
+		{
+			seeking = FALSE;
+			setPlaySpeed (replayOptions.playSpeed);
+		}
+
+		if (playInputLeft == 0)
+		{
+			event = peekEvent ();
+			if (event == NULL || event[0] != 'i')
+			{
+				stopPlaying (event != NULL && event[0] == 'e' ? NULL :
+						"input missing");
+				return;
+			}
+			memcpy (playInput, event + 1, NUM_PLAYERS);
+			playInputLeft = getUInt (event + 1 + NUM_PLAYERS, 2);
+			nextEvent ();
+		}
+		playInputLeft--;
+
+		now = GetPerfCounter ();
+		if (lastFrameTime != 0)
+			playTime += now - lastFrameTime;
+		lastFrameTime = now;
+		playedFrames++;
+	}
+
+	matchFrame++;
+}
+
+// Called at the end of ProcessInput(), with the input used for each
+// player.
+void
+Replay_frameEnd (const BATTLE_INPUT_STATE *inputs)
+{
+	if (recordFile == NULL)
+		return;
+
+	if (runLength > 0 && runLength < REPLAY_MAX_RUN &&
+			memcmp (runInput, inputs, sizeof runInput) == 0)
+	{
+		runLength++;
+		return;
+	}
+
+	flushRun ();
+	memcpy (runInput, inputs, sizeof runInput);
+	runLength = 1;
+}
+
+BATTLE_INPUT_STATE
+Replay_getInput (COUNT playerNr)
+{
+	return playInput[playerNr];
+}
+
+void
+Replay_shipSelected (COUNT playerNr, COUNT choice)
+{
+	BYTE buf[4];
+
+	buf[0] = 's';
+	buf[1] = (BYTE) playerNr;
+	putUInt (buf + 2, choice, 2);
+	writeEvent (buf, sizeof buf);
+}
+
+ReplaySelectResult
+Replay_getShipSelection (COUNT playerNr, COUNT *choice)
+{
+	const BYTE *event = peekEvent ();
+
+	lastFrameTime = 0;
+
+	if (event == NULL || event[0] != 's')
+	{
+		if (event == NULL || event[0] != 'e')
+			stopPlaying ("ship selection missing");
+		return REPLAY_SELECT_ABORT;
+	}
+
+	if (event[1] != playerNr)
+		return REPLAY_SELECT_WAIT;
+
+	*choice = (COUNT) getUInt (event + 2, 2);
+	nextEvent ();
+	return REPLAY_SELECT_DONE;
+}
+
+// Called when the battle goes on after a ship has died.
+void
+Replay_battleEnd (void)
+{
+	BYTE event = 'b';
+
+	writeEvent (&event, 1);
+}
+
+BOOLEAN
+Replay_battleEndReady (void)
+{
+	const BYTE *event;
+
+	if (playInputLeft > 0)
+		return FALSE;
+
+	event = peekEvent ();
+	if (event == NULL || event[0] != 'b')
+		return FALSE;
+
+	nextEvent ();
+	lastFrameTime = 0;
+	return TRUE;
+}
@@ -0,0 +1,95 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef UQM_SUPERMELEE_REPLAY_H_
+#define UQM_SUPERMELEE_REPLAY_H_
+
+#include "meleesetup.h"
+#include "../controls.h"
+#include "types.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define REPLAY_MAGIC "UQMrply1"
+#define REPLAY_MAGIC_SIZE 8
+#define REPLAY_MAX_RUN 0xffff
+		// The most frames in one 'i' event.
+
+// A keyframe, with the state of the random number generator, is written
+// every this many frames. Playback can start at a keyframe, and checks
+// at each one that the simulation is still the same.
+#define REPLAY_KEYFRAME_INTERVAL 240
+
+#define REPLAY_SPEED_MAX ((BYTE) ~0)
+		// As 'playSpeed': as fast as possible, without drawing anything.
+
+typedef struct
+{
+	const char *recordFile;
+			// Each SuperMelee match is recorded to this file, if set.
+	const char *playFile;
+			// Replay this file instead of showing the SuperMelee menu.
+	BYTE playSpeed;
+			// Frames skipped per frame drawn, or REPLAY_SPEED_MAX.
+	DWORD seekFrame;
+			// Play at full speed without drawing up to the last
+			// keyframe before this frame.
+} ReplayOptions;
+
+extern ReplayOptions replayOptions;
+
+typedef enum
+{
+	REPLAY_SELECT_WAIT,
+			// Another player selects first.
+	REPLAY_SELECT_DONE,
+	REPLAY_SELECT_ABORT,
+			// The match was ended here.
+} ReplaySelectResult;
+
+// Called during live playback when the next event has not been received
+// yet. Returns FALSE if no more will come; otherwise it has passed more
+// data to Replay_addData().
+typedef BOOLEAN (*ReplayFetchFunc) (void);
+
+BOOLEAN Replay_isPlaying (void);
+
+BOOLEAN Replay_load (MeleeSetup *setup);
+BOOLEAN Replay_loadLive (MeleeSetup *setup, const BYTE *data, size_t size,
+		ReplayFetchFunc fetch, DWORD seekFrame);
+void Replay_addData (const BYTE *data, size_t size);
+void Replay_matchStart (const MeleeSetup *setup);
+void Replay_matchEnd (void);
+DWORD Replay_getPlayedFrames (void);
+		// The number of frames of the last match played back.
+
+void Replay_frameStart (void);
+void Replay_frameEnd (const BATTLE_INPUT_STATE *inputs);
+BATTLE_INPUT_STATE Replay_getInput (COUNT playerNr);
+
+void Replay_shipSelected (COUNT playerNr, COUNT choice);
+ReplaySelectResult Replay_getShipSelection (COUNT playerNr, COUNT *choice);
+
+void Replay_battleEnd (void);
+BOOLEAN Replay_battleEndReady (void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_SUPERMELEE_REPLAY_H_ */
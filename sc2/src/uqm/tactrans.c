@@ -28,6 +28,7 @@
 #include "battle.h"
 #include "init.h"
 #include "supermelee/pickmele.h"
+#include "supermelee/replay.h"
 #ifdef NETPLAY
 #	include "supermelee/netplay/netmelee.h"
 #	include "supermelee/netplay/netmisc.h"
@@ -35,6 +36,7 @@
 #	include "supermelee/netplay/proto/ready.h"
 #	include "supermelee/netplay/packet.h"
 #	include "supermelee/netplay/packetq.h"
+#	include "supermelee/netplay/spectator.h"
 #endif
 #include "races.h"
 #include "encount.h"
@@ -242,6 +244,14 @@ battleEndReadyComputer (ComputerInputContext *context)
 	return true;
 }
 
+bool
+battleEndReadyReplay (ReplayInputContext *context)
+{
+	// readyForBattleEnd() asks the replay directly.
+	(void) context;
+	return true;
+}
+
 #ifdef NETPLAY
 bool
 battleEndReadyNetwork (NetworkInputContext *context)
@@ -254,6 +264,16 @@ battleEndReadyNetwork (NetworkInputContext *context)
 static inline bool
 readyForBattleEnd (void)
 {
+#ifdef NETPLAY
+	int playerI;
+#endif
+
+	if (Replay_isPlaying ())
+	{
+		// The battle ends at the same frame as when it was recorded.
+		return Replay_battleEndReady ();
+	}
+
 #ifndef NETPLAY
 #if DEMO_MODE
 	// In Demo mode, the saved journal should be replayed with frame
@@ -263,8 +283,6 @@ readyForBattleEnd (void)
 	return !DittyPlaying ();
 #endif  /* !DEMO_MODE */
 #else  /* defined (NETPLAY) */
-	int playerI;
-
 	if (DittyPlaying ())
 		return false;
 
@@ -459,6 +477,10 @@ new_ship (ELEMENT *DeadShipPtr)
 		checkOtherShipLifeSpan (DeadShipPtr);
 		return;
 	}
+	Replay_battleEnd ();
+#ifdef NETPLAY
+	Spectator_battleEnd ();
+#endif
 
 	// Once a ship is being picked, we do not care about the winner anymore
 	winnerStarShip = NULL;
@@ -30,6 +30,7 @@ extern "C" {
 
 bool battleEndReadyHuman (HumanInputContext *context);
 bool battleEndReadyComputer (ComputerInputContext *context);
+bool battleEndReadyReplay (ReplayInputContext *context);
 #ifdef NETPLAY
 bool battleEndReadyNetwork (NetworkInputContext *context);
 #endif
@@ -0,0 +1,1025 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Benchmarks of the hot paths of the game, run with --bench=FILE in
+// place of the game itself.
+// Each benchmark is run a number of times to warm up, and then timed for
+// a fixed number of samples. Everything that is random is seeded with a
+// fixed value, so that the results of different builds on the same
+// machine can be compared.
+// The mixer benchmarks run before the audio driver is started, as the
+// mixer is shared with it; the others once the game kernel is loaded.
+
+#include "uqmbench.h"
+
+#include "globdata.h"
+#include "options.h"
+#include "planets/planets.h"
+#include "setup.h"
+#include "starcon.h"
+#include "supermelee/melee.h"
+#include "supermelee/replay.h"
+#include "uqmdebug.h"
+#include "uqmversion.h"
+#include "libs/gfxlib.h"
+#include "libs/graphics/gfx_common.h"
+#include "libs/graphics/tfb_draw.h"
+#include "libs/log.h"
+#include "libs/mathlib.h"
+#include "libs/memlib.h"
+#include "libs/reslib.h"
+#include "libs/sound/decoders/decoder.h"
+#include "libs/sound/mixer/mixer.h"
+#include "libs/timelib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#ifndef M_PI
+#	define M_PI 3.14159265358979323846
+#endif
+
+
+#define BENCH_CANVAS_WIDTH 320
+#define BENCH_CANVAS_HEIGHT 240
+#define BENCH_SPRITE_SIZE 64
+#define BENCH_DRAWS 100
+		// Number of draws per sample of the drawing benchmarks.
+#define BENCH_DCQ_COMMANDS 256
+#define BENCH_DECODE_BUFFERS 64
+#define BENCH_DECODE_BUFFER_SIZE 4096
+#define BENCH_SEEKS 64
+#define BENCH_READ_SIZE 4096
+#define BENCH_TOPO_FAULTS 200
+#define BENCH_SEED 0x5eed1e55
+#define BENCH_MIX_RATE 44100
+#define BENCH_MIX_SFX_RATE 22050
+#define BENCH_MIX_SOURCES 6
+		// One stereo music track at the output rate, and mono sound
+		// effects at half of it, which have to be resampled.
+#define BENCH_MIX_FRAMES 4096
+		// Frames mixed per sample.
+#define BENCH_MELEE_SAMPLES 3
+
+#define BENCH_MOD_FILE "base/ui/outfit.mod"
+#define BENCH_OGG_FILE "addons/3domusic/starbase.ogg"
+#define BENCH_RESOURCE_INDEX "uqm.rmp"
+#define BENCH_RESOURCE_PREFIX "bench."
+
+typedef struct
+{
+	const char *name;
+	BOOLEAN (*setup) (void **state);
+			// Returns FALSE if the benchmark can not be run, for
+			// instance because some content is missing. May be NULL.
+	void (*run) (void *state);
+	void (*cleanup) (void *state);
+			// May be NULL.
+	COUNT warmup;
+	COUNT samples;
+	COUNT opsPerSample;
+			// Number of operations in one run, such as draws or seeks.
+	DWORD (*countOps) (void *state);
+			// If not NULL, returns the number of operations in the last
+			// run, in place of 'opsPerSample'.
+} Benchmark;
+
+typedef struct
+{
+	mixer_Object sources[BENCH_MIX_SOURCES];
+	mixer_Object buffers[BENCH_MIX_SOURCES];
+	sint16 *data[BENCH_MIX_SOURCES];
+			// The mixer plays from this data; it must outlive the buffers.
+	uint8 *out;
+} MixerBenchState;
+
+typedef struct
+{
+	TFB_ScalerBench *scaler;
+} ScalerBenchState;
+
+typedef struct
+{
+	BYTE playSpeed;
+} MeleeBenchState;
+
+typedef struct
+{
+	TFB_Canvas target;
+	TFB_Image *sprite;
+	TFB_Canvas other;
+			// For intersection; the same shape as the sprite, with the
+			// opaque pixels where the sprite is transparent.
+	DrawMode mode;
+	int scaleMode;
+} DrawBenchState;
+
+typedef struct
+{
+	TFB_SoundDecoder *decoder;
+} DecodeBenchState;
+
+typedef struct
+{
+	uio_Stream *fp;
+	size_t length;
+	BYTE buf[BENCH_READ_SIZE];
+} ReadBenchState;
+
+typedef struct
+{
+	RandomContext *rng;
+	SBYTE *topo;
+			// MAP_WIDTH * MAP_HEIGHT
+} TopoBenchState;
+
+
+static BOOLEAN setupMixerBench (void **state, mixer_Quality quality);
+static BOOLEAN setupMixLow (void **state);
+static BOOLEAN setupMixMedium (void **state);
+static BOOLEAN setupMixHigh (void **state);
+static void runMix (void *state);
+static void cleanupMixerBench (void *state);
+
+static BOOLEAN setupScalerBench (void **state, int flags);
+static BOOLEAN setupScaleNearest (void **state);
+static BOOLEAN setupScaleBilinear (void **state);
+static BOOLEAN setupScaleBiadapt (void **state);
+static BOOLEAN setupScaleBiadaptAdv (void **state);
+static BOOLEAN setupScaleTriscan (void **state);
+static BOOLEAN setupScaleHq (void **state);
+static void runScale (void *state);
+static void cleanupScalerBench (void *state);
+
+static BOOLEAN setupDrawBench (DrawBenchState **state, DrawMode mode,
+		int scaleMode);
+static BOOLEAN setupBlitReplace (void **state);
+static BOOLEAN setupBlitAdditive (void **state);
+static BOOLEAN setupBlitAlpha (void **state);
+static BOOLEAN setupBlitNearest (void **state);
+static BOOLEAN setupBlitBilinear (void **state);
+static void runBlit (void *state);
+static void runBlitScaled (void *state);
+static void runIntersect (void *state);
+static void cleanupDrawBench (void *state);
+
+static void runDCQPushFlush (void *state);
+
+static BOOLEAN setupDecodeBench (void **state, const char *fileName);
+static BOOLEAN setupDecodeMod (void **state);
+static BOOLEAN setupDecodeOgg (void **state);
+static void runDecode (void *state);
+static void cleanupDecodeBench (void *state);
+
+static BOOLEAN setupReadBench (void **state);
+static void runReadSequential (void *state);
+static void runReadSeek (void *state);
+static void cleanupReadBench (void *state);
+
+static void runResourceIndexLoad (void *state);
+
+static BOOLEAN setupTopoBench (void **state);
+static void runTopography (void *state);
+static void cleanupTopoBench (void *state);
+
+#if defined(DEBUG) || defined(USE_DEBUG_KEY)
+static BOOLEAN setupUniverseBench (void **state);
+static void runUniverseIndex (void *state);
+static void cleanupUniverseBench (void *state);
+#endif
+
+static BOOLEAN setupMeleeBench (void **state);
+static void runMelee (void *state);
+static DWORD countMeleeFrames (void *state);
+static void cleanupMeleeBench (void *state);
+
+// Run by startBenchmarks().
+static const Benchmark mixerBenchmarks[] =
+{
+	{ "audio.mix.low", setupMixLow, runMix, cleanupMixerBench,
+			5, 50, BENCH_MIX_FRAMES, NULL },
+	{ "audio.mix.medium", setupMixMedium, runMix, cleanupMixerBench,
+			5, 50, BENCH_MIX_FRAMES, NULL },
+	{ "audio.mix.high", setupMixHigh, runMix, cleanupMixerBench,
+			5, 50, BENCH_MIX_FRAMES, NULL },
+};
+#define NUM_MIXER_BENCHMARKS \
+		(sizeof (mixerBenchmarks) / sizeof (mixerBenchmarks[0]))
+
+// Run by finishBenchmarks().
+static const Benchmark benchmarks[] =
+{
+	{ "scale.nearest", setupScaleNearest, runScale, cleanupScalerBench,
+			5, 50, 1, NULL },
+	{ "scale.bilinear", setupScaleBilinear, runScale, cleanupScalerBench,
+			5, 50, 1, NULL },
+	{ "scale.biadapt", setupScaleBiadapt, runScale, cleanupScalerBench,
+			5, 50, 1, NULL },
+	{ "scale.biadaptadv", setupScaleBiadaptAdv, runScale,
+			cleanupScalerBench, 5, 50, 1, NULL },
+	{ "scale.triscan", setupScaleTriscan, runScale, cleanupScalerBench,
+			5, 50, 1, NULL },
+	{ "scale.hq", setupScaleHq, runScale, cleanupScalerBench,
+			5, 50, 1, NULL },
+	{ "dcq.push_flush", NULL, runDCQPushFlush, NULL,
+			5, 30, BENCH_DCQ_COMMANDS, NULL },
+	{ "draw.blit.replace", setupBlitReplace, runBlit, cleanupDrawBench,
+			10, 50, BENCH_DRAWS, NULL },
+	{ "draw.blit.additive", setupBlitAdditive, runBlit, cleanupDrawBench,
+			10, 50, BENCH_DRAWS, NULL },
+	{ "draw.blit.alpha", setupBlitAlpha, runBlit, cleanupDrawBench,
+			10, 50, BENCH_DRAWS, NULL },
+	{ "draw.blit.scaled_nearest", setupBlitNearest, runBlitScaled,
+			cleanupDrawBench, 10, 50, BENCH_DRAWS, NULL },
+	{ "draw.blit.scaled_bilinear", setupBlitBilinear, runBlitScaled,
+			cleanupDrawBench, 10, 50, BENCH_DRAWS, NULL },
+	{ "draw.intersect", setupBlitReplace, runIntersect, cleanupDrawBench,
+			10, 50, BENCH_DRAWS, NULL },
+	{ "audio.decode.mod", setupDecodeMod, runDecode, cleanupDecodeBench,
+			2, 20, BENCH_DECODE_BUFFERS, NULL },
+	{ "audio.decode.ogg", setupDecodeOgg, runDecode, cleanupDecodeBench,
+			2, 20, BENCH_DECODE_BUFFERS, NULL },
+	{ "io.read", setupReadBench, runReadSequential, cleanupReadBench,
+			2, 20, 1, NULL },
+	{ "io.read_seek", setupReadBench, runReadSeek, cleanupReadBench,
+			2, 20, BENCH_SEEKS, NULL },
+	{ "resource.index_load", NULL, runResourceIndexLoad, NULL,
+			1, 10, 1, NULL },
+	{ "planet.topography", setupTopoBench, runTopography,
+			cleanupTopoBench, 5, 50, BENCH_TOPO_FAULTS, NULL },
+#if defined(DEBUG) || defined(USE_DEBUG_KEY)
+	{ "universe.generate", setupUniverseBench, runUniverseIndex,
+			cleanupUniverseBench, 1, 5, NUM_SOLAR_SYSTEMS, NULL },
+#endif
+	{ "melee.replay", setupMeleeBench, runMelee, cleanupMeleeBench,
+			0, BENCH_MELEE_SAMPLES, 0, countMeleeFrames },
+};
+#define NUM_BENCHMARKS (sizeof (benchmarks) / sizeof (benchmarks[0]))
+
+
+const char *benchFile = NULL;
+
+static FILE *benchOut;
+static BOOLEAN benchFirst;
+		// No benchmark has been written to 'benchOut' yet.
+
+
+static BOOLEAN
+setupMixerBench (void **state, mixer_Quality quality)
+{
+	MixerBenchState *bench;
+	COUNT srcI;
+
+	if (!mixer_Init (BENCH_MIX_RATE, MIX_FORMAT_STEREO16, quality,
+			MIX_NOFLAGS))
+		return FALSE;
+
+	bench = HCalloc (sizeof *bench);
+	bench->out = HMalloc (BENCH_MIX_FRAMES * 2 * sizeof (sint16));
+	mixer_GenSources (BENCH_MIX_SOURCES, bench->sources);
+	mixer_GenBuffers (BENCH_MIX_SOURCES, bench->buffers);
+
+	// One second of a sine wave for each source, each at its own pitch,
+	// quiet enough that the sum does not clip.
+	for (srcI = 0; srcI < BENCH_MIX_SOURCES; srcI++)
+	{
+		BOOLEAN music = (srcI == 0);
+		uint32 rate = music ? BENCH_MIX_RATE : BENCH_MIX_SFX_RATE;
+		uint32 channels = music ? 2 : 1;
+		uint32 numSamples = rate * channels;
+		uint32 i;
+
+		bench->data[srcI] = HMalloc (numSamples * sizeof (sint16));
+		for (i = 0; i < numSamples; i++)
+		{
+			bench->data[srcI][i] = (sint16) (3000.0 * sin ((double) (i
+					/ channels) * (220.0 * (srcI + 1)) * 2.0 * M_PI
+					/ rate));
+		}
+		mixer_BufferData (bench->buffers[srcI], music ? MIX_FORMAT_STEREO16
+				: MIX_FORMAT_MONO16, bench->data[srcI],
+				numSamples * sizeof (sint16), rate);
+		mixer_Sourcei (bench->sources[srcI], MIX_BUFFER,
+				(mixer_IntVal) bench->buffers[srcI]);
+	}
+
+	*state = bench;
+	return TRUE;
+}
+
+static BOOLEAN
+setupMixLow (void **state)
+{
+	return setupMixerBench (state, MIX_QUALITY_LOW);
+}
+
+static BOOLEAN
+setupMixMedium (void **state)
+{
+	return setupMixerBench (state, MIX_QUALITY_MEDIUM);
+}
+
+static BOOLEAN
+setupMixHigh (void **state)
+{
+	return setupMixerBench (state, MIX_QUALITY_HIGH);
+}
+
+static void
+runMix (void *state)
+{
+	MixerBenchState *bench = state;
+	COUNT srcI;
+
+	// The sources would stop at the end of their data otherwise; every
+	// sample mixes the same stretch.
+	for (srcI = 0; srcI < BENCH_MIX_SOURCES; srcI++)
+	{
+		mixer_SourceRewind (bench->sources[srcI]);
+		mixer_SourcePlay (bench->sources[srcI]);
+	}
+	mixer_MixChannels (NULL, bench->out,
+			BENCH_MIX_FRAMES * 2 * sizeof (sint16));
+}
+
+static void
+cleanupMixerBench (void *state)
+{
+	MixerBenchState *bench = state;
+	COUNT srcI;
+
+	for (srcI = 0; srcI < BENCH_MIX_SOURCES; srcI++)
+		mixer_SourceStop (bench->sources[srcI]);
+	mixer_DeleteSources (BENCH_MIX_SOURCES, bench->sources);
+	mixer_DeleteBuffers (BENCH_MIX_SOURCES, bench->buffers);
+	for (srcI = 0; srcI < BENCH_MIX_SOURCES; srcI++)
+		HFree (bench->data[srcI]);
+	HFree (bench->out);
+	HFree (bench);
+	mixer_Uninit ();
+}
+
+static BOOLEAN
+setupScalerBench (void **state, int flags)
+{
+	ScalerBenchState *bench;
+	TFB_ScalerBench *scaler;
+
+	scaler = TFB_ScalerBench_New (flags);
+	if (scaler == NULL)
+		return FALSE;
+
+	bench = HMalloc (sizeof *bench);
+	bench->scaler = scaler;
+	*state = bench;
+	return TRUE;
+}
+
+static BOOLEAN
+setupScaleNearest (void **state)
+{
+	return setupScalerBench (state, 0);
+}
+
+static BOOLEAN
+setupScaleBilinear (void **state)
+{
+	return setupScalerBench (state, TFB_GFXFLAGS_SCALE_BILINEAR);
+}
+
+static BOOLEAN
+setupScaleBiadapt (void **state)
+{
+	return setupScalerBench (state, TFB_GFXFLAGS_SCALE_BIADAPT);
+}
+
+static BOOLEAN
+setupScaleBiadaptAdv (void **state)
+{
+	return setupScalerBench (state, TFB_GFXFLAGS_SCALE_BIADAPTADV);
+}
+
+static BOOLEAN
+setupScaleTriscan (void **state)
+{
+	return setupScalerBench (state, TFB_GFXFLAGS_SCALE_TRISCAN);
+}
+
+static BOOLEAN
+setupScaleHq (void **state)
+{
+	return setupScalerBench (state, TFB_GFXFLAGS_SCALE_HQXX);
+}
+
+static void
+runScale (void *state)
+{
+	ScalerBenchState *bench = state;
+
+	TFB_ScalerBench_Run (bench->scaler);
+}
+
+static void
+cleanupScalerBench (void *state)
+{
+	ScalerBenchState *bench = state;
+
+	TFB_ScalerBench_Delete (bench->scaler);
+	HFree (bench);
+}
+
+static BOOLEAN
+setupDrawBench (DrawBenchState **state, DrawMode mode, int scaleMode)
+{
+	DrawBenchState *bench;
+	Color *pixels;
+	Color *otherPixels;
+	int x, y;
+
+	bench = HCalloc (sizeof *bench);
+	pixels = HMalloc (BENCH_SPRITE_SIZE * BENCH_SPRITE_SIZE
+			* sizeof *pixels);
+	otherPixels = HMalloc (BENCH_SPRITE_SIZE * BENCH_SPRITE_SIZE
+			* sizeof *otherPixels);
+
+	// A checkerboard, so that the sprite and the other canvas never
+	// collide, and TFB_DrawCanvas_Intersect() has to check every pixel.
+	for (y = 0; y < BENCH_SPRITE_SIZE; y++)
+	{
+		for (x = 0; x < BENCH_SPRITE_SIZE; x++)
+		{
+			BOOLEAN opaque = ((x + y) & 1) == 0;
+			Color *p = &pixels[y * BENCH_SPRITE_SIZE + x];
+			Color *q = &otherPixels[y * BENCH_SPRITE_SIZE + x];
+
+			*p = BUILD_COLOR_RGBA (x * 4, y * 4, 0x80, opaque ? 0xff : 0x00);
+			*q = BUILD_COLOR_RGBA (0x80, x * 4, y * 4, opaque ? 0x00 : 0xff);
+		}
+	}
+
+	bench->target = TFB_DrawCanvas_New_ForScreen (BENCH_CANVAS_WIDTH,
+			BENCH_CANVAS_HEIGHT, FALSE);
+	bench->other = TFB_DrawCanvas_New_TrueColor (BENCH_SPRITE_SIZE,
+			BENCH_SPRITE_SIZE, TRUE);
+	if (bench->target == NULL || bench->other == NULL)
+		goto err;
+	TFB_DrawCanvas_SetPixelColors (bench->other, otherPixels,
+			BENCH_SPRITE_SIZE, BENCH_SPRITE_SIZE);
+
+	{
+		TFB_Canvas spriteCanvas = TFB_DrawCanvas_New_TrueColor (
+				BENCH_SPRITE_SIZE, BENCH_SPRITE_SIZE, TRUE);
+		if (spriteCanvas == NULL)
+			goto err;
+		TFB_DrawCanvas_SetPixelColors (spriteCanvas, pixels,
+				BENCH_SPRITE_SIZE, BENCH_SPRITE_SIZE);
+		bench->sprite = TFB_DrawImage_New (spriteCanvas);
+	}
+
+	bench->mode = mode;
+	bench->scaleMode = scaleMode;
+
+	HFree (otherPixels);
+	HFree (pixels);
+	*state = bench;
+	return TRUE;
+
+err:
+	HFree (otherPixels);
+	HFree (pixels);
+	cleanupDrawBench (bench);
+	return FALSE;
+}
+
+static BOOLEAN
+setupBlitReplace (void **state)
+{
+	return setupDrawBench ((DrawBenchState **) state, DRAW_REPLACE_MODE,
+			TFB_SCALE_NEAREST);
+}
+
+static BOOLEAN
+setupBlitAdditive (void **state)
+{
+	return setupDrawBench ((DrawBenchState **) state,
+			MAKE_DRAW_MODE (DRAW_ADDITIVE, DRAW_FACTOR_1 / 2),
+			TFB_SCALE_NEAREST);
+}
+
+static BOOLEAN
+setupBlitAlpha (void **state)
+{
+	return setupDrawBench ((DrawBenchState **) state,
+			MAKE_DRAW_MODE (DRAW_ALPHA, DRAW_FACTOR_1 / 2),
+			TFB_SCALE_NEAREST);
+}
+
+static BOOLEAN
+setupBlitNearest (void **state)
+{
+	return setupDrawBench ((DrawBenchState **) state, DRAW_REPLACE_MODE,
+			TFB_SCALE_NEAREST);
+}
+
+static BOOLEAN
+setupBlitBilinear (void **state)
+{
+	return setupDrawBench ((DrawBenchState **) state, DRAW_REPLACE_MODE,
+			TFB_SCALE_BILINEAR);
+}
+
+static void
+runBlit (void *state)
+{
+	DrawBenchState *bench = state;
+	COUNT i;
+
+	for (i = 0; i < BENCH_DRAWS; i++)
+	{
+		TFB_DrawCanvas_Image (bench->sprite,
+				(i * 37) % (BENCH_CANVAS_WIDTH - BENCH_SPRITE_SIZE),
+				(i * 23) % (BENCH_CANVAS_HEIGHT - BENCH_SPRITE_SIZE),
+				0, 0, NULL, bench->mode, bench->target);
+	}
+}
+
+static void
+runBlitScaled (void *state)
+{
+	DrawBenchState *bench = state;
+	COUNT i;
+
+	// The scaled image is cached in the TFB_Image as long as the scale
+	// stays the same, so the scale alternates to rescale on every draw.
+	for (i = 0; i < BENCH_DRAWS; i++)
+	{
+		int scale = (i & 1) ? GSCALE_IDENTITY * 3 / 2 : GSCALE_IDENTITY / 2;
+		TFB_DrawCanvas_Image (bench->sprite,
+				(i * 37) % (BENCH_CANVAS_WIDTH - BENCH_SPRITE_SIZE * 3 / 2),
+				(i * 23) % (BENCH_CANVAS_HEIGHT - BENCH_SPRITE_SIZE * 3 / 2),
+				scale, bench->scaleMode, NULL, bench->mode, bench->target);
+	}
+}
+
+static void
+runIntersect (void *state)
+{
+	DrawBenchState *bench = state;
+	POINT org = { 0, 0 };
+	RECT r;
+	COUNT i;
+
+	r.corner = org;
+	r.extent.width = BENCH_SPRITE_SIZE;
+	r.extent.height = BENCH_SPRITE_SIZE;
+
+	for (i = 0; i < BENCH_DRAWS; i++)
+	{
+		if (TFB_DrawCanvas_Intersect (bench->sprite->NormalImg, org,
+				bench->other, org, &r))
+		{
+			log_add (log_Warning, "draw.intersect: unexpected collision");
+			break;
+		}
+	}
+}
+
+static void
+cleanupDrawBench (void *state)
+{
+	DrawBenchState *bench = state;
+
+	if (bench->sprite)
+		TFB_DrawImage_Delete (bench->sprite);
+	if (bench->other)
+		TFB_DrawCanvas_Delete (bench->other);
+	if (bench->target)
+		TFB_DrawCanvas_Delete (bench->target);
+	HFree (bench);
+}
+
+// Measures the time from queueing draw commands until the main() thread
+// has processed them. As the queue is drained once per frame, this
+// includes the wait for the next frame.
+static void
+runDCQPushFlush (void *state)
+{
+	RECT r;
+	COUNT i;
+
+	for (i = 0; i < BENCH_DCQ_COMMANDS; i++)
+	{
+		r.corner.x = (i * 7) % (SCREEN_WIDTH - 16);
+		r.corner.y = (i * 5) % (SCREEN_HEIGHT - 16);
+		r.extent.width = 16;
+		r.extent.height = 16;
+		TFB_DrawScreen_Rect (&r, BUILD_COLOR_RGBA (i, i, i, 0xff),
+				DRAW_REPLACE_MODE, TFB_SCREEN_EXTRA);
+	}
+	FlushGraphics ();
+	(void) state;
+}
+
+static BOOLEAN
+setupDecodeBench (void **state, const char *fileName)
+{
+	DecodeBenchState *bench;
+	TFB_SoundDecoder *decoder;
+
+	decoder = SoundDecoder_Load (contentDir, fileName,
+			BENCH_DECODE_BUFFER_SIZE, 0, 0);
+	if (decoder == NULL)
+		return FALSE;
+
+	bench = HMalloc (sizeof *bench);
+	bench->decoder = decoder;
+	*state = bench;
+	return TRUE;
+}
+
+static BOOLEAN
+setupDecodeMod (void **state)
+{
+	return setupDecodeBench (state, BENCH_MOD_FILE);
+}
+
+static BOOLEAN
+setupDecodeOgg (void **state)
+{
+	return setupDecodeBench (state, BENCH_OGG_FILE);
+}
+
+static void
+runDecode (void *state)
+{
+	DecodeBenchState *bench = state;
+	COUNT i;
+
+	// Always decode the start of the track, so that every sample
+	// decodes the same data.
+	SoundDecoder_Rewind (bench->decoder);
+	for (i = 0; i < BENCH_DECODE_BUFFERS; i++)
+	{
+		if (SoundDecoder_Decode (bench->decoder) == 0)
+			SoundDecoder_Rewind (bench->decoder);
+	}
+}
+
+static void
+cleanupDecodeBench (void *state)
+{
+	DecodeBenchState *bench = state;
+
+	SoundDecoder_Free (bench->decoder);
+	HFree (bench);
+}
+
+static BOOLEAN
+setupReadBench (void **state)
+{
+	ReadBenchState *bench;
+	uio_Stream *fp;
+
+	fp = res_OpenResFile (contentDir, BENCH_OGG_FILE, "rb");
+	if (fp == NULL)
+		return FALSE;
+
+	bench = HMalloc (sizeof *bench);
+	bench->fp = fp;
+	bench->length = LengthResFile (fp);
+	if (bench->length <= BENCH_READ_SIZE)
+	{
+		cleanupReadBench (bench);
+		return FALSE;
+	}
+	*state = bench;
+	return TRUE;
+}
+
+static void
+runReadSequential (void *state)
+{
+	ReadBenchState *bench = state;
+
+	SeekResFile (bench->fp, 0, SEEK_SET);
+	while (ReadResFile (bench->buf, 1, BENCH_READ_SIZE, bench->fp)
+			== BENCH_READ_SIZE)
+		;
+}
+
+static void
+runReadSeek (void *state)
+{
+	ReadBenchState *bench = state;
+	DWORD pos = BENCH_SEED;
+	COUNT i;
+
+	for (i = 0; i < BENCH_SEEKS; i++)
+	{
+		// The same sequence of offsets for every sample.
+		pos = pos * 1103515245 + 12345;
+		SeekResFile (bench->fp, (long) (pos % (bench->length
+				- BENCH_READ_SIZE)), SEEK_SET);
+		ReadResFile (bench->buf, 1, BENCH_READ_SIZE, bench->fp);
+	}
+}
+
+static void
+cleanupReadBench (void *state)
+{
+	ReadBenchState *bench = state;
+
+	res_CloseResFile (bench->fp);
+	HFree (bench);
+}
+
+// The index is loaded under a separate prefix, so that the resources
+// of the game itself are left alone.
+static void
+runResourceIndexLoad (void *state)
+{
+	LoadResourceIndex (contentDir, BENCH_RESOURCE_INDEX,
+			BENCH_RESOURCE_PREFIX);
+	(void) state;
+}
+
+static BOOLEAN
+setupTopoBench (void **state)
+{
+	TopoBenchState *bench = HMalloc (sizeof *bench);
+
+	bench->rng = RandomContext_New ();
+	bench->topo = HMalloc (MAP_WIDTH * MAP_HEIGHT);
+	*state = bench;
+	return TRUE;
+}
+
+static void
+runTopography (void *state)
+{
+	TopoBenchState *bench = state;
+	RandomContext *oldRNG = SysGenRNG;
+	RECT r;
+
+	r.corner.x = 0;
+	r.corner.y = 0;
+	r.extent.width = MAP_WIDTH;
+	r.extent.height = MAP_HEIGHT;
+
+	memset (bench->topo, 0, MAP_WIDTH * MAP_HEIGHT);
+	RandomContext_SeedRandom (bench->rng, BENCH_SEED);
+	SysGenRNG = bench->rng;
+	DeltaTopography (BENCH_TOPO_FAULTS, bench->topo, &r, 8);
+	SysGenRNG = oldRNG;
+}
+
+static void
+cleanupTopoBench (void *state)
+{
+	TopoBenchState *bench = state;
+
+	HFree (bench->topo);
+	RandomContext_Delete (bench->rng);
+	HFree (bench);
+}
+
+#if defined(DEBUG) || defined(USE_DEBUG_KEY)
+// The benchmarks run before a game is started, so the game structures
+// that the generate functions use are set up here.
+static BOOLEAN
+setupUniverseBench (void **state)
+{
+	extern STAR_DESC starmap_array[];
+	extern const BYTE element_array[];
+	extern const PlanetFrame planet_array[];
+
+	star_array = starmap_array;
+	Elements = element_array;
+	PlanData = planet_array;
+	if (!InitGameStructures ())
+		return FALSE;
+	InitGameClock ();
+
+	*state = HMalloc (sizeof (UniverseIndex));
+	return TRUE;
+}
+
+static void
+runUniverseIndex (void *state)
+{
+	buildUniverseIndex ((UniverseIndex *) state);
+}
+
+static void
+cleanupUniverseBench (void *state)
+{
+	HFree (state);
+	UninitGameClock ();
+	UninitGameStructures ();
+}
+#endif  /* defined(DEBUG) || defined(USE_DEBUG_KEY) */
+
+// Plays back the match given with --replaymelee, as fast as possible and
+// without drawing. The time includes loading the SuperMelee resources;
+// Replay_matchEnd() logs the frame rate of the battle alone.
+static BOOLEAN
+setupMeleeBench (void **state)
+{
+	MeleeBenchState *bench;
+
+	if (replayOptions.playFile == NULL)
+		return FALSE;
+
+	bench = HMalloc (sizeof *bench);
+	bench->playSpeed = replayOptions.playSpeed;
+	replayOptions.playSpeed = REPLAY_SPEED_MAX;
+	*state = bench;
+	return TRUE;
+}
+
+static void
+runMelee (void *state)
+{
+	GLOBAL (CurrentActivity) = SUPER_MELEE;
+	FreeGameData ();
+	Melee ();
+	GLOBAL (CurrentActivity) = 0;
+	(void) state;
+}
+
+static DWORD
+countMeleeFrames (void *state)
+{
+	(void) state;
+	return Replay_getPlayedFrames ();
+}
+
+static void
+cleanupMeleeBench (void *state)
+{
+	MeleeBenchState *bench = state;
+
+	replayOptions.playSpeed = bench->playSpeed;
+	HFree (bench);
+}
+
+static int
+compareTimes (const void *a, const void *b)
+{
+	uint64 ta = *(const uint64 *) a;
+	uint64 tb = *(const uint64 *) b;
+
+	return (ta > tb) - (ta < tb);
+}
+
+static double
+countsToUs (double counts)
+{
+	uint64 frequency = GetPerfFrequency ();
+	return counts * 1000000.0 / (double) frequency;
+}
+
+static void
+runBenchmark (FILE *out, const Benchmark *bench, BOOLEAN first)
+{
+	void *state = NULL;
+	uint64 *times;
+	DWORD opsPerSample = bench->opsPerSample;
+	COUNT i;
+	double sum = 0.0;
+	double sumSq = 0.0;
+	double mean;
+	double stddev;
+	double median;
+
+	fprintf (out, "%s\n\t\t{\n\t\t\t\"name\": \"%s\",\n", first ? "" : ",",
+			bench->name);
+
+	if (bench->setup != NULL && !(*bench->setup) (&state))
+	{
+		log_add (log_Warning, "Benchmark %s skipped: could not be "
+				"set up.", bench->name);
+		fprintf (out, "\t\t\t\"skipped\": true\n\t\t}");
+		return;
+	}
+
+	for (i = 0; i < bench->warmup; i++)
+		(*bench->run) (state);
+
+	times = HMalloc (bench->samples * sizeof *times);
+	for (i = 0; i < bench->samples; i++)
+	{
+		uint64 start = GetPerfCounter ();
+		(*bench->run) (state);
+		times[i] = GetPerfCounter () - start;
+	}
+
+	if (bench->countOps != NULL)
+		opsPerSample = (*bench->countOps) (state);
+	if (opsPerSample == 0)
+		opsPerSample = 1;
+
+	if (bench->cleanup != NULL)
+		(*bench->cleanup) (state);
+
+	for (i = 0; i < bench->samples; i++)
+	{
+		sum += (double) times[i];
+		sumSq += (double) times[i] * (double) times[i];
+	}
+	mean = sum / bench->samples;
+	stddev = sumSq / bench->samples - mean * mean;
+	stddev = stddev > 0.0 ? sqrt (stddev) : 0.0;
+
+	qsort (times, bench->samples, sizeof *times, compareTimes);
+	if (bench->samples & 1)
+		median = (double) times[bench->samples / 2];
+	else
+		median = ((double) times[bench->samples / 2 - 1]
+				+ (double) times[bench->samples / 2]) / 2.0;
+
+	fprintf (out, "\t\t\t\"warmup\": %u,\n"
+			"\t\t\t\"samples\": %u,\n"
+			"\t\t\t\"ops_per_sample\": %lu,\n"
+			"\t\t\t\"min_us\": %.3f,\n"
+			"\t\t\t\"median_us\": %.3f,\n"
+			"\t\t\t\"mean_us\": %.3f,\n"
+			"\t\t\t\"stddev_us\": %.3f,\n"
+			"\t\t\t\"max_us\": %.3f,\n"
+			"\t\t\t\"median_us_per_op\": %.3f\n"
+			"\t\t}",
+			bench->warmup, bench->samples, (unsigned long) opsPerSample,
+			countsToUs ((double) times[0]), countsToUs (median),
+			countsToUs (mean), countsToUs (stddev),
+			countsToUs ((double) times[bench->samples - 1]),
+			countsToUs (median) / opsPerSample);
+
+	log_add (log_Debug, "Benchmark %s: median %.3f us, %.3f us per op",
+			bench->name, countsToUs (median),
+			countsToUs (median) / opsPerSample);
+
+	HFree (times);
+}
+
+static void
+runBenchmarkList (const Benchmark *list, COUNT count)
+{
+	COUNT i;
+
+	for (i = 0; i < count; i++)
+	{
+		runBenchmark (benchOut, &list[i], benchFirst);
+		benchFirst = FALSE;
+		fflush (benchOut);
+	}
+}
+
+void
+startBenchmarks (void)
+{
+	benchOut = fopen (benchFile, "w");
+	if (benchOut == NULL)
+	{
+		log_add (log_Error, "Error: Could not open file '%s' for "
+				"writing: %s", benchFile, strerror (errno));
+		return;
+	}
+
+	log_add (log_Info, "Running the benchmarks; the results are written "
+			"to '%s'.", benchFile);
+	fprintf (benchOut, "{\n\t\"version\": \"%s\",\n\t\"benchmarks\": [",
+			UQM_STRING_VERSION);
+	benchFirst = TRUE;
+	runBenchmarkList (mixerBenchmarks, NUM_MIXER_BENCHMARKS);
+}
+
+void
+finishBenchmarks (void)
+{
+	if (benchOut == NULL)
+		return;
+
+	runBenchmarkList (benchmarks, NUM_BENCHMARKS);
+	fprintf (benchOut, "\n\t]\n}\n");
+	fclose (benchOut);
+	benchOut = NULL;
+
+	log_add (log_Info, "Benchmarks complete.");
+}
+
@@ -0,0 +1,45 @@
+/*
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+// Benchmarks of the hot paths of the game, run with --bench=FILE instead
+// of the game itself. The results are written to FILE as JSON.
+
+#ifndef UQM_UQMBENCH_H_
+#define UQM_UQMBENCH_H_
+
+#include "libs/compiler.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+extern const char *benchFile;
+		// Set by --bench; NULL to play the game.
+
+// Opens 'benchFile', and runs the benchmarks that need the mixer to
+// themselves. Called on the Starcon2Main thread, before the audio driver
+// is started.
+void startBenchmarks (void);
+// Runs the other benchmarks, and closes 'benchFile'. Called on the
+// Starcon2Main thread, once the game kernel is loaded, instead of
+// showing the main menu.
+void finishBenchmarks (void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif  /* UQM_UQMBENCH_H_ */
@@ -32,10 +32,15 @@
 #include "globdata.h"
 #include "planets/lifeform.h"
 #include "planets/scan.h"
+#include "planets/generate/gendefault.h"
 #include "races.h"
 #include "setup.h"
 #include "state.h"
+#include "libs/log.h"
 #include "libs/mathlib.h"
+#include "libs/memlib.h"
+#include "libs/threadlib.h"
+#include "libs/timelib.h"
 
 #include <stdio.h>
 #include <errno.h>
@@ -55,19 +60,15 @@ static void dumpPlanetCallback (const PLANET_DESC *planet, void *arg);
 static void dumpMoonCallback (const PLANET_DESC *moon, void *arg);
 static void dumpWorld (FILE *out, const PLANET_DESC *world);
 
-typedef struct TallyResourcesArg TallyResourcesArg;
-static void tallySystemPreCallback (const STAR_DESC *star, const
-		SOLARSYS_STATE *system, void *arg);
-static void tallySystemPostCallback (const STAR_DESC *star, const
-		SOLARSYS_STATE *system, void *arg);
-static void tallyPlanetCallback (const PLANET_DESC *planet, void *arg);
-static void tallyMoonCallback (const PLANET_DESC *moon, void *arg);
-static void tallyResourcesWorld (TallyResourcesArg *arg,
-		const PLANET_DESC *world);
+static void indexSystem (STAR_DESC *star, SOLARSYS_STATE *system,
+		RandomContext *rng, UniverseIndexSystem *entry);
+static void indexWorld (SOLARSYS_STATE *system, PLANET_DESC *world,
+		BYTE planetI, BYTE moonI, UniverseIndexSystem *entry);
 
 static void dumpPlanetTypeCallback (int index, const PlanetFrame *planet,
 		void *arg);
 
+extern STAR_DESC starmap_array[];
 
 BOOLEAN instantMove = FALSE;
 BOOLEAN disableInteractivity = FALSE;
@@ -152,41 +153,18 @@ debugKeyPressed (void)
 void
 forwardToNextEvent (BOOLEAN skipHEE)
 {
-	HEVENT hEvent;
-	EVENT *EventPtr;
-	COUNT year, month, day;
-			// time of next event
-	BOOLEAN done;
+	BYTE func_index;
 
 	if (!GameClockRunning ())
 		return;
 
 	LockGameClock ();
 
-	done = !skipHEE;
-	do {
-		hEvent = GetHeadEvent ();
-		if (hEvent == 0)
-			return;
-		LockEvent (hEvent, &EventPtr);
-		if (EventPtr->func_index != HYPERSPACE_ENCOUNTER_EVENT)
-			done = TRUE;
-		year = EventPtr->year_index;
-		month = EventPtr->month_index;
-		day = EventPtr->day_index;
-		UnlockEvent (hEvent);
-
-		for (;;) {
-			if (GLOBAL (GameClock.year_index) > year ||
-					(GLOBAL (GameClock.year_index) == year &&
-					(GLOBAL (GameClock.month_index) > month ||
-					(GLOBAL (GameClock.month_index) == month &&
-					GLOBAL (GameClock.day_index) >= day))))
-				break;
-
-			MoveGameClockDays (1);
-		}
-	} while (!done);
+	while (MoveGameClockToNextEvent (&func_index))
+	{
+		if (!skipHEE || func_index != HYPERSPACE_ENCOUNTER_EVENT)
+			break;
+	}
 
 	UnlockGameClock ();
 }
@@ -566,7 +544,6 @@ void
 forAllStars (void (*callback) (STAR_DESC *, void *), void *arg)
 {
 	int i;
-	extern STAR_DESC starmap_array[];
 
 	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
 		callback (&starmap_array[i], arg);
@@ -646,6 +623,8 @@ starRecurse (STAR_DESC *star, void *arg)
 	SolarSysState.SunDesc[0].location.y = 0;
 	//SolarSysState.SunDesc[0].radius = MIN_ZOOM_RADIUS;
 	SolarSysState.genFuncs = getGenerateFunctions (star->Index);
+	SolarSysState.star = star;
+	SolarSysState.rng = SysGenRNG;
 
 	pSolarSysState = &SolarSysState;
 	(*SolarSysState.genFuncs->generatePlanets) (&SolarSysState);
@@ -688,7 +667,7 @@ planetRecurse (STAR_DESC *star, SOLARSYS_STATE *system, PLANET_DESC *planet,
 	if (universeRecurseArg->planetFuncPre != NULL)
 	{
 		system->pOrbitalDesc = planet;
-		DoPlanetaryAnalysis (&system->SysInfo, planet);
+		DoPlanetaryAnalysis (system, &system->SysInfo, planet);
 				// When GenerateDefaultFunctions is used as genFuncs,
 				// generateOrbital will also call DoPlanetaryAnalysis,
 				// but with other GenerateFunctions this is not guaranteed.
@@ -710,7 +689,7 @@ planetRecurse (STAR_DESC *star, SOLARSYS_STATE *system, PLANET_DESC *planet,
 	if (universeRecurseArg->planetFuncPost != NULL)
 	{
 		system->pOrbitalDesc = planet;
-		DoPlanetaryAnalysis (&system->SysInfo, planet);
+		DoPlanetaryAnalysis (system, &system->SysInfo, planet);
 				// When GenerateDefaultFunctions is used as genFuncs,
 				// generateOrbital will also call DoPlanetaryAnalysis,
 				// but with other GenerateFunctions this is not guaranteed.
@@ -736,7 +715,7 @@ moonRecurse (STAR_DESC *star, SOLARSYS_STATE *system, PLANET_DESC *planet,
 		system->pOrbitalDesc = moon;
 		if (moon->data_index != HIERARCHY_STARBASE && moon->data_index != SA_MATRA)
 		{
-			DoPlanetaryAnalysis (&system->SysInfo, moon);
+			DoPlanetaryAnalysis (system, &system->SysInfo, moon);
 				// When GenerateDefaultFunctions is used as genFuncs,
 				// generateOrbital will also call DoPlanetaryAnalysis,
 				// but with other GenerateFunctions this is not guaranteed.
@@ -1149,110 +1128,252 @@ generateMineralIndex(const SOLARSYS_STATE *system, const PLANET_DESC *world,
 
 ////////////////////////////////////////////////////////////////////////////
 
-struct TallyResourcesArg
+#define UNIVERSE_INDEX_THREADS 4
+		// Number of threads generating systems in buildUniverseIndex().
+
+typedef struct
 {
-	FILE *out;
-	COUNT mineralCount;
-	COUNT bioCount;
-};
+	UniverseIndex *index;
+	COUNT first;
+			// This thread handles starmap_array[first], and every
+			// UNIVERSE_INDEX_THREADS'th system after it.
+	Semaphore done;
+} UniverseIndexWorkerArg;
+
+// Whether the worlds of a star system can be generated away from the
+// Starcon2Main thread: whether every generate function that indexSystem()
+// calls for it is the default one. The default ones only use the
+// SOLARSYS_STATE they are given; the ones of the special systems load
+// graphics and read or change the game state.
+static BOOLEAN
+isDefaultSystem (const STAR_DESC *star)
+{
+	const GenerateFunctions *genFuncs = getGenerateFunctions (star->Index);
 
-// Must be called from the Starcon2Main thread.
-void
-tallyResources (FILE *out)
+	return genFuncs->generatePlanets == GenerateDefault_generatePlanets
+			&& genFuncs->generateMoons == GenerateDefault_generateMoons
+			&& genFuncs->generateOrbital == GenerateDefault_generateOrbital
+			&& genFuncs->generateMinerals == GenerateDefault_generateMinerals
+			&& genFuncs->generateEnergy == GenerateDefault_generateEnergy
+			&& genFuncs->generateLife == GenerateDefault_generateLife;
+}
+
+static int
+universeIndexWorker (void *data)
 {
-	TallyResourcesArg tallyResourcesArg;
-	UniverseRecurseArg universeRecurseArg;
-	
-	tallyResourcesArg.out = out;
+	UniverseIndexWorkerArg *arg = (UniverseIndexWorkerArg *) data;
+	RandomContext *rng;
+	SOLARSYS_STATE system;
+	COUNT i;
 
-	universeRecurseArg.systemFuncPre = tallySystemPreCallback;
-	universeRecurseArg.systemFuncPost = tallySystemPostCallback;
-	universeRecurseArg.planetFuncPre = tallyPlanetCallback;
-	universeRecurseArg.planetFuncPost = NULL;
-	universeRecurseArg.moonFunc = tallyMoonCallback;
-	universeRecurseArg.arg = (void *) &tallyResourcesArg;
+	rng = RandomContext_New ();
+	for (i = arg->first; i < NUM_SOLAR_SYSTEMS; i += UNIVERSE_INDEX_THREADS)
+	{
+		if (isDefaultSystem (&starmap_array[i]))
+		{
+			indexSystem (&starmap_array[i], &system, rng,
+					&arg->index->systems[i]);
+		}
+	}
+	RandomContext_Delete (rng);
 
-	UniverseRecurse (&universeRecurseArg);
+	ClearSemaphore (arg->done);
+	return 0;
 }
 
 // Must be called from the Starcon2Main thread.
 void
-tallyResourcesToFile (void)
+buildUniverseIndex (UniverseIndex *index)
 {
-	FILE *out;
+	UniverseIndexWorkerArg workerArgs[UNIVERSE_INDEX_THREADS];
+	Semaphore done;
+	SOLARSYS_STATE SolarSysState;
+	SOLARSYS_STATE *oldPSolarSysState = pSolarSysState;
+	STAR_DESC *oldStarDescPtr = CurStarDescPtr;
+	ACTIVITY savedActivity;
+	RandomContext *rng;
+	uint64 startTime;
+	COUNT i;
 
-#	define RESOURCE_TALLY_FILE "ResourceTally"
-	out = fopen(RESOURCE_TALLY_FILE, "w");
-	if (out == NULL)
+	startTime = GetPerfCounter ();
+
+	// The special systems are generated on this thread first, as
+	// UniverseRecurse() does. They change pSolarSysState, CurStarDescPtr
+	// and the game state, so that is done before the workers start.
+	LockGameClock ();
+	savedActivity = GLOBAL (CurrentActivity);
+	disableInteractivity = TRUE;
+
+	rng = RandomContext_New ();
+	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
 	{
-		fprintf(stderr, "Error: Could not open file '%s' for "
-				"writing: %s\n", RESOURCE_TALLY_FILE, strerror(errno));
-		return;
+		STAR_DESC *star = &starmap_array[i];
+
+		if (isDefaultSystem (star))
+			continue;
+
+		CurStarDescPtr = star;
+		pSolarSysState = &SolarSysState;
+		indexSystem (star, &SolarSysState, rng, &index->systems[i]);
 	}
+	RandomContext_Delete (rng);
+	pSolarSysState = oldPSolarSysState;
+	CurStarDescPtr = oldStarDescPtr;
 
-	tallyResources (out);
-	
-	fclose(out);
+	disableInteractivity = FALSE;
+	GLOBAL (CurrentActivity) = savedActivity;
+	UnlockGameClock ();
 
-	fprintf(stdout, "*** Resource tally complete. The game may be in an "
-			"undefined state.\n");
-			// Data generation may have changed the game state,
-			// in particular for special planet generation.
-}
+	done = CreateSemaphore (0, "Universe index workers",
+			SYNC_CLASS_RESOURCE);
+	for (i = 0; i < UNIVERSE_INDEX_THREADS; i++)
+	{
+		workerArgs[i].index = index;
+		workerArgs[i].first = i;
+		workerArgs[i].done = done;
+		if (!CreateThread (universeIndexWorker, &workerArgs[i], 0,
+				"Universe index worker"))
+		{
+			// Do its share here; it still clears 'done' once.
+			universeIndexWorker (&workerArgs[i]);
+		}
+	}
 
-static void
-tallySystemPreCallback (const STAR_DESC *star, const SOLARSYS_STATE *system,
-		void *arg)
-{
-	TallyResourcesArg *tallyResourcesArg = (TallyResourcesArg *) arg;
-	tallyResourcesArg->mineralCount = 0;
-	tallyResourcesArg->bioCount = 0;
-	
-	(void) star;  /* satisfy compiler */
-	(void) system;  /* satisfy compiler */
+	for (i = 0; i < UNIVERSE_INDEX_THREADS; i++)
+		SetSemaphore (done);
+	DestroySemaphore (done);
+
+	log_add (log_Debug, "buildUniverseIndex(): %d systems generated in "
+			"%.2f ms", NUM_SOLAR_SYSTEMS,
+			(double) (GetPerfCounter () - startTime) * 1000.0
+			/ GetPerfFrequency ());
 }
 
+// Generates the system and all its worlds, the same way as
+// UniverseRecurse(), but using only 'system' and 'rng'.
 static void
-tallySystemPostCallback (const STAR_DESC *star, const SOLARSYS_STATE *system,
-		void *arg)
+indexSystem (STAR_DESC *star, SOLARSYS_STATE *system, RandomContext *rng,
+		UniverseIndexSystem *entry)
 {
-	UNICODE name[256];
-	TallyResourcesArg *tallyResourcesArg = (TallyResourcesArg *) arg;
-	FILE *out = tallyResourcesArg->out;
+	BYTE i;
+	BYTE j;
 
-	GetClusterName (star, name);
-	fprintf (out, "%s\t%d\t%d\n", name, tallyResourcesArg->mineralCount,
-			tallyResourcesArg->bioCount);
+	memset (system, 0, sizeof (*system));
+	system->genFuncs = getGenerateFunctions (star->Index);
+	system->star = star;
+	system->rng = rng;
 
-	(void) star;  /* satisfy compiler */
-	(void) system;  /* satisfy compiler */
+	RandomContext_SeedRandom (rng, GetRandomSeedForStar (star));
+	system->SunDesc[0].rand_seed = RandomContext_Random (rng);
+	system->SunDesc[0].data_index = STAR_TYPE (star->Type);
+	(*system->genFuncs->generatePlanets) (system);
+
+	entry->star = star;
+	entry->numWorlds = 0;
+	entry->mineralValue = 0;
+	entry->bioValue = 0;
+
+	for (i = 0; i < system->SunDesc[0].NumPlanets; i++)
+	{
+		PLANET_DESC *planet = &system->PlanetDesc[i];
+
+		planet->pPrevDesc = &system->SunDesc[0];
+		indexWorld (system, planet, i, MATCH_PLANET, entry);
+
+		RandomContext_SeedRandom (rng, planet->rand_seed);
+		(*system->genFuncs->generateMoons) (system, planet);
+
+		for (j = 0; j < planet->NumPlanets; j++)
+		{
+			PLANET_DESC *moon = &system->MoonDesc[j];
+
+			moon->pPrevDesc = planet;
+			indexWorld (system, moon, i, j, entry);
+		}
+	}
 }
 
 static void
-tallyPlanetCallback (const PLANET_DESC *planet, void *arg)
+indexWorld (SOLARSYS_STATE *system, PLANET_DESC *world, BYTE planetI,
+		BYTE moonI, UniverseIndexSystem *entry)
 {
-	tallyResourcesWorld ((TallyResourcesArg *) arg, planet);
+	UniverseIndexWorld *worldEntry = &entry->worlds[entry->numWorlds++];
+	BOOLEAN realWorld = world->data_index != HIERARCHY_STARBASE
+			&& world->data_index != SA_MATRA;
+
+	worldEntry->data_index = world->data_index;
+	worldEntry->planetI = planetI;
+	worldEntry->moonI = moonI;
+	worldEntry->mineralValue = 0;
+	worldEntry->bioValue = 0;
+
+	system->pOrbitalDesc = world;
+	if (system->genFuncs->generateOrbital == GenerateDefault_generateOrbital)
+	{
+		GenerateDefault_analyzeWorld (system, world);
+	}
+	else
+	{
+		if (realWorld)
+			DoPlanetaryAnalysis (system, &system->SysInfo, world);
+		(*system->genFuncs->generateOrbital) (system, world);
+	}
+
+	if (!realWorld)
+		return;
+
+	worldEntry->bioValue = calculateBioValue (system, world);
+	worldEntry->mineralValue = calculateMineralValue (system, world);
+	entry->bioValue += worldEntry->bioValue;
+	entry->mineralValue += worldEntry->mineralValue;
 }
 
-static void
-tallyMoonCallback (const PLANET_DESC *moon, void *arg)
+// Must be called from the Starcon2Main thread.
+void
+tallyResources (FILE *out)
 {
-	tallyResourcesWorld ((TallyResourcesArg *) arg, moon);
+	UniverseIndex *index;
+	COUNT i;
+
+	index = HMalloc (sizeof (*index));
+	buildUniverseIndex (index);
+
+	for (i = 0; i < NUM_SOLAR_SYSTEMS; i++)
+	{
+		const UniverseIndexSystem *entry = &index->systems[i];
+		UNICODE name[256];
+
+		GetClusterName (entry->star, name);
+		fprintf (out, "%s\t%d\t%d\n", name, entry->mineralValue,
+				entry->bioValue);
+	}
+
+	HFree (index);
 }
 
-static void
-tallyResourcesWorld (TallyResourcesArg *arg, const PLANET_DESC *world)
+// Must be called from the Starcon2Main thread.
+void
+tallyResourcesToFile (void)
 {
-	if (world->data_index == HIERARCHY_STARBASE) {
+	FILE *out;
+
+#	define RESOURCE_TALLY_FILE "ResourceTally"
+	out = fopen(RESOURCE_TALLY_FILE, "w");
+	if (out == NULL)
+	{
+		fprintf(stderr, "Error: Could not open file '%s' for "
+				"writing: %s\n", RESOURCE_TALLY_FILE, strerror(errno));
 		return;
 	}
+
+	tallyResources (out);
 	
-	if (world->data_index == SA_MATRA) {
-		return;
-	}
+	fclose(out);
 
-	arg->bioCount += calculateBioValue (pSolarSysState, world),
-	arg->mineralCount += calculateMineralValue (pSolarSysState, world);
+	fprintf(stdout, "*** Resource tally complete. The game may be in an "
+			"undefined state.\n");
+			// Data generation may have changed the game state,
+			// in particular for special planet generation.
 }
 
 ////////////////////////////////////////////////////////////////////////////
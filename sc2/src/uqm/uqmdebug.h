@@ -19,6 +19,7 @@
 
 #include "clock.h"
 #include "planets/planets.h"
+#include "starmap.h"
 #include "races.h"
 #include "libs/compiler.h"
 
@@ -138,6 +139,43 @@ COUNT calculateBioValue (const SOLARSYS_STATE *system,
 void generateBioIndex(const SOLARSYS_STATE *system,
 		const PLANET_DESC *world, COUNT bio[]);
 
+// One world in a UniverseIndex.
+typedef struct
+{
+	BYTE data_index;
+			// World type, as in PLANET_DESC.
+	BYTE planetI;
+	BYTE moonI;
+			// MATCH_PLANET for a planet.
+	COUNT mineralValue;
+	COUNT bioValue;
+			// 0 for the Starbase and the Sa-Matra.
+} UniverseIndexWorld;
+
+// One star system in a UniverseIndex.
+typedef struct
+{
+	const STAR_DESC *star;
+	COUNT numWorlds;
+	COUNT mineralValue;
+	COUNT bioValue;
+			// Totals for all worlds in the system.
+	UniverseIndexWorld worlds[MAX_PLANETS * (1 + MAX_MOONS)];
+			// Each planet, followed by its moons.
+} UniverseIndexSystem;
+
+// The worlds and resources of the entire universe, in the order of
+// starmap_array[].
+typedef struct
+{
+	UniverseIndexSystem systems[NUM_SOLAR_SYSTEMS];
+} UniverseIndex;
+
+// Generate every star system into 'index'. Systems with default worlds
+// are generated in parallel; the result is the same as that of
+// UniverseRecurse(). Must be called on the Starcon2Main thread.
+void buildUniverseIndex (UniverseIndex *index);
+
 // Tally the resources for each star system.
 // Must be called on the Starcon2Main thread.
 void tallyResources (FILE *out);
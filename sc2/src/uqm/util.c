@@ -174,19 +174,19 @@ PauseGame (void)
 	while (ImmediateInputState.menu[KEY_PAUSE] && GamePaused)
 	{
 		BeginInputFrame ();
-		TaskSwitch ();
+		WaitInputEventUntil (GetTimeCounter () + ONE_SECOND / 10);
 	}
 
 	while (!ImmediateInputState.menu[KEY_PAUSE] && GamePaused)
 	{
 		BeginInputFrame ();
-		TaskSwitch ();
+		WaitInputEventUntil (GetTimeCounter () + ONE_SECOND / 10);
 	}
 
 	while (ImmediateInputState.menu[KEY_PAUSE] && GamePaused)
 	{
 		BeginInputFrame ();
-		TaskSwitch ();
+		WaitInputEventUntil (GetTimeCounter () + ONE_SECOND / 10);
 	}
 
 	GamePaused = FALSE;
@@ -228,7 +228,7 @@ WaitForAnyButtonUntil (BOOLEAN newButton, TimeCount timeOut,
 			&& !(GLOBAL (CurrentActivity) & CHECK_ABORT)
 			&& !QuitPosted)
 	{
-		SleepThread (ONE_SECOND / 40);
+		SleepThreadUntilInput (GetTimeCounter () + ONE_SECOND / 40);
 		buttonPressed = AnyButtonPress (TRUE);
 	} 
 
@@ -260,7 +260,7 @@ WaitForNoInputUntil (TimeCount timeOut, BOOLEAN resetInput)
 			&& !(GLOBAL (CurrentActivity) & CHECK_ABORT)
 			&& !QuitPosted)
 	{
-		SleepThread (ONE_SECOND / 40);
+		SleepThreadUntilInput (GetTimeCounter () + ONE_SECOND / 40);
 		buttonPressed = AnyButtonPress (TRUE);
 	} 
 
@@ -0,0 +1,21 @@
+#!/bin/sh
+# Generates the manifest for the http content file system.
+# Usage: wasm/mkmanifest.sh <content dir> [<base url>]
+# The manifest is written to <content dir>/content.manifest.
+# The base URL defaults to "content/", which is resolved relative to
+# uqm.js (the fetches are made from its worker threads).
+
+set -e
+
+CONTENT_DIR="${1:?usage: $0 <content dir> [<base url>]}"
+BASE_URL="${2:-content/}"
+MANIFEST="content.manifest"
+
+cd "$CONTENT_DIR"
+{
+	echo "# uqm content manifest 1"
+	echo "base $BASE_URL"
+	find . -type f ! -name "$MANIFEST*" -printf '%s %T@ %P\n' |
+			sed -e 's/^\([0-9]*\) \([0-9]*\)[.0-9]* /\1 \2 /' | LC_ALL=C sort -k 3
+} > "$MANIFEST.tmp"
+mv "$MANIFEST.tmp" "$MANIFEST"